@@ -0,0 +1,212 @@
+﻿#include "ProfilerWindow.h"
+#include "DirectXCommon.h"
+#include "Model.h"
+#include "Profiler.h"
+#include <algorithm>
+#include <imgui.h>
+
+namespace {
+
+// トレースの保存先
+const char* const kTraceFilePath = "profile.json";
+// 1段の高さ
+const float kRowHeight = 18.0f;
+// 段の名前を書く幅
+const float kLabelWidth = 80.0f;
+
+// 区間の色（名前毎に固定）
+ImU32 GetEventColor(const char* name) {
+	uint32_t hash = 2166136261u;
+	for (const char* c = name; *c; c++) {
+		hash = (hash ^ static_cast<uint8_t>(*c)) * 16777619u;
+	}
+	return ImColor::HSV(static_cast<float>(hash % 360) / 360.0f, 0.5f, 0.75f);
+}
+
+// ナノ秒をミリ秒にする
+float ToMilliseconds(uint64_t nanoseconds) {
+	return static_cast<float>(static_cast<double>(nanoseconds) / 1000000.0);
+}
+
+} // namespace
+
+ProfilerWindow* ProfilerWindow::GetInstance() {
+	static ProfilerWindow instance;
+	return &instance;
+}
+
+void ProfilerWindow::Draw() {
+	Profiler* profiler = Profiler::GetInstance();
+
+	if (!ImGui::Begin("Profiler")) {
+		ImGui::End();
+		return;
+	}
+
+	// 前のフレームの時間
+	float frameTime = DirectXCommon::GetInstance()->GetFrameTime();
+	ImGui::Text(
+	    "Frame %.2f ms (%.1f fps)", frameTime * 1000.0f, 1.0f / (std::max)(frameTime, 1e-6f));
+	const Profiler::Statistics& statistics = profiler->GetStatistics();
+	ImGui::Text(
+	    "Events %llu  Dropped %llu", static_cast<unsigned long long>(statistics.recordedEventCount),
+	    static_cast<unsigned long long>(statistics.droppedEventCount));
+
+	DrawStatistics();
+
+	bool paused = profiler->IsPaused();
+	if (ImGui::Checkbox("Pause", &paused)) {
+		profiler->SetPaused(paused);
+	}
+	ImGui::SameLine();
+	if (ImGui::Button("Save Trace")) {
+		saveMessage_ = profiler->SaveChromeTrace(kTraceFilePath) ? "Saved profile.json" : "Failed";
+	}
+	if (saveMessage_) {
+		ImGui::SameLine();
+		ImGui::TextUnformatted(saveMessage_);
+	}
+
+	uint32_t frameCount = profiler->GetFrameCount();
+	if (frameCount == 0) {
+		ImGui::End();
+		return;
+	}
+
+	// フレーム時間の推移
+	float frameTimes[Profiler::kFrameHistoryCount];
+	for (uint32_t i = 0; i < frameCount; i++) {
+		const Profiler::Frame& frame = profiler->GetFrame(i);
+		frameTimes[i] = ToMilliseconds(frame.end - frame.begin);
+	}
+	ImGui::PlotLines(
+	    "##FrameTimes", frameTimes, static_cast<int>(frameCount), 0, "Frame (ms)", 0.0f, 33.3f,
+	    ImVec2(ImGui::GetContentRegionAvail().x, 60.0f));
+
+	// 表示するフレーム。記録中はGPUの結果が届いている最新のもの、停止中は選んだもの
+	uint32_t shownFrame = frameCount - 1;
+	if (paused) {
+		selectedFrame_ = (std::min)(selectedFrame_, static_cast<int>(frameCount) - 1);
+		ImGui::SliderInt("Frame", &selectedFrame_, 0, static_cast<int>(frameCount) - 1);
+		shownFrame = static_cast<uint32_t>(selectedFrame_);
+	} else {
+		while (0 < shownFrame && profiler->GetFrame(shownFrame).gpuEvents.empty()) {
+			shownFrame--;
+		}
+		if (profiler->GetFrame(shownFrame).gpuEvents.empty()) {
+			shownFrame = frameCount - 1;
+		}
+		selectedFrame_ = static_cast<int>(shownFrame);
+	}
+
+	DrawFlameGraph(shownFrame);
+
+	ImGui::End();
+}
+
+void ProfilerWindow::DrawStatistics() {
+	// ResetDrawStatisticsの前に呼ぶので、前のフレームの描画統計になる
+	if (!ImGui::CollapsingHeader("Draw Statistics")) {
+		return;
+	}
+	const Model::DrawStatistics& draw = Model::GetDrawStatistics();
+	ImGui::Text(
+	    "Models   visible %u  culled %u", draw.submittedModelCount - draw.culledModelCount,
+	    draw.culledModelCount);
+	ImGui::Text(
+	    "Meshes   drawn %u  culled %u  occluded %u", draw.drawnMeshCount, draw.culledMeshCount,
+	    draw.occludedMeshCount);
+	ImGui::Text(
+	    "Meshlets drawn %u  culled %u", draw.drawnMeshletCount, draw.culledMeshletCount);
+	ImGui::Text("Triangles %u", draw.drawnTriangleCount);
+	ImGui::Text(
+	    "Shadow   drawn %u  culled %u", draw.shadowDrawnMeshCount, draw.shadowCulledMeshCount);
+
+	// ライトの転送量（前のフレームのPreDrawから描画までの分）
+	const LightGroup::UploadStatistics& light = Model::GetLightUploadStatistics();
+	ImGui::Text(
+	    "Light upload %u B  const %u  lights %u (%u ranges)  clusters %u", light.totalBytes,
+	    light.constantBytes, light.lightBytes, light.lightRangeCount, light.clusterBytes);
+	if (light.unlitViewCount > 0) {
+		ImGui::TextColored(
+		    ImVec4(1.0f, 0.4f, 0.4f, 1.0f), "Light views over kMaxViewCount: %u draws unlit",
+		    light.unlitViewCount);
+	}
+}
+
+void ProfilerWindow::DrawFlameGraph(uint32_t frameIndex) {
+	Profiler* profiler = Profiler::GetInstance();
+	const Profiler::Frame& frame = profiler->GetFrame(frameIndex);
+
+	// 表示する時間の範囲（前のフレームから続く区間もあるので区間も含める）
+	uint64_t begin = frame.begin;
+	uint64_t end = frame.end;
+	for (const std::vector<Profiler::Event>* events : {&frame.cpuEvents, &frame.gpuEvents}) {
+		for (const Profiler::Event& event : *events) {
+			begin = (std::min)(begin, event.begin);
+			end = (std::max)(end, event.end);
+		}
+	}
+	ImGui::Text(
+	    "Frame %llu  %.3f ms", static_cast<unsigned long long>(frame.index),
+	    ToMilliseconds(frame.end - frame.begin));
+
+	ImDrawList* drawList = ImGui::GetWindowDrawList();
+	ImVec2 origin = ImGui::GetCursorScreenPos();
+	float width = (std::max)(ImGui::GetContentRegionAvail().x - kLabelWidth, 1.0f);
+	float scale = width / static_cast<float>((std::max)(end - begin, uint64_t(1)));
+	ImVec2 mouse = ImGui::GetIO().MousePos;
+	float y = origin.y;
+
+	// 1段分（同じスレッドの区間）を描く
+	auto drawLane = [&](const char* label, const Profiler::Event* events, size_t count) {
+		uint32_t maxDepth = 0;
+		for (size_t i = 0; i < count; i++) {
+			maxDepth = (std::max)(maxDepth, events[i].depth);
+		}
+		drawList->AddText(ImVec2(origin.x, y), ImGui::GetColorU32(ImGuiCol_Text), label);
+		for (size_t i = 0; i < count; i++) {
+			const Profiler::Event& event = events[i];
+			ImVec2 min(
+			    origin.x + kLabelWidth + static_cast<float>(event.begin - begin) * scale,
+			    y + static_cast<float>(event.depth) * kRowHeight);
+			ImVec2 max(
+			    (std::max)(
+			        origin.x + kLabelWidth + static_cast<float>(event.end - begin) * scale,
+			        min.x + 1.0f),
+			    min.y + kRowHeight - 1.0f);
+			drawList->AddRectFilled(min, max, GetEventColor(event.name));
+			// 名前は区間からはみ出さないように切る
+			if (max.x - min.x > 8.0f) {
+				drawList->PushClipRect(min, max, true);
+				drawList->AddText(
+				    ImVec2(min.x + 2.0f, min.y + 1.0f), IM_COL32(0, 0, 0, 255), event.name);
+				drawList->PopClipRect();
+			}
+			if (min.x <= mouse.x && mouse.x < max.x && min.y <= mouse.y && mouse.y < max.y) {
+				ImGui::SetTooltip(
+				    "%s\n%.3f ms", event.name, ToMilliseconds(event.end - event.begin));
+			}
+		}
+		y += static_cast<float>(maxDepth + 1) * kRowHeight + 4.0f;
+	};
+
+	// CPUはスレッド毎に並んでいるので、同じスレッドの範囲毎に描く
+	const std::vector<Profiler::Event>& cpuEvents = frame.cpuEvents;
+	for (size_t first = 0; first < cpuEvents.size();) {
+		uint32_t threadIndex = cpuEvents[first].threadIndex;
+		size_t last = first;
+		while (last < cpuEvents.size() && cpuEvents[last].threadIndex == threadIndex) {
+			last++;
+		}
+		std::string name = profiler->GetThreadName(threadIndex);
+		drawLane(name.c_str(), &cpuEvents[first], last - first);
+		first = last;
+	}
+	if (!frame.gpuEvents.empty()) {
+		drawLane("GPU", frame.gpuEvents.data(), frame.gpuEvents.size());
+	}
+
+	// 描いた分の場所を確保する
+	ImGui::Dummy(ImVec2(kLabelWidth + width, y - origin.y));
+}
@@ -0,0 +1,39 @@
+#pragma once
+
+#include <cstdint>
+
+/// <summary>
+/// プロファイラの表示（フレーム時間の推移と描画統計、1フレーム分のフレームグラフ）
+/// </summary>
+class ProfilerWindow {
+public: // 静的メンバ関数
+	/// <summary>
+	/// シングルトンインスタンスの取得
+	/// </summary>
+	/// <returns>シングルトンインスタンス</returns>
+	static ProfilerWindow* GetInstance();
+
+public: // メンバ関数
+	/// <summary>
+	/// ウィンドウの表示（ImGui受付中に呼ぶ）
+	/// </summary>
+	void Draw();
+
+private:
+	ProfilerWindow() = default;
+	~ProfilerWindow() = default;
+	ProfilerWindow(const ProfilerWindow&) = delete;
+	ProfilerWindow& operator=(const ProfilerWindow&) = delete;
+
+	// 前のフレームの描画統計（カリングされた数など）を表示する
+	void DrawStatistics();
+
+	// 1フレーム分の区間をスレッド毎の段に並べて描く
+	void DrawFlameGraph(uint32_t frameIndex);
+
+private: // メンバ変数
+	// 一時停止中に表示するフレーム（古い順の番号）
+	int selectedFrame_ = 0;
+	// トレースの保存結果の表示
+	const char* saveMessage_ = nullptr;
+};
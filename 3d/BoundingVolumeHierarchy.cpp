@@ -0,0 +1,677 @@
+﻿#include "BoundingVolumeHierarchy.h"
+#include "MathUtility.h"
+#include <algorithm>
+#include <cassert>
+#include <cfloat>
+#include <cmath>
+#include <xmmintrin.h>
+
+namespace {
+
+// 空のAABB（最初のMergeで置き換わる）
+const AABB kEmptyAABB = {{FLT_MAX, FLT_MAX, FLT_MAX}, {-FLT_MAX, -FLT_MAX, -FLT_MAX}};
+
+// AABBを合成する
+AABB Merge(const AABB& a, const AABB& b) { return {Min(a.min, b.min), Max(a.max, b.max)}; }
+
+// 表面積の半分（SAHの比較にしか使わないので係数は省く）
+float HalfArea(const AABB& aabb) {
+	Vector3 size = Subtract(aabb.max, aabb.min);
+	if (size.x < 0.0f || size.y < 0.0f || size.z < 0.0f) {
+		return 0.0f;
+	}
+	return size.x * size.y + size.y * size.z + size.z * size.x;
+}
+
+// 表面積の半分（SIMDレジスタ版）
+float HalfArea(__m128 min, __m128 max) {
+	float size[4];
+	_mm_storeu_ps(size, _mm_sub_ps(max, min));
+	if (size[0] < 0.0f || size[1] < 0.0f || size[2] < 0.0f) {
+		return 0.0f;
+	}
+	return size[0] * size[1] + size[1] * size[2] + size[2] * size[0];
+}
+
+// 軸番号で成分を取り出す
+float GetAxis(const Vector3& v, int axis) { return axis == 0 ? v.x : (axis == 1 ? v.y : v.z); }
+
+// AABB同士の交差
+bool Overlaps(const AABB& a, const AABB& b) {
+	return a.min.x <= b.max.x && a.max.x >= b.min.x && a.min.y <= b.max.y &&
+	       a.max.y >= b.min.y && a.min.z <= b.max.z && a.max.z >= b.min.z;
+}
+
+// 球とAABBの交差
+bool Overlaps(const Sphere& sphere, const AABB& aabb) {
+	Vector3 closest = Min(Max(sphere.center, aabb.min), aabb.max);
+	Vector3 difference = Subtract(closest, sphere.center);
+	return Dot(difference, difference) <= sphere.radius * sphere.radius;
+}
+
+// レイとAABBの交差（スラブ法）。当たらなければFLT_MAXを返す
+float IntersectRay(
+  const Vector3& origin, const Vector3& inverseDirection, float maxDistance, const AABB& aabb) {
+	float t1 = (aabb.min.x - origin.x) * inverseDirection.x;
+	float t2 = (aabb.max.x - origin.x) * inverseDirection.x;
+	float tMin = (std::min)(t1, t2);
+	float tMax = (std::max)(t1, t2);
+	t1 = (aabb.min.y - origin.y) * inverseDirection.y;
+	t2 = (aabb.max.y - origin.y) * inverseDirection.y;
+	tMin = (std::max)(tMin, (std::min)(t1, t2));
+	tMax = (std::min)(tMax, (std::max)(t1, t2));
+	t1 = (aabb.min.z - origin.z) * inverseDirection.z;
+	t2 = (aabb.max.z - origin.z) * inverseDirection.z;
+	tMin = (std::max)(tMin, (std::min)(t1, t2));
+	tMax = (std::min)(tMax, (std::max)(t1, t2));
+
+	if (tMax < tMin || tMax < 0.0f || tMin > maxDistance) {
+		return FLT_MAX;
+	}
+	return (std::max)(tMin, 0.0f);
+}
+
+// 0除算でNaNが出ないよう十分大きな値で代用した逆数
+float SafeInverse(float value) {
+	const float kEpsilon = 1.0e-20f;
+	if (std::fabs(value) < kEpsilon) {
+		return value < 0.0f ? -1.0e20f : 1.0e20f;
+	}
+	return 1.0f / value;
+}
+
+} // namespace
+
+BoundingVolumeHierarchy::Handle
+  BoundingVolumeHierarchy::Insert(const AABB& bounds, uint32_t userData) {
+	uint32_t index;
+	if (!freeIndices_.empty()) {
+		index = freeIndices_.back();
+		freeIndices_.pop_back();
+	} else {
+		index = static_cast<uint32_t>(objects_.size());
+		assert(index <= kIndexMask);
+		objects_.push_back({});
+	}
+
+	Object& object = objects_[index];
+	object.bounds = bounds;
+	object.centroid = Multiply(0.5f, Add(bounds.min, bounds.max));
+	object.userData = userData;
+	object.leaf = kInvalidIndex;
+	object.alive = true;
+	object.moved = false;
+	aliveCount_++;
+
+	// 次の再構築までは総当たりで判定する
+	pendingIndices_.push_back(index);
+	return ToHandle(index);
+}
+
+BoundingVolumeHierarchy::Handle BoundingVolumeHierarchy::Insert(
+  const AABB& localBounds, const Matrix4x4& matWorld, uint32_t userData) {
+	return Insert(TransformAABB(localBounds, matWorld), userData);
+}
+
+void BoundingVolumeHierarchy::Remove(Handle handle) {
+	uint32_t index = ToIndex(handle);
+	assert(index != kInvalidIndex);
+	if (index == kInvalidIndex) {
+		return;
+	}
+
+	Object& object = objects_[index];
+	object.alive = false;
+	object.generation++;
+	aliveCount_--;
+
+	if (object.leaf == kInvalidIndex) {
+		// 木に入っていなければすぐ再利用できる
+		pendingIndices_.erase(std::find(pendingIndices_.begin(), pendingIndices_.end(), index));
+		freeIndices_.push_back(index);
+	} else {
+		// 葉が参照しているので再構築まで再利用しない
+		retiredIndices_.push_back(index);
+	}
+}
+
+void BoundingVolumeHierarchy::Move(Handle handle, const AABB& bounds) {
+	uint32_t index = ToIndex(handle);
+	assert(index != kInvalidIndex);
+	if (index == kInvalidIndex) {
+		return;
+	}
+
+	Object& object = objects_[index];
+	object.bounds = bounds;
+	object.centroid = Multiply(0.5f, Add(bounds.min, bounds.max));
+	// 木の境界に入るのは再フィット後なので、それまでは未構築分と同じく総当たりで判定する
+	if (object.leaf != kInvalidIndex && !object.moved) {
+		object.moved = true;
+		movedIndices_.push_back(index);
+		dirtyNodes_[object.leaf] = 1;
+	}
+}
+
+void BoundingVolumeHierarchy::Move(
+  Handle handle, const AABB& localBounds, const Matrix4x4& matWorld) {
+	Move(handle, TransformAABB(localBounds, matWorld));
+}
+
+void BoundingVolumeHierarchy::Update() {
+	// 未構築・削除済みが溜まったら作り直す
+	uint32_t staleCount = static_cast<uint32_t>(pendingIndices_.size() + retiredIndices_.size());
+	uint32_t rebuildCount = (std::max)(kMinRebuildObjectCount, aliveCount_ / 8);
+	if ((nodes_.empty() && aliveCount_ > 0) || staleCount > rebuildCount) {
+		Build();
+		return;
+	}
+
+	if (!movedIndices_.empty()) {
+		Refit();
+		// 移動で木の品質が落ちすぎたら作り直す
+		if (builtRootArea_ > 0.0f &&
+		    HalfArea(nodes_[0].bounds) > builtRootArea_ * kRebuildThreshold) {
+			Build();
+		}
+	}
+}
+
+void BoundingVolumeHierarchy::Build() {
+	// 削除済みの番号をここで解放する
+	freeIndices_.insert(freeIndices_.end(), retiredIndices_.begin(), retiredIndices_.end());
+	retiredIndices_.clear();
+	pendingIndices_.clear();
+	ClearMoved();
+	buildCount_++;
+
+	buildItems_.clear();
+	buildItems_.reserve(aliveCount_);
+	for (uint32_t i = 0; i < objects_.size(); i++) {
+		if (objects_[i].alive) {
+			buildItems_.push_back({objects_[i].bounds, objects_[i].centroid, i});
+		}
+	}
+
+	nodes_.clear();
+	objectIndices_.clear();
+	if (buildItems_.empty()) {
+		dirtyNodes_.clear();
+		builtRootArea_ = 0.0f;
+		return;
+	}
+	uint32_t itemCount = static_cast<uint32_t>(buildItems_.size());
+	nodes_.reserve(itemCount * 2);
+	nodes_.push_back({CalculateBuildBounds(0, itemCount), 0, itemCount});
+
+	// 深さ優先で分割する（子は常に親より後ろの番号になる）
+	// 問い合わせのスタックに収まるよう深さを制限する
+	struct Entry {
+		uint32_t nodeIndex;
+		uint32_t depth;
+	};
+	std::vector<Entry> stack;
+	stack.push_back({0, 0});
+	while (!stack.empty()) {
+		Entry entry = stack.back();
+		stack.pop_back();
+		if (entry.depth + 2 < kMaxStackDepth && Subdivide(entry.nodeIndex)) {
+			uint32_t left = nodes_[entry.nodeIndex].leftOrFirst;
+			stack.push_back({left + 1, entry.depth + 1});
+			stack.push_back({left, entry.depth + 1});
+		}
+	}
+
+	// 並べ替えた順でオブジェクト番号を確定し、葉の所属を記録する
+	objectIndices_.resize(itemCount);
+	for (uint32_t i = 0; i < itemCount; i++) {
+		objectIndices_[i] = buildItems_[i].index;
+	}
+	for (uint32_t nodeIndex = 0; nodeIndex < nodes_.size(); nodeIndex++) {
+		const Node& node = nodes_[nodeIndex];
+		for (uint32_t i = 0; i < node.count; i++) {
+			objects_[objectIndices_[node.leftOrFirst + i]].leaf = nodeIndex;
+		}
+	}
+
+	dirtyNodes_.assign(nodes_.size(), 0);
+	builtRootArea_ = HalfArea(nodes_[0].bounds);
+}
+
+void BoundingVolumeHierarchy::Refit() {
+	if (movedIndices_.empty()) {
+		return;
+	}
+	refitCount_++;
+
+	// 子は親より後ろにあるので逆順に辿れば下から更新できる
+	for (uint32_t nodeIndex = static_cast<uint32_t>(nodes_.size()); nodeIndex-- > 0;) {
+		Node& node = nodes_[nodeIndex];
+		if (node.count > 0) {
+			if (dirtyNodes_[nodeIndex]) {
+				UpdateNodeBounds(nodeIndex);
+			}
+			continue;
+		}
+		uint32_t left = node.leftOrFirst;
+		if (dirtyNodes_[left] || dirtyNodes_[left + 1]) {
+			node.bounds = Merge(nodes_[left].bounds, nodes_[left + 1].bounds);
+			dirtyNodes_[nodeIndex] = 1;
+			dirtyNodes_[left] = 0;
+			dirtyNodes_[left + 1] = 0;
+		}
+	}
+	dirtyNodes_[0] = 0;
+	ClearMoved();
+}
+
+void BoundingVolumeHierarchy::ClearMoved() {
+	for (uint32_t index : movedIndices_) {
+		objects_[index].moved = false;
+	}
+	movedIndices_.clear();
+}
+
+template<class Function>
+void BoundingVolumeHierarchy::ForEachLooseObject(const Function& function) const {
+	for (uint32_t index : pendingIndices_) {
+		function(index);
+	}
+	for (uint32_t index : movedIndices_) {
+		if (objects_[index].alive) {
+			function(index);
+		}
+	}
+}
+
+template<class Predicate>
+void BoundingVolumeHierarchy::Query(
+  const Predicate& predicate, std::vector<Handle>& results) const {
+	// 未構築分と移動分は総当たり
+	ForEachLooseObject([&](uint32_t index) {
+		if (predicate(objects_[index].bounds)) {
+			results.push_back(ToHandle(index));
+		}
+	});
+	if (nodes_.empty()) {
+		return;
+	}
+
+	uint32_t stack[kMaxStackDepth];
+	uint32_t stackSize = 0;
+	stack[stackSize++] = 0;
+	while (stackSize > 0) {
+		const Node& node = nodes_[stack[--stackSize]];
+		if (!predicate(node.bounds)) {
+			continue;
+		}
+
+		if (node.count > 0) {
+			for (uint32_t i = 0; i < node.count; i++) {
+				uint32_t index = objectIndices_[node.leftOrFirst + i];
+				if (IsInTree(objects_[index]) && predicate(objects_[index].bounds)) {
+					results.push_back(ToHandle(index));
+				}
+			}
+			continue;
+		}
+
+		assert(stackSize + 2 <= kMaxStackDepth);
+		stack[stackSize++] = node.leftOrFirst + 1;
+		stack[stackSize++] = node.leftOrFirst;
+	}
+}
+
+void BoundingVolumeHierarchy::CollectSubtree(
+  uint32_t nodeIndex, std::vector<Handle>& results) const {
+	uint32_t stack[kMaxStackDepth];
+	uint32_t stackSize = 0;
+	stack[stackSize++] = nodeIndex;
+	while (stackSize > 0) {
+		const Node& node = nodes_[stack[--stackSize]];
+		if (node.count > 0) {
+			for (uint32_t i = 0; i < node.count; i++) {
+				uint32_t index = objectIndices_[node.leftOrFirst + i];
+				if (IsInTree(objects_[index])) {
+					results.push_back(ToHandle(index));
+				}
+			}
+			continue;
+		}
+		assert(stackSize + 2 <= kMaxStackDepth);
+		stack[stackSize++] = node.leftOrFirst + 1;
+		stack[stackSize++] = node.leftOrFirst;
+	}
+}
+
+void BoundingVolumeHierarchy::QueryAABB(const AABB& bounds, std::vector<Handle>& results) const {
+	Query([&bounds](const AABB& aabb) { return Overlaps(bounds, aabb); }, results);
+}
+
+void BoundingVolumeHierarchy::QuerySphere(
+  const Sphere& sphere, std::vector<Handle>& results) const {
+	Query([&sphere](const AABB& aabb) { return Overlaps(sphere, aabb); }, results);
+}
+
+void BoundingVolumeHierarchy::QueryFrustum(
+  const Frustum& frustum, std::vector<Handle>& results) const {
+	// 未構築分と移動分
+	ForEachLooseObject([&](uint32_t index) {
+		if (IsVisible(frustum, objects_[index].bounds)) {
+			results.push_back(ToHandle(index));
+		}
+	});
+	if (nodes_.empty()) {
+		return;
+	}
+
+	// 完全に内側と分かった平面はビットを落とし、子では判定しない
+	const uint32_t kAllPlanes = (1u << Frustum::kPlaneCount) - 1;
+	struct Entry {
+		uint32_t nodeIndex;
+		uint32_t planeMask;
+	};
+	Entry stack[kMaxStackDepth];
+	uint32_t stackSize = 0;
+	stack[stackSize++] = {0, kAllPlanes};
+
+	while (stackSize > 0) {
+		Entry entry = stack[--stackSize];
+		const Node& node = nodes_[entry.nodeIndex];
+
+		Vector3 center = Multiply(0.5f, Add(node.bounds.min, node.bounds.max));
+		Vector3 extent = Multiply(0.5f, Subtract(node.bounds.max, node.bounds.min));
+		bool outside = false;
+		for (int i = 0; i < Frustum::kPlaneCount; i++) {
+			if (!(entry.planeMask & (1u << i))) {
+				continue;
+			}
+			const Vector4& plane = frustum.planes[i];
+			float distance = plane.x * center.x + plane.y * center.y + plane.z * center.z + plane.w;
+			float radius = std::fabs(plane.x) * extent.x + std::fabs(plane.y) * extent.y +
+			               std::fabs(plane.z) * extent.z;
+			if (distance + radius < 0.0f) {
+				outside = true;
+				break;
+			}
+			if (distance - radius >= 0.0f) {
+				entry.planeMask &= ~(1u << i);
+			}
+		}
+		if (outside) {
+			continue;
+		}
+
+		// 完全に内側なら部分木をまとめて追加
+		if (entry.planeMask == 0) {
+			CollectSubtree(entry.nodeIndex, results);
+			continue;
+		}
+
+		if (node.count > 0) {
+			for (uint32_t i = 0; i < node.count; i++) {
+				uint32_t index = objectIndices_[node.leftOrFirst + i];
+				if (IsInTree(objects_[index]) && IsVisible(frustum, objects_[index].bounds)) {
+					results.push_back(ToHandle(index));
+				}
+			}
+			continue;
+		}
+
+		assert(stackSize + 2 <= kMaxStackDepth);
+		stack[stackSize++] = {node.leftOrFirst + 1, entry.planeMask};
+		stack[stackSize++] = {node.leftOrFirst, entry.planeMask};
+	}
+}
+
+bool BoundingVolumeHierarchy::Raycast(
+  const Vector3& origin, const Vector3& direction, float maxDistance, RaycastHit& hit) const {
+	Vector3 normalizedDirection = Normalize(direction);
+	Vector3 inverseDirection = {
+	  SafeInverse(normalizedDirection.x), SafeInverse(normalizedDirection.y),
+	  SafeInverse(normalizedDirection.z)};
+
+	float nearest = maxDistance;
+	uint32_t nearestIndex = kInvalidIndex;
+
+	// 未構築分と移動分
+	ForEachLooseObject([&](uint32_t index) {
+		float t = IntersectRay(origin, inverseDirection, nearest, objects_[index].bounds);
+		if (t < nearest) {
+			nearest = t;
+			nearestIndex = index;
+		}
+	});
+
+	if (!nodes_.empty() &&
+	    IntersectRay(origin, inverseDirection, nearest, nodes_[0].bounds) != FLT_MAX) {
+		uint32_t stack[kMaxStackDepth];
+		uint32_t stackSize = 0;
+		stack[stackSize++] = 0;
+
+		while (stackSize > 0) {
+			const Node& node = nodes_[stack[--stackSize]];
+
+			if (node.count > 0) {
+				for (uint32_t i = 0; i < node.count; i++) {
+					uint32_t index = objectIndices_[node.leftOrFirst + i];
+					if (!IsInTree(objects_[index])) {
+						continue;
+					}
+					float t =
+					  IntersectRay(origin, inverseDirection, nearest, objects_[index].bounds);
+					if (t < nearest) {
+						nearest = t;
+						nearestIndex = index;
+					}
+				}
+				continue;
+			}
+
+			// 近い子から先に辿る
+			uint32_t first = node.leftOrFirst;
+			uint32_t second = node.leftOrFirst + 1;
+			float firstDistance =
+			  IntersectRay(origin, inverseDirection, nearest, nodes_[first].bounds);
+			float secondDistance =
+			  IntersectRay(origin, inverseDirection, nearest, nodes_[second].bounds);
+			if (secondDistance < firstDistance) {
+				std::swap(first, second);
+				std::swap(firstDistance, secondDistance);
+			}
+			assert(stackSize + 2 <= kMaxStackDepth);
+			if (secondDistance != FLT_MAX) {
+				stack[stackSize++] = second;
+			}
+			if (firstDistance != FLT_MAX) {
+				stack[stackSize++] = first;
+			}
+		}
+	}
+
+	if (nearestIndex == kInvalidIndex) {
+		return false;
+	}
+	hit.handle = ToHandle(nearestIndex);
+	hit.distance = nearest;
+	hit.userData = objects_[nearestIndex].userData;
+	return true;
+}
+
+const AABB& BoundingVolumeHierarchy::GetBounds(Handle handle) const {
+	uint32_t index = ToIndex(handle);
+	assert(index != kInvalidIndex);
+	return objects_[index].bounds;
+}
+
+uint32_t BoundingVolumeHierarchy::GetUserData(Handle handle) const {
+	uint32_t index = ToIndex(handle);
+	assert(index != kInvalidIndex);
+	return objects_[index].userData;
+}
+
+BoundingVolumeHierarchy::Statistics BoundingVolumeHierarchy::GetStatistics() const {
+	Statistics statistics;
+	statistics.objectCount = aliveCount_;
+	statistics.nodeCount = static_cast<uint32_t>(nodes_.size());
+	statistics.buildCount = buildCount_;
+	statistics.refitCount = refitCount_;
+	statistics.pendingCount = static_cast<uint32_t>(pendingIndices_.size());
+	return statistics;
+}
+
+uint32_t BoundingVolumeHierarchy::ToIndex(Handle handle) const {
+	uint32_t index = handle & kIndexMask;
+	if (handle == kInvalidHandle || index >= objects_.size()) {
+		return kInvalidIndex;
+	}
+	const Object& object = objects_[index];
+	if (!object.alive || object.generation != (handle >> kIndexBits)) {
+		return kInvalidIndex;
+	}
+	return index;
+}
+
+BoundingVolumeHierarchy::Handle BoundingVolumeHierarchy::ToHandle(uint32_t index) const {
+	return (static_cast<uint32_t>(objects_[index].generation) << kIndexBits) | index;
+}
+
+bool BoundingVolumeHierarchy::Subdivide(uint32_t nodeIndex) {
+	Node node = nodes_[nodeIndex];
+	if (node.count <= kMaxLeafObjectCount) {
+		return false;
+	}
+
+	int axis = 0;
+	float splitPosition = 0.0f;
+	float splitCost = FindBestSplit(node, axis, splitPosition);
+	// 分割しない方が安ければ葉にする
+	float leafCost = static_cast<float>(node.count) * HalfArea(node.bounds);
+	if (splitCost >= leafCost) {
+		return false;
+	}
+
+	// 重心で振り分ける
+	auto begin = buildItems_.begin() + node.leftOrFirst;
+	auto end = begin + node.count;
+	auto middle = std::partition(begin, end, [&](const BuildItem& item) {
+		return GetAxis(item.centroid, axis) < splitPosition;
+	});
+	uint32_t leftCount = static_cast<uint32_t>(middle - begin);
+	if (leftCount == 0 || leftCount == node.count) {
+		return false;
+	}
+
+	uint32_t left = static_cast<uint32_t>(nodes_.size());
+	uint32_t rightFirst = node.leftOrFirst + leftCount;
+	uint32_t rightCount = node.count - leftCount;
+	nodes_.push_back(
+	  {CalculateBuildBounds(node.leftOrFirst, leftCount), node.leftOrFirst, leftCount});
+	nodes_.push_back({CalculateBuildBounds(rightFirst, rightCount), rightFirst, rightCount});
+
+	nodes_[nodeIndex].leftOrFirst = left;
+	nodes_[nodeIndex].count = 0;
+	return true;
+}
+
+void BoundingVolumeHierarchy::UpdateNodeBounds(uint32_t nodeIndex) {
+	Node& node = nodes_[nodeIndex];
+	AABB bounds = kEmptyAABB;
+	for (uint32_t i = 0; i < node.count; i++) {
+		const Object& object = objects_[objectIndices_[node.leftOrFirst + i]];
+		// 削除済みは葉に残っていても境界に含めない
+		if (object.alive) {
+			bounds = Merge(bounds, object.bounds);
+		}
+	}
+	node.bounds = bounds;
+}
+
+AABB BoundingVolumeHierarchy::CalculateBuildBounds(uint32_t first, uint32_t count) const {
+	AABB bounds = kEmptyAABB;
+	for (uint32_t i = first; i < first + count; i++) {
+		bounds = Merge(bounds, buildItems_[i].bounds);
+	}
+	return bounds;
+}
+
+float BoundingVolumeHierarchy::FindBestSplit(
+  const Node& node, int& axis, float& splitPosition) const {
+	// 重心の範囲
+	Vector3 centroidMin = {FLT_MAX, FLT_MAX, FLT_MAX};
+	Vector3 centroidMax = {-FLT_MAX, -FLT_MAX, -FLT_MAX};
+	for (uint32_t i = 0; i < node.count; i++) {
+		const Vector3& centroid = buildItems_[node.leftOrFirst + i].centroid;
+		centroidMin = Min(centroidMin, centroid);
+		centroidMax = Max(centroidMax, centroid);
+	}
+
+	// 3軸分のビンに1回の走査で振り分ける（境界の合成はSIMDで行う）
+	__m128 binMin[3][kBinCount], binMax[3][kBinCount];
+	uint32_t binCount[3][kBinCount] = {};
+	float scale[3];
+	for (int a = 0; a < 3; a++) {
+		for (uint32_t i = 0; i < kBinCount; i++) {
+			binMin[a][i] = _mm_set1_ps(FLT_MAX);
+			binMax[a][i] = _mm_set1_ps(-FLT_MAX);
+		}
+		float extent = GetAxis(centroidMax, a) - GetAxis(centroidMin, a);
+		scale[a] = extent > 0.0f ? static_cast<float>(kBinCount) / extent : 0.0f;
+	}
+	for (uint32_t i = 0; i < node.count; i++) {
+		const BuildItem& item = buildItems_[node.leftOrFirst + i];
+		// min.xyz+max.x / max.xyz+centroid.x を読む（wは使わない）
+		__m128 itemMin = _mm_loadu_ps(&item.bounds.min.x);
+		__m128 itemMax = _mm_loadu_ps(&item.bounds.max.x);
+		for (int a = 0; a < 3; a++) {
+			float offset = GetAxis(item.centroid, a) - GetAxis(centroidMin, a);
+			uint32_t binIndex = (std::min)(kBinCount - 1, static_cast<uint32_t>(offset * scale[a]));
+			binCount[a][binIndex]++;
+			binMin[a][binIndex] = _mm_min_ps(binMin[a][binIndex], itemMin);
+			binMax[a][binIndex] = _mm_max_ps(binMax[a][binIndex], itemMax);
+		}
+	}
+
+	float bestCost = FLT_MAX;
+	for (int a = 0; a < 3; a++) {
+		if (scale[a] == 0.0f) {
+			continue;
+		}
+
+		// 左右から累積して各境界のコストを求める
+		float leftArea[kBinCount - 1], rightArea[kBinCount - 1];
+		uint32_t leftCount[kBinCount - 1], rightCount[kBinCount - 1];
+		__m128 leftMin = _mm_set1_ps(FLT_MAX), leftMax = _mm_set1_ps(-FLT_MAX);
+		__m128 rightMin = _mm_set1_ps(FLT_MAX), rightMax = _mm_set1_ps(-FLT_MAX);
+		uint32_t leftSum = 0, rightSum = 0;
+		for (uint32_t i = 0; i < kBinCount - 1; i++) {
+			leftSum += binCount[a][i];
+			leftCount[i] = leftSum;
+			leftMin = _mm_min_ps(leftMin, binMin[a][i]);
+			leftMax = _mm_max_ps(leftMax, binMax[a][i]);
+			leftArea[i] = HalfArea(leftMin, leftMax);
+
+			uint32_t right = kBinCount - 1 - i;
+			rightSum += binCount[a][right];
+			rightCount[right - 1] = rightSum;
+			rightMin = _mm_min_ps(rightMin, binMin[a][right]);
+			rightMax = _mm_max_ps(rightMax, binMax[a][right]);
+			rightArea[right - 1] = HalfArea(rightMin, rightMax);
+		}
+
+		float binWidth = 1.0f / scale[a];
+		for (uint32_t i = 0; i < kBinCount - 1; i++) {
+			if (leftCount[i] == 0 || rightCount[i] == 0) {
+				continue;
+			}
+			float cost = static_cast<float>(leftCount[i]) * leftArea[i] +
+			             static_cast<float>(rightCount[i]) * rightArea[i];
+			if (cost < bestCost) {
+				bestCost = cost;
+				axis = a;
+				splitPosition = GetAxis(centroidMin, a) + binWidth * static_cast<float>(i + 1);
+			}
+		}
+	}
+	return bestCost;
+}
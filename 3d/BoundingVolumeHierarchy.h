@@ -0,0 +1,274 @@
+#pragma once
+
+#include "Culling.h"
+#include "Matrix4x4.h"
+#include "Vector3.h"
+#include <cstdint>
+#include <vector>
+
+/// <summary>
+/// 動的BVH（シーン空間インデックス）
+/// オブジェクトをハンドルで管理し、視錐台・レイ・球・AABBの問い合わせを行う
+/// </summary>
+class BoundingVolumeHierarchy {
+public: // エイリアス
+	// オブジェクトハンドル
+	using Handle = uint32_t;
+
+public: // 定数
+	// 無効なハンドル
+	static const Handle kInvalidHandle = UINT32_MAX;
+	// 葉に入れるオブジェクトの最大数
+	static const uint32_t kMaxLeafObjectCount = 4;
+	// SAH評価のビン数
+	static const uint32_t kBinCount = 12;
+	// 再構築を行う表面積の悪化率
+	static constexpr float kRebuildThreshold = 2.0f;
+	// 未構築・削除済みがこの数を超えたら再構築する（最低値）
+	static constexpr uint32_t kMinRebuildObjectCount = 64;
+
+public: // サブクラス
+	// レイキャストの結果
+	struct RaycastHit {
+		Handle handle = kInvalidHandle; // 当たったオブジェクト
+		float distance = 0.0f;          // レイ始点からの距離
+		uint32_t userData = 0;          // 登録時のユーザーデータ
+	};
+
+	// 統計
+	struct Statistics {
+		uint32_t objectCount = 0;  // 登録オブジェクト数
+		uint32_t nodeCount = 0;    // ノード数
+		uint32_t buildCount = 0;   // 再構築回数
+		uint32_t refitCount = 0;   // 再フィット回数
+		uint32_t pendingCount = 0; // 未構築のオブジェクト数
+	};
+
+public: // メンバ関数
+	/// <summary>
+	/// オブジェクト登録
+	/// </summary>
+	/// <param name="bounds">ワールド座標系のAABB</param>
+	/// <param name="userData">ユーザーデータ</param>
+	/// <returns>ハンドル</returns>
+	Handle Insert(const AABB& bounds, uint32_t userData = 0);
+
+	/// <summary>
+	/// オブジェクト登録（ローカルAABBとワールド行列から）
+	/// </summary>
+	/// <param name="localBounds">メッシュのローカルAABB</param>
+	/// <param name="matWorld">ワールド行列（WorldTransform::matWorld_）</param>
+	/// <param name="userData">ユーザーデータ</param>
+	/// <returns>ハンドル</returns>
+	Handle Insert(const AABB& localBounds, const Matrix4x4& matWorld, uint32_t userData = 0);
+
+	/// <summary>
+	/// オブジェクト削除
+	/// </summary>
+	/// <param name="handle">ハンドル</param>
+	void Remove(Handle handle);
+
+	/// <summary>
+	/// オブジェクトの移動
+	/// </summary>
+	/// <param name="handle">ハンドル</param>
+	/// <param name="bounds">ワールド座標系のAABB</param>
+	void Move(Handle handle, const AABB& bounds);
+
+	/// <summary>
+	/// オブジェクトの移動（ローカルAABBとワールド行列から）
+	/// </summary>
+	/// <param name="handle">ハンドル</param>
+	/// <param name="localBounds">メッシュのローカルAABB</param>
+	/// <param name="matWorld">ワールド行列（WorldTransform::matWorld_）</param>
+	void Move(Handle handle, const AABB& localBounds, const Matrix4x4& matWorld);
+
+	/// <summary>
+	/// 毎フレーム処理。構造が変わっていれば再構築、移動だけなら再フィットする
+	/// </summary>
+	void Update();
+
+	/// <summary>
+	/// SAHによる全再構築
+	/// </summary>
+	void Build();
+
+	/// <summary>
+	/// 移動したオブジェクトを含むノードだけ境界を更新する
+	/// </summary>
+	void Refit();
+
+	/// <summary>
+	/// AABBと交差するオブジェクトを列挙
+	/// </summary>
+	/// <param name="bounds">AABB</param>
+	/// <param name="results">結果の出力先（追記）</param>
+	void QueryAABB(const AABB& bounds, std::vector<Handle>& results) const;
+
+	/// <summary>
+	/// 球と交差するオブジェクトを列挙
+	/// </summary>
+	/// <param name="sphere">球</param>
+	/// <param name="results">結果の出力先（追記）</param>
+	void QuerySphere(const Sphere& sphere, std::vector<Handle>& results) const;
+
+	/// <summary>
+	/// 視錐台と交差するオブジェクトを列挙
+	/// </summary>
+	/// <param name="frustum">視錐台</param>
+	/// <param name="results">結果の出力先（追記）</param>
+	void QueryFrustum(const Frustum& frustum, std::vector<Handle>& results) const;
+
+	/// <summary>
+	/// レイと最初に交差するオブジェクトを求める
+	/// </summary>
+	/// <param name="origin">始点</param>
+	/// <param name="direction">方向</param>
+	/// <param name="maxDistance">最大距離</param>
+	/// <param name="hit">結果</param>
+	/// <returns>当たったか</returns>
+	bool Raycast(
+	    const Vector3& origin, const Vector3& direction, float maxDistance, RaycastHit& hit) const;
+
+	/// <summary>
+	/// AABBを取得
+	/// </summary>
+	/// <param name="handle">ハンドル</param>
+	/// <returns>ワールド座標系のAABB</returns>
+	const AABB& GetBounds(Handle handle) const;
+
+	/// <summary>
+	/// ユーザーデータを取得
+	/// </summary>
+	/// <param name="handle">ハンドル</param>
+	/// <returns>ユーザーデータ</returns>
+	uint32_t GetUserData(Handle handle) const;
+
+	/// <summary>
+	/// 統計を取得
+	/// </summary>
+	/// <returns>統計</returns>
+	Statistics GetStatistics() const;
+
+private: // サブクラス
+	// ノード
+	struct Node {
+		AABB bounds;
+		// 葉ならobjectIndices_の開始位置、内部ノードなら左の子（右の子は+1）
+		uint32_t leftOrFirst;
+		// 葉のオブジェクト数。0なら内部ノード
+		uint32_t count;
+	};
+
+	// オブジェクト
+	struct Object {
+		AABB bounds;
+		Vector3 centroid;
+		uint32_t userData;
+		uint32_t leaf;      // 所属する葉ノード（未構築ならkInvalidIndex）
+		uint8_t generation; // 再利用検出用の世代
+		bool alive;
+		bool moved; // 移動後まだ再フィットしていない（木の境界を外れているかもしれない）
+	};
+
+	// 構築中の作業データ（連続アクセスになるよう境界と重心を複製して並べ替える）
+	// boundsの直後にcentroidを置き、max.xyzを4要素でまとめて読めるようにしている
+	struct BuildItem {
+		AABB bounds;
+		Vector3 centroid;
+		uint32_t index;
+	};
+
+private: // 定数
+	static const uint32_t kInvalidIndex = UINT32_MAX;
+	static const uint32_t kIndexBits = 24;
+	static const uint32_t kIndexMask = (1u << kIndexBits) - 1;
+	static const uint32_t kMaxStackDepth = 64;
+
+private: // メンバ関数
+	/// <summary>
+	/// ハンドルからオブジェクト番号を取得（無効ならkInvalidIndex）
+	/// </summary>
+	uint32_t ToIndex(Handle handle) const;
+
+	/// <summary>
+	/// ノードを2つに分割する
+	/// </summary>
+	/// <returns>分割したか（しなければ葉のまま）</returns>
+	bool Subdivide(uint32_t nodeIndex);
+
+	/// <summary>
+	/// ノードの境界をオブジェクトから計算する
+	/// </summary>
+	void UpdateNodeBounds(uint32_t nodeIndex);
+
+	/// <summary>
+	/// 構築中の作業データから境界を計算する
+	/// </summary>
+	AABB CalculateBuildBounds(uint32_t first, uint32_t count) const;
+
+	/// <summary>
+	/// 最適な分割を探す
+	/// </summary>
+	/// <returns>分割コスト</returns>
+	float FindBestSplit(const Node& node, int& axis, float& splitPosition) const;
+
+	/// <summary>
+	/// 境界の判定関数で木と未構築オブジェクトを問い合わせる
+	/// </summary>
+	template<class Predicate>
+	void Query(const Predicate& predicate, std::vector<Handle>& results) const;
+
+	/// <summary>
+	/// 木の境界に入っていないオブジェクト（未構築分と移動分）を列挙する
+	/// </summary>
+	template<class Function>
+	void ForEachLooseObject(const Function& function) const;
+
+	/// <summary>
+	/// 葉から辿って判定してよいオブジェクトか（移動分は総当たりで判定するので除く）
+	/// </summary>
+	static bool IsInTree(const Object& object) { return object.alive && !object.moved; }
+
+	/// <summary>
+	/// 移動分の記録を消す（再フィットか再構築で木の境界に入った後に呼ぶ）
+	/// </summary>
+	void ClearMoved();
+
+	/// <summary>
+	/// 部分木の全オブジェクトを判定なしで列挙する
+	/// </summary>
+	void CollectSubtree(uint32_t nodeIndex, std::vector<Handle>& results) const;
+
+	/// <summary>
+	/// オブジェクト番号からハンドルを作る
+	/// </summary>
+	Handle ToHandle(uint32_t index) const;
+
+private: // メンバ変数
+	// ノード（0番がルート）
+	std::vector<Node> nodes_;
+	// 葉が参照するオブジェクト番号
+	std::vector<uint32_t> objectIndices_;
+	// オブジェクト
+	std::vector<Object> objects_;
+	// 構築用の作業データ
+	std::vector<BuildItem> buildItems_;
+	// 空きオブジェクト番号
+	std::vector<uint32_t> freeIndices_;
+	// 未構築のオブジェクト番号
+	std::vector<uint32_t> pendingIndices_;
+	// 削除済みだが木に残っているオブジェクト番号（再構築まで再利用しない）
+	std::vector<uint32_t> retiredIndices_;
+	// 移動後まだ再フィットしていないオブジェクト番号
+	std::vector<uint32_t> movedIndices_;
+	// 再フィットが必要なノード
+	std::vector<uint8_t> dirtyNodes_;
+	// 生存オブジェクト数
+	uint32_t aliveCount_ = 0;
+	// 構築直後のルートの表面積
+	float builtRootArea_ = 0.0f;
+	// 統計
+	uint32_t buildCount_ = 0;
+	uint32_t refitCount_ = 0;
+};
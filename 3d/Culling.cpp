@@ -0,0 +1,236 @@
+﻿#include "Culling.h"
+#include "JobSystem.h"
+#include "MathUtility.h"
+#include <atomic>
+#include <cmath>
+#include <emmintrin.h>
+
+namespace {
+
+// 平面を正規化する
+Vector4 NormalizePlane(const Vector4& plane) {
+	float length = std::sqrt(plane.x * plane.x + plane.y * plane.y + plane.z * plane.z);
+	if (length == 0.0f) {
+		return plane;
+	}
+	float inv = 1.0f / length;
+	return {plane.x * inv, plane.y * inv, plane.z * inv, plane.w * inv};
+}
+
+// 1個分の判定（端数処理用）
+bool IsBoxVisible(
+  const Frustum& frustum, float centerX, float centerY, float centerZ, float extentX,
+  float extentY, float extentZ) {
+	for (const Vector4& plane : frustum.planes) {
+		float distance = plane.x * centerX + plane.y * centerY + plane.z * centerZ + plane.w;
+		float radius = std::fabs(plane.x) * extentX + std::fabs(plane.y) * extentY +
+		               std::fabs(plane.z) * extentZ;
+		if (distance + radius < 0.0f) {
+			return false;
+		}
+	}
+	return true;
+}
+
+} // namespace
+
+Frustum MakeFrustum(const Matrix4x4& viewProjection) {
+	const auto& m = viewProjection.m;
+	// 行ベクトル規約なので列から平面を作る（クリップ空間のzは0～1）
+	Vector4 column[4];
+	for (int i = 0; i < 4; i++) {
+		column[i] = {m[0][i], m[1][i], m[2][i], m[3][i]};
+	}
+
+	Frustum frustum{};
+	frustum.planes[Frustum::kLeft] = {
+	  column[3].x + column[0].x, column[3].y + column[0].y, column[3].z + column[0].z,
+	  column[3].w + column[0].w};
+	frustum.planes[Frustum::kRight] = {
+	  column[3].x - column[0].x, column[3].y - column[0].y, column[3].z - column[0].z,
+	  column[3].w - column[0].w};
+	frustum.planes[Frustum::kBottom] = {
+	  column[3].x + column[1].x, column[3].y + column[1].y, column[3].z + column[1].z,
+	  column[3].w + column[1].w};
+	frustum.planes[Frustum::kTop] = {
+	  column[3].x - column[1].x, column[3].y - column[1].y, column[3].z - column[1].z,
+	  column[3].w - column[1].w};
+	frustum.planes[Frustum::kNear] = column[2];
+	frustum.planes[Frustum::kFar] = {
+	  column[3].x - column[2].x, column[3].y - column[2].y, column[3].z - column[2].z,
+	  column[3].w - column[2].w};
+
+	for (Vector4& plane : frustum.planes) {
+		plane = NormalizePlane(plane);
+	}
+	return frustum;
+}
+
+AABB TransformAABB(const AABB& aabb, const Matrix4x4& matrix) {
+	// 中心と半径に分けて変換する（Arvoの方法）
+	Vector3 center = Multiply(0.5f, Add(aabb.min, aabb.max));
+	Vector3 extent = Multiply(0.5f, Subtract(aabb.max, aabb.min));
+
+	Vector3 worldCenter = Transform(center, matrix);
+	Vector3 worldExtent{};
+	worldExtent.x = std::fabs(matrix.m[0][0]) * extent.x + std::fabs(matrix.m[1][0]) * extent.y +
+	                std::fabs(matrix.m[2][0]) * extent.z;
+	worldExtent.y = std::fabs(matrix.m[0][1]) * extent.x + std::fabs(matrix.m[1][1]) * extent.y +
+	                std::fabs(matrix.m[2][1]) * extent.z;
+	worldExtent.z = std::fabs(matrix.m[0][2]) * extent.x + std::fabs(matrix.m[1][2]) * extent.y +
+	                std::fabs(matrix.m[2][2]) * extent.z;
+
+	return {Subtract(worldCenter, worldExtent), Add(worldCenter, worldExtent)};
+}
+
+Sphere TransformSphere(const Sphere& sphere, const Matrix4x4& matrix) {
+	return {Transform(sphere.center, matrix), sphere.radius * GetMaxScale(matrix)};
+}
+
+bool IsVisible(const Frustum& frustum, const Sphere& sphere) {
+	for (const Vector4& plane : frustum.planes) {
+		float distance = plane.x * sphere.center.x + plane.y * sphere.center.y +
+		                 plane.z * sphere.center.z + plane.w;
+		if (distance < -sphere.radius) {
+			return false;
+		}
+	}
+	return true;
+}
+
+bool IsVisible(const Frustum& frustum, const AABB& aabb) {
+	Vector3 center = Multiply(0.5f, Add(aabb.min, aabb.max));
+	Vector3 extent = Multiply(0.5f, Subtract(aabb.max, aabb.min));
+	return IsBoxVisible(frustum, center.x, center.y, center.z, extent.x, extent.y, extent.z);
+}
+
+void FrustumCuller::Clear() { count_ = 0; }
+
+uint32_t FrustumCuller::AddSphere(const Sphere& sphere) {
+	Reserve(count_ + 1);
+	uint32_t index = count_++;
+	centerX_[index] = sphere.center.x;
+	centerY_[index] = sphere.center.y;
+	centerZ_[index] = sphere.center.z;
+	extentX_[index] = sphere.radius;
+	extentY_[index] = sphere.radius;
+	extentZ_[index] = sphere.radius;
+	return index;
+}
+
+uint32_t FrustumCuller::AddAABB(const AABB& aabb) {
+	Reserve(count_ + 1);
+	uint32_t index = count_++;
+	centerX_[index] = (aabb.min.x + aabb.max.x) * 0.5f;
+	centerY_[index] = (aabb.min.y + aabb.max.y) * 0.5f;
+	centerZ_[index] = (aabb.min.z + aabb.max.z) * 0.5f;
+	extentX_[index] = (aabb.max.x - aabb.min.x) * 0.5f;
+	extentY_[index] = (aabb.max.y - aabb.min.y) * 0.5f;
+	extentZ_[index] = (aabb.max.z - aabb.min.z) * 0.5f;
+	return index;
+}
+
+uint32_t FrustumCuller::Cull(const Frustum& frustum) {
+	uint32_t visibleCount = 0;
+
+	if (count_ < kParallelThreshold) {
+		visibleCount = CullBoxes(
+		  frustum, centerX_.data(), centerY_.data(), centerZ_.data(), extentX_.data(),
+		  extentY_.data(), extentZ_.data(), count_, visibility_.data());
+	} else {
+		// 大量にある場合はジョブシステムで分割する
+		std::atomic<uint32_t> totalVisibleCount{0};
+		JobSystem::GetInstance()->ParallelFor(
+		  count_, kParallelThreshold / 4, [&](uint32_t begin, uint32_t end) {
+			  uint32_t count = CullBoxes(
+			    frustum, centerX_.data() + begin, centerY_.data() + begin,
+			    centerZ_.data() + begin, extentX_.data() + begin, extentY_.data() + begin,
+			    extentZ_.data() + begin, end - begin, visibility_.data() + begin);
+			  totalVisibleCount.fetch_add(count, std::memory_order_relaxed);
+		  });
+		visibleCount = totalVisibleCount.load();
+	}
+
+	culledCount_ = count_ - visibleCount;
+	return visibleCount;
+}
+
+uint32_t FrustumCuller::CullBoxes(
+  const Frustum& frustum, const float* centerX, const float* centerY, const float* centerZ,
+  const float* extentX, const float* extentY, const float* extentZ, uint32_t count,
+  uint8_t* visibility) {
+	// 平面をレーン毎に展開しておく
+	__m128 planeX[Frustum::kPlaneCount], planeY[Frustum::kPlaneCount];
+	__m128 planeZ[Frustum::kPlaneCount], planeW[Frustum::kPlaneCount];
+	__m128 absPlaneX[Frustum::kPlaneCount], absPlaneY[Frustum::kPlaneCount];
+	__m128 absPlaneZ[Frustum::kPlaneCount];
+	for (int i = 0; i < Frustum::kPlaneCount; i++) {
+		const Vector4& plane = frustum.planes[i];
+		planeX[i] = _mm_set1_ps(plane.x);
+		planeY[i] = _mm_set1_ps(plane.y);
+		planeZ[i] = _mm_set1_ps(plane.z);
+		planeW[i] = _mm_set1_ps(plane.w);
+		absPlaneX[i] = _mm_set1_ps(std::fabs(plane.x));
+		absPlaneY[i] = _mm_set1_ps(std::fabs(plane.y));
+		absPlaneZ[i] = _mm_set1_ps(std::fabs(plane.z));
+	}
+	const __m128 zero = _mm_setzero_ps();
+
+	uint32_t visibleCount = 0;
+	uint32_t index = 0;
+	// 4個ずつ判定
+	for (; index + 4 <= count; index += 4) {
+		__m128 cx = _mm_loadu_ps(centerX + index);
+		__m128 cy = _mm_loadu_ps(centerY + index);
+		__m128 cz = _mm_loadu_ps(centerZ + index);
+		__m128 ex = _mm_loadu_ps(extentX + index);
+		__m128 ey = _mm_loadu_ps(extentY + index);
+		__m128 ez = _mm_loadu_ps(extentZ + index);
+
+		// 全平面の内側にあるレーンだけビットが立つ
+		__m128 inside = _mm_castsi128_ps(_mm_set1_epi32(-1));
+		for (int i = 0; i < Frustum::kPlaneCount; i++) {
+			__m128 distance = _mm_add_ps(
+			  _mm_add_ps(_mm_mul_ps(planeX[i], cx), _mm_mul_ps(planeY[i], cy)),
+			  _mm_add_ps(_mm_mul_ps(planeZ[i], cz), planeW[i]));
+			__m128 radius = _mm_add_ps(
+			  _mm_add_ps(_mm_mul_ps(absPlaneX[i], ex), _mm_mul_ps(absPlaneY[i], ey)),
+			  _mm_mul_ps(absPlaneZ[i], ez));
+			inside = _mm_and_ps(inside, _mm_cmpge_ps(_mm_add_ps(distance, radius), zero));
+		}
+
+		int mask = _mm_movemask_ps(inside);
+		for (int lane = 0; lane < 4; lane++) {
+			uint8_t visible = static_cast<uint8_t>((mask >> lane) & 1);
+			visibility[index + lane] = visible;
+			visibleCount += visible;
+		}
+	}
+	// 端数
+	for (; index < count; index++) {
+		bool visible = IsBoxVisible(
+		  frustum, centerX[index], centerY[index], centerZ[index], extentX[index], extentY[index],
+		  extentZ[index]);
+		visibility[index] = visible ? 1 : 0;
+		visibleCount += visible ? 1 : 0;
+	}
+	return visibleCount;
+}
+
+void FrustumCuller::Reserve(uint32_t count) {
+	if (count <= centerX_.size()) {
+		return;
+	}
+	// 倍々で確保する
+	size_t capacity = centerX_.empty() ? 256 : centerX_.size() * 2;
+	while (capacity < count) {
+		capacity *= 2;
+	}
+	centerX_.resize(capacity);
+	centerY_.resize(capacity);
+	centerZ_.resize(capacity);
+	extentX_.resize(capacity);
+	extentY_.resize(capacity);
+	extentZ_.resize(capacity);
+	visibility_.resize(capacity);
+}
@@ -0,0 +1,170 @@
+#pragma once
+
+#include "Matrix4x4.h"
+#include "Vector3.h"
+#include "Vector4.h"
+#include <cstdint>
+#include <vector>
+
+/// <summary>
+/// 軸平行境界ボックス
+/// </summary>
+struct AABB {
+	Vector3 min; // 最小点
+	Vector3 max; // 最大点
+};
+
+/// <summary>
+/// 境界球
+/// </summary>
+struct Sphere {
+	Vector3 center; // 中心
+	float radius;   // 半径
+};
+
+/// <summary>
+/// 視錐台。平面は内側向きの法線で ax+by+cz+d >= 0 が内側
+/// </summary>
+struct Frustum {
+	// 平面番号
+	enum Plane {
+		kLeft,
+		kRight,
+		kBottom,
+		kTop,
+		kNear,
+		kFar,
+
+		kPlaneCount,
+	};
+
+	Vector4 planes[kPlaneCount];
+};
+
+/// <summary>
+/// ビュープロジェクション行列から視錐台平面を抽出する
+/// </summary>
+/// <param name="viewProjection">ビュー行列×射影行列</param>
+/// <returns>視錐台（ワールド座標系）</returns>
+Frustum MakeFrustum(const Matrix4x4& viewProjection);
+
+/// <summary>
+/// AABBを行列で変換した結果を包むAABBを求める
+/// </summary>
+/// <param name="aabb">ローカルAABB</param>
+/// <param name="matrix">変換行列</param>
+/// <returns>変換後のAABB</returns>
+AABB TransformAABB(const AABB& aabb, const Matrix4x4& matrix);
+
+/// <summary>
+/// 境界球を行列で変換する（半径は最大スケールで拡大）
+/// </summary>
+/// <param name="sphere">ローカル境界球</param>
+/// <param name="matrix">変換行列</param>
+/// <returns>変換後の境界球</returns>
+Sphere TransformSphere(const Sphere& sphere, const Matrix4x4& matrix);
+
+/// <summary>
+/// 境界球が視錐台と交差するか
+/// </summary>
+bool IsVisible(const Frustum& frustum, const Sphere& sphere);
+
+/// <summary>
+/// AABBが視錐台と交差するか
+/// </summary>
+bool IsVisible(const Frustum& frustum, const AABB& aabb);
+
+/// <summary>
+/// 視錐台カリング（一括判定）
+/// 境界をSoA形式で溜めておき、描画前にまとめてSIMDで判定する
+/// </summary>
+class FrustumCuller {
+public: // 定数
+	// 並列化する要素数の閾値
+	static const uint32_t kParallelThreshold = 4096;
+
+public: // メンバ関数
+	/// <summary>
+	/// 登録した境界を全て破棄
+	/// </summary>
+	void Clear();
+
+	/// <summary>
+	/// 境界球を追加
+	/// </summary>
+	/// <param name="sphere">ワールド座標系の境界球</param>
+	/// <returns>追加した番号</returns>
+	uint32_t AddSphere(const Sphere& sphere);
+
+	/// <summary>
+	/// AABBを追加（内部では中心と半径の組で保持する）
+	/// </summary>
+	/// <param name="aabb">ワールド座標系のAABB</param>
+	/// <returns>追加した番号</returns>
+	uint32_t AddAABB(const AABB& aabb);
+
+	/// <summary>
+	/// 登録済みの全境界を判定する
+	/// </summary>
+	/// <param name="frustum">視錐台</param>
+	/// <returns>可視の数</returns>
+	uint32_t Cull(const Frustum& frustum);
+
+	/// <summary>
+	/// 判定結果の取得
+	/// </summary>
+	/// <param name="index">追加した番号</param>
+	/// <returns>可視か</returns>
+	bool IsVisible(uint32_t index) const { return visibility_[index] != 0; }
+
+	/// <summary>
+	/// 登録数の取得
+	/// </summary>
+	uint32_t GetCount() const { return count_; }
+
+	/// <summary>
+	/// 直前のCullでカリングされた数
+	/// </summary>
+	uint32_t GetCulledCount() const { return culledCount_; }
+
+public: // 静的メンバ関数
+	/// <summary>
+	/// SoA配列の境界ボックス（中心と半径）を判定する
+	/// 球は extentX=extentY=extentZ=半径 として渡せば良い
+	/// </summary>
+	/// <param name="frustum">視錐台</param>
+	/// <param name="centerX">中心X</param>
+	/// <param name="centerY">中心Y</param>
+	/// <param name="centerZ">中心Z</param>
+	/// <param name="extentX">半径X</param>
+	/// <param name="extentY">半径Y</param>
+	/// <param name="extentZ">半径Z</param>
+	/// <param name="count">要素数</param>
+	/// <param name="visibility">結果の出力先（可視なら1）</param>
+	/// <returns>可視の数</returns>
+	static uint32_t CullBoxes(
+	    const Frustum& frustum, const float* centerX, const float* centerY, const float* centerZ,
+	    const float* extentX, const float* extentY, const float* extentZ, uint32_t count,
+	    uint8_t* visibility);
+
+private: // メンバ関数
+	/// <summary>
+	/// 配列を4の倍数に揃えて確保する
+	/// </summary>
+	void Reserve(uint32_t count);
+
+private: // メンバ変数
+	// 中心と半径（SoA）
+	std::vector<float> centerX_;
+	std::vector<float> centerY_;
+	std::vector<float> centerZ_;
+	std::vector<float> extentX_;
+	std::vector<float> extentY_;
+	std::vector<float> extentZ_;
+	// 判定結果
+	std::vector<uint8_t> visibility_;
+	// 登録数
+	uint32_t count_ = 0;
+	// カリングされた数
+	uint32_t culledCount_ = 0;
+};
@@ -0,0 +1,240 @@
+﻿#include "LightCluster.h"
+#include "JobSystem.h"
+#include <algorithm>
+#include <bit>
+#include <cassert>
+#include <cmath>
+#include <xmmintrin.h>
+
+namespace {
+
+// ライトを並列に処理する時の1ジョブあたりの要素数
+const uint32_t kGrainSize = 1024;
+
+// 並列化するなら各範囲をジョブに分けて、しないならそのまま処理する
+template<class Function>
+void ForEachRange(bool parallel, uint32_t count, uint32_t grainSize, const Function& function) {
+	if (parallel) {
+		JobSystem::GetInstance()->ParallelFor(count, grainSize, function);
+	} else {
+		function(0, count);
+	}
+}
+
+// 原点を通る境界面の係数を求める（勾配 slope の面に垂直で、正の側が sign の向き）
+void MakeBoundary(float slope, float sign, float& lateral, float& depth) {
+	float inv = 1.0f / std::sqrt(1.0f + slope * slope);
+	lateral = sign * inv;
+	depth = -sign * slope * inv;
+}
+
+/// <summary>
+/// 境界面の並びに対して、スライス内にあるライトの部分が重なる区画の範囲を求める
+/// ライトの部分は半径 radius、深度 [za, zb] の円柱で包んで判定する
+/// </summary>
+/// <returns>重なる区画があるか。範囲は [begin, end)</returns>
+bool Span(
+  const float* lateral, const float* depth, uint32_t boundaryCount, float center, float radius,
+  float za, float zb, uint32_t& begin, uint32_t& end) {
+	const __m128 signMask = _mm_set1_ps(-0.0f);
+	const __m128 zero = _mm_setzero_ps();
+	const __m128 centerV = _mm_set1_ps(center);
+	const __m128 radiusV = _mm_set1_ps(radius);
+	const __m128 zaV = _mm_set1_ps(za);
+	const __m128 zbV = _mm_set1_ps(zb);
+	uint32_t positiveMask = 0;
+	uint32_t negativeMask = 0;
+	for (uint32_t i = 0; i < boundaryCount; i += 4) {
+		__m128 a = _mm_load_ps(lateral + i);
+		__m128 c = _mm_load_ps(depth + i);
+		// 面からの距離の、円柱上での最小値と最大値
+		__m128 mid = _mm_mul_ps(a, centerV);
+		__m128 extent = _mm_mul_ps(_mm_andnot_ps(signMask, a), radiusV);
+		__m128 depthA = _mm_mul_ps(c, zaV);
+		__m128 depthB = _mm_mul_ps(c, zbV);
+		__m128 minimum = _mm_add_ps(_mm_sub_ps(mid, extent), _mm_min_ps(depthA, depthB));
+		__m128 maximum = _mm_add_ps(_mm_add_ps(mid, extent), _mm_max_ps(depthA, depthB));
+		positiveMask |= static_cast<uint32_t>(_mm_movemask_ps(_mm_cmpgt_ps(minimum, zero))) << i;
+		negativeMask |= static_cast<uint32_t>(_mm_movemask_ps(_mm_cmplt_ps(maximum, zero))) << i;
+	}
+	const uint32_t validMask = (1u << boundaryCount) - 1;
+	positiveMask &= validMask;
+	negativeMask &= validMask;
+
+	// k番目の境界より完全に正の側なら区画k以降、完全に負の側なら区画k-1以前にしか重ならない
+	begin = positiveMask ? 31 - std::countl_zero(positiveMask) : 0;
+	end = negativeMask ? std::countr_zero(negativeMask) : boundaryCount - 1;
+	return begin < end;
+}
+
+} // namespace
+
+float LightCluster::GetDepthScale(const Grid& grid) {
+	return static_cast<float>(kSliceCount) / std::log(grid.farZ / grid.nearZ);
+}
+
+float LightCluster::GetDepthBias(const Grid& grid) {
+	return -std::log(grid.nearZ) * GetDepthScale(grid);
+}
+
+uint32_t LightCluster::GetSlice(const Grid& grid, float viewZ) {
+	float z = (std::max)(viewZ, grid.nearZ);
+	float slice = std::floor(std::log(z) * GetDepthScale(grid) + GetDepthBias(grid));
+	return static_cast<uint32_t>(std::clamp(slice, 0.0f, static_cast<float>(kSliceCount - 1)));
+}
+
+void LightCluster::Build(const Grid& grid, const Sphere* lights, uint32_t lightCount) {
+	assert(lights || lightCount == 0);
+	assert(0.0f < grid.nearZ && grid.nearZ < grid.farZ);
+	const bool parallel = lightCount >= kParallelThreshold;
+
+	// タイルの境界面（画面の端も含む）。余りの要素は判定に使わない
+	std::fill(std::begin(columnLateral_), std::end(columnLateral_), 0.0f);
+	std::fill(std::begin(columnDepth_), std::end(columnDepth_), 0.0f);
+	std::fill(std::begin(rowLateral_), std::end(rowLateral_), 0.0f);
+	std::fill(std::begin(rowDepth_), std::end(rowDepth_), 0.0f);
+	for (uint32_t k = 0; k <= kTileCountX; k++) {
+		float ndc = -1.0f + 2.0f * k / kTileCountX;
+		MakeBoundary(ndc / grid.projectionX, 1.0f, columnLateral_[k], columnDepth_[k]);
+	}
+	for (uint32_t k = 0; k <= kTileCountY; k++) {
+		// 縦は画面の上から数えるので、下向きを正にする
+		float ndc = 1.0f - 2.0f * k / kTileCountY;
+		MakeBoundary(ndc / grid.projectionY, -1.0f, rowLateral_[k], rowDepth_[k]);
+	}
+	// スライスの境界の深度
+	for (uint32_t s = 0; s <= kSliceCount; s++) {
+		sliceDepths_[s] =
+		  grid.nearZ * std::pow(grid.farZ / grid.nearZ, static_cast<float>(s) / kSliceCount);
+	}
+
+	// 境界球をビュー空間に移し、重なるスライスの範囲を求める
+	centerX_.resize(lightCount);
+	centerY_.resize(lightCount);
+	centerZ_.resize(lightCount);
+	radius_.resize(lightCount);
+	sliceBegin_.resize(lightCount);
+	sliceEnd_.resize(lightCount);
+	ForEachRange(parallel, lightCount, kGrainSize, [&](uint32_t begin, uint32_t end) {
+		const __m128 row0 = _mm_loadu_ps(grid.view.m[0]);
+		const __m128 row1 = _mm_loadu_ps(grid.view.m[1]);
+		const __m128 row2 = _mm_loadu_ps(grid.view.m[2]);
+		const __m128 row3 = _mm_loadu_ps(grid.view.m[3]);
+		for (uint32_t i = begin; i < end; i++) {
+			const Sphere& light = lights[i];
+			__m128 center = _mm_add_ps(
+			  _mm_add_ps(
+			    _mm_mul_ps(_mm_set1_ps(light.center.x), row0),
+			    _mm_mul_ps(_mm_set1_ps(light.center.y), row1)),
+			  _mm_add_ps(_mm_mul_ps(_mm_set1_ps(light.center.z), row2), row3));
+			float result[4];
+			_mm_storeu_ps(result, center);
+			centerX_[i] = result[0];
+			centerY_[i] = result[1];
+			centerZ_[i] = result[2];
+			radius_[i] = light.radius;
+
+			float zMin = result[2] - light.radius;
+			float zMax = result[2] + light.radius;
+			if (zMax < grid.nearZ || grid.farZ < zMin) {
+				sliceBegin_[i] = 0;
+				sliceEnd_[i] = 0;
+			} else {
+				sliceBegin_[i] = static_cast<uint8_t>(GetSlice(grid, zMin));
+				sliceEnd_[i] = static_cast<uint8_t>(GetSlice(grid, zMax) + 1);
+			}
+		}
+	});
+
+	// スライス毎にライト一覧を作る
+	ForEachRange(parallel, kSliceCount, 1, [this](uint32_t begin, uint32_t end) {
+		for (uint32_t s = begin; s < end; s++) {
+			BuildSlice(s);
+		}
+	});
+
+	// スライス毎の一覧を1つに並べる
+	const uint32_t tileCount = kTileCountX * kTileCountY;
+	uint32_t sliceOffsets[kSliceCount + 1] = {};
+	for (uint32_t s = 0; s < kSliceCount; s++) {
+		sliceOffsets[s + 1] = sliceOffsets[s] + work_[s].offsets[tileCount];
+	}
+	ranges_.resize(kClusterCount);
+	lightIndices_.resize(sliceOffsets[kSliceCount]);
+	ForEachRange(parallel, kSliceCount, 1, [&](uint32_t begin, uint32_t end) {
+		for (uint32_t s = begin; s < end; s++) {
+			const SliceWork& work = work_[s];
+			for (uint32_t tile = 0; tile < tileCount; tile++) {
+				uint32_t offset = work.offsets[tile];
+				ranges_[s * tileCount + tile] = {
+				  sliceOffsets[s] + offset, work.offsets[tile + 1] - offset};
+			}
+			std::copy(
+			  work.lightIndices.begin(), work.lightIndices.end(),
+			  lightIndices_.begin() + sliceOffsets[s]);
+		}
+	});
+}
+
+void LightCluster::BuildSlice(uint32_t slice) {
+	SliceWork& work = work_[slice];
+	work.footprints.clear();
+	work.offsets.fill(0);
+	const float sliceNear = sliceDepths_[slice];
+	const float sliceFar = sliceDepths_[slice + 1];
+
+	// スライスに重なるライト毎に、重なるタイルの範囲を求めて数える
+	const uint32_t lightCount = static_cast<uint32_t>(centerZ_.size());
+	for (uint32_t i = 0; i < lightCount; i++) {
+		if (slice < sliceBegin_[i] || sliceEnd_[i] <= slice) {
+			continue;
+		}
+		// スライス内にある部分は、中心に最も近い断面の円を深度方向に伸ばした円柱に収まる
+		float z = centerZ_[i];
+		float radius = radius_[i];
+		float dz = z - std::clamp(z, sliceNear, sliceFar);
+		float radiusSq = radius * radius - dz * dz;
+		if (radiusSq < 0.0f) {
+			continue;
+		}
+		float sectionRadius = std::sqrt(radiusSq);
+		float za = (std::max)(sliceNear, z - radius);
+		float zb = (std::min)(sliceFar, z + radius);
+
+		uint32_t x0, x1, y0, y1;
+		if (!Span(
+		      columnLateral_, columnDepth_, kTileCountX + 1, centerX_[i], sectionRadius, za, zb,
+		      x0, x1)) {
+			continue;
+		}
+		if (!Span(
+		      rowLateral_, rowDepth_, kTileCountY + 1, centerY_[i], sectionRadius, za, zb, y0,
+		      y1)) {
+			continue;
+		}
+		work.footprints.push_back(
+		  {i, static_cast<uint8_t>(x0), static_cast<uint8_t>(x1), static_cast<uint8_t>(y0),
+		   static_cast<uint8_t>(y1)});
+		for (uint32_t y = y0; y < y1; y++) {
+			for (uint32_t x = x0; x < x1; x++) {
+				work.offsets[y * kTileCountX + x + 1]++;
+			}
+		}
+	}
+
+	// タイル毎の開始位置にしてから、ライト番号を詰める
+	const uint32_t tileCount = kTileCountX * kTileCountY;
+	for (uint32_t tile = 0; tile < tileCount; tile++) {
+		work.offsets[tile + 1] += work.offsets[tile];
+	}
+	work.lightIndices.resize(work.offsets[tileCount]);
+	std::array<uint32_t, kTileCountX * kTileCountY> cursors;
+	std::copy(work.offsets.begin(), work.offsets.begin() + tileCount, cursors.begin());
+	for (const Footprint& footprint : work.footprints) {
+		for (uint32_t y = footprint.y0; y < footprint.y1; y++) {
+			for (uint32_t x = footprint.x0; x < footprint.x1; x++) {
+				work.lightIndices[cursors[y * kTileCountX + x]++] = footprint.light;
+			}
+		}
+	}
+}
@@ -0,0 +1,118 @@
+#pragma once
+
+#include "Culling.h"
+#include "Matrix4x4.h"
+#include <array>
+#include <cstdint>
+#include <vector>
+
+/// <summary>
+/// クラスタードライティング用のライト割り当て
+/// 視錐台を画面のタイル×指数分割した深度スライスの小区画（クラスタ）に分け、
+/// ライトの影響範囲（境界球）が重なるクラスタ毎にライト番号の一覧を作る
+/// </summary>
+class LightCluster {
+public: // 定数
+	// 横方向のタイル数
+	static const uint32_t kTileCountX = 16;
+	// 縦方向のタイル数
+	static const uint32_t kTileCountY = 9;
+	// 深度方向のスライス数
+	static const uint32_t kSliceCount = 24;
+	// クラスタ数
+	static const uint32_t kClusterCount = kTileCountX * kTileCountY * kSliceCount;
+	// 並列化するライト数の閾値
+	static const uint32_t kParallelThreshold = 256;
+
+public: // サブクラス
+	// 分割の設定（ViewProjectionの値を渡す）
+	struct Grid {
+		Matrix4x4 view;        // ビュー行列
+		float projectionX = 1; // 射影行列の m[0][0]
+		float projectionY = 1; // 射影行列の m[1][1]
+		float nearZ = 0.1f;    // 深度限界（手前側）
+		float farZ = 1000.0f;  // 深度限界（奥側）
+	};
+
+	// クラスタ毎のライト番号の範囲
+	struct Range {
+		uint32_t offset; // ライト番号一覧内の開始位置
+		uint32_t count;  // ライト数
+	};
+
+public: // 静的メンバ関数
+	/// <summary>
+	/// クラスタ番号の取得。タイルは画面左上から数える
+	/// </summary>
+	static uint32_t GetClusterIndex(uint32_t tileX, uint32_t tileY, uint32_t slice) {
+		return (slice * kTileCountY + tileY) * kTileCountX + tileX;
+	}
+
+	/// <summary>
+	/// ビュー空間の深度からスライス番号を求める係数
+	/// slice = log(viewZ) * scale + bias（シェーダーと同じ式）
+	/// </summary>
+	static float GetDepthScale(const Grid& grid);
+	static float GetDepthBias(const Grid& grid);
+
+	/// <summary>
+	/// ビュー空間の深度が入るスライス番号
+	/// </summary>
+	static uint32_t GetSlice(const Grid& grid, float viewZ);
+
+public: // メンバ関数
+	/// <summary>
+	/// ライトをクラスタに割り当てる
+	/// ライト数がkParallelThreshold以上ならジョブシステムで並列に処理する
+	/// </summary>
+	/// <param name="grid">分割の設定</param>
+	/// <param name="lights">ライトの境界球（ワールド座標系）</param>
+	/// <param name="lightCount">ライト数</param>
+	void Build(const Grid& grid, const Sphere* lights, uint32_t lightCount);
+
+	/// <summary>
+	/// クラスタ毎の範囲（kClusterCount個）
+	/// </summary>
+	const std::vector<Range>& GetRanges() const { return ranges_; }
+
+	/// <summary>
+	/// 全クラスタのライト番号一覧。クラスタ内は番号順
+	/// </summary>
+	const std::vector<uint32_t>& GetLightIndices() const { return lightIndices_; }
+
+private: // サブクラス
+	// スライス内で重なるタイルの範囲 [x0, x1) x [y0, y1)
+	struct Footprint {
+		uint32_t light;
+		uint8_t x0, x1, y0, y1;
+	};
+
+	// スライス毎の作業領域（フレームをまたいで使い回す）
+	struct SliceWork {
+		std::vector<Footprint> footprints;
+		std::vector<uint32_t> lightIndices;
+		std::array<uint32_t, kTileCountX * kTileCountY + 1> offsets;
+	};
+
+private: // メンバ関数
+	// スライス内のライト一覧を作る
+	void BuildSlice(uint32_t slice);
+
+private: // メンバ変数
+	// ビュー空間の境界球（成分毎の配列）
+	std::vector<float> centerX_, centerY_, centerZ_, radius_;
+	// ライトが重なるスライスの範囲 [begin, end)
+	std::vector<uint8_t> sliceBegin_, sliceEnd_;
+	// スライスの境界の深度
+	std::array<float, kSliceCount + 1> sliceDepths_;
+	// タイルの境界面（ビュー空間、原点を通る）の係数。4個単位で余りは判定に使わない
+	// 横: nx * x + nz * z、縦: ny * y + nz * z が正ならその境界より右・下側
+	alignas(16) float columnLateral_[20], columnDepth_[20];
+	alignas(16) float rowLateral_[12], rowDepth_[12];
+	// スライス毎の作業領域
+	std::array<SliceWork, kSliceCount> work_;
+	// クラスタ毎の範囲
+	std::vector<Range> ranges_;
+	// ライト番号一覧
+	std::vector<uint32_t> lightIndices_;
+};
@@ -1,9 +1,115 @@
 ﻿#include "LightGroup.h"
 #include "DirectXCommon.h"
+#include "MathUtility.h"
+#include <algorithm>
 #include <assert.h>
+#include <bit>
+#include <cstring>
+#include <limits>
 
 using namespace DirectX;
 
+// 変更フラグは64ライト単位で持つ
+static_assert(LightGroup::kPointLightNum % 64 == 0 && LightGroup::kSpotLightNum % 64 == 0);
+
+namespace {
+
+// アップロード用のバッファを生成してマップする
+template<class T>
+void CreateMappedBuffer(
+  size_t size, Microsoft::WRL::ComPtr<ID3D12Resource>& buffer, T** map) {
+	// ヒーププロパティ
+	CD3DX12_HEAP_PROPERTIES heapProps = CD3DX12_HEAP_PROPERTIES(D3D12_HEAP_TYPE_UPLOAD);
+	// リソース設定
+	CD3DX12_RESOURCE_DESC resourceDesc = CD3DX12_RESOURCE_DESC::Buffer(size);
+
+	HRESULT result;
+	result = DirectXCommon::GetInstance()->GetDevice()->CreateCommittedResource(
+	  &heapProps, D3D12_HEAP_FLAG_NONE, &resourceDesc, D3D12_RESOURCE_STATE_GENERIC_READ, nullptr,
+	  IID_PPV_ARGS(&buffer));
+	assert(SUCCEEDED(result));
+
+	result = buffer->Map(0, nullptr, (void**)map);
+	assert(SUCCEEDED(result));
+}
+
+// 距離減衰後の明るさが閾値を下回る距離（下回らなければ無限大）
+float AttenuationRange(const Vector3& atten, const Vector3& color) {
+	float brightness = (std::max)({color.x, color.y, color.z});
+	// atten.x + atten.y * d + atten.z * d^2 = brightness / cutoff を解く
+	float limit = brightness / LightGroup::kAttenuationCutoff - atten.x;
+	if (limit <= 0.0f) {
+		return 0.0f;
+	}
+	if (atten.z > 0.0f) {
+		return (-atten.y + std::sqrt(atten.y * atten.y + 4.0f * atten.z * limit)) /
+		       (2.0f * atten.z);
+	}
+	if (atten.y > 0.0f) {
+		return limit / atten.y;
+	}
+	return std::numeric_limits<float>::infinity();
+}
+
+// スポットライトの円錐を包む球
+Sphere SpotLightBounds(
+  const Vector3& position, const Vector3& direction, float range, float cosOuter) {
+	if (cosOuter <= 0.0f || std::isinf(range)) {
+		return {position, range};
+	}
+	Vector3 axis = Normalize(direction);
+	if (cosOuter < std::sqrt(0.5f)) {
+		// 広い円錐は底面の円を包む球で足りる
+		float sinOuter = std::sqrt(1.0f - cosOuter * cosOuter);
+		return {Add(position, Multiply(range * cosOuter, axis)), range * sinOuter};
+	}
+	// 狭い円錐は頂点と底面の円を通る球
+	float radius = range / (2.0f * cosOuter);
+	return {Add(position, Multiply(radius, axis)), radius};
+}
+
+// 変更フラグを立てる
+template<size_t N> void MarkDirty(std::array<uint64_t, N>& bits, int index) {
+	bits[index / 64] |= uint64_t(1) << (index % 64);
+}
+
+// 変更フラグの立っている連続した範囲毎に function(begin, end) を呼び、フラグを下ろす
+template<size_t N, class Function>
+void ForEachDirtyRange(std::array<uint64_t, N>& bits, const Function& function) {
+	const uint32_t kNone = UINT32_MAX;
+	uint32_t runBegin = kNone;
+	for (uint32_t w = 0; w < N; w++) {
+		uint64_t word = bits[w];
+		bits[w] = 0;
+		uint32_t bit = 0;
+		while (bit < 64) {
+			if (runBegin == kNone) {
+				// 次に立っているフラグを探す
+				uint64_t rest = word >> bit;
+				if (rest == 0) {
+					break;
+				}
+				bit += std::countr_zero(rest);
+				runBegin = w * 64 + bit;
+			} else {
+				// 次に下りているフラグを探す（なければ範囲は次の語に続く）
+				uint64_t rest = ~word >> bit;
+				if (rest == 0) {
+					break;
+				}
+				bit += std::countr_zero(rest);
+				function(runBegin, w * 64 + bit);
+				runBegin = kNone;
+			}
+		}
+	}
+	if (runBegin != kNone) {
+		function(runBegin, static_cast<uint32_t>(N * 64));
+	}
+}
+
+} // namespace
+
 LightGroup* LightGroup::Create() {
 	// 3Dオブジェクトのインスタンスを生成
 	LightGroup* instance = new LightGroup();
@@ -22,7 +128,7 @@ void LightGroup::Initialize() {
 	CD3DX12_HEAP_PROPERTIES heapProps = CD3DX12_HEAP_PROPERTIES(D3D12_HEAP_TYPE_UPLOAD);
 	// リソース設定
 	CD3DX12_RESOURCE_DESC resourceDesc =
-	  CD3DX12_RESOURCE_DESC::Buffer((sizeof(ConstBufferData) + 0xff) & ~0xff);
+	  CD3DX12_RESOURCE_DESC::Buffer(kConstBufferStride * kViewSlotCount);
 
 	HRESULT result;
 	// 定数バッファの生成
@@ -36,87 +142,279 @@ void LightGroup::Initialize() {
 	result = constBuff_->Map(0, nullptr, (void**)&constMap_);
 	assert(SUCCEEDED(result));
 
+	// 点光源・スポットライト・クラスタの構造化バッファ
+	CreateMappedBuffer(
+	  sizeof(PointLight::ConstBufferData) * kPointLightNum, pointLightBuff_, &pointLightMap_);
+	CreateMappedBuffer(
+	  sizeof(SpotLight::ConstBufferData) * kSpotLightNum, spotLightBuff_, &spotLightMap_);
+	CreateMappedBuffer(
+	  sizeof(uint32_t) * kClusterBufferStride * kViewSlotCount, clusterBuff_, &clusterMap_);
+	// 照らさない枠のクラスタは全て空にしておく（定数はTransferConstBufferで送る）
+	std::fill_n(
+	  clusterMap_ + kClusterBufferStride * kUnlitView, LightCluster::kClusterCount * 2, 0u);
+
+	// 転送用の内容は全て無効なライトで埋めておき、最初のUpdateで全て転送する
+	pointLightData_.assign(kPointLightNum, PointLight::ConstBufferData{});
+	spotLightData_.assign(kSpotLightNum, SpotLight::ConstBufferData{});
+	pointLightBounds_.assign(kPointLightNum, Sphere{});
+	spotLightBounds_.assign(kSpotLightNum, Sphere{});
+	pointLightDirty_.fill(~uint64_t(0));
+	spotLightDirty_.fill(~uint64_t(0));
+	constData_.spotLightIndexBase = kPointLightNum;
+	dirty_ = true;
+
 	// 定数バッファへデータ転送
-	TransferConstBuffer();
+	Update();
 }
 
 void LightGroup::Update() {
+	uploadStatistics_ = {};
+
 	// 値の更新があった時だけ定数バッファに転送する
 	if (dirty_) {
 		TransferConstBuffer();
 		dirty_ = false;
 	}
+	// 点光源・スポットライトは変更のあったものだけを転送する
+	TransferLights();
+}
+
+uint32_t LightGroup::PrepareView(const ViewProjection& viewProjection) {
+	LightCluster::Grid grid;
+	grid.view = viewProjection.matView;
+	grid.projectionX = viewProjection.matProjection.m[0][0];
+	grid.projectionY = viewProjection.matProjection.m[1][1];
+	grid.nearZ = viewProjection.nearZ;
+	grid.farZ = viewProjection.farZ;
+
+	// フレームが変われば全ての枠を使える（前のフレームのGPUの処理は終わっている）
+	uint64_t frame = DirectXCommon::GetInstance()->GetFrameCount();
+	if (frame != viewFrame_) {
+		viewFrame_ = frame;
+		viewCount_ = 0;
+	}
+	// ライトが変わっていれば全ての枠を割り当て直す
+	if (clusterDirty_) {
+		for (View& view : views_) {
+			view.valid = false;
+		}
+		clusterDirty_ = false;
+	}
+
+	// このフレームで用意済みのカメラなら同じ枠を使う
+	auto isSameView = [&grid](const View& view) {
+		return view.valid && std::memcmp(&grid, &view.grid, sizeof(grid)) == 0;
+	};
+	for (uint32_t i = 0; i < viewCount_; i++) {
+		if (isSameView(views_[i])) {
+			return i;
+		}
+	}
+
+	// 枠が足りなければ、先に積んだ描画の枠は書き換えずに照らさない枠を返す
+	if (viewCount_ == kMaxViewCount) {
+		uploadStatistics_.unlitViewCount++;
+		if (!viewOverflowReported_) {
+			OutputDebugStringA(
+			  "LightGroup: kMaxViewCount を超えたカメラは点光源・スポットライト無しで描画します\n");
+			viewOverflowReported_ = true;
+		}
+		return kUnlitView;
+	}
+
+	// 次の枠を使う
+	uint32_t index = viewCount_++;
+	// 前のフレームで同じ枠に同じカメラを割り当てていればそのまま使う
+	if (isSameView(views_[index])) {
+		return index;
+	}
+	views_[index].grid = grid;
+	views_[index].valid = true;
+	BuildClusters(index);
+	UploadConstants(index);
+	return index;
+}
+
+void LightGroup::BuildClusters(uint32_t view) {
+	cluster_.Build(
+	  views_[view].grid, lightBounds_.data(), static_cast<uint32_t>(lightBounds_.size()));
+
+	// クラスタ毎の範囲の後ろにライト番号一覧を並べる。入りきらない分は切り捨てる
+	// 書き込み先は書き込み結合メモリなので、先頭から順に1回ずつ書く
+	const std::vector<LightCluster::Range>& ranges = cluster_.GetRanges();
+	const std::vector<uint32_t>& lightIndices = cluster_.GetLightIndices();
+	assert(lightIndices.size() <= kMaxClusterLightIndexCount);
+	uint32_t* clusterMap = clusterMap_ + kClusterBufferStride * view;
+	const uint32_t indexBase = LightCluster::kClusterCount * 2;
+	for (uint32_t i = 0; i < LightCluster::kClusterCount; i++) {
+		uint32_t offset = (std::min)(ranges[i].offset, kMaxClusterLightIndexCount);
+		clusterMap[i * 2] = indexBase + offset;
+		clusterMap[i * 2 + 1] = (std::min)(ranges[i].count, kMaxClusterLightIndexCount - offset);
+	}
+	uint32_t indexCount = static_cast<uint32_t>(
+	  (std::min)(lightIndices.size(), size_t(kMaxClusterLightIndexCount)));
+	uint32_t* indexMap = clusterMap + indexBase;
+	for (uint32_t i = 0; i < indexCount; i++) {
+		indexMap[i] = lightSlots_[lightIndices[i]];
+	}
+	uint32_t bytes = (indexBase + indexCount) * static_cast<uint32_t>(sizeof(uint32_t));
+	uploadStatistics_.clusterBytes += bytes;
+	uploadStatistics_.totalBytes += bytes;
+}
+
+void LightGroup::Draw(
+  ID3D12GraphicsCommandList* cmdList, UINT rootParameterIndexPointLights,
+  UINT rootParameterIndexSpotLights) {
+	// 点光源・スポットライトの構造化バッファをセット
+	cmdList->SetGraphicsRootShaderResourceView(
+	  rootParameterIndexPointLights, pointLightBuff_->GetGPUVirtualAddress());
+	cmdList->SetGraphicsRootShaderResourceView(
+	  rootParameterIndexSpotLights, spotLightBuff_->GetGPUVirtualAddress());
 }
 
-void LightGroup::Draw(ID3D12GraphicsCommandList* cmdList, UINT rootParameterIndex) {
-	// 定数バッファビューをセット
+void LightGroup::SetView(
+  ID3D12GraphicsCommandList* cmdList, UINT rootParameterIndex, UINT rootParameterIndexClusters,
+  uint32_t view) {
+	assert(view < kViewSlotCount);
+	// 定数バッファビューとクラスタの構造化バッファを、枠の位置でセット
 	cmdList->SetGraphicsRootConstantBufferView(
-	  rootParameterIndex, constBuff_->GetGPUVirtualAddress());
+	  rootParameterIndex, constBuff_->GetGPUVirtualAddress() + kConstBufferStride * view);
+	cmdList->SetGraphicsRootShaderResourceView(
+	  rootParameterIndexClusters,
+	  clusterBuff_->GetGPUVirtualAddress() + sizeof(uint32_t) * kClusterBufferStride * view);
 }
 
 void LightGroup::TransferConstBuffer() {
 	// 環境光
-	constMap_->ambientColor = ambientColor_;
+	constData_.ambientColor = ambientColor_;
 	// 平行光源
 	for (int i = 0; i < kDirLightNum; i++) {
 		// ライトが有効なら設定を転送
 		if (dirLights_[i].IsActive()) {
-			constMap_->dirLights[i].active = 1;
-			constMap_->dirLights[i].lightv = -dirLights_[i].GetLightDir();
-			constMap_->dirLights[i].lightcolor = dirLights_[i].GetLightColor();
+			constData_.dirLights[i].active = 1;
+			constData_.dirLights[i].lightv = -dirLights_[i].GetLightDir();
+			constData_.dirLights[i].lightcolor = dirLights_[i].GetLightColor();
 		}
 		// ライトが無効ならライト色を0に
 		else {
-			constMap_->dirLights[i].active = 0;
-		}
-	}
-	// 点光源
-	for (int i = 0; i < kPointLightNum; i++) {
-		// ライトが有効なら設定を転送
-		if (pointLights_[i].IsActive()) {
-			constMap_->pointLights[i].active = 1;
-			constMap_->pointLights[i].lightpos = pointLights_[i].GetLightPos();
-			constMap_->pointLights[i].lightcolor = pointLights_[i].GetLightColor();
-			constMap_->pointLights[i].lightatten = pointLights_[i].GetLightAtten();
-		}
-		// ライトが無効ならライト色を0に
-		else {
-			constMap_->pointLights[i].active = 0;
-		}
-	}
-	// スポットライト
-	for (int i = 0; i < kSpotLightNum; i++) {
-		// ライトが有効なら設定を転送
-		if (spotLights_[i].IsActive()) {
-			constMap_->spotLights[i].active = 1;
-			constMap_->spotLights[i].lightv = -spotLights_[i].GetLightDir();
-			constMap_->spotLights[i].lightpos = spotLights_[i].GetLightPos();
-			constMap_->spotLights[i].lightcolor = spotLights_[i].GetLightColor();
-			constMap_->spotLights[i].lightatten = spotLights_[i].GetLightAtten();
-			constMap_->spotLights[i].lightfactoranglecos = spotLights_[i].GetLightFactorAngleCos();
-		}
-		// ライトが無効ならライト色を0に
-		else {
-			constMap_->spotLights[i].active = 0;
+			constData_.dirLights[i].active = 0;
 		}
 	}
 	// 丸影
 	for (int i = 0; i < kCircleShadowNum; i++) {
 		// 有効なら設定を転送
 		if (circleShadows_[i].IsActive()) {
-			constMap_->circleShadows[i].active = 1;
-			constMap_->circleShadows[i].dir = -circleShadows_[i].GetDir();
-			constMap_->circleShadows[i].casterPos = circleShadows_[i].GetCasterPos();
-			constMap_->circleShadows[i].distanceCasterLight =
+			constData_.circleShadows[i].active = 1;
+			constData_.circleShadows[i].dir = -circleShadows_[i].GetDir();
+			constData_.circleShadows[i].casterPos = circleShadows_[i].GetCasterPos();
+			constData_.circleShadows[i].distanceCasterLight =
 			  circleShadows_[i].GetDistanceCasterLight();
-			constMap_->circleShadows[i].atten = circleShadows_[i].GetAtten();
-			constMap_->circleShadows[i].factorAngleCos = circleShadows_[i].GetFactorAngleCos();
+			constData_.circleShadows[i].atten = circleShadows_[i].GetAtten();
+			constData_.circleShadows[i].factorAngleCos = circleShadows_[i].GetFactorAngleCos();
 		}
 		// 無効なら色を0に
 		else {
-			constMap_->circleShadows[i].active = 0;
+			constData_.circleShadows[i].active = 0;
+		}
+	}
+	// 割り当て済みの全てのカメラの枠と、照らさない枠に送る
+	for (uint32_t view = 0; view < kMaxViewCount; view++) {
+		if (views_[view].valid) {
+			UploadConstants(view);
+		}
+	}
+	UploadConstants(kUnlitView);
+}
+
+void LightGroup::UploadConstants(uint32_t view) {
+	// シェーダーでクラスタを引くための定数
+	constData_.clusterTileCountX = LightCluster::kTileCountX;
+	constData_.clusterTileCountY = LightCluster::kTileCountY;
+	constData_.clusterSliceCount = LightCluster::kSliceCount;
+	// カメラ毎の係数（照らさない枠のクラスタは全て空なので、どのクラスタを引いてもよい）
+	if (view < kMaxViewCount) {
+		const LightCluster::Grid& grid = views_[view].grid;
+		DirectXCommon* dxCommon = DirectXCommon::GetInstance();
+		constData_.clusterTileScale = {
+		  static_cast<float>(LightCluster::kTileCountX) / dxCommon->GetBackBufferWidth(),
+		  static_cast<float>(LightCluster::kTileCountY) / dxCommon->GetBackBufferHeight()};
+		constData_.clusterDepthScale = LightCluster::GetDepthScale(grid);
+		constData_.clusterDepthBias = LightCluster::GetDepthBias(grid);
+	}
+
+	// 書き込み結合メモリには1回の連続した書き込みで送る
+	std::memcpy(constMap_ + kConstBufferStride * view, &constData_, sizeof(ConstBufferData));
+	uploadStatistics_.constantBytes += sizeof(ConstBufferData);
+	uploadStatistics_.totalBytes += sizeof(ConstBufferData);
+}
+
+void LightGroup::TransferLights() {
+	bool changed = false;
+
+	// 点光源
+	ForEachDirtyRange(pointLightDirty_, [&](uint32_t begin, uint32_t end) {
+		for (uint32_t i = begin; i < end; i++) {
+			const PointLight& light = pointLights_[i];
+			PointLight::ConstBufferData& data = pointLightData_[i];
+			data.active = light.IsActive() ? 1 : 0;
+			data.lightpos = light.GetLightPos();
+			data.lightcolor = light.GetLightColor();
+			data.lightatten = light.GetLightAtten();
+			pointLightBounds_[i] = {
+			  light.GetLightPos(), AttenuationRange(light.GetLightAtten(), light.GetLightColor())};
 		}
+		uint32_t bytes = (end - begin) * static_cast<uint32_t>(sizeof(PointLight::ConstBufferData));
+		std::memcpy(pointLightMap_ + begin, pointLightData_.data() + begin, bytes);
+		uploadStatistics_.lightBytes += bytes;
+		uploadStatistics_.totalBytes += bytes;
+		uploadStatistics_.lightRangeCount++;
+		changed = true;
+	});
+
+	// スポットライト
+	ForEachDirtyRange(spotLightDirty_, [&](uint32_t begin, uint32_t end) {
+		for (uint32_t i = begin; i < end; i++) {
+			const SpotLight& light = spotLights_[i];
+			SpotLight::ConstBufferData& data = spotLightData_[i];
+			data.active = light.IsActive() ? 1 : 0;
+			data.lightv = -light.GetLightDir();
+			data.lightpos = light.GetLightPos();
+			data.lightcolor = light.GetLightColor();
+			data.lightatten = light.GetLightAtten();
+			data.lightfactoranglecos = light.GetLightFactorAngleCos();
+			spotLightBounds_[i] = SpotLightBounds(
+			  light.GetLightPos(), light.GetLightDir(),
+			  AttenuationRange(light.GetLightAtten(), light.GetLightColor()),
+			  light.GetLightFactorAngleCos().y);
+		}
+		uint32_t bytes = (end - begin) * static_cast<uint32_t>(sizeof(SpotLight::ConstBufferData));
+		std::memcpy(spotLightMap_ + begin, spotLightData_.data() + begin, bytes);
+		uploadStatistics_.lightBytes += bytes;
+		uploadStatistics_.totalBytes += bytes;
+		uploadStatistics_.lightRangeCount++;
+		changed = true;
+	});
+
+	if (!changed) {
+		return;
 	}
+
+	// 有効なライトの一覧を作り直し、クラスタを割り当て直す
+	lightBounds_.clear();
+	lightSlots_.clear();
+	for (int i = 0; i < kPointLightNum; i++) {
+		if (pointLightData_[i].active) {
+			lightBounds_.push_back(pointLightBounds_[i]);
+			lightSlots_.push_back(static_cast<uint32_t>(i));
+		}
+	}
+	for (int i = 0; i < kSpotLightNum; i++) {
+		if (spotLightData_[i].active) {
+			lightBounds_.push_back(spotLightBounds_[i]);
+			lightSlots_.push_back(constData_.spotLightIndexBase + static_cast<uint32_t>(i));
+		}
+	}
+	clusterDirty_ = true;
 }
 
 void LightGroup::DefaultLightSetting() {
@@ -142,6 +440,7 @@ void LightGroup::SetDirLightActive(int index, bool active) {
 	assert(0 <= index && index < kDirLightNum);
 
 	dirLights_[index].SetActive(active);
+	dirty_ = true;
 }
 
 void LightGroup::SetDirLightDir(int index, const XMVECTOR& lightdir) {
@@ -151,6 +450,12 @@ void LightGroup::SetDirLightDir(int index, const XMVECTOR& lightdir) {
 	dirty_ = true;
 }
 
+const Vector3& LightGroup::GetDirLightDir(int index) const {
+	assert(0 <= index && index < kDirLightNum);
+
+	return dirLights_[index].GetLightDir();
+}
+
 void LightGroup::SetDirLightColor(int index, const XMFLOAT3& lightcolor) {
 	assert(0 <= index && index < kDirLightNum);
 
@@ -162,74 +467,77 @@ void LightGroup::SetPointLightActive(int index, bool active) {
 	assert(0 <= index && index < kPointLightNum);
 
 	pointLights_[index].SetActive(active);
+	MarkDirty(pointLightDirty_, index);
 }
 
 void LightGroup::SetPointLightPos(int index, const XMFLOAT3& lightpos) {
 	assert(0 <= index && index < kPointLightNum);
 
 	pointLights_[index].SetLightPos(lightpos);
-	dirty_ = true;
+	MarkDirty(pointLightDirty_, index);
 }
 
 void LightGroup::SetPointLightColor(int index, const XMFLOAT3& lightcolor) {
 	assert(0 <= index && index < kPointLightNum);
 
 	pointLights_[index].SetLightColor(lightcolor);
-	dirty_ = true;
+	MarkDirty(pointLightDirty_, index);
 }
 
 void LightGroup::SetPointLightAtten(int index, const XMFLOAT3& lightAtten) {
 	assert(0 <= index && index < kPointLightNum);
 
 	pointLights_[index].SetLightAtten(lightAtten);
-	dirty_ = true;
+	MarkDirty(pointLightDirty_, index);
 }
 
 void LightGroup::SetSpotLightActive(int index, bool active) {
 	assert(0 <= index && index < kSpotLightNum);
 
 	spotLights_[index].SetActive(active);
+	MarkDirty(spotLightDirty_, index);
 }
 
 void LightGroup::SetSpotLightDir(int index, const XMVECTOR& lightdir) {
 	assert(0 <= index && index < kSpotLightNum);
 
 	spotLights_[index].SetLightDir(lightdir);
-	dirty_ = true;
+	MarkDirty(spotLightDirty_, index);
 }
 
 void LightGroup::SetSpotLightPos(int index, const XMFLOAT3& lightpos) {
 	assert(0 <= index && index < kSpotLightNum);
 
 	spotLights_[index].SetLightPos(lightpos);
-	dirty_ = true;
+	MarkDirty(spotLightDirty_, index);
 }
 
 void LightGroup::SetSpotLightColor(int index, const XMFLOAT3& lightcolor) {
 	assert(0 <= index && index < kSpotLightNum);
 
 	spotLights_[index].SetLightColor(lightcolor);
-	dirty_ = true;
+	MarkDirty(spotLightDirty_, index);
 }
 
 void LightGroup::SetSpotLightAtten(int index, const XMFLOAT3& lightAtten) {
 	assert(0 <= index && index < kSpotLightNum);
 
 	spotLights_[index].SetLightAtten(lightAtten);
-	dirty_ = true;
+	MarkDirty(spotLightDirty_, index);
 }
 
 void LightGroup::SetSpotLightFactorAngle(int index, const XMFLOAT2& lightFactorAngle) {
 	assert(0 <= index && index < kSpotLightNum);
 
 	spotLights_[index].SetLightFactorAngle(lightFactorAngle);
-	dirty_ = true;
+	MarkDirty(spotLightDirty_, index);
 }
 
 void LightGroup::SetCircleShadowActive(int index, bool active) {
 	assert(0 <= index && index < kCircleShadowNum);
 
 	circleShadows_[index].SetActive(active);
+	dirty_ = true;
 }
 
 void LightGroup::SetCircleShadowCasterPos(int index, const XMFLOAT3& casterPos) {
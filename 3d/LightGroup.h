@@ -9,11 +9,18 @@
 
 #include "CircleShadow.h"
 #include "DirectionalLight.h"
+#include "LightCluster.h"
 #include "PointLight.h"
 #include "SpotLight.h"
+#include "ViewProjection.h"
+#include <array>
+#include <cstdint>
+#include <vector>
 
 /// <summary>
 /// ライト
+/// 点光源とスポットライトは構造化バッファに置き、画面を分割したクラスタ毎に
+/// 影響するライトの一覧を作ってピクセルシェーダーで参照する（クラスタードライティング）
 /// </summary>
 class LightGroup {
 private: // エイリアス
@@ -24,11 +31,19 @@ public: // 定数
 	// 平行光源の数
 	static const int kDirLightNum = 3;
 	// 点光源の数
-	static const int kPointLightNum = 3;
+	static const int kPointLightNum = 1024;
 	// スポットライトの数
-	static const int kSpotLightNum = 3;
+	static const int kSpotLightNum = 1024;
 	// 丸影の数
 	static const int kCircleShadowNum = 1;
+	// クラスタのライト番号一覧に入る最大数
+	static const uint32_t kMaxClusterLightIndexCount = 1 << 18;
+	// 1フレームで使えるカメラの数（カメラ毎に定数バッファとクラスタの枠を持つ）
+	static const uint32_t kMaxViewCount = 4;
+	// カメラの枠が足りない時に使う枠（点光源・スポットライトを照らさない）
+	static const uint32_t kUnlitView = kMaxViewCount;
+	// 影響範囲の閾値。距離減衰後の明るさがこれを下回る距離より先は照らさない
+	static constexpr float kAttenuationCutoff = 1.0f / 256.0f;
 
 public: // サブクラス
 	// 定数バッファ用データ構造体
@@ -38,12 +53,27 @@ public: // サブクラス
 		float pad1;
 		// 平行光源用
 		DirectionalLight::ConstBufferData dirLights[kDirLightNum];
-		// 点光源用
-		PointLight::ConstBufferData pointLights[kPointLightNum];
-		// スポットライト用
-		SpotLight::ConstBufferData spotLights[kSpotLightNum];
 		// 丸影用
 		CircleShadow::ConstBufferData circleShadows[kCircleShadowNum];
+		// クラスタの参照用
+		Vector2 clusterTileScale; // スクリーン座標 → タイル番号
+		float clusterDepthScale;  // log(ビュー空間の深度) → スライス番号の係数
+		float clusterDepthBias;   // log(ビュー空間の深度) → スライス番号の定数項
+		uint32_t clusterTileCountX;
+		uint32_t clusterTileCountY;
+		uint32_t clusterSliceCount;
+		// スポットライトのライト番号の開始位置（点光源の枠の数）
+		uint32_t spotLightIndexBase;
+	};
+
+	// 転送量の統計（Updateで0に戻し、次のUpdateまでの分を数える）
+	struct UploadStatistics {
+		uint32_t totalBytes = 0;      // 合計
+		uint32_t constantBytes = 0;   // 定数バッファ
+		uint32_t lightBytes = 0;      // 点光源・スポットライト
+		uint32_t lightRangeCount = 0; // ライトを転送した連続範囲の数
+		uint32_t clusterBytes = 0;    // クラスタのライト一覧
+		uint32_t unlitViewCount = 0;  // 枠が足りずにkUnlitViewを返した回数
 	};
 
 public: // 静的メンバ関数
@@ -60,20 +90,50 @@ public: // メンバ関数
 	void Initialize();
 
 	/// <summary>
-	/// 更新
+	/// 更新。変更のあった値だけを連続する範囲毎にまとめて転送する。フレーム毎に1回呼ぶ
 	/// </summary>
 	void Update();
 
 	/// <summary>
-	/// 描画
+	/// カメラ用の定数バッファとクラスタの枠を用意して、その番号を返す
+	/// 同じフレームで用意済みのカメラなら書き込まずに同じ枠を返すので、描画毎に呼んでよい
+	/// 枠はフレーム内で上書きしないので、先に積んだ描画の参照先は変わらない
+	/// </summary>
+	/// <param name="viewProjection">ビュープロジェクション</param>
+	/// <returns>枠の番号（SetViewに渡す。枠が足りなければkUnlitView）</returns>
+	uint32_t PrepareView(const ViewProjection& viewProjection);
+
+	/// <summary>
+	/// 描画（点光源とスポットライトのバッファの位置は変わらないので描画パス毎に1回セットすればよい）
+	/// </summary>
+	/// <param name="cmdList">コマンドリスト</param>
+	/// <param name="rootParameterIndexPointLights">点光源のルートパラメータ番号</param>
+	/// <param name="rootParameterIndexSpotLights">スポットライトのルートパラメータ番号</param>
+	void Draw(
+	    ID3D12GraphicsCommandList* cmdList, UINT rootParameterIndexPointLights,
+	    UINT rootParameterIndexSpotLights);
+
+	/// <summary>
+	/// カメラの枠の定数バッファとクラスタをセット（枠が変わった時だけ呼べばよい）
 	/// </summary>
-	void Draw(ID3D12GraphicsCommandList* cmdList, UINT rootParameterIndex);
+	/// <param name="cmdList">コマンドリスト</param>
+	/// <param name="rootParameterIndex">定数バッファのルートパラメータ番号</param>
+	/// <param name="rootParameterIndexClusters">クラスタのルートパラメータ番号</param>
+	/// <param name="view">PrepareViewで得た枠の番号</param>
+	void SetView(
+	    ID3D12GraphicsCommandList* cmdList, UINT rootParameterIndex,
+	    UINT rootParameterIndexClusters, uint32_t view);
 
 	/// <summary>
 	/// 定数バッファ転送
 	/// </summary>
 	void TransferConstBuffer();
 
+	/// <summary>
+	/// 転送量の統計を取得
+	/// </summary>
+	const UploadStatistics& GetUploadStatistics() const { return uploadStatistics_; }
+
 	/// <summary>
 	/// 標準のライト設定
 	/// </summary>
@@ -99,6 +159,13 @@ public: // メンバ関数
 	/// <param name="lightdir">ライト方向</param>
 	void SetDirLightDir(int index, const Vector3& lightdir);
 
+	/// <summary>
+	/// 平行光源のライト方向を取得
+	/// </summary>
+	/// <param name="index">ライト番号</param>
+	/// <returns>ライト方向</returns>
+	const Vector3& GetDirLightDir(int index) const;
+
 	/// <summary>
 	/// 平行光源のライト色をセット
 	/// </summary>
@@ -218,11 +285,38 @@ public: // メンバ関数
 	/// <param name="lightFactorAngle">x:減衰開始角度 y:減衰終了角度</param>
 	void SetCircleShadowFactorAngle(int index, const Vector2& lightFactorAngle);
 
+private: // サブクラス
+	// カメラ毎の枠
+	struct View {
+		LightCluster::Grid grid; // 割り当てに使ったカメラ
+		bool valid = false;      // 今のライトで割り当て済みか
+	};
+
+private: // 定数
+	// 定数バッファの枠の間隔（バイト）
+	static const uint32_t kConstBufferStride =
+	    static_cast<uint32_t>((sizeof(ConstBufferData) + 0xff) & ~0xff);
+	// クラスタの枠の間隔（要素数）。範囲の後ろにライト番号一覧を並べる
+	static const uint32_t kClusterBufferStride =
+	    LightCluster::kClusterCount * 2 + kMaxClusterLightIndexCount;
+	// 枠の数（カメラの枠の後ろにkUnlitViewを置く）
+	static const uint32_t kViewSlotCount = kMaxViewCount + 1;
+
 private: // メンバ変数
-	// 定数バッファ
+	// 定数バッファ（カメラの枠の数だけ並べる）
 	ComPtr<ID3D12Resource> constBuff_;
 	// 定数バッファのマップ
-	ConstBufferData* constMap_ = nullptr;
+	uint8_t* constMap_ = nullptr;
+	// 点光源の構造化バッファ（ライト番号の位置に置く）
+	ComPtr<ID3D12Resource> pointLightBuff_;
+	PointLight::ConstBufferData* pointLightMap_ = nullptr;
+	// スポットライトの構造化バッファ（ライト番号の位置に置く）
+	ComPtr<ID3D12Resource> spotLightBuff_;
+	SpotLight::ConstBufferData* spotLightMap_ = nullptr;
+	// クラスタ毎の範囲（開始位置, ライト数）とライト番号一覧を並べた構造化バッファ
+	// （カメラの枠の数だけ並べる）
+	ComPtr<ID3D12Resource> clusterBuff_;
+	uint32_t* clusterMap_ = nullptr;
 
 	// 環境光の色
 	Vector3 ambientColor_ = {1, 1, 1};
@@ -239,6 +333,56 @@ private: // メンバ変数
 	// 丸影の配列
 	CircleShadow circleShadows_[kCircleShadowNum];
 
-	// ダーティフラグ
+	// ダーティフラグ（定数バッファ）
 	bool dirty_ = false;
+
+	// 定数バッファの内容（まとめて転送する）
+	ConstBufferData constData_ = {};
+	// 点光源・スポットライトの転送用の内容（ライト番号順に詰めた配列）
+	std::vector<PointLight::ConstBufferData> pointLightData_;
+	std::vector<SpotLight::ConstBufferData> spotLightData_;
+	// ライト番号毎の影響範囲
+	std::vector<Sphere> pointLightBounds_;
+	std::vector<Sphere> spotLightBounds_;
+	// ライト番号毎の変更フラグ（1ビット1ライト）
+	std::array<uint64_t, kPointLightNum / 64> pointLightDirty_ = {};
+	std::array<uint64_t, kSpotLightNum / 64> spotLightDirty_ = {};
+
+	// 有効なライトの影響範囲と、そのシェーダー側のライト番号
+	// （スポットライトは spotLightIndexBase を足した番号）
+	std::vector<Sphere> lightBounds_;
+	std::vector<uint32_t> lightSlots_;
+	// ライトの割り当て
+	LightCluster cluster_;
+	// カメラ毎の枠
+	std::array<View, kMaxViewCount> views_;
+	// 今のフレームで使った枠の数
+	uint32_t viewCount_ = 0;
+	// viewCount_を数えているフレーム
+	uint64_t viewFrame_ = 0;
+	// 割り当てをやり直す必要があるか
+	bool clusterDirty_ = true;
+	// 枠が足りないことを知らせたか
+	bool viewOverflowReported_ = false;
+
+	// 転送量の統計
+	UploadStatistics uploadStatistics_;
+
+private: // メンバ関数
+	/// <summary>
+	/// 変更のあった点光源・スポットライトを転送し、有効なライトの一覧を作り直す
+	/// </summary>
+	void TransferLights();
+
+	/// <summary>
+	/// 枠のカメラでライトを割り当て、クラスタの枠に転送する
+	/// </summary>
+	/// <param name="view">枠の番号</param>
+	void BuildClusters(uint32_t view);
+
+	/// <summary>
+	/// 定数バッファの内容を、枠のカメラのクラスタの定数と合わせてまとめて転送する
+	/// </summary>
+	/// <param name="view">枠の番号</param>
+	void UploadConstants(uint32_t view);
 };
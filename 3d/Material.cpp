@@ -1,5 +1,6 @@
 ﻿#include "DirectXCommon.h"
 #include "Material.h"
+#include "MaterialBuffer.h"
 #include "TextureManager.h"
 #include <DirectXTex.h>
 #include <cassert>
@@ -15,29 +16,14 @@ Material* Material::Create() {
 	return instance;
 }
 
-void Material::Initialize() {
-	// 定数バッファの生成
-	CreateConstantBuffer();
+Material::~Material() {
+	// マテリアル番号の参照を解放
+	MaterialBuffer::GetInstance()->Release(materialId_);
 }
 
-void Material::CreateConstantBuffer() {
-	HRESULT result;
-
-	// ヒーププロパティ
-	CD3DX12_HEAP_PROPERTIES heapProps = CD3DX12_HEAP_PROPERTIES(D3D12_HEAP_TYPE_UPLOAD);
-	// リソース設定
-	CD3DX12_RESOURCE_DESC resourceDesc =
-	  CD3DX12_RESOURCE_DESC::Buffer((sizeof(ConstBufferData) + 0xff) & ~0xff);
-
-	// 定数バッファの生成
-	result = DirectXCommon::GetInstance()->GetDevice()->CreateCommittedResource(
-	  &heapProps, D3D12_HEAP_FLAG_NONE, &resourceDesc, D3D12_RESOURCE_STATE_GENERIC_READ, nullptr,
-	  IID_PPV_ARGS(&constBuff_));
-	assert(SUCCEEDED(result));
-
-	// 定数バッファとのデータリンク
-	result = constBuff_->Map(0, nullptr, (void**)&constMap_);
-	assert(SUCCEEDED(result));
+void Material::Initialize() {
+	// 初期値で番号を取っておく
+	Update();
 }
 
 void Material::LoadTexture(const std::string& directoryPath) {
@@ -57,14 +43,25 @@ void Material::LoadTexture(const std::string& directoryPath) {
 
 	// テクスチャ読み込み
 	textureHandle_ = TextureManager::Load(filepath);
+
+	// 法線マップは色ではないのでSRGB変換せずに読み込む
+	if (HasNormalMap()) {
+		normalMapHandle_ = TextureManager::LoadLinear(directoryPath + normalMapFilename_);
+	}
 }
 
 void Material::Update() {
-	// 定数バッファへデータ転送
-	constMap_->ambient = ambient_;
-	constMap_->diffuse = diffuse_;
-	constMap_->specular = specular_;
-	constMap_->alpha = alpha_;
+	// パディングも含めて値で比べるので0で初期化しておく
+	ConstBufferData data = {};
+	data.ambient = ambient_;
+	data.diffuse = diffuse_;
+	data.specular = specular_;
+	data.alpha = alpha_;
+	data.uvScale = uvScale_;
+	data.uvOffset = uvOffset_;
+
+	// 同じ値のマテリアルと番号を共有する。転送はMaterialBuffer::Flushでまとめて行う
+	materialId_ = MaterialBuffer::GetInstance()->Replace(materialId_, data);
 }
 
 void Material::SetGraphicsCommand(
@@ -75,9 +72,9 @@ void Material::SetGraphicsCommand(
 	TextureManager::GetInstance()->SetGraphicsRootDescriptorTable(
 	  commandList, rooParameterIndexTexture, textureHandle_);
 
-	// マテリアルの定数バッファをセット
-	commandList->SetGraphicsRootConstantBufferView(
-	  rooParameterIndexMaterial, constBuff_->GetGPUVirtualAddress());
+	// マテリアル番号をセット
+	assert(materialId_ != MaterialBuffer::kInvalidId);
+	commandList->SetGraphicsRoot32BitConstant(rooParameterIndexMaterial, materialId_, 0);
 }
 
 void Material::SetGraphicsCommand(
@@ -88,7 +85,7 @@ void Material::SetGraphicsCommand(
 	TextureManager::GetInstance()->SetGraphicsRootDescriptorTable(
 	  commandList, rooParameterIndexTexture, textureHandle);
 
-	// マテリアルの定数バッファをセット
-	commandList->SetGraphicsRootConstantBufferView(
-	  rooParameterIndexMaterial, constBuff_->GetGPUVirtualAddress());
+	// マテリアル番号をセット
+	assert(materialId_ != MaterialBuffer::kInvalidId);
+	commandList->SetGraphicsRoot32BitConstant(rooParameterIndexMaterial, materialId_, 0);
 }
\ No newline at end of file
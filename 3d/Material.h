@@ -1,17 +1,17 @@
 #pragma once
 
+#include "Vector2.h"
 #include "Vector3.h"
 #include <d3d12.h>
 #include <d3dx12.h>
 #include <string>
-#include <wrl.h>
 
 /// <summary>
 /// マテリアル
 /// </summary>
 class Material {
 public: // サブクラス
-	// 定数バッファ用データ構造体
+	// 定数データ構造体（MaterialBufferの構造化バッファの1要素）
 	struct ConstBufferData {
 		Vector3 ambient;  // アンビエント係数
 		float pad1;       // パディング
@@ -21,6 +21,7 @@ public: // サブクラス
 		float alpha;      // アルファ
 		Vector3 uvScale;  // UVスケール
 		Vector3 uvOffset; // UVオフセット
+		Vector2 pad3;     // パディング（要素を16バイト境界に揃える）
 	};
 
 public: // 静的メンバ関数
@@ -31,29 +32,36 @@ public: // 静的メンバ関数
 	static Material* Create();
 
 public:
-	std::string name_;             // マテリアル名
-	Vector3 ambient_;              // アンビエント影響度
-	Vector3 diffuse_;              // ディフューズ影響度
-	Vector3 specular_;             // スペキュラー影響度
-	Vector3 uvScale_ = {1, 1, 1};  // UVスケール
-	Vector3 uvOffset_ = {0, 0, 0}; // UVオフセット
-	float alpha_;                  // アルファ
-	std::string textureFilename_;  // テクスチャファイル名
+	std::string name_;                     // マテリアル名
+	Vector3 ambient_ = {0.3f, 0.3f, 0.3f}; // アンビエント影響度
+	Vector3 diffuse_ = {0, 0, 0};          // ディフューズ影響度
+	Vector3 specular_ = {0, 0, 0};         // スペキュラー影響度
+	Vector3 uvScale_ = {1, 1, 1};          // UVスケール
+	Vector3 uvOffset_ = {0, 0, 0};         // UVオフセット
+	float alpha_ = 1.0f;                   // アルファ
+	std::string textureFilename_;          // テクスチャファイル名
+	std::string normalMapFilename_;        // 法線マップのファイル名（map_Bump/norm）
 
 public:
 	/// <summary>
-	/// 定数バッファの取得
+	/// デストラクタ
 	/// </summary>
-	/// <returns></returns>
-	ID3D12Resource* GetConstantBuffer() const { return constBuff_.Get(); }
+	~Material();
 
+	/// <summary>
+	/// マテリアル番号の取得（MaterialBuffer内の位置。同じ値のマテリアルは同じ番号）
+	/// </summary>
+	/// <returns>マテリアル番号</returns>
+	uint32_t GetMaterialId() const { return materialId_; }
+
+	/// <summary>
 	/// テクスチャ読み込み
 	/// </summary>
 	/// <param name="directoryPath">読み込みディレクトリパス</param>
 	void LoadTexture(const std::string& directoryPath);
 
 	/// <summary>
-	/// 更新
+	/// 更新（値をMaterialBufferに登録し直す）
 	/// </summary>
 	void Update();
 
@@ -61,7 +69,7 @@ public:
 	/// グラフィックスコマンドのセット
 	/// </summary>
 	/// <param name="commandList">コマンドリスト</param>
-	/// <param name="rooParameterIndexMaterial">マテリアルのルートパラメータ番号</param>
+	/// <param name="rooParameterIndexMaterial">マテリアル番号のルートパラメータ番号</param>
 	/// <param name="rooParameterIndexTexture">テクスチャのルートパラメータ番号</param>
 	void SetGraphicsCommand(
 	    ID3D12GraphicsCommandList* commandList, UINT rooParameterIndexMaterial,
@@ -71,7 +79,7 @@ public:
 	/// グラフィックスコマンドのセット（テクスチャ差し替え版）
 	/// </summary>
 	/// <param name="commandList">コマンドリスト</param>
-	/// <param name="rooParameterIndexMaterial">マテリアルのルートパラメータ番号</param>
+	/// <param name="rooParameterIndexMaterial">マテリアル番号のルートパラメータ番号</param>
 	/// <param name="rooParameterIndexTexture">テクスチャのルートパラメータ番号</param>
 	/// <param name="textureHandle">差し替えるテクスチャハンドル</param>
 	void SetGraphicsCommand(
@@ -81,30 +89,26 @@ public:
 	// テクスチャハンドル
 	uint32_t GetTextureHadle() const { return textureHandle_; }
 
+	// 法線マップを持つか
+	bool HasNormalMap() const { return !normalMapFilename_.empty(); }
+
+	// 法線マップのテクスチャハンドル
+	uint32_t GetNormalMapHandle() const { return normalMapHandle_; }
+
 private:
-	// 定数バッファ
-	Microsoft::WRL::ComPtr<ID3D12Resource> constBuff_;
-	// 定数バッファのマップ
-	ConstBufferData* constMap_ = nullptr;
+	// マテリアル番号（Updateするまでは未登録）
+	uint32_t materialId_ = UINT32_MAX;
 	// テクスチャハンドル
 	uint32_t textureHandle_ = 0;
+	// 法線マップのテクスチャハンドル
+	uint32_t normalMapHandle_ = 0;
 
 private:
 	// コンストラクタ
-	Material() {
-		ambient_ = {0.3f, 0.3f, 0.3f};
-		diffuse_ = {0.0f, 0.0f, 0.0f};
-		specular_ = {0.0f, 0.0f, 0.0f};
-		alpha_ = 1.0f;
-	}
+	Material() = default;
 
 	/// <summary>
 	/// 初期化
 	/// </summary>
 	void Initialize();
-
-	/// <summary>
-	/// 定数バッファの生成
-	/// </summary>
-	void CreateConstantBuffer();
 };
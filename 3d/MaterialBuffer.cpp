@@ -0,0 +1,65 @@
+﻿#include "MaterialBuffer.h"
+#include <algorithm>
+#include <cassert>
+#include <d3dx12.h>
+
+// シェーダー側のMaterialDataと同じ並びで、要素は16バイト境界に揃える
+static_assert(sizeof(Material::ConstBufferData) % 16 == 0);
+
+MaterialBuffer* MaterialBuffer::GetInstance() {
+	static MaterialBuffer instance;
+	return &instance;
+}
+
+void MaterialBuffer::Initialize(ID3D12Device* device) {
+	assert(device);
+	HRESULT result;
+
+	// ヒーププロパティ
+	CD3DX12_HEAP_PROPERTIES heapProps = CD3DX12_HEAP_PROPERTIES(D3D12_HEAP_TYPE_UPLOAD);
+	// リソース設定
+	CD3DX12_RESOURCE_DESC resourceDesc =
+	  CD3DX12_RESOURCE_DESC::Buffer(sizeof(Material::ConstBufferData) * kMaxMaterialCount);
+
+	// 構造化バッファの生成
+	result = device->CreateCommittedResource(
+	  &heapProps, D3D12_HEAP_FLAG_NONE, &resourceDesc, D3D12_RESOURCE_STATE_GENERIC_READ, nullptr,
+	  IID_PPV_ARGS(&buffer_));
+	assert(SUCCEEDED(result));
+
+	// 構造化バッファとのデータリンク
+	result = buffer_->Map(0, nullptr, (void**)&bufferMap_);
+	assert(SUCCEEDED(result));
+
+	table_.Clear();
+}
+
+uint32_t MaterialBuffer::Acquire(const Material::ConstBufferData& data) {
+	uint32_t id = table_.Acquire(data);
+	ReportOverflow();
+	return id;
+}
+
+void MaterialBuffer::Release(uint32_t id) { table_.Release(id); }
+
+uint32_t MaterialBuffer::Replace(uint32_t id, const Material::ConstBufferData& data) {
+	uint32_t newId = table_.Replace(id, data);
+	ReportOverflow();
+	return newId;
+}
+
+void MaterialBuffer::ReportOverflow() {
+	// 満杯で代用した最初の1回だけ知らせる（色は変わるがバッファの外には書かない）
+	if (table_.TakeFirstOverflow()) {
+		OutputDebugStringA("MaterialBuffer: kMaxMaterialCount を超えたので番号0で代用します\n");
+	}
+}
+
+void MaterialBuffer::Flush() {
+	uint32_t begin, end;
+	if (table_.TakeDirtyRange(begin, end) == 0) {
+		return;
+	}
+	const std::vector<Material::ConstBufferData>& entries = table_.GetEntries();
+	std::copy(entries.begin() + begin, entries.begin() + end, bufferMap_ + begin);
+}
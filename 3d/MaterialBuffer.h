@@ -0,0 +1,101 @@
+#pragma once
+
+#include "Material.h"
+#include "MaterialTable.h"
+#include <cstdint>
+#include <d3d12.h>
+#include <wrl.h>
+
+/// <summary>
+/// 全マテリアルの定数を1つの構造化バッファにまとめて管理する
+/// 同じ値のマテリアルは同じ番号を共有し、番号は0から詰めて振るので描画のソートキーにそのまま使える
+/// </summary>
+class MaterialBuffer {
+public: // 定数
+	// 登録できるマテリアルの最大数
+	static const uint32_t kMaxMaterialCount = 1024;
+
+public: // サブクラス
+	// 値と番号の表（重複の排除と番号の再利用はここで行う）
+	using Table = MaterialTable<Material::ConstBufferData, kMaxMaterialCount>;
+	// 統計
+	using Statistics = Table::Statistics;
+
+public: // 定数
+	// 無効なマテリアル番号
+	static const uint32_t kInvalidId = Table::kInvalidId;
+	// 満杯の時に代わりに返す番号（満杯なら全ての番号が使用中なので必ず有効）
+	static const uint32_t kFallbackId = Table::kFallbackId;
+
+public: // 静的メンバ関数
+	/// <summary>
+	/// シングルトンインスタンスの取得
+	/// </summary>
+	/// <returns>シングルトンインスタンス</returns>
+	static MaterialBuffer* GetInstance();
+
+public: // メンバ関数
+	/// <summary>
+	/// 初期化
+	/// </summary>
+	/// <param name="device">デバイス</param>
+	void Initialize(ID3D12Device* device);
+
+	/// <summary>
+	/// 値を登録して番号を得る。同じ値が登録済みならその番号を共有する
+	/// kMaxMaterialCount種類を超えたらkFallbackIdを共有する（Releaseは通常通り呼ぶ）
+	/// </summary>
+	/// <param name="data">マテリアルの定数</param>
+	/// <returns>マテリアル番号</returns>
+	uint32_t Acquire(const Material::ConstBufferData& data);
+
+	/// <summary>
+	/// 番号の参照を解放する。参照がなくなった番号は再利用される
+	/// </summary>
+	/// <param name="id">マテリアル番号</param>
+	void Release(uint32_t id);
+
+	/// <summary>
+	/// 値を差し替える（古い番号を他と共有していなければ先に解放する）
+	/// </summary>
+	/// <param name="id">現在のマテリアル番号（未登録ならkInvalidId）</param>
+	/// <param name="data">新しい値</param>
+	/// <returns>新しいマテリアル番号</returns>
+	uint32_t Replace(uint32_t id, const Material::ConstBufferData& data);
+
+	/// <summary>
+	/// 前回から変わった範囲だけをGPUのバッファに転送する。描画前に呼ぶ
+	/// </summary>
+	void Flush();
+
+	/// <summary>
+	/// 構造化バッファのGPUアドレスを取得（ルートSRVに設定する）
+	/// </summary>
+	D3D12_GPU_VIRTUAL_ADDRESS GetGPUVirtualAddress() const {
+		return buffer_->GetGPUVirtualAddress();
+	}
+
+	/// <summary>
+	/// 統計を取得
+	/// </summary>
+	const Statistics& GetStatistics() const { return table_.GetStatistics(); }
+
+private:
+	MaterialBuffer() = default;
+	~MaterialBuffer() = default;
+	MaterialBuffer(const MaterialBuffer&) = delete;
+	MaterialBuffer& operator=(const MaterialBuffer&) = delete;
+
+	/// <summary>
+	/// 初めて満杯になったらデバッグ出力に知らせる
+	/// </summary>
+	void ReportOverflow();
+
+private: // メンバ変数
+	// 構造化バッファ
+	Microsoft::WRL::ComPtr<ID3D12Resource> buffer_;
+	// 構造化バッファのマップ
+	Material::ConstBufferData* bufferMap_ = nullptr;
+	// 値と番号の表
+	Table table_;
+};
@@ -0,0 +1,221 @@
+#pragma once
+
+#include <algorithm>
+#include <cassert>
+#include <cstdint>
+#include <cstring>
+#include <type_traits>
+#include <unordered_map>
+#include <vector>
+
+/// <summary>
+/// 値を重複なく登録して番号を振る固定容量の表（MaterialBufferのCPU側）
+/// 同じ値（バイト列で比べる）は同じ番号を共有し、番号は0から詰めて振る。
+/// 前回の転送から書き換わった番号の範囲を覚えておく（スレッドセーフではない）
+/// </summary>
+template<typename T, uint32_t Capacity>
+class MaterialTable {
+	static_assert(std::is_trivially_copyable_v<T>);
+	static_assert(0 < Capacity);
+
+public: // 定数
+	// 無効な番号
+	static constexpr uint32_t kInvalidId = UINT32_MAX;
+	// 満杯の時に代わりに返す番号（満杯なら全ての番号が使用中なので必ず有効）
+	static constexpr uint32_t kFallbackId = 0;
+
+public: // サブクラス
+	// 統計
+	struct Statistics {
+		uint32_t materialCount = 0;  // 登録中の値の種類数（バッファの使用数）
+		uint32_t referenceCount = 0; // 参照しているマテリアル数
+		uint32_t uploadCount = 0;    // 直近のFlushで転送した要素数
+		uint32_t overflowCount = 0;  // 満杯でkFallbackIdを返した回数
+	};
+
+public: // メンバ関数
+	/// <summary>
+	/// 全ての登録を消す（発行済みの番号は全て無効になる）
+	/// </summary>
+	void Clear() {
+		entries_.clear();
+		referenceCounts_.clear();
+		freeIds_.clear();
+		idMap_.clear();
+		dirtyBegin_ = 0;
+		dirtyEnd_ = 0;
+		overflowReported_ = false;
+		statistics_ = {};
+	}
+
+	/// <summary>
+	/// 値を登録して番号を得る。同じ値が登録済みならその番号を共有する
+	/// Capacity種類を超えたらkFallbackIdを共有する（Releaseは通常通り呼ぶ）
+	/// </summary>
+	/// <param name="value">値</param>
+	/// <returns>番号</returns>
+	uint32_t Acquire(const T& value) {
+		// 同じ値があれば共有する
+		auto itr = idMap_.find(value);
+		if (itr != idMap_.end()) {
+			referenceCounts_[itr->second]++;
+			statistics_.referenceCount++;
+			return itr->second;
+		}
+
+		// 満杯なら登録せず、代わりの番号を共有する（値は変わるがバッファの外には書かない）
+		if (freeIds_.empty() && entries_.size() >= Capacity) {
+			statistics_.overflowCount++;
+			referenceCounts_[kFallbackId]++;
+			statistics_.referenceCount++;
+			return kFallbackId;
+		}
+
+		// 空いている番号を優先して使い、番号を詰めておく
+		uint32_t id;
+		if (!freeIds_.empty()) {
+			id = freeIds_.back();
+			freeIds_.pop_back();
+			entries_[id] = value;
+			referenceCounts_[id] = 1;
+		} else {
+			id = static_cast<uint32_t>(entries_.size());
+			entries_.push_back(value);
+			referenceCounts_.push_back(1);
+		}
+		idMap_.emplace(value, id);
+		statistics_.materialCount++;
+		statistics_.referenceCount++;
+
+		// 転送範囲を広げる
+		if (dirtyBegin_ == dirtyEnd_) {
+			dirtyBegin_ = id;
+			dirtyEnd_ = id + 1;
+		} else {
+			dirtyBegin_ = (std::min)(dirtyBegin_, id);
+			dirtyEnd_ = (std::max)(dirtyEnd_, id + 1);
+		}
+		return id;
+	}
+
+	/// <summary>
+	/// 番号の参照を解放する。参照がなくなった番号は再利用される
+	/// </summary>
+	/// <param name="id">番号</param>
+	void Release(uint32_t id) {
+		if (id == kInvalidId) {
+			return;
+		}
+		assert(id < entries_.size() && referenceCounts_[id] > 0);
+		statistics_.referenceCount--;
+		if (--referenceCounts_[id] > 0) {
+			return;
+		}
+
+		// 誰も使わなくなった値は登録を外し、番号を再利用する
+		idMap_.erase(entries_[id]);
+		freeIds_.push_back(id);
+		statistics_.materialCount--;
+	}
+
+	/// <summary>
+	/// 値を差し替える
+	/// 古い番号を他と共有していなければ先に解放するので、満杯でもその番号に書き換えられる
+	/// </summary>
+	/// <param name="id">現在の番号（未登録ならkInvalidId）</param>
+	/// <param name="value">新しい値</param>
+	/// <returns>新しい番号</returns>
+	uint32_t Replace(uint32_t id, const T& value) {
+		// 値が変わらなければ何もしない
+		if (id != kInvalidId && ValueEqual()(entries_[id], value)) {
+			return id;
+		}
+		if (id != kInvalidId && referenceCounts_[id] == 1) {
+			Release(id);
+			return Acquire(value);
+		}
+		// 共有している番号は新しい値を登録してから解放する
+		uint32_t newId = Acquire(value);
+		Release(id);
+		return newId;
+	}
+
+	/// <summary>
+	/// 初めて満杯になったかを取得する（Clearまでに一度だけtrueを返す）
+	/// </summary>
+	bool TakeFirstOverflow() {
+		if (overflowReported_ || statistics_.overflowCount == 0) {
+			return false;
+		}
+		overflowReported_ = true;
+		return true;
+	}
+
+	/// <summary>
+	/// 前回から書き換わった範囲を取り出して空にする
+	/// </summary>
+	/// <param name="begin">範囲の先頭の番号</param>
+	/// <param name="end">範囲の末尾の次の番号</param>
+	/// <returns>転送する要素数</returns>
+	uint32_t TakeDirtyRange(uint32_t& begin, uint32_t& end) {
+		begin = dirtyBegin_;
+		end = dirtyEnd_;
+		statistics_.uploadCount = dirtyEnd_ - dirtyBegin_;
+		dirtyBegin_ = 0;
+		dirtyEnd_ = 0;
+		return statistics_.uploadCount;
+	}
+
+	/// <summary>
+	/// 番号毎の値を取得（解放済みの番号には古い値が残る）
+	/// </summary>
+	const std::vector<T>& GetEntries() const { return entries_; }
+
+	/// <summary>
+	/// 番号の参照数を取得
+	/// </summary>
+	uint32_t GetReferenceCount(uint32_t id) const {
+		return id < referenceCounts_.size() ? referenceCounts_[id] : 0;
+	}
+
+	/// <summary>
+	/// 統計を取得
+	/// </summary>
+	const Statistics& GetStatistics() const { return statistics_; }
+
+private: // サブクラス
+	// 値のハッシュ（バイト列で比べる）
+	struct ValueHash {
+		size_t operator()(const T& value) const {
+			// FNV-1a
+			const uint8_t* bytes = reinterpret_cast<const uint8_t*>(&value);
+			uint64_t hash = 14695981039346656037ull;
+			for (size_t i = 0; i < sizeof(T); i++) {
+				hash = (hash ^ bytes[i]) * 1099511628211ull;
+			}
+			return static_cast<size_t>(hash);
+		}
+	};
+	struct ValueEqual {
+		bool operator()(const T& a, const T& b) const {
+			return std::memcmp(&a, &b, sizeof(T)) == 0;
+		}
+	};
+
+private: // メンバ変数
+	// 番号毎の値
+	std::vector<T> entries_;
+	// 番号毎の参照数
+	std::vector<uint32_t> referenceCounts_;
+	// 空いている番号
+	std::vector<uint32_t> freeIds_;
+	// 値→番号
+	std::unordered_map<T, uint32_t, ValueHash, ValueEqual> idMap_;
+	// 転送が必要な番号の範囲 [dirtyBegin_, dirtyEnd_)
+	uint32_t dirtyBegin_ = 0;
+	uint32_t dirtyEnd_ = 0;
+	// 満杯になったことを知らせたか
+	bool overflowReported_ = false;
+	// 統計
+	Statistics statistics_;
+};
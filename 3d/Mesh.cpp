@@ -1,47 +1,214 @@
 ﻿#include "DirectXCommon.h"
+#include "MathUtility.h"
 #include "Mesh.h"
+#include "MeshSimplifier.h"
+#include <algorithm>
 #include <cassert>
 #include <d3dcompiler.h>
 
 #pragma comment(lib, "d3dcompiler.lib")
 
-using namespace DirectX;
-
 void Mesh::SetName(const std::string& name_) { this->name_ = name_; }
 
 void Mesh::AddVertex(const VertexPosNormalUv& vertex) { vertices_.emplace_back(vertex); }
 
 void Mesh::AddIndex(unsigned short index) { indices_.emplace_back(index); }
 
-void Mesh::AddSmoothData(unsigned short indexPosition, unsigned short indexVertex) {
-	smoothData_[indexPosition].emplace_back(indexVertex);
+void Mesh::AddSmoothData(uint32_t indexPosition, uint32_t indexVertex) {
+	if (smoothPositionKeys_.size() <= indexVertex) {
+		smoothPositionKeys_.resize(indexVertex + 1, NormalSmoother::kNoPositionKey);
+	}
+	smoothPositionKeys_[indexVertex] = indexPosition;
+}
+
+void Mesh::CalculateSmoothedVertexNormals(NormalSmoother::Weighting weighting) {
+	if (vertices_.empty() || smoothPositionKeys_.empty()) {
+		return;
+	}
+	smoothPositionKeys_.resize(vertices_.size(), NormalSmoother::kNoPositionKey);
+
+	NormalSmoother::VertexInput input;
+	input.positionKeys = smoothPositionKeys_.data();
+	input.positions = &vertices_[0].pos;
+	input.positionStride = sizeof(VertexPosNormalUv);
+	input.normals = &vertices_[0].normal;
+	input.normalStride = sizeof(VertexPosNormalUv);
+	input.vertexCount = static_cast<uint32_t>(vertices_.size());
+	std::vector<uint32_t> indices;
+	if (weighting == NormalSmoother::Weighting::kAreaAngle) {
+		indices.assign(indices_.begin(), indices_.end());
+		input.indices = indices.data();
+		input.indexCount = indices.size();
+	}
+	NormalSmoother::Smooth(input, weighting);
+}
+
+void Mesh::CalculateBounds() {
+	if (vertices_.empty()) {
+		aabb_ = {};
+		boundingSphere_ = {};
+		return;
+	}
+
+	// AABB
+	aabb_.min = vertices_[0].pos;
+	aabb_.max = vertices_[0].pos;
+	for (const VertexPosNormalUv& vertex : vertices_) {
+		aabb_.min = Min(aabb_.min, vertex.pos);
+		aabb_.max = Max(aabb_.max, vertex.pos);
+	}
+
+	// 境界球はAABBの中心から最も遠い頂点までを半径とする
+	boundingSphere_.center = Multiply(0.5f, Add(aabb_.min, aabb_.max));
+	float radiusSq = 0.0f;
+	for (const VertexPosNormalUv& vertex : vertices_) {
+		Vector3 diff = Subtract(vertex.pos, boundingSphere_.center);
+		radiusSq = (std::max)(radiusSq, Dot(diff, diff));
+	}
+	boundingSphere_.radius = std::sqrt(radiusSq);
+}
+
+void Mesh::Optimize() {
+	optimizeStatistics_ = {};
+	optimizeStatistics_.vertexCountBefore = static_cast<uint32_t>(vertices_.size());
+	optimizeStatistics_.vertexCountAfter = optimizeStatistics_.vertexCountBefore;
+	if (vertices_.empty() || indices_.empty()) {
+		return;
+	}
+
+	// OBJの読み込みでは面の頂点毎に複製されているので、同じ頂点をまとめる
+	std::vector<uint32_t> remap;
+	uint32_t vertexCount = MeshOptimizer::GenerateVertexRemap(
+	  vertices_.data(), static_cast<uint32_t>(vertices_.size()), sizeof(VertexPosNormalUv), remap);
+	std::vector<uint32_t> indices(indices_.size());
+	for (size_t i = 0; i < indices_.size(); i++) {
+		indices[i] = remap[indices_[i]];
+	}
+	std::vector<VertexPosNormalUv> vertices(vertexCount);
+	for (size_t v = 0; v < vertices_.size(); v++) {
+		vertices[remap[v]] = vertices_[v];
+	}
+	optimizeStatistics_.vertexCountAfter = vertexCount;
+	optimizeStatistics_.cacheBefore =
+	  MeshOptimizer::AnalyzeVertexCache(indices.data(), indices.size(), vertexCount);
+
+	// 三角形の並べ替え
+	MeshOptimizer::OptimizeVertexCache(indices.data(), indices.size(), vertexCount);
+	MeshOptimizer::OptimizeOverdraw(
+	  indices.data(), indices.size(), &vertices[0].pos, sizeof(VertexPosNormalUv), vertexCount);
+	optimizeStatistics_.cacheAfter =
+	  MeshOptimizer::AnalyzeVertexCache(indices.data(), indices.size(), vertexCount);
+
+	// 頂点を使われる順に並べ替える
+	std::vector<uint32_t> fetchRemap =
+	  MeshOptimizer::OptimizeVertexFetch(indices.data(), indices.size(), vertexCount);
+	vertices_.resize(vertexCount);
+	for (uint32_t v = 0; v < vertexCount; v++) {
+		vertices_[fetchRemap[v]] = vertices[v];
+	}
+	for (size_t i = 0; i < indices.size(); i++) {
+		indices_[i] = static_cast<unsigned short>(indices[i]);
+	}
+
+	// 平滑化データも新しい頂点番号に合わせる
+	if (!smoothPositionKeys_.empty()) {
+		std::vector<uint32_t> keys(vertexCount, NormalSmoother::kNoPositionKey);
+		for (size_t v = 0; v < smoothPositionKeys_.size(); v++) {
+			keys[fetchRemap[remap[v]]] = smoothPositionKeys_[v];
+		}
+		smoothPositionKeys_.swap(keys);
+	}
+}
+
+void Mesh::GenerateMeshlets() {
+	meshlets_.clear();
+	if (vertices_.empty() || indices_.empty()) {
+		return;
+	}
+	std::vector<uint32_t> indices(indices_.begin(), indices_.end());
+	meshlets_ = ::BuildMeshlets(
+	  indices.data(), indices.size(), &vertices_[0].pos, sizeof(VertexPosNormalUv),
+	  static_cast<uint32_t>(vertices_.size()));
+}
+
+void Mesh::GenerateTangents() {
+	tangents_.clear();
+	if (vertices_.empty() || indices_.empty()) {
+		return;
+	}
+
+	TangentGenerator::VertexInput input;
+	input.positions = &vertices_[0].pos;
+	input.positionStride = sizeof(VertexPosNormalUv);
+	input.normals = &vertices_[0].normal;
+	input.normalStride = sizeof(VertexPosNormalUv);
+	input.uvs = &vertices_[0].uv;
+	input.uvStride = sizeof(VertexPosNormalUv);
+	input.vertexCount = static_cast<uint32_t>(vertices_.size());
+	std::vector<uint32_t> indices(indices_.begin(), indices_.end());
+	input.indices = indices.data();
+	input.indexCount = indices.size();
+
+	tangents_.resize(vertices_.size());
+	TangentGenerator::Generate(input, tangents_.data());
 }
 
-void Mesh::CalculateSmoothedVertexNormals() {
-	auto itr = smoothData_.begin();
-	for (; itr != smoothData_.end(); ++itr) {
-		// 各面用の共通頂点コレクション
-		std::vector<unsigned short>& v = itr->second;
-		// 全頂点の法線を平均する
-		XMVECTOR normal = {};
-		for (unsigned short index : v) {
-			normal += XMVectorSet(
-			  vertices_[index].normal.x, vertices_[index].normal.y, vertices_[index].normal.z, 0);
+void Mesh::GenerateLods(uint32_t lodCount) {
+	lodIndices_.clear();
+	lods_.clear();
+	lods_.push_back({0, static_cast<uint32_t>(indices_.size()), 0.0f});
+	if (vertices_.empty() || indices_.empty()) {
+		return;
+	}
+
+	MeshSimplifier::VertexInput input;
+	input.positions = &vertices_[0].pos;
+	input.positionStride = sizeof(VertexPosNormalUv);
+	input.normals = &vertices_[0].normal;
+	input.normalStride = sizeof(VertexPosNormalUv);
+	input.uvs = &vertices_[0].uv;
+	input.uvStride = sizeof(VertexPosNormalUv);
+	input.vertexCount = static_cast<uint32_t>(vertices_.size());
+
+	// 誤差が累積しないよう、毎回元の形状から簡略化する
+	std::vector<uint32_t> source(indices_.begin(), indices_.end());
+	for (uint32_t level = 1; level < lodCount; level++) {
+		size_t targetIndexCount = source.size() >> level;
+		MeshSimplifier::Result result =
+		  MeshSimplifier::Simplify(input, source.data(), source.size(), targetIndexCount);
+
+		// 減らせなくなったらそこで打ち切る
+		const Lod& previous = lods_.back();
+		if (result.indices.empty() || result.indices.size() >= previous.indexCount) {
+			break;
 		}
-		normal = XMVector3Normalize(normal / (float)v.size());
 
-		for (unsigned short index : v) {
-			vertices_[index].normal = {normal.m128_f32[0], normal.m128_f32[1], normal.m128_f32[2]};
+		Lod lod;
+		lod.indexOffset = static_cast<uint32_t>(indices_.size() + lodIndices_.size());
+		lod.indexCount = static_cast<uint32_t>(result.indices.size());
+		lod.error = (std::max)(result.error, previous.error);
+		MeshOptimizer::OptimizeVertexCache(
+		  result.indices.data(), result.indices.size(), input.vertexCount);
+		for (uint32_t index : result.indices) {
+			lodIndices_.push_back(static_cast<unsigned short>(index));
 		}
+		lods_.push_back(lod);
 	}
 }
 
 void Mesh::SetMaterial(Material* material) { this->material_ = material; }
 
-void Mesh::CreateBuffers() {
+void Mesh::CreateBuffers(bool quantize) {
 	HRESULT result;
 
-	UINT sizeVB = static_cast<UINT>(sizeof(VertexPosNormalUv) * vertices_.size());
+	quantized_ = quantize && !HasTangents();
+	UINT vertexStride = static_cast<UINT>(sizeof(VertexPosNormalUv));
+	if (quantized_) {
+		vertexStride = static_cast<UINT>(sizeof(VertexQuantizer::PackedVertex));
+	} else if (HasTangents()) {
+		vertexStride = static_cast<UINT>(sizeof(VertexPosNormalUvTangent));
+	}
+	UINT sizeVB = static_cast<UINT>(vertexStride * vertices_.size());
 
 	// ヒーププロパティ
 	CD3DX12_HEAP_PROPERTIES heapProps = CD3DX12_HEAP_PROPERTIES(D3D12_HEAP_TYPE_UPLOAD);
@@ -55,24 +222,62 @@ void Mesh::CreateBuffers() {
 	assert(SUCCEEDED(result));
 
 	// 頂点バッファへのデータ転送
-	VertexPosNormalUv* vertMap = nullptr;
-	result = vertBuff_->Map(0, nullptr, (void**)&vertMap);
-	if (SUCCEEDED(result)) {
-		std::copy(vertices_.begin(), vertices_.end(), vertMap);
-		vertBuff_->Unmap(0, nullptr);
+	if (quantized_) {
+		// AABBを基準に圧縮し、誤差を記録する
+		CalculateBounds();
+		quantizationRange_ = VertexQuantizer::MakeRange(aabb_);
+		quantizationError_ = {};
+		VertexQuantizer::PackedVertex* vertMap = nullptr;
+		result = vertBuff_->Map(0, nullptr, (void**)&vertMap);
+		if (SUCCEEDED(result)) {
+			for (size_t i = 0; i < vertices_.size(); i++) {
+				const VertexPosNormalUv& vertex = vertices_[i];
+				VertexQuantizer::PackedVertex packed =
+				  VertexQuantizer::Encode(vertex.pos, vertex.normal, vertex.uv, quantizationRange_);
+				VertexQuantizer::AccumulateError(
+				  quantizationError_, packed, quantizationRange_, vertex.pos, vertex.normal,
+				  vertex.uv);
+				vertMap[i] = packed;
+			}
+			vertBuff_->Unmap(0, nullptr);
+		}
+	} else if (HasTangents()) {
+		// 接線を並べて転送する
+		VertexPosNormalUvTangent* vertMap = nullptr;
+		result = vertBuff_->Map(0, nullptr, (void**)&vertMap);
+		if (SUCCEEDED(result)) {
+			for (size_t i = 0; i < vertices_.size(); i++) {
+				const VertexPosNormalUv& vertex = vertices_[i];
+				vertMap[i] = {vertex.pos, vertex.normal, vertex.uv, tangents_[i]};
+			}
+			vertBuff_->Unmap(0, nullptr);
+		}
+	} else {
+		VertexPosNormalUv* vertMap = nullptr;
+		result = vertBuff_->Map(0, nullptr, (void**)&vertMap);
+		if (SUCCEEDED(result)) {
+			std::copy(vertices_.begin(), vertices_.end(), vertMap);
+			vertBuff_->Unmap(0, nullptr);
+		}
 	}
 
 	// 頂点バッファビューの作成
 	vbView_.BufferLocation = vertBuff_->GetGPUVirtualAddress();
 	vbView_.SizeInBytes = sizeVB;
-	vbView_.StrideInBytes = sizeof(vertices_[0]);
+	vbView_.StrideInBytes = vertexStride;
 
 	if (FAILED(result)) {
 		assert(0);
 		return;
 	}
 
-	UINT sizeIB = static_cast<UINT>(sizeof(unsigned short) * indices_.size());
+	// LODを生成していなければ元の形状だけ
+	if (lods_.empty()) {
+		lods_.push_back({0, static_cast<uint32_t>(indices_.size()), 0.0f});
+	}
+
+	UINT sizeIB =
+	  static_cast<UINT>(sizeof(unsigned short) * (indices_.size() + lodIndices_.size()));
 	// リソース設定
 	resourceDesc.Width = sizeIB;
 	// インデックスバッファ生成
@@ -88,7 +293,8 @@ void Mesh::CreateBuffers() {
 	unsigned short* indexMap = nullptr;
 	result = indexBuff_->Map(0, nullptr, (void**)&indexMap);
 	if (SUCCEEDED(result)) {
-		std::copy(indices_.begin(), indices_.end(), indexMap);
+		indexMap = std::copy(indices_.begin(), indices_.end(), indexMap);
+		std::copy(lodIndices_.begin(), lodIndices_.end(), indexMap);
 		indexBuff_->Unmap(0, nullptr);
 	}
 
@@ -115,7 +321,7 @@ void Mesh::Draw(
 
 void Mesh::Draw(
   ID3D12GraphicsCommandList* commandList, UINT rooParameterIndexMaterial,
-  UINT rooParameterIndexTexture, uint32_t textureHandle) {
+  UINT rooParameterIndexTexture, uint32_t textureHandle, uint32_t lodLevel) {
 	// 頂点バッファをセット
 	commandList->IASetVertexBuffers(0, 1, &vbView_);
 	// インデックスバッファをセット
@@ -126,5 +332,24 @@ void Mesh::Draw(
 	  commandList, rooParameterIndexMaterial, rooParameterIndexTexture, textureHandle);
 
 	// 描画コマンド
-	commandList->DrawIndexedInstanced((UINT)indices_.size(), 1, 0, 0, 0);
+	const Lod& lod = GetLod(lodLevel);
+	commandList->DrawIndexedInstanced(lod.indexCount, 1, lod.indexOffset, 0, 0);
+}
+
+void Mesh::DrawRanges(
+  ID3D12GraphicsCommandList* commandList, UINT rooParameterIndexMaterial,
+  UINT rooParameterIndexTexture, uint32_t textureHandle, const std::vector<IndexRange>& ranges) {
+	// 頂点バッファをセット
+	commandList->IASetVertexBuffers(0, 1, &vbView_);
+	// インデックスバッファをセット
+	commandList->IASetIndexBuffer(&ibView_);
+
+	// マテリアルのグラフィックスコマンドをセット
+	material_->SetGraphicsCommand(
+	  commandList, rooParameterIndexMaterial, rooParameterIndexTexture, textureHandle);
+
+	// 描画コマンド（範囲毎）
+	for (const IndexRange& range : ranges) {
+		commandList->DrawIndexedInstanced(range.indexCount, 1, range.indexOffset, 0, 0);
+	}
 }
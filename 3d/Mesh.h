@@ -1,12 +1,19 @@
 #pragma once
 
+#include "Culling.h"
 #include "Material.h"
+#include "MeshOptimizer.h"
+#include "Meshlet.h"
+#include "NormalSmoother.h"
+#include "TangentGenerator.h"
+#include "VertexQuantizer.h"
 #include "Vector2.h"
 #include "Vector3.h"
+#include "Vector4.h"
 #include <Windows.h>
+#include <algorithm>
 #include <d3d12.h>
 #include <d3dx12.h>
-#include <unordered_map>
 #include <vector>
 #include <wrl.h>
 
@@ -26,6 +33,29 @@ public: // サブクラス
 		Vector2 uv;     // uv座標
 	};
 
+	// 頂点データ構造体（法線マップ用の接線あり）
+	struct VertexPosNormalUvTangent {
+		Vector3 pos;     // xyz座標
+		Vector3 normal;  // 法線ベクトル
+		Vector2 uv;      // uv座標
+		Vector4 tangent; // 接線（wは従法線の向き）
+	};
+
+	// 詳細度（LOD）毎のインデックス範囲。頂点バッファは全LODで共有する
+	struct Lod {
+		uint32_t indexOffset; // インデックスバッファ内の開始位置
+		uint32_t indexCount;  // インデックス数
+		float error;          // 元の形状からの幾何誤差（ローカル座標系）
+	};
+
+	// メッシュ最適化の統計
+	struct OptimizeStatistics {
+		uint32_t vertexCountBefore = 0;                    // 重複頂点の統合前の頂点数
+		uint32_t vertexCountAfter = 0;                     // 重複頂点の統合後の頂点数
+		MeshOptimizer::VertexCacheStatistics cacheBefore; // 並べ替え前（読み込んだ面の順）
+		MeshOptimizer::VertexCacheStatistics cacheAfter;  // 並べ替え後
+	};
+
 public: // メンバ関数
 	/// <summary>
 	/// 名前を取得
@@ -62,12 +92,87 @@ public: // メンバ関数
 	/// </summary>
 	/// <param name="indexPosition">座標インデックス</param>
 	/// <param name="indexVertex">頂点インデックス</param>
-	void AddSmoothData(unsigned short indexPosition, unsigned short indexVertex);
+	void AddSmoothData(uint32_t indexPosition, uint32_t indexVertex);
 
 	/// <summary>
 	/// 平滑化された頂点法線の計算
 	/// </summary>
-	void CalculateSmoothedVertexNormals();
+	/// <param name="weighting">法線の重み付け（既定は各頂点の法線の平均）</param>
+	void CalculateSmoothedVertexNormals(
+	    NormalSmoother::Weighting weighting = NormalSmoother::Weighting::kAverage);
+
+	/// <summary>
+	/// 境界ボリューム（AABBと境界球）の計算
+	/// </summary>
+	void CalculateBounds();
+
+	/// <summary>
+	/// AABBを取得
+	/// </summary>
+	/// <returns>ローカル座標系のAABB</returns>
+	const AABB& GetAABB() const { return aabb_; }
+
+	/// <summary>
+	/// 境界球を取得
+	/// </summary>
+	/// <returns>ローカル座標系の境界球</returns>
+	const Sphere& GetBoundingSphere() const { return boundingSphere_; }
+
+	/// <summary>
+	/// 重複頂点をまとめ、頂点キャッシュ・オーバードロー・頂点フェッチの順に並べ替える
+	/// GenerateLodsとCreateBuffersより前に呼ぶ
+	/// </summary>
+	void Optimize();
+
+	/// <summary>
+	/// メッシュ最適化の統計を取得
+	/// </summary>
+	/// <returns>統計</returns>
+	const OptimizeStatistics& GetOptimizeStatistics() const { return optimizeStatistics_; }
+
+	/// <summary>
+	/// 元の形状（LOD0）をメッシュレットに分ける。Optimizeの後、CreateBuffersより前に呼ぶ
+	/// </summary>
+	void GenerateMeshlets();
+
+	/// <summary>
+	/// メッシュレット一覧を取得（LOD0のインデックス範囲を指す）
+	/// </summary>
+	/// <returns>メッシュレット一覧</returns>
+	const std::vector<Meshlet>& GetMeshlets() const { return meshlets_; }
+
+	/// <summary>
+	/// 法線マップ用の接線を生成する。Optimizeの後、CreateBuffersより前に呼ぶ
+	/// 生成すると頂点バッファはVertexPosNormalUvTangent形式になる
+	/// </summary>
+	void GenerateTangents();
+
+	/// <summary>
+	/// 接線を生成済みか
+	/// </summary>
+	bool HasTangents() const { return !tangents_.empty(); }
+
+	/// <summary>
+	/// 簡略化したLODを生成する。CreateBuffersより前に呼ぶ
+	/// LODが増える毎に三角形数を約半分にする
+	/// </summary>
+	/// <param name="lodCount">LOD数（元の形状を含む）</param>
+	void GenerateLods(uint32_t lodCount);
+
+	/// <summary>
+	/// LOD一覧を取得（0番が元の形状）
+	/// </summary>
+	/// <returns>LOD一覧</returns>
+	const std::vector<Lod>& GetLods() const { return lods_; }
+
+	/// <summary>
+	/// LODを取得
+	/// </summary>
+	/// <param name="lodLevel">LOD番号（範囲外なら最も粗いLOD）</param>
+	/// <returns>LOD</returns>
+	const Lod& GetLod(uint32_t lodLevel) const {
+		return lods_[(std::min)(lodLevel, static_cast<uint32_t>(lods_.size()) - 1)];
+	}
 
 	/// <summary>
 	/// マテリアルの取得
@@ -83,8 +188,27 @@ public: // メンバ関数
 
 	/// <summary>
 	/// バッファの生成
+	/// 接線付きの頂点は圧縮形式に対応していないので、quantizeの指定に関わらず圧縮しない
 	/// </summary>
-	void CreateBuffers();
+	/// <param name="quantize">頂点を圧縮形式（VertexQuantizer::PackedVertex）で転送するか</param>
+	void CreateBuffers(bool quantize = false);
+
+	/// <summary>
+	/// 頂点バッファが圧縮形式か
+	/// </summary>
+	bool IsQuantized() const { return quantized_; }
+
+	/// <summary>
+	/// 圧縮した座標の範囲を取得（シェーダーの定数にそのまま渡す）
+	/// </summary>
+	const VertexQuantizer::Range& GetQuantizationRange() const { return quantizationRange_; }
+
+	/// <summary>
+	/// 圧縮誤差を取得
+	/// </summary>
+	const VertexQuantizer::ErrorStatistics& GetQuantizationError() const {
+		return quantizationError_;
+	}
 
 	/// <summary>
 	/// 頂点バッファ取得
@@ -115,9 +239,23 @@ public: // メンバ関数
 	/// <param name="rooParameterIndexMaterial">マテリアルのルートパラメータ番号</param>
 	/// <param name="rooParameterIndexTexture">テクスチャのルートパラメータ番号</param>
 	/// <param name="textureHandle">差し替えるテクスチャハンドル</param>
+	/// <param name="lodLevel">LOD番号（範囲外なら最も粗いLOD）</param>
 	void Draw(
 	    ID3D12GraphicsCommandList* commandList, UINT rooParameterIndexMaterial,
-	    UINT rooParameterIndexTexture, uint32_t textureHandle);
+	    UINT rooParameterIndexTexture, uint32_t textureHandle, uint32_t lodLevel = 0);
+
+	/// <summary>
+	/// インデックス範囲を指定して描画（メッシュレットカリングの結果を描く）
+	/// </summary>
+	/// <param name="commandList">命令発行先コマンドリスト</param>
+	/// <param name="rooParameterIndexMaterial">マテリアルのルートパラメータ番号</param>
+	/// <param name="rooParameterIndexTexture">テクスチャのルートパラメータ番号</param>
+	/// <param name="textureHandle">テクスチャハンドル</param>
+	/// <param name="ranges">描画するインデックス範囲</param>
+	void DrawRanges(
+	    ID3D12GraphicsCommandList* commandList, UINT rooParameterIndexMaterial,
+	    UINT rooParameterIndexTexture, uint32_t textureHandle,
+	    const std::vector<IndexRange>& ranges);
 
 	/// <summary>
 	/// 頂点配列を取得
@@ -146,8 +284,28 @@ private: // メンバ変数
 	std::vector<VertexPosNormalUv> vertices_;
 	// 頂点インデックス配列
 	std::vector<unsigned short> indices_;
-	// 頂点法線スムージング用データ
-	std::unordered_map<unsigned short, std::vector<unsigned short>> smoothData_;
+	// LOD1以降の頂点インデックス配列（indices_の後ろに続けて転送する）
+	std::vector<unsigned short> lodIndices_;
+	// LOD一覧
+	std::vector<Lod> lods_;
+	// メッシュレット一覧
+	std::vector<Meshlet> meshlets_;
+	// 頂点毎の接線（法線マップを使う場合のみ）
+	std::vector<Vector4> tangents_;
+	// 頂点法線スムージング用データ（頂点毎の座標インデックス）
+	std::vector<uint32_t> smoothPositionKeys_;
 	// マテリアル
 	Material* material_ = nullptr;
+	// AABB（ローカル座標系）
+	AABB aabb_ = {};
+	// 境界球（ローカル座標系）
+	Sphere boundingSphere_ = {};
+	// メッシュ最適化の統計
+	OptimizeStatistics optimizeStatistics_;
+	// 頂点バッファが圧縮形式か
+	bool quantized_ = false;
+	// 圧縮した座標の範囲
+	VertexQuantizer::Range quantizationRange_ = {};
+	// 圧縮誤差
+	VertexQuantizer::ErrorStatistics quantizationError_;
 };
@@ -0,0 +1,385 @@
+﻿#include "MeshOptimizer.h"
+#include "MathUtility.h"
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+#include <cstring>
+#include <numeric>
+
+namespace {
+
+// スコア計算で扱う残り三角形数の上限
+const uint32_t kMaxValence = 32;
+
+// FIFOキャッシュのシミュレーション
+// 頂点毎に最後に読み込んだ時刻を持ち、時刻の差でキャッシュに残っているかを判定する
+class FifoCache {
+public:
+	FifoCache(uint32_t vertexCount, uint32_t cacheSize)
+	    : timestamps_(vertexCount, 0), cacheSize_(cacheSize), time_(cacheSize + 1) {}
+
+	// 頂点を参照する。ミスならtrue
+	bool Access(uint32_t vertex) {
+		if (time_ - timestamps_[vertex] > cacheSize_) {
+			timestamps_[vertex] = time_++;
+			return true;
+		}
+		return false;
+	}
+
+	// 三角形を参照する。ミス数を返す
+	uint32_t Access(const uint32_t* corner) {
+		uint32_t misses = 0;
+		for (int i = 0; i < 3; i++) {
+			misses += Access(corner[i]) ? 1 : 0;
+		}
+		return misses;
+	}
+
+	// キャッシュを空にする
+	void Flush() { time_ += cacheSize_ + 1; }
+
+private:
+	std::vector<uint32_t> timestamps_;
+	uint32_t cacheSize_;
+	uint32_t time_;
+};
+
+// 頂点スコアの表（Forsyth, "Linear-Speed Vertex Cache Optimisation"）
+struct ScoreTable {
+	float cache[MeshOptimizer::kScoringCacheSize];
+	float valence[kMaxValence + 1];
+
+	ScoreTable() {
+		const float kCacheDecayPower = 1.5f;
+		const float kLastTriangleScore = 0.75f;
+		const float kValenceBoostScale = 2.0f;
+		const float kValenceBoostPower = 0.5f;
+		for (uint32_t i = 0; i < MeshOptimizer::kScoringCacheSize; i++) {
+			if (i < 3) {
+				// 直前の三角形の頂点は、同じ三角形を続けて出しにくいよう少し下げる
+				cache[i] = kLastTriangleScore;
+			} else {
+				float scaler = 1.0f / static_cast<float>(MeshOptimizer::kScoringCacheSize - 3);
+				cache[i] = std::pow(1.0f - static_cast<float>(i - 3) * scaler, kCacheDecayPower);
+			}
+		}
+		valence[0] = 0.0f;
+		for (uint32_t i = 1; i <= kMaxValence; i++) {
+			// 残りの少ない頂点を優先して使い切る
+			valence[i] = kValenceBoostScale * std::pow(static_cast<float>(i), -kValenceBoostPower);
+		}
+	}
+
+	float Score(int32_t cachePosition, uint32_t remaining) const {
+		if (remaining == 0) {
+			return -1.0f;
+		}
+		float score = cachePosition >= 0 ? cache[cachePosition] : 0.0f;
+		return score + valence[(std::min)(remaining, kMaxValence)];
+	}
+};
+
+} // namespace
+
+uint32_t MeshOptimizer::GenerateVertexRemap(
+  const void* vertices, uint32_t vertexCount, size_t vertexSize, std::vector<uint32_t>& remap) {
+	assert(vertices || vertexCount == 0);
+	const uint8_t* bytes = static_cast<const uint8_t*>(vertices);
+	auto compare = [bytes, vertexSize](uint32_t a, uint32_t b) {
+		return std::memcmp(bytes + vertexSize * a, bytes + vertexSize * b, vertexSize);
+	};
+
+	// 内容順に並べて同じ頂点を隣り合わせる（同じ内容なら番号順）
+	std::vector<uint32_t> sorted(vertexCount);
+	std::iota(sorted.begin(), sorted.end(), 0);
+	std::sort(sorted.begin(), sorted.end(), [&compare](uint32_t a, uint32_t b) {
+		int result = compare(a, b);
+		return result != 0 ? result < 0 : a < b;
+	});
+
+	// 同じ内容のグループは先頭（最も小さい番号）に寄せる
+	std::vector<uint32_t> representative(vertexCount);
+	for (uint32_t i = 0; i < vertexCount; i++) {
+		bool sameAsPrevious = i > 0 && compare(sorted[i - 1], sorted[i]) == 0;
+		representative[sorted[i]] = sameAsPrevious ? representative[sorted[i - 1]] : sorted[i];
+	}
+
+	// 最初に現れた順に番号を振る
+	const uint32_t kUnused = UINT32_MAX;
+	remap.assign(vertexCount, kUnused);
+	uint32_t uniqueCount = 0;
+	for (uint32_t v = 0; v < vertexCount; v++) {
+		uint32_t first = representative[v];
+		if (remap[first] == kUnused) {
+			remap[first] = uniqueCount++;
+		}
+		remap[v] = remap[first];
+	}
+	return uniqueCount;
+}
+
+void MeshOptimizer::OptimizeVertexCache(
+  uint32_t* indices, size_t indexCount, uint32_t vertexCount) {
+	assert(indexCount % 3 == 0);
+	const uint32_t triangleCount = static_cast<uint32_t>(indexCount / 3);
+	if (triangleCount == 0) {
+		return;
+	}
+	static const ScoreTable kScoreTable;
+
+	// 頂点→三角形の隣接リスト（未出力の三角形を先頭に詰めて持つ）
+	std::vector<uint32_t> remaining(vertexCount, 0);
+	for (size_t i = 0; i < indexCount; i++) {
+		assert(indices[i] < vertexCount);
+		remaining[indices[i]]++;
+	}
+	std::vector<uint32_t> offsets(vertexCount + 1, 0);
+	std::partial_sum(remaining.begin(), remaining.end(), offsets.begin() + 1);
+	std::vector<uint32_t> adjacency(indexCount);
+	{
+		std::vector<uint32_t> cursor(offsets.begin(), offsets.end() - 1);
+		for (uint32_t t = 0; t < triangleCount; t++) {
+			for (int i = 0; i < 3; i++) {
+				adjacency[cursor[indices[t * 3 + i]]++] = t;
+			}
+		}
+	}
+
+	std::vector<float> vertexScores(vertexCount);
+	for (uint32_t v = 0; v < vertexCount; v++) {
+		vertexScores[v] = kScoreTable.Score(-1, remaining[v]);
+	}
+
+	std::vector<uint32_t> output;
+	output.reserve(indexCount);
+	std::vector<uint8_t> emitted(triangleCount, 0);
+	// キャッシュ（先頭が最新）。追加した3頂点分だけ一時的にあふれる
+	uint32_t cache[kScoringCacheSize + 3];
+	uint32_t cacheCount = 0;
+	uint32_t newCache[kScoringCacheSize + 3];
+	uint32_t scanCursor = 0;
+	int64_t best = -1;
+
+	while (output.size() < indexCount) {
+		// キャッシュ内に候補がなければ、まだ出していない三角形を先頭から探す
+		if (best < 0) {
+			while (emitted[scanCursor]) {
+				scanCursor++;
+			}
+			best = scanCursor;
+		}
+		const uint32_t triangle = static_cast<uint32_t>(best);
+		const uint32_t* corner = &indices[triangle * 3];
+		emitted[triangle] = 1;
+
+		// 出力して隣接リストから外す
+		for (int i = 0; i < 3; i++) {
+			uint32_t v = corner[i];
+			output.push_back(v);
+			uint32_t* list = &adjacency[offsets[v]];
+			uint32_t* found = std::find(list, list + remaining[v], triangle);
+			assert(found != list + remaining[v]);
+			std::swap(*found, list[remaining[v] - 1]);
+			remaining[v]--;
+		}
+
+		// 出力した3頂点を先頭に置き、残りを後ろへずらす
+		uint32_t newCacheCount = 0;
+		for (int i = 0; i < 3; i++) {
+			newCache[newCacheCount++] = corner[i];
+		}
+		for (uint32_t i = 0; i < cacheCount; i++) {
+			uint32_t v = cache[i];
+			if (v != corner[0] && v != corner[1] && v != corner[2]) {
+				newCache[newCacheCount++] = v;
+			}
+		}
+
+		// キャッシュ内の頂点のスコアを更新する（あふれた頂点はキャッシュ外の扱い）
+		for (uint32_t i = 0; i < newCacheCount; i++) {
+			uint32_t v = newCache[i];
+			int32_t position = i < kScoringCacheSize ? static_cast<int32_t>(i) : -1;
+			vertexScores[v] = kScoreTable.Score(position, remaining[v]);
+		}
+
+		// キャッシュ内の頂点を使う三角形から次を選ぶ
+		best = -1;
+		float bestScore = 0.0f;
+		for (uint32_t i = 0; i < newCacheCount; i++) {
+			uint32_t v = newCache[i];
+			const uint32_t* list = &adjacency[offsets[v]];
+			for (uint32_t j = 0; j < remaining[v]; j++) {
+				const uint32_t* c = &indices[list[j] * 3];
+				float score = vertexScores[c[0]] + vertexScores[c[1]] + vertexScores[c[2]];
+				if (best < 0 || score > bestScore) {
+					best = list[j];
+					bestScore = score;
+				}
+			}
+		}
+
+		cacheCount = (std::min)(newCacheCount, kScoringCacheSize);
+		std::copy(newCache, newCache + cacheCount, cache);
+	}
+
+	std::copy(output.begin(), output.end(), indices);
+}
+
+void MeshOptimizer::OptimizeOverdraw(
+  uint32_t* indices, size_t indexCount, const Vector3* positions, size_t positionStride,
+  uint32_t vertexCount, float threshold) {
+	assert(positions);
+	assert(indexCount % 3 == 0);
+	const uint32_t triangleCount = static_cast<uint32_t>(indexCount / 3);
+	if (triangleCount == 0) {
+		return;
+	}
+	auto position = [positions, positionStride](uint32_t index) -> const Vector3& {
+		return *reinterpret_cast<const Vector3*>(
+		  reinterpret_cast<const uint8_t*>(positions) + positionStride * index);
+	};
+
+	// キャッシュが途切れる（3頂点ともミスする）所で大きな塊に分ける
+	std::vector<uint32_t> hardBoundaries;
+	{
+		FifoCache cache(vertexCount, kCacheSize);
+		for (uint32_t t = 0; t < triangleCount; t++) {
+			if (cache.Access(&indices[t * 3]) == 3 || t == 0) {
+				hardBoundaries.push_back(t);
+			}
+		}
+		hardBoundaries.push_back(triangleCount);
+	}
+
+	// 塊の中を、ACMRが塊全体のthreshold倍に収まる範囲で細かく分ける
+	// 境界でキャッシュを空にした前提で数えるので、どの順に並べても悪化は抑えられる
+	std::vector<uint32_t> clusters;
+	{
+		FifoCache cache(vertexCount, kCacheSize);
+		for (size_t h = 0; h + 1 < hardBoundaries.size(); h++) {
+			uint32_t begin = hardBoundaries[h];
+			uint32_t end = hardBoundaries[h + 1];
+			cache.Flush();
+			uint32_t clusterMisses = 0;
+			for (uint32_t t = begin; t < end; t++) {
+				clusterMisses += cache.Access(&indices[t * 3]);
+			}
+			float limit = threshold * static_cast<float>(clusterMisses) /
+			              static_cast<float>(end - begin);
+
+			cache.Flush();
+			clusters.push_back(begin);
+			uint32_t start = begin;
+			uint32_t misses = 0;
+			for (uint32_t t = begin; t < end; t++) {
+				misses += cache.Access(&indices[t * 3]);
+				float count = static_cast<float>(t + 1 - start);
+				if (t + 1 < end && static_cast<float>(misses) <= limit * count) {
+					clusters.push_back(t + 1);
+					start = t + 1;
+					misses = 0;
+					cache.Flush();
+				}
+			}
+		}
+		clusters.push_back(triangleCount);
+	}
+
+	// 塊毎の重心と法線（面積で重み付け）
+	const size_t clusterCount = clusters.size() - 1;
+	std::vector<Vector3> centroids(clusterCount, {0.0f, 0.0f, 0.0f});
+	std::vector<Vector3> normals(clusterCount, {0.0f, 0.0f, 0.0f});
+	Vector3 meshCentroid = {0.0f, 0.0f, 0.0f};
+	float meshArea = 0.0f;
+	for (size_t c = 0; c < clusterCount; c++) {
+		float clusterArea = 0.0f;
+		for (uint32_t t = clusters[c]; t < clusters[c + 1]; t++) {
+			const uint32_t* corner = &indices[t * 3];
+			const Vector3& p0 = position(corner[0]);
+			const Vector3& p1 = position(corner[1]);
+			const Vector3& p2 = position(corner[2]);
+			Vector3 cross = Cross(Subtract(p1, p0), Subtract(p2, p0));
+			float area = Length(cross);
+			Vector3 center = Multiply(1.0f / 3.0f, Add(Add(p0, p1), p2));
+			centroids[c] = Add(centroids[c], Multiply(area, center));
+			normals[c] = Add(normals[c], cross);
+			clusterArea += area;
+		}
+		meshCentroid = Add(meshCentroid, centroids[c]);
+		meshArea += clusterArea;
+		if (clusterArea > 0.0f) {
+			centroids[c] = Multiply(1.0f / clusterArea, centroids[c]);
+		}
+	}
+	if (meshArea > 0.0f) {
+		meshCentroid = Multiply(1.0f / meshArea, meshCentroid);
+	}
+
+	// 外側を向いている塊ほど手前に来やすいので先に描く
+	std::vector<float> sortKeys(clusterCount);
+	for (size_t c = 0; c < clusterCount; c++) {
+		float length = Length(normals[c]);
+		Vector3 normal =
+		  length > 0.0f ? Multiply(1.0f / length, normals[c]) : Vector3{0.0f, 0.0f, 0.0f};
+		sortKeys[c] = Dot(Subtract(centroids[c], meshCentroid), normal);
+	}
+	std::vector<uint32_t> order(clusterCount);
+	std::iota(order.begin(), order.end(), 0);
+	std::stable_sort(order.begin(), order.end(), [&sortKeys](uint32_t a, uint32_t b) {
+		return sortKeys[a] > sortKeys[b];
+	});
+
+	std::vector<uint32_t> source(indices, indices + indexCount);
+	uint32_t* destination = indices;
+	for (uint32_t c : order) {
+		destination = std::copy(
+		  source.begin() + clusters[c] * 3, source.begin() + clusters[c + 1] * 3, destination);
+	}
+}
+
+std::vector<uint32_t>
+  MeshOptimizer::OptimizeVertexFetch(uint32_t* indices, size_t indexCount, uint32_t vertexCount) {
+	const uint32_t kUnused = UINT32_MAX;
+	std::vector<uint32_t> remap(vertexCount, kUnused);
+	uint32_t next = 0;
+	for (size_t i = 0; i < indexCount; i++) {
+		assert(indices[i] < vertexCount);
+		uint32_t& newIndex = remap[indices[i]];
+		if (newIndex == kUnused) {
+			newIndex = next++;
+		}
+		indices[i] = newIndex;
+	}
+	for (uint32_t& newIndex : remap) {
+		if (newIndex == kUnused) {
+			newIndex = next++;
+		}
+	}
+	return remap;
+}
+
+MeshOptimizer::VertexCacheStatistics MeshOptimizer::AnalyzeVertexCache(
+  const uint32_t* indices, size_t indexCount, uint32_t vertexCount, uint32_t cacheSize) {
+	assert(indexCount % 3 == 0);
+	VertexCacheStatistics statistics;
+	if (indexCount == 0) {
+		return statistics;
+	}
+
+	FifoCache cache(vertexCount, cacheSize);
+	std::vector<uint8_t> used(vertexCount, 0);
+	uint32_t usedCount = 0;
+	for (size_t i = 0; i < indexCount; i++) {
+		assert(indices[i] < vertexCount);
+		statistics.missCount += cache.Access(indices[i]) ? 1 : 0;
+		if (!used[indices[i]]) {
+			used[indices[i]] = 1;
+			usedCount++;
+		}
+	}
+	statistics.acmr =
+	  static_cast<float>(statistics.missCount) / static_cast<float>(indexCount / 3);
+	statistics.atvr = static_cast<float>(statistics.missCount) / static_cast<float>(usedCount);
+	return statistics;
+}
@@ -0,0 +1,87 @@
+#pragma once
+
+#include "Vector3.h"
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+/// <summary>
+/// メッシュ最適化（三角形と頂点の並べ替え）
+/// 重複頂点の統合 → 頂点キャッシュ → オーバードロー → 頂点フェッチの順に適用する
+/// </summary>
+class MeshOptimizer {
+public: // 定数
+	// 統計用にシミュレートする頂点キャッシュのサイズ（FIFO）
+	static const uint32_t kCacheSize = 16;
+	// 並べ替えのスコア計算に使うキャッシュのサイズ（LRU）
+	static constexpr uint32_t kScoringCacheSize = 32;
+	// オーバードロー最適化で許容するACMRの悪化率
+	static constexpr float kDefaultOverdrawThreshold = 1.05f;
+
+public: // サブクラス
+	// 頂点キャッシュの統計
+	struct VertexCacheStatistics {
+		uint32_t missCount = 0; // キャッシュミス数（頂点シェーダの実行回数）
+		float acmr = 0.0f;      // 三角形あたりのキャッシュミス数（0.5～3）
+		float atvr = 0.0f;      // 使われている頂点あたりのキャッシュミス数（1が理想）
+	};
+
+public: // 静的メンバ関数
+	/// <summary>
+	/// 内容が完全に一致する頂点をまとめる対応表を作る
+	/// 新しい番号は最初に現れた順に振る
+	/// </summary>
+	/// <param name="vertices">頂点配列の先頭</param>
+	/// <param name="vertexCount">頂点数</param>
+	/// <param name="vertexSize">頂点1個のサイズ（バイト。パディングを含まないこと）</param>
+	/// <param name="remap">元の頂点番号から新しい頂点番号への対応表（出力）</param>
+	/// <returns>まとめた後の頂点数</returns>
+	static uint32_t GenerateVertexRemap(
+	    const void* vertices, uint32_t vertexCount, size_t vertexSize,
+	    std::vector<uint32_t>& remap);
+
+	/// <summary>
+	/// 頂点キャッシュの再利用が増えるよう三角形を並べ替える（Forsythの手法）
+	/// </summary>
+	/// <param name="indices">三角形リストのインデックス（書き換える）</param>
+	/// <param name="indexCount">インデックス数</param>
+	/// <param name="vertexCount">頂点数</param>
+	static void OptimizeVertexCache(uint32_t* indices, size_t indexCount, uint32_t vertexCount);
+
+	/// <summary>
+	/// 外側を向いた三角形の塊が先に描かれるよう並べ替える（Tipsifyのクラスタ整列）
+	/// OptimizeVertexCacheの後に呼ぶ。ACMRの悪化はthreshold倍までに抑える
+	/// </summary>
+	/// <param name="indices">三角形リストのインデックス（書き換える）</param>
+	/// <param name="indexCount">インデックス数</param>
+	/// <param name="positions">頂点座標の先頭</param>
+	/// <param name="positionStride">頂点座標のストライド（バイト）</param>
+	/// <param name="vertexCount">頂点数</param>
+	/// <param name="threshold">許容するACMRの悪化率</param>
+	static void OptimizeOverdraw(
+	    uint32_t* indices, size_t indexCount, const Vector3* positions, size_t positionStride,
+	    uint32_t vertexCount, float threshold = kDefaultOverdrawThreshold);
+
+	/// <summary>
+	/// 頂点を最初に使われる順に並べ替える。インデックスは新しい番号に書き換える
+	/// 使われていない頂点は末尾に元の順で並べる
+	/// </summary>
+	/// <param name="indices">三角形リストのインデックス（書き換える）</param>
+	/// <param name="indexCount">インデックス数</param>
+	/// <param name="vertexCount">頂点数</param>
+	/// <returns>元の頂点番号から新しい頂点番号への対応表</returns>
+	static std::vector<uint32_t>
+	    OptimizeVertexFetch(uint32_t* indices, size_t indexCount, uint32_t vertexCount);
+
+	/// <summary>
+	/// 頂点キャッシュをシミュレートして統計を取る
+	/// </summary>
+	/// <param name="indices">三角形リストのインデックス</param>
+	/// <param name="indexCount">インデックス数</param>
+	/// <param name="vertexCount">頂点数</param>
+	/// <param name="cacheSize">キャッシュサイズ</param>
+	/// <returns>統計</returns>
+	static VertexCacheStatistics AnalyzeVertexCache(
+	    const uint32_t* indices, size_t indexCount, uint32_t vertexCount,
+	    uint32_t cacheSize = kCacheSize);
+};
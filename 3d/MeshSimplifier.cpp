@@ -0,0 +1,361 @@
+﻿#include "MeshSimplifier.h"
+#include "MathUtility.h"
+#include "VertexMath.h"
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+#include <numeric>
+#include <queue>
+
+namespace {
+
+// 座標の辞書順比較
+bool LessPosition(const Vector3& a, const Vector3& b) {
+	if (a.x != b.x) {
+		return a.x < b.x;
+	}
+	if (a.y != b.y) {
+		return a.y < b.y;
+	}
+	return a.z < b.z;
+}
+
+bool EqualPosition(const Vector3& a, const Vector3& b) {
+	return a.x == b.x && a.y == b.y && a.z == b.z;
+}
+
+} // namespace
+
+MeshSimplifier::Result MeshSimplifier::Simplify(
+  const VertexInput& vertices, const uint32_t* indices, size_t indexCount,
+  size_t targetIndexCount, float targetError) {
+	assert(vertices.positions);
+	assert(indexCount % 3 == 0);
+
+	const uint32_t vertexCount = vertices.vertexCount;
+	const uint32_t triangleCount = static_cast<uint32_t>(indexCount / 3);
+	auto position = [&vertices](uint32_t index) -> const Vector3& {
+		return At(vertices.positions, vertices.positionStride, index);
+	};
+
+	// 同じ座標の頂点をまとめる（OBJは面の頂点毎に複製されているため）
+	// 座標順に並べ、グループ先頭の番号を代表とする
+	std::vector<uint32_t> sortedVertices(vertexCount);
+	std::iota(sortedVertices.begin(), sortedVertices.end(), 0);
+	std::sort(sortedVertices.begin(), sortedVertices.end(), [&](uint32_t a, uint32_t b) {
+		if (LessPosition(position(a), position(b))) {
+			return true;
+		}
+		if (LessPosition(position(b), position(a))) {
+			return false;
+		}
+		return a < b;
+	});
+	std::vector<uint32_t> canonical(vertexCount);
+	std::vector<uint32_t> groupBegin(vertexCount, 0);
+	std::vector<uint32_t> groupSize(vertexCount, 0);
+	for (uint32_t i = 0; i < vertexCount;) {
+		uint32_t first = sortedVertices[i];
+		uint32_t end = i;
+		while (end < vertexCount && EqualPosition(position(sortedVertices[end]), position(first))) {
+			canonical[sortedVertices[end]] = first;
+			end++;
+		}
+		groupBegin[first] = i;
+		groupSize[first] = end - i;
+		i = end;
+	}
+
+	// 代表頂点で表した三角形
+	std::vector<uint32_t> triangles(indexCount);
+	for (size_t i = 0; i < indexCount; i++) {
+		assert(indices[i] < vertexCount);
+		triangles[i] = canonical[indices[i]];
+	}
+	std::vector<uint8_t> triangleAlive(triangleCount, 1);
+	uint32_t aliveTriangleCount = 0;
+	for (uint32_t t = 0; t < triangleCount; t++) {
+		uint32_t* corner = &triangles[t * 3];
+		if (corner[0] == corner[1] || corner[1] == corner[2] || corner[2] == corner[0]) {
+			triangleAlive[t] = 0;
+		} else {
+			aliveTriangleCount++;
+		}
+	}
+
+	// 面の二次誤差（面積で重み付け）
+	std::vector<Quadric> quadrics(vertexCount, Quadric{});
+	std::vector<std::vector<uint32_t>> vertexTriangles(vertexCount);
+	for (uint32_t t = 0; t < triangleCount; t++) {
+		if (!triangleAlive[t]) {
+			continue;
+		}
+		const uint32_t* corner = &triangles[t * 3];
+		const Vector3& p0 = position(corner[0]);
+		Vector3 cross = Cross(Subtract(position(corner[1]), p0), Subtract(position(corner[2]), p0));
+		float length = Length(cross);
+		if (length > 0.0f) {
+			Vector3 normal = Multiply(1.0f / length, cross);
+			Quadric quadric = MakeQuadric(normal, -Dot(normal, p0), length * 0.5f);
+			for (int i = 0; i < 3; i++) {
+				AddQuadric(quadrics[corner[i]], quadric);
+			}
+		}
+		for (int i = 0; i < 3; i++) {
+			vertexTriangles[corner[i]].push_back(t);
+		}
+	}
+
+	// 辺の一覧（小さい番号, 大きい番号, 三角形）を作り、境界の辺を探す
+	struct Edge {
+		uint32_t a;
+		uint32_t b;
+		uint32_t triangle;
+	};
+	std::vector<Edge> edges;
+	edges.reserve(static_cast<size_t>(aliveTriangleCount) * 3);
+	for (uint32_t t = 0; t < triangleCount; t++) {
+		if (!triangleAlive[t]) {
+			continue;
+		}
+		const uint32_t* corner = &triangles[t * 3];
+		for (int i = 0; i < 3; i++) {
+			uint32_t a = corner[i];
+			uint32_t b = corner[(i + 1) % 3];
+			edges.push_back({(std::min)(a, b), (std::max)(a, b), t});
+		}
+	}
+	std::sort(edges.begin(), edges.end(), [](const Edge& lhs, const Edge& rhs) {
+		if (lhs.a != rhs.a) {
+			return lhs.a < rhs.a;
+		}
+		if (lhs.b != rhs.b) {
+			return lhs.b < rhs.b;
+		}
+		return lhs.triangle < rhs.triangle;
+	});
+	for (size_t i = 0; i < edges.size();) {
+		size_t end = i;
+		while (end < edges.size() && edges[end].a == edges[i].a && edges[end].b == edges[i].b) {
+			end++;
+		}
+		// 1枚の面にしか使われていない辺は、辺を含み面に垂直な平面で縛る
+		if (end - i == 1) {
+			const uint32_t* corner = &triangles[edges[i].triangle * 3];
+			const Vector3& p0 = position(corner[0]);
+			Vector3 faceNormal = Normalize(
+			  Cross(Subtract(position(corner[1]), p0), Subtract(position(corner[2]), p0)));
+			const Vector3& a = position(edges[i].a);
+			Vector3 edge = Subtract(position(edges[i].b), a);
+			Vector3 normal = Normalize(Cross(edge, faceNormal));
+			Quadric quadric =
+			  MakeQuadric(normal, -Dot(normal, a), kBoundaryWeight * Dot(edge, edge));
+			AddQuadric(quadrics[edges[i].a], quadric);
+			AddQuadric(quadrics[edges[i].b], quadric);
+		}
+		i = end;
+	}
+
+	// 縮約候補。コストが同じなら番号順にして結果を決定的にする
+	auto greater = [](const Collapse& lhs, const Collapse& rhs) {
+		if (lhs.cost != rhs.cost) {
+			return lhs.cost > rhs.cost;
+		}
+		if (lhs.from != rhs.from) {
+			return lhs.from > rhs.from;
+		}
+		return lhs.to > rhs.to;
+	};
+	std::priority_queue<Collapse, std::vector<Collapse>, decltype(greater)> heap(greater);
+	std::vector<uint32_t> versions(vertexCount, 0);
+	auto pushCollapse = [&](uint32_t a, uint32_t b) {
+		Quadric quadric = quadrics[a];
+		AddQuadric(quadric, quadrics[b]);
+		// 既存の頂点に寄せる（インデックスだけで表せるように）
+		double costToB = EvaluateQuadric(quadric, position(b));
+		double costToA = EvaluateQuadric(quadric, position(a));
+		if (costToB <= costToA) {
+			heap.push({costToB, a, b, versions[a], versions[b]});
+		} else {
+			heap.push({costToA, b, a, versions[b], versions[a]});
+		}
+	};
+	for (size_t i = 0; i < edges.size(); i++) {
+		if (i > 0 && edges[i].a == edges[i - 1].a && edges[i].b == edges[i - 1].b) {
+			continue;
+		}
+		pushCollapse(edges[i].a, edges[i].b);
+	}
+
+	// コストの小さい順に縮約する
+	const double maxCost = static_cast<double>(targetError) * targetError;
+	const uint32_t targetTriangleCount = static_cast<uint32_t>(targetIndexCount / 3);
+	std::vector<uint8_t> vertexAlive(vertexCount, 1);
+	std::vector<uint32_t> neighbors;
+	double resultCost = 0.0;
+	while (aliveTriangleCount > targetTriangleCount && !heap.empty()) {
+		Collapse collapse = heap.top();
+		heap.pop();
+		uint32_t from = collapse.from;
+		uint32_t to = collapse.to;
+		// 古い候補
+		if (!vertexAlive[from] || !vertexAlive[to] || versions[from] != collapse.fromVersion ||
+		    versions[to] != collapse.toVersion) {
+			continue;
+		}
+		if (collapse.cost > maxCost) {
+			break;
+		}
+
+		// 面が裏返るなら縮約しない
+		bool flipped = false;
+		for (uint32_t t : vertexTriangles[from]) {
+			if (!triangleAlive[t]) {
+				continue;
+			}
+			const uint32_t* corner = &triangles[t * 3];
+			if (corner[0] == to || corner[1] == to || corner[2] == to) {
+				continue;
+			}
+			Vector3 p[3], q[3];
+			for (int i = 0; i < 3; i++) {
+				p[i] = position(corner[i]);
+				q[i] = corner[i] == from ? position(to) : p[i];
+			}
+			Vector3 before = Cross(Subtract(p[1], p[0]), Subtract(p[2], p[0]));
+			Vector3 after = Cross(Subtract(q[1], q[0]), Subtract(q[2], q[0]));
+			if (Dot(before, after) <= 0.0f) {
+				flipped = true;
+				break;
+			}
+		}
+		if (flipped) {
+			continue;
+		}
+
+		// fromをtoに付け替え、両方を含む面は消す
+		vertexAlive[from] = 0;
+		AddQuadric(quadrics[to], quadrics[from]);
+		versions[to]++;
+		resultCost = (std::max)(resultCost, collapse.cost);
+		for (uint32_t t : vertexTriangles[from]) {
+			if (!triangleAlive[t]) {
+				continue;
+			}
+			uint32_t* corner = &triangles[t * 3];
+			if (corner[0] == to || corner[1] == to || corner[2] == to) {
+				triangleAlive[t] = 0;
+				aliveTriangleCount--;
+				continue;
+			}
+			for (int i = 0; i < 3; i++) {
+				if (corner[i] == from) {
+					corner[i] = to;
+				}
+			}
+			vertexTriangles[to].push_back(t);
+		}
+		vertexTriangles[from].clear();
+
+		// toの面リストを整理し、隣接頂点との候補を作り直す
+		std::vector<uint32_t>& toTriangles = vertexTriangles[to];
+		toTriangles.erase(
+		  std::remove_if(
+		    toTriangles.begin(), toTriangles.end(), [&](uint32_t t) { return !triangleAlive[t]; }),
+		  toTriangles.end());
+		neighbors.clear();
+		for (uint32_t t : toTriangles) {
+			for (int i = 0; i < 3; i++) {
+				if (triangles[t * 3 + i] != to) {
+					neighbors.push_back(triangles[t * 3 + i]);
+				}
+			}
+		}
+		std::sort(neighbors.begin(), neighbors.end());
+		neighbors.erase(std::unique(neighbors.begin(), neighbors.end()), neighbors.end());
+		for (uint32_t neighbor : neighbors) {
+			pushCollapse(neighbor, to);
+		}
+	}
+
+	// 代表頂点を元の頂点に戻す。移動した角は移動先の座標の頂点のうち
+	// 法線・UVが最も近いものを使う（同点なら番号の小さいもの）
+	auto attributeDistance = [&vertices](uint32_t a, uint32_t b) {
+		float distance = 0.0f;
+		if (vertices.normals) {
+			distance += 1.0f - Dot(
+			                     At(vertices.normals, vertices.normalStride, a),
+			                     At(vertices.normals, vertices.normalStride, b));
+		}
+		if (vertices.uvs) {
+			const Vector2& uvA = At(vertices.uvs, vertices.uvStride, a);
+			const Vector2& uvB = At(vertices.uvs, vertices.uvStride, b);
+			float du = uvA.x - uvB.x;
+			float dv = uvA.y - uvB.y;
+			distance += du * du + dv * dv;
+		}
+		return distance;
+	};
+
+	Result result;
+	result.indices.reserve(static_cast<size_t>(aliveTriangleCount) * 3);
+	for (uint32_t t = 0; t < triangleCount; t++) {
+		if (!triangleAlive[t]) {
+			continue;
+		}
+		for (int i = 0; i < 3; i++) {
+			uint32_t original = indices[t * 3 + i];
+			uint32_t target = triangles[t * 3 + i];
+			if (canonical[original] == target) {
+				result.indices.push_back(original);
+				continue;
+			}
+			uint32_t best = target;
+			float bestDistance = FLT_MAX;
+			for (uint32_t j = 0; j < groupSize[target]; j++) {
+				uint32_t candidate = sortedVertices[groupBegin[target] + j];
+				float distance = attributeDistance(original, candidate);
+				if (distance < bestDistance) {
+					bestDistance = distance;
+					best = candidate;
+				}
+			}
+			result.indices.push_back(best);
+		}
+	}
+	result.error = static_cast<float>(std::sqrt(resultCost));
+	return result;
+}
+
+MeshSimplifier::Quadric
+  MeshSimplifier::MakeQuadric(const Vector3& normal, float distance, float weight) {
+	double x = normal.x, y = normal.y, z = normal.z, d = distance, w = weight;
+	return {w * x * x, w * x * y, w * x * z, w * y * y, w * y * z, w * z * z,
+	        w * x * d, w * y * d, w * z * d, w * d * d, w};
+}
+
+void MeshSimplifier::AddQuadric(Quadric& quadric, const Quadric& other) {
+	quadric.a00 += other.a00;
+	quadric.a01 += other.a01;
+	quadric.a02 += other.a02;
+	quadric.a11 += other.a11;
+	quadric.a12 += other.a12;
+	quadric.a22 += other.a22;
+	quadric.b0 += other.b0;
+	quadric.b1 += other.b1;
+	quadric.b2 += other.b2;
+	quadric.c += other.c;
+	quadric.weight += other.weight;
+}
+
+double MeshSimplifier::EvaluateQuadric(const Quadric& quadric, const Vector3& point) {
+	if (quadric.weight <= 0.0) {
+		return 0.0;
+	}
+	double x = point.x, y = point.y, z = point.z;
+	double error = quadric.a00 * x * x + 2.0 * quadric.a01 * x * y + 2.0 * quadric.a02 * x * z +
+	               quadric.a11 * y * y + 2.0 * quadric.a12 * y * z + quadric.a22 * z * z +
+	               2.0 * (quadric.b0 * x + quadric.b1 * y + quadric.b2 * z) + quadric.c;
+	// 丸め誤差で負になることがある
+	return (std::max)(error, 0.0) / quadric.weight;
+}
@@ -0,0 +1,84 @@
+#pragma once
+
+#include "Vector2.h"
+#include "Vector3.h"
+#include <cfloat>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+/// <summary>
+/// メッシュ簡略化（二次誤差メトリクスによる辺の縮約）
+/// 頂点バッファは共有し、インデックスだけを作り直す。結果は入力が同じなら常に同じ
+/// </summary>
+class MeshSimplifier {
+public: // 定数
+	// 境界の辺を保つための重み
+	static constexpr float kBoundaryWeight = 10.0f;
+
+public: // サブクラス
+	// 頂点データ（任意のストライドの配列を指す。normals,uvsはnullptr可）
+	struct VertexInput {
+		const Vector3* positions = nullptr;
+		size_t positionStride = sizeof(Vector3);
+		const Vector3* normals = nullptr;
+		size_t normalStride = sizeof(Vector3);
+		const Vector2* uvs = nullptr;
+		size_t uvStride = sizeof(Vector2);
+		uint32_t vertexCount = 0;
+	};
+
+	// 簡略化の結果
+	struct Result {
+		std::vector<uint32_t> indices; // 三角形リストのインデックス
+		float error = 0.0f;            // 幾何誤差（元の面からの距離の目安。モデル座標系）
+	};
+
+public: // 静的メンバ関数
+	/// <summary>
+	/// 簡略化
+	/// </summary>
+	/// <param name="vertices">頂点データ</param>
+	/// <param name="indices">三角形リストのインデックス</param>
+	/// <param name="indexCount">インデックス数</param>
+	/// <param name="targetIndexCount">目標のインデックス数</param>
+	/// <param name="targetError">許容する幾何誤差（超える縮約は行わない）</param>
+	/// <returns>結果</returns>
+	static Result Simplify(
+	    const VertexInput& vertices, const uint32_t* indices, size_t indexCount,
+	    size_t targetIndexCount, float targetError = FLT_MAX);
+
+private: // サブクラス
+	// 二次誤差（対称4x4行列の10要素と重みの合計）
+	struct Quadric {
+		double a00, a01, a02, a11, a12, a22;
+		double b0, b1, b2;
+		double c;
+		double weight;
+	};
+
+	// 縮約候補
+	struct Collapse {
+		double cost;
+		uint32_t from;
+		uint32_t to;
+		uint32_t fromVersion;
+		uint32_t toVersion;
+	};
+
+private: // 静的メンバ関数
+	/// <summary>
+	/// 平面から二次誤差を作る
+	/// </summary>
+	static Quadric MakeQuadric(const Vector3& normal, float distance, float weight);
+
+	/// <summary>
+	/// 二次誤差を足し合わせる
+	/// </summary>
+	static void AddQuadric(Quadric& quadric, const Quadric& other);
+
+	/// <summary>
+	/// 点での誤差（重みで割った距離の二乗の平均）
+	/// </summary>
+	static double EvaluateQuadric(const Quadric& quadric, const Vector3& point);
+};
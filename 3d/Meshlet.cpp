@@ -0,0 +1,165 @@
+﻿#include "Meshlet.h"
+#include "MathUtility.h"
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+
+namespace {
+
+// メッシュレットの境界球と法線コーンを求める
+void CalculateMeshletBounds(
+  Meshlet& meshlet, const uint32_t* indices, const std::vector<uint32_t>& vertices,
+  const Vector3* positions, size_t positionStride) {
+	auto position = [positions, positionStride](uint32_t index) -> const Vector3& {
+		return *reinterpret_cast<const Vector3*>(
+		  reinterpret_cast<const uint8_t*>(positions) + positionStride * index);
+	};
+
+	// 境界球はAABBの中心から最も遠い頂点までを半径とする
+	Vector3 min = position(vertices[0]);
+	Vector3 max = min;
+	for (uint32_t v : vertices) {
+		min = Min(min, position(v));
+		max = Max(max, position(v));
+	}
+	meshlet.bounds.center = Multiply(0.5f, Add(min, max));
+	float radiusSq = 0.0f;
+	for (uint32_t v : vertices) {
+		Vector3 diff = Subtract(position(v), meshlet.bounds.center);
+		radiusSq = (std::max)(radiusSq, Dot(diff, diff));
+	}
+	meshlet.bounds.radius = std::sqrt(radiusSq);
+
+	// 法線コーンの軸は面の向きの平均、広がりは軸から最も離れた面で決める
+	const uint32_t* triangles = indices + meshlet.indexOffset;
+	Vector3 normalSum = {0.0f, 0.0f, 0.0f};
+	for (uint32_t t = 0; t < meshlet.triangleCount; t++) {
+		const Vector3& p0 = position(triangles[t * 3]);
+		Vector3 cross = Cross(
+		  Subtract(position(triangles[t * 3 + 1]), p0),
+		  Subtract(position(triangles[t * 3 + 2]), p0));
+		float length = Length(cross);
+		if (length > 0.0f) {
+			normalSum = Add(normalSum, Multiply(1.0f / length, cross));
+		}
+	}
+	meshlet.coneAxis = {0.0f, 0.0f, 0.0f};
+	meshlet.coneCutoff = 1.0f;
+	float axisLength = Length(normalSum);
+	if (axisLength <= 0.0f) {
+		return;
+	}
+	Vector3 axis = Multiply(1.0f / axisLength, normalSum);
+	float minDot = 1.0f;
+	for (uint32_t t = 0; t < meshlet.triangleCount; t++) {
+		const Vector3& p0 = position(triangles[t * 3]);
+		Vector3 cross = Cross(
+		  Subtract(position(triangles[t * 3 + 1]), p0),
+		  Subtract(position(triangles[t * 3 + 2]), p0));
+		float length = Length(cross);
+		if (length > 0.0f) {
+			minDot = (std::min)(minDot, Dot(axis, cross) / length);
+		}
+	}
+	meshlet.coneAxis = axis;
+	// 半球以上に広がっていると全面が裏を向く方向はない
+	if (minDot > 0.0f) {
+		meshlet.coneCutoff = std::sqrt(1.0f - minDot * minDot);
+	}
+}
+
+} // namespace
+
+std::vector<Meshlet> BuildMeshlets(
+  const uint32_t* indices, size_t indexCount, const Vector3* positions, size_t positionStride,
+  uint32_t vertexCount, uint32_t maxVertices, uint32_t maxTriangles) {
+	assert(indexCount % 3 == 0);
+	assert(maxVertices >= 3 && maxTriangles >= 1);
+
+	std::vector<Meshlet> meshlets;
+	if (indexCount == 0) {
+		return meshlets;
+	}
+
+	// 頂点毎に、最後に数えたメッシュレットの番号を持つ
+	const uint32_t kNone = UINT32_MAX;
+	std::vector<uint32_t> owner(vertexCount, kNone);
+	std::vector<uint32_t> vertices;
+	vertices.reserve(maxVertices);
+	Meshlet current = {};
+
+	auto finish = [&]() {
+		current.vertexCount = static_cast<uint32_t>(vertices.size());
+		CalculateMeshletBounds(current, indices, vertices, positions, positionStride);
+		meshlets.push_back(current);
+	};
+
+	const uint32_t triangleCount = static_cast<uint32_t>(indexCount / 3);
+	for (uint32_t t = 0; t < triangleCount; t++) {
+		const uint32_t* corner = &indices[t * 3];
+		const uint32_t meshletIndex = static_cast<uint32_t>(meshlets.size());
+		uint32_t newVertices = 0;
+		for (int i = 0; i < 3; i++) {
+			assert(corner[i] < vertexCount);
+			bool duplicate =
+			  (i > 0 && corner[i] == corner[0]) || (i > 1 && corner[i] == corner[1]);
+			if (owner[corner[i]] != meshletIndex && !duplicate) {
+				newVertices++;
+			}
+		}
+
+		// 上限を超えるなら新しいメッシュレットを始める
+		if (current.triangleCount + 1 > maxTriangles ||
+		    vertices.size() + newVertices > maxVertices) {
+			finish();
+			current = {};
+			current.indexOffset = t * 3;
+			vertices.clear();
+		}
+
+		const uint32_t index = static_cast<uint32_t>(meshlets.size());
+		for (int i = 0; i < 3; i++) {
+			if (owner[corner[i]] != index) {
+				owner[corner[i]] = index;
+				vertices.push_back(corner[i]);
+			}
+		}
+		current.triangleCount++;
+	}
+	finish();
+
+	return meshlets;
+}
+
+uint32_t CullMeshlets(
+  const Meshlet* meshlets, size_t count, const Frustum& frustum, const Vector3& cameraPosition,
+  std::vector<IndexRange>& ranges) {
+	ranges.clear();
+	uint32_t visibleCount = 0;
+	for (size_t i = 0; i < count; i++) {
+		const Meshlet& meshlet = meshlets[i];
+		if (!IsVisible(frustum, meshlet.bounds)) {
+			continue;
+		}
+
+		// 境界球のどこから見ても全ての面が裏を向いているなら描かない
+		if (meshlet.coneCutoff < 1.0f) {
+			Vector3 toCenter = Subtract(meshlet.bounds.center, cameraPosition);
+			if (Dot(toCenter, meshlet.coneAxis) >=
+			    meshlet.coneCutoff * Length(toCenter) + meshlet.bounds.radius) {
+				continue;
+			}
+		}
+
+		// 直前の範囲と続いていればまとめる
+		uint32_t indexCount = meshlet.triangleCount * 3;
+		if (!ranges.empty() &&
+		    ranges.back().indexOffset + ranges.back().indexCount == meshlet.indexOffset) {
+			ranges.back().indexCount += indexCount;
+		} else {
+			ranges.push_back({meshlet.indexOffset, indexCount});
+		}
+		visibleCount++;
+	}
+	return visibleCount;
+}
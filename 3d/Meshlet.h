@@ -0,0 +1,62 @@
+#pragma once
+
+#include "Culling.h"
+#include "Vector3.h"
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+/// <summary>
+/// メッシュレット（三角形の小さな塊）。インデックス配列の連続した範囲を指す
+/// </summary>
+struct Meshlet {
+	uint32_t indexOffset;   // インデックス配列内の開始位置
+	uint32_t triangleCount; // 三角形数
+	uint32_t vertexCount;   // 使っている頂点数
+	Sphere bounds;          // 境界球（ローカル座標系）
+	Vector3 coneAxis;       // 法線コーンの軸（面の向きの平均）
+	float coneCutoff;       // 法線コーンの広がりの正弦。1なら背面カリングできない
+};
+
+/// <summary>
+/// 描画するインデックスの範囲
+/// </summary>
+struct IndexRange {
+	uint32_t indexOffset; // 開始位置
+	uint32_t indexCount;  // インデックス数
+};
+
+// メッシュレット1個あたりの上限
+const uint32_t kMeshletMaxVertices = 64;
+const uint32_t kMeshletMaxTriangles = 124;
+
+/// <summary>
+/// 三角形を先頭から順に詰めてメッシュレットに分ける
+/// 頂点キャッシュ最適化済みの順序なら空間的にまとまった塊になる
+/// </summary>
+/// <param name="indices">三角形リストのインデックス</param>
+/// <param name="indexCount">インデックス数</param>
+/// <param name="positions">頂点座標の先頭</param>
+/// <param name="positionStride">頂点座標のストライド（バイト）</param>
+/// <param name="vertexCount">頂点数</param>
+/// <param name="maxVertices">メッシュレット1個の最大頂点数</param>
+/// <param name="maxTriangles">メッシュレット1個の最大三角形数</param>
+/// <returns>メッシュレット一覧（インデックス順）</returns>
+std::vector<Meshlet> BuildMeshlets(
+    const uint32_t* indices, size_t indexCount, const Vector3* positions, size_t positionStride,
+    uint32_t vertexCount, uint32_t maxVertices = kMeshletMaxVertices,
+    uint32_t maxTriangles = kMeshletMaxTriangles);
+
+/// <summary>
+/// メッシュレットを視錐台と法線コーンで判定し、見える範囲をまとめて出力する
+/// 視錐台とカメラ座標はメッシュのローカル座標系で渡す
+/// </summary>
+/// <param name="meshlets">メッシュレットの先頭</param>
+/// <param name="count">メッシュレット数</param>
+/// <param name="frustum">ローカル座標系の視錐台</param>
+/// <param name="cameraPosition">ローカル座標系のカメラ座標</param>
+/// <param name="ranges">見えるインデックス範囲（隣り合うものは1つにまとめる）</param>
+/// <returns>見えるメッシュレット数</returns>
+uint32_t CullMeshlets(
+    const Meshlet* meshlets, size_t count, const Frustum& frustum, const Vector3& cameraPosition,
+    std::vector<IndexRange>& ranges);
@@ -1,7 +1,11 @@
 ﻿#include "DirectXCommon.h"
+#include "MaterialBuffer.h"
+#include "MathUtility.h"
 #include "Model.h"
+#include "WinApp.h"
 #include <algorithm>
 #include <cassert>
+#include <cstdio>
 #include <d3dcompiler.h>
 #include <fstream>
 #include <sstream>
@@ -20,10 +24,76 @@ UINT Model::sDescriptorHandleIncrementSize_ = 0;
 ID3D12GraphicsCommandList* Model::sCommandList_ = nullptr;
 ComPtr<ID3D12RootSignature> Model::sRootSignature_;
 ComPtr<ID3D12PipelineState> Model::sPipelineState_;
+ComPtr<ID3D12PipelineState> Model::sPipelineStateQuantized_;
+ComPtr<ID3D12PipelineState> Model::sPipelineStateNormalMap_;
+ComPtr<ID3D12PipelineState> Model::sPipelineStateShadow_;
+ComPtr<ID3D12PipelineState> Model::sPipelineStateShadowQuantized_;
+ID3D12PipelineState* Model::sBoundPipelineState_ = nullptr;
+bool Model::sShadowPass_ = false;
+uint32_t Model::sShadowCascade_ = 0;
+const ViewProjection* Model::sShadowViewProjection_ = nullptr;
+bool Model::sVertexQuantization_ = false;
 std::unique_ptr<LightGroup> Model::lightGroup;
+Model::DrawStatistics Model::sDrawStatistics_;
+const OcclusionCuller* Model::sOcclusionCuller_ = nullptr;
+const ViewProjection* Model::sOcclusionViewProjection_ = nullptr;
+float Model::sLodErrorThreshold_ = 1.0f;
+std::vector<IndexRange> Model::sMeshletRanges_;
+uint32_t Model::sLightView_ = UINT32_MAX;
+std::vector<Model::DrawRequest> Model::sDrawRequests_;
+FrustumCuller Model::sFrustumCuller_;
+
+namespace {
+
+// ビュー行列（回転＋平行移動）からカメラのワールド座標を求める
+Vector3 GetCameraPosition(const Matrix4x4& matView) {
+	const auto& m = matView.m;
+	return {
+	  -(m[3][0] * m[0][0] + m[3][1] * m[0][1] + m[3][2] * m[0][2]),
+	  -(m[3][0] * m[1][0] + m[3][1] * m[1][1] + m[3][2] * m[1][2]),
+	  -(m[3][0] * m[2][0] + m[3][1] * m[2][1] + m[3][2] * m[2][2])};
+}
+
+// ローカル→ビュー行列から、ローカル座標系でのカメラ座標を求める（拡大縮小を含んでも良い）
+Vector3 GetLocalCameraPosition(const Matrix4x4& matWorldView) {
+	const auto& m = matWorldView.m;
+	Vector3 row[3] = {
+	  {m[0][0], m[0][1], m[0][2]},
+	  {m[1][0], m[1][1], m[1][2]},
+	  {m[2][0], m[2][1], m[2][2]}
+	};
+	// p×(3x3部分) = -平行移動 をクラメルの公式で解く
+	Vector3 target = {-m[3][0], -m[3][1], -m[3][2]};
+	Vector3 cross12 = Cross(row[1], row[2]);
+	Vector3 cross20 = Cross(row[2], row[0]);
+	Vector3 cross01 = Cross(row[0], row[1]);
+	float determinant = Dot(row[0], cross12);
+	if (determinant == 0.0f) {
+		return {0.0f, 0.0f, 0.0f};
+	}
+	float inv = 1.0f / determinant;
+	return {Dot(target, cross12) * inv, Dot(target, cross20) * inv, Dot(target, cross01) * inv};
+}
+
+// フルパスからファイル名を取り出す
+std::string GetFileName(const std::string& path) {
+	size_t pos = path.find_last_of("\\/");
+	if (pos == std::string::npos) {
+		return path;
+	}
+	return path.substr(pos + 1);
+}
+
+} // namespace
 
 void Model::StaticInitialize() {
 
+	// マテリアルの構造化バッファ初期化
+	MaterialBuffer::GetInstance()->Initialize(DirectXCommon::GetInstance()->GetDevice());
+
+	// シャドウマップ初期化
+	ShadowMap::GetInstance()->Initialize(DirectXCommon::GetInstance()->GetDevice());
+
 	// パイプライン初期化
 	InitializeGraphicsPipeline();
 		
@@ -138,22 +208,42 @@ void Model::InitializeGraphicsPipeline() {
 	// デスクリプタレンジ
 	CD3DX12_DESCRIPTOR_RANGE descRangeSRV;
 	descRangeSRV.Init(D3D12_DESCRIPTOR_RANGE_TYPE_SRV, 1, 0); // t0 レジスタ
+	CD3DX12_DESCRIPTOR_RANGE descRangeNormalMap;
+	descRangeNormalMap.Init(D3D12_DESCRIPTOR_RANGE_TYPE_SRV, 1, 1); // t1 レジスタ
+	CD3DX12_DESCRIPTOR_RANGE descRangeShadowMap;
+	descRangeShadowMap.Init(D3D12_DESCRIPTOR_RANGE_TYPE_SRV, 1, 6); // t6 レジスタ
 
 	// ルートパラメータ
-	CD3DX12_ROOT_PARAMETER rootparams[5];
+	CD3DX12_ROOT_PARAMETER rootparams[13];
 	rootparams[0].InitAsConstantBufferView(0, 0, D3D12_SHADER_VISIBILITY_ALL);
 	rootparams[1].InitAsConstantBufferView(1, 0, D3D12_SHADER_VISIBILITY_ALL);
-	rootparams[2].InitAsConstantBufferView(2, 0, D3D12_SHADER_VISIBILITY_ALL);
+	rootparams[2].InitAsConstants(1, 2, 0, D3D12_SHADER_VISIBILITY_ALL);
 	rootparams[3].InitAsDescriptorTable(1, &descRangeSRV, D3D12_SHADER_VISIBILITY_ALL);
 	rootparams[4].InitAsConstantBufferView(3, 0, D3D12_SHADER_VISIBILITY_ALL);
+	rootparams[5].InitAsConstants(
+	  static_cast<UINT>(sizeof(VertexQuantizer::Range) / sizeof(float)), 4, 0,
+	  D3D12_SHADER_VISIBILITY_VERTEX);
+	rootparams[6].InitAsDescriptorTable(1, &descRangeNormalMap, D3D12_SHADER_VISIBILITY_PIXEL);
+	rootparams[7].InitAsShaderResourceView(2, 0, D3D12_SHADER_VISIBILITY_PIXEL);
+	rootparams[8].InitAsShaderResourceView(3, 0, D3D12_SHADER_VISIBILITY_PIXEL);
+	rootparams[9].InitAsShaderResourceView(4, 0, D3D12_SHADER_VISIBILITY_PIXEL);
+	rootparams[10].InitAsShaderResourceView(5, 0, D3D12_SHADER_VISIBILITY_PIXEL);
+	rootparams[11].InitAsConstantBufferView(5, 0, D3D12_SHADER_VISIBILITY_PIXEL);
+	rootparams[12].InitAsDescriptorTable(1, &descRangeShadowMap, D3D12_SHADER_VISIBILITY_PIXEL);
 
 	// スタティックサンプラー
-	CD3DX12_STATIC_SAMPLER_DESC samplerDesc = CD3DX12_STATIC_SAMPLER_DESC(0);
+	CD3DX12_STATIC_SAMPLER_DESC samplerDescs[2];
+	samplerDescs[0] = CD3DX12_STATIC_SAMPLER_DESC(0);
+	// シャドウマップ用（深度を比較して線形補間する）
+	samplerDescs[1] = CD3DX12_STATIC_SAMPLER_DESC(
+	  1, D3D12_FILTER_COMPARISON_MIN_MAG_LINEAR_MIP_POINT, D3D12_TEXTURE_ADDRESS_MODE_CLAMP,
+	  D3D12_TEXTURE_ADDRESS_MODE_CLAMP, D3D12_TEXTURE_ADDRESS_MODE_CLAMP, 0.0f, 1,
+	  D3D12_COMPARISON_FUNC_LESS_EQUAL);
 
 	// ルートシグネチャの設定
 	CD3DX12_VERSIONED_ROOT_SIGNATURE_DESC rootSignatureDesc;
 	rootSignatureDesc.Init_1_0(
-	  _countof(rootparams), rootparams, 1, &samplerDesc,
+	  _countof(rootparams), rootparams, _countof(samplerDescs), samplerDescs,
 	  D3D12_ROOT_SIGNATURE_FLAG_ALLOW_INPUT_ASSEMBLER_INPUT_LAYOUT);
 
 	ComPtr<ID3DBlob> rootSigBlob;
@@ -172,6 +262,147 @@ void Model::InitializeGraphicsPipeline() {
 	result = DirectXCommon::GetInstance()->GetDevice()->CreateGraphicsPipelineState(
 	  &gpipeline, IID_PPV_ARGS(&sPipelineState_));
 	assert(SUCCEEDED(result));
+
+	// 圧縮頂点用の頂点シェーダの読み込みとコンパイル
+	D3D_SHADER_MACRO quantizedDefines[] = {
+	  {"QUANTIZED_VERTEX", "1"},
+	  {nullptr,            nullptr},
+	};
+	ComPtr<ID3DBlob> quantizedVsBlob;
+	result = D3DCompileFromFile(
+	  L"Resources/shaders/ObjVS.hlsl", // シェーダファイル名
+	  quantizedDefines,
+	  D3D_COMPILE_STANDARD_FILE_INCLUDE, // インクルード可能にする
+	  "main", "vs_5_0", // エントリーポイント名、シェーダーモデル指定
+	  D3DCOMPILE_DEBUG | D3DCOMPILE_SKIP_OPTIMIZATION, // デバッグ用設定
+	  0, &quantizedVsBlob, &errorBlob);
+	if (FAILED(result)) {
+		// errorBlobからエラー内容をstring型にコピー
+		std::string errstr;
+		errstr.resize(errorBlob->GetBufferSize());
+
+		std::copy_n(
+		  (char*)errorBlob->GetBufferPointer(), errorBlob->GetBufferSize(), errstr.begin());
+		errstr += "\n";
+		// エラー内容を出力ウィンドウに表示
+		OutputDebugStringA(errstr.c_str());
+		exit(1);
+	}
+
+	// 圧縮頂点のレイアウト（VertexQuantizer::PackedVertex）
+	D3D12_INPUT_ELEMENT_DESC quantizedInputLayout[] = {
+	  {// xyz座標（AABB基準の正規化値）
+	   "POSITION", 0, DXGI_FORMAT_R16G16B16A16_UNORM, 0, D3D12_APPEND_ALIGNED_ELEMENT,
+	   D3D12_INPUT_CLASSIFICATION_PER_VERTEX_DATA, 0},
+	  {// 8面体写像した法線ベクトル
+	   "NORMAL",   0, DXGI_FORMAT_R16G16_SNORM,       0, D3D12_APPEND_ALIGNED_ELEMENT,
+	   D3D12_INPUT_CLASSIFICATION_PER_VERTEX_DATA, 0},
+	  {// uv座標（半精度）
+	   "TEXCOORD", 0, DXGI_FORMAT_R16G16_FLOAT,       0, D3D12_APPEND_ALIGNED_ELEMENT,
+	   D3D12_INPUT_CLASSIFICATION_PER_VERTEX_DATA, 0},
+	};
+
+	// 頂点シェーダと頂点レイアウト以外は共通
+	gpipeline.VS = CD3DX12_SHADER_BYTECODE(quantizedVsBlob.Get());
+	gpipeline.InputLayout.pInputElementDescs = quantizedInputLayout;
+	gpipeline.InputLayout.NumElements = _countof(quantizedInputLayout);
+	result = DirectXCommon::GetInstance()->GetDevice()->CreateGraphicsPipelineState(
+	  &gpipeline, IID_PPV_ARGS(&sPipelineStateQuantized_));
+	assert(SUCCEEDED(result));
+
+	// 法線マップ用のシェーダの読み込みとコンパイル
+	D3D_SHADER_MACRO normalMapDefines[] = {
+	  {"NORMAL_MAP", "1"},
+	  {nullptr,      nullptr},
+	};
+	ComPtr<ID3DBlob> normalMapVsBlob;
+	result = D3DCompileFromFile(
+	  L"Resources/shaders/ObjVS.hlsl", // シェーダファイル名
+	  normalMapDefines,
+	  D3D_COMPILE_STANDARD_FILE_INCLUDE, // インクルード可能にする
+	  "main", "vs_5_0", // エントリーポイント名、シェーダーモデル指定
+	  D3DCOMPILE_DEBUG | D3DCOMPILE_SKIP_OPTIMIZATION, // デバッグ用設定
+	  0, &normalMapVsBlob, &errorBlob);
+	if (FAILED(result)) {
+		// errorBlobからエラー内容をstring型にコピー
+		std::string errstr;
+		errstr.resize(errorBlob->GetBufferSize());
+
+		std::copy_n(
+		  (char*)errorBlob->GetBufferPointer(), errorBlob->GetBufferSize(), errstr.begin());
+		errstr += "\n";
+		// エラー内容を出力ウィンドウに表示
+		OutputDebugStringA(errstr.c_str());
+		exit(1);
+	}
+	ComPtr<ID3DBlob> normalMapPsBlob;
+	result = D3DCompileFromFile(
+	  L"Resources/shaders/ObjPS.hlsl", // シェーダファイル名
+	  normalMapDefines,
+	  D3D_COMPILE_STANDARD_FILE_INCLUDE, // インクルード可能にする
+	  "main", "ps_5_0", // エントリーポイント名、シェーダーモデル指定
+	  D3DCOMPILE_DEBUG | D3DCOMPILE_SKIP_OPTIMIZATION, // デバッグ用設定
+	  0, &normalMapPsBlob, &errorBlob);
+	if (FAILED(result)) {
+		// errorBlobからエラー内容をstring型にコピー
+		std::string errstr;
+		errstr.resize(errorBlob->GetBufferSize());
+
+		std::copy_n(
+		  (char*)errorBlob->GetBufferPointer(), errorBlob->GetBufferSize(), errstr.begin());
+		errstr += "\n";
+		// エラー内容を出力ウィンドウに表示
+		OutputDebugStringA(errstr.c_str());
+		exit(1);
+	}
+
+	// 接線付きの頂点レイアウト（Mesh::VertexPosNormalUvTangent）
+	D3D12_INPUT_ELEMENT_DESC normalMapInputLayout[] = {
+	  {// xyz座標
+	   "POSITION", 0, DXGI_FORMAT_R32G32B32_FLOAT,    0, D3D12_APPEND_ALIGNED_ELEMENT,
+	   D3D12_INPUT_CLASSIFICATION_PER_VERTEX_DATA, 0},
+	  {// 法線ベクトル
+	   "NORMAL",   0, DXGI_FORMAT_R32G32B32_FLOAT,    0, D3D12_APPEND_ALIGNED_ELEMENT,
+	   D3D12_INPUT_CLASSIFICATION_PER_VERTEX_DATA, 0},
+	  {// uv座標
+	   "TEXCOORD", 0, DXGI_FORMAT_R32G32_FLOAT,       0, D3D12_APPEND_ALIGNED_ELEMENT,
+	   D3D12_INPUT_CLASSIFICATION_PER_VERTEX_DATA, 0},
+	  {// 接線（wは従法線の向き）
+	   "TANGENT",  0, DXGI_FORMAT_R32G32B32A32_FLOAT, 0, D3D12_APPEND_ALIGNED_ELEMENT,
+	   D3D12_INPUT_CLASSIFICATION_PER_VERTEX_DATA, 0},
+	};
+
+	// シェーダと頂点レイアウト以外は共通
+	gpipeline.VS = CD3DX12_SHADER_BYTECODE(normalMapVsBlob.Get());
+	gpipeline.PS = CD3DX12_SHADER_BYTECODE(normalMapPsBlob.Get());
+	gpipeline.InputLayout.pInputElementDescs = normalMapInputLayout;
+	gpipeline.InputLayout.NumElements = _countof(normalMapInputLayout);
+	result = DirectXCommon::GetInstance()->GetDevice()->CreateGraphicsPipelineState(
+	  &gpipeline, IID_PPV_ARGS(&sPipelineStateNormalMap_));
+	assert(SUCCEEDED(result));
+
+	// シャドウマップの深度描画用（ピクセルシェーダと描画対象なし）
+	// 接線付きの頂点も先頭の並びは同じなので標準の頂点レイアウトで読める
+	gpipeline.VS = CD3DX12_SHADER_BYTECODE(vsBlob.Get());
+	gpipeline.PS = D3D12_SHADER_BYTECODE{};
+	gpipeline.InputLayout.pInputElementDescs = inputLayout;
+	gpipeline.InputLayout.NumElements = _countof(inputLayout);
+	gpipeline.NumRenderTargets = 0;
+	gpipeline.RTVFormats[0] = DXGI_FORMAT_UNKNOWN;
+	// ライトより手前の物も影を落とすよう、深度を切り取らずにクランプする
+	gpipeline.RasterizerState.DepthClipEnable = false;
+	// 自己遮蔽によるしま模様を防ぐ（一定量のずらしはシェーダーで法線方向に行う）
+	gpipeline.RasterizerState.SlopeScaledDepthBias = 2.0f;
+	result = DirectXCommon::GetInstance()->GetDevice()->CreateGraphicsPipelineState(
+	  &gpipeline, IID_PPV_ARGS(&sPipelineStateShadow_));
+	assert(SUCCEEDED(result));
+
+	gpipeline.VS = CD3DX12_SHADER_BYTECODE(quantizedVsBlob.Get());
+	gpipeline.InputLayout.pInputElementDescs = quantizedInputLayout;
+	gpipeline.InputLayout.NumElements = _countof(quantizedInputLayout);
+	result = DirectXCommon::GetInstance()->GetDevice()->CreateGraphicsPipelineState(
+	  &gpipeline, IID_PPV_ARGS(&sPipelineStateShadowQuantized_));
+	assert(SUCCEEDED(result));
 }
 
 Model* Model::Create() { 
@@ -199,17 +430,98 @@ void Model::PreDraw(ID3D12GraphicsCommandList* commandList) {
 
 	// パイプラインステートの設定
 	commandList->SetPipelineState(sPipelineState_.Get());
+	sBoundPipelineState_ = sPipelineState_.Get();
 	// ルートシグネチャの設定
 	commandList->SetGraphicsRootSignature(sRootSignature_.Get());
 	// プリミティブ形状を設定
 	commandList->IASetPrimitiveTopology(D3D_PRIMITIVE_TOPOLOGY_TRIANGLELIST);
+
+	// 変更のあったマテリアルだけを転送し、全マテリアルの構造化バッファを設定
+	MaterialBuffer* materialBuffer = MaterialBuffer::GetInstance();
+	materialBuffer->Flush();
+	commandList->SetGraphicsRootShaderResourceView(
+	  static_cast<UINT>(RoomParameter::kMaterialBuffer), materialBuffer->GetGPUVirtualAddress());
+
+	// 変更のあったライトだけを転送し、ライトのバッファをまとめて設定
+	// （カメラ毎の定数バッファとクラスタは最初の描画でセットする）
+	lightGroup->Update();
+	lightGroup->Draw(
+	  commandList, static_cast<UINT>(RoomParameter::kPointLights),
+	  static_cast<UINT>(RoomParameter::kSpotLights));
+	sLightView_ = UINT32_MAX;
+
+	// シャドウマップ
+	ShadowMap* shadowMap = ShadowMap::GetInstance();
+	commandList->SetGraphicsRootConstantBufferView(
+	  static_cast<UINT>(RoomParameter::kShadow), shadowMap->GetConstBufferAddress());
+	TextureManager::GetInstance()->SetGraphicsRootDescriptorTable(
+	  commandList, static_cast<UINT>(RoomParameter::kShadowMap), shadowMap->GetTextureHandle());
 }
 
 void Model::PostDraw() {
+	// 溜めた描画要求を判定して積む
+	FlushDrawRequests();
+
+	// コマンドリストを解除
+	sCommandList_ = nullptr;
+}
+
+void Model::PreDrawShadow(
+  ID3D12GraphicsCommandList* commandList, const ViewProjection& viewProjection) {
+	// PreDrawとPostDrawがペアで呼ばれていなければエラー
+	assert(Model::sCommandList_ == nullptr);
+
+	// コマンドリストをセット
+	sCommandList_ = commandList;
+	sShadowPass_ = true;
+	sShadowViewProjection_ = &viewProjection;
+
+	// 主光源のカスケードを求め、シャドウマップを描画対象にできる状態にする
+	ShadowMap* shadowMap = ShadowMap::GetInstance();
+	shadowMap->Update(viewProjection, lightGroup->GetDirLightDir(0));
+	shadowMap->Begin(commandList);
+
+	// パイプラインステートの設定
+	commandList->SetPipelineState(sPipelineStateShadow_.Get());
+	sBoundPipelineState_ = sPipelineStateShadow_.Get();
+	// ルートシグネチャの設定
+	commandList->SetGraphicsRootSignature(sRootSignature_.Get());
+	// プリミティブ形状を設定
+	commandList->IASetPrimitiveTopology(D3D_PRIMITIVE_TOPOLOGY_TRIANGLELIST);
+}
+
+uint32_t Model::GetShadowCascadeCount() {
+	ShadowMap* shadowMap = ShadowMap::GetInstance();
+	return shadowMap->IsEnabled() ? shadowMap->GetCascadeCount() : 0;
+}
+
+void Model::SetShadowCascade(uint32_t index) {
+	assert(sShadowPass_);
+	sShadowCascade_ = index;
+
+	// 描画対象をカスケードの1枚にして、ライト空間のビュープロジェクションを設定
+	ShadowMap* shadowMap = ShadowMap::GetInstance();
+	shadowMap->SetCascade(sCommandList_, index);
+	sCommandList_->SetGraphicsRootConstantBufferView(
+	  static_cast<UINT>(RoomParameter::kViewProjection),
+	  shadowMap->GetCascadeViewProjectionAddress(index));
+}
+
+void Model::PostDrawShadow() {
+	assert(sShadowPass_);
+
+	// シャドウマップを参照できる状態に戻し、描画対象をバックバッファに戻す
+	ShadowMap::GetInstance()->End(sCommandList_);
+	DirectXCommon::GetInstance()->SetRenderTarget();
+
 	// コマンドリストを解除
+	sShadowPass_ = false;
+	sShadowViewProjection_ = nullptr;
 	sCommandList_ = nullptr;
 }
 
+void Model::ResetDrawStatistics() { sDrawStatistics_ = {}; }
+
 Model::~Model() {
 	for (auto m : meshes_) {
 		delete m;
@@ -241,11 +553,31 @@ void Model::Initialize(const std::string& modelname, bool smoothing) {
 		}
 	}
 
-	// メッシュのバッファ生成
+	// メッシュ最適化、接線・メッシュレット・LODの生成、メッシュのバッファ生成
 	for (auto& m : meshes_) {
-		m->CreateBuffers();
+		m->Optimize();
+		if (m->GetMaterial()->HasNormalMap()) {
+			m->GenerateTangents();
+		}
+		m->GenerateMeshlets();
+		m->GenerateLods(kLodCount);
+		m->CreateBuffers(sVertexQuantization_);
+	}
+
+	// LOD毎の誤差はメッシュの中で最大のものを使う
+	lodErrors_.clear();
+	for (auto& m : meshes_) {
+		lodErrors_.resize((std::max)(lodErrors_.size(), m->GetLods().size()), 0.0f);
+	}
+	for (auto& m : meshes_) {
+		for (uint32_t level = 0; level < lodErrors_.size(); level++) {
+			lodErrors_[level] = (std::max)(lodErrors_[level], m->GetLod(level).error);
+		}
 	}
 
+	// 境界ボリュームの計算
+	CalculateBounds();
+
 	// マテリアルの数値を定数バッファに反映
 	for (auto& m : materials_) {
 		m.second->Update();
@@ -372,14 +704,15 @@ void Model::LoadModel(const std::string& modelname, bool smoothing) {
 			while (getline(line_stream, index_string, ' ')) {
 				// 頂点インデックス1個分の文字列をストリームに変換して解析しやすくする
 				std::istringstream index_stream(index_string);
-				unsigned short indexPosition, indexNormal, indexTexcoord;
+				uint32_t indexPosition, indexNormal, indexTexcoord;
 				// 頂点番号
 				index_stream >> indexPosition;
 
 				Material* material = mesh->GetMaterial();
 				index_stream.seekg(1, ios_base::cur); // スラッシュを飛ばす
-				// マテリアル、テクスチャがある場合
-				if (material && material->textureFilename_.size() > 0) {
+				// マテリアル、テクスチャ（法線マップを含む）がある場合
+				if (material &&
+				    (material->textureFilename_.size() > 0 || material->HasNormalMap())) {
 					index_stream >> indexTexcoord;
 					index_stream.seekg(1, ios_base::cur); // スラッシュを飛ばす
 					index_stream >> indexNormal;
@@ -392,7 +725,7 @@ void Model::LoadModel(const std::string& modelname, bool smoothing) {
 					// エッジ平滑化用のデータを追加
 					if (smoothing) {
 						mesh->AddSmoothData(
-						  indexPosition, (unsigned short)mesh->GetVertexCount() - 1);
+						  indexPosition, static_cast<uint32_t>(mesh->GetVertexCount() - 1));
 					}
 				} else {
 					char c;
@@ -419,7 +752,7 @@ void Model::LoadModel(const std::string& modelname, bool smoothing) {
 						// エッジ平滑化用のデータを追加
 						if (smoothing) {
 							mesh->AddSmoothData(
-							  indexPosition, (unsigned short)mesh->GetVertexCount() - 1);
+							  indexPosition, static_cast<uint32_t>(mesh->GetVertexCount() - 1));
 						}
 					}
 				}
@@ -512,17 +845,14 @@ void Model::LoadMaterial(const std::string& directoryPath, const std::string& fi
 			line_stream >> material->textureFilename_;
 
 			// フルパスからファイル名を取り出す
-			size_t pos1;
-			pos1 = material->textureFilename_.rfind('\\');
-			if (pos1 != string::npos) {
-				material->textureFilename_ = material->textureFilename_.substr(
-				  pos1 + 1, material->textureFilename_.size() - pos1 - 1);
-			}
-
-			pos1 = material->textureFilename_.rfind('/');
-			if (pos1 != string::npos) {
-				material->textureFilename_ = material->textureFilename_.substr(
-				  pos1 + 1, material->textureFilename_.size() - pos1 - 1);
+			material->textureFilename_ = GetFileName(material->textureFilename_);
+		}
+		// 先頭文字列がmap_Bump、bump、normなら法線マップのファイル名
+		if (key == "map_Bump" || key == "map_bump" || key == "bump" || key == "norm") {
+			// 「-bm 1.0」などのオプションが前に付くので最後の項目をファイル名とする
+			string token;
+			while (line_stream >> token) {
+				material->normalMapFilename_ = GetFileName(token);
 			}
 		}
 	}
@@ -562,11 +892,175 @@ void Model::LoadTextures() {
 	}
 }
 
+void Model::CalculateBounds() {
+	bool first = true;
+	AABB aabb{};
+	for (auto& m : meshes_) {
+		m->CalculateBounds();
+		if (m->GetVertexCount() == 0) {
+			continue;
+		}
+		// 全メッシュのAABBを合成する
+		if (first) {
+			aabb = m->GetAABB();
+			first = false;
+		} else {
+			aabb.min = Min(aabb.min, m->GetAABB().min);
+			aabb.max = Max(aabb.max, m->GetAABB().max);
+		}
+	}
+
+	boundingSphere_.center = Multiply(0.5f, Add(aabb.min, aabb.max));
+	boundingSphere_.radius = 0.0f;
+	for (auto& m : meshes_) {
+		if (m->GetVertexCount() == 0) {
+			continue;
+		}
+		// メッシュの境界球を包む半径
+		const Sphere& sphere = m->GetBoundingSphere();
+		float radius = Length(Subtract(sphere.center, boundingSphere_.center)) + sphere.radius;
+		boundingSphere_.radius = (std::max)(boundingSphere_.radius, radius);
+	}
+}
+
+bool Model::IsOccluded(
+  const WorldTransform& worldTransform, const ViewProjection& viewProjection) const {
+	// 深度は設定したカメラから描いたものなので、他のカメラの描画には使えない
+	if (!sOcclusionCuller_ || sOcclusionViewProjection_ != &viewProjection) {
+		return false;
+	}
+	// 境界球を包むAABBで判定する
+	Sphere sphere = TransformSphere(boundingSphere_, worldTransform.matWorld_);
+	Vector3 extent = {sphere.radius, sphere.radius, sphere.radius};
+	return !sOcclusionCuller_->IsVisible(
+	  {Subtract(sphere.center, extent), Add(sphere.center, extent)});
+}
+
+bool Model::IsMeshVisible(
+  const Mesh* mesh, const WorldTransform& worldTransform,
+  const ViewProjection& viewProjection) const {
+	// メッシュが1つならモデル単位の判定で十分
+	if (meshes_.size() <= 1) {
+		return true;
+	}
+	return ::IsVisible(
+	  viewProjection.frustum, TransformAABB(mesh->GetAABB(), worldTransform.matWorld_));
+}
+
+uint32_t Model::UpdateLod(
+  const WorldTransform& worldTransform, const ViewProjection& viewProjection) {
+	if (lodErrors_.size() <= 1) {
+		return 0;
+	}
+
+	// しばらく描かれていない組の状態を捨てる
+	uint64_t frame = DirectXCommon::GetInstance()->GetFrameCount();
+	if (frame - lodPruneFrame_ >= kLodStateLifetime) {
+		std::erase_if(lodStates_, [frame](const auto& entry) {
+			return frame - entry.second.lastFrame >= kLodStateLifetime;
+		});
+		lodPruneFrame_ = frame;
+	}
+	LodState& state = lodStates_.try_emplace({&worldTransform, &viewProjection}, LodState{0, 0})
+	                    .first->second;
+	state.lastFrame = frame;
+
+	// 境界球の表面までの距離で、1単位が画面上で何ピクセルになるかを求める
+	Sphere sphere = TransformSphere(boundingSphere_, worldTransform.matWorld_);
+	Vector3 cameraPosition = GetCameraPosition(viewProjection.matView);
+	float distance = Length(Subtract(sphere.center, cameraPosition)) - sphere.radius;
+	distance = (std::max)(distance, viewProjection.nearZ);
+	float pixelsPerUnit = viewProjection.matProjection.m[1][1] *
+	                      static_cast<float>(WinApp::kWindowHeight) * 0.5f / distance;
+	float scale = GetMaxScale(worldTransform.matWorld_);
+	auto projectedError = [&](uint32_t level) { return lodErrors_[level] * scale * pixelsPerUnit; };
+
+	uint32_t lastLevel = static_cast<uint32_t>(lodErrors_.size()) - 1;
+	uint32_t current = (std::min)(state.level, lastLevel);
+	uint32_t next = current;
+	if (projectedError(current) > sLodErrorThreshold_ * (1.0f + kLodHysteresis)) {
+		// 粗すぎるので閾値に収まるところまで細かくする
+		while (next > 0 && projectedError(next) > sLodErrorThreshold_) {
+			next--;
+		}
+	} else {
+		// 閾値より十分小さく収まる範囲で粗くする
+		while (next < lastLevel &&
+		       projectedError(next + 1) <= sLodErrorThreshold_ * (1.0f - kLodHysteresis)) {
+			next++;
+		}
+	}
+	state.level = next;
+	return next;
+}
+
 void Model::Draw(
   const WorldTransform& worldTransform, const ViewProjection& viewProjection) {
+	assert(sCommandList_ && !sShadowPass_);
+	sDrawRequests_.push_back({this, &worldTransform, &viewProjection, 0, false});
+}
+
+void Model::Draw(
+  const WorldTransform& worldTransform, const ViewProjection& viewProjection,
+  uint32_t textureHadle) {
+	assert(sCommandList_ && !sShadowPass_);
+	sDrawRequests_.push_back({this, &worldTransform, &viewProjection, textureHadle, true});
+}
+
+void Model::FlushDrawRequests() {
+	// 要求に出てきた順にカメラを並べる
+	std::vector<const ViewProjection*> views;
+	for (const DrawRequest& request : sDrawRequests_) {
+		if (std::find(views.begin(), views.end(), request.viewProjection) == views.end()) {
+			views.push_back(request.viewProjection);
+		}
+	}
+
+	for (const ViewProjection* viewProjection : views) {
+		// カメラの全要求のワールド境界球を溜め、描画を積む前にまとめてSIMDで判定する
+		sFrustumCuller_.Clear();
+		for (const DrawRequest& request : sDrawRequests_) {
+			if (request.viewProjection == viewProjection) {
+				sFrustumCuller_.AddSphere(TransformSphere(
+				  request.model->boundingSphere_, request.worldTransform->matWorld_));
+			}
+		}
+		sFrustumCuller_.Cull(viewProjection->frustum);
+		sDrawStatistics_.submittedModelCount += sFrustumCuller_.GetCount();
+		sDrawStatistics_.culledModelCount += sFrustumCuller_.GetCulledCount();
+
+		// 見えるものだけを積んだ順に描画する
+		uint32_t index = 0;
+		for (const DrawRequest& request : sDrawRequests_) {
+			if (request.viewProjection != viewProjection) {
+				continue;
+			}
+			if (sFrustumCuller_.IsVisible(index++)) {
+				request.model->Submit(request);
+			} else {
+				sDrawStatistics_.culledMeshCount +=
+				  static_cast<uint32_t>(request.model->meshes_.size());
+			}
+		}
+	}
+	sDrawRequests_.clear();
+}
+
+void Model::Submit(const DrawRequest& request) {
+	const WorldTransform& worldTransform = *request.worldTransform;
+	const ViewProjection& viewProjection = *request.viewProjection;
+
+	// 遮蔽物に隠れていれば何も積まない
+	if (IsOccluded(worldTransform, viewProjection)) {
+		sDrawStatistics_.occludedMeshCount += static_cast<uint32_t>(meshes_.size());
+		return;
+	}
+
+	// 画面上の大きさから描くLODを選ぶ
+	uint32_t lodLevel = UpdateLod(worldTransform, viewProjection);
 
-	// ライトの描画
-	lightGroup->Draw(sCommandList_, static_cast<UINT>(RoomParameter::kLight));
+	// カメラ用のライトの枠をセット（同じカメラが続く間は何もしない）
+	SetLightView(viewProjection);
 
 	// CBVをセット（ワールド行列）
 	sCommandList_->SetGraphicsRootConstantBufferView(
@@ -580,31 +1074,190 @@ void Model::Draw(
 
 	// 全メッシュを描画
 	for (auto& mesh : meshes_) {
-		mesh->Draw(sCommandList_, (UINT)RoomParameter::kMaterial, (UINT)RoomParameter::kTexture);
+		uint32_t textureHandle = request.overridesTexture
+		                           ? request.textureHandle
+		                           : mesh->GetMaterial()->GetTextureHadle();
+		DrawMesh(mesh, worldTransform, viewProjection, textureHandle, lodLevel);
 	}
 }
 
-void Model::Draw(
-  const WorldTransform& worldTransform, const ViewProjection& viewProjection,
-  uint32_t textureHadle) {
+void Model::DrawShadow(const WorldTransform& worldTransform) {
+	assert(sShadowPass_);
+	const ShadowCascade& cascade = ShadowMap::GetInstance()->GetCascade(sShadowCascade_);
 
-	// ライトの描画
-	lightGroup->Draw(sCommandList_, static_cast<UINT>(RoomParameter::kLight));
+	// カスケードに影を落とさなければ何も積まない
+	if (!IsShadowCaster(cascade, TransformSphere(boundingSphere_, worldTransform.matWorld_))) {
+		sDrawStatistics_.shadowCulledMeshCount += static_cast<uint32_t>(meshes_.size());
+		return;
+	}
+
+	// 影はカメラから見えるので、カメラの画面上の大きさからLODを選ぶ（本描画と同じ状態を使う）
+	uint32_t lodLevel = UpdateLod(worldTransform, *sShadowViewProjection_);
 
 	// CBVをセット（ワールド行列）
 	sCommandList_->SetGraphicsRootConstantBufferView(
 	  static_cast<UINT>(RoomParameter::kWorldTransform),
 	  worldTransform.constBuff_->GetGPUVirtualAddress());
 
-	// CBVをセット（ビュープロジェクション行列）
-	sCommandList_->SetGraphicsRootConstantBufferView(
-	  static_cast<UINT>(RoomParameter::kViewProjection),
-	  viewProjection.constBuff_->GetGPUVirtualAddress());
-
-	// 全メッシュを描画
+	// 全メッシュを描画（メッシュが複数ならメッシュ単位でも判定する）
 	for (auto& mesh : meshes_) {
+		if (meshes_.size() > 1) {
+			AABB aabb = TransformAABB(mesh->GetAABB(), worldTransform.matWorld_);
+			if (!::IsVisible(cascade.casterFrustum, aabb)) {
+				sDrawStatistics_.shadowCulledMeshCount++;
+				continue;
+			}
+		}
+		SetVertexFormat(mesh);
 		mesh->Draw(
 		  sCommandList_, (UINT)RoomParameter::kMaterial, (UINT)RoomParameter::kTexture,
-		  textureHadle);
+		  mesh->GetMaterial()->GetTextureHadle(), lodLevel);
+		sDrawStatistics_.shadowDrawnMeshCount++;
+	}
+}
+
+void Model::DrawMesh(
+  Mesh* mesh, const WorldTransform& worldTransform, const ViewProjection& viewProjection,
+  uint32_t textureHandle, uint32_t lodLevel) {
+	if (!IsMeshVisible(mesh, worldTransform, viewProjection)) {
+		sDrawStatistics_.culledMeshCount++;
+		return;
+	}
+
+	// 最も詳細なLODで、メッシュレットが十分多ければ見える塊だけを描く
+	// （メッシュレットはLOD0から作る。粗いLODは画面上で小さく、丸ごと描いても安い）
+	const std::vector<Meshlet>& meshlets = mesh->GetMeshlets();
+	if (lodLevel == 0 && meshlets.size() >= kMeshletCullingMinCount) {
+		// 視錐台とカメラをメッシュのローカル座標系に移して判定する
+		Matrix4x4 matWorldView = Multiply(worldTransform.matWorld_, viewProjection.matView);
+		Frustum frustum = MakeFrustum(Multiply(matWorldView, viewProjection.matProjection));
+		Vector3 cameraPosition = GetLocalCameraPosition(matWorldView);
+		uint32_t visibleCount =
+		  CullMeshlets(meshlets.data(), meshlets.size(), frustum, cameraPosition, sMeshletRanges_);
+		sDrawStatistics_.drawnMeshletCount += visibleCount;
+		sDrawStatistics_.culledMeshletCount +=
+		  static_cast<uint32_t>(meshlets.size()) - visibleCount;
+		if (visibleCount == 0) {
+			sDrawStatistics_.culledMeshCount++;
+			return;
+		}
+
+		SetVertexFormat(mesh);
+		mesh->DrawRanges(
+		  sCommandList_, (UINT)RoomParameter::kMaterial, (UINT)RoomParameter::kTexture,
+		  textureHandle, sMeshletRanges_);
+		sDrawStatistics_.drawnMeshCount++;
+		for (const IndexRange& range : sMeshletRanges_) {
+			sDrawStatistics_.drawnTriangleCount += range.indexCount / 3;
+		}
+		return;
+	}
+
+	SetVertexFormat(mesh);
+	mesh->Draw(
+	  sCommandList_, (UINT)RoomParameter::kMaterial, (UINT)RoomParameter::kTexture,
+	  textureHandle, lodLevel);
+	sDrawStatistics_.drawnMeshCount++;
+	sDrawStatistics_.drawnTriangleCount += mesh->GetLod(lodLevel).indexCount / 3;
+}
+
+void Model::SetLightView(const ViewProjection& viewProjection) {
+	// 枠はカメラ毎に分かれていて、フレーム内で先に積んだ描画の枠は書き換えない
+	uint32_t view = lightGroup->PrepareView(viewProjection);
+	if (view == sLightView_) {
+		return;
+	}
+	lightGroup->SetView(
+	  sCommandList_, static_cast<UINT>(RoomParameter::kLight),
+	  static_cast<UINT>(RoomParameter::kLightClusters), view);
+	sLightView_ = view;
+}
+
+void Model::SetVertexFormat(const Mesh* mesh) {
+	// 頂点形式が変わる時だけパイプラインを切り替える
+	ID3D12PipelineState* pipelineState = sPipelineState_.Get();
+	if (sShadowPass_) {
+		pipelineState = mesh->IsQuantized() ? sPipelineStateShadowQuantized_.Get()
+		                                    : sPipelineStateShadow_.Get();
+	} else if (mesh->IsQuantized()) {
+		pipelineState = sPipelineStateQuantized_.Get();
+	} else if (mesh->HasTangents()) {
+		pipelineState = sPipelineStateNormalMap_.Get();
+	}
+	if (pipelineState != sBoundPipelineState_) {
+		sCommandList_->SetPipelineState(pipelineState);
+		sBoundPipelineState_ = pipelineState;
+	}
+	// 圧縮座標の復元に使う範囲
+	if (mesh->IsQuantized()) {
+		sCommandList_->SetGraphicsRoot32BitConstants(
+		  static_cast<UINT>(RoomParameter::kQuantization),
+		  static_cast<UINT>(sizeof(VertexQuantizer::Range) / sizeof(float)),
+		  &mesh->GetQuantizationRange(), 0);
+	}
+	// 法線マップ
+	if (mesh->HasTangents() && !sShadowPass_) {
+		TextureManager::GetInstance()->SetGraphicsRootDescriptorTable(
+		  sCommandList_, static_cast<UINT>(RoomParameter::kNormalMap),
+		  mesh->GetMaterial()->GetNormalMapHandle());
+	}
+}
+
+OccluderMesh Model::CreateOccluderMesh() const {
+	OccluderMesh occluder;
+	for (auto& mesh : meshes_) {
+		uint32_t baseVertex = static_cast<uint32_t>(occluder.positions.size());
+		for (auto& vertex : mesh->GetVertices()) {
+			occluder.positions.push_back(vertex.pos);
+		}
+		for (auto index : mesh->GetIndices()) {
+			occluder.indices.push_back(baseVertex + index);
+		}
+	}
+	return occluder;
+}
+
+std::string Model::GetOptimizeReport() const {
+	std::string report = name_ + "\n";
+	char line[256];
+	for (auto& mesh : meshes_) {
+		const Mesh::OptimizeStatistics& statistics = mesh->GetOptimizeStatistics();
+		snprintf(
+		  line, sizeof(line), "  %s vertices %u -> %u, ACMR %.3f -> %.3f, ATVR %.3f -> %.3f\n",
+		  mesh->GetName().c_str(), statistics.vertexCountBefore, statistics.vertexCountAfter,
+		  statistics.cacheBefore.acmr, statistics.cacheAfter.acmr, statistics.cacheBefore.atvr,
+		  statistics.cacheAfter.atvr);
+		report += line;
+		if (mesh->IsQuantized()) {
+			const VertexQuantizer::ErrorStatistics& error = mesh->GetQuantizationError();
+			snprintf(
+			  line, sizeof(line),
+			  "  %s quantized %zu -> %zu bytes/vertex, max error pos %.6f normal %.4fdeg uv %.6f\n",
+			  mesh->GetName().c_str(), sizeof(Mesh::VertexPosNormalUv),
+			  sizeof(VertexQuantizer::PackedVertex), error.position, error.normalDegree, error.uv);
+			report += line;
+		}
+	}
+	return report;
+}
+
+std::string Model::GetLodReport() const {
+	std::string report = name_ + "\n";
+	char line[256];
+	for (auto& mesh : meshes_) {
+		const auto& lods = mesh->GetLods();
+		float baseTriangleCount = static_cast<float>(lods.empty() ? 0 : lods[0].indexCount / 3);
+		for (uint32_t level = 0; level < lods.size(); level++) {
+			uint32_t triangleCount = lods[level].indexCount / 3;
+			float ratio = 0.0f;
+			if (baseTriangleCount > 0.0f) {
+				ratio = 100.0f * static_cast<float>(triangleCount) / baseTriangleCount;
+			}
+			snprintf(
+			  line, sizeof(line), "  %s LOD%u: %u tris (%.1f%%) error %.5f\n",
+			  mesh->GetName().c_str(), level, triangleCount, ratio, lods[level].error);
+			report += line;
+		}
 	}
+	return report;
 }
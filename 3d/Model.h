@@ -2,11 +2,14 @@
 
 #include "LightGroup.h"
 #include "Mesh.h"
+#include "OcclusionCuller.h"
+#include "ShadowMap.h"
 #include "TextureManager.h"
 #include "ViewProjection.h"
 #include "WorldTransform.h"
 #include <string>
 #include <unordered_map>
+#include <utility>
 #include <vector>
 
 /// <summary>
@@ -24,9 +27,74 @@ public: // 列挙子
 	enum class RoomParameter {
 		kWorldTransform, // ワールド変換行列
 		kViewProjection, // ビュープロジェクション変換行列
-		kMaterial,       // マテリアル
+		kMaterial,       // マテリアル番号（ルート定数）
 		kTexture,        // テクスチャ
 		kLight,          // ライト
+		kQuantization,   // 圧縮頂点の座標範囲（ルート定数）
+		kNormalMap,      // 法線マップ
+		kMaterialBuffer, // 全マテリアルの定数（構造化バッファ）
+		kPointLights,    // 有効な点光源（構造化バッファ）
+		kSpotLights,     // 有効なスポットライト（構造化バッファ）
+		kLightClusters,  // クラスタ毎のライト一覧（構造化バッファ）
+		kShadow,         // シャドウマップの参照用定数
+		kShadowMap,      // シャドウマップ（カスケード毎のテクスチャ配列）
+	};
+
+	/// <summary>
+	/// 描画統計
+	/// </summary>
+	struct DrawStatistics {
+		uint32_t submittedModelCount = 0;   // 一括判定にかけたモデル数
+		uint32_t culledModelCount = 0;      // 一括判定で視錐台カリングされたモデル数
+		uint32_t drawnMeshCount = 0;        // 描画したメッシュ数
+		uint32_t culledMeshCount = 0;       // 視錐台カリングされたメッシュ数
+		uint32_t occludedMeshCount = 0;     // 遮蔽カリングされたメッシュ数
+		uint32_t drawnTriangleCount = 0;    // 描画した三角形数
+		uint32_t drawnMeshletCount = 0;     // 描画したメッシュレット数
+		uint32_t culledMeshletCount = 0;    // カリングされたメッシュレット数
+		uint32_t shadowDrawnMeshCount = 0;  // シャドウマップに描画したメッシュ数（全カスケード）
+		uint32_t shadowCulledMeshCount = 0; // 影を落とさないのでカリングされたメッシュ数
+	};
+
+public: // 定数
+	// 生成するLOD数（元の形状を含む）
+	static const uint32_t kLodCount = 4;
+	// LOD切り替えの履歴幅（閾値に対する割合）
+	static constexpr float kLodHysteresis = 0.25f;
+	// メッシュレット単位でカリングする最小のメッシュレット数（少なければメッシュ単位で描く）
+	static const uint32_t kMeshletCullingMinCount = 8;
+	// 描かれなくなったLODの選択状態を捨てるまでのフレーム数
+	static const uint64_t kLodStateLifetime = 60;
+
+private: // サブクラス
+	/// <summary>
+	/// 描画要求（PostDrawでまとめて視錐台カリングしてから描画を積む）
+	/// </summary>
+	struct DrawRequest {
+		Model* model;
+		const WorldTransform* worldTransform;
+		const ViewProjection* viewProjection;
+		uint32_t textureHandle; // 差し替えるテクスチャ
+		bool overridesTexture;  // テクスチャを差し替えるか
+	};
+
+	/// <summary>
+	/// LODの選択状態（ワールドトランスフォームとカメラの組毎）
+	/// </summary>
+	struct LodState {
+		uint32_t level;     // 前回選んだLOD
+		uint64_t lastFrame; // 前回選んだフレーム
+	};
+
+	// LODの選択状態のキー
+	using LodKey = std::pair<const WorldTransform*, const ViewProjection*>;
+
+	// LODの選択状態のキーのハッシュ
+	struct LodKeyHash {
+		size_t operator()(const LodKey& key) const {
+			return std::hash<const void*>()(key.first) ^
+			       (std::hash<const void*>()(key.second) * 0x9e3779b97f4a7c15ull);
+		}
 	};
 
 private:
@@ -42,8 +110,42 @@ private: // 静的メンバ変数
 	static Microsoft::WRL::ComPtr<ID3D12RootSignature> sRootSignature_;
 	// パイプラインステートオブジェクト
 	static Microsoft::WRL::ComPtr<ID3D12PipelineState> sPipelineState_;
+	// パイプラインステートオブジェクト（圧縮頂点用）
+	static Microsoft::WRL::ComPtr<ID3D12PipelineState> sPipelineStateQuantized_;
+	// パイプラインステートオブジェクト（法線マップ用）
+	static Microsoft::WRL::ComPtr<ID3D12PipelineState> sPipelineStateNormalMap_;
+	// パイプラインステートオブジェクト（シャドウマップの深度描画用）
+	static Microsoft::WRL::ComPtr<ID3D12PipelineState> sPipelineStateShadow_;
+	// パイプラインステートオブジェクト（シャドウマップの深度描画用、圧縮頂点）
+	static Microsoft::WRL::ComPtr<ID3D12PipelineState> sPipelineStateShadowQuantized_;
+	// 設定中のパイプライン
+	static ID3D12PipelineState* sBoundPipelineState_;
+	// シャドウマップを描画中か
+	static bool sShadowPass_;
+	// 描画中のカスケード番号
+	static uint32_t sShadowCascade_;
+	// シャドウマップのLODを選ぶカメラ
+	static const ViewProjection* sShadowViewProjection_;
+	// 読み込むモデルの頂点を圧縮するか
+	static bool sVertexQuantization_;
 	// ライト
 	static std::unique_ptr<LightGroup> lightGroup;
+	// 描画統計
+	static DrawStatistics sDrawStatistics_;
+	// 遮蔽カリング（未設定なら行わない）
+	static const OcclusionCuller* sOcclusionCuller_;
+	// 遮蔽カリングの深度を描いたカメラ（他のカメラの描画には使わない）
+	static const ViewProjection* sOcclusionViewProjection_;
+	// LODを切り替える画面上の誤差（ピクセル）
+	static float sLodErrorThreshold_;
+	// メッシュレットカリング結果の作業領域
+	static std::vector<IndexRange> sMeshletRanges_;
+	// セット中のライトのカメラの枠（PreDrawで未設定に戻す）
+	static uint32_t sLightView_;
+	// PostDrawで描画する要求
+	static std::vector<DrawRequest> sDrawRequests_;
+	// 描画要求の境界球の一括判定
+	static FrustumCuller sFrustumCuller_;
 
 public: // 静的メンバ関数
 	/// <summary>
@@ -78,9 +180,79 @@ public: // 静的メンバ関数
 
 	/// <summary>
 	/// 描画後処理
+	/// PreDrawからの描画要求をカメラ毎にまとめて視錐台カリングし、見えるものだけ描画を積む
 	/// </summary>
 	static void PostDraw();
 
+	/// <summary>
+	/// シャドウマップ描画前処理
+	/// 主光源（平行光源0番）とカメラからカスケードを求め、深度だけを描くパイプラインを設定する
+	/// </summary>
+	/// <param name="commandList">描画コマンドリスト</param>
+	/// <param name="viewProjection">カメラのビュープロジェクション</param>
+	static void PreDrawShadow(
+	    ID3D12GraphicsCommandList* commandList, const ViewProjection& viewProjection);
+
+	/// <summary>
+	/// 描画するカスケード数（影が無効なら0）
+	/// </summary>
+	static uint32_t GetShadowCascadeCount();
+
+	/// <summary>
+	/// 描画するカスケードを切り替える。以降のDrawShadowはこのカスケードに描く
+	/// </summary>
+	/// <param name="index">カスケード番号</param>
+	static void SetShadowCascade(uint32_t index);
+
+	/// <summary>
+	/// シャドウマップ描画後処理（描画対象をバックバッファに戻す）
+	/// </summary>
+	static void PostDrawShadow();
+
+	/// <summary>
+	/// 描画統計を取得
+	/// </summary>
+	/// <returns>描画統計</returns>
+	static const DrawStatistics& GetDrawStatistics() { return sDrawStatistics_; }
+
+	/// <summary>
+	/// ライトの転送量の統計を取得（PreDrawから次のPreDrawまでの分）
+	/// </summary>
+	/// <returns>転送量の統計</returns>
+	static const LightGroup::UploadStatistics& GetLightUploadStatistics() {
+		return lightGroup->GetUploadStatistics();
+	}
+
+	/// <summary>
+	/// 描画統計をリセット。フレームの描画開始時に呼ぶ
+	/// </summary>
+	static void ResetDrawStatistics();
+
+	/// <summary>
+	/// 遮蔽カリングを設定する。Renderを済ませたものを渡す（nullptrで無効）
+	/// 深度を描いたカメラの描画だけを判定し、他のカメラの描画には使わない
+	/// </summary>
+	/// <param name="occlusionCuller">遮蔽カリング</param>
+	/// <param name="viewProjection">深度を描いたビュープロジェクション</param>
+	static void SetOcclusionCuller(
+	  const OcclusionCuller* occlusionCuller, const ViewProjection* viewProjection) {
+		sOcclusionCuller_ = occlusionCuller;
+		sOcclusionViewProjection_ = viewProjection;
+	}
+
+	/// <summary>
+	/// LODを切り替える画面上の誤差を設定する
+	/// </summary>
+	/// <param name="pixels">許容する誤差（ピクセル）</param>
+	static void SetLodErrorThreshold(float pixels) { sLodErrorThreshold_ = pixels; }
+
+	/// <summary>
+	/// 以降に読み込むモデルの頂点を圧縮形式にするか設定する（既定は圧縮しない）
+	/// 頂点1個あたり32バイトが16バイトになる
+	/// </summary>
+	/// <param name="enable">圧縮するか</param>
+	static void SetVertexQuantization(bool enable) { sVertexQuantization_ = enable; }
+
 public: // メンバ関数
 	/// <summary>
 	/// デストラクタ
@@ -94,8 +266,20 @@ public: // メンバ関数
 	/// <param name="modelname">エッジ平滑化フラグ</param>
 	void Initialize(const std::string& modelname, bool smoothing = false);
 
+	/// <summary>
+	/// 画面上の誤差からLODを選ぶ
+	/// ワールドトランスフォームとカメラの組毎に前回のLODを覚えておき、
+	/// 切り替えの境界付近でちらつかないよう履歴幅を持たせる
+	/// DrawとDrawShadowが呼ぶので、通常は直接呼ぶ必要はない
+	/// </summary>
+	/// <param name="worldTransform">ワールドトランスフォーム（行列は更新済みのこと）</param>
+	/// <param name="viewProjection">ビュープロジェクション</param>
+	/// <returns>LOD番号（0が最も詳細）</returns>
+	uint32_t UpdateLod(const WorldTransform& worldTransform, const ViewProjection& viewProjection);
+
 	/// <summary>
 	/// 描画
+	/// 要求を溜めるだけで、描画はPostDrawで積む。引数はPostDrawまで保持しておくこと
 	/// </summary>
 	/// <param name="worldTransform">ワールドトランスフォーム</param>
 	/// <param name="viewProjection">ビュープロジェクション</param>
@@ -103,6 +287,7 @@ public: // メンバ関数
 
 	/// <summary>
 	/// 描画（テクスチャ差し替え）
+	/// 要求を溜めるだけで、描画はPostDrawで積む。引数はPostDrawまで保持しておくこと
 	/// </summary>
 	/// <param name="worldTransform">ワールドトランスフォーム</param>
 	/// <param name="viewProjection">ビュープロジェクション</param>
@@ -111,12 +296,38 @@ public: // メンバ関数
 	    const WorldTransform& worldTransform, const ViewProjection& viewProjection,
 	    uint32_t textureHadle);
 
+	/// <summary>
+	/// シャドウマップに深度を描画（カスケードに影を落とさないものは積まない）
+	/// LODはPreDrawShadowに渡したカメラから選ぶ
+	/// </summary>
+	/// <param name="worldTransform">ワールドトランスフォーム</param>
+	void DrawShadow(const WorldTransform& worldTransform);
+
 	/// <summary>
 	/// メッシュコンテナを取得
 	/// </summary>
 	/// <returns>メッシュコンテナ</returns>
 	inline const std::vector<Mesh*>& GetMeshes() { return meshes_; }
 
+	/// <summary>
+	/// 全メッシュの位置と三角形から遮蔽物メッシュを作る
+	/// 遮蔽物用に用意した低ポリゴンモデルで呼ぶこと
+	/// </summary>
+	/// <returns>遮蔽物メッシュ</returns>
+	OccluderMesh CreateOccluderMesh() const;
+
+	/// <summary>
+	/// メッシュ最適化の結果（頂点数とACMR・ATVRの変化、圧縮誤差）を文字列で取得
+	/// </summary>
+	/// <returns>レポート</returns>
+	std::string GetOptimizeReport() const;
+
+	/// <summary>
+	/// LODの一覧（三角形数の削減率と幾何誤差）を文字列で取得
+	/// </summary>
+	/// <returns>レポート</returns>
+	std::string GetLodReport() const;
+
 private: // メンバ変数
 	// 名前
 	std::string name_;
@@ -126,6 +337,14 @@ private: // メンバ変数
 	std::unordered_map<std::string, Material*> materials_;
 	// デフォルトマテリアル
 	Material* defaultMaterial_ = nullptr;
+	// 全メッシュを包む境界球（ローカル座標系）
+	Sphere boundingSphere_ = {};
+	// LOD毎の幾何誤差（全メッシュの最大）
+	std::vector<float> lodErrors_;
+	// ワールドトランスフォームとカメラの組毎のLODの選択状態
+	std::unordered_map<LodKey, LodState, LodKeyHash> lodStates_;
+	// 古いLODの選択状態を最後に捨てたフレーム
+	uint64_t lodPruneFrame_ = 0;
 
 private: // メンバ関数
 	/// <summary>
@@ -149,4 +368,65 @@ private: // メンバ関数
 	/// テクスチャ読み込み
 	/// </summary>
 	void LoadTextures();
+
+	/// <summary>
+	/// 境界ボリュームの計算
+	/// </summary>
+	void CalculateBounds();
+
+	/// <summary>
+	/// メッシュを1つ描画する（メッシュ単位・メッシュレット単位のカリングを含む）
+	/// </summary>
+	/// <param name="mesh">メッシュ</param>
+	/// <param name="worldTransform">ワールドトランスフォーム</param>
+	/// <param name="viewProjection">ビュープロジェクション</param>
+	/// <param name="textureHandle">テクスチャハンドル</param>
+	/// <param name="lodLevel">LOD番号</param>
+	void DrawMesh(
+	    Mesh* mesh, const WorldTransform& worldTransform, const ViewProjection& viewProjection,
+	    uint32_t textureHandle, uint32_t lodLevel);
+
+	/// <summary>
+	/// メッシュの頂点形式に合わせてパイプラインと座標範囲、法線マップを設定する
+	/// シャドウマップの描画中は深度描画用のパイプラインにする
+	/// </summary>
+	/// <param name="mesh">メッシュ</param>
+	static void SetVertexFormat(const Mesh* mesh);
+
+	/// <summary>
+	/// カメラ用のライトの枠を用意し、セット中の枠と違えばセットし直す
+	/// </summary>
+	/// <param name="viewProjection">ビュープロジェクション</param>
+	static void SetLightView(const ViewProjection& viewProjection);
+
+	/// <summary>
+	/// 溜めた描画要求をカメラ毎に一括で視錐台カリングし、見えるものを積む
+	/// </summary>
+	static void FlushDrawRequests();
+
+	/// <summary>
+	/// 視錐台カリングを通った描画要求を積む（遮蔽カリングとLODの選択を含む）
+	/// </summary>
+	/// <param name="request">描画要求</param>
+	void Submit(const DrawRequest& request);
+
+	/// <summary>
+	/// 遮蔽カリング
+	/// </summary>
+	/// <param name="worldTransform">ワールドトランスフォーム</param>
+	/// <param name="viewProjection">ビュープロジェクション</param>
+	/// <returns>モデルが遮蔽物に隠れているか</returns>
+	bool IsOccluded(
+	  const WorldTransform& worldTransform, const ViewProjection& viewProjection) const;
+
+	/// <summary>
+	/// メッシュ単位の視錐台カリング
+	/// </summary>
+	/// <param name="mesh">メッシュ</param>
+	/// <param name="worldTransform">ワールドトランスフォーム</param>
+	/// <param name="viewProjection">ビュープロジェクション</param>
+	/// <returns>メッシュが見えるか</returns>
+	bool IsMeshVisible(
+	    const Mesh* mesh, const WorldTransform& worldTransform,
+	    const ViewProjection& viewProjection) const;
 };
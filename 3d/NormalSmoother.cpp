@@ -0,0 +1,157 @@
+﻿#include "NormalSmoother.h"
+#include "JobSystem.h"
+#include "VertexMath.h"
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+#include <numbers>
+#include <vector>
+#include <xmmintrin.h>
+
+namespace {
+
+// 並列処理の1ジョブあたりの要素数
+const uint32_t kGrainSize = 4096;
+
+// 2辺のなす角
+float Angle(__m128 a, __m128 b) {
+	float lengthSq = Dot(a, a) * Dot(b, b);
+	if (lengthSq <= 0.0f) {
+		return 0.0f;
+	}
+	float cosine = Dot(a, b) / std::sqrt(lengthSq);
+	return std::acos((std::clamp)(cosine, -1.0f, 1.0f));
+}
+
+// 要素数が多ければ並列に、少なければそのまま処理する
+template<class Function> void ForEachRange(uint32_t count, const Function& function) {
+	if (count < NormalSmoother::kParallelThreshold) {
+		function(0, count);
+	} else {
+		JobSystem::GetInstance()->ParallelFor(count, kGrainSize, function);
+	}
+}
+
+// キー毎の要素一覧をCSR形式で作る（数えて、累積して、詰める）
+template<class KeyFunction>
+void BuildGroups(
+  uint32_t itemCount, uint32_t keyCount, const KeyFunction& keyOf,
+  std::vector<uint32_t>& offsets, std::vector<uint32_t>& items) {
+	offsets.assign(keyCount + 1, 0);
+	for (uint32_t i = 0; i < itemCount; i++) {
+		uint32_t key = keyOf(i);
+		if (key != NormalSmoother::kNoPositionKey) {
+			offsets[key + 1]++;
+		}
+	}
+	for (uint32_t key = 0; key < keyCount; key++) {
+		offsets[key + 1] += offsets[key];
+	}
+	items.resize(offsets[keyCount]);
+	std::vector<uint32_t> cursor(offsets.begin(), offsets.end() - 1);
+	for (uint32_t i = 0; i < itemCount; i++) {
+		uint32_t key = keyOf(i);
+		if (key != NormalSmoother::kNoPositionKey) {
+			items[cursor[key]++] = i;
+		}
+	}
+}
+
+} // namespace
+
+void NormalSmoother::Smooth(const VertexInput& vertices, Weighting weighting) {
+	assert(vertices.positionKeys && vertices.normals);
+	const uint32_t* keys = vertices.positionKeys;
+	auto normal = [&vertices](uint32_t index) -> Vector3& {
+		return At(vertices.normals, vertices.normalStride, index);
+	};
+
+	// 座標番号はファイル全体の通し番号なので、メッシュ内の最小値からの差で扱う
+	uint32_t minKey = kNoPositionKey;
+	uint32_t maxKey = 0;
+	for (uint32_t v = 0; v < vertices.vertexCount; v++) {
+		if (keys[v] != kNoPositionKey) {
+			minKey = (std::min)(minKey, keys[v]);
+			maxKey = (std::max)(maxKey, keys[v]);
+		}
+	}
+	if (minKey == kNoPositionKey) {
+		return;
+	}
+	const uint32_t keyCount = maxKey - minKey + 1;
+	auto keyOfVertex = [keys, minKey](uint32_t v) {
+		return keys[v] == kNoPositionKey ? kNoPositionKey : keys[v] - minKey;
+	};
+
+	// 座標番号→頂点
+	std::vector<uint32_t> vertexOffsets;
+	std::vector<uint32_t> groupVertices;
+	BuildGroups(vertices.vertexCount, keyCount, keyOfVertex, vertexOffsets, groupVertices);
+
+	if (weighting == Weighting::kAverage) {
+		// 座標番号毎に既存の法線を合計して正規化する
+		ForEachRange(keyCount, [&](uint32_t begin, uint32_t end) {
+			for (uint32_t key = begin; key < end; key++) {
+				__m128 sum = _mm_setzero_ps();
+				for (uint32_t i = vertexOffsets[key]; i < vertexOffsets[key + 1]; i++) {
+					sum = _mm_add_ps(sum, Load(normal(groupVertices[i])));
+				}
+				__m128 result = Normalize(sum);
+				for (uint32_t i = vertexOffsets[key]; i < vertexOffsets[key + 1]; i++) {
+					Store(normal(groupVertices[i]), result);
+				}
+			}
+		});
+		return;
+	}
+
+	assert(vertices.positions && vertices.indices);
+	assert(vertices.indexCount % 3 == 0);
+	const uint32_t* indices = vertices.indices;
+	const uint32_t cornerCount = static_cast<uint32_t>(vertices.indexCount);
+	const uint32_t triangleCount = cornerCount / 3;
+	auto position = [&vertices](uint32_t index) -> const Vector3& {
+		return At(vertices.positions, vertices.positionStride, index);
+	};
+
+	// 角毎の寄与（面の外積は面積の2倍の長さを持つので、角の大きさを掛ける）
+	std::vector<Vector3> cornerNormals(cornerCount);
+	ForEachRange(triangleCount, [&](uint32_t begin, uint32_t end) {
+		for (uint32_t t = begin; t < end; t++) {
+			const uint32_t* corner = &indices[t * 3];
+			__m128 p0 = Load(position(corner[0]));
+			__m128 p1 = Load(position(corner[1]));
+			__m128 p2 = Load(position(corner[2]));
+			__m128 e01 = _mm_sub_ps(p1, p0);
+			__m128 e02 = _mm_sub_ps(p2, p0);
+			__m128 e12 = _mm_sub_ps(p2, p1);
+			__m128 faceNormal = Cross(e01, e02);
+			float angle0 = Angle(e01, e02);
+			float angle1 = Angle(_mm_sub_ps(_mm_setzero_ps(), e01), e12);
+			float angle2 = std::numbers::pi_v<float> - angle0 - angle1;
+			Store(cornerNormals[t * 3], _mm_mul_ps(faceNormal, _mm_set1_ps(angle0)));
+			Store(cornerNormals[t * 3 + 1], _mm_mul_ps(faceNormal, _mm_set1_ps(angle1)));
+			Store(cornerNormals[t * 3 + 2], _mm_mul_ps(faceNormal, _mm_set1_ps(angle2)));
+		}
+	});
+
+	// 座標番号→角
+	std::vector<uint32_t> cornerOffsets;
+	std::vector<uint32_t> groupCorners;
+	auto keyOfCorner = [&keyOfVertex, indices](uint32_t c) { return keyOfVertex(indices[c]); };
+	BuildGroups(cornerCount, keyCount, keyOfCorner, cornerOffsets, groupCorners);
+
+	// 座標番号毎に角の寄与を合計し、同じ座標番号の全頂点に書き込む
+	ForEachRange(keyCount, [&](uint32_t begin, uint32_t end) {
+		for (uint32_t key = begin; key < end; key++) {
+			__m128 sum = _mm_setzero_ps();
+			for (uint32_t i = cornerOffsets[key]; i < cornerOffsets[key + 1]; i++) {
+				sum = _mm_add_ps(sum, Load(cornerNormals[groupCorners[i]]));
+			}
+			__m128 result = Normalize(sum);
+			for (uint32_t i = vertexOffsets[key]; i < vertexOffsets[key + 1]; i++) {
+				Store(normal(groupVertices[i]), result);
+			}
+		}
+	});
+}
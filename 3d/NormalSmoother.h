@@ -0,0 +1,48 @@
+#pragma once
+
+#include "Vector3.h"
+#include <cstddef>
+#include <cstdint>
+
+/// <summary>
+/// 頂点法線の平滑化
+/// 同じ座標から作られた頂点をCSR形式（開始位置の配列と番号の配列）でまとめ、法線を共有させる
+/// </summary>
+class NormalSmoother {
+public: // 定数
+	// 平滑化しない頂点の座標番号
+	static const uint32_t kNoPositionKey = UINT32_MAX;
+	// 並列化する要素数の閾値
+	static const uint32_t kParallelThreshold = 16384;
+
+public: // 列挙子
+	/// <summary>
+	/// 法線の重み付け
+	/// </summary>
+	enum class Weighting {
+		kAverage,   // 各頂点の既存の法線を平均する（従来の処理）
+		kAreaAngle, // 面の法線を面積と角の大きさで重み付けして合計する
+	};
+
+public: // サブクラス
+	// 頂点データ（任意のストライドの配列を指す）
+	struct VertexInput {
+		const uint32_t* positionKeys = nullptr; // 頂点毎の元の座標番号
+		const Vector3* positions = nullptr;     // kAreaAngleでのみ使う
+		size_t positionStride = sizeof(Vector3);
+		Vector3* normals = nullptr; // 入力兼出力
+		size_t normalStride = sizeof(Vector3);
+		uint32_t vertexCount = 0;
+		const uint32_t* indices = nullptr; // 三角形リスト。kAreaAngleでのみ使う
+		size_t indexCount = 0;
+	};
+
+public: // 静的メンバ関数
+	/// <summary>
+	/// 同じ座標番号を持つ頂点の法線を揃える
+	/// 要素数がkParallelThreshold以上ならジョブシステムで並列に処理する
+	/// </summary>
+	/// <param name="vertices">頂点データ</param>
+	/// <param name="weighting">重み付け</param>
+	static void Smooth(const VertexInput& vertices, Weighting weighting = Weighting::kAverage);
+};
@@ -0,0 +1,401 @@
+﻿#include "OcclusionCuller.h"
+#include "JobSystem.h"
+#include "MathUtility.h"
+#include <algorithm>
+#include <cassert>
+#include <cfloat>
+#include <cmath>
+#include <emmintrin.h>
+
+namespace {
+
+// 頂点変換用の作業領域（スレッド毎）
+thread_local std::vector<float> tClipPositions;
+
+// クリップ座標の頂点をニアクリップ面（z=0）で分割した補間点
+void LerpClipVertex(const float* a, const float* b, float t, float* result) {
+	for (int i = 0; i < 4; i++) {
+		result[i] = a[i] + (b[i] - a[i]) * t;
+	}
+}
+
+// 3頂点が全て同じクリップ面の外側にあるか
+bool IsTriviallyRejected(const float (*clip)[4]) {
+	auto allOutside = [clip](auto isOutside) {
+		return isOutside(clip[0]) && isOutside(clip[1]) && isOutside(clip[2]);
+	};
+	return allOutside([](const float* v) { return v[0] < -v[3]; }) ||
+	       allOutside([](const float* v) { return v[0] > v[3]; }) ||
+	       allOutside([](const float* v) { return v[1] < -v[3]; }) ||
+	       allOutside([](const float* v) { return v[1] > v[3]; }) ||
+	       allOutside([](const float* v) { return v[2] < 0.0f; }) ||
+	       allOutside([](const float* v) { return v[2] > v[3]; });
+}
+
+} // namespace
+
+void OcclusionCuller::Initialize(uint32_t width, uint32_t height) {
+	// SIMDで4ピクセルずつ処理するので幅は4の倍数
+	assert(width > 0 && width % 4 == 0);
+	assert(height > 0);
+
+	width_ = width;
+	height_ = height;
+
+	// 1x1になるまで半分にしていく
+	hierarchicalDepth_.clear();
+	levelWidths_.clear();
+	levelHeights_.clear();
+	uint32_t levelWidth = width;
+	uint32_t levelHeight = height;
+	while (true) {
+		levelWidths_.push_back(levelWidth);
+		levelHeights_.push_back(levelHeight);
+		hierarchicalDepth_.emplace_back(levelWidth * levelHeight, 1.0f);
+		if (levelWidth == 1 && levelHeight == 1) {
+			break;
+		}
+		levelWidth = (levelWidth + 1) / 2;
+		levelHeight = (levelHeight + 1) / 2;
+	}
+}
+
+void OcclusionCuller::BeginFrame(const Matrix4x4& viewProjection) {
+	viewProjection_ = viewProjection;
+	occluders_.clear();
+	occluderTriangleCount_ = 0;
+	testCount_ = 0;
+	occludedCount_ = 0;
+}
+
+void OcclusionCuller::AddOccluder(const OccluderMesh* mesh, const Matrix4x4& matWorld) {
+	assert(mesh);
+	occluders_.push_back({mesh, Multiply(matWorld, viewProjection_)});
+	occluderTriangleCount_ += static_cast<uint32_t>(mesh->indices.size() / 3);
+}
+
+void OcclusionCuller::Render() {
+	assert(!hierarchicalDepth_.empty());
+	JobSystem* jobSystem = JobSystem::GetInstance();
+
+	// ニアクリップで1枚が最大2枚に分かれる
+	triangles_.resize(static_cast<size_t>(occluderTriangleCount_) * 2);
+	triangleCount_ = 0;
+
+	// 頂点変換・クリップ・背面カリング
+	jobSystem->ParallelFor(
+	  static_cast<uint32_t>(occluders_.size()), 1, [this](uint32_t begin, uint32_t end) {
+		  for (uint32_t i = begin; i < end; i++) {
+			  SetupTriangles(occluders_[i]);
+		  }
+	  });
+
+	// 横帯に分けてラスタライズ（帯毎に深度バッファのクリアも行う）
+	uint32_t bandCount = (height_ + kBandHeight - 1) / kBandHeight;
+	jobSystem->ParallelFor(bandCount, 1, [this](uint32_t begin, uint32_t end) {
+		for (uint32_t band = begin; band < end; band++) {
+			RasterizeBand(band * kBandHeight, (std::min)((band + 1) * kBandHeight, height_));
+		}
+	});
+
+	// 階層Z。大きい段だけ並列化する
+	for (uint32_t level = 1; level < hierarchicalDepth_.size(); level++) {
+		uint32_t levelHeight = levelHeights_[level];
+		if (levelHeight >= kBandHeight * 2) {
+			auto buildRows = [this, level](uint32_t begin, uint32_t end) {
+				BuildHierarchyLevel(level, begin, end);
+			};
+			jobSystem->ParallelFor(levelHeight, kBandHeight, buildRows);
+		} else {
+			BuildHierarchyLevel(level, 0, levelHeight);
+		}
+	}
+}
+
+bool OcclusionCuller::IsVisible(const AABB& aabb) const {
+	testCount_.fetch_add(1, std::memory_order_relaxed);
+	if (hierarchicalDepth_.empty()) {
+		return true;
+	}
+
+	// 8頂点をスクリーンに投影して矩形と最も手前の深度を求める
+	const auto& m = viewProjection_.m;
+	float minX = FLT_MAX, minY = FLT_MAX, maxX = -FLT_MAX, maxY = -FLT_MAX;
+	float minZ = FLT_MAX;
+	for (int i = 0; i < 8; i++) {
+		Vector3 corner = {
+		  (i & 1) ? aabb.max.x : aabb.min.x, (i & 2) ? aabb.max.y : aabb.min.y,
+		  (i & 4) ? aabb.max.z : aabb.min.z};
+		float x = corner.x * m[0][0] + corner.y * m[1][0] + corner.z * m[2][0] + m[3][0];
+		float y = corner.x * m[0][1] + corner.y * m[1][1] + corner.z * m[2][1] + m[3][1];
+		float z = corner.x * m[0][2] + corner.y * m[1][2] + corner.z * m[2][2] + m[3][2];
+		float w = corner.x * m[0][3] + corner.y * m[1][3] + corner.z * m[2][3] + m[3][3];
+		// ニア面をまたぐものは判定しない
+		if (z < 0.0f || w <= 0.0f) {
+			return true;
+		}
+		float inverseW = 1.0f / w;
+		float screenX = (x * inverseW * 0.5f + 0.5f) * static_cast<float>(width_);
+		float screenY = (0.5f - y * inverseW * 0.5f) * static_cast<float>(height_);
+		minX = (std::min)(minX, screenX);
+		maxX = (std::max)(maxX, screenX);
+		minY = (std::min)(minY, screenY);
+		maxY = (std::max)(maxY, screenY);
+		minZ = (std::min)(minZ, z * inverseW);
+	}
+
+	// 画面外の判定は視錐台カリングに任せる
+	if (maxX < 0.0f || maxY < 0.0f || minX >= static_cast<float>(width_) ||
+	    minY >= static_cast<float>(height_)) {
+		return true;
+	}
+	int32_t pixelMinX = (std::max)(0, static_cast<int32_t>(std::floor(minX)));
+	int32_t pixelMinY = (std::max)(0, static_cast<int32_t>(std::floor(minY)));
+	int32_t pixelMaxX =
+	  (std::min)(static_cast<int32_t>(width_) - 1, static_cast<int32_t>(std::floor(maxX)));
+	int32_t pixelMaxY =
+	  (std::min)(static_cast<int32_t>(height_) - 1, static_cast<int32_t>(std::floor(maxY)));
+
+	// 矩形が4x4テクセル以内に収まる段を選ぶ
+	uint32_t level = 0;
+	while (level + 1 < hierarchicalDepth_.size() &&
+	       (((pixelMaxX >> level) - (pixelMinX >> level)) >= 4 ||
+	        ((pixelMaxY >> level) - (pixelMinY >> level)) >= 4)) {
+		level++;
+	}
+
+	// 矩形内の遮蔽物の最も奥の深度より手前にあれば見える
+	const std::vector<float>& depth = hierarchicalDepth_[level];
+	uint32_t levelWidth = levelWidths_[level];
+	for (int32_t y = pixelMinY >> level; y <= (pixelMaxY >> level); y++) {
+		for (int32_t x = pixelMinX >> level; x <= (pixelMaxX >> level); x++) {
+			if (minZ <= depth[y * levelWidth + x]) {
+				return true;
+			}
+		}
+	}
+
+	occludedCount_.fetch_add(1, std::memory_order_relaxed);
+	return false;
+}
+
+OcclusionCuller::Statistics OcclusionCuller::GetStatistics() const {
+	Statistics statistics;
+	statistics.occluderCount = static_cast<uint32_t>(occluders_.size());
+	statistics.occluderTriangleCount = occluderTriangleCount_;
+	statistics.rasterizedTriangleCount = triangleCount_.load(std::memory_order_relaxed);
+	statistics.testCount = testCount_.load(std::memory_order_relaxed);
+	statistics.occludedCount = occludedCount_.load(std::memory_order_relaxed);
+	return statistics;
+}
+
+void OcclusionCuller::SetupTriangles(const Occluder& occluder) {
+	const OccluderMesh& mesh = *occluder.mesh;
+	const auto& m = occluder.matWorldViewProjection.m;
+
+	// 全頂点をクリップ座標に変換（行ベクトル×行列を4要素まとめて計算）
+	tClipPositions.resize(mesh.positions.size() * 4);
+	__m128 row0 = _mm_loadu_ps(m[0]);
+	__m128 row1 = _mm_loadu_ps(m[1]);
+	__m128 row2 = _mm_loadu_ps(m[2]);
+	__m128 row3 = _mm_loadu_ps(m[3]);
+	for (size_t i = 0; i < mesh.positions.size(); i++) {
+		const Vector3& position = mesh.positions[i];
+		__m128 clip = _mm_add_ps(
+		  _mm_add_ps(
+		    _mm_mul_ps(_mm_set1_ps(position.x), row0), _mm_mul_ps(_mm_set1_ps(position.y), row1)),
+		  _mm_add_ps(_mm_mul_ps(_mm_set1_ps(position.z), row2), row3));
+		_mm_storeu_ps(&tClipPositions[i * 4], clip);
+	}
+
+	for (size_t i = 0; i + 2 < mesh.indices.size(); i += 3) {
+		float clip[3][4];
+		for (int j = 0; j < 3; j++) {
+			std::copy_n(&tClipPositions[mesh.indices[i + j] * 4], 4, clip[j]);
+		}
+		if (IsTriviallyRejected(clip)) {
+			continue;
+		}
+
+		// ニア面の内側にある頂点の数
+		int insideCount = 0;
+		for (int j = 0; j < 3; j++) {
+			insideCount += clip[j][2] >= 0.0f ? 1 : 0;
+		}
+		if (insideCount == 3) {
+			EmitTriangle(clip);
+			continue;
+		}
+
+		// ニア面で切って最大4角形にし、扇形に2枚へ分ける
+		float polygon[4][4];
+		int polygonCount = 0;
+		for (int j = 0; j < 3; j++) {
+			const float* current = clip[j];
+			const float* next = clip[(j + 1) % 3];
+			bool currentInside = current[2] >= 0.0f;
+			bool nextInside = next[2] >= 0.0f;
+			if (currentInside) {
+				std::copy_n(current, 4, polygon[polygonCount++]);
+			}
+			if (currentInside != nextInside) {
+				float t = current[2] / (current[2] - next[2]);
+				LerpClipVertex(current, next, t, polygon[polygonCount++]);
+			}
+		}
+		for (int j = 1; j + 1 < polygonCount; j++) {
+			float triangle[3][4];
+			std::copy_n(polygon[0], 4, triangle[0]);
+			std::copy_n(polygon[j], 4, triangle[1]);
+			std::copy_n(polygon[j + 1], 4, triangle[2]);
+			EmitTriangle(triangle);
+		}
+	}
+}
+
+void OcclusionCuller::EmitTriangle(const float (*clip)[4]) {
+	Triangle triangle;
+	for (int i = 0; i < 3; i++) {
+		float inverseW = 1.0f / clip[i][3];
+		triangle.x[i] = (clip[i][0] * inverseW * 0.5f + 0.5f) * static_cast<float>(width_);
+		triangle.y[i] = (0.5f - clip[i][1] * inverseW * 0.5f) * static_cast<float>(height_);
+		triangle.z[i] = clip[i][2] * inverseW;
+	}
+
+	// 時計回りが表（Y下向きのスクリーン座標で面積が正）。裏面と潰れた三角形は捨てる
+	float area = (triangle.x[1] - triangle.x[0]) * (triangle.y[2] - triangle.y[0]) -
+	             (triangle.x[2] - triangle.x[0]) * (triangle.y[1] - triangle.y[0]);
+	if (!(area > 0.0f)) {
+		return;
+	}
+
+	uint32_t index = triangleCount_.fetch_add(1, std::memory_order_relaxed);
+	assert(index < triangles_.size());
+	triangles_[index] = triangle;
+}
+
+void OcclusionCuller::RasterizeBand(uint32_t rowBegin, uint32_t rowEnd) {
+	float* depth = hierarchicalDepth_[0].data();
+	std::fill(depth + rowBegin * width_, depth + rowEnd * width_, 1.0f);
+
+	const __m128 laneOffset = _mm_setr_ps(0.5f, 1.5f, 2.5f, 3.5f);
+	const __m128 zero = _mm_setzero_ps();
+	uint32_t triangleCount = triangleCount_.load(std::memory_order_relaxed);
+
+	for (uint32_t i = 0; i < triangleCount; i++) {
+		const Triangle& triangle = triangles_[i];
+
+		// ピクセル中心が含まれ得る範囲
+		float minX = (std::min)({triangle.x[0], triangle.x[1], triangle.x[2]});
+		float maxX = (std::max)({triangle.x[0], triangle.x[1], triangle.x[2]});
+		float minY = (std::min)({triangle.y[0], triangle.y[1], triangle.y[2]});
+		float maxY = (std::max)({triangle.y[0], triangle.y[1], triangle.y[2]});
+		float bandTop = static_cast<float>(rowBegin);
+		float bandBottom = static_cast<float>(rowEnd);
+		if (maxY < bandTop || minY >= bandBottom || maxX < 0.0f ||
+		    minX >= static_cast<float>(width_)) {
+			continue;
+		}
+		uint32_t startY = static_cast<uint32_t>((std::max)(bandTop, std::floor(minY)));
+		uint32_t endY = static_cast<uint32_t>((std::min)(bandBottom - 1.0f, std::floor(maxY)));
+		// 4ピクセル単位に揃える
+		uint32_t startX = static_cast<uint32_t>((std::max)(0.0f, std::floor(minX))) & ~3u;
+		uint32_t endX = static_cast<uint32_t>(
+		  (std::min)(static_cast<float>(width_) - 1.0f, std::floor(maxX)));
+
+		// 辺関数 E = A*x + B*y + C（内側で正）。頂点iの対辺をi番とする
+		float edgeA[3], edgeB[3], edgeC[3];
+		for (int e = 0; e < 3; e++) {
+			int a = (e + 1) % 3;
+			int b = (e + 2) % 3;
+			edgeA[e] = triangle.y[a] - triangle.y[b];
+			edgeB[e] = triangle.x[b] - triangle.x[a];
+			edgeC[e] = -(edgeA[e] * triangle.x[a] + edgeB[e] * triangle.y[a]);
+		}
+		// 深度の平面 z = A*x + B*y + C
+		float area = edgeC[0] + edgeC[1] + edgeC[2];
+		float inverseArea = 1.0f / area;
+		float depthA = (edgeA[0] * triangle.z[0] + edgeA[1] * triangle.z[1] +
+		                edgeA[2] * triangle.z[2]) *
+		               inverseArea;
+		float depthB = (edgeB[0] * triangle.z[0] + edgeB[1] * triangle.z[1] +
+		                edgeB[2] * triangle.z[2]) *
+		               inverseArea;
+		float depthC = (edgeC[0] * triangle.z[0] + edgeC[1] * triangle.z[1] +
+		                edgeC[2] * triangle.z[2]) *
+		               inverseArea;
+
+		__m128 stepE0 = _mm_set1_ps(edgeA[0] * 4.0f);
+		__m128 stepE1 = _mm_set1_ps(edgeA[1] * 4.0f);
+		__m128 stepE2 = _mm_set1_ps(edgeA[2] * 4.0f);
+		__m128 stepZ = _mm_set1_ps(depthA * 4.0f);
+		__m128 pixelX = _mm_add_ps(_mm_set1_ps(static_cast<float>(startX)), laneOffset);
+
+		for (uint32_t y = startY; y <= endY; y++) {
+			// 行頭の4ピクセル分の値
+			float centerY = static_cast<float>(y) + 0.5f;
+			__m128 e0 = _mm_add_ps(
+			  _mm_mul_ps(_mm_set1_ps(edgeA[0]), pixelX),
+			  _mm_set1_ps(edgeB[0] * centerY + edgeC[0]));
+			__m128 e1 = _mm_add_ps(
+			  _mm_mul_ps(_mm_set1_ps(edgeA[1]), pixelX),
+			  _mm_set1_ps(edgeB[1] * centerY + edgeC[1]));
+			__m128 e2 = _mm_add_ps(
+			  _mm_mul_ps(_mm_set1_ps(edgeA[2]), pixelX),
+			  _mm_set1_ps(edgeB[2] * centerY + edgeC[2]));
+			__m128 z = _mm_add_ps(
+			  _mm_mul_ps(_mm_set1_ps(depthA), pixelX), _mm_set1_ps(depthB * centerY + depthC));
+
+			float* row = depth + y * width_;
+			for (uint32_t x = startX; x <= endX; x += 4) {
+				__m128 inside = _mm_and_ps(
+				  _mm_and_ps(_mm_cmpge_ps(e0, zero), _mm_cmpge_ps(e1, zero)),
+				  _mm_cmpge_ps(e2, zero));
+				if (_mm_movemask_ps(inside)) {
+					// 手前の深度を残す
+					__m128 old = _mm_loadu_ps(row + x);
+					__m128 nearest = _mm_min_ps(old, z);
+					_mm_storeu_ps(
+					  row + x, _mm_or_ps(_mm_and_ps(inside, nearest), _mm_andnot_ps(inside, old)));
+				}
+				e0 = _mm_add_ps(e0, stepE0);
+				e1 = _mm_add_ps(e1, stepE1);
+				e2 = _mm_add_ps(e2, stepE2);
+				z = _mm_add_ps(z, stepZ);
+			}
+		}
+	}
+}
+
+void OcclusionCuller::BuildHierarchyLevel(uint32_t level, uint32_t rowBegin, uint32_t rowEnd) {
+	const float* source = hierarchicalDepth_[level - 1].data();
+	float* destination = hierarchicalDepth_[level].data();
+	uint32_t sourceWidth = levelWidths_[level - 1];
+	uint32_t sourceHeight = levelHeights_[level - 1];
+	uint32_t destinationWidth = levelWidths_[level];
+
+	for (uint32_t y = rowBegin; y < rowEnd; y++) {
+		// 奇数サイズの端は最後の行・列を重ねて使う
+		const float* row0 = source + (y * 2) * sourceWidth;
+		const float* row1 = source + (std::min)(y * 2 + 1, sourceHeight - 1) * sourceWidth;
+		float* output = destination + y * destinationWidth;
+
+		uint32_t x = 0;
+		// 8ピクセル→4テクセルをまとめて処理
+		for (; x * 2 + 8 <= sourceWidth; x += 4) {
+			const float* source0 = row0 + x * 2;
+			const float* source1 = row1 + x * 2;
+			__m128 left = _mm_max_ps(_mm_loadu_ps(source0), _mm_loadu_ps(source1));
+			__m128 right = _mm_max_ps(_mm_loadu_ps(source0 + 4), _mm_loadu_ps(source1 + 4));
+			__m128 even = _mm_shuffle_ps(left, right, _MM_SHUFFLE(2, 0, 2, 0));
+			__m128 odd = _mm_shuffle_ps(left, right, _MM_SHUFFLE(3, 1, 3, 1));
+			_mm_storeu_ps(output + x, _mm_max_ps(even, odd));
+		}
+		// 端数
+		for (; x < destinationWidth; x++) {
+			uint32_t x0 = x * 2;
+			uint32_t x1 = (std::min)(x0 + 1, sourceWidth - 1);
+			output[x] = (std::max)({row0[x0], row0[x1], row1[x0], row1[x1]});
+		}
+	}
+}
@@ -0,0 +1,144 @@
+#pragma once
+
+#include "Culling.h"
+#include "Matrix4x4.h"
+#include "Vector3.h"
+#include <atomic>
+#include <cstdint>
+#include <vector>
+
+/// <summary>
+/// 遮蔽物メッシュ（描画用メッシュの低ポリゴン版。位置と三角形だけを持つ）
+/// </summary>
+struct OccluderMesh {
+	std::vector<Vector3> positions; // 頂点座標（ローカル座標系）
+	std::vector<uint32_t> indices;  // 三角形リストのインデックス
+};
+
+/// <summary>
+/// ソフトウェア遮蔽カリング
+/// 遮蔽物をCPUで低解像度の深度バッファに描き、階層Zで境界ボックスの隠れ判定を行う
+/// </summary>
+class OcclusionCuller {
+public: // 定数
+	// 深度バッファの既定サイズ
+	static const uint32_t kDefaultWidth = 256;
+	static const uint32_t kDefaultHeight = 128;
+	// ラスタライズを分担する帯の高さ（ピクセル）
+	static const uint32_t kBandHeight = 8;
+
+public: // サブクラス
+	// 統計
+	struct Statistics {
+		uint32_t occluderCount = 0;           // 遮蔽物の数
+		uint32_t occluderTriangleCount = 0;   // 遮蔽物の三角形数
+		uint32_t rasterizedTriangleCount = 0; // クリップ・背面カリング後の三角形数
+		uint32_t testCount = 0;               // 隠れ判定の回数
+		uint32_t occludedCount = 0;           // 隠れていると判定した回数
+	};
+
+public: // メンバ関数
+	/// <summary>
+	/// 初期化
+	/// </summary>
+	/// <param name="width">深度バッファの幅（4の倍数）</param>
+	/// <param name="height">深度バッファの高さ</param>
+	void Initialize(uint32_t width = kDefaultWidth, uint32_t height = kDefaultHeight);
+
+	/// <summary>
+	/// フレーム開始。遮蔽物を全て破棄する
+	/// </summary>
+	/// <param name="viewProjection">ViewProjection::matView×matProjection</param>
+	void BeginFrame(const Matrix4x4& viewProjection);
+
+	/// <summary>
+	/// 遮蔽物を追加する。Renderまでメッシュを破棄しないこと
+	/// </summary>
+	/// <param name="mesh">遮蔽物メッシュ</param>
+	/// <param name="matWorld">ワールド行列（WorldTransform::matWorld_）</param>
+	void AddOccluder(const OccluderMesh* mesh, const Matrix4x4& matWorld);
+
+	/// <summary>
+	/// 遮蔽物を深度バッファに描画し、階層Zを作る（ワーカースレッドで並列実行）
+	/// </summary>
+	void Render();
+
+	/// <summary>
+	/// AABBが遮蔽物に完全に隠れていないか
+	/// 判定できない場合（カメラをまたぐ等）は見えるとみなす
+	/// </summary>
+	/// <param name="aabb">ワールド座標系のAABB</param>
+	/// <returns>見える可能性があるか</returns>
+	bool IsVisible(const AABB& aabb) const;
+
+	/// <summary>
+	/// 深度バッファを取得（値が小さいほど手前。遮蔽物がなければ1）
+	/// </summary>
+	const std::vector<float>& GetDepthBuffer() const { return hierarchicalDepth_[0]; }
+
+	/// <summary>
+	/// 深度バッファのサイズを取得
+	/// </summary>
+	uint32_t GetWidth() const { return width_; }
+	uint32_t GetHeight() const { return height_; }
+
+	/// <summary>
+	/// 統計を取得
+	/// </summary>
+	Statistics GetStatistics() const;
+
+private: // サブクラス
+	// 遮蔽物の登録情報
+	struct Occluder {
+		const OccluderMesh* mesh;
+		Matrix4x4 matWorldViewProjection;
+	};
+
+	// スクリーン座標系の三角形（表向きに揃えてある）
+	struct Triangle {
+		float x[3];
+		float y[3];
+		float z[3];
+	};
+
+private: // メンバ関数
+	/// <summary>
+	/// 遮蔽物の頂点を変換し、クリップして三角形を出力する
+	/// </summary>
+	void SetupTriangles(const Occluder& occluder);
+
+	/// <summary>
+	/// クリップ座標の三角形をスクリーン座標に変換して出力する
+	/// </summary>
+	void EmitTriangle(const float (*clip)[4]);
+
+	/// <summary>
+	/// 帯の範囲の三角形をラスタライズする
+	/// </summary>
+	void RasterizeBand(uint32_t rowBegin, uint32_t rowEnd);
+
+	/// <summary>
+	/// 階層Zの1段を作る
+	/// </summary>
+	void BuildHierarchyLevel(uint32_t level, uint32_t rowBegin, uint32_t rowEnd);
+
+private: // メンバ変数
+	// 深度バッファのサイズ
+	uint32_t width_ = 0;
+	uint32_t height_ = 0;
+	// 階層Z（0段目が深度バッファ本体。上の段は2x2の最大値）
+	std::vector<std::vector<float>> hierarchicalDepth_;
+	std::vector<uint32_t> levelWidths_;
+	std::vector<uint32_t> levelHeights_;
+	// ビュープロジェクション行列
+	Matrix4x4 viewProjection_ = {};
+	// 遮蔽物
+	std::vector<Occluder> occluders_;
+	// セットアップ済みの三角形
+	std::vector<Triangle> triangles_;
+	std::atomic<uint32_t> triangleCount_{0};
+	// 統計
+	uint32_t occluderTriangleCount_ = 0;
+	mutable std::atomic<uint32_t> testCount_{0};
+	mutable std::atomic<uint32_t> occludedCount_{0};
+};
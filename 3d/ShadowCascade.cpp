@@ -0,0 +1,113 @@
+﻿#include "ShadowCascade.h"
+#include "MathUtility.h"
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+
+namespace {
+
+// ライトの向きを基準にしたビュー行列（回転のみ、左手系）
+Matrix4x4 MakeLightView(const Vector3& lightDirection) {
+	Vector3 forward = Normalize(lightDirection);
+	// 真上・真下からの光でも外積が潰れないように基準の上方向を切り替える
+	Vector3 up = std::abs(forward.y) < 0.99f ? Vector3{0, 1, 0} : Vector3{0, 0, 1};
+	Vector3 right = Normalize(Cross(up, forward));
+	up = Cross(forward, right);
+
+	// 行ベクトル規約なので各軸を列に並べる
+	Matrix4x4 view{};
+	const Vector3 axes[3] = {right, up, forward};
+	for (int i = 0; i < 3; i++) {
+		view.m[0][i] = axes[i].x;
+		view.m[1][i] = axes[i].y;
+		view.m[2][i] = axes[i].z;
+	}
+	view.m[3][3] = 1.0f;
+	return view;
+}
+
+} // namespace
+
+void ComputeCascadeSplits(float nearZ, float farZ, uint32_t count, float lambda, float* splits) {
+	assert(0.0f < nearZ && nearZ < farZ);
+	assert(0 < count && count <= kMaxShadowCascades && splits);
+	splits[0] = nearZ;
+	for (uint32_t i = 1; i < count; i++) {
+		float t = static_cast<float>(i) / count;
+		float logSplit = nearZ * std::pow(farZ / nearZ, t);
+		float uniformSplit = nearZ + (farZ - nearZ) * t;
+		splits[i] = lambda * logSplit + (1.0f - lambda) * uniformSplit;
+	}
+	splits[count] = farZ;
+}
+
+void ComputeShadowCascades(
+  const ShadowCascadeSettings& settings, const ShadowCascadeCamera& camera,
+  const Vector3& lightDirection, ShadowCascade* cascades) {
+	assert(cascades && settings.resolution > 2);
+	const uint32_t count = settings.cascadeCount;
+	float splits[kMaxShadowCascades + 1];
+	float farZ = (std::min)(settings.shadowDistance, camera.farZ);
+	ComputeCascadeSplits(camera.nearZ, farZ, count, settings.splitLambda, splits);
+
+	// カメラの位置と視線（ビュー行列は回転と平行移動だけなので転置で逆変換できる）
+	const auto& v = camera.view.m;
+	Vector3 cameraPosition = {
+	  -(v[3][0] * v[0][0] + v[3][1] * v[0][1] + v[3][2] * v[0][2]),
+	  -(v[3][0] * v[1][0] + v[3][1] * v[1][1] + v[3][2] * v[1][2]),
+	  -(v[3][0] * v[2][0] + v[3][1] * v[2][1] + v[3][2] * v[2][2])};
+	Vector3 cameraForward = {v[0][2], v[1][2], v[2][2]};
+
+	// 深度zの断面の角までの距離の2乗は z^2 * (1 + k)
+	float tanHalfFov = std::tan(camera.fovAngleY * 0.5f);
+	float k = tanHalfFov * tanHalfFov * (1.0f + camera.aspectRatio * camera.aspectRatio);
+
+	const Matrix4x4 lightView = MakeLightView(lightDirection);
+	for (uint32_t i = 0; i < count; i++) {
+		ShadowCascade& cascade = cascades[i];
+		float n = splits[i];
+		float f = splits[i + 1];
+		cascade.splitNear = n;
+		cascade.splitFar = f;
+
+		// 手前と奥の断面の角から等距離の点を中心にする（奥の断面より先に出るなら奥の断面の中心）
+		float centerZ = (std::min)((1.0f + k) * (f + n) * 0.5f, f);
+		float radius = std::sqrt((f - centerZ) * (f - centerZ) + f * f * k);
+		// 半径の誤差でテクセルの大きさが揺れないように切り上げておく
+		radius = std::ceil(radius * 16.0f) / 16.0f;
+		cascade.bounds.center = Add(cameraPosition, Multiply(centerZ, cameraForward));
+		cascade.bounds.radius = radius;
+
+		// ライト空間の中心をテクセル単位に揃える
+		// 揃えた分だけ球がずれても収まるように、1テクセル分広く写す
+		float resolution = static_cast<float>(settings.resolution);
+		float halfExtent = radius * resolution / (resolution - 2.0f);
+		float texelSize = 2.0f * halfExtent / resolution;
+		Vector3 center = Transform(cascade.bounds.center, lightView);
+		center.x = std::floor(center.x / texelSize) * texelSize;
+		center.y = std::floor(center.y / texelSize) * texelSize;
+		cascade.texelSize = texelSize;
+
+		// 球を包む正射影。手前の物はラスタライザで深度をクランプして描く
+		Matrix4x4 projection{};
+		projection.m[0][0] = 1.0f / halfExtent;
+		projection.m[1][1] = 1.0f / halfExtent;
+		projection.m[2][2] = 0.5f / radius;
+		projection.m[3][0] = -center.x / halfExtent;
+		projection.m[3][1] = -center.y / halfExtent;
+		projection.m[3][2] = -(center.z - radius) * 0.5f / radius;
+		projection.m[3][3] = 1.0f;
+
+		cascade.lightView = lightView;
+		cascade.lightProjection = projection;
+		cascade.lightViewProjection = Multiply(lightView, projection);
+
+		// 光源側の物も影を落とすので手前の平面は判定しない
+		cascade.casterFrustum = MakeFrustum(cascade.lightViewProjection);
+		cascade.casterFrustum.planes[Frustum::kNear] = {0.0f, 0.0f, 0.0f, 1.0f};
+	}
+}
+
+bool IsShadowCaster(const ShadowCascade& cascade, const Sphere& sphere) {
+	return IsVisible(cascade.casterFrustum, sphere);
+}
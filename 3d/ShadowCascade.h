@@ -0,0 +1,72 @@
+#pragma once
+
+#include "Culling.h"
+#include "Matrix4x4.h"
+#include "Vector3.h"
+#include <cstdint>
+
+// カスケード数の上限
+const uint32_t kMaxShadowCascades = 4;
+
+/// <summary>
+/// カスケードシャドウマップの設定
+/// </summary>
+struct ShadowCascadeSettings {
+	uint32_t cascadeCount = 4;     // カスケード数
+	float shadowDistance = 200.0f; // 影を描く最大の深度（ビュー空間）
+	float splitLambda = 0.75f;     // 対数分割と均等分割の混合率（1で対数分割）
+	uint32_t resolution = 2048;    // シャドウマップ1枚の解像度
+};
+
+/// <summary>
+/// カメラの設定（ViewProjectionの値を渡す）
+/// </summary>
+struct ShadowCascadeCamera {
+	Matrix4x4 view;           // ビュー行列
+	float fovAngleY = 0.785f; // 垂直方向視野角
+	float aspectRatio = 1.0f; // アスペクト比
+	float nearZ = 0.1f;       // 深度限界（手前側）
+	float farZ = 1000.0f;     // 深度限界（奥側）
+};
+
+/// <summary>
+/// カスケード1枚分
+/// </summary>
+struct ShadowCascade {
+	float splitNear;               // 担当する深度範囲の手前（ビュー空間）
+	float splitFar;                // 担当する深度範囲の奥（ビュー空間）
+	Sphere bounds;                 // 深度範囲の視錐台を包む球（ワールド座標系）
+	float texelSize;               // 1テクセルのワールドでの大きさ
+	Matrix4x4 lightView;           // ワールド → ライト空間（回転のみ）
+	Matrix4x4 lightProjection;     // ライト空間 → シャドウマップのクリップ空間（正射影）
+	Matrix4x4 lightViewProjection; // lightView × lightProjection
+	Frustum casterFrustum;         // 影を落とす物の判定用。ライト側には無限に伸ばしてある
+};
+
+/// <summary>
+/// 深度の分割位置を求める（対数分割と均等分割を混ぜる実用分割法）
+/// </summary>
+/// <param name="nearZ">手前の深度</param>
+/// <param name="farZ">奥の深度</param>
+/// <param name="count">分割数</param>
+/// <param name="lambda">混合率（1で対数分割、0で均等分割）</param>
+/// <param name="splits">分割位置の出力先（count+1個。先頭はnearZ、末尾はfarZ）</param>
+void ComputeCascadeSplits(float nearZ, float farZ, uint32_t count, float lambda, float* splits);
+
+/// <summary>
+/// 平行光源のカスケードを求める
+/// 各カスケードは深度範囲を包む球に合わせるのでカメラが回っても大きさが変わらず、
+/// 位置はテクセル単位に揃えるのでカメラが動いても影の輪郭がちらつかない
+/// </summary>
+/// <param name="settings">設定</param>
+/// <param name="camera">カメラ</param>
+/// <param name="lightDirection">光の進む向き</param>
+/// <param name="cascades">出力先（settings.cascadeCount個）</param>
+void ComputeShadowCascades(
+    const ShadowCascadeSettings& settings, const ShadowCascadeCamera& camera,
+    const Vector3& lightDirection, ShadowCascade* cascades);
+
+/// <summary>
+/// 境界球がカスケードに影を落とし得るか
+/// </summary>
+bool IsShadowCaster(const ShadowCascade& cascade, const Sphere& sphere);
@@ -0,0 +1,164 @@
+﻿#include "ShadowMap.h"
+#include "TextureManager.h"
+#include <cassert>
+#include <d3dx12.h>
+
+// シェーダー側のShadowと同じ並びで、配列の要素は16バイト境界に揃える
+static_assert(sizeof(ShadowMap::CascadeData) % 16 == 0);
+static_assert(sizeof(ShadowMap::ConstBufferData) % 16 == 0);
+
+namespace {
+
+// 定数バッファ1個分の大きさ（256バイト境界）
+const UINT kCascadeBufferStride = (sizeof(ConstBufferDataViewProjection) + 0xff) & ~0xff;
+
+} // namespace
+
+ShadowMap* ShadowMap::GetInstance() {
+	static ShadowMap instance;
+	return &instance;
+}
+
+void ShadowMap::Initialize(ID3D12Device* device) {
+	assert(device);
+	HRESULT result;
+
+	// 深度テクスチャ配列（深度として書き、floatとして読むので型なし）
+	CD3DX12_HEAP_PROPERTIES textureHeapProps = CD3DX12_HEAP_PROPERTIES(D3D12_HEAP_TYPE_DEFAULT);
+	CD3DX12_RESOURCE_DESC textureDesc = CD3DX12_RESOURCE_DESC::Tex2D(
+	  DXGI_FORMAT_R32_TYPELESS, kResolution, kResolution, kMaxShadowCascades, 1, 1, 0,
+	  D3D12_RESOURCE_FLAG_ALLOW_DEPTH_STENCIL);
+	CD3DX12_CLEAR_VALUE clearValue = CD3DX12_CLEAR_VALUE(DXGI_FORMAT_D32_FLOAT, 1.0f, 0);
+	result = device->CreateCommittedResource(
+	  &textureHeapProps, D3D12_HEAP_FLAG_NONE, &textureDesc,
+	  D3D12_RESOURCE_STATE_PIXEL_SHADER_RESOURCE, &clearValue, IID_PPV_ARGS(&texture_));
+	assert(SUCCEEDED(result));
+
+	// カスケード毎の深度ステンシルビュー
+	D3D12_DESCRIPTOR_HEAP_DESC dsvHeapDesc{};
+	dsvHeapDesc.Type = D3D12_DESCRIPTOR_HEAP_TYPE_DSV;
+	dsvHeapDesc.NumDescriptors = kMaxShadowCascades;
+	result = device->CreateDescriptorHeap(&dsvHeapDesc, IID_PPV_ARGS(&dsvHeap_));
+	assert(SUCCEEDED(result));
+	dsvIncrementSize_ = device->GetDescriptorHandleIncrementSize(D3D12_DESCRIPTOR_HEAP_TYPE_DSV);
+	for (uint32_t i = 0; i < kMaxShadowCascades; i++) {
+		D3D12_DEPTH_STENCIL_VIEW_DESC dsvDesc{};
+		dsvDesc.Format = DXGI_FORMAT_D32_FLOAT;
+		dsvDesc.ViewDimension = D3D12_DSV_DIMENSION_TEXTURE2DARRAY;
+		dsvDesc.Texture2DArray.FirstArraySlice = i;
+		dsvDesc.Texture2DArray.ArraySize = 1;
+		device->CreateDepthStencilView(
+		  texture_.Get(), &dsvDesc,
+		  CD3DX12_CPU_DESCRIPTOR_HANDLE(
+		    dsvHeap_->GetCPUDescriptorHandleForHeapStart(), i, dsvIncrementSize_));
+	}
+
+	// 全カスケードを1つのシェーダリソースビューで参照する
+	D3D12_SHADER_RESOURCE_VIEW_DESC srvDesc{};
+	srvDesc.Format = DXGI_FORMAT_R32_FLOAT;
+	srvDesc.Shader4ComponentMapping = D3D12_DEFAULT_SHADER_4_COMPONENT_MAPPING;
+	srvDesc.ViewDimension = D3D12_SRV_DIMENSION_TEXTURE2DARRAY;
+	srvDesc.Texture2DArray.MipLevels = 1;
+	srvDesc.Texture2DArray.ArraySize = kMaxShadowCascades;
+	textureHandle_ = TextureManager::Register("ShadowMap", texture_.Get(), srvDesc);
+
+	// 定数バッファ
+	CD3DX12_HEAP_PROPERTIES uploadHeapProps = CD3DX12_HEAP_PROPERTIES(D3D12_HEAP_TYPE_UPLOAD);
+	CD3DX12_RESOURCE_DESC cascadeDesc =
+	  CD3DX12_RESOURCE_DESC::Buffer(kCascadeBufferStride * kMaxShadowCascades);
+	result = device->CreateCommittedResource(
+	  &uploadHeapProps, D3D12_HEAP_FLAG_NONE, &cascadeDesc, D3D12_RESOURCE_STATE_GENERIC_READ,
+	  nullptr, IID_PPV_ARGS(&cascadeBuff_));
+	assert(SUCCEEDED(result));
+	result = cascadeBuff_->Map(0, nullptr, (void**)&cascadeMap_);
+	assert(SUCCEEDED(result));
+
+	CD3DX12_RESOURCE_DESC constDesc =
+	  CD3DX12_RESOURCE_DESC::Buffer((sizeof(ConstBufferData) + 0xff) & ~0xff);
+	result = device->CreateCommittedResource(
+	  &uploadHeapProps, D3D12_HEAP_FLAG_NONE, &constDesc, D3D12_RESOURCE_STATE_GENERIC_READ,
+	  nullptr, IID_PPV_ARGS(&constBuff_));
+	assert(SUCCEEDED(result));
+	result = constBuff_->Map(0, nullptr, (void**)&constMap_);
+	assert(SUCCEEDED(result));
+
+	// 最初のUpdateまでは影を落とさない
+	*constMap_ = {};
+	constMap_->inverseResolution = 1.0f / kResolution;
+	settings_.resolution = kResolution;
+}
+
+void ShadowMap::Update(const ViewProjection& viewProjection, const Vector3& lightDirection) {
+	ShadowCascadeCamera camera;
+	camera.view = viewProjection.matView;
+	camera.fovAngleY = viewProjection.fovAngleY;
+	camera.aspectRatio = viewProjection.aspectRatio;
+	camera.nearZ = viewProjection.nearZ;
+	camera.farZ = viewProjection.farZ;
+	ComputeShadowCascades(settings_, camera, lightDirection, cascades_);
+
+	for (uint32_t i = 0; i < settings_.cascadeCount; i++) {
+		const ShadowCascade& cascade = cascades_[i];
+		// 描画用
+		ConstBufferDataViewProjection* cascadeData =
+		  reinterpret_cast<ConstBufferDataViewProjection*>(cascadeMap_ + kCascadeBufferStride * i);
+		cascadeData->view = cascade.lightView;
+		cascadeData->projection = cascade.lightProjection;
+		cascadeData->cameraPos = cascade.bounds.center;
+		// 参照用
+		constMap_->cascades[i].lightViewProjection = cascade.lightViewProjection;
+		constMap_->cascades[i].splitFar = cascade.splitFar;
+		constMap_->cascades[i].texelSize = cascade.texelSize;
+	}
+	constMap_->cascadeCount = enabled_ ? settings_.cascadeCount : 0;
+}
+
+void ShadowMap::Begin(ID3D12GraphicsCommandList* commandList) {
+	CD3DX12_RESOURCE_BARRIER barrier = CD3DX12_RESOURCE_BARRIER::Transition(
+	  texture_.Get(), D3D12_RESOURCE_STATE_PIXEL_SHADER_RESOURCE,
+	  D3D12_RESOURCE_STATE_DEPTH_WRITE);
+	commandList->ResourceBarrier(1, &barrier);
+}
+
+void ShadowMap::SetCascade(ID3D12GraphicsCommandList* commandList, uint32_t index) {
+	assert(index < settings_.cascadeCount);
+	CD3DX12_CPU_DESCRIPTOR_HANDLE dsvH = CD3DX12_CPU_DESCRIPTOR_HANDLE(
+	  dsvHeap_->GetCPUDescriptorHandleForHeapStart(), index, dsvIncrementSize_);
+	// 深度だけを描く
+	commandList->OMSetRenderTargets(0, nullptr, false, &dsvH);
+	commandList->ClearDepthStencilView(dsvH, D3D12_CLEAR_FLAG_DEPTH, 1.0f, 0, 0, nullptr);
+
+	// ビューポートの設定
+	CD3DX12_VIEWPORT viewport =
+	  CD3DX12_VIEWPORT(0.0f, 0.0f, float(kResolution), float(kResolution));
+	commandList->RSSetViewports(1, &viewport);
+	// シザリング矩形の設定
+	CD3DX12_RECT rect = CD3DX12_RECT(0, 0, kResolution, kResolution);
+	commandList->RSSetScissorRects(1, &rect);
+}
+
+void ShadowMap::End(ID3D12GraphicsCommandList* commandList) {
+	CD3DX12_RESOURCE_BARRIER barrier = CD3DX12_RESOURCE_BARRIER::Transition(
+	  texture_.Get(), D3D12_RESOURCE_STATE_DEPTH_WRITE,
+	  D3D12_RESOURCE_STATE_PIXEL_SHADER_RESOURCE);
+	commandList->ResourceBarrier(1, &barrier);
+}
+
+void ShadowMap::SetSettings(const ShadowCascadeSettings& settings) {
+	assert(0 < settings.cascadeCount && settings.cascadeCount <= kMaxShadowCascades);
+	settings_ = settings;
+	settings_.resolution = kResolution;
+}
+
+void ShadowMap::SetEnabled(bool enabled) {
+	enabled_ = enabled;
+	// 有効に戻した時は次のUpdateから影を落とす
+	if (!enabled_) {
+		constMap_->cascadeCount = 0;
+	}
+}
+
+D3D12_GPU_VIRTUAL_ADDRESS ShadowMap::GetCascadeViewProjectionAddress(uint32_t index) const {
+	assert(index < settings_.cascadeCount);
+	return cascadeBuff_->GetGPUVirtualAddress() + kCascadeBufferStride * index;
+}
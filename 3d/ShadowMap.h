@@ -0,0 +1,136 @@
+#pragma once
+
+#include "ShadowCascade.h"
+#include "ViewProjection.h"
+#include <cstdint>
+#include <d3d12.h>
+#include <wrl.h>
+
+/// <summary>
+/// 平行光源のカスケードシャドウマップ
+/// カスケード毎に1枚ずつ深度を描くテクスチャ配列と、描画用・参照用の定数バッファを管理する
+/// </summary>
+class ShadowMap {
+public: // 定数
+	// シャドウマップ1枚の解像度
+	static const uint32_t kResolution = 2048;
+
+public: // サブクラス
+	// カスケード毎の参照用データ
+	struct CascadeData {
+		Matrix4x4 lightViewProjection; // ワールド → シャドウマップのクリップ空間
+		float splitFar;                // 担当する深度範囲の奥（ビュー空間）
+		float texelSize;               // 1テクセルのワールドでの大きさ
+		float pad[2];                  // パディング
+	};
+
+	// 影を受ける側の定数バッファ用データ構造体（シェーダーのShadowと同じ並び）
+	struct ConstBufferData {
+		CascadeData cascades[kMaxShadowCascades];
+		uint32_t cascadeCount;   // カスケード数（0なら影を落とさない）
+		float inverseResolution; // 1テクセルのテクスチャ座標での大きさ
+		float pad[2];            // パディング
+	};
+
+public: // 静的メンバ関数
+	/// <summary>
+	/// シングルトンインスタンスの取得
+	/// </summary>
+	/// <returns>シングルトンインスタンス</returns>
+	static ShadowMap* GetInstance();
+
+public: // メンバ関数
+	/// <summary>
+	/// 初期化（TextureManagerの初期化後に呼ぶ）
+	/// </summary>
+	/// <param name="device">デバイス</param>
+	void Initialize(ID3D12Device* device);
+
+	/// <summary>
+	/// カメラと光の向きからカスケードを求め、定数バッファに書き込む
+	/// </summary>
+	/// <param name="viewProjection">カメラのビュープロジェクション</param>
+	/// <param name="lightDirection">光の進む向き</param>
+	void Update(const ViewProjection& viewProjection, const Vector3& lightDirection);
+
+	/// <summary>
+	/// 深度の描画を始める（シェーダーリソース → 深度書き込みに遷移）
+	/// </summary>
+	/// <param name="commandList">コマンドリスト</param>
+	void Begin(ID3D12GraphicsCommandList* commandList);
+
+	/// <summary>
+	/// 描画対象をカスケードの1枚にしてクリアする
+	/// </summary>
+	/// <param name="commandList">コマンドリスト</param>
+	/// <param name="index">カスケード番号</param>
+	void SetCascade(ID3D12GraphicsCommandList* commandList, uint32_t index);
+
+	/// <summary>
+	/// 深度の描画を終える（深度書き込み → シェーダーリソースに遷移）
+	/// </summary>
+	/// <param name="commandList">コマンドリスト</param>
+	void End(ID3D12GraphicsCommandList* commandList);
+
+	/// <summary>
+	/// 設定を変更する（次のUpdateから反映）。解像度はkResolutionに固定
+	/// </summary>
+	void SetSettings(const ShadowCascadeSettings& settings);
+	const ShadowCascadeSettings& GetSettings() const { return settings_; }
+
+	/// <summary>
+	/// 影を落とすか設定する。無効の間は参照用のカスケード数を0にする
+	/// </summary>
+	void SetEnabled(bool enabled);
+	bool IsEnabled() const { return enabled_; }
+
+	/// <summary>
+	/// カスケード数と各カスケード（Updateで求めたもの）
+	/// </summary>
+	uint32_t GetCascadeCount() const { return settings_.cascadeCount; }
+	const ShadowCascade& GetCascade(uint32_t index) const { return cascades_[index]; }
+
+	/// <summary>
+	/// カスケードを描く時のビュープロジェクション定数バッファ（ConstBufferDataViewProjection）
+	/// </summary>
+	D3D12_GPU_VIRTUAL_ADDRESS GetCascadeViewProjectionAddress(uint32_t index) const;
+
+	/// <summary>
+	/// 影を受ける側の定数バッファ
+	/// </summary>
+	D3D12_GPU_VIRTUAL_ADDRESS GetConstBufferAddress() const {
+		return constBuff_->GetGPUVirtualAddress();
+	}
+
+	/// <summary>
+	/// シャドウマップのテクスチャハンドル（Texture2DArray）
+	/// </summary>
+	uint32_t GetTextureHandle() const { return textureHandle_; }
+
+private:
+	ShadowMap() = default;
+	~ShadowMap() = default;
+	ShadowMap(const ShadowMap&) = delete;
+	ShadowMap& operator=(const ShadowMap&) = delete;
+
+private: // メンバ変数
+	// 深度テクスチャ配列
+	Microsoft::WRL::ComPtr<ID3D12Resource> texture_;
+	// カスケード毎の深度ステンシルビュー
+	Microsoft::WRL::ComPtr<ID3D12DescriptorHeap> dsvHeap_;
+	UINT dsvIncrementSize_ = 0;
+	// テクスチャハンドル
+	uint32_t textureHandle_ = 0;
+	// カスケード毎のビュープロジェクション定数バッファ（256バイト毎に並べる）
+	Microsoft::WRL::ComPtr<ID3D12Resource> cascadeBuff_;
+	uint8_t* cascadeMap_ = nullptr;
+	// 影を受ける側の定数バッファ
+	Microsoft::WRL::ComPtr<ID3D12Resource> constBuff_;
+	ConstBufferData* constMap_ = nullptr;
+	// 設定
+	ShadowCascadeSettings settings_;
+	// 有効フラグ
+	bool enabled_ = true;
+	// カスケード
+	ShadowCascade cascades_[kMaxShadowCascades] = {};
+};
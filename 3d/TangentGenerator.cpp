@@ -0,0 +1,192 @@
+﻿#include "TangentGenerator.h"
+#include "JobSystem.h"
+#include "VertexMath.h"
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+#include <iterator>
+#include <numbers>
+#include <vector>
+#include <xmmintrin.h>
+
+namespace {
+
+// 並列処理の1ジョブあたりの要素数
+const uint32_t kGrainSize = 4096;
+
+__m128 Scale(__m128 v, float s) { return _mm_mul_ps(v, _mm_set1_ps(s)); }
+
+// 法線に垂直な成分
+__m128 Reject(__m128 v, __m128 normal) { return _mm_sub_ps(v, Scale(normal, Dot(normal, v))); }
+
+// 3つのベクトルをxyz成分毎のレーンに並べたもの（4番目のレーンは使わない）
+struct Lanes {
+	__m128 x, y, z;
+};
+
+Lanes Transpose(__m128 a, __m128 b, __m128 c) {
+	__m128 w = _mm_setzero_ps();
+	_MM_TRANSPOSE4_PS(a, b, c, w);
+	return {a, b, c};
+}
+
+Lanes Broadcast(__m128 v) {
+	return {
+	  _mm_shuffle_ps(v, v, _MM_SHUFFLE(0, 0, 0, 0)), _mm_shuffle_ps(v, v, _MM_SHUFFLE(1, 1, 1, 1)),
+	  _mm_shuffle_ps(v, v, _MM_SHUFFLE(2, 2, 2, 2))};
+}
+
+// レーンを1つずらす（i番目にi+2番目を入れる。3番目のレーンで一巡する）
+__m128 Rotate(__m128 v) { return _mm_shuffle_ps(v, v, _MM_SHUFFLE(3, 1, 0, 2)); }
+
+Lanes Rotate(const Lanes& v) { return {Rotate(v.x), Rotate(v.y), Rotate(v.z)}; }
+
+__m128 Negate(__m128 v) { return _mm_sub_ps(_mm_setzero_ps(), v); }
+
+__m128 Dot(const Lanes& a, const Lanes& b) {
+	return _mm_add_ps(
+	  _mm_add_ps(_mm_mul_ps(a.x, b.x), _mm_mul_ps(a.y, b.y)), _mm_mul_ps(a.z, b.z));
+}
+
+Lanes Scale(const Lanes& v, __m128 s) {
+	return {_mm_mul_ps(v.x, s), _mm_mul_ps(v.y, s), _mm_mul_ps(v.z, s)};
+}
+
+Lanes Reject(const Lanes& v, const Lanes& normal) {
+	__m128 d = Dot(normal, v);
+	return {
+	  _mm_sub_ps(v.x, _mm_mul_ps(normal.x, d)), _mm_sub_ps(v.y, _mm_mul_ps(normal.y, d)),
+	  _mm_sub_ps(v.z, _mm_mul_ps(normal.z, d))};
+}
+
+// 正規化（長さ0なら0のまま）
+Lanes Normalize(const Lanes& v) {
+	__m128 lengthSq = Dot(v, v);
+	__m128 valid = _mm_cmpgt_ps(lengthSq, _mm_setzero_ps());
+	__m128 inv = _mm_and_ps(_mm_div_ps(_mm_set1_ps(1.0f), _mm_sqrt_ps(lengthSq)), valid);
+	return Scale(v, inv);
+}
+
+// 逆余弦の多項式近似（Abramowitz & Stegun 4.4.46、誤差2e-8程度）
+__m128 Acos(__m128 x) {
+	const float kCoefficients[] = {
+	  -0.0012624911f, 0.0066700901f, -0.0170881256f, 0.0308918810f,
+	  -0.0501743046f, 0.0889789874f, -0.2145988016f, 1.5707963050f,
+	};
+	__m128 one = _mm_set1_ps(1.0f);
+	__m128 negative = _mm_cmplt_ps(x, _mm_setzero_ps());
+	__m128 a = _mm_min_ps(_mm_max_ps(x, Negate(x)), one);
+	__m128 polynomial = _mm_set1_ps(kCoefficients[0]);
+	for (size_t i = 1; i < std::size(kCoefficients); i++) {
+		polynomial = _mm_add_ps(_mm_mul_ps(polynomial, a), _mm_set1_ps(kCoefficients[i]));
+	}
+	__m128 result = _mm_mul_ps(_mm_sqrt_ps(_mm_sub_ps(one, a)), polynomial);
+	// 負の値はπから引く
+	__m128 mirrored = _mm_sub_ps(_mm_set1_ps(std::numbers::pi_v<float>), result);
+	return _mm_or_ps(_mm_and_ps(negative, mirrored), _mm_andnot_ps(negative, result));
+}
+
+// 3つのレーンをそれぞれの頂点の合計に足す
+void AddLanes(Vector3* sums, const uint32_t* indices, const Lanes& v) {
+	float x[4], y[4], z[4];
+	_mm_storeu_ps(x, v.x);
+	_mm_storeu_ps(y, v.y);
+	_mm_storeu_ps(z, v.z);
+	for (int i = 0; i < 3; i++) {
+		Vector3& sum = sums[indices[i]];
+		sum = {sum.x + x[i], sum.y + y[i], sum.z + z[i]};
+	}
+}
+
+// 要素数が多ければ並列に、少なければそのまま処理する
+template<class Function> void ForEachRange(uint32_t count, const Function& function) {
+	if (count < TangentGenerator::kParallelThreshold) {
+		function(0, count);
+	} else {
+		JobSystem::GetInstance()->ParallelFor(count, kGrainSize, function);
+	}
+}
+
+} // namespace
+
+void TangentGenerator::Generate(const VertexInput& vertices, Vector4* tangents) {
+	assert(vertices.positions && vertices.normals && vertices.uvs && tangents);
+	assert(vertices.indices && vertices.indexCount % 3 == 0);
+	const uint32_t* indices = vertices.indices;
+	const uint32_t cornerCount = static_cast<uint32_t>(vertices.indexCount);
+	const uint32_t triangleCount = cornerCount / 3;
+	auto position = [&vertices](uint32_t index) {
+		return Load(At(vertices.positions, vertices.positionStride, index));
+	};
+	auto normal = [&vertices](uint32_t index) {
+		return Load(At(vertices.normals, vertices.normalStride, index));
+	};
+	auto uv = [&vertices](uint32_t index) -> const Vector2& {
+		return At(vertices.uvs, vertices.uvStride, index);
+	};
+
+	// 角毎の寄与（接線・従法線の方向×接平面上での角の大きさ）を頂点毎に合計する
+	// 書き込み先の頂点が三角形同士で重なるので、ここは順に処理する
+	const uint32_t vertexCount = vertices.vertexCount;
+	std::vector<Vector3> tangentSums(vertexCount, Vector3{0.0f, 0.0f, 0.0f});
+	std::vector<Vector3> bitangentSums(vertexCount, Vector3{0.0f, 0.0f, 0.0f});
+	for (uint32_t t = 0; t < triangleCount; t++) {
+		const uint32_t* corner = &indices[t * 3];
+		assert(corner[0] < vertexCount && corner[1] < vertexCount && corner[2] < vertexCount);
+		__m128 p0 = position(corner[0]);
+		__m128 edge1 = _mm_sub_ps(position(corner[1]), p0);
+		__m128 edge2 = _mm_sub_ps(position(corner[2]), p0);
+		float s1 = uv(corner[1]).x - uv(corner[0]).x;
+		float t1 = uv(corner[1]).y - uv(corner[0]).y;
+		float s2 = uv(corner[2]).x - uv(corner[0]).x;
+		float t2 = uv(corner[2]).y - uv(corner[0]).y;
+
+		// UV上の面積の符号で向きを揃え、位置のU方向・V方向の勾配を求める
+		// 長さは後で接平面に射影してから正規化するので揃えない
+		float signedArea = s1 * t2 - t1 * s2;
+		__m128 faceTangent = _mm_setzero_ps();
+		__m128 faceBitangent = _mm_setzero_ps();
+		if (signedArea != 0.0f) {
+			float orientation = signedArea > 0.0f ? 1.0f : -1.0f;
+			faceTangent = Scale(_mm_sub_ps(Scale(edge1, t2), Scale(edge2, t1)), orientation);
+			faceBitangent = Scale(_mm_sub_ps(Scale(edge2, s1), Scale(edge1, s2)), orientation);
+		}
+
+		// 3つの角をレーンに並べて同時に計算する
+		Lanes n = Transpose(normal(corner[0]), normal(corner[1]), normal(corner[2]));
+		Lanes toNext = Transpose(edge1, _mm_sub_ps(edge2, edge1), Scale(edge2, -1.0f));
+		Lanes toPrev = Rotate(toNext);
+		toPrev = {Negate(toPrev.x), Negate(toPrev.y), Negate(toPrev.z)};
+		// 角の大きさは接平面に射影した2辺で測る
+		toNext = Reject(toNext, n);
+		toPrev = Reject(toPrev, n);
+		__m128 lengthSq = _mm_mul_ps(Dot(toNext, toNext), Dot(toPrev, toPrev));
+		__m128 cosine = _mm_div_ps(Dot(toNext, toPrev), _mm_sqrt_ps(lengthSq));
+		__m128 valid = _mm_cmpgt_ps(lengthSq, _mm_setzero_ps());
+		__m128 angle = _mm_and_ps(Acos(_mm_and_ps(cosine, valid)), valid);
+
+		Lanes tangent = Normalize(Reject(Broadcast(faceTangent), n));
+		Lanes bitangent = Normalize(Reject(Broadcast(faceBitangent), n));
+		AddLanes(tangentSums.data(), corner, Scale(tangent, angle));
+		AddLanes(bitangentSums.data(), corner, Scale(bitangent, angle));
+	}
+
+	// 法線と直交させて向きを決める
+	ForEachRange(vertexCount, [&](uint32_t begin, uint32_t end) {
+		for (uint32_t v = begin; v < end; v++) {
+			__m128 n = normal(v);
+			__m128 tangent = Normalize(Reject(Load(tangentSums[v]), n));
+			if (Dot(tangent, tangent) <= 0.0f) {
+				// UVが潰れていて決まらなければ、法線に垂直な任意の向きにする
+				float ny = std::abs(Dot(n, _mm_set_ps(0.0f, 0.0f, 1.0f, 0.0f)));
+				__m128 axis = ny < 0.999f ? _mm_set_ps(0.0f, 0.0f, 1.0f, 0.0f)
+				                          : _mm_set_ps(0.0f, 0.0f, 0.0f, 1.0f);
+				tangent = Normalize(Cross(axis, n));
+			}
+			Vector3 result;
+			Store(result, tangent);
+			float sign = Dot(Cross(n, tangent), Load(bitangentSums[v])) < 0.0f ? -1.0f : 1.0f;
+			tangents[v] = {result.x, result.y, result.z, sign};
+		}
+	});
+}
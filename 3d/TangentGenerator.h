@@ -0,0 +1,41 @@
+#pragma once
+
+#include "Vector2.h"
+#include "Vector3.h"
+#include "Vector4.h"
+#include <cstddef>
+#include <cstdint>
+
+/// <summary>
+/// 法線マップ用の接線の生成（MikkTSpace互換）
+/// 面毎のUV方向の勾配を頂点法線の接平面に射影し、角の大きさで重み付けして頂点毎に合計する
+/// </summary>
+class TangentGenerator {
+public: // 定数
+	// 並列化する要素数の閾値
+	static const uint32_t kParallelThreshold = 16384;
+
+public: // サブクラス
+	// 頂点データ（任意のストライドの配列を指す）
+	struct VertexInput {
+		const Vector3* positions = nullptr;
+		size_t positionStride = sizeof(Vector3);
+		const Vector3* normals = nullptr; // 正規化済みであること
+		size_t normalStride = sizeof(Vector3);
+		const Vector2* uvs = nullptr;
+		size_t uvStride = sizeof(Vector2);
+		uint32_t vertexCount = 0;
+		const uint32_t* indices = nullptr; // 三角形リスト
+		size_t indexCount = 0;
+	};
+
+public: // 静的メンバ関数
+	/// <summary>
+	/// 頂点毎の接線を求める
+	/// xyzは単位接線、wは従法線の向き（従法線 = w * cross(法線, 接線)）
+	/// 要素数がkParallelThreshold以上ならジョブシステムで並列に処理する
+	/// </summary>
+	/// <param name="vertices">頂点データ</param>
+	/// <param name="tangents">出力先（頂点数分）</param>
+	static void Generate(const VertexInput& vertices, Vector4* tangents);
+};
@@ -0,0 +1,177 @@
+﻿#include "VertexQuantizer.h"
+#include "MathUtility.h"
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <numbers>
+
+namespace {
+
+// 16bit正規化整数の最大値
+const float kUnorm16Max = 65535.0f;
+const float kSnorm16Max = 32767.0f;
+
+uint16_t EncodeUnorm16(float value) {
+	value = (std::clamp)(value, 0.0f, 1.0f);
+	return static_cast<uint16_t>(std::lround(value * kUnorm16Max));
+}
+
+float DecodeUnorm16(uint16_t value) { return static_cast<float>(value) / kUnorm16Max; }
+
+int16_t EncodeSnorm16(float value) {
+	value = (std::clamp)(value, -1.0f, 1.0f);
+	return static_cast<int16_t>(std::lround(value * kSnorm16Max));
+}
+
+// D3Dの規則どおり-32768も-1として扱う
+float DecodeSnorm16(int16_t value) {
+	return (std::max)(static_cast<float>(value) / kSnorm16Max, -1.0f);
+}
+
+// 0を正として扱う符号
+float SignNotZero(float value) { return value >= 0.0f ? 1.0f : -1.0f; }
+
+uint32_t FloatBits(float value) {
+	uint32_t bits;
+	std::memcpy(&bits, &value, sizeof(bits));
+	return bits;
+}
+
+float BitsToFloat(uint32_t bits) {
+	float value;
+	std::memcpy(&value, &bits, sizeof(value));
+	return value;
+}
+
+} // namespace
+
+VertexQuantizer::Range VertexQuantizer::MakeRange(const AABB& aabb) {
+	Range range = {};
+	range.offset = aabb.min;
+	range.scale = Subtract(aabb.max, aabb.min);
+	return range;
+}
+
+VertexQuantizer::PackedVertex VertexQuantizer::Encode(
+  const Vector3& position, const Vector3& normal, const Vector2& uv, const Range& range) {
+	auto normalize = [](float value, float offset, float scale) {
+		return scale > 0.0f ? (value - offset) / scale : 0.0f;
+	};
+
+	PackedVertex vertex = {};
+	vertex.pos[0] = EncodeUnorm16(normalize(position.x, range.offset.x, range.scale.x));
+	vertex.pos[1] = EncodeUnorm16(normalize(position.y, range.offset.y, range.scale.y));
+	vertex.pos[2] = EncodeUnorm16(normalize(position.z, range.offset.z, range.scale.z));
+	vertex.pos[3] = 0;
+	EncodeOctahedral(normal, vertex.normal);
+	vertex.uv[0] = FloatToHalf(uv.x);
+	vertex.uv[1] = FloatToHalf(uv.y);
+	return vertex;
+}
+
+void VertexQuantizer::Decode(
+  const PackedVertex& vertex, const Range& range, Vector3& position, Vector3& normal,
+  Vector2& uv) {
+	position.x = DecodeUnorm16(vertex.pos[0]) * range.scale.x + range.offset.x;
+	position.y = DecodeUnorm16(vertex.pos[1]) * range.scale.y + range.offset.y;
+	position.z = DecodeUnorm16(vertex.pos[2]) * range.scale.z + range.offset.z;
+	normal = DecodeOctahedral(vertex.normal);
+	uv.x = HalfToFloat(vertex.uv[0]);
+	uv.y = HalfToFloat(vertex.uv[1]);
+}
+
+void VertexQuantizer::EncodeOctahedral(const Vector3& normal, int16_t encoded[2]) {
+	// 8面体に投影し、下半分は外側の三角形に折り返す
+	float length = std::abs(normal.x) + std::abs(normal.y) + std::abs(normal.z);
+	if (length <= 0.0f) {
+		encoded[0] = 0;
+		encoded[1] = 0;
+		return;
+	}
+	float x = normal.x / length;
+	float y = normal.y / length;
+	if (normal.z < 0.0f) {
+		float foldedX = (1.0f - std::abs(y)) * SignNotZero(x);
+		float foldedY = (1.0f - std::abs(x)) * SignNotZero(y);
+		x = foldedX;
+		y = foldedY;
+	}
+	encoded[0] = EncodeSnorm16(x);
+	encoded[1] = EncodeSnorm16(y);
+}
+
+Vector3 VertexQuantizer::DecodeOctahedral(const int16_t encoded[2]) {
+	Vector3 normal;
+	normal.x = DecodeSnorm16(encoded[0]);
+	normal.y = DecodeSnorm16(encoded[1]);
+	normal.z = 1.0f - std::abs(normal.x) - std::abs(normal.y);
+	float t = (std::max)(-normal.z, 0.0f);
+	normal.x += normal.x >= 0.0f ? -t : t;
+	normal.y += normal.y >= 0.0f ? -t : t;
+	return Normalize(normal);
+}
+
+uint16_t VertexQuantizer::FloatToHalf(float value) {
+	// 指数部のずらしで丸める（Fabian Giesenの手法）
+	const uint32_t kInfinityBits = 255u << 23;
+	const uint32_t kHalfOverflowBits = (127u + 16u) << 23;
+	const uint32_t kDenormalMagicBits = ((127u - 15u) + (23u - 10u) + 1u) << 23;
+
+	uint32_t bits = FloatBits(value);
+	uint32_t sign = bits & 0x80000000u;
+	bits ^= sign;
+
+	uint32_t result;
+	if (bits >= kHalfOverflowBits) {
+		// 無限大かNaN
+		result = bits > kInfinityBits ? 0x7e00u : 0x7c00u;
+	} else if (bits < (113u << 23)) {
+		// 非正規化数は加算で仮数部を揃えて丸める
+		float shifted = BitsToFloat(bits) + BitsToFloat(kDenormalMagicBits);
+		result = FloatBits(shifted) - kDenormalMagicBits;
+	} else {
+		uint32_t mantissaOdd = (bits >> 13) & 1u;
+		bits += (static_cast<uint32_t>(15 - 127) << 23) + 0xfffu;
+		bits += mantissaOdd;
+		result = bits >> 13;
+	}
+	return static_cast<uint16_t>(result | (sign >> 16));
+}
+
+float VertexQuantizer::HalfToFloat(uint16_t value) {
+	const uint32_t kShiftedExponent = 0x7c00u << 13;
+	const float kMagic = BitsToFloat(113u << 23);
+
+	uint32_t bits = (value & 0x7fffu) << 13;
+	uint32_t exponent = bits & kShiftedExponent;
+	bits += (127u - 15u) << 23;
+	if (exponent == kShiftedExponent) {
+		// 無限大かNaN
+		bits += (128u - 16u) << 23;
+	} else if (exponent == 0) {
+		// 非正規化数
+		bits += 1u << 23;
+		bits = FloatBits(BitsToFloat(bits) - kMagic);
+	}
+	return BitsToFloat(bits | (static_cast<uint32_t>(value & 0x8000u) << 16));
+}
+
+void VertexQuantizer::AccumulateError(
+  ErrorStatistics& statistics, const PackedVertex& vertex, const Range& range,
+  const Vector3& position, const Vector3& normal, const Vector2& uv) {
+	Vector3 decodedPosition, decodedNormal;
+	Vector2 decodedUv;
+	Decode(vertex, range, decodedPosition, decodedNormal, decodedUv);
+
+	statistics.position =
+	  (std::max)(statistics.position, Length(Subtract(decodedPosition, position)));
+	// 小さい角度でも精度が落ちないようatan2で求める
+	float sine = Length(Cross(decodedNormal, normal));
+	float cosine = Dot(decodedNormal, normal);
+	if (sine > 0.0f || cosine > 0.0f) {
+		float degree = std::atan2(sine, cosine) * 180.0f / std::numbers::pi_v<float>;
+		statistics.normalDegree = (std::max)(statistics.normalDegree, degree);
+	}
+	float uvError = (std::max)(std::abs(decodedUv.x - uv.x), std::abs(decodedUv.y - uv.y));
+	statistics.uv = (std::max)(statistics.uv, uvError);
+}
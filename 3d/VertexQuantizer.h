@@ -0,0 +1,90 @@
+#pragma once
+
+#include "Culling.h"
+#include "Vector2.h"
+#include "Vector3.h"
+#include <cstddef>
+#include <cstdint>
+
+/// <summary>
+/// 頂点の圧縮
+/// 座標はAABB基準の16bit正規化整数、法線は8面体写像の16bit×2、UVは半精度浮動小数点
+/// </summary>
+class VertexQuantizer {
+public: // サブクラス
+	// 圧縮した頂点（16バイト。ObjVS.hlslのQUANTIZED_VERTEX版と対応）
+	struct PackedVertex {
+		uint16_t pos[4];   // xyz座標（DXGI_FORMAT_R16G16B16A16_UNORM。wは未使用）
+		int16_t normal[2]; // 8面体写像した法線（DXGI_FORMAT_R16G16_SNORM）
+		uint16_t uv[2];    // uv座標（DXGI_FORMAT_R16G16_FLOAT）
+	};
+
+	// 座標の復元に使う範囲（シェーダーの定数と同じ並び。座標 = 正規化値 * scale + offset）
+	struct Range {
+		Vector3 scale;
+		float padding0;
+		Vector3 offset;
+		float padding1;
+	};
+
+	// 圧縮誤差（全頂点の最大）
+	struct ErrorStatistics {
+		float position = 0.0f;     // 座標の誤差（ローカル座標系の距離）
+		float normalDegree = 0.0f; // 法線の角度の誤差（度）
+		float uv = 0.0f;           // uvの誤差
+	};
+
+public: // 静的メンバ関数
+	/// <summary>
+	/// AABBから座標の範囲を作る
+	/// </summary>
+	/// <param name="aabb">圧縮する頂点を包むAABB</param>
+	/// <returns>範囲</returns>
+	static Range MakeRange(const AABB& aabb);
+
+	/// <summary>
+	/// 頂点を圧縮する
+	/// </summary>
+	static PackedVertex Encode(
+	    const Vector3& position, const Vector3& normal, const Vector2& uv, const Range& range);
+
+	/// <summary>
+	/// 圧縮した頂点を復元する（シェーダーと同じ計算）
+	/// </summary>
+	static void Decode(
+	    const PackedVertex& vertex, const Range& range, Vector3& position, Vector3& normal,
+	    Vector2& uv);
+
+	/// <summary>
+	/// 8面体写像で法線を圧縮する
+	/// </summary>
+	static void EncodeOctahedral(const Vector3& normal, int16_t encoded[2]);
+
+	/// <summary>
+	/// 8面体写像の法線を復元する
+	/// </summary>
+	static Vector3 DecodeOctahedral(const int16_t encoded[2]);
+
+	/// <summary>
+	/// 単精度を半精度に変換する（最近接偶数丸め）
+	/// </summary>
+	static uint16_t FloatToHalf(float value);
+
+	/// <summary>
+	/// 半精度を単精度に変換する
+	/// </summary>
+	static float HalfToFloat(uint16_t value);
+
+	/// <summary>
+	/// 圧縮誤差の最大値を更新する
+	/// </summary>
+	/// <param name="statistics">更新する統計</param>
+	/// <param name="vertex">圧縮した頂点</param>
+	/// <param name="range">座標の範囲</param>
+	/// <param name="position">元の座標</param>
+	/// <param name="normal">元の法線</param>
+	/// <param name="uv">元のuv座標</param>
+	static void AccumulateError(
+	    ErrorStatistics& statistics, const PackedVertex& vertex, const Range& range,
+	    const Vector3& position, const Vector3& normal, const Vector2& uv);
+};
@@ -1,4 +1,5 @@
 ﻿#include "DirectXCommon.h"
+#include "MathUtility.h"
 #include "ViewProjection.h"
 #include "WinApp.h"
 #include <cassert>
@@ -42,6 +43,9 @@ void ViewProjection::UpdateMatrix() {
 	// 透視投影による射影行列の生成
 	matProjection = XMMatrixPerspectiveFovLH(fovAngleY, aspectRatio, nearZ, farZ);
 
+	// 視錐台平面の抽出
+	frustum = MakeFrustum(Multiply(matView, matProjection));
+
 	// 定数バッファに書き込み
 	constMap->view = matView;
 	constMap->projection = matProjection;
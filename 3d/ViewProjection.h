@@ -1,5 +1,6 @@
 #pragma once
 
+#include "Culling.h"
 #include "Matrix4x4.h"
 #include "Vector3.h"
 #include <d3d12.h>
@@ -43,6 +44,8 @@ struct ViewProjection {
 	Matrix4x4 matView;
 	// 射影行列
 	Matrix4x4 matProjection;
+	// 視錐台（ワールド座標系）。UpdateMatrixで更新される
+	Frustum frustum;
 
 	/// <summary>
 	/// 初期化
@@ -10,14 +10,24 @@ cbuffer ViewProjection : register(b1) {
 	float3 cameraPos;  // カメラ座標（ワールド座標）
 };
 
-cbuffer Material : register(b2) {
-	float3 m_ambient : packoffset(c0);   // アンビエント係数
-	float3 m_diffuse : packoffset(c1);   // ディフューズ係数
-	float3 m_specular : packoffset(c2);  // スペキュラー係数
-	float m_alpha : packoffset(c2.w);    // アルファ
-	float3 m_uv_scale : packoffset(c3);  // UVスケール
-	float3 m_uv_offset : packoffset(c4); // UVオフセット
-	                                     // float3x3 uvTransform : packoffset(c3); // UV変換行列
+// マテリアル（Material::ConstBufferDataと同じ並び）
+struct MaterialData {
+	float3 ambient;  // アンビエント係数
+	float pad1;      // パディング
+	float3 diffuse;  // ディフューズ係数
+	float pad2;      // パディング
+	float3 specular; // スペキュラー係数
+	float alpha;     // アルファ
+	float3 uvScale;  // UVスケール
+	float3 uvOffset; // UVオフセット
+	float2 pad3;     // パディング
+};
+
+// 全マテリアル
+StructuredBuffer<MaterialData> materials : register(t2);
+
+cbuffer MaterialIndex : register(b2) {
+	uint materialId; // 描画するマテリアルの番号
 }
 
 // 平行光源の数
@@ -29,30 +39,33 @@ struct DirLight {
 	uint active;
 };
 
-// 点光源の数
-static const int POINTLIGHT_NUM = 3;
-
+// 点光源（PointLight::ConstBufferDataと同じ並び）
 struct PointLight {
 	float3 lightpos;   // ライト座標
+	float pad1;        // パディング
 	float3 lightcolor; // ライトの色(RGB)
+	float pad2;        // パディング
 	float3 lightatten; // ライト距離減衰係数
 	uint active;
 };
 
-// スポットライトの数
-static const int SPOTLIGHT_NUM = 3;
-
+// スポットライト（SpotLight::ConstBufferDataと同じ並び）
 struct SpotLight {
 	float3 lightv;     // ライトの光線方向の逆ベクトル（単位ベクトル）
+	float pad1;        // パディング
 	float3 lightpos;   // ライト座標
+	float pad2;        // パディング
 	float3 lightcolor; // ライトの色(RGB)
+	float pad3;        // パディング
 	float3 lightatten; // ライト距離減衰係数
+	float pad4;        // パディング
 	float2 lightfactoranglecos; // ライト減衰角度のコサイン
 	uint active;
+	float pad5;        // パディング
 };
 
 // 丸影の数
-static const int CIRCLESHADOW_NUM = 3;
+static const int CIRCLESHADOW_NUM = 1;
 
 struct CircleShadow {
 	float3 dir;                // 投影方向の逆ベクトル（単位ベクトル）
@@ -66,15 +79,29 @@ struct CircleShadow {
 cbuffer LightGroup : register(b3) {
 	float3 ambientColor;
 	DirLight dirLights[DIRLIGHT_NUM];
-	PointLight pointLights[POINTLIGHT_NUM];
-	SpotLight spotLights[SPOTLIGHT_NUM];
 	CircleShadow circleShadows[CIRCLESHADOW_NUM];
+	float2 clusterTileScale;  // スクリーン座標 → タイル番号
+	float clusterDepthScale;  // log(ビュー空間の深度) → スライス番号の係数
+	float clusterDepthBias;   // log(ビュー空間の深度) → スライス番号の定数項
+	uint clusterTileCountX;
+	uint clusterTileCountY;
+	uint clusterSliceCount;
+	uint spotLightIndexBase;  // スポットライトのライト番号の開始位置（点光源の枠の数）
 }
 
+// 点光源とスポットライト（ライト番号の位置に置かれ、無効なものも含む）
+StructuredBuffer<PointLight> pointLights : register(t3);
+StructuredBuffer<SpotLight> spotLights : register(t4);
+// 先頭にクラスタ毎の（開始位置, ライト数）、その後ろにライト番号一覧
+StructuredBuffer<uint> lightClusters : register(t5);
+
 // 頂点シェーダーからピクセルシェーダーへのやり取りに使用する構造体
 struct VSOutput {
 	float4 svpos : SV_POSITION; // システム用頂点座標
 	float4 worldpos : POSITION; // ワールド座標
 	float3 normal : NORMAL;     // 法線
 	float2 uv : TEXCOORD;       // uv値
+#ifdef NORMAL_MAP
+	float4 tangent : TANGENT;   // 接線（wは従法線の向き）
+#endif
 };
@@ -2,101 +2,183 @@
 
 Texture2D<float4> tex : register(t0); // 0番スロットに設定されたテクスチャ
 SamplerState smp : register(s0);      // 0番スロットに設定されたサンプラー
+#ifdef NORMAL_MAP
+Texture2D<float4> normalTex : register(t1); // 1番スロットに設定された法線マップ
+#endif
+
+// シャドウマップのカスケード数の上限
+static const uint SHADOW_CASCADE_NUM = 4;
+
+// カスケード（ShadowMap::CascadeDataと同じ並び）
+struct ShadowCascade {
+	matrix lightViewProjection; // ワールド → シャドウマップのクリップ空間
+	float splitFar;             // 担当する深度範囲の奥（ビュー空間）
+	float texelSize;            // 1テクセルのワールドでの大きさ
+	float2 pad;                 // パディング
+};
+
+cbuffer Shadow : register(b5) {
+	ShadowCascade shadowCascades[SHADOW_CASCADE_NUM];
+	uint shadowCascadeCount;       // カスケード数（0なら影を落とさない）
+	float shadowInverseResolution; // 1テクセルのテクスチャ座標での大きさ
+}
+
+Texture2DArray<float> shadowMap : register(t6);   // カスケード毎のシャドウマップ
+SamplerComparisonState shadowSmp : register(s1); // 深度を比較するサンプラー
+
+// 主光源の光が届く割合（1で影なし）
+float ShadowFactor(float3 worldpos, float3 normal, float viewZ) {
+	if (shadowCascadeCount == 0 || viewZ > shadowCascades[shadowCascadeCount - 1].splitFar) {
+		return 1.0f;
+	}
+	// 深度範囲に入るカスケードを選ぶ
+	uint cascade = 0;
+	for (uint c = 0; c + 1 < shadowCascadeCount; c++) {
+		cascade += viewZ > shadowCascades[c].splitFar ? 1 : 0;
+	}
+
+	// 自己遮蔽を防ぐため法線方向にテクセルの大きさ分ずらしてから投影する
+	float3 pos = worldpos + normal * shadowCascades[cascade].texelSize * 1.5f;
+	float4 clip = mul(float4(pos, 1), shadowCascades[cascade].lightViewProjection);
+	float2 uv = clip.xy * float2(0.5f, -0.5f) + 0.5f;
+
+	// 3x3の比較結果を平均して輪郭をぼかす
+	float lit = 0.0f;
+	for (int y = -1; y <= 1; y++) {
+		for (int x = -1; x <= 1; x++) {
+			float2 offset = float2(x, y) * shadowInverseResolution;
+			lit += shadowMap.SampleCmpLevelZero(shadowSmp, float3(uv + offset, cascade), clip.z);
+		}
+	}
+	return lit / 9.0f;
+}
 
 float4 main(VSOutput input) : SV_TARGET {
+	// マテリアル
+	MaterialData material = materials[materialId];
+
 	// UV変換
-	float2 uv = float2(
-	    input.uv.x * m_uv_scale.x + m_uv_offset.x, input.uv.y * m_uv_scale.y + m_uv_offset.y);
+	float2 uv = input.uv * material.uvScale.xy + material.uvOffset.xy;
 	// テクスチャマッピング
 	float4 texcolor = tex.Sample(smp, uv);
 
+	// 法線
+	float3 normal = input.normal;
+#ifdef NORMAL_MAP
+	// 法線マップの値を接空間から変換する（MikkTSpaceに合わせ、補間した値を正規化せずに組む）
+	float3 bitangent = input.tangent.w * cross(input.normal, input.tangent.xyz);
+	float3 tangentNormal = normalTex.Sample(smp, uv).xyz * 2.0f - 1.0f;
+	normal = normalize(
+	    tangentNormal.x * input.tangent.xyz + tangentNormal.y * bitangent +
+	    tangentNormal.z * input.normal);
+#endif
+
 	// 光沢度
 	const float shininess = 4.0f;
 	// 頂点から視点への方向ベクトル
 	float3 eyedir = normalize(cameraPos - input.worldpos.xyz);
 
 	// 環境反射光
-	float3 ambient = m_ambient;
+	float3 ambient = material.ambient;
 
 	// シェーディングによる色
-	float4 shadecolor = float4(ambientColor * ambient, m_alpha);
+	float4 shadecolor = float4(ambientColor * ambient, material.alpha);
+
+	// ビュー空間の深度
+	float viewZ = mul(float4(input.worldpos.xyz, 1), view).z;
+	// 主光源（平行光源0番）の影
+	float shadow = ShadowFactor(input.worldpos.xyz, input.normal, viewZ);
 
 	// 平行光源
 	for (int i = 0; i < DIRLIGHT_NUM; i++) {
 		if (dirLights[i].active) {
 			// ライトに向かうベクトルと法線の内積
-			float3 dotlightnormal = dot(dirLights[i].lightv, input.normal);
+			float3 dotlightnormal = dot(dirLights[i].lightv, normal);
 			// 反射光ベクトル
-			float3 reflect = normalize(-dirLights[i].lightv + 2 * dotlightnormal * input.normal);
+			float3 reflect = normalize(-dirLights[i].lightv + 2 * dotlightnormal * normal);
 			// 拡散反射光
-			float3 diffuse = dotlightnormal * m_diffuse;
+			float3 diffuse = dotlightnormal * material.diffuse;
 			// 鏡面反射光
-			float3 specular = pow(saturate(dot(reflect, eyedir)), shininess) * m_specular;
+			float3 specular = pow(saturate(dot(reflect, eyedir)), shininess) * material.specular;
 
-			// 全て加算する
-			shadecolor.rgb += (diffuse + specular) * dirLights[i].lightcolor;
+			// 全て加算する（主光源はシャドウマップの影を掛ける）
+			float lit = i == 0 ? shadow : 1.0f;
+			shadecolor.rgb += lit * (diffuse + specular) * dirLights[i].lightcolor;
 		}
 	}
 
-	// 点光源
-	for (i = 0; i < POINTLIGHT_NUM; i++) {
-		if (pointLights[i].active) {
+	// クラスタ（画面のタイルと深度のスライス）に割り当てられた点光源・スポットライト
+	uint2 tile = min(
+	    uint2(input.svpos.xy * clusterTileScale),
+	    uint2(clusterTileCountX - 1, clusterTileCountY - 1));
+	float slice = floor(log(max(viewZ, 1e-4f)) * clusterDepthScale + clusterDepthBias);
+	uint cluster =
+	    ((uint)clamp(slice, 0, clusterSliceCount - 1) * clusterTileCountY + tile.y) *
+	        clusterTileCountX + tile.x;
+	uint lightOffset = lightClusters[cluster * 2];
+	uint lightCount = lightClusters[cluster * 2 + 1];
+
+	for (uint j = 0; j < lightCount; j++) {
+		uint lightIndex = lightClusters[lightOffset + j];
+		// 点光源
+		if (lightIndex < spotLightIndexBase) {
+			PointLight pointLight = pointLights[lightIndex];
+
 			// ライトへの方向ベクトル
-			float3 lightv = pointLights[i].lightpos - input.worldpos.xyz;
+			float3 lightv = pointLight.lightpos - input.worldpos.xyz;
 			float d = length(lightv);
 			lightv = normalize(lightv);
 
 			// 距離減衰係数
-			float atten = 1.0f / (pointLights[i].lightatten.x + pointLights[i].lightatten.y * d +
-			                      pointLights[i].lightatten.z * d * d);
+			float atten = 1.0f / (pointLight.lightatten.x + pointLight.lightatten.y * d +
+			                      pointLight.lightatten.z * d * d);
 
 			// ライトに向かうベクトルと法線の内積
-			float3 dotlightnormal = dot(lightv, input.normal);
+			float3 dotlightnormal = dot(lightv, normal);
 			// 反射光ベクトル
-			float3 reflect = normalize(-lightv + 2 * dotlightnormal * input.normal);
+			float3 reflect = normalize(-lightv + 2 * dotlightnormal * normal);
 			// 拡散反射光
-			float3 diffuse = dotlightnormal * m_diffuse;
+			float3 diffuse = dotlightnormal * material.diffuse;
 			// 鏡面反射光
-			float3 specular = pow(saturate(dot(reflect, eyedir)), shininess) * m_specular;
+			float3 specular = pow(saturate(dot(reflect, eyedir)), shininess) * material.specular;
 
 			// 全て加算する
-			shadecolor.rgb += atten * (diffuse + specular) * pointLights[i].lightcolor;
+			shadecolor.rgb += atten * (diffuse + specular) * pointLight.lightcolor;
 		}
-	}
+		// スポットライト
+		else {
+			SpotLight spotLight = spotLights[lightIndex - spotLightIndexBase];
 
-	// スポットライト
-	for (i = 0; i < SPOTLIGHT_NUM; i++) {
-		if (spotLights[i].active) {
 			// ライトへの方向ベクトル
-			float3 lightv = spotLights[i].lightpos - input.worldpos.xyz;
+			float3 lightv = spotLight.lightpos - input.worldpos.xyz;
 			float d = length(lightv);
 			lightv = normalize(lightv);
 
 			// 距離減衰係数
 			float atten = saturate(
-			    1.0f / (spotLights[i].lightatten.x + spotLights[i].lightatten.y * d +
-			            spotLights[i].lightatten.z * d * d));
+			    1.0f / (spotLight.lightatten.x + spotLight.lightatten.y * d +
+			            spotLight.lightatten.z * d * d));
 
 			// 角度減衰
-			float cos = dot(lightv, spotLights[i].lightv);
+			float cos = dot(lightv, spotLight.lightv);
 			// 減衰開始角度から、減衰終了角度にかけて減衰
 			// 減衰開始角度の内側は1倍 減衰終了角度の外側は0倍の輝度
 			float angleatten = smoothstep(
-			    spotLights[i].lightfactoranglecos.y, spotLights[i].lightfactoranglecos.x, cos);
+			    spotLight.lightfactoranglecos.y, spotLight.lightfactoranglecos.x, cos);
 			// 角度減衰を乗算
 			atten *= angleatten;
 
 			// ライトに向かうベクトルと法線の内積
-			float3 dotlightnormal = dot(lightv, input.normal);
+			float3 dotlightnormal = dot(lightv, normal);
 			// 反射光ベクトル
-			float3 reflect = normalize(-lightv + 2 * dotlightnormal * input.normal);
+			float3 reflect = normalize(-lightv + 2 * dotlightnormal * normal);
 			// 拡散反射光
-			float3 diffuse = dotlightnormal * m_diffuse;
+			float3 diffuse = dotlightnormal * material.diffuse;
 			// 鏡面反射光
-			float3 specular = pow(saturate(dot(reflect, eyedir)), shininess) * m_specular;
+			float3 specular = pow(saturate(dot(reflect, eyedir)), shininess) * material.specular;
 
 			// 全て加算する
-			shadecolor.rgb += atten * (diffuse + specular) * spotLights[i].lightcolor;
+			shadecolor.rgb += atten * (diffuse + specular) * spotLight.lightcolor;
 		}
 	}
 
@@ -1,6 +1,29 @@
 #include "Obj.hlsli"
 
+#ifdef QUANTIZED_VERTEX
+cbuffer Quantization : register(b4) {
+	float3 posScale : packoffset(c0);  // 座標の範囲の大きさ（メッシュのAABB）
+	float3 posOffset : packoffset(c1); // 座標の範囲の最小値
+};
+
+// 8面体写像した法線の復元
+float3 DecodeOctahedral(float2 e) {
+	float3 n = float3(e, 1.0f - abs(e.x) - abs(e.y));
+	float t = saturate(-n.z);
+	n.xy += n.xy >= 0.0f ? -t : t;
+	return normalize(n);
+}
+
+VSOutput main(float4 packedPos : POSITION, float2 packedNormal : NORMAL, float2 uv : TEXCOORD) {
+	// 圧縮された頂点の復元
+	float4 pos = float4(packedPos.xyz * posScale + posOffset, 1.0f);
+	float3 normal = DecodeOctahedral(packedNormal);
+#elif defined(NORMAL_MAP)
+VSOutput main(
+    float4 pos : POSITION, float3 normal : NORMAL, float2 uv : TEXCOORD, float4 tangent : TANGENT) {
+#else
 VSOutput main(float4 pos : POSITION, float3 normal : NORMAL, float2 uv : TEXCOORD) {
+#endif
 	// 法線にワールド行列によるスケーリング・回転を適用
 	// ※スケーリングが一様な場合のみ正しい
 	float4 worldNormal = normalize(mul(float4(normal, 0), world));
@@ -12,6 +35,10 @@ VSOutput main(float4 pos : POSITION, float3 normal : NORMAL, float2 uv : TEXCOOR
 	output.worldpos = worldPos;
 	output.normal = worldNormal.xyz;
 	output.uv = uv;
+#ifdef NORMAL_MAP
+	// 接線も法線と同じく回転させ、従法線の向きはそのまま渡す
+	output.tangent = float4(normalize(mul(float4(tangent.xyz, 0), world)).xyz, tangent.w);
+#endif
 
 	return output;
 }
\ No newline at end of file
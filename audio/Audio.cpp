@@ -1,16 +1,109 @@
 ﻿#include "Audio.h"
-
+#include "ImaAdpcm.h"
+#include "MathUtility.h"
+#include "SoundBank.h"
+#include "ViewProjection.h"
+#include "WaveParser.h"
+#include "WorldTransform.h"
+
+#include <algorithm>
 #include <cassert>
-#include <fstream>
+#include <cmath>
 #include <windows.h>
 
 #pragma comment(lib, "xaudio2.lib")
 
+namespace {
+
+// 3D再生の出力をまとめて反映する操作の番号
+const uint32_t kSpatialOperationSet = 1u;
+const float kPi = 3.14159265f;
+
+// 同じボイスで再生できる波形フォーマットか
+bool IsSameFormat(const WAVEFORMATEX& lhs, const WAVEFORMATEX& rhs) {
+	return lhs.wFormatTag == rhs.wFormatTag && lhs.nChannels == rhs.nChannels &&
+	       lhs.nSamplesPerSec == rhs.nSamplesPerSec && lhs.nBlockAlign == rhs.nBlockAlign &&
+	       lhs.wBitsPerSample == rhs.wBitsPerSample;
+}
+
+// WAVファイルの波形フォーマットからXAudio2の波形フォーマットを作る
+WAVEFORMATEX ToWaveFormatEx(const WaveFormat& format) {
+	WAVEFORMATEX wfex{};
+	wfex.wFormatTag = format.formatTag;
+	wfex.nChannels = format.channels;
+	wfex.nSamplesPerSec = format.samplesPerSec;
+	wfex.nAvgBytesPerSec = format.avgBytesPerSec;
+	wfex.nBlockAlign = format.blockAlign;
+	wfex.wBitsPerSample = format.bitsPerSample;
+	return wfex;
+}
+
+// 再生ハンドルとバッファのコンテキストの変換
+void* ToBufferContext(uint32_t voiceHandle) {
+	return reinterpret_cast<void*>(static_cast<uintptr_t>(voiceHandle));
+}
+uint32_t ToVoiceHandle(void* bufferContext) {
+	return static_cast<uint32_t>(reinterpret_cast<uintptr_t>(bufferContext));
+}
+
+// ビュー行列からリスナーの位置と向きを得る（速度は0）
+SpatialListener MakeListener(const ViewProjection* viewProjection) {
+	SpatialListener listener;
+	if (!viewProjection) {
+		return listener;
+	}
+	// ビュー行列の列がカメラの右、上、正面の向きになる
+	const Matrix4x4& m = viewProjection->matView;
+	Vector3 right = {m.m[0][0], m.m[1][0], m.m[2][0]};
+	Vector3 up = {m.m[0][1], m.m[1][1], m.m[2][1]};
+	Vector3 forward = {m.m[0][2], m.m[1][2], m.m[2][2]};
+	// 平行移動の成分はカメラの位置を各軸に射影して符号を反転したもの
+	listener.position = Multiply(
+	  -1.0f, Add(
+	           Add(Multiply(m.m[3][0], right), Multiply(m.m[3][1], up)),
+	           Multiply(m.m[3][2], forward)));
+	listener.right = right;
+	listener.forward = forward;
+	return listener;
+}
+
+// IMA-ADPCMの波形データを16bit PCMに展開する
+std::vector<uint8_t> DecodeAdpcm(const WaveFormat& format, const uint8_t* data, size_t size) {
+	std::vector<uint8_t> decoded(ImaAdpcm::GetDecodedSize(format, size));
+	ImaAdpcm::Decode(format, data, size, reinterpret_cast<int16_t*>(decoded.data()));
+	return decoded;
+}
+
+// 前の位置からの速度
+Vector3 GetVelocity(const Vector3& previous, const Vector3& current, float deltaTime) {
+	if (deltaTime <= 0.0f) {
+		return {0.0f, 0.0f, 0.0f};
+	}
+	return Multiply(1.0f / deltaTime, Subtract(current, previous));
+}
+
+} // namespace
+
 void Audio::XAudio2VoiceCallback::OnBufferEnd(THIS_ void* pBufferContext) {
+	// XAudio2のスレッドなのでロックせず、回収はメインスレッド側に任せる
+	// （停止したボイスの分も届くが、世代が変わっているので回収時に無視される）
+	Audio* audio = Audio::GetInstance();
+	if (!audio->finishedVoices_.Push(ToVoiceHandle(pBufferContext))) {
+		// 溢れた分は捨てて、次の回収で全てのボイスの状態を調べてもらう
+		audio->finishedVoicesOverflowed_.store(true, std::memory_order_release);
+	}
+}
+
+void Audio::StreamVoiceCallback::OnStreamEnd(THIS) {
+	// 破棄は読み込みスレッドに任せる
+	stream->finished = true;
+	Audio::GetInstance()->SignalStreamThread();
+}
 
-	Voice* voice = reinterpret_cast<Voice*>(pBufferContext);
-	// 再生リストから除外
-	Audio::GetInstance()->voices_.erase(voice);
+void Audio::StreamVoiceCallback::OnBufferEnd(THIS_ [[maybe_unused]] void* pBufferContext) {
+	// 空いたバッファを読み込みスレッドに埋めてもらう
+	stream->ring.Release();
+	Audio::GetInstance()->SignalStreamThread();
 }
 
 Audio* Audio::GetInstance() {
@@ -19,203 +112,802 @@ Audio* Audio::GetInstance() {
 	return &instance;
 }
 
-void Audio::Initialize(const std::string& directoryPath) {
+void Audio::Initialize(
+  const std::string& directoryPath, Backend backend, AudioOutput* output) {
 	directoryPath_ = directoryPath;
+	backend_ = backend;
+	listenerView_ = nullptr;
+	listenerReset_ = true;
+
+	if (backend_ == Backend::kMixer) {
+		// XAudio2を使わず、Updateで経過時間分を混ぜて出力に書く（3D再生は左右に振り分ける）
+		assert(output);
+		mixer_.Initialize(kMixerSampleRate, output);
+		mixerFrameRemainder_ = 0.0;
+		masterChannelCount_ = 2u;
+		speakerLayout_ = SpeakerLayout::Create(masterChannelCount_);
+		return;
+	}
 
 	HRESULT result;
-	IXAudio2MasteringVoice* masterVoice;
 
 	// XAudioエンジンのインスタンスを生成
 	result = XAudio2Create(&xAudio2_, 0, XAUDIO2_DEFAULT_PROCESSOR);
 	assert(SUCCEEDED(result));
 
 	// マスターボイスを生成
-	result = xAudio2_->CreateMasteringVoice(&masterVoice);
+	result = xAudio2_->CreateMasteringVoice(&masterVoice_);
 	assert(SUCCEEDED(result));
 
-	indexSoundData_ = 0u;
-	indexVoice_ = 0u;
+	// 3D再生はマスターボイスのチャンネル数に合わせて振り分ける
+	XAUDIO2_VOICE_DETAILS details;
+	masterVoice_->GetVoiceDetails(&details);
+	masterChannelCount_ = details.InputChannels;
+	speakerLayout_ = SpeakerLayout::Create(
+	  (std::min)(masterChannelCount_, SpeakerLayout::kMaxChannelCount));
+
+	// ストリーミング再生の読み込みスレッドを開始
+	streamQuit_ = false;
+	streamThread_ = std::thread(&Audio::StreamThreadMain, this);
 }
 
 void Audio::Finalize() {
+	// 読み込みスレッドを止めてから、ストリーミング再生を破棄
+	{
+		std::lock_guard<std::mutex> lock(streamSignalMutex_);
+		streamQuit_ = true;
+	}
+	streamCondition_.notify_one();
+	if (streamThread_.joinable()) {
+		streamThread_.join();
+	}
+	for (auto& stream : streams_) {
+		stream->sourceVoice->DestroyVoice();
+	}
+	streams_.clear();
+
+	// 再生中とプールのボイスを破棄
+	{
+		std::lock_guard<std::mutex> lock(voiceMutex_);
+		voices_.ForEach([](uint32_t, Voice& voice) {
+			if (voice.sourceVoice && !voice.stream) {
+				voice.sourceVoice->DestroyVoice();
+			}
+		});
+		voices_.Clear();
+		for (VoicePool& pool : voicePools_) {
+			for (IXAudio2SourceVoice* sourceVoice : pool.freeVoices) {
+				sourceVoice->DestroyVoice();
+			}
+		}
+		voicePools_.clear();
+		uint32_t voiceHandle;
+		while (finishedVoices_.Pop(voiceHandle)) {
+		}
+		finishedVoicesOverflowed_ = false;
+		spatialVoices_.clear();
+		mixerBuffers_.clear();
+	}
+	if (masterVoice_) {
+		masterVoice_->DestroyVoice();
+		masterVoice_ = nullptr;
+	}
+
 	// XAudio2解放
 	xAudio2_.Reset();
 	// 音声データ解放
 	for (auto& soundData : soundDatas_) {
-		Unload(&soundData);
+		Unload(soundData.get());
 	}
+	soundDatas_.clear();
+	soundHandles_.clear();
+	banks_.clear();
 }
 
-uint32_t Audio::LoadWave(const std::string& fileName) {
-	assert(indexSoundData_ < kMaxSoundData);
-	uint32_t handle = indexSoundData_;
-	// 読み込み済みサウンドデータを検索
-	auto it = std::find_if(soundDatas_.begin(), soundDatas_.end(), [&](const auto& soundData) {
-		return soundData.name_ == fileName;
-	});
-	if (it != soundDatas_.end()) {
-		// 読み込み済みサウンドデータの要素番号を取得
-		handle = static_cast<uint32_t>(std::distance(soundDatas_.begin(), it));
-		return handle;
-	}
-
-	// ディレクトリパスとファイル名を連結してフルパスを得る
-	bool currentRelative = false;
-	if (2 < fileName.size()) {
-		currentRelative = (fileName[0] == '.') && (fileName[1] == '/');
+uint32_t Audio::LoadWave(const std::string& fileName, bool keepCompressed) {
+	// 読み込み済み（サウンドバンクで登録済みを含む）ならそのハンドルを返す
+	auto it = soundHandles_.find(fileName);
+	if (it != soundHandles_.end()) {
+		return it->second;
 	}
-	std::string fullpath = currentRelative ? fileName : directoryPath_ + fileName;
 
-	// ファイル入力ストリームのインスタンス
-	std::ifstream file;
-	// .wavファイルをバイナリモードで開く
-	file.open(fullpath, std::ios_base::binary);
-	// ファイルオープン失敗を検出する
-	assert(file.is_open());
+	// .wavファイルをメモリにマップしてチャンクを調べる
+	std::unique_ptr<SoundData> soundData = std::make_unique<SoundData>();
+	bool opened = soundData->file.Open(GetFullPath(fileName));
+	assert(opened);
+	WaveInfo info;
+	bool parsed = WaveParser::Parse(soundData->file.GetData(), soundData->file.GetSize(), info);
+	assert(parsed);
+	// 再生中に読み込みを待たないよう、波形データの読み込みを先に始めておく
+	soundData->file.Prefetch(static_cast<size_t>(info.dataOffset), info.dataSize);
+
+	// 波形データはマップしたファイルを直接指す
+	soundData->data = soundData->file.GetData() + info.dataOffset;
+	soundData->dataSize = info.dataSize;
+	return AddSoundData(
+	  fileName, std::move(soundData), info.format, info.frameCount, info.loopStart, info.loopEnd,
+	  keepCompressed);
+}
 
-	// RIFFヘッダーの読み込み
-	RiffHeader riff;
-	file.read((char*)&riff, sizeof(riff));
-	// ファイルがRIFFかチェック
-	if (strncmp(riff.chunk.id, "RIFF", 4) != 0) {
-		assert(0);
-	}
-	// タイプがWAVEかチェック
-	if (strncmp(riff.type, "WAVE", 4) != 0) {
-		assert(0);
+uint32_t Audio::LoadBank(const std::string& fileName) {
+	// ファイルを1つマップするだけで、全ての波形をまとめて読み込む
+	std::unique_ptr<MappedFile> file = std::make_unique<MappedFile>();
+	bool opened = file->Open(GetFullPath(fileName));
+	assert(opened);
+	SoundBank bank;
+	bool parsed = bank.Open(file->GetData(), file->GetSize());
+	assert(parsed);
+	file->Prefetch(0, file->GetSize());
+
+	uint32_t count = 0u;
+	for (uint32_t i = 0; i < bank.GetEntryCount(); i++) {
+		std::string name(bank.GetName(i));
+		if (soundHandles_.count(name)) {
+			continue;
+		}
+		const SoundBank::Entry& entry = bank.GetEntry(i);
+		std::unique_ptr<SoundData> soundData = std::make_unique<SoundData>();
+		soundData->data = bank.GetData(i);
+		soundData->dataSize = entry.dataSize;
+		bool keepCompressed = (entry.flags & SoundBank::kFlagKeepCompressed) != 0;
+		AddSoundData(
+		  name, std::move(soundData), entry.format, entry.frameCount, entry.loopStart,
+		  entry.loopEnd, keepCompressed);
+		count++;
 	}
+	banks_.push_back(std::move(file));
+	return count;
+}
 
-	// Formatチャンクの読み込み
-	FormatChunk format = {};
-	// チャンクヘッダーの確認
-	file.read((char*)&format, sizeof(ChunkHeader));
-	if (strncmp(format.chunk.id, "fmt ", 4) != 0) {
-		assert(0);
+uint32_t Audio::AddSoundData(
+  const std::string& name, std::unique_ptr<SoundData> soundData, const WaveFormat& format,
+  uint32_t frameCount, uint32_t loopStart, uint32_t loopEnd, bool keepCompressed) {
+	WaveFormat playFormat = format;
+	if (format.formatTag == ImaAdpcm::kFormatTag) {
+		assert(ImaAdpcm::IsValidFormat(format));
+		if (keepCompressed) {
+			// 圧縮したまま保持し、再生時に展開する
+			soundData->compressed = true;
+			soundData->compressedFormat = format;
+		} else {
+			// 読み込み時に16bit PCMに展開する（最後のブロックの余りはフレーム数で切る）
+			soundData->buffer.resize(ImaAdpcm::GetDecodedSize(format, soundData->dataSize));
+			ImaAdpcm::Decode(
+			  format, soundData->data, soundData->dataSize,
+			  reinterpret_cast<int16_t*>(soundData->buffer.data()));
+			soundData->buffer.resize(
+			  (std::min)(soundData->buffer.size(), frameCount * format.channels * sizeof(int16_t)));
+			soundData->data = soundData->buffer.data();
+			soundData->dataSize = static_cast<uint32_t>(soundData->buffer.size());
+			soundData->file.Close();
+		}
+		playFormat = ImaAdpcm::GetDecodedFormat(format);
 	}
-	// チャンク本体の読み込み
-	assert(format.chunk.size <= sizeof(format.fmt));
-	file.read((char*)&format.fmt, format.chunk.size);
 
-	// Dataチャンクの読み込み
-	ChunkHeader data;
-	file.read((char*)&data, sizeof(data));
-	// JUNKチャンクか Broadcast Wave Formatを検出した場合。
-	while (_strnicmp(data.id, "junk", 4) == 0 || _strnicmp(data.id, "bext", 4) == 0) {
-		// 読み取り位置をJUNKチャンクの終わりまで進める
-		file.seekg(data.size, std::ios_base::cur);
-		// 再読み込み
-		file.read((char*)&data, sizeof(data));
+	soundData->wfex = ToWaveFormatEx(playFormat);
+	soundData->name_ = name;
+	soundData->loopBegin = loopStart;
+	soundData->loopLength = loopEnd - loopStart;
+
+	// 初めての波形フォーマットなら、再生時に生成しなくて済むようボイスを作っておく
+	// （圧縮したまま保持するものはストリーミング再生のボイスを使う）
+	if (backend_ == Backend::kXAudio2 && !soundData->compressed) {
+		std::lock_guard<std::mutex> lock(voiceMutex_);
+		size_t poolCount = voicePools_.size();
+		VoicePool& pool = voicePools_[GetVoicePoolIndex(soundData->wfex, false)];
+		if (poolCount != voicePools_.size()) {
+			for (uint32_t i = 0; i < kPrewarmVoiceCount; i++) {
+				IXAudio2SourceVoice* pSourceVoice = nullptr;
+				HRESULT result = xAudio2_->CreateSourceVoice(
+				  &pSourceVoice, &soundData->wfex, 0, 2.0f, &voiceCallback_);
+				assert(SUCCEEDED(result));
+				pool.freeVoices.push_back(pSourceVoice);
+			}
+		}
 	}
-	if (_strnicmp(data.id, "data", 4) != 0) {
-		assert(0);
-	}
-
-	// Dataチャンクのデータ部（波形データ）の読み込み
-	char* pBuffer = new char[data.size];
-	file.read(pBuffer, data.size);
-
-	// Waveファイルを閉じる
-	file.close();
-
-	// 書き込むサウンドデータの参照
-	SoundData& soundData = soundDatas_.at(handle);
-
-	soundData.wfex = format.fmt;
-	soundData.pBuffer = reinterpret_cast<BYTE*>(pBuffer);
-	soundData.bufferSize = data.size;
-	soundData.name_ = fileName;
-
-	indexSoundData_++;
 
+	uint32_t handle = static_cast<uint32_t>(soundDatas_.size());
+	soundDatas_.push_back(std::move(soundData));
+	soundHandles_[name] = handle;
 	return handle;
 }
 
 void Audio::Unload(SoundData* soundData) {
-	// バッファのメモリを解放
-	delete[] soundData->pBuffer;
-
-	soundData->pBuffer = 0;
-	soundData->bufferSize = 0;
+	// バッファのメモリとマップしたファイルを解放
+	soundData->buffer.clear();
+	soundData->buffer.shrink_to_fit();
+	soundData->file.Close();
+	soundData->data = nullptr;
+	soundData->dataSize = 0u;
 	soundData->wfex = {};
+	soundData->compressed = false;
+	soundData->compressedFormat = {};
+	soundData->loopBegin = 0u;
+	soundData->loopLength = 0u;
 }
 
 uint32_t Audio::PlayWave(uint32_t soundDataHandle, bool loopFlag, float volume) {
+	return StartVoice(soundDataHandle, loopFlag, volume, nullptr, {});
+}
+
+uint32_t Audio::PlayWave3D(
+  uint32_t soundDataHandle, const WorldTransform* emitter, const SpatialEmitterDesc& desc,
+  bool loopFlag, float volume) {
+	assert(emitter);
+	return StartVoice(soundDataHandle, loopFlag, volume, emitter, desc);
+}
+
+uint32_t Audio::StartVoice(
+  uint32_t soundDataHandle, bool loopFlag, float volume, const WorldTransform* emitter,
+  const SpatialEmitterDesc& desc) {
 	HRESULT result;
 
-	assert(soundDataHandle <= soundDatas_.size());
+	assert(soundDataHandle < soundDatas_.size());
 
 	// サウンドデータの参照を取得
-	SoundData& soundData = soundDatas_.at(soundDataHandle);
+	SoundData& soundData = *soundDatas_[soundDataHandle];
 	// 未読み込みの検出
-	assert(soundData.bufferSize != 0);
+	assert(soundData.dataSize != 0);
+
+	if (backend_ == Backend::kMixer) {
+		// 圧縮したまま保持しているものは、この再生の間だけ全体を展開しておく
+		if (soundData.compressed) {
+			std::vector<uint8_t> decoded =
+			  DecodeAdpcm(soundData.compressedFormat, soundData.data, soundData.dataSize);
+			const uint8_t* data = decoded.data();
+			uint32_t dataSize = static_cast<uint32_t>(decoded.size());
+			return StartMixerVoice(
+			  soundData.wfex, data, dataSize, std::move(decoded), loopFlag, volume, emitter, desc);
+		}
+		return StartMixerVoice(
+		  soundData.wfex, soundData.data, soundData.dataSize, {}, loopFlag, volume, emitter, desc);
+	}
 
-	uint32_t handle = indexVoice_;
+	if (soundData.compressed) {
+		// 圧縮したまま保持しているものは、メモリから展開しながらストリーミング再生する
+		std::unique_ptr<Stream> stream = std::make_unique<Stream>();
+		stream->reader.OpenMemory(soundData.compressedFormat, soundData.data, soundData.dataSize);
+		return StartStream(std::move(stream), loopFlag, volume, emitter, desc);
+	}
 
-	// 波形フォーマットを元にSourceVoiceの生成
+	std::lock_guard<std::mutex> lock(voiceMutex_);
+	RecycleFinishedVoices();
+
+	// 同じ波形フォーマットのボイスをプールから借りる（無ければ生成する）
+	uint32_t poolIndex = GetVoicePoolIndex(soundData.wfex, emitter != nullptr);
+	std::vector<IXAudio2SourceVoice*>& freeVoices = voicePools_[poolIndex].freeVoices;
 	IXAudio2SourceVoice* pSourceVoice = nullptr;
-	result = xAudio2_->CreateSourceVoice(&pSourceVoice, &soundData.wfex, 0, 2.0f, &voiceCallback_);
-	assert(SUCCEEDED(result));
+	if (!freeVoices.empty()) {
+		pSourceVoice = freeVoices.back();
+		freeVoices.pop_back();
+	} else {
+		result =
+		  xAudio2_->CreateSourceVoice(&pSourceVoice, &soundData.wfex, 0, 2.0f, &voiceCallback_);
+		assert(SUCCEEDED(result));
+	}
 
-	// 再生中データ
-	Voice* voice = new Voice();
-	voice->handle = handle;
-	voice->sourceVoice = pSourceVoice;
 	// 再生中データコンテナに登録
-	voices_.insert(voice);
+	uint32_t handle = voices_.Insert({pSourceVoice, poolIndex, nullptr});
+	if (handle == kInvalidVoiceHandle) {
+		// 同時再生数の上限
+		freeVoices.push_back(pSourceVoice);
+		return kInvalidVoiceHandle;
+	}
 
 	// 再生する波形データの設定
 	XAUDIO2_BUFFER buf{};
-	buf.pAudioData = soundData.pBuffer;
-	buf.pContext = voice;
-	buf.AudioBytes = soundData.bufferSize;
+	buf.pAudioData = soundData.data;
+	buf.pContext = ToBufferContext(handle);
+	buf.AudioBytes = soundData.dataSize;
 	buf.Flags = XAUDIO2_END_OF_STREAM;
 	if (loopFlag) {
-		// 無限ループ
+		// 無限ループ（ループ範囲があれば、最初は先頭から再生してその範囲を繰り返す）
 		buf.LoopCount = XAUDIO2_LOOP_INFINITE;
+		buf.LoopBegin = soundData.loopBegin;
+		buf.LoopLength = soundData.loopLength;
 	}
 
 	// 波形データの再生
 	result = pSourceVoice->SubmitSourceBuffer(&buf);
 	pSourceVoice->SetVolume(volume);
+	if (emitter) {
+		InitializeEmitter(*voices_.Find(handle), soundData.wfex.nChannels, emitter, desc);
+	}
 	result = pSourceVoice->Start();
 
-	indexVoice_++;
+	return handle;
+}
+
+uint32_t Audio::PlayStream(const std::string& fileName, bool loopFlag, float volume) {
+	std::unique_ptr<Stream> stream = std::make_unique<Stream>();
+	// ファイルを開いて波形フォーマットを得る
+	bool opened = stream->reader.Open(GetFullPath(fileName));
+	assert(opened);
+
+	if (backend_ == Backend::kMixer) {
+		// Mixerは波形全体を参照するので、最後まで読んで（IMA-ADPCMは展開して）から再生する
+		const WaveFormat& format = stream->reader.GetFormat();
+		std::vector<uint8_t> data(stream->reader.GetDataSize());
+		data.resize(stream->reader.Read(data.data(), data.size(), false));
+		WaveFormat playFormat = format;
+		if (format.formatTag == ImaAdpcm::kFormatTag) {
+			assert(ImaAdpcm::IsValidFormat(format));
+			data = DecodeAdpcm(format, data.data(), data.size());
+			playFormat = ImaAdpcm::GetDecodedFormat(format);
+		}
+		if (data.empty()) {
+			return kInvalidVoiceHandle;
+		}
+		const uint8_t* pData = data.data();
+		uint32_t dataSize = static_cast<uint32_t>(data.size());
+		return StartMixerVoice(
+		  ToWaveFormatEx(playFormat), pData, dataSize, std::move(data), loopFlag, volume, nullptr,
+		  {});
+	}
+
+	return StartStream(std::move(stream), loopFlag, volume);
+}
+
+uint32_t Audio::StartMixerVoice(
+  const WAVEFORMATEX& wfex, const uint8_t* data, uint32_t dataSize, std::vector<uint8_t> buffer,
+  bool loopFlag, float volume, const WorldTransform* emitter, const SpatialEmitterDesc& desc) {
+	// Mixerは16bit PCMのモノラルとステレオを混ぜられる
+	assert(wfex.wFormatTag == WAVE_FORMAT_PCM && wfex.wBitsPerSample == 16);
+	assert(wfex.nChannels == 1 || wfex.nChannels == 2);
+
+	std::lock_guard<std::mutex> lock(voiceMutex_);
+	uint32_t handle = voices_.Insert({});
+	if (handle == kInvalidVoiceHandle) {
+		// 同時再生数の上限
+		return kInvalidVoiceHandle;
+	}
+
+	MixerSource source;
+	source.data = data;
+	source.frameCount = dataSize / wfex.nBlockAlign;
+	source.channelCount = wfex.nChannels;
+	source.sampleRate = wfex.nSamplesPerSec;
+	source.format = MixerSampleFormat::kInt16;
+	MixerVoiceDesc voiceDesc;
+	voiceDesc.volume = volume;
+	voiceDesc.loop = loopFlag;
+	uint32_t mixerHandle = mixer_.Play(source, voiceDesc);
+	if (mixerHandle == Mixer::kInvalidHandle) {
+		// Mixerの同時再生数の上限
+		voices_.Remove(handle);
+		return kInvalidVoiceHandle;
+	}
+
+	Voice& voice = *voices_.Find(handle);
+	voice.mixerHandle = mixerHandle;
+	voice.volume = volume;
+	if (!buffer.empty()) {
+		// vectorはムーブしても中身の場所が変わらないので、dataはそのまま使える
+		mixerBuffers_.emplace(handle, std::move(buffer));
+	}
+	if (emitter) {
+		InitializeEmitter(voice, wfex.nChannels, emitter, desc);
+	}
+	return handle;
+}
+
+uint32_t Audio::StartStream(
+  std::unique_ptr<Stream> stream, bool loopFlag, float volume, const WorldTransform* emitter,
+  const SpatialEmitterDesc& desc) {
+	HRESULT result;
+
+	const WaveFormat& format = stream->reader.GetFormat();
+	WaveFormat playFormat = format;
+	stream->loop = loopFlag;
+	stream->adpcm = format.formatTag == ImaAdpcm::kFormatTag;
+	if (stream->adpcm) {
+		// IMA-ADPCMは読み込みスレッドで16bit PCMに展開して渡す
+		assert(ImaAdpcm::IsValidFormat(format));
+		playFormat = ImaAdpcm::GetDecodedFormat(format);
+		// 展開後がバッファ1つに収まるだけのブロックをまとめて読む
+		uint32_t decodedBlockSize =
+		  static_cast<uint32_t>(ImaAdpcm::GetDecodedSize(format, format.blockAlign));
+		uint32_t blockCount = (std::max)(kStreamBufferSize / decodedBlockSize, 1u);
+		stream->bufferSize = decodedBlockSize * blockCount;
+		stream->encoded.resize(format.blockAlign * blockCount);
+	} else {
+		// バッファはサンプルの途中で切れないようブロック境界に揃える
+		stream->bufferSize = kStreamBufferSize - kStreamBufferSize % format.blockAlign;
+	}
+	WAVEFORMATEX wfex = ToWaveFormatEx(playFormat);
+	stream->buffers.resize(stream->bufferSize * StreamBufferRing::kBufferCount);
+	stream->callback.stream = stream.get();
+
+	// 波形フォーマットを元にSourceVoiceの生成
+	result = xAudio2_->CreateSourceVoice(&stream->sourceVoice, &wfex, 0, 2.0f, &stream->callback);
+	assert(SUCCEEDED(result));
+
+	// 再生中データコンテナに登録
+	{
+		std::lock_guard<std::mutex> lock(voiceMutex_);
+		stream->handle = voices_.Insert({stream->sourceVoice, 0u, stream.get()});
+		if (emitter && stream->handle != kInvalidVoiceHandle) {
+			InitializeEmitter(*voices_.Find(stream->handle), wfex.nChannels, emitter, desc);
+		}
+	}
+	if (stream->handle == kInvalidVoiceHandle) {
+		// 同時再生数の上限
+		stream->sourceVoice->DestroyVoice();
+		return kInvalidVoiceHandle;
+	}
+
+	// 再生前に全バッファを埋めておく（以降は読み込みスレッドが補充する）
+	while (stream->ring.HasFreeBuffer() && !stream->endSubmitted) {
+		FillStream(*stream);
+	}
+	stream->sourceVoice->SetVolume(volume);
+	result = stream->sourceVoice->Start();
+
+	uint32_t handle = stream->handle;
+	{
+		std::lock_guard<std::mutex> lock(streamMutex_);
+		streams_.push_back(std::move(stream));
+	}
+	// 空のファイルなどで既に終わっていれば読み込みスレッドで片付ける
+	SignalStreamThread();
 
 	return handle;
 }
 
 void Audio::StopWave(uint32_t voiceHandle) {
+	std::unique_lock<std::mutex> lock(voiceMutex_);
+	RecycleFinishedVoices();
+
+	Voice* voice = voices_.Find(voiceHandle);
+	if (!voice) {
+		return;
+	}
+	Voice stopped = *voice;
+	voices_.Remove(voiceHandle);
 
-	// 再生中リストから検索
-	auto it = std::find_if(
-	  voices_.begin(), voices_.end(), [&](Voice* voice) { return voice->handle == voiceHandle; });
-	// 発見
-	if (it != voices_.end()) {
-		(*it)->sourceVoice->DestroyVoice();
+	if (backend_ == Backend::kMixer) {
+		mixer_.Stop(stopped.mixerHandle);
+		mixerBuffers_.erase(voiceHandle);
+		return;
+	}
 
-		voices_.erase(it);
+	if (stopped.stream) {
+		// ストリーミング再生は読み込みスレッドから外して破棄する
+		lock.unlock();
+		std::unique_ptr<Stream> stream = TakeStream(voiceHandle);
+		if (stream) {
+			stream->sourceVoice->DestroyVoice();
+		}
+		return;
 	}
+
+	// 止めて、残っているバッファを捨ててからプールに戻す
+	stopped.sourceVoice->Stop();
+	stopped.sourceVoice->FlushSourceBuffers();
+	voicePools_[stopped.poolIndex].freeVoices.push_back(stopped.sourceVoice);
 }
 
 bool Audio::IsPlaying(uint32_t voiceHandle) {
-	// 再生中リストから検索
-	auto it = std::find_if(
-	  voices_.begin(), voices_.end(), [&](Voice* voice) { return voice->handle == voiceHandle; });
-	// 発見。再生終わってるのかどうかを判断
-	if (it != voices_.end()) {
-		XAUDIO2_VOICE_STATE state{};
-		(*it)->sourceVoice->GetState(&state);
-		return state.SamplesPlayed != 0;
+	std::lock_guard<std::mutex> lock(voiceMutex_);
+	RecycleFinishedVoices();
+
+	// 再生し終わったものは回収済みなので、引ければ再生中
+	Voice* voice = voices_.Find(voiceHandle);
+	if (backend_ == Backend::kMixer) {
+		// Mixerで再生し終わったものは次のUpdateで外す
+		return voice && mixer_.IsPlaying(voice->mixerHandle);
+	}
+	return voice && !(voice->stream && voice->stream->finished);
+}
+
+void Audio::PauseWave(uint32_t voiceHandle) {
+	std::lock_guard<std::mutex> lock(voiceMutex_);
+	Voice* voice = voices_.Find(voiceHandle);
+	if (!voice) {
+		return;
+	}
+	if (backend_ == Backend::kMixer) {
+		mixer_.SetPaused(voice->mixerHandle, true);
+	} else {
+		voice->sourceVoice->Stop();
+	}
+}
+
+void Audio::ResumeWave(uint32_t voiceHandle) {
+	std::lock_guard<std::mutex> lock(voiceMutex_);
+	Voice* voice = voices_.Find(voiceHandle);
+	if (!voice) {
+		return;
+	}
+	if (backend_ == Backend::kMixer) {
+		mixer_.SetPaused(voice->mixerHandle, false);
+	} else {
+		voice->sourceVoice->Start();
 	}
-	return false;
 }
 
 void Audio::SetVolume(uint32_t voiceHandle, float volume) {
-	// 再生中リストから検索
-	auto it = std::find_if(
-	  voices_.begin(), voices_.end(), [&](Voice* voice) { return voice->handle == voiceHandle; });
-	// 発見
-	if (it != voices_.end()) {
-		(*it)->sourceVoice->SetVolume(volume);
+	std::lock_guard<std::mutex> lock(voiceMutex_);
+	Voice* voice = voices_.Find(voiceHandle);
+	if (!voice) {
+		return;
+	}
+	voice->volume = volume;
+	if (backend_ == Backend::kMixer) {
+		mixer_.SetVolume(voice->mixerHandle, volume * voice->spatialGain);
+	} else {
+		voice->sourceVoice->SetVolume(volume);
+	}
+}
+
+void Audio::SetListener(const ViewProjection* viewProjection) {
+	std::lock_guard<std::mutex> lock(voiceMutex_);
+	listenerView_ = viewProjection;
+	// 別のカメラに切り替えた時の移動量を速度にしない
+	listenerReset_ = true;
+}
+
+void Audio::Update(float deltaTime) {
+	std::lock_guard<std::mutex> lock(voiceMutex_);
+	RecycleFinishedVoices();
+
+	// リスナーの速度は前のUpdateからの移動量で求める
+	SpatialListener listener = MakeListener(listenerView_);
+	if (!listenerReset_) {
+		listener.velocity = GetVelocity(listener_.position, listener.position, deltaTime);
+	}
+	listener_ = listener;
+	listenerReset_ = false;
+
+	// 3D再生中の音源を集める
+	spatialBatch_.Clear();
+	spatialVoices_.clear();
+	voices_.ForEach([&](uint32_t, Voice& voice) {
+		if (!voice.emitter) {
+			return;
+		}
+		Vector3 position = GetTranslation(voice.emitter->matWorld_);
+		Vector3 velocity = GetVelocity(voice.emitterPosition, position, deltaTime);
+		voice.emitterPosition = position;
+		spatialBatch_.Add(position, velocity, voice.emitterDesc);
+		spatialVoices_.push_back(&voice);
+	});
+	if (!spatialVoices_.empty()) {
+		// まとめて計算し、全てのボイスの変更を1回の操作で反映する
+		spatialBatch_.Compute(listener_, speakerLayout_);
+		for (uint32_t i = 0; i < spatialVoices_.size(); i++) {
+			ApplyEmitter(*spatialVoices_[i], i, kSpatialOperationSet);
+		}
+		spatialVoices_.clear();
+		if (backend_ == Backend::kXAudio2) {
+			HRESULT result = xAudio2_->CommitChanges(kSpatialOperationSet);
+			assert(SUCCEEDED(result));
+		}
+	}
+
+	if (backend_ == Backend::kMixer) {
+		// 経過時間分を混ぜて出力に書く（端数は次のUpdateに繰り越す）
+		double frames =
+		  (std::max)(static_cast<double>(deltaTime), 0.0) * kMixerSampleRate + mixerFrameRemainder_;
+		uint32_t frameCount = static_cast<uint32_t>(frames);
+		mixerFrameRemainder_ = frames - frameCount;
+		mixer_.Render(frameCount);
+		RecycleFinishedMixerVoices();
+	}
+}
+
+std::string Audio::GetFullPath(const std::string& fileName) const {
+	bool currentRelative = false;
+	if (2 < fileName.size()) {
+		currentRelative = (fileName[0] == '.') && (fileName[1] == '/');
+	}
+	return currentRelative ? fileName : directoryPath_ + fileName;
+}
+
+void Audio::InitializeEmitter(
+  Voice& voice, uint32_t channelCount, const WorldTransform* emitter,
+  const SpatialEmitterDesc& desc) {
+	voice.emitter = emitter;
+	voice.emitterDesc = desc;
+	voice.emitterPosition = GetTranslation(emitter->matWorld_);
+	voice.channelCount = channelCount;
+
+	// 再生を始める前に、現在の位置関係で出力を決めておく（速度は次のUpdateから）
+	SpatialListener listener = MakeListener(listenerView_);
+	spatialBatch_.Clear();
+	spatialBatch_.Add(voice.emitterPosition, {0.0f, 0.0f, 0.0f}, desc);
+	spatialBatch_.Compute(listener, speakerLayout_);
+	ApplyEmitter(voice, 0, XAUDIO2_COMMIT_NOW);
+}
+
+void Audio::ApplyEmitter(Voice& voice, uint32_t index, uint32_t operationSet) {
+	if (backend_ == Backend::kMixer) {
+		// 左右のゲインを、合計の大きさと定位に直す（モノラルならMixerで同じゲインに戻る）
+		float left = spatialBatch_.GetChannelGain(index, 0);
+		float right = spatialBatch_.GetChannelGain(index, 1);
+		voice.spatialGain = std::sqrt(left * left + right * right);
+		float pan = 0.0f;
+		if (voice.spatialGain > 0.0f) {
+			pan = std::atan2(right, left) * 4.0f / kPi - 1.0f;
+		}
+		mixer_.SetVolume(voice.mixerHandle, voice.volume * voice.spatialGain);
+		mixer_.SetPan(voice.mixerHandle, pan);
+		mixer_.SetPitch(voice.mixerHandle, spatialBatch_.GetFrequencyRatio(index));
+		return;
+	}
+
+	// 複数チャンネルの波形は全チャンネルを同じ重みで混ぜる（電力が変わらないよう1/√nを掛ける）
+	float sourceScale = 1.0f / std::sqrt(static_cast<float>(voice.channelCount));
+	outputMatrix_.resize(static_cast<size_t>(masterChannelCount_) * voice.channelCount);
+	for (uint32_t c = 0; c < masterChannelCount_; c++) {
+		float gain =
+		  c < speakerLayout_.channelCount ? spatialBatch_.GetChannelGain(index, c) : 0.0f;
+		for (uint32_t s = 0; s < voice.channelCount; s++) {
+			outputMatrix_[c * voice.channelCount + s] = gain * sourceScale;
+		}
+	}
+	HRESULT result = voice.sourceVoice->SetOutputMatrix(
+	  masterVoice_, voice.channelCount, masterChannelCount_, outputMatrix_.data(), operationSet);
+	assert(SUCCEEDED(result));
+	result = voice.sourceVoice->SetFrequencyRatio(
+	  spatialBatch_.GetFrequencyRatio(index), operationSet);
+	assert(SUCCEEDED(result));
+}
+
+void Audio::FillStream(Stream& stream) {
+	uint8_t* buffer = stream.buffers.data() + stream.bufferSize * stream.ring.GetFillIndex();
+	// ループ時は末尾で先頭に戻って読み続けるので、継ぎ目に隙間ができない
+	size_t size = 0;
+	if (stream.adpcm) {
+		// ブロック毎に独立して展開できるので、ループの継ぎ目もそのまま展開してよい
+		const WaveFormat& format = stream.reader.GetFormat();
+		size_t encodedSize =
+		  stream.reader.Read(stream.encoded.data(), stream.encoded.size(), stream.loop);
+		ImaAdpcm::Decode(
+		  format, stream.encoded.data(), encodedSize, reinterpret_cast<int16_t*>(buffer));
+		size = ImaAdpcm::GetDecodedSize(format, encodedSize);
+	} else {
+		size = stream.reader.Read(buffer, stream.bufferSize, stream.loop);
+	}
+	if (size == 0) {
+		// 波形データが空
+		stream.endSubmitted = true;
+		stream.finished = true;
+		return;
+	}
+
+	XAUDIO2_BUFFER buf{};
+	buf.pAudioData = buffer;
+	buf.pContext = &stream;
+	buf.AudioBytes = static_cast<UINT32>(size);
+	if (!stream.loop && stream.reader.IsEnd()) {
+		// 最後のバッファ
+		buf.Flags = XAUDIO2_END_OF_STREAM;
+		stream.endSubmitted = true;
+	}
+	// コールバックで返ってくる前に渡した数を増やしておく
+	stream.ring.Submit();
+	HRESULT result = stream.sourceVoice->SubmitSourceBuffer(&buf);
+	assert(SUCCEEDED(result));
+}
+
+void Audio::SignalStreamThread() {
+	{
+		std::lock_guard<std::mutex> lock(streamSignalMutex_);
+		streamSignaled_ = true;
+	}
+	streamCondition_.notify_one();
+}
+
+void Audio::StreamThreadMain() {
+	while (true) {
+		// バッファが返ってくるか、終了するまで待つ
+		{
+			std::unique_lock<std::mutex> lock(streamSignalMutex_);
+			streamCondition_.wait(lock, [this] { return streamSignaled_ || streamQuit_; });
+			if (streamQuit_) {
+				return;
+			}
+			streamSignaled_ = false;
+		}
+
+		std::vector<std::unique_ptr<Stream>> finishedStreams;
+		{
+			std::lock_guard<std::mutex> lock(streamMutex_);
+			for (auto it = streams_.begin(); it != streams_.end();) {
+				Stream& stream = **it;
+				// 空いたバッファを埋める
+				while (stream.ring.HasFreeBuffer() && !stream.endSubmitted) {
+					FillStream(stream);
+				}
+				// 再生し終わったものを外す
+				if (stream.finished) {
+					finishedStreams.push_back(std::move(*it));
+					it = streams_.erase(it);
+				} else {
+					++it;
+				}
+			}
+		}
+		// ボイスの破棄はコールバックの終了を待つので、ロックの外で行う
+		for (auto& stream : finishedStreams) {
+			{
+				std::lock_guard<std::mutex> lock(voiceMutex_);
+				voices_.Remove(stream->handle);
+			}
+			stream->sourceVoice->DestroyVoice();
+		}
+	}
+}
+
+std::unique_ptr<Audio::Stream> Audio::TakeStream(uint32_t voiceHandle) {
+	std::lock_guard<std::mutex> lock(streamMutex_);
+	auto it = std::find_if(streams_.begin(), streams_.end(), [&](const auto& stream) {
+		return stream->handle == voiceHandle;
+	});
+	if (it == streams_.end()) {
+		return nullptr;
+	}
+	std::unique_ptr<Stream> stream = std::move(*it);
+	streams_.erase(it);
+	return stream;
+}
+
+uint32_t Audio::GetVoicePoolIndex(const WAVEFORMATEX& wfex, bool positional) {
+	for (uint32_t i = 0; i < voicePools_.size(); i++) {
+		if (voicePools_[i].positional == positional && IsSameFormat(voicePools_[i].wfex, wfex)) {
+			return i;
+		}
+	}
+	voicePools_.push_back({wfex, positional, {}});
+	return static_cast<uint32_t>(voicePools_.size() - 1);
+}
+
+void Audio::RecycleFinishedVoices() {
+	uint32_t voiceHandle;
+	while (finishedVoices_.Pop(voiceHandle)) {
+		// 停止済みなどで既に外れていれば世代が合わず引けない
+		Voice* voice = voices_.Find(voiceHandle);
+		if (!voice || voice->stream) {
+			continue;
+		}
+		// 最後まで再生したボイスはそのまま次の再生に使える
+		voicePools_[voice->poolIndex].freeVoices.push_back(voice->sourceVoice);
+		voices_.Remove(voiceHandle);
+	}
+
+	// 通知が溢れていたら、バッファを再生し終えたボイスを全て探して回収する
+	if (!finishedVoicesOverflowed_.exchange(false, std::memory_order_acquire)) {
+		return;
+	}
+	std::vector<uint32_t> finishedHandles;
+	voices_.ForEach([&](uint32_t handle, Voice& voice) {
+		if (voice.stream) {
+			return;
+		}
+		XAUDIO2_VOICE_STATE state;
+		voice.sourceVoice->GetState(&state, XAUDIO2_VOICE_NOSAMPLESPLAYED);
+		if (state.BuffersQueued == 0) {
+			finishedHandles.push_back(handle);
+		}
+	});
+	for (uint32_t handle : finishedHandles) {
+		Voice* voice = voices_.Find(handle);
+		voicePools_[voice->poolIndex].freeVoices.push_back(voice->sourceVoice);
+		voices_.Remove(handle);
+	}
+}
+
+void Audio::RecycleFinishedMixerVoices() {
+	// Mixerは再生し終わったものを自分で外すので、引けなくなったものを外す
+	std::vector<uint32_t> finishedHandles;
+	voices_.ForEach([&](uint32_t handle, Voice& voice) {
+		if (!mixer_.IsPlaying(voice.mixerHandle)) {
+			finishedHandles.push_back(handle);
+		}
+	});
+	for (uint32_t handle : finishedHandles) {
+		voices_.Remove(handle);
+		mixerBuffers_.erase(handle);
 	}
 }
@@ -1,36 +1,68 @@
 #pragma once
 
-#include <array>
+#include "MappedFile.h"
+#include "Mixer.h"
+#include "SlotMap.h"
+#include "SpatialAudio.h"
+#include "SpscQueue.h"
+#include "WaveStream.h"
+#include <atomic>
+#include <condition_variable>
 #include <cstdint>
+#include <memory>
 #include <mutex>
-#include <set>
 #include <string>
+#include <thread>
 #include <unordered_map>
+#include <vector>
 #include <wrl.h>
 #include <xaudio2.h>
 
+struct ViewProjection;
+struct WorldTransform;
+
 /// <summary>
 /// オーディオ
 /// </summary>
 class Audio {
 public:
-	// サウンドデータの最大数
-	static const int kMaxSoundData = 256;
+	// 同時に再生できる音声の最大数
+	static const uint32_t kMaxVoiceCount = 1024;
+	// 波形フォーマット毎に最初に作っておくボイス数
+	static const uint32_t kPrewarmVoiceCount = 8;
+	// 無効な再生ハンドル
+	static const uint32_t kInvalidVoiceHandle = 0u;
+	// ストリーミング再生のバッファ1つのバイト数
+	static const uint32_t kStreamBufferSize = 64 * 1024;
+	// ミキサーで混ぜる時の出力のサンプリング周波数
+	static const uint32_t kMixerSampleRate = 48000;
+
+	// 音声を混ぜて鳴らす方式
+	enum class Backend {
+		kXAudio2, // XAudio2で鳴らす
+		kMixer,   // Mixerで混ぜて出力に書く（音を出せない環境や、ミックス結果の確認用）
+	};
 
 	// 音声データ
 	struct SoundData {
 		// 波形フォーマット
 		WAVEFORMATEX wfex;
-		// バッファ
+		// 波形データ（マップしたファイルかbufferの中を指す）
+		const uint8_t* data = nullptr;
+		uint32_t dataSize = 0u;
+		// 読み込み時に展開した波形データ
 		std::vector<uint8_t> buffer;
+		// 波形データをコピーせずに使うため、マップしたままにしておくファイル
+		MappedFile file;
 		// 名前
 		std::string name_;
-	};
-
-	// 再生データ
-	struct Voice {
-		uint32_t handle = 0u;
-		IXAudio2SourceVoice* sourceVoice = nullptr;
+		// 圧縮したまま保持しているか（wfexは展開後の形式）
+		bool compressed = false;
+		// 圧縮したまま保持している場合の形式
+		WaveFormat compressedFormat = {};
+		// ループ範囲（フレーム単位。loopLengthが0なら全体をループする）
+		uint32_t loopBegin = 0u;
+		uint32_t loopLength = 0u;
 	};
 
 	/// <summary>
@@ -60,8 +92,16 @@ public:
 
 	/// <summary>
 	/// 初期化
+	/// kMixerではXAudio2を使わず、Updateのたびに経過時間分をミックスしてoutputに書く。
+	/// ループ範囲は使わず全体をループし、ストリーミング再生と圧縮したまま保持した波形は
+	/// 再生開始時に全体を展開する
 	/// </summary>
-	void Initialize(const std::string& directoryPath = "Resources/");
+	/// <param name="directoryPath">サウンド格納ディレクトリ</param>
+	/// <param name="backend">混ぜて鳴らす方式</param>
+	/// <param name="output">kMixerの出力先（Finalizeまで保持すること）</param>
+	void Initialize(
+	    const std::string& directoryPath = "Resources/", Backend backend = Backend::kXAudio2,
+	    AudioOutput* output = nullptr);
 
 	/// <summary>
 	/// 終了処理
@@ -69,11 +109,25 @@ public:
 	void Finalize();
 
 	/// <summary>
-	/// WAV音声読み込み
+	/// WAV音声読み込み（16bit PCMとIMA-ADPCMに対応）
+	/// ファイルはメモリにマップし、PCMはコピーせずにそのまま再生に使う。
+	/// smplチャンクかcueチャンクにループ範囲があれば、ループ再生はその範囲を繰り返す
 	/// </summary>
 	/// <param name="filename">WAVファイル名</param>
+	/// <param name="keepCompressed">IMA-ADPCMを圧縮したまま保持し、再生時に展開するか。
+	/// メモリは展開した場合の約1/4で済むが、再生中は読み込みスレッドで展開し続ける。
+	/// falseなら読み込み時に展開する。PCMでは無視する</param>
 	/// <returns>サウンドデータハンドル</returns>
-	uint32_t LoadWave(const std::string& filename);
+	uint32_t LoadWave(const std::string& filename, bool keepCompressed = false);
+
+	/// <summary>
+	/// サウンドバンクの読み込み
+	/// ファイルを1つマップし、入っている全ての波形を名前で登録する（波形データはコピーしない）。
+	/// 以降、同じ名前のLoadWaveはファイルを開かずにそのサウンドデータハンドルを返す
+	/// </summary>
+	/// <param name="filename">サウンドバンクのファイル名</param>
+	/// <returns>新しく登録した波形の数（同じ名前が登録済みのものは除く）</returns>
+	uint32_t LoadBank(const std::string& filename);
 
 	/// <summary>
 	/// サウンドデータの解放
@@ -88,9 +142,50 @@ public:
 	/// <param name="loopFlag">ループ再生フラグ</param>
 	/// <param name="volume">ボリューム
 	/// 0で無音、1がデフォルト音量。あまり大きくしすぎると音割れする</param>
-	/// <returns>再生ハンドル</returns>
+	/// <returns>再生ハンドル（同時再生数が上限ならkInvalidVoiceHandle）</returns>
 	uint32_t PlayWave(uint32_t soundDataHandle, bool loopFlag = false, float volume = 1.0f);
 
+	/// <summary>
+	/// 音声の3D再生
+	/// ワールド変換の位置から鳴らし、Updateのたびにリスナーとの位置関係から
+	/// 距離減衰、スピーカー毎の音量、ドップラー効果を設定し直す（ステレオの波形は混ぜて1点から鳴らす）
+	/// </summary>
+	/// <param name="soundDataHandle">サウンドデータハンドル</param>
+	/// <param name="emitter">音源のワールド変換（再生が終わるか止めるまで保持すること）</param>
+	/// <param name="desc">音源の設定</param>
+	/// <param name="loopFlag">ループ再生フラグ</param>
+	/// <param name="volume">ボリューム（距離減衰とは別に掛かる）</param>
+	/// <returns>再生ハンドル（同時再生数が上限ならkInvalidVoiceHandle）</returns>
+	uint32_t PlayWave3D(
+	    uint32_t soundDataHandle, const WorldTransform* emitter,
+	    const SpatialEmitterDesc& desc = {}, bool loopFlag = false, float volume = 1.0f);
+
+	/// <summary>
+	/// リスナーの設定
+	/// ビュー行列からカメラの位置と向きを得る（nullptrなら原点でZ軸の正の向きを見る）
+	/// </summary>
+	/// <param name="viewProjection">ビュープロジェクション（設定している間は保持すること）</param>
+	void SetListener(const ViewProjection* viewProjection);
+
+	/// <summary>
+	/// 毎フレーム処理
+	/// 3D再生中の全ての音源をまとめて計算し、1回の操作で全てのボイスに反映する
+	/// </summary>
+	/// <param name="deltaTime">前のフレームからの経過秒数（速度を求めるのに使う）</param>
+	void Update(float deltaTime);
+
+	/// <summary>
+	/// WAV音声のストリーミング再生
+	/// 全体を読み込まず、少しずつ読みながら再生する（BGMなどの長い音声向け）
+	/// IMA-ADPCMは読み込みスレッドで展開しながら再生する
+	/// </summary>
+	/// <param name="filename">WAVファイル名</param>
+	/// <param name="loopFlag">ループ再生フラグ</param>
+	/// <param name="volume">ボリューム
+	/// 0で無音、1がデフォルト音量。あまり大きくしすぎると音割れする</param>
+	/// <returns>再生ハンドル（PlayWaveの再生ハンドルと同じように使える）</returns>
+	uint32_t PlayStream(const std::string& filename, bool loopFlag = false, float volume = 1.0f);
+
 	/// <summary>
 	/// 音声停止
 	/// </summary>
@@ -125,25 +220,186 @@ public:
 	void SetVolume(uint32_t voiceHandle, float volume);
 
 private:
+	struct Stream;
+
+	// 再生データ
+	struct Voice {
+		IXAudio2SourceVoice* sourceVoice = nullptr;
+		// 再生し終わったボイスを返すプールの番号
+		uint32_t poolIndex = 0u;
+		// ストリーミング再生データ（ストリーミング再生でなければnullptr）
+		Stream* stream = nullptr;
+		// 3D再生の音源（3D再生でなければnullptr）
+		const WorldTransform* emitter = nullptr;
+		SpatialEmitterDesc emitterDesc;
+		// 前のUpdateでの音源の位置
+		Vector3 emitterPosition = {0.0f, 0.0f, 0.0f};
+		// 波形のチャンネル数
+		uint32_t channelCount = 0u;
+		// Mixerのハンドル（kMixerの時だけ使う）
+		uint32_t mixerHandle = Mixer::kInvalidHandle;
+		// 設定した音量と、3D再生の距離減衰（kMixerでは掛けたものをMixerに設定する）
+		float volume = 1.0f;
+		float spatialGain = 1.0f;
+	};
+
+	// 同じ波形フォーマットのボイスのプール
+	struct VoicePool {
+		WAVEFORMATEX wfex;
+		// 3D再生用か（出力行列と周波数比を変えたボイスを通常の再生に渡さないよう分ける）
+		bool positional;
+		// 再生に使っていないボイス
+		std::vector<IXAudio2SourceVoice*> freeVoices;
+	};
+
+	/// <summary>
+	/// ストリーミング再生のコールバック
+	/// </summary>
+	class StreamVoiceCallback : public IXAudio2VoiceCallback {
+	public:
+		// ボイス処理パスの開始時
+		STDMETHOD_(void, OnVoiceProcessingPassStart)
+		([[maybe_unused]] THIS_ UINT32 BytesRequired){};
+		// ボイス処理パスの終了時
+		STDMETHOD_(void, OnVoiceProcessingPassEnd)(THIS){};
+		// バッファストリームの再生が終了した時
+		STDMETHOD_(void, OnStreamEnd)(THIS);
+		// バッファの使用開始時
+		STDMETHOD_(void, OnBufferStart)([[maybe_unused]] THIS_ void* pBufferContext){};
+		// バッファの末尾に達した時
+		STDMETHOD_(void, OnBufferEnd)(THIS_ void* pBufferContext);
+		// 再生がループ位置に達した時
+		STDMETHOD_(void, OnLoopEnd)([[maybe_unused]] THIS_ void* pBufferContext){};
+		// ボイスの実行エラー時
+		STDMETHOD_(void, OnVoiceError)
+		([[maybe_unused]] THIS_ void* pBufferContext, [[maybe_unused]] HRESULT Error){};
+
+		// 対象のストリーミング再生データ
+		Stream* stream = nullptr;
+	};
+
+	// ストリーミング再生データ
+	struct Stream {
+		uint32_t handle = 0u;
+		IXAudio2SourceVoice* sourceVoice = nullptr;
+		StreamVoiceCallback callback;
+		// ファイルの読み込み
+		WaveStreamReader reader;
+		// バッファ（StreamBufferRing::kBufferCount個を並べたもの）
+		std::vector<uint8_t> buffers;
+		uint32_t bufferSize = 0u;
+		StreamBufferRing ring;
+		// IMA-ADPCMを展開しながら再生するか
+		bool adpcm = false;
+		// 展開前のデータの読み込み先（バッファ1つ分に展開できるブロック数）
+		std::vector<uint8_t> encoded;
+		bool loop = false;
+		// 最後のバッファを渡したか（読み込みスレッドだけが触る）
+		bool endSubmitted = false;
+		// 最後まで再生し終わったか
+		std::atomic<bool> finished = false;
+	};
+
 	Audio() = default;
 	~Audio() = default;
 	Audio(const Audio&) = delete;
 	const Audio& operator=(const Audio&) = delete;
 
+	// ディレクトリパスとファイル名を連結してフルパスを得る
+	std::string GetFullPath(const std::string& fileName) const;
+	// 波形データを設定したサウンドデータを登録する（ADPCMは必要なら展開する）
+	uint32_t AddSoundData(
+	    const std::string& name, std::unique_ptr<SoundData> soundData, const WaveFormat& format,
+	    uint32_t frameCount, uint32_t loopStart, uint32_t loopEnd, bool keepCompressed);
+	// ボイスをプールから借りて再生を始める（emitterがあれば3D再生）
+	uint32_t StartVoice(
+	    uint32_t soundDataHandle, bool loopFlag, float volume, const WorldTransform* emitter,
+	    const SpatialEmitterDesc& desc);
+	// 読み込みを開いたストリーミング再生データのボイスを作り、再生を始める
+	uint32_t StartStream(
+	    std::unique_ptr<Stream> stream, bool loopFlag, float volume,
+	    const WorldTransform* emitter = nullptr, const SpatialEmitterDesc& desc = {});
+	// Mixerで再生を始める（bufferは波形データを展開した場合の置き場所で、再生中は保持する）
+	uint32_t StartMixerVoice(
+	    const WAVEFORMATEX& wfex, const uint8_t* data, uint32_t dataSize,
+	    std::vector<uint8_t> buffer, bool loopFlag, float volume, const WorldTransform* emitter,
+	    const SpatialEmitterDesc& desc);
+	// 3D再生のボイスに音源を設定し、最初の出力を反映する（voiceMutex_をロックして呼ぶ）
+	void InitializeEmitter(
+	    Voice& voice, uint32_t channelCount, const WorldTransform* emitter,
+	    const SpatialEmitterDesc& desc);
+	// 計算した結果をボイスの出力行列と周波数比（kMixerでは音量、定位、再生速度）に反映する
+	void ApplyEmitter(Voice& voice, uint32_t index, uint32_t operationSet);
+	// 空いたバッファを1つ埋めて再生側に渡す
+	void FillStream(Stream& stream);
+	// 読み込みスレッドを起こす
+	void SignalStreamThread();
+	// 読み込みスレッドの処理
+	void StreamThreadMain();
+	// ストリーミング再生データを再生中リストから外す
+	std::unique_ptr<Stream> TakeStream(uint32_t voiceHandle);
+	// 波形フォーマットと用途が同じボイスのプールの番号を得る（無ければ作る）
+	uint32_t GetVoicePoolIndex(const WAVEFORMATEX& wfex, bool positional);
+	// 再生し終わったボイスをプールに戻す（voiceMutex_をロックして呼ぶ）
+	// 通知が溢れていた時は全てのボイスの状態を調べる
+	void RecycleFinishedVoices();
+	// Mixerで再生し終わったボイスを外す（voiceMutex_をロックして呼ぶ）
+	void RecycleFinishedMixerVoices();
+
+	// 混ぜて鳴らす方式
+	Backend backend_ = Backend::kXAudio2;
 	// XAudio2のインスタンス
 	Microsoft::WRL::ComPtr<IXAudio2> xAudio2_;
-	// サウンドデータコンテナ
-	std::array<SoundData, kMaxSoundData> soundDatas_;
-	// 再生中データコンテナ
-	// std::unordered_map<uint32_t, IXAudio2SourceVoice*> voices_;
-	std::set<Voice*> voices_;
+	// マスターボイス
+	IXAudio2MasteringVoice* masterVoice_ = nullptr;
+	// マスターボイスのチャンネル数
+	uint32_t masterChannelCount_ = 0u;
+	// 出力先のスピーカー配置
+	SpeakerLayout speakerLayout_;
+	// サウンドデータコンテナ（サウンドデータハンドルで引く）
+	std::vector<std::unique_ptr<SoundData>> soundDatas_;
+	// 名前からサウンドデータハンドルを引く
+	std::unordered_map<std::string, uint32_t> soundHandles_;
+	// 読み込んだサウンドバンク（波形データはこの中を指す）
+	std::vector<std::unique_ptr<MappedFile>> banks_;
+	// 再生中データコンテナ（再生ハンドルで引く）
+	SlotMap<Voice, kMaxVoiceCount> voices_;
+	// ボイスのプール
+	std::vector<VoicePool> voicePools_;
 	// サウンド格納ディレクトリ
 	std::string directoryPath_;
-	// 次に使うサウンドデータの番号
-	uint32_t indexSoundData_ = 0u;
-	// 次に使う再生中データの番号
-	uint32_t indexVoice_ = 0u;
 	// オーディオコールバック
 	XAudio2VoiceCallback voiceCallback_;
+	// 再生中データとプールの排他
 	std::mutex voiceMutex_;
+	// 再生し終わったボイスの再生ハンドル（コールバックから積み、メインスレッド側で回収する）
+	SpscQueue<uint32_t, kMaxVoiceCount * 2> finishedVoices_;
+	// finishedVoices_が満杯で積めなかったか（次の回収で全てのボイスを調べる）
+	std::atomic<bool> finishedVoicesOverflowed_{false};
+	// ストリーミング再生中データ
+	std::vector<std::unique_ptr<Stream>> streams_;
+	std::mutex streamMutex_;
+	// ストリーミング再生の読み込みスレッド
+	std::thread streamThread_;
+	std::mutex streamSignalMutex_;
+	std::condition_variable streamCondition_;
+	bool streamSignaled_ = false;
+	bool streamQuit_ = false;
+	// リスナーのビュープロジェクション
+	const ViewProjection* listenerView_ = nullptr;
+	// リスナー（前のUpdateでの状態）
+	SpatialListener listener_;
+	// リスナーを設定し直してから、まだ速度を求めていないか
+	bool listenerReset_ = true;
+	// 3D再生の計算（毎フレーム作り直すが、配列の確保は使い回す）
+	SpatialBatch spatialBatch_;
+	std::vector<Voice*> spatialVoices_;
+	// 出力行列（ボイス毎に作り直す）
+	std::vector<float> outputMatrix_;
+	// kMixerのミキサー
+	Mixer mixer_;
+	// kMixerで再生開始時に展開した波形データ（再生ハンドルで引く）
+	std::unordered_map<uint32_t, std::vector<uint8_t>> mixerBuffers_;
+	// kMixerでまだミックスしていない経過時間の端数（フレーム単位）
+	double mixerFrameRemainder_ = 0.0;
 };
@@ -0,0 +1,85 @@
+﻿#include "AudioOutput.h"
+#include "WaveStream.h"
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+
+namespace {
+
+// 書き出すWAVのヘッダー（RIFF、fmt、dataの各チャンクヘッダーまで）
+struct WaveFileHeader {
+	char riff[4];
+	uint32_t riffSize;
+	char wave[4];
+	char fmt[4];
+	uint32_t fmtSize;
+	WaveFormat format;
+	char data[4];
+	uint32_t dataSize;
+};
+static_assert(sizeof(WaveFileHeader) == 44);
+
+// 形式（IEEE float）
+const uint16_t kWaveFormatFloat = 3;
+
+} // namespace
+
+void NullAudioOutput::Write(const float* left, const float* right, uint32_t frameCount) {
+	for (uint32_t i = 0; i < frameCount; i++) {
+		peak_ = (std::max)(peak_, (std::max)(std::fabs(left[i]), std::fabs(right[i])));
+	}
+	frameCount_ += frameCount;
+}
+
+WaveFileOutput::~WaveFileOutput() { Close(); }
+
+bool WaveFileOutput::Open(const std::string& filePath, uint32_t sampleRate) {
+	Close();
+	file_.open(filePath, std::ios_base::binary);
+	if (!file_.is_open()) {
+		return false;
+	}
+	dataSize_ = 0;
+
+	// サイズは閉じる時に書き直す
+	WaveFileHeader header = {
+	  {'R', 'I', 'F', 'F'},
+	  0,
+	  {'W', 'A', 'V', 'E'},
+	  {'f', 'm', 't', ' '},
+	  sizeof(WaveFormat),
+	  {kWaveFormatFloat, 2, sampleRate, sampleRate * 8, 8, 32},
+	  {'d', 'a', 't', 'a'},
+	  0};
+	file_.write(reinterpret_cast<const char*>(&header), sizeof(header));
+	return true;
+}
+
+void WaveFileOutput::Close() {
+	if (!file_.is_open()) {
+		return;
+	}
+	uint32_t riffSize = sizeof(WaveFileHeader) - 8 + dataSize_;
+	file_.seekp(offsetof(WaveFileHeader, riffSize));
+	file_.write(reinterpret_cast<const char*>(&riffSize), sizeof(riffSize));
+	file_.seekp(offsetof(WaveFileHeader, dataSize));
+	file_.write(reinterpret_cast<const char*>(&dataSize_), sizeof(dataSize_));
+	file_.close();
+}
+
+void WaveFileOutput::Write(const float* left, const float* right, uint32_t frameCount) {
+	if (!file_.is_open()) {
+		return;
+	}
+	// インターリーブして書き出す
+	float frames[256 * 2];
+	for (uint32_t first = 0; first < frameCount; first += 256) {
+		uint32_t count = (std::min)(frameCount - first, 256u);
+		for (uint32_t i = 0; i < count; i++) {
+			frames[i * 2] = left[first + i];
+			frames[i * 2 + 1] = right[first + i];
+		}
+		file_.write(reinterpret_cast<const char*>(frames), sizeof(float) * 2 * count);
+		dataSize_ += static_cast<uint32_t>(sizeof(float) * 2 * count);
+	}
+}
@@ -0,0 +1,70 @@
+#pragma once
+
+#include <cstdint>
+#include <fstream>
+#include <string>
+
+/// <summary>
+/// ミキサーの出力先
+/// </summary>
+class AudioOutput {
+public: // メンバ関数
+	virtual ~AudioOutput() = default;
+
+	/// <summary>
+	/// ミックス結果を書き込む
+	/// </summary>
+	/// <param name="left">左チャンネル（-1～1）</param>
+	/// <param name="right">右チャンネル（-1～1）</param>
+	/// <param name="frameCount">フレーム数</param>
+	virtual void Write(const float* left, const float* right, uint32_t frameCount) = 0;
+};
+
+/// <summary>
+/// 何も鳴らさない出力（音の出ない環境やテスト用）。書き込まれた量と最大音量だけを数える
+/// </summary>
+class NullAudioOutput : public AudioOutput {
+public: // メンバ関数
+	void Write(const float* left, const float* right, uint32_t frameCount) override;
+
+	/// <summary>
+	/// 書き込まれたフレーム数
+	/// </summary>
+	uint64_t GetFrameCount() const { return frameCount_; }
+
+	/// <summary>
+	/// 書き込まれた値の絶対値の最大
+	/// </summary>
+	float GetPeak() const { return peak_; }
+
+private: // メンバ変数
+	uint64_t frameCount_ = 0;
+	float peak_ = 0.0f;
+};
+
+/// <summary>
+/// WAVファイル（32bit float、ステレオ）に書き出す出力
+/// </summary>
+class WaveFileOutput : public AudioOutput {
+public: // メンバ関数
+	~WaveFileOutput() override;
+
+	/// <summary>
+	/// ファイルを開く
+	/// </summary>
+	/// <param name="filePath">書き出すWAVファイルのパス</param>
+	/// <param name="sampleRate">サンプリング周波数</param>
+	/// <returns>開けたか</returns>
+	bool Open(const std::string& filePath, uint32_t sampleRate);
+
+	/// <summary>
+	/// ヘッダーのサイズを確定させて閉じる
+	/// </summary>
+	void Close();
+
+	void Write(const float* left, const float* right, uint32_t frameCount) override;
+
+private: // メンバ変数
+	std::ofstream file_;
+	uint32_t dataSize_ = 0;
+};
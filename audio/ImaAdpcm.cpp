@@ -0,0 +1,236 @@
+﻿#include "ImaAdpcm.h"
+#include <algorithm>
+#include <array>
+#include <cassert>
+
+namespace {
+
+// 量子化幅
+constexpr int32_t kStepTable[89] = {
+  7,     8,     9,     10,    11,    12,    13,    14,    16,    17,    19,    21,    23,
+  25,    28,    31,    34,    37,    41,    45,    50,    55,    60,    66,    73,    80,
+  88,    97,    107,   118,   130,   143,   157,   173,   190,   209,   230,   253,   279,
+  307,   337,   371,   408,   449,   494,   544,   598,   658,   724,   796,   876,   963,
+  1060,  1166,  1282,  1411,  1552,  1707,  1878,  2066,  2272,  2499,  2749,  3024,  3327,
+  3660,  4026,  4428,  4871,  5358,  5894,  6484,  7132,  7845,  8630,  9493,  10442, 11487,
+  12635, 13899, 15289, 16818, 18500, 20350, 22385, 24623, 27086, 29794, 32767};
+
+// 差分の値による量子化幅の番号の増減
+constexpr int32_t kIndexTable[16] = {-1, -1, -1, -1, 2, 4, 6, 8, -1, -1, -1, -1, 2, 4, 6, 8};
+
+// 量子化幅の番号と4bitの差分の組から引く展開結果
+struct DecodeEntry {
+	int32_t difference; // 予測値に足す値
+	uint32_t next;      // 次の量子化幅の番号*16（そのまま次の表引きの行になる）
+};
+
+// 分岐をなくすため、全ての組の展開結果を前もって計算しておく
+constexpr std::array<DecodeEntry, 89 * 16> MakeDecodeTable() {
+	std::array<DecodeEntry, 89 * 16> table = {};
+	for (int32_t index = 0; index < 89; index++) {
+		for (int32_t code = 0; code < 16; code++) {
+			int32_t step = kStepTable[index];
+			int32_t difference = step >> 3;
+			if (code & 1) {
+				difference += step >> 2;
+			}
+			if (code & 2) {
+				difference += step >> 1;
+			}
+			if (code & 4) {
+				difference += step;
+			}
+			if (code & 8) {
+				difference = -difference;
+			}
+			int32_t next = std::clamp(index + kIndexTable[code], 0, 88);
+			table[index * 16 + code] = {difference, static_cast<uint32_t>(next * 16)};
+		}
+	}
+	return table;
+}
+constexpr std::array<DecodeEntry, 89 * 16> kDecodeTable = MakeDecodeTable();
+
+// 予測値を16bitに収める
+inline int32_t ClampSample(int32_t value) { return std::clamp(value, -32768, 32767); }
+
+// 1チャンネル分の展開の状態
+struct Lane {
+	const uint8_t* source; // 次に読む4バイト
+	int16_t* destination;  // 次に書くサンプル
+	int32_t predictor;     // 予測値
+	uint32_t row;          // 量子化幅の番号*16
+};
+
+/// <summary>
+/// 複数のチャンネル（別のブロックでもよい）を並べて展開する
+/// 1チャンネルの展開は直前の結果に依存して並列にできないので、
+/// 依存のない複数チャンネルを交互に進めてCPUが同時に実行できるようにする
+/// </summary>
+template<uint32_t LaneCount>
+void DecodeLanes(Lane* lanes, uint32_t groupCount, uint32_t channels) {
+	for (uint32_t group = 0; group < groupCount; group++) {
+		for (uint32_t byte = 0; byte < 4; byte++) {
+			for (uint32_t l = 0; l < LaneCount; l++) {
+				Lane& lane = lanes[l];
+				uint32_t code = lane.source[byte];
+				// 下位4bitが先のサンプル
+				const DecodeEntry& low = kDecodeTable[lane.row + (code & 15)];
+				int32_t first = ClampSample(lane.predictor + low.difference);
+				const DecodeEntry& high = kDecodeTable[low.next + (code >> 4)];
+				int32_t second = ClampSample(first + high.difference);
+				lane.destination[0] = static_cast<int16_t>(first);
+				lane.destination[channels] = static_cast<int16_t>(second);
+				lane.destination += channels * 2;
+				lane.predictor = second;
+				lane.row = high.next;
+			}
+		}
+		for (uint32_t l = 0; l < LaneCount; l++) {
+			lanes[l].source += 4 * channels;
+		}
+	}
+}
+
+// 1サンプルを4bitに圧縮し、展開側と同じ計算で予測値と量子化幅を進める
+uint8_t EncodeSample(int32_t sample, int32_t& predictor, uint32_t& row) {
+	int32_t difference = sample - predictor;
+	uint8_t code = 0;
+	if (difference < 0) {
+		code = 8;
+		difference = -difference;
+	}
+	int32_t step = kStepTable[row / 16];
+	if (difference >= step) {
+		code |= 4;
+		difference -= step;
+	}
+	step >>= 1;
+	if (difference >= step) {
+		code |= 2;
+		difference -= step;
+	}
+	step >>= 1;
+	if (difference >= step) {
+		code |= 1;
+	}
+	const DecodeEntry& entry = kDecodeTable[row + code];
+	predictor = ClampSample(predictor + entry.difference);
+	row = entry.next;
+	return code;
+}
+
+} // namespace
+
+bool ImaAdpcm::IsValidFormat(const WaveFormat& format) {
+	if (format.formatTag != kFormatTag || format.bitsPerSample != 4) {
+		return false;
+	}
+	if (format.channels != 1 && format.channels != 2) {
+		return false;
+	}
+	// チャンネル毎に、4バイトのヘッダーと4バイト単位の差分
+	uint32_t channelBytes = format.blockAlign / format.channels;
+	return format.blockAlign % format.channels == 0 && channelBytes > 4 && channelBytes % 4 == 0;
+}
+
+uint32_t ImaAdpcm::GetFramesPerBlock(const WaveFormat& format) {
+	// ヘッダーの予測値がそのまま最初のサンプルになる
+	return (format.blockAlign / format.channels - 4) * 2 + 1;
+}
+
+WaveFormat ImaAdpcm::GetDecodedFormat(const WaveFormat& format) {
+	WaveFormat decoded = {};
+	decoded.formatTag = 1;
+	decoded.channels = format.channels;
+	decoded.samplesPerSec = format.samplesPerSec;
+	decoded.blockAlign = static_cast<uint16_t>(format.channels * 2);
+	decoded.avgBytesPerSec = format.samplesPerSec * decoded.blockAlign;
+	decoded.bitsPerSample = 16;
+	return decoded;
+}
+
+size_t ImaAdpcm::GetDecodedSize(const WaveFormat& format, size_t size) {
+	size_t blockCount = size / format.blockAlign;
+	return blockCount * GetFramesPerBlock(format) * format.channels * sizeof(int16_t);
+}
+
+size_t ImaAdpcm::Decode(
+  const WaveFormat& format, const uint8_t* source, size_t size, int16_t* destination) {
+	assert(IsValidFormat(format));
+	uint32_t channels = format.channels;
+	uint32_t framesPerBlock = GetFramesPerBlock(format);
+	uint32_t groupCount = (format.blockAlign / channels - 4) / 4;
+	size_t blockCount = size / format.blockAlign;
+
+	// ブロックの各チャンネルを4つずつまとめて展開する
+	Lane lanes[4];
+	uint32_t laneCount = 0;
+	for (size_t b = 0; b < blockCount; b++) {
+		const uint8_t* block = source + b * format.blockAlign;
+		int16_t* frames = destination + b * framesPerBlock * channels;
+		for (uint32_t c = 0; c < channels; c++) {
+			const uint8_t* header = block + c * 4;
+			Lane& lane = lanes[laneCount++];
+			lane.predictor = static_cast<int16_t>(header[0] | header[1] << 8);
+			lane.row = (std::min)(header[2], uint8_t(88)) * 16u;
+			frames[c] = static_cast<int16_t>(lane.predictor);
+			lane.destination = frames + channels + c;
+			lane.source = block + channels * 4 + c * 4;
+			if (laneCount == 4) {
+				DecodeLanes<4>(lanes, groupCount, channels);
+				laneCount = 0;
+			}
+		}
+	}
+	for (uint32_t l = 0; l < laneCount; l++) {
+		DecodeLanes<1>(&lanes[l], groupCount, channels);
+	}
+	return blockCount * framesPerBlock;
+}
+
+std::vector<uint8_t> ImaAdpcm::Encode(
+  const int16_t* samples, size_t frameCount, uint32_t channels, uint32_t sampleRate,
+  uint32_t blockAlign, WaveFormat& format) {
+	format = {};
+	format.formatTag = kFormatTag;
+	format.channels = static_cast<uint16_t>(channels);
+	format.samplesPerSec = sampleRate;
+	format.blockAlign = static_cast<uint16_t>(blockAlign);
+	format.bitsPerSample = 4;
+	assert(IsValidFormat(format));
+	uint32_t framesPerBlock = GetFramesPerBlock(format);
+	format.avgBytesPerSec =
+	  static_cast<uint32_t>(static_cast<uint64_t>(sampleRate) * blockAlign / framesPerBlock);
+
+	size_t blockCount = (frameCount + framesPerBlock - 1) / framesPerBlock;
+	std::vector<uint8_t> encoded(blockCount * blockAlign);
+	// 範囲外は最後のサンプルで埋める
+	auto getSample = [&](size_t frame, uint32_t c) -> int32_t {
+		return frameCount == 0 ? 0 : samples[(std::min)(frame, frameCount - 1) * channels + c];
+	};
+
+	// 量子化幅はブロックをまたいで引き継ぐ
+	uint32_t rows[2] = {};
+	for (size_t b = 0; b < blockCount; b++) {
+		uint8_t* block = encoded.data() + b * blockAlign;
+		size_t firstFrame = b * framesPerBlock;
+		for (uint32_t c = 0; c < channels; c++) {
+			int32_t predictor = getSample(firstFrame, c);
+			uint8_t* header = block + c * 4;
+			header[0] = static_cast<uint8_t>(predictor & 0xff);
+			header[1] = static_cast<uint8_t>((predictor >> 8) & 0xff);
+			header[2] = static_cast<uint8_t>(rows[c] / 16);
+			header[3] = 0;
+			// 8サンプル（4バイト）毎にチャンネルが交互に並ぶ
+			for (uint32_t i = 0; i + 1 < framesPerBlock; i += 2) {
+				uint8_t low = EncodeSample(getSample(firstFrame + 1 + i, c), predictor, rows[c]);
+				uint8_t high = EncodeSample(getSample(firstFrame + 2 + i, c), predictor, rows[c]);
+				uint32_t byte = i / 2;
+				size_t offset = channels * 4 + (byte / 4) * channels * 4 + c * 4 + byte % 4;
+				block[offset] = static_cast<uint8_t>(low | high << 4);
+			}
+		}
+	}
+	return encoded;
+}
@@ -0,0 +1,65 @@
+#pragma once
+
+#include "WaveParser.h"
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+/// <summary>
+/// IMA-ADPCM（4bit、WAVE_FORMAT_IMA_ADPCM）の展開と圧縮
+/// 1ブロックはチャンネル毎に4バイトのヘッダー（予測値と量子化幅の番号）と、
+/// チャンネル毎に4バイトずつ交互に並ぶ4bitの差分からなる。ブロック毎に独立して展開できる
+/// </summary>
+class ImaAdpcm {
+public: // 定数
+	// 形式の番号
+	static const uint16_t kFormatTag = 0x0011;
+
+public: // 静的メンバ関数
+	/// <summary>
+	/// 展開できる形式か（1～2チャンネル、4bit、ブロックの大きさが4バイト単位）
+	/// </summary>
+	static bool IsValidFormat(const WaveFormat& format);
+
+	/// <summary>
+	/// 1ブロックに入っているフレーム数
+	/// </summary>
+	static uint32_t GetFramesPerBlock(const WaveFormat& format);
+
+	/// <summary>
+	/// 展開後の形式（16bit PCM）
+	/// </summary>
+	static WaveFormat GetDecodedFormat(const WaveFormat& format);
+
+	/// <summary>
+	/// 展開後のバイト数（端数のブロックは含めない）
+	/// </summary>
+	/// <param name="format">圧縮した形式</param>
+	/// <param name="size">圧縮したデータのバイト数</param>
+	static size_t GetDecodedSize(const WaveFormat& format, size_t size);
+
+	/// <summary>
+	/// 展開する
+	/// </summary>
+	/// <param name="format">圧縮した形式</param>
+	/// <param name="source">圧縮したデータ</param>
+	/// <param name="size">圧縮したデータのバイト数（端数のブロックは無視する）</param>
+	/// <param name="destination">展開先（GetDecodedSizeバイト。チャンネルはインターリーブ）</param>
+	/// <returns>展開したフレーム数</returns>
+	static size_t Decode(
+	    const WaveFormat& format, const uint8_t* source, size_t size, int16_t* destination);
+
+	/// <summary>
+	/// 圧縮する（最後のブロックの足りない分は最後のサンプルで埋める）
+	/// </summary>
+	/// <param name="samples">16bit PCM（チャンネルはインターリーブ）</param>
+	/// <param name="frameCount">フレーム数</param>
+	/// <param name="channels">チャンネル数（1か2）</param>
+	/// <param name="sampleRate">サンプリング周波数</param>
+	/// <param name="blockAlign">1ブロックのバイト数</param>
+	/// <param name="format">圧縮した形式の書き込み先</param>
+	/// <returns>圧縮したデータ</returns>
+	static std::vector<uint8_t> Encode(
+	    const int16_t* samples, size_t frameCount, uint32_t channels, uint32_t sampleRate,
+	    uint32_t blockAlign, WaveFormat& format);
+};
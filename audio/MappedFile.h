@@ -0,0 +1,53 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <windows.h>
+
+/// <summary>
+/// 読み込み専用でメモリにマップしたファイル
+/// 中身はアクセスした時にOSが読み込むので、開くだけではコピーしない
+/// </summary>
+class MappedFile {
+public: // メンバ関数
+	MappedFile() = default;
+	~MappedFile();
+	MappedFile(const MappedFile&) = delete;
+	MappedFile& operator=(const MappedFile&) = delete;
+
+	/// <summary>
+	/// ファイルを開いてマップする
+	/// </summary>
+	/// <param name="filePath">ファイルパス</param>
+	/// <returns>マップできたか（空のファイルはマップできない）</returns>
+	bool Open(const std::string& filePath);
+
+	/// <summary>
+	/// マップを解除して閉じる
+	/// </summary>
+	void Close();
+
+	/// <summary>
+	/// 指定範囲の読み込みを先に始めておく（アクセスした時に待たなくて済むように）
+	/// </summary>
+	/// <param name="offset">先頭からのバイト数</param>
+	/// <param name="size">バイト数</param>
+	void Prefetch(size_t offset, size_t size) const;
+
+	/// <summary>
+	/// 中身の取得（開いていなければnullptr）
+	/// </summary>
+	const uint8_t* GetData() const { return data_; }
+
+	/// <summary>
+	/// バイト数の取得
+	/// </summary>
+	size_t GetSize() const { return size_; }
+
+private: // メンバ変数
+	HANDLE file_ = INVALID_HANDLE_VALUE;
+	HANDLE mapping_ = nullptr;
+	const uint8_t* data_ = nullptr;
+	size_t size_ = 0;
+};
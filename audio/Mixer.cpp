@@ -0,0 +1,361 @@
+﻿#include "Mixer.h"
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+#include <cstring>
+#include <emmintrin.h>
+
+namespace {
+
+const float kPi = 3.14159265f;
+// 固定小数点の端数をfloatにする倍率
+const float kFractionScale = 1.0f / 4294967296.0f;
+
+// サンプルを-1～1のfloatで読む
+inline float LoadSample(const int16_t* data, size_t index) {
+	return static_cast<float>(data[index]) * (1.0f / 32768.0f);
+}
+inline float LoadSample(const float* data, size_t index) { return data[index]; }
+
+// 2点を線形補間する
+inline __m128 Lerp(const float* a, const float* b, __m128 fraction) {
+	__m128 va = _mm_loadu_ps(a);
+	return _mm_add_ps(va, _mm_mul_ps(_mm_sub_ps(_mm_loadu_ps(b), va), fraction));
+}
+
+/// <summary>
+/// 読み込み位置から線形補間でリサンプリングし、左右のゲインを掛けて足す
+/// 読み込むフレームとその次のフレームが波形内にあることは呼び出し側で保証する
+/// </summary>
+template<uint32_t ChannelCount, typename Sample>
+void MixFrames(
+  const Sample* data, uint64_t& position, uint64_t step, uint32_t count, float* left,
+  float* right, const float gain[2], const float gainStep[2]) {
+	uint32_t i = 0;
+
+	// 4フレームずつ（読み込みは位置がばらばらなので1つずつ、補間と合成をまとめて行う）
+	__m128 gainLeft = _mm_setr_ps(
+	  gain[0], gain[0] + gainStep[0], gain[0] + gainStep[0] * 2.0f, gain[0] + gainStep[0] * 3.0f);
+	__m128 gainRight = _mm_setr_ps(
+	  gain[1], gain[1] + gainStep[1], gain[1] + gainStep[1] * 2.0f, gain[1] + gainStep[1] * 3.0f);
+	const __m128 gainLeftStep = _mm_set1_ps(gainStep[0] * 4.0f);
+	const __m128 gainRightStep = _mm_set1_ps(gainStep[1] * 4.0f);
+	const __m128 fractionScale = _mm_set1_ps(kFractionScale);
+	for (; i + 4 <= count; i += 4) {
+		alignas(16) float a[ChannelCount][4];
+		alignas(16) float b[ChannelCount][4];
+		alignas(16) float fraction[4];
+		for (uint32_t k = 0; k < 4; k++) {
+			uint64_t p = position + step * k;
+			size_t index = static_cast<size_t>(p >> 32) * ChannelCount;
+			fraction[k] = static_cast<float>(static_cast<uint32_t>(p));
+			for (uint32_t c = 0; c < ChannelCount; c++) {
+				a[c][k] = LoadSample(data, index + c);
+				b[c][k] = LoadSample(data, index + ChannelCount + c);
+			}
+		}
+		__m128 f = _mm_mul_ps(_mm_load_ps(fraction), fractionScale);
+		__m128 sampleLeft = Lerp(a[0], b[0], f);
+		__m128 sampleRight =
+		  ChannelCount == 1 ? sampleLeft : Lerp(a[ChannelCount - 1], b[ChannelCount - 1], f);
+		_mm_storeu_ps(
+		  left + i, _mm_add_ps(_mm_loadu_ps(left + i), _mm_mul_ps(sampleLeft, gainLeft)));
+		_mm_storeu_ps(
+		  right + i, _mm_add_ps(_mm_loadu_ps(right + i), _mm_mul_ps(sampleRight, gainRight)));
+		gainLeft = _mm_add_ps(gainLeft, gainLeftStep);
+		gainRight = _mm_add_ps(gainRight, gainRightStep);
+		position += step * 4;
+	}
+
+	// 残り
+	for (; i < count; i++) {
+		size_t index = static_cast<size_t>(position >> 32) * ChannelCount;
+		float f = static_cast<float>(static_cast<uint32_t>(position)) * kFractionScale;
+		float sample[ChannelCount];
+		for (uint32_t c = 0; c < ChannelCount; c++) {
+			float a = LoadSample(data, index + c);
+			sample[c] = a + (LoadSample(data, index + ChannelCount + c) - a) * f;
+		}
+		left[i] += sample[0] * (gain[0] + gainStep[0] * static_cast<float>(i));
+		right[i] += sample[ChannelCount - 1] * (gain[1] + gainStep[1] * static_cast<float>(i));
+		position += step;
+	}
+}
+
+// 形式とチャンネル数に合わせてMixFramesを呼ぶ
+void MixSource(
+  const MixerSource& source, uint64_t& position, uint64_t step, uint32_t count, float* left,
+  float* right, const float gain[2], const float gainStep[2]) {
+	if (source.format == MixerSampleFormat::kInt16) {
+		const int16_t* data = static_cast<const int16_t*>(source.data);
+		if (source.channelCount == 1) {
+			MixFrames<1>(data, position, step, count, left, right, gain, gainStep);
+		} else {
+			MixFrames<2>(data, position, step, count, left, right, gain, gainStep);
+		}
+	} else {
+		const float* data = static_cast<const float*>(source.data);
+		if (source.channelCount == 1) {
+			MixFrames<1>(data, position, step, count, left, right, gain, gainStep);
+		} else {
+			MixFrames<2>(data, position, step, count, left, right, gain, gainStep);
+		}
+	}
+}
+
+// 波形の指定フレーム・チャンネルのサンプルを読む
+float LoadSourceSample(const MixerSource& source, uint32_t frame, uint32_t channel) {
+	size_t index = static_cast<size_t>(frame) * source.channelCount + channel;
+	return source.format == MixerSampleFormat::kInt16
+	         ? LoadSample(static_cast<const int16_t*>(source.data), index)
+	         : LoadSample(static_cast<const float*>(source.data), index);
+}
+
+} // namespace
+
+void Mixer::Initialize(uint32_t sampleRate, AudioOutput* output, uint32_t voiceBudget) {
+	assert(sampleRate > 0);
+	assert(output);
+	sampleRate_ = sampleRate;
+	output_ = output;
+	voiceBudget_ = voiceBudget;
+	voices_.Clear();
+	buses_.assign(1, Bus());
+	ranks_.reserve(kMaxVoiceCount);
+	statistics_ = {};
+}
+
+uint32_t Mixer::CreateBus(uint32_t parent, float volume) {
+	assert(buses_.size() < kMaxBusCount);
+	assert(parent < buses_.size());
+	// 親は必ず前に並ぶので、後ろから足していけば子が先に揃う
+	buses_.emplace_back();
+	buses_.back().parent = parent;
+	buses_.back().volume = volume;
+	return static_cast<uint32_t>(buses_.size() - 1);
+}
+
+void Mixer::SetBusVolume(uint32_t bus, float volume) {
+	assert(bus < buses_.size());
+	buses_[bus].volume = volume;
+}
+
+uint32_t Mixer::Play(const MixerSource& source, const MixerVoiceDesc& desc) {
+	assert(source.data && source.frameCount > 0);
+	assert(source.channelCount == 1 || source.channelCount == 2);
+	assert(desc.bus < buses_.size());
+	Voice voice;
+	voice.source = source;
+	voice.desc = desc;
+	return voices_.Insert(voice);
+}
+
+void Mixer::Stop(uint32_t handle) { voices_.Remove(handle); }
+
+void Mixer::SetVolume(uint32_t handle, float volume) {
+	Voice* voice = voices_.Find(handle);
+	if (voice) {
+		voice->desc.volume = volume;
+	}
+}
+
+void Mixer::SetPan(uint32_t handle, float pan) {
+	Voice* voice = voices_.Find(handle);
+	if (voice) {
+		voice->desc.pan = pan;
+	}
+}
+
+void Mixer::SetPitch(uint32_t handle, float pitch) {
+	Voice* voice = voices_.Find(handle);
+	if (voice) {
+		voice->desc.pitch = pitch;
+	}
+}
+
+void Mixer::SetPaused(uint32_t handle, bool paused) {
+	Voice* voice = voices_.Find(handle);
+	if (voice && voice->paused != paused) {
+		voice->paused = paused;
+		// 再開した時は無音から立ち上げる
+		voice->gain[0] = 0.0f;
+		voice->gain[1] = 0.0f;
+		voice->mixed = true;
+	}
+}
+
+void Mixer::Render(uint32_t frameCount) {
+	assert(output_);
+	for (uint32_t first = 0; first < frameCount; first += kBlockFrameCount) {
+		RenderBlock((std::min)(frameCount - first, kBlockFrameCount));
+	}
+}
+
+void Mixer::RenderBlock(uint32_t frameCount) {
+	// バスの足し合わせは4フレームずつ行うので端数も含めて消す
+	uint32_t clearCount = (frameCount + 3) & ~3u;
+	for (Bus& bus : buses_) {
+		memset(bus.left, 0, sizeof(float) * clearCount);
+		memset(bus.right, 0, sizeof(float) * clearCount);
+	}
+
+	// 上限を超えていれば、聞こえる大きさの順に上限までを混ぜる
+	ranks_.clear();
+	voices_.ForEach([this](uint32_t handle, const Voice& voice) {
+		if (voice.paused) {
+			return;
+		}
+		float audibility = voice.desc.volume * voice.desc.priority * GetBusGain(voice.desc.bus);
+		ranks_.push_back({audibility, handle});
+	});
+	uint32_t realCount = (std::min)(static_cast<uint32_t>(ranks_.size()), voiceBudget_);
+	if (realCount < ranks_.size()) {
+		std::nth_element(
+		  ranks_.begin(), ranks_.begin() + realCount, ranks_.end(),
+		  [](const VoiceRank& a, const VoiceRank& b) { return a.audibility > b.audibility; });
+	}
+	for (uint32_t i = 0; i < ranks_.size(); i++) {
+		Voice& voice = *voices_.Find(ranks_[i].handle);
+		if (i < realCount) {
+			MixVoice(voice, buses_[voice.desc.bus], frameCount);
+		} else {
+			AdvanceVoice(voice, frameCount);
+		}
+		if (voice.finished) {
+			voices_.Remove(ranks_[i].handle);
+		}
+	}
+	statistics_.realVoiceCount = realCount;
+	statistics_.virtualVoiceCount = static_cast<uint32_t>(ranks_.size()) - realCount;
+
+	// バスを子から順に親へ足す
+	for (size_t b = buses_.size() - 1; b > 0; b--) {
+		Bus& bus = buses_[b];
+		Bus& parent = buses_[bus.parent];
+		__m128 volume = _mm_set1_ps(bus.volume);
+		for (uint32_t i = 0; i < frameCount; i += 4) {
+			__m128 left = _mm_mul_ps(_mm_load_ps(bus.left + i), volume);
+			__m128 right = _mm_mul_ps(_mm_load_ps(bus.right + i), volume);
+			_mm_store_ps(parent.left + i, _mm_add_ps(_mm_load_ps(parent.left + i), left));
+			_mm_store_ps(parent.right + i, _mm_add_ps(_mm_load_ps(parent.right + i), right));
+		}
+	}
+
+	// マスターの音量を掛け、音割れしないよう-1～1に収めて出力する
+	Bus& master = buses_[kMasterBus];
+	__m128 volume = _mm_set1_ps(master.volume);
+	__m128 minimum = _mm_set1_ps(-1.0f);
+	__m128 maximum = _mm_set1_ps(1.0f);
+	for (uint32_t i = 0; i < frameCount; i += 4) {
+		__m128 left = _mm_mul_ps(_mm_load_ps(master.left + i), volume);
+		__m128 right = _mm_mul_ps(_mm_load_ps(master.right + i), volume);
+		_mm_store_ps(master.left + i, _mm_min_ps(_mm_max_ps(left, minimum), maximum));
+		_mm_store_ps(master.right + i, _mm_min_ps(_mm_max_ps(right, minimum), maximum));
+	}
+	output_->Write(master.left, master.right, frameCount);
+	statistics_.renderedFrameCount += frameCount;
+}
+
+void Mixer::MixVoice(Voice& voice, Bus& bus, uint32_t frameCount) {
+	const MixerSource& source = voice.source;
+
+	// 目標の左右ゲイン
+	float volume = voice.desc.volume;
+	float pan = std::clamp(voice.desc.pan, -1.0f, 1.0f);
+	float target[2];
+	if (source.channelCount == 1) {
+		// モノラルは合計の大きさが変わらないように振り分ける
+		float angle = (pan + 1.0f) * kPi * 0.25f;
+		target[0] = volume * std::cos(angle);
+		target[1] = volume * std::sin(angle);
+	} else {
+		// ステレオは反対側を絞る
+		target[0] = volume * (std::min)(1.0f, 1.0f - pan);
+		target[1] = volume * (std::min)(1.0f, 1.0f + pan);
+	}
+	if (!voice.mixed) {
+		voice.gain[0] = target[0];
+		voice.gain[1] = target[1];
+		voice.mixed = true;
+	}
+	// 音量の変化はブロック内で滑らかにつなぐ
+	float gainStep[2] = {
+	  (target[0] - voice.gain[0]) / static_cast<float>(frameCount),
+	  (target[1] - voice.gain[1]) / static_cast<float>(frameCount)};
+
+	uint64_t step = GetStep(voice);
+	uint64_t lastPosition = static_cast<uint64_t>(source.frameCount - 1) << 32;
+	uint32_t done = 0;
+	while (done < frameCount) {
+		uint32_t index = static_cast<uint32_t>(voice.position >> 32);
+		if (index >= source.frameCount) {
+			if (!voice.desc.loop) {
+				voice.finished = true;
+				break;
+			}
+			voice.position -= static_cast<uint64_t>(source.frameCount) << 32;
+			continue;
+		}
+
+		float gain[2] = {
+		  voice.gain[0] + gainStep[0] * static_cast<float>(done),
+		  voice.gain[1] + gainStep[1] * static_cast<float>(done)};
+		if (voice.position < lastPosition) {
+			// 次のフレームが波形内にある間はまとめて処理する
+			uint64_t remain = (lastPosition - voice.position + step - 1) / step;
+			uint32_t count = static_cast<uint32_t>((std::min)(uint64_t(frameCount - done), remain));
+			MixSource(
+			  source, voice.position, step, count, bus.left + done, bus.right + done, gain,
+			  gainStep);
+			done += count;
+		} else {
+			// 最後のフレームは、ループなら先頭と、そうでなければ自身と補間する
+			uint32_t next = voice.desc.loop ? 0 : index;
+			float fraction =
+			  static_cast<float>(static_cast<uint32_t>(voice.position)) * kFractionScale;
+			float sample[2];
+			for (uint32_t c = 0; c < source.channelCount; c++) {
+				float a = LoadSourceSample(source, index, c);
+				sample[c] = a + (LoadSourceSample(source, next, c) - a) * fraction;
+			}
+			bus.left[done] += sample[0] * gain[0];
+			bus.right[done] += sample[source.channelCount - 1] * gain[1];
+			voice.position += step;
+			done++;
+		}
+	}
+	voice.gain[0] = target[0];
+	voice.gain[1] = target[1];
+}
+
+void Mixer::AdvanceVoice(Voice& voice, uint32_t frameCount) {
+	uint64_t length = static_cast<uint64_t>(voice.source.frameCount) << 32;
+	voice.position += GetStep(voice) * frameCount;
+	if (voice.position >= length) {
+		if (voice.desc.loop) {
+			voice.position %= length;
+		} else {
+			voice.finished = true;
+		}
+	}
+	// 再び混ぜる時は無音から立ち上げる
+	voice.gain[0] = 0.0f;
+	voice.gain[1] = 0.0f;
+	voice.mixed = true;
+}
+
+uint64_t Mixer::GetStep(const Voice& voice) const {
+	// 止まらないよう、極端に遅い再生速度は切り上げる
+	double pitch = (std::max)(static_cast<double>(voice.desc.pitch), 1.0 / 1024.0);
+	double ratio = static_cast<double>(voice.source.sampleRate) / sampleRate_ * pitch;
+	return (std::max)(static_cast<uint64_t>(ratio * 4294967296.0), uint64_t(1));
+}
+
+float Mixer::GetBusGain(uint32_t bus) const {
+	float gain = buses_[bus].volume;
+	while (bus != kMasterBus) {
+		bus = buses_[bus].parent;
+		gain *= buses_[bus].volume;
+	}
+	return gain;
+}
@@ -0,0 +1,182 @@
+#pragma once
+
+#include "AudioOutput.h"
+#include "SlotMap.h"
+#include <cstdint>
+#include <vector>
+
+// 波形のサンプル形式
+enum class MixerSampleFormat {
+	kInt16,   // 16bit整数
+	kFloat32, // 32bit浮動小数点
+};
+
+/// <summary>
+/// ミキサーで再生する波形（データは再生が終わるまで呼び出し側が保持する）
+/// </summary>
+struct MixerSource {
+	const void* data = nullptr; // チャンネルをインターリーブした波形
+	uint32_t frameCount = 0;    // フレーム数
+	uint32_t channelCount = 1;  // チャンネル数（1か2）
+	uint32_t sampleRate = 44100;
+	MixerSampleFormat format = MixerSampleFormat::kInt16;
+};
+
+/// <summary>
+/// 再生の設定
+/// </summary>
+struct MixerVoiceDesc {
+	uint32_t bus = 0;       // 出力するバス（0はマスター）
+	float volume = 1.0f;    // 音量
+	float pan = 0.0f;       // 定位（-1で左、1で右）
+	float pitch = 1.0f;     // 再生速度の倍率
+	float priority = 1.0f;  // 仮想化の優先度（聞こえる大きさに掛ける）
+	bool loop = false;      // ループ再生するか
+};
+
+/// <summary>
+/// ソフトウェアミキサー
+/// 再生中の音声をバス毎に足し合わせ、バスを親に足し合わせてマスターを出力に書く。
+/// 同時に鳴らす数が上限を超えたら、聞こえにくいものは位置だけ進めて混ぜない（仮想化）。
+/// 1スレッドから使う（スレッドセーフではない）
+/// </summary>
+class Mixer {
+public: // 定数
+	// 同時に再生できる音声の最大数（仮想化したものを含む）
+	static const uint32_t kMaxVoiceCount = 512;
+	// バスの最大数
+	static const uint32_t kMaxBusCount = 16;
+	// マスターバス
+	static const uint32_t kMasterBus = 0;
+	// 一度にミックスするフレーム数
+	static constexpr uint32_t kBlockFrameCount = 256;
+	// 無効なハンドル
+	static const uint32_t kInvalidHandle = 0;
+
+public: // サブクラス
+	// 統計（直前のブロック）
+	struct Statistics {
+		uint32_t realVoiceCount = 0;    // 混ぜた音声数
+		uint32_t virtualVoiceCount = 0; // 仮想化した音声数
+		uint64_t renderedFrameCount = 0; // 出力した総フレーム数
+	};
+
+public: // メンバ関数
+	/// <summary>
+	/// 初期化
+	/// </summary>
+	/// <param name="sampleRate">出力のサンプリング周波数</param>
+	/// <param name="output">出力先</param>
+	/// <param name="voiceBudget">実際に混ぜる音声数の上限</param>
+	void Initialize(uint32_t sampleRate, AudioOutput* output, uint32_t voiceBudget = 64);
+
+	/// <summary>
+	/// バスを作る
+	/// </summary>
+	/// <param name="parent">出力先のバス</param>
+	/// <param name="volume">音量</param>
+	/// <returns>バスの番号</returns>
+	uint32_t CreateBus(uint32_t parent = kMasterBus, float volume = 1.0f);
+
+	/// <summary>
+	/// バスの音量を設定
+	/// </summary>
+	void SetBusVolume(uint32_t bus, float volume);
+
+	/// <summary>
+	/// 再生
+	/// </summary>
+	/// <returns>ハンドル（同時再生数が上限ならkInvalidHandle）</returns>
+	uint32_t Play(const MixerSource& source, const MixerVoiceDesc& desc = {});
+
+	/// <summary>
+	/// 停止
+	/// </summary>
+	void Stop(uint32_t handle);
+
+	/// <summary>
+	/// 再生中か（仮想化中も再生中とみなす）
+	/// </summary>
+	bool IsPlaying(uint32_t handle) { return voices_.Find(handle) != nullptr; }
+
+	/// <summary>
+	/// 音量・定位・再生速度の設定（音量と定位はブロック内で滑らかに変える）
+	/// </summary>
+	void SetVolume(uint32_t handle, float volume);
+	void SetPan(uint32_t handle, float pan);
+	void SetPitch(uint32_t handle, float pitch);
+
+	/// <summary>
+	/// 一時停止と再開（一時停止中は混ぜず、再生位置も進めない）
+	/// </summary>
+	void SetPaused(uint32_t handle, bool paused);
+
+	/// <summary>
+	/// 実際に混ぜる音声数の上限を設定
+	/// </summary>
+	void SetVoiceBudget(uint32_t voiceBudget) { voiceBudget_ = voiceBudget; }
+
+	/// <summary>
+	/// ミックスして出力に書く
+	/// </summary>
+	/// <param name="frameCount">フレーム数（kBlockFrameCount毎に分けて処理する）</param>
+	void Render(uint32_t frameCount);
+
+	/// <summary>
+	/// 統計の取得
+	/// </summary>
+	const Statistics& GetStatistics() const { return statistics_; }
+
+private: // サブクラス
+	// 再生中の音声
+	struct Voice {
+		MixerSource source;
+		MixerVoiceDesc desc;
+		// 読み込み位置（32.32の固定小数点のフレーム位置）
+		uint64_t position = 0;
+		// 直前のブロックの終わりの左右ゲイン
+		float gain[2] = {};
+		// 最初のブロックを混ぜたか（それまではゲインを滑らかに変えない）
+		bool mixed = false;
+		// 最後まで再生したか
+		bool finished = false;
+		// 一時停止中か
+		bool paused = false;
+	};
+
+	// バス
+	struct Bus {
+		uint32_t parent = 0;
+		float volume = 1.0f;
+		// ミックス中のブロック（左右）
+		alignas(16) float left[kBlockFrameCount];
+		alignas(16) float right[kBlockFrameCount];
+	};
+
+	// 仮想化の判定用
+	struct VoiceRank {
+		float audibility;
+		uint32_t handle;
+	};
+
+private: // メンバ関数
+	// 1ブロック分をミックスする
+	void RenderBlock(uint32_t frameCount);
+	// 音声をバスに混ぜる
+	void MixVoice(Voice& voice, Bus& bus, uint32_t frameCount);
+	// 混ぜずに位置だけ進める
+	void AdvanceVoice(Voice& voice, uint32_t frameCount);
+	// 1出力フレームあたりの読み込み位置の進み（32.32の固定小数点）
+	uint64_t GetStep(const Voice& voice) const;
+	// バスの音量を親まで掛けたもの
+	float GetBusGain(uint32_t bus) const;
+
+private: // メンバ変数
+	AudioOutput* output_ = nullptr;
+	uint32_t sampleRate_ = 48000;
+	uint32_t voiceBudget_ = 64;
+	SlotMap<Voice, kMaxVoiceCount> voices_;
+	std::vector<Bus> buses_;
+	std::vector<VoiceRank> ranks_;
+	Statistics statistics_;
+};
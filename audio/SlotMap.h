@@ -0,0 +1,131 @@
+#pragma once
+
+#include <array>
+#include <cassert>
+#include <cstdint>
+
+/// <summary>
+/// 世代付きハンドルで要素を引く固定容量の表
+/// ハンドルは下位16ビットが枠の番号、上位16ビットが世代。
+/// 枠を再利用すると世代が変わるので、古いハンドルでは引けない。
+/// 追加・削除・検索は全てO(1)（スレッドセーフではない）
+/// </summary>
+template<typename T, uint32_t Capacity>
+class SlotMap {
+	static_assert(0 < Capacity && Capacity < 0xffff);
+
+public: // 定数
+	// 無効なハンドル（世代は1から始まるので、有効なハンドルは0にならない）
+	static const uint32_t kInvalidHandle = 0;
+
+public: // メンバ関数
+	SlotMap() { Clear(); }
+
+	/// <summary>
+	/// 全ての要素を削除する（発行済みのハンドルは全て無効になる）
+	/// </summary>
+	void Clear() {
+		for (uint32_t i = 0; i < Capacity; i++) {
+			if (slots_[i].used) {
+				slots_[i].used = false;
+				NextGeneration(slots_[i]);
+			}
+			slots_[i].nextFree = i + 1;
+		}
+		freeHead_ = 0;
+		count_ = 0;
+	}
+
+	/// <summary>
+	/// 要素を追加する
+	/// </summary>
+	/// <returns>ハンドル（満杯ならkInvalidHandle）</returns>
+	uint32_t Insert(const T& value) {
+		if (freeHead_ == Capacity) {
+			return kInvalidHandle;
+		}
+		uint32_t index = freeHead_;
+		Slot& slot = slots_[index];
+		freeHead_ = slot.nextFree;
+		slot.value = value;
+		slot.used = true;
+		count_++;
+		return static_cast<uint32_t>(slot.generation) << 16 | index;
+	}
+
+	/// <summary>
+	/// ハンドルから要素を探す
+	/// </summary>
+	/// <returns>要素（削除済み・無効なハンドルならnullptr）</returns>
+	T* Find(uint32_t handle) {
+		uint32_t index = handle & 0xffff;
+		if (index >= Capacity) {
+			return nullptr;
+		}
+		Slot& slot = slots_[index];
+		if (!slot.used || slot.generation != handle >> 16) {
+			return nullptr;
+		}
+		return &slot.value;
+	}
+
+	/// <summary>
+	/// 要素を削除する
+	/// </summary>
+	/// <returns>削除したか（削除済み・無効なハンドルならfalse）</returns>
+	bool Remove(uint32_t handle) {
+		if (!Find(handle)) {
+			return false;
+		}
+		uint32_t index = handle & 0xffff;
+		Slot& slot = slots_[index];
+		slot.used = false;
+		slot.value = T();
+		NextGeneration(slot);
+		slot.nextFree = freeHead_;
+		freeHead_ = index;
+		count_--;
+		return true;
+	}
+
+	/// <summary>
+	/// 全ての要素に対して処理する
+	/// </summary>
+	/// <param name="function">(ハンドル, 要素)を受け取る処理</param>
+	template<typename Function>
+	void ForEach(Function function) {
+		for (uint32_t i = 0; i < Capacity; i++) {
+			if (slots_[i].used) {
+				function(static_cast<uint32_t>(slots_[i].generation) << 16 | i, slots_[i].value);
+			}
+		}
+	}
+
+	/// <summary>
+	/// 要素数の取得
+	/// </summary>
+	uint32_t GetCount() const { return count_; }
+
+private: // サブクラス
+	struct Slot {
+		T value = T();
+		uint16_t generation = 1;
+		bool used = false;
+		uint32_t nextFree = 0;
+	};
+
+private: // メンバ関数
+	// 世代を進める（0はハンドルを無効値にしてしまうので飛ばす）
+	static void NextGeneration(Slot& slot) {
+		slot.generation++;
+		if (slot.generation == 0) {
+			slot.generation = 1;
+		}
+	}
+
+private: // メンバ変数
+	std::array<Slot, Capacity> slots_;
+	// 空き枠の連結リストの先頭（Capacityなら空きなし）
+	uint32_t freeHead_ = 0;
+	uint32_t count_ = 0;
+};
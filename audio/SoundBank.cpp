@@ -0,0 +1,157 @@
+﻿#include "SoundBank.h"
+#include <algorithm>
+#include <cassert>
+#include <cstring>
+
+namespace {
+
+const char kMagic[4] = {'S', 'B', 'N', 'K'};
+
+// ファイル上の並びを変えないよう大きさを固定する
+static_assert(sizeof(SoundBank::Header) == 16);
+static_assert(sizeof(SoundBank::Entry) == 64);
+
+// 境界に揃える
+size_t AlignUp(size_t value, size_t alignment) {
+	return (value + alignment - 1) / alignment * alignment;
+}
+
+} // namespace
+
+uint64_t SoundBank::HashName(std::string_view name) {
+	uint64_t hash = 14695981039346656037ull;
+	for (char c : name) {
+		hash ^= static_cast<uint8_t>(c);
+		hash *= 1099511628211ull;
+	}
+	return hash;
+}
+
+std::vector<uint8_t> SoundBank::Build(const std::vector<Source>& sources) {
+	// 索引はハッシュ順（同じハッシュは名前順）に並べて二分探索できるようにする
+	std::vector<uint32_t> order(sources.size());
+	std::vector<uint64_t> hashes(sources.size());
+	for (uint32_t i = 0; i < sources.size(); i++) {
+		order[i] = i;
+		hashes[i] = HashName(sources[i].name);
+	}
+	std::sort(order.begin(), order.end(), [&](uint32_t a, uint32_t b) {
+		return hashes[a] != hashes[b] ? hashes[a] < hashes[b] : sources[a].name < sources[b].name;
+	});
+
+	// 並び順を決める
+	std::vector<Entry> entries(sources.size());
+	size_t offset = sizeof(Header) + sizeof(Entry) * entries.size();
+	for (uint32_t i = 0; i < order.size(); i++) {
+		const Source& source = sources[order[i]];
+		assert(i == 0 || source.name != sources[order[i - 1]].name);
+		Entry& entry = entries[i];
+		entry.nameHash = hashes[order[i]];
+		entry.nameOffset = static_cast<uint32_t>(offset);
+		entry.nameLength = static_cast<uint32_t>(source.name.size());
+		offset += source.name.size();
+	}
+	for (uint32_t i = 0; i < order.size(); i++) {
+		const Source& source = sources[order[i]];
+		Entry& entry = entries[i];
+		offset = AlignUp(offset, kDataAlignment);
+		entry.format = source.format;
+		entry.dataOffset = static_cast<uint32_t>(offset);
+		entry.dataSize = static_cast<uint32_t>(source.data.size());
+		entry.frameCount = source.frameCount;
+		entry.loopStart = source.loopStart;
+		entry.loopEnd = source.loopEnd;
+		entry.flags = source.flags;
+		offset += source.data.size();
+	}
+	// 位置は32bitで持つ
+	assert(offset <= UINT32_MAX);
+
+	// 書き込む
+	std::vector<uint8_t> file(offset);
+	Header header = {};
+	memcpy(header.magic, kMagic, sizeof(kMagic));
+	header.version = kVersion;
+	header.entryCount = static_cast<uint32_t>(entries.size());
+	memcpy(file.data(), &header, sizeof(header));
+	if (!entries.empty()) {
+		memcpy(file.data() + sizeof(Header), entries.data(), sizeof(Entry) * entries.size());
+	}
+	for (uint32_t i = 0; i < order.size(); i++) {
+		const Source& source = sources[order[i]];
+		const Entry& entry = entries[i];
+		memcpy(file.data() + entry.nameOffset, source.name.data(), source.name.size());
+		if (!source.data.empty()) {
+			memcpy(file.data() + entry.dataOffset, source.data.data(), source.data.size());
+		}
+	}
+	return file;
+}
+
+bool SoundBank::Open(const uint8_t* data, size_t size) {
+	data_ = nullptr;
+	size_ = 0;
+	header_ = nullptr;
+	entries_ = nullptr;
+
+	if (size < sizeof(Header)) {
+		return false;
+	}
+	const Header* header = reinterpret_cast<const Header*>(data);
+	if (memcmp(header->magic, kMagic, sizeof(kMagic)) != 0 || header->version != kVersion) {
+		return false;
+	}
+	if (header->entryCount > (size - sizeof(Header)) / sizeof(Entry)) {
+		return false;
+	}
+
+	// 壊れたファイルで範囲外を読まないよう、全ての索引を確かめておく
+	const Entry* entries = reinterpret_cast<const Entry*>(data + sizeof(Header));
+	for (uint32_t i = 0; i < header->entryCount; i++) {
+		const Entry& entry = entries[i];
+		if (entry.nameOffset > size || entry.nameLength > size - entry.nameOffset) {
+			return false;
+		}
+		if (entry.dataOffset > size || entry.dataSize > size - entry.dataOffset) {
+			return false;
+		}
+		if (entry.format.channels == 0 || entry.format.blockAlign == 0) {
+			return false;
+		}
+		bool hasLoop = entry.loopEnd != 0;
+		if (hasLoop && (entry.loopStart >= entry.loopEnd || entry.loopEnd > entry.frameCount)) {
+			return false;
+		}
+		if (i > 0 && entries[i - 1].nameHash > entry.nameHash) {
+			return false;
+		}
+	}
+
+	data_ = data;
+	size_ = size;
+	header_ = header;
+	entries_ = entries;
+	return true;
+}
+
+std::string_view SoundBank::GetName(uint32_t index) const {
+	const Entry& entry = entries_[index];
+	const char* name = reinterpret_cast<const char*>(data_ + entry.nameOffset);
+	return std::string_view(name, entry.nameLength);
+}
+
+int32_t SoundBank::Find(std::string_view name) const {
+	uint64_t hash = HashName(name);
+	const Entry* end = entries_ + GetEntryCount();
+	const Entry* it = std::lower_bound(entries_, end, hash, [](const Entry& entry, uint64_t value) {
+		return entry.nameHash < value;
+	});
+	// ハッシュが衝突していれば名前で確かめる
+	for (; it != end && it->nameHash == hash; ++it) {
+		int32_t index = static_cast<int32_t>(it - entries_);
+		if (GetName(index) == name) {
+			return index;
+		}
+	}
+	return -1;
+}
@@ -0,0 +1,112 @@
+#pragma once
+
+#include "WaveParser.h"
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+
+/// <summary>
+/// サウンドバンク（複数の波形を1ファイルにまとめたもの）
+/// ヘッダー、名前のハッシュ順に並べた索引、名前、16バイト境界に揃えた波形データの順に並ぶ。
+/// 開く時はファイル全体をメモリに置き（マップでよい）、波形データはコピーせずにそのまま使う
+/// </summary>
+class SoundBank {
+public: // 定数
+	// 形式のバージョン
+	static const uint32_t kVersion = 1;
+	// 波形データの境界
+	static const uint32_t kDataAlignment = 16;
+	// 圧縮した波形を読み込み時に展開せず、再生時に展開する
+	static const uint32_t kFlagKeepCompressed = 1u << 0;
+
+public: // サブクラス
+	// ヘッダー
+	struct Header {
+		char magic[4];       // "SBNK"
+		uint32_t version;    // kVersion
+		uint32_t entryCount; // 索引の数
+		uint32_t reserved;
+	};
+
+	// 索引（1つの波形）
+	struct Entry {
+		uint64_t nameHash;   // 名前のハッシュ（HashName）
+		uint32_t nameOffset; // 名前のファイル内位置
+		uint32_t nameLength; // 名前のバイト数
+		WaveFormat format;   // 波形フォーマット
+		uint32_t dataOffset; // 波形データのファイル内位置
+		uint32_t dataSize;   // 波形データのバイト数
+		uint32_t frameCount; // フレーム数
+		uint32_t loopStart;  // ループ範囲（フレーム単位。loopEndが0なら無し）
+		uint32_t loopEnd;
+		uint32_t flags;      // kFlag～の組み合わせ
+		uint32_t reserved;
+	};
+
+	// 書き出す波形
+	struct Source {
+		std::string name;
+		WaveFormat format = {};
+		std::vector<uint8_t> data;
+		uint32_t frameCount = 0;
+		uint32_t loopStart = 0;
+		uint32_t loopEnd = 0;
+		uint32_t flags = 0;
+	};
+
+public: // 静的メンバ関数
+	/// <summary>
+	/// 名前のハッシュ（64bit FNV-1a）
+	/// </summary>
+	static uint64_t HashName(std::string_view name);
+
+	/// <summary>
+	/// サウンドバンクを作る
+	/// </summary>
+	/// <param name="sources">まとめる波形（名前は重複しないこと）</param>
+	/// <returns>ファイルの中身</returns>
+	static std::vector<uint8_t> Build(const std::vector<Source>& sources);
+
+public: // メンバ関数
+	/// <summary>
+	/// メモリ上のサウンドバンクを開く（全ての索引が範囲内か確かめる）
+	/// </summary>
+	/// <param name="data">ファイルの中身（使い終わるまで呼び出し側が保持する）</param>
+	/// <param name="size">バイト数</param>
+	/// <returns>サウンドバンクとして読めたか</returns>
+	bool Open(const uint8_t* data, size_t size);
+
+	/// <summary>
+	/// 索引の数
+	/// </summary>
+	uint32_t GetEntryCount() const { return header_ ? header_->entryCount : 0; }
+
+	/// <summary>
+	/// 索引の取得
+	/// </summary>
+	const Entry& GetEntry(uint32_t index) const { return entries_[index]; }
+
+	/// <summary>
+	/// 名前の取得
+	/// </summary>
+	std::string_view GetName(uint32_t index) const;
+
+	/// <summary>
+	/// 波形データの取得
+	/// </summary>
+	const uint8_t* GetData(uint32_t index) const { return data_ + entries_[index].dataOffset; }
+
+	/// <summary>
+	/// 名前で索引を探す
+	/// </summary>
+	/// <returns>索引の番号（無ければ-1）</returns>
+	int32_t Find(std::string_view name) const;
+
+private: // メンバ変数
+	const uint8_t* data_ = nullptr;
+	size_t size_ = 0;
+	const Header* header_ = nullptr;
+	const Entry* entries_ = nullptr;
+};
@@ -0,0 +1,244 @@
+﻿#include "SpatialAudio.h"
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+#include <emmintrin.h>
+
+namespace {
+
+const float kPi = 3.14159265f;
+// これより近い音源は向きが決まらないものとして扱う
+const float kEpsilon = 1.0e-4f;
+// 速度の視線方向成分の上限（音速に対する割合。周波数比の分母が0にならないようにする）
+const float kMaxVelocityRatio = 0.5f;
+
+// 配列の端数の部分を埋める値（計算しても0除算にならない音源）
+const float kPaddingMinDistance = 1.0f;
+const float kPaddingMaxDistance = 2.0f;
+
+// スピーカーの向きを設定する（角度は正面を0、右回りを正とする度数）
+void SetSpeaker(SpeakerLayout& layout, uint32_t channel, float degree, float weight = 1.0f) {
+	float radian = degree * kPi / 180.0f;
+	layout.directionX[channel] = std::sin(radian);
+	layout.directionZ[channel] = std::cos(radian);
+	layout.weight[channel] = weight;
+}
+
+// maskが立っている要素はa、それ以外はbを選ぶ
+inline __m128 Select(__m128 mask, __m128 a, __m128 b) {
+	return _mm_or_ps(_mm_and_ps(mask, a), _mm_andnot_ps(mask, b));
+}
+
+// 値を範囲内に収める
+inline __m128 Clamp(__m128 value, __m128 low, __m128 high) {
+	return _mm_min_ps(_mm_max_ps(value, low), high);
+}
+
+// 4要素ずつの内積
+inline __m128 Dot(__m128 ax, __m128 ay, __m128 az, __m128 bx, __m128 by, __m128 bz) {
+	return _mm_add_ps(_mm_add_ps(_mm_mul_ps(ax, bx), _mm_mul_ps(ay, by)), _mm_mul_ps(az, bz));
+}
+
+} // namespace
+
+SpeakerLayout SpeakerLayout::Create(uint32_t channelCount) {
+	assert(1 <= channelCount && channelCount <= kMaxChannelCount);
+	SpeakerLayout layout;
+	layout.channelCount = channelCount;
+	switch (channelCount) {
+	case 1:
+		// 向きを持たないので、どこにあっても同じ重みになる
+		layout.weight[0] = 1.0f;
+		break;
+	case 4:
+		SetSpeaker(layout, 0, -45.0f);
+		SetSpeaker(layout, 1, 45.0f);
+		SetSpeaker(layout, 2, -135.0f);
+		SetSpeaker(layout, 3, 135.0f);
+		layout.sharpness = 2;
+		break;
+	case 6:
+		SetSpeaker(layout, 0, -30.0f);
+		SetSpeaker(layout, 1, 30.0f);
+		SetSpeaker(layout, 2, 0.0f);
+		SetSpeaker(layout, 3, 0.0f, 0.0f);
+		SetSpeaker(layout, 4, -110.0f);
+		SetSpeaker(layout, 5, 110.0f);
+		layout.sharpness = 2;
+		break;
+	case 8:
+		SetSpeaker(layout, 0, -30.0f);
+		SetSpeaker(layout, 1, 30.0f);
+		SetSpeaker(layout, 2, 0.0f);
+		SetSpeaker(layout, 3, 0.0f, 0.0f);
+		SetSpeaker(layout, 4, -150.0f);
+		SetSpeaker(layout, 5, 150.0f);
+		SetSpeaker(layout, 6, -90.0f);
+		SetSpeaker(layout, 7, 90.0f);
+		layout.sharpness = 3;
+		break;
+	default:
+		// ステレオは真横で片側だけから聞こえるよう左右に置く（残りのチャンネルには出さない）
+		SetSpeaker(layout, 0, -90.0f);
+		SetSpeaker(layout, 1, 90.0f);
+		break;
+	}
+	return layout;
+}
+
+void SpatialBatch::Clear() {
+	count_ = 0;
+	capacity_ = 0;
+	for (std::vector<float>* array :
+	     {&positionX_, &positionY_, &positionZ_, &velocityX_, &velocityY_, &velocityZ_,
+	      &minDistances_, &maxDistances_, &rolloffs_, &dopplerScales_}) {
+		array->clear();
+	}
+	curves_.clear();
+}
+
+uint32_t SpatialBatch::Add(
+  const Vector3& position, const Vector3& velocity, const SpatialEmitterDesc& desc) {
+	assert(desc.minDistance > 0.0f);
+	assert(desc.curve != AttenuationCurve::kLinear || desc.maxDistance > desc.minDistance);
+
+	if (count_ == capacity_) {
+		// 4つ分ずつ伸ばし、端数の部分は計算できる値で埋める
+		capacity_ += 4;
+		for (std::vector<float>* array :
+		     {&positionX_, &positionY_, &positionZ_, &velocityX_, &velocityY_, &velocityZ_,
+		      &rolloffs_, &dopplerScales_}) {
+			array->resize(capacity_, 0.0f);
+		}
+		minDistances_.resize(capacity_, kPaddingMinDistance);
+		maxDistances_.resize(capacity_, kPaddingMaxDistance);
+		curves_.resize(capacity_, static_cast<uint32_t>(AttenuationCurve::kNone));
+	}
+
+	uint32_t index = count_++;
+	positionX_[index] = position.x;
+	positionY_[index] = position.y;
+	positionZ_[index] = position.z;
+	velocityX_[index] = velocity.x;
+	velocityY_[index] = velocity.y;
+	velocityZ_[index] = velocity.z;
+	minDistances_[index] = desc.minDistance;
+	// 最大距離が最小距離より近ければ、最小距離より遠くでも減衰しない
+	maxDistances_[index] = (std::max)(desc.maxDistance, desc.minDistance);
+	rolloffs_[index] = desc.rolloff;
+	dopplerScales_[index] = desc.dopplerScale;
+	curves_[index] = static_cast<uint32_t>(desc.curve);
+	return index;
+}
+
+void SpatialBatch::Compute(const SpatialListener& listener, const SpeakerLayout& layout) {
+	const uint32_t channelCount = layout.channelCount;
+	assert(channelCount <= SpeakerLayout::kMaxChannelCount);
+	gains_.resize(capacity_);
+	frequencyRatios_.resize(capacity_);
+	channelGains_.resize(static_cast<size_t>(capacity_) * channelCount);
+
+	const __m128 zero = _mm_setzero_ps();
+	const __m128 one = _mm_set1_ps(1.0f);
+	const __m128 half = _mm_set1_ps(0.5f);
+	const __m128 epsilon = _mm_set1_ps(kEpsilon);
+	const __m128 tiny = _mm_set1_ps(1.0e-20f);
+	const __m128 speedOfSound = _mm_set1_ps(kSpeedOfSound);
+	const __m128 maxVelocity = _mm_set1_ps(kSpeedOfSound * kMaxVelocityRatio);
+	const __m128 minVelocity = _mm_set1_ps(-kSpeedOfSound * kMaxVelocityRatio);
+	const __m128 minRatio = _mm_set1_ps(kMinFrequencyRatio);
+	const __m128 maxRatio = _mm_set1_ps(kMaxFrequencyRatio);
+	const __m128i linearCurve = _mm_set1_epi32(static_cast<int>(AttenuationCurve::kLinear));
+	const __m128i noneCurve = _mm_set1_epi32(static_cast<int>(AttenuationCurve::kNone));
+
+	const __m128 listenerX = _mm_set1_ps(listener.position.x);
+	const __m128 listenerY = _mm_set1_ps(listener.position.y);
+	const __m128 listenerZ = _mm_set1_ps(listener.position.z);
+	const __m128 rightX = _mm_set1_ps(listener.right.x);
+	const __m128 rightY = _mm_set1_ps(listener.right.y);
+	const __m128 rightZ = _mm_set1_ps(listener.right.z);
+	const __m128 forwardX = _mm_set1_ps(listener.forward.x);
+	const __m128 forwardY = _mm_set1_ps(listener.forward.y);
+	const __m128 forwardZ = _mm_set1_ps(listener.forward.z);
+	const __m128 listenerVelocityX = _mm_set1_ps(listener.velocity.x);
+	const __m128 listenerVelocityY = _mm_set1_ps(listener.velocity.y);
+	const __m128 listenerVelocityZ = _mm_set1_ps(listener.velocity.z);
+
+	for (uint32_t i = 0; i < capacity_; i += 4) {
+		// リスナーから音源へのベクトルと距離
+		__m128 x = _mm_sub_ps(_mm_loadu_ps(&positionX_[i]), listenerX);
+		__m128 y = _mm_sub_ps(_mm_loadu_ps(&positionY_[i]), listenerY);
+		__m128 z = _mm_sub_ps(_mm_loadu_ps(&positionZ_[i]), listenerZ);
+		__m128 distance = _mm_sqrt_ps(Dot(x, y, z, x, y, z));
+		// 重なっている音源は向きを0にする
+		__m128 inverseDistance = _mm_and_ps(
+		  _mm_cmpgt_ps(distance, epsilon), _mm_div_ps(one, _mm_max_ps(distance, epsilon)));
+
+		// 距離減衰
+		__m128 minDistance = _mm_loadu_ps(&minDistances_[i]);
+		__m128 maxDistance = _mm_loadu_ps(&maxDistances_[i]);
+		__m128 over = _mm_sub_ps(Clamp(distance, minDistance, maxDistance), minDistance);
+		__m128 inverse = _mm_div_ps(
+		  minDistance, _mm_add_ps(minDistance, _mm_mul_ps(_mm_loadu_ps(&rolloffs_[i]), over)));
+		// 最大距離と最小距離が同じ（kLinear以外）なら、差は0なので0除算にならないよう除数を揃える
+		__m128 range = _mm_max_ps(_mm_sub_ps(maxDistance, minDistance), epsilon);
+		__m128 linear = _mm_sub_ps(one, _mm_div_ps(over, range));
+		__m128i curve = _mm_loadu_si128(reinterpret_cast<const __m128i*>(&curves_[i]));
+		__m128 isLinear = _mm_castsi128_ps(_mm_cmpeq_epi32(curve, linearCurve));
+		__m128 isNone = _mm_castsi128_ps(_mm_cmpeq_epi32(curve, noneCurve));
+		__m128 gain = Select(isNone, one, Select(isLinear, linear, inverse));
+		_mm_storeu_ps(&gains_[i], gain);
+
+		// リスナー空間の水平方向（最小距離より近ければ、近いほど全体から聞こえるようにする）
+		__m128 spread = _mm_min_ps(_mm_div_ps(distance, minDistance), one);
+		__m128 scale = _mm_mul_ps(inverseDistance, spread);
+		__m128 directionX = _mm_mul_ps(Dot(x, y, z, rightX, rightY, rightZ), scale);
+		__m128 directionZ = _mm_mul_ps(Dot(x, y, z, forwardX, forwardY, forwardZ), scale);
+
+		// スピーカー毎の重み（向きが近いほど大きい）
+		__m128 weights[SpeakerLayout::kMaxChannelCount];
+		__m128 weightSum = zero;
+		for (uint32_t c = 0; c < channelCount; c++) {
+			if (layout.weight[c] == 0.0f) {
+				weights[c] = zero;
+				continue;
+			}
+			__m128 cosine = _mm_add_ps(
+			  _mm_mul_ps(directionX, _mm_set1_ps(layout.directionX[c])),
+			  _mm_mul_ps(directionZ, _mm_set1_ps(layout.directionZ[c])));
+			__m128 base = _mm_mul_ps(_mm_add_ps(one, cosine), half);
+			__m128 weight = base;
+			for (uint32_t k = 1; k < layout.sharpness; k++) {
+				weight = _mm_mul_ps(weight, base);
+			}
+			weights[c] = _mm_mul_ps(weight, _mm_set1_ps(layout.weight[c]));
+			weightSum = _mm_add_ps(weightSum, weights[c]);
+		}
+		// 重みの割合で電力を分ける（各チャンネルのゲインの2乗の和がgainの2乗になる）
+		__m128 power = _mm_div_ps(_mm_mul_ps(gain, gain), _mm_max_ps(weightSum, tiny));
+		for (uint32_t c = 0; c < channelCount; c++) {
+			_mm_storeu_ps(
+			  &channelGains_[static_cast<size_t>(c) * capacity_ + i],
+			  _mm_sqrt_ps(_mm_mul_ps(weights[c], power)));
+		}
+
+		// ドップラー効果（音源へ向かう単位ベクトルへの速度の成分から周波数比を求める）
+		__m128 unitX = _mm_mul_ps(x, inverseDistance);
+		__m128 unitY = _mm_mul_ps(y, inverseDistance);
+		__m128 unitZ = _mm_mul_ps(z, inverseDistance);
+		__m128 listenerSpeed = Clamp(
+		  Dot(listenerVelocityX, listenerVelocityY, listenerVelocityZ, unitX, unitY, unitZ),
+		  minVelocity, maxVelocity);
+		__m128 sourceVelocityX = _mm_loadu_ps(&velocityX_[i]);
+		__m128 sourceVelocityY = _mm_loadu_ps(&velocityY_[i]);
+		__m128 sourceVelocityZ = _mm_loadu_ps(&velocityZ_[i]);
+		__m128 sourceSpeed = Clamp(
+		  Dot(sourceVelocityX, sourceVelocityY, sourceVelocityZ, unitX, unitY, unitZ), minVelocity,
+		  maxVelocity);
+		__m128 ratio = _mm_div_ps(
+		  _mm_add_ps(speedOfSound, listenerSpeed), _mm_add_ps(speedOfSound, sourceSpeed));
+		__m128 dopplerScale = _mm_loadu_ps(&dopplerScales_[i]);
+		ratio = _mm_add_ps(one, _mm_mul_ps(_mm_sub_ps(ratio, one), dopplerScale));
+		_mm_storeu_ps(&frequencyRatios_[i], Clamp(ratio, minRatio, maxRatio));
+	}
+}
@@ -0,0 +1,126 @@
+#pragma once
+
+#include "Vector3.h"
+#include <cstdint>
+#include <vector>
+
+// 距離減衰の曲線
+enum class AttenuationCurve {
+	kInverse, // 最小距離で1、距離に反比例して下がる（rolloffが大きいほど速く下がる）
+	kLinear,  // 最小距離で1、最大距離で0になるよう直線的に下がる
+	kNone,    // 減衰しない
+};
+
+/// <summary>
+/// 音源（エミッター）の設定
+/// </summary>
+struct SpatialEmitterDesc {
+	float minDistance = 1.0f;   // これより近くでは減衰しない（0より大きいこと）
+	float maxDistance = 100.0f; // これより遠くでは減衰が変わらない（minDistanceより大きいこと）
+	float rolloff = 1.0f;       // kInverseの減衰の速さ
+	AttenuationCurve curve = AttenuationCurve::kInverse;
+	float dopplerScale = 1.0f;  // ドップラー効果の強さ（0で無し）
+};
+
+/// <summary>
+/// 聞き手（リスナー）
+/// 向きは水平方向の定位にだけ使う（上下は区別しない）
+/// </summary>
+struct SpatialListener {
+	Vector3 position = {0.0f, 0.0f, 0.0f};
+	Vector3 right = {1.0f, 0.0f, 0.0f};   // 右方向（単位ベクトル）
+	Vector3 forward = {0.0f, 0.0f, 1.0f}; // 正面方向（単位ベクトル）
+	Vector3 velocity = {0.0f, 0.0f, 0.0f}; // 速度（毎秒）
+};
+
+/// <summary>
+/// スピーカー配置
+/// チャンネルの並びはWAVEFORMATEXTENSIBLEの標準の並び（L, R, C, LFE, 後方L, 後方R, 側方L, 側方R）
+/// </summary>
+struct SpeakerLayout {
+	// 最大チャンネル数
+	static const uint32_t kMaxChannelCount = 8;
+
+	uint32_t channelCount = 2;
+	// 各スピーカーの水平方向（リスナー空間の右と正面の成分）
+	float directionX[kMaxChannelCount] = {};
+	float directionZ[kMaxChannelCount] = {};
+	// 振り分けに加えるか（LFEは0）
+	float weight[kMaxChannelCount] = {};
+	// 振り分けの鋭さ（スピーカー毎の重みを何乗するか。スピーカーが多いほど大きくする）
+	uint32_t sharpness = 1;
+
+	/// <summary>
+	/// チャンネル数に応じた標準の配置（1, 2, 4, 6, 8。それ以外は前の2チャンネルを左右とする）
+	/// </summary>
+	static SpeakerLayout Create(uint32_t channelCount);
+};
+
+/// <summary>
+/// 音源の減衰と定位とドップラー効果を、全ての音源についてまとめて計算する
+/// 音源は成分毎の配列に並べて、SSEで4つずつ計算する
+/// </summary>
+class SpatialBatch {
+public: // 定数
+	// 音速（毎秒）
+	static constexpr float kSpeedOfSound = 343.0f;
+	// 周波数比の範囲（XAudio2のボイスの上限に合わせる）
+	static constexpr float kMinFrequencyRatio = 0.5f;
+	static constexpr float kMaxFrequencyRatio = 2.0f;
+
+public: // メンバ関数
+	/// <summary>
+	/// 音源を全て外す
+	/// </summary>
+	void Clear();
+
+	/// <summary>
+	/// 音源を加える
+	/// </summary>
+	/// <param name="position">位置</param>
+	/// <param name="velocity">速度（毎秒）</param>
+	/// <param name="desc">設定</param>
+	/// <returns>音源の番号</returns>
+	uint32_t Add(const Vector3& position, const Vector3& velocity, const SpatialEmitterDesc& desc);
+
+	/// <summary>
+	/// 全ての音源の減衰、チャンネル毎のゲイン、周波数比を計算する
+	/// </summary>
+	void Compute(const SpatialListener& listener, const SpeakerLayout& layout);
+
+	/// <summary>
+	/// 音源の数
+	/// </summary>
+	uint32_t GetCount() const { return count_; }
+
+	/// <summary>
+	/// 距離減衰（0～1）
+	/// </summary>
+	float GetGain(uint32_t index) const { return gains_[index]; }
+
+	/// <summary>
+	/// 出力チャンネルのゲイン（各チャンネルの2乗の和が距離減衰の2乗になる）
+	/// </summary>
+	float GetChannelGain(uint32_t index, uint32_t channel) const {
+		return channelGains_[channel * capacity_ + index];
+	}
+
+	/// <summary>
+	/// ドップラー効果による周波数比
+	/// </summary>
+	float GetFrequencyRatio(uint32_t index) const { return frequencyRatios_[index]; }
+
+private: // メンバ変数
+	uint32_t count_ = 0;
+	// 配列の長さ（4の倍数。端数の部分は計算できる値で埋めておく）
+	uint32_t capacity_ = 0;
+	// 音源（成分毎の配列）
+	std::vector<float> positionX_, positionY_, positionZ_;
+	std::vector<float> velocityX_, velocityY_, velocityZ_;
+	std::vector<float> minDistances_, maxDistances_, rolloffs_, dopplerScales_;
+	std::vector<uint32_t> curves_;
+	// 計算結果
+	std::vector<float> gains_;
+	std::vector<float> channelGains_;
+	std::vector<float> frequencyRatios_;
+};
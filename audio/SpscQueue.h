@@ -0,0 +1,56 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <cstdint>
+
+/// <summary>
+/// 書き込み側1スレッド・読み出し側1スレッド用の固定容量キュー（ロックなし）
+/// </summary>
+template<typename T, uint32_t Capacity>
+class SpscQueue {
+	static_assert((Capacity & (Capacity - 1)) == 0, "Capacity must be a power of two");
+
+public: // メンバ関数
+	/// <summary>
+	/// 末尾に追加する（書き込み側）
+	/// </summary>
+	/// <returns>追加できたか（満杯ならfalse）</returns>
+	bool Push(const T& value) {
+		uint32_t tail = tail_.load(std::memory_order_relaxed);
+		if (tail - head_.load(std::memory_order_acquire) == Capacity) {
+			return false;
+		}
+		items_[tail & (Capacity - 1)] = value;
+		tail_.store(tail + 1, std::memory_order_release);
+		return true;
+	}
+
+	/// <summary>
+	/// 空いている数を取得する（書き込み側。読み出しが進めば増える）
+	/// </summary>
+	uint32_t GetFreeCount() const {
+		uint32_t tail = tail_.load(std::memory_order_relaxed);
+		return Capacity - (tail - head_.load(std::memory_order_acquire));
+	}
+
+	/// <summary>
+	/// 先頭から取り出す（読み出し側）
+	/// </summary>
+	/// <returns>取り出せたか（空ならfalse）</returns>
+	bool Pop(T& value) {
+		uint32_t head = head_.load(std::memory_order_relaxed);
+		if (head == tail_.load(std::memory_order_acquire)) {
+			return false;
+		}
+		value = items_[head & (Capacity - 1)];
+		head_.store(head + 1, std::memory_order_release);
+		return true;
+	}
+
+private: // メンバ変数
+	std::array<T, Capacity> items_;
+	// 読み出し位置と書き込み位置（通し番号）
+	std::atomic<uint32_t> head_{0};
+	std::atomic<uint32_t> tail_{0};
+};
@@ -0,0 +1,168 @@
+﻿#include "WaveParser.h"
+#include "ImaAdpcm.h"
+#include <algorithm>
+#include <cstring>
+#include <vector>
+
+namespace {
+
+// チャンクヘッダ
+struct ChunkHeader {
+	char id[4];    // チャンク毎のID
+	uint32_t size; // チャンクサイズ
+};
+
+// smplチャンクのループ情報
+struct SampleLoop {
+	uint32_t cuePointId;
+	uint32_t type;
+	uint32_t start;    // 開始フレーム
+	uint32_t end;      // 終了フレーム（含む）
+	uint32_t fraction;
+	uint32_t playCount;
+};
+
+// smplチャンクのループ情報より前の部分のバイト数と、その中のループ数の位置
+const uint32_t kSampleHeaderSize = 36;
+const uint32_t kSampleLoopCountOffset = 28;
+// cueチャンクの1点のバイト数と、その中のフレーム位置の位置
+const uint32_t kCuePointSize = 24;
+const uint32_t kCuePointOffset = 20;
+
+// 波形データのフレーム数
+uint32_t GetFrameCount(const WaveFormat& format, uint32_t dataSize) {
+	if (format.formatTag == ImaAdpcm::kFormatTag) {
+		if (!ImaAdpcm::IsValidFormat(format)) {
+			return 0;
+		}
+		return static_cast<uint32_t>(
+		  ImaAdpcm::GetDecodedSize(format, dataSize) / (format.channels * sizeof(int16_t)));
+	}
+	return dataSize / format.blockAlign;
+}
+
+} // namespace
+
+bool WaveParser::Parse(const ReadFunction& read, uint64_t fileSize, WaveInfo& info) {
+	info = {};
+
+	// RIFFヘッダー
+	ChunkHeader riff;
+	char type[4];
+	if (fileSize < sizeof(riff) + sizeof(type) || !read(0, &riff, sizeof(riff)) ||
+	    !read(sizeof(riff), type, sizeof(type)) || memcmp(riff.id, "RIFF", 4) != 0 ||
+	    memcmp(type, "WAVE", 4) != 0) {
+		return false;
+	}
+	// RIFFのサイズは書き出したツールによって正しくないことがあるので、ファイルの終わりまで調べる
+	uint64_t end = fileSize;
+
+	bool hasFormat = false;
+	bool hasData = false;
+	uint32_t factFrameCount = 0;
+	bool hasSampleLoop = false;
+	SampleLoop sampleLoop = {};
+	std::vector<uint32_t> cuePoints;
+
+	uint64_t offset = sizeof(riff) + sizeof(type);
+	while (offset + sizeof(ChunkHeader) <= end) {
+		ChunkHeader chunk;
+		if (!read(offset, &chunk, sizeof(chunk))) {
+			return false;
+		}
+		uint64_t body = offset + sizeof(chunk);
+		// 途中で切れたチャンクは、実際にある分だけを読む
+		uint32_t size = static_cast<uint32_t>((std::min)(uint64_t(chunk.size), end - body));
+
+		if (memcmp(chunk.id, "fmt ", 4) == 0 && !hasFormat) {
+			// 拡張部分（cbSize以降）は使わない
+			if (size < sizeof(WaveFormat) || !read(body, &info.format, sizeof(WaveFormat))) {
+				return false;
+			}
+			hasFormat = true;
+		} else if (memcmp(chunk.id, "data", 4) == 0 && !hasData) {
+			info.dataOffset = body;
+			info.dataSize = size;
+			hasData = true;
+		} else if (memcmp(chunk.id, "fact", 4) == 0) {
+			if (size >= sizeof(uint32_t) && !read(body, &factFrameCount, sizeof(uint32_t))) {
+				return false;
+			}
+		} else if (memcmp(chunk.id, "smpl", 4) == 0 && !hasSampleLoop) {
+			// ループ数が0か、最初のループ情報が収まっていなければ使わない
+			uint32_t loopCount = 0;
+			if (size >= kSampleHeaderSize + sizeof(SampleLoop)) {
+				if (!read(body + kSampleLoopCountOffset, &loopCount, sizeof(loopCount))) {
+					return false;
+				}
+				uint64_t loopOffset = body + kSampleHeaderSize;
+				if (loopCount > 0 && !read(loopOffset, &sampleLoop, sizeof(sampleLoop))) {
+					return false;
+				}
+			}
+			hasSampleLoop = loopCount > 0;
+		} else if (memcmp(chunk.id, "cue ", 4) == 0 && cuePoints.empty()) {
+			uint32_t count = 0;
+			if (size >= sizeof(count) && !read(body, &count, sizeof(count))) {
+				return false;
+			}
+			// 宣言された数がチャンクに収まらなければ、収まる分だけにする
+			uint32_t capacity = (size - static_cast<uint32_t>(sizeof(count))) / kCuePointSize;
+			count = (std::min)(count, capacity);
+			for (uint32_t i = 0; i < count; i++) {
+				uint32_t position;
+				if (!read(
+				      body + sizeof(count) + i * kCuePointSize + kCuePointOffset, &position,
+				      sizeof(position))) {
+					return false;
+				}
+				cuePoints.push_back(position);
+			}
+		}
+
+		// 次のチャンク（チャンクは2バイト境界に揃えて並ぶ）
+		offset = body + chunk.size + (chunk.size & 1);
+	}
+
+	if (!hasFormat || !hasData || info.format.channels == 0 || info.format.blockAlign == 0) {
+		return false;
+	}
+	info.dataSize -= info.dataSize % info.format.blockAlign;
+	info.frameCount = GetFrameCount(info.format, info.dataSize);
+	if (factFrameCount > 0) {
+		info.frameCount = (std::min)(info.frameCount, factFrameCount);
+	}
+
+	// ループ範囲
+	if (hasSampleLoop) {
+		info.loopStart = sampleLoop.start;
+		info.loopEnd = sampleLoop.end + 1;
+		// 終了フレームが最大値だと足して0になるので、範囲外として捨てる
+		info.hasLoop = sampleLoop.end != UINT32_MAX;
+	} else if (!cuePoints.empty()) {
+		std::sort(cuePoints.begin(), cuePoints.end());
+		info.loopStart = cuePoints[0];
+		info.loopEnd = cuePoints.size() > 1 ? cuePoints[1] : info.frameCount;
+		info.hasLoop = true;
+	}
+	// 波形の外や空の範囲は無視する
+	if (info.hasLoop && (info.loopStart >= info.loopEnd || info.loopEnd > info.frameCount)) {
+		info.hasLoop = false;
+	}
+	if (!info.hasLoop) {
+		info.loopStart = 0;
+		info.loopEnd = 0;
+	}
+	return true;
+}
+
+bool WaveParser::Parse(const uint8_t* data, size_t size, WaveInfo& info) {
+	auto read = [data, size](uint64_t offset, void* destination, size_t bytes) {
+		if (offset > size || bytes > size - offset) {
+			return false;
+		}
+		memcpy(destination, data + offset, bytes);
+		return true;
+	};
+	return Parse(read, size, info);
+}
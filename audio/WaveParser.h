@@ -0,0 +1,66 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+
+/// <summary>
+/// 波形フォーマット（WAVEFORMATEXのcbSize以外と同じ並び）
+/// </summary>
+struct WaveFormat {
+	uint16_t formatTag;      // 形式（1:PCM 3:float 0x11:IMA-ADPCM）
+	uint16_t channels;       // チャンネル数
+	uint32_t samplesPerSec;  // サンプリング周波数
+	uint32_t avgBytesPerSec; // 1秒あたりのバイト数
+	uint16_t blockAlign;     // 1サンプル（全チャンネル分）のバイト数
+	uint16_t bitsPerSample;  // 1チャンネル1サンプルのビット数
+
+	bool operator==(const WaveFormat&) const = default;
+};
+
+/// <summary>
+/// WAVファイルを調べた結果
+/// </summary>
+struct WaveInfo {
+	WaveFormat format = {};
+	// 波形データのファイル内位置
+	uint64_t dataOffset = 0;
+	// 波形データのバイト数（ファイルの終わりとブロック境界で切り捨てたもの）
+	uint32_t dataSize = 0;
+	// フレーム数（factチャンクがあればその値で切り詰める）
+	uint32_t frameCount = 0;
+	// ループ範囲があるか
+	bool hasLoop = false;
+	// ループ範囲（フレーム単位。endは含まない）
+	uint32_t loopStart = 0;
+	uint32_t loopEnd = 0;
+
+	// パディングを含めずにメンバごとに比べる
+	bool operator==(const WaveInfo&) const = default;
+};
+
+/// <summary>
+/// WAVファイル（RIFF）のチャンクを順に調べる
+/// チャンクの順番は問わず、知らないチャンクは読み飛ばす。
+/// ループ範囲はsmplチャンクの最初のループ、無ければcueチャンクの最初の2点（1点なら末尾まで）から得る
+/// </summary>
+class WaveParser {
+public: // サブクラス
+	// ファイル内位置からバイト列を読む関数（読めなければfalse）
+	using ReadFunction = std::function<bool(uint64_t offset, void* destination, size_t size)>;
+
+public: // 静的メンバ関数
+	/// <summary>
+	/// 調べる
+	/// </summary>
+	/// <param name="read">読み込み関数</param>
+	/// <param name="fileSize">ファイルのバイト数</param>
+	/// <param name="info">結果の書き込み先</param>
+	/// <returns>fmtチャンクとdataチャンクがある、再生できるWAVか</returns>
+	static bool Parse(const ReadFunction& read, uint64_t fileSize, WaveInfo& info);
+
+	/// <summary>
+	/// メモリ上のファイルを調べる
+	/// </summary>
+	static bool Parse(const uint8_t* data, size_t size, WaveInfo& info);
+};
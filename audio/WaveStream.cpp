@@ -0,0 +1,129 @@
+﻿#include "WaveStream.h"
+#include "ImaAdpcm.h"
+#include <algorithm>
+#include <cassert>
+#include <cstring>
+
+bool WaveStreamReader::Open(const std::string& filePath) {
+	Close();
+	file_.open(filePath, std::ios_base::binary);
+	if (!file_.is_open()) {
+		return false;
+	}
+
+	// チャンクを調べる（波形データは読まない）
+	file_.seekg(0, std::ios_base::end);
+	uint64_t fileSize = static_cast<uint64_t>(file_.tellg());
+	auto read = [this](uint64_t offset, void* destination, size_t size) {
+		file_.clear();
+		file_.seekg(static_cast<std::streamoff>(offset), std::ios_base::beg);
+		file_.read(reinterpret_cast<char*>(destination), size);
+		return static_cast<size_t>(file_.gcount()) == size;
+	};
+	WaveInfo info;
+	if (!WaveParser::Parse(read, fileSize, info)) {
+		Close();
+		return false;
+	}
+	format_ = info.format;
+	dataOffset_ = static_cast<std::streamoff>(info.dataOffset);
+	dataSize_ = info.dataSize;
+	// ループ範囲はフレームとバイト位置が比例するPCMだけで使う
+	if (info.hasLoop && format_.formatTag != ImaAdpcm::kFormatTag) {
+		loopStart_ = info.loopStart * format_.blockAlign;
+		loopEnd_ = info.loopEnd * format_.blockAlign;
+	}
+	Rewind();
+	return true;
+}
+
+void WaveStreamReader::OpenMemory(const WaveFormat& format, const uint8_t* data, uint32_t size) {
+	Close();
+	assert(format.blockAlign > 0);
+	memory_ = data;
+	format_ = format;
+	dataSize_ = size - size % format_.blockAlign;
+}
+
+void WaveStreamReader::Close() {
+	if (file_.is_open()) {
+		file_.close();
+	}
+	file_.clear();
+	memory_ = nullptr;
+	format_ = {};
+	dataOffset_ = 0;
+	dataSize_ = 0;
+	position_ = 0;
+	loopStart_ = 0;
+	loopEnd_ = 0;
+}
+
+size_t WaveStreamReader::Read(uint8_t* destination, size_t bytes, bool loop) {
+	assert(memory_ || file_.is_open());
+	bytes -= bytes % format_.blockAlign;
+
+	// ループ時はループ範囲の終わり（範囲が無ければ末尾）で始めに戻る
+	bool hasLoop = loopEnd_ > loopStart_;
+	uint32_t end = loop && hasLoop ? loopEnd_ : dataSize_;
+	uint32_t restart = loop && hasLoop ? loopStart_ : 0;
+
+	size_t total = 0;
+	while (total < bytes) {
+		if (position_ >= end) {
+			// 空のデータでループすると終わらないので、その場合も抜ける
+			if (!loop || end == restart) {
+				break;
+			}
+			Seek(restart);
+		}
+		// 終わりを超えない分だけ続けて読む
+		size_t count = (std::min)(bytes - total, static_cast<size_t>(end - position_));
+		if (memory_) {
+			memcpy(destination + total, memory_ + position_, count);
+		} else {
+			file_.read(reinterpret_cast<char*>(destination + total), count);
+			assert(static_cast<size_t>(file_.gcount()) == count);
+		}
+		position_ += static_cast<uint32_t>(count);
+		total += count;
+	}
+	return total;
+}
+
+void WaveStreamReader::Rewind() { Seek(0); }
+
+void WaveStreamReader::Seek(uint32_t position) {
+	position_ = position;
+	if (memory_) {
+		return;
+	}
+	file_.clear();
+	file_.seekg(dataOffset_ + position, std::ios_base::beg);
+}
+
+void StreamBufferRing::Reset() {
+	submitCount_.store(0, std::memory_order_relaxed);
+	releaseCount_.store(0, std::memory_order_relaxed);
+}
+
+uint32_t StreamBufferRing::GetFillIndex() const {
+	return static_cast<uint32_t>(submitCount_.load(std::memory_order_relaxed) % kBufferCount);
+}
+
+void StreamBufferRing::Submit() {
+	assert(HasFreeBuffer());
+	submitCount_.fetch_add(1, std::memory_order_release);
+}
+
+void StreamBufferRing::Release() {
+	assert(GetQueuedCount() > 0);
+	releaseCount_.fetch_add(1, std::memory_order_release);
+}
+
+uint32_t StreamBufferRing::GetQueuedCount() const {
+	// 返ってきた数を先に読めば、渡した数より大きくならない
+	uint64_t releaseCount = releaseCount_.load(std::memory_order_acquire);
+	uint64_t submitCount = submitCount_.load(std::memory_order_acquire);
+	return static_cast<uint32_t>(submitCount - releaseCount);
+}
@@ -0,0 +1,130 @@
+#pragma once
+
+#include "WaveParser.h"
+#include <atomic>
+#include <cstdint>
+#include <fstream>
+#include <string>
+
+/// <summary>
+/// WAVファイルの波形データを少しずつ読み込む
+/// </summary>
+class WaveStreamReader {
+public: // メンバ関数
+	/// <summary>
+	/// ファイルを開き、fmtチャンクとdataチャンクの位置とループ範囲を調べる
+	/// </summary>
+	/// <param name="filePath">WAVファイルのパス</param>
+	/// <returns>WAVとして読めたか</returns>
+	bool Open(const std::string& filePath);
+
+	/// <summary>
+	/// メモリ上の波形データを開く（ファイルの代わりにここから読む）
+	/// </summary>
+	/// <param name="format">波形フォーマット</param>
+	/// <param name="data">波形データ（閉じるまで呼び出し側が保持する）</param>
+	/// <param name="size">波形データのバイト数</param>
+	void OpenMemory(const WaveFormat& format, const uint8_t* data, uint32_t size);
+
+	/// <summary>
+	/// ファイルを閉じる
+	/// </summary>
+	void Close();
+
+	/// <summary>
+	/// 波形データを読み込む
+	/// </summary>
+	/// <param name="destination">書き込み先</param>
+	/// <param name="bytes">最大バイト数（ブロック境界に切り捨てる）</param>
+	/// <param name="loop">末尾に達したら先頭に戻って続けるか
+	/// ループ範囲があるPCMは、範囲の終わりに達したら範囲の始めに戻る</param>
+	/// <returns>読み込んだバイト数。ループしない場合、末尾では0</returns>
+	size_t Read(uint8_t* destination, size_t bytes, bool loop);
+
+	/// <summary>
+	/// 読み込み位置を波形データの先頭に戻す
+	/// </summary>
+	void Rewind();
+
+	/// <summary>
+	/// 波形データの末尾まで読んだか
+	/// </summary>
+	bool IsEnd() const { return position_ == dataSize_; }
+
+	/// <summary>
+	/// 波形フォーマットの取得
+	/// </summary>
+	const WaveFormat& GetFormat() const { return format_; }
+
+	/// <summary>
+	/// 波形データのバイト数の取得
+	/// </summary>
+	uint32_t GetDataSize() const { return dataSize_; }
+
+private: // メンバ変数
+	std::ifstream file_;
+	// メモリから読む場合の波形データ（ファイルから読む場合はnullptr）
+	const uint8_t* memory_ = nullptr;
+	WaveFormat format_ = {};
+	// 波形データの先頭のファイル内位置
+	std::streamoff dataOffset_ = 0;
+	// 波形データのバイト数（ブロック境界に切り捨てたもの）
+	uint32_t dataSize_ = 0;
+	// 次に読む波形データ内の位置
+	uint32_t position_ = 0;
+	// ループ範囲（波形データ内のバイト位置）
+	uint32_t loopStart_ = 0;
+	uint32_t loopEnd_ = 0;
+
+private: // メンバ関数
+	// 読み込み位置を波形データ内の位置に移す
+	void Seek(uint32_t position);
+};
+
+/// <summary>
+/// ストリーミング再生用のバッファのリング
+/// 読み込み側が埋めて再生側に渡し、再生側が使い終わったら返す。
+/// 読み込み側と再生側がそれぞれ1スレッドならロック不要
+/// </summary>
+class StreamBufferRing {
+public: // 定数
+	// バッファ数
+	static const uint32_t kBufferCount = 3;
+
+public: // メンバ関数
+	/// <summary>
+	/// 全バッファを空きに戻す（再生側が止まっている時に呼ぶ）
+	/// </summary>
+	void Reset();
+
+	/// <summary>
+	/// 埋められる空きバッファがあるか（読み込み側）
+	/// </summary>
+	bool HasFreeBuffer() const { return GetQueuedCount() < kBufferCount; }
+
+	/// <summary>
+	/// 次に埋めるバッファの番号（読み込み側）
+	/// </summary>
+	uint32_t GetFillIndex() const;
+
+	/// <summary>
+	/// 埋めたバッファを再生側に渡したことを記録する（読み込み側）
+	/// </summary>
+	void Submit();
+
+	/// <summary>
+	/// 再生し終わったバッファを返す（再生側）
+	/// </summary>
+	void Release();
+
+	/// <summary>
+	/// 再生側に渡していて、まだ返ってきていないバッファ数
+	/// </summary>
+	uint32_t GetQueuedCount() const;
+
+private: // メンバ変数
+	// 渡した数
+	std::atomic<uint64_t> submitCount_{0};
+	// 返ってきた数
+	std::atomic<uint64_t> releaseCount_{0};
+};
@@ -1,4 +1,5 @@
 #include "DirectXCommon.h"
+#include "Profiler.h"
 #include "SafeDelete.h"
 #include <algorithm>
 #include <cassert>
@@ -61,6 +62,19 @@ void DirectXCommon::PreDraw() {
 	    D3D12_RESOURCE_STATE_RENDER_TARGET);
 	commandList_->ResourceBarrier(1, &barrier);
 
+	// レンダーターゲットをセット
+	SetRenderTarget();
+
+	// 全画面クリア
+	ClearRenderTarget();
+	// 深度バッファクリア
+	ClearDepthBuffer();
+}
+
+void DirectXCommon::SetRenderTarget() {
+	// バックバッファの番号を取得（2つなので0番か1番）
+	UINT bbIndex = swapChain_->GetCurrentBackBufferIndex();
+
 	// レンダーターゲットビュー用ディスクリプタヒープのハンドルを取得
 	CD3DX12_CPU_DESCRIPTOR_HANDLE rtvH = CD3DX12_CPU_DESCRIPTOR_HANDLE(
 	    rtvHeap_->GetCPUDescriptorHandleForHeapStart(), bbIndex,
@@ -71,11 +85,6 @@ void DirectXCommon::PreDraw() {
 	// レンダーターゲットをセット
 	commandList_->OMSetRenderTargets(1, &rtvH, false, &dsvH);
 
-	// 全画面クリア
-	ClearRenderTarget();
-	// 深度バッファクリア
-	ClearDepthBuffer();
-
 	// ビューポートの設定
 	CD3DX12_VIEWPORT viewport =
 	    CD3DX12_VIEWPORT(0.0f, 0.0f, float(backBufferWidth_), float(backBufferHeight_));
@@ -122,6 +131,7 @@ void DirectXCommon::PostDraw() {
 	// コマンドリストの実行完了を待つ
 	commandQueue_->Signal(fence_.Get(), ++fenceVal_);
 	if (fence_->GetCompletedValue() != fenceVal_) {
+		Profiler::Scope scope("DirectXCommon::WaitForGpu");
 		HANDLE event = CreateEvent(nullptr, false, false, nullptr);
 		fence_->SetEventOnCompletion(fenceVal_, event);
 		WaitForSingleObject(event, INFINITE);
@@ -142,7 +152,8 @@ void DirectXCommon::PostDraw() {
 	// 実際にwaitするのは60基準
 	static const std::chrono::microseconds kMinTime(uint64_t(1000000.0f / 60.0f));
 	std::chrono::microseconds check = kMinCheckTime - elapsed;
-	if (std::chrono::microseconds(0) < check) {
+	if (frameLimitEnabled_ && std::chrono::microseconds(0) < check) {
+		Profiler::Scope scope("DirectXCommon::FrameLimit");
 		std::chrono::microseconds waitTime = kMinTime - elapsed;
 
 		// sleepは信用ならないので1uでポーリング
@@ -155,6 +166,7 @@ void DirectXCommon::PostDraw() {
 	elapsed = std::chrono::duration_cast<std::chrono::microseconds>(
 	    std::chrono::steady_clock::now() - reference_);
 	reference_ = std::chrono::steady_clock::now();
+	frameTime_ = static_cast<float>(elapsed.count()) / 1000000.0f;
 
 	commandAllocator_->Reset();
 	commandList_->Reset(commandAllocator_.Get(), nullptr);
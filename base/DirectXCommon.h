@@ -38,6 +38,12 @@ public: // メンバ関数
 	/// </summary>
 	void PostDraw();
 
+	/// <summary>
+	/// バックバッファと深度バッファを描画対象に戻し、ビューポートを画面全体にする
+	/// シャドウマップなど別の描画対象に描いた後に呼ぶ
+	/// </summary>
+	void SetRenderTarget();
+
 	/// <summary>
 	/// レンダーターゲットのクリア
 	/// </summary>
@@ -60,6 +66,38 @@ public: // メンバ関数
 	/// <returns>描画コマンドリスト</returns>
 	ID3D12GraphicsCommandList* GetCommandList() const { return commandList_.Get(); }
 
+	/// <summary>
+	/// コマンドキューの取得
+	/// </summary>
+	/// <returns>コマンドキュー</returns>
+	ID3D12CommandQueue* GetCommandQueue() const { return commandQueue_.Get(); }
+
+	/// <summary>
+	/// 前のフレームにかかった時間の取得（fps固定の待ちを含む）
+	/// </summary>
+	/// <returns>秒</returns>
+	float GetFrameTime() const { return frameTime_; }
+
+	/// <summary>
+	/// 固定時間刻みの設定
+	/// 有効ならGetDeltaTimeは常にこの値を返す（入力の記録と再生で、
+	/// 実際にかかった時間によらず毎回同じ結果にするのに使う）
+	/// </summary>
+	/// <param name="deltaTime">1フレームの秒数（0で無効）</param>
+	void SetFixedDeltaTime(float deltaTime) { fixedDeltaTime_ = deltaTime; }
+
+	/// <summary>
+	/// 60fps固定の待ちをするかの設定（記録した入力の再生では待たずに進める）
+	/// </summary>
+	/// <param name="enabled">待つか</param>
+	void SetFrameLimitEnabled(bool enabled) { frameLimitEnabled_ = enabled; }
+
+	/// <summary>
+	/// ゲームの更新に使う1フレームの時間の取得
+	/// </summary>
+	/// <returns>秒（固定時間刻みならその値、それ以外はGetFrameTimeと同じ）</returns>
+	float GetDeltaTime() const { return fixedDeltaTime_ > 0.0f ? fixedDeltaTime_ : frameTime_; }
+
 	/// <summary>
 	/// バックバッファの幅取得
 	/// </summary>
@@ -75,6 +113,12 @@ public: // メンバ関数
 	// バックバッファの数を取得
 	size_t GetBackBufferCount() const { return backBuffers_.size(); }
 
+	/// <summary>
+	/// 描画を終えたフレームの数の取得（PostDrawでGPUを待つ毎に1増える）
+	/// </summary>
+	/// <returns>フレーム数</returns>
+	uint64_t GetFrameCount() const { return fenceVal_; }
+
 private: // メンバ変数
 	// ウィンドウズアプリケーション管理
 	WinApp* winApp_;
@@ -97,6 +141,9 @@ private: // メンバ変数
 	HANDLE frameLatencyWaitableObject_;
 	std::chrono::steady_clock::time_point reference_;
 	int32_t refreshRate_ = 0;
+	float frameTime_ = 0.0f;
+	float fixedDeltaTime_ = 0.0f;
+	bool frameLimitEnabled_ = true;
 
 private: // メンバ関数
 	DirectXCommon() = default;
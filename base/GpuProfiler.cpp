@@ -0,0 +1,163 @@
+﻿#include "GpuProfiler.h"
+#include "Profiler.h"
+#include <Windows.h>
+#include <cassert>
+#include <d3dx12.h>
+
+namespace {
+
+// 全枠のクエリ数
+const uint32_t kQueryCount = GpuProfiler::kMaxScopeCount * 2 * GpuProfiler::kFrameCount;
+
+// カウンタの値をナノ秒にする（桁あふれしないよう整数部と端数に分ける）
+uint64_t ToNanoseconds(uint64_t ticks, uint64_t frequency) {
+	const uint64_t kNanosecondsPerSecond = 1000000000;
+	return ticks / frequency * kNanosecondsPerSecond +
+	       ticks % frequency * kNanosecondsPerSecond / frequency;
+}
+
+} // namespace
+
+GpuProfiler::Scope::Scope(ID3D12GraphicsCommandList* commandList, const char* name)
+    : commandList_(commandList) {
+	index_ = GpuProfiler::GetInstance()->BeginScope(commandList_, name);
+}
+
+GpuProfiler::Scope::~Scope() { GpuProfiler::GetInstance()->EndScope(commandList_, index_); }
+
+GpuProfiler* GpuProfiler::GetInstance() {
+	static GpuProfiler instance;
+	return &instance;
+}
+
+void GpuProfiler::Initialize(ID3D12Device* device, ID3D12CommandQueue* commandQueue) {
+	assert(device);
+	assert(commandQueue);
+	HRESULT result;
+
+	commandQueue_ = commandQueue;
+
+	// タイムスタンプのクエリヒープ（区間毎に開始と終了の2つ）
+	D3D12_QUERY_HEAP_DESC queryHeapDesc{};
+	queryHeapDesc.Type = D3D12_QUERY_HEAP_TYPE_TIMESTAMP;
+	queryHeapDesc.Count = kQueryCount;
+	result = device->CreateQueryHeap(&queryHeapDesc, IID_PPV_ARGS(&queryHeap_));
+	assert(SUCCEEDED(result));
+
+	// 読み戻し用バッファ
+	CD3DX12_HEAP_PROPERTIES heapProps = CD3DX12_HEAP_PROPERTIES(D3D12_HEAP_TYPE_READBACK);
+	CD3DX12_RESOURCE_DESC resourceDesc =
+	    CD3DX12_RESOURCE_DESC::Buffer(sizeof(uint64_t) * kQueryCount);
+	result = device->CreateCommittedResource(
+	    &heapProps, D3D12_HEAP_FLAG_NONE, &resourceDesc, D3D12_RESOURCE_STATE_COPY_DEST, nullptr,
+	    IID_PPV_ARGS(&readbackBuff_));
+	assert(SUCCEEDED(result));
+
+	// 周波数
+	result = commandQueue_->GetTimestampFrequency(&gpuFrequency_);
+	assert(SUCCEEDED(result));
+	LARGE_INTEGER frequency;
+	QueryPerformanceFrequency(&frequency);
+	cpuFrequency_ = static_cast<uint64_t>(frequency.QuadPart);
+
+	initialized_ = true;
+}
+
+void GpuProfiler::BeginFrame() {
+	if (!initialized_) {
+		return;
+	}
+
+	// 枠を1つ進める。kFrameCountフレーム前の結果なので、GPUは書き終えている
+	currentSlot_ = (currentSlot_ + 1) % kFrameCount;
+	FrameSlot& slot = slots_[currentSlot_];
+	if (slot.pending) {
+		ReadBack(slot, currentSlot_);
+	}
+	slot.scopeCount = 0;
+	slot.frameIndex = Profiler::GetInstance()->GetFrameIndex();
+	slot.pending = false;
+	depth_ = 0;
+}
+
+void GpuProfiler::EndFrame(ID3D12GraphicsCommandList* commandList) {
+	if (!initialized_) {
+		return;
+	}
+	assert(depth_ == 0);
+
+	FrameSlot& slot = slots_[currentSlot_];
+	if (slot.scopeCount == 0) {
+		return;
+	}
+	// 書き込んだ分だけ読み戻し用バッファに移す
+	uint32_t first = currentSlot_ * kMaxScopeCount * 2;
+	commandList->ResolveQueryData(
+	    queryHeap_.Get(), D3D12_QUERY_TYPE_TIMESTAMP, first, slot.scopeCount * 2,
+	    readbackBuff_.Get(), sizeof(uint64_t) * first);
+	slot.pending = true;
+}
+
+uint32_t GpuProfiler::BeginScope(ID3D12GraphicsCommandList* commandList, const char* name) {
+	if (!initialized_) {
+		return UINT32_MAX;
+	}
+	FrameSlot& slot = slots_[currentSlot_];
+	if (slot.scopeCount == kMaxScopeCount) {
+		return UINT32_MAX;
+	}
+
+	uint32_t index = slot.scopeCount++;
+	slot.scopes[index] = {name, depth_++};
+	commandList->EndQuery(
+	    queryHeap_.Get(), D3D12_QUERY_TYPE_TIMESTAMP, (currentSlot_ * kMaxScopeCount + index) * 2);
+	return index;
+}
+
+void GpuProfiler::EndScope(ID3D12GraphicsCommandList* commandList, uint32_t index) {
+	if (index == UINT32_MAX) {
+		return;
+	}
+	depth_--;
+	commandList->EndQuery(
+	    queryHeap_.Get(), D3D12_QUERY_TYPE_TIMESTAMP,
+	    (currentSlot_ * kMaxScopeCount + index) * 2 + 1);
+}
+
+void GpuProfiler::ReadBack(FrameSlot& slot, uint32_t slotIndex) {
+	// この枠の範囲だけをマップする
+	uint32_t first = slotIndex * kMaxScopeCount * 2;
+	D3D12_RANGE readRange{
+	    sizeof(uint64_t) * first, sizeof(uint64_t) * (first + slot.scopeCount * 2)};
+	uint64_t* timestamps = nullptr;
+	HRESULT result = readbackBuff_->Map(0, &readRange, reinterpret_cast<void**>(&timestamps));
+	assert(SUCCEEDED(result));
+	timestamps += first;
+
+	// GPUとCPUの同じ瞬間の時刻から、タイムスタンプをCPUの時刻基準に直す
+	uint64_t gpuReference = 0;
+	uint64_t cpuReference = 0;
+	result = commandQueue_->GetClockCalibration(&gpuReference, &cpuReference);
+	assert(SUCCEEDED(result));
+	uint64_t cpuReferenceTime = ToNanoseconds(cpuReference, cpuFrequency_);
+	auto toCpuTime = [&](uint64_t timestamp) {
+		return timestamp >= gpuReference
+		           ? cpuReferenceTime + ToNanoseconds(timestamp - gpuReference, gpuFrequency_)
+		           : cpuReferenceTime - ToNanoseconds(gpuReference - timestamp, gpuFrequency_);
+	};
+
+	std::array<Profiler::Event, kMaxScopeCount> events;
+	for (uint32_t i = 0; i < slot.scopeCount; i++) {
+		events[i].name = slot.scopes[i].name;
+		events[i].begin = toCpuTime(timestamps[i * 2]);
+		events[i].end = toCpuTime(timestamps[i * 2 + 1]);
+		events[i].threadIndex = Profiler::kGpuThreadIndex;
+		events[i].depth = slot.scopes[i].depth;
+	}
+
+	// 書き込んでいないことを伝える
+	D3D12_RANGE writtenRange{0, 0};
+	readbackBuff_->Unmap(0, &writtenRange);
+
+	Profiler::GetInstance()->AddGpuEvents(slot.frameIndex, events.data(), slot.scopeCount);
+}
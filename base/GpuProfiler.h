@@ -0,0 +1,114 @@
+#pragma once
+
+#include <array>
+#include <cstdint>
+#include <d3d12.h>
+#include <wrl.h>
+
+/// <summary>
+/// タイムスタンプクエリによるGPUの区間計測
+/// 結果はフレームの数だけ遅れて読み戻し、CPUと同じ時刻基準に直してProfilerに渡す
+/// </summary>
+class GpuProfiler {
+public: // 定数
+	// 1フレームで計測できる区間の最大数
+	static const uint32_t kMaxScopeCount = 256;
+	// 読み戻しを待つフレーム数（描画中のフレーム数以上にする）
+	static const uint32_t kFrameCount = 3;
+
+public: // サブクラス
+	/// <summary>
+	/// 生存期間中にコマンドリストに積んだ命令のGPU時間を計測する区間
+	/// </summary>
+	class Scope {
+	public:
+		Scope(ID3D12GraphicsCommandList* commandList, const char* name);
+		~Scope();
+		Scope(const Scope&) = delete;
+		Scope& operator=(const Scope&) = delete;
+
+	private:
+		ID3D12GraphicsCommandList* commandList_;
+		uint32_t index_;
+	};
+
+public: // 静的メンバ関数
+	/// <summary>
+	/// シングルトンインスタンスの取得
+	/// </summary>
+	/// <returns>シングルトンインスタンス</returns>
+	static GpuProfiler* GetInstance();
+
+public: // メンバ関数
+	/// <summary>
+	/// 初期化
+	/// </summary>
+	/// <param name="device">デバイス</param>
+	/// <param name="commandQueue">計測するコマンドリストを実行するキュー</param>
+	void Initialize(ID3D12Device* device, ID3D12CommandQueue* commandQueue);
+
+	/// <summary>
+	/// フレームの開始。同じ枠を使っていたフレームの結果を読み戻してProfilerに渡す
+	/// </summary>
+	void BeginFrame();
+
+	/// <summary>
+	/// フレームの終了。計測結果を読み戻し用バッファに書き出す命令を積む（Close前に呼ぶ）
+	/// </summary>
+	/// <param name="commandList">コマンドリスト</param>
+	void EndFrame(ID3D12GraphicsCommandList* commandList);
+
+	/// <summary>
+	/// 区間の開始
+	/// </summary>
+	/// <returns>区間の番号（上限を超えた場合はUINT32_MAX）</returns>
+	uint32_t BeginScope(ID3D12GraphicsCommandList* commandList, const char* name);
+
+	/// <summary>
+	/// 区間の終了
+	/// </summary>
+	/// <param name="index">BeginScopeが返した番号</param>
+	void EndScope(ID3D12GraphicsCommandList* commandList, uint32_t index);
+
+private: // サブクラス
+	// 計測中の区間
+	struct ScopeRecord {
+		const char* name;
+		uint32_t depth;
+	};
+
+	// フレーム1つ分の計測枠
+	struct FrameSlot {
+		std::array<ScopeRecord, kMaxScopeCount> scopes;
+		uint32_t scopeCount = 0;
+		uint64_t frameIndex = 0;
+		// 結果の読み戻し待ちか
+		bool pending = false;
+	};
+
+private:
+	GpuProfiler() = default;
+	~GpuProfiler() = default;
+	GpuProfiler(const GpuProfiler&) = delete;
+	GpuProfiler& operator=(const GpuProfiler&) = delete;
+
+	// 枠の結果を読み戻してProfilerに渡す
+	void ReadBack(FrameSlot& slot, uint32_t slotIndex);
+
+private: // メンバ変数
+	Microsoft::WRL::ComPtr<ID3D12QueryHeap> queryHeap_;
+	Microsoft::WRL::ComPtr<ID3D12Resource> readbackBuff_;
+	// 時刻の基準を合わせるためのキュー
+	ID3D12CommandQueue* commandQueue_ = nullptr;
+	// GPUのタイムスタンプの周波数
+	uint64_t gpuFrequency_ = 0;
+	// CPUのパフォーマンスカウンタの周波数
+	uint64_t cpuFrequency_ = 0;
+	// 計測枠
+	std::array<FrameSlot, kFrameCount> slots_;
+	uint32_t currentSlot_ = 0;
+	// 現在の入れ子の深さ
+	uint32_t depth_ = 0;
+	// 初期化済みか
+	bool initialized_ = false;
+};
@@ -0,0 +1,323 @@
+﻿#include "JobSystem.h"
+#include "Profiler.h"
+#include <algorithm>
+#include <cassert>
+
+// 1にすると全てのジョブの実行をProfilerの区間として記録する（/DJOB_SYSTEM_PROFILE_JOBS=1）
+// 記録の分だけ細かいジョブが遅くなるので、普段は記録しない
+#ifndef JOB_SYSTEM_PROFILE_JOBS
+#define JOB_SYSTEM_PROFILE_JOBS 0
+#endif
+
+namespace {
+
+// 現在のスレッド番号
+thread_local uint32_t tThreadIndex = JobSystem::kInvalidThreadIndex;
+
+// 眠る前に空回りする回数
+const uint32_t kSpinCountBeforeSleep = 64;
+
+uint32_t XorShift(uint32_t& state) {
+	state ^= state << 13;
+	state ^= state >> 17;
+	state ^= state << 5;
+	return state;
+}
+
+} // namespace
+
+void JobSystem::WorkStealingQueue::Store(int64_t index, const Job& job) {
+	Slot& slot = jobs_[index & (kJobCountPerThread - 1)];
+	slot.function.store(job.function, std::memory_order_relaxed);
+	slot.context.store(job.context, std::memory_order_relaxed);
+	slot.begin.store(job.begin, std::memory_order_relaxed);
+	slot.end.store(job.end, std::memory_order_relaxed);
+	slot.counter.store(job.counter, std::memory_order_relaxed);
+}
+
+void JobSystem::WorkStealingQueue::Load(int64_t index, Job& job) const {
+	const Slot& slot = jobs_[index & (kJobCountPerThread - 1)];
+	job.function = slot.function.load(std::memory_order_relaxed);
+	job.context = slot.context.load(std::memory_order_relaxed);
+	job.begin = slot.begin.load(std::memory_order_relaxed);
+	job.end = slot.end.load(std::memory_order_relaxed);
+	job.counter = slot.counter.load(std::memory_order_relaxed);
+}
+
+bool JobSystem::WorkStealingQueue::Push(const Job& job) {
+	int64_t bottom = bottom_.load(std::memory_order_relaxed);
+	int64_t top = top_.load(std::memory_order_acquire);
+	// 満杯（盗む側が写し終えるまで先頭は進まないので、写している途中の場所は上書きしない）
+	if (bottom - top >= static_cast<int64_t>(kJobCountPerThread)) {
+		return false;
+	}
+	Store(bottom, job);
+	std::atomic_thread_fence(std::memory_order_release);
+	bottom_.store(bottom + 1, std::memory_order_relaxed);
+	return true;
+}
+
+bool JobSystem::WorkStealingQueue::Pop(Job& job) {
+	int64_t bottom = bottom_.load(std::memory_order_relaxed) - 1;
+	bottom_.store(bottom, std::memory_order_relaxed);
+	std::atomic_thread_fence(std::memory_order_seq_cst);
+	int64_t top = top_.load(std::memory_order_relaxed);
+
+	// 空
+	if (bottom < top) {
+		bottom_.store(bottom + 1, std::memory_order_relaxed);
+		return false;
+	}
+
+	Load(bottom, job);
+	// 最後の1個は盗む側と競合するのでCASで取り合う
+	bool taken = true;
+	if (bottom == top) {
+		// CASに失敗するとtopは盗まれた後の値で上書きされるので、末尾は元の位置から戻す
+		taken = top_.compare_exchange_strong(
+		  top, top + 1, std::memory_order_seq_cst, std::memory_order_relaxed);
+		bottom_.store(bottom + 1, std::memory_order_relaxed);
+	}
+	return taken;
+}
+
+bool JobSystem::WorkStealingQueue::Steal(Job& job) {
+	int64_t top = top_.load(std::memory_order_acquire);
+	std::atomic_thread_fence(std::memory_order_seq_cst);
+	int64_t bottom = bottom_.load(std::memory_order_acquire);
+
+	// 空
+	if (bottom <= top) {
+		return false;
+	}
+
+	// 先頭を進める前に写す（進めた後は所有スレッドが上書きしうる）
+	Load(top, job);
+	// 他スレッドに先を越されたら、写したものは捨てる
+	return top_.compare_exchange_strong(
+	  top, top + 1, std::memory_order_seq_cst, std::memory_order_relaxed);
+}
+
+JobSystem* JobSystem::GetInstance() {
+	static JobSystem instance;
+	return &instance;
+}
+
+uint32_t JobSystem::GetCurrentThreadIndex() { return tThreadIndex; }
+
+void JobSystem::Initialize(uint32_t workerCount) {
+	assert(threadContexts_.empty());
+
+	if (workerCount == 0) {
+		uint32_t hardwareCount = std::thread::hardware_concurrency();
+		workerCount = hardwareCount > 1 ? hardwareCount - 1 : 1;
+	}
+	workerCount = (std::min)(workerCount, kMaxWorkerCount);
+
+	quit_ = false;
+	pendingJobCount_ = 0;
+	sleepingWorkerCount_ = 0;
+
+	// メインスレッド＋ワーカー分のデータを確保
+	threadContexts_.resize(workerCount + 1);
+	for (uint32_t i = 0; i < threadContexts_.size(); i++) {
+		threadContexts_[i] = std::make_unique<ThreadContext>();
+		threadContexts_[i]->randomState = 0x9E3779B9u * (i + 1);
+	}
+
+	// 呼び出したスレッドをメインスレッドとする
+	tThreadIndex = 0;
+
+	// ワーカースレッド起動
+	workers_.reserve(workerCount);
+	for (uint32_t i = 1; i <= workerCount; i++) {
+		workers_.emplace_back(&JobSystem::WorkerMain, this, i);
+	}
+}
+
+void JobSystem::Finalize() {
+	{
+		std::lock_guard<std::mutex> lock(sleepMutex_);
+		quit_ = true;
+	}
+	sleepCondition_.notify_all();
+
+	for (auto& worker : workers_) {
+		worker.join();
+	}
+	workers_.clear();
+	threadContexts_.clear();
+	mainThreadJobs_.clear();
+	tThreadIndex = kInvalidThreadIndex;
+}
+
+void JobSystem::Run(
+  JobFunction function, const void* context, Counter* counter, uint32_t begin, uint32_t end) {
+	assert(function);
+
+	if (counter) {
+		counter->value.fetch_add(1, std::memory_order_relaxed);
+	}
+
+	Job job{function, context, begin, end, counter};
+	uint32_t threadIndex = tThreadIndex;
+	// ジョブシステム外のスレッドからはその場で実行する
+	if (threadIndex == kInvalidThreadIndex || threadContexts_.empty()) {
+		Execute(job);
+		return;
+	}
+
+	// キューが溢れたらその場で実行する
+	if (!threadContexts_[threadIndex]->queue.Push(job)) {
+		Execute(job);
+		return;
+	}
+
+	pendingJobCount_.fetch_add(1);
+	WakeWorkers();
+}
+
+void JobSystem::Wait(const Counter& counter) {
+	uint32_t threadIndex = tThreadIndex;
+	Job job;
+	while (!counter.IsDone()) {
+		if (threadIndex != kInvalidThreadIndex && FindJob(threadIndex, job)) {
+			pendingJobCount_.fetch_sub(1);
+			Execute(job);
+		} else {
+			std::this_thread::yield();
+		}
+	}
+}
+
+void JobSystem::RunOnMainThread(std::function<void()> function) {
+	std::lock_guard<std::mutex> lock(mainThreadMutex_);
+	mainThreadJobs_.emplace_back(std::move(function));
+}
+
+void JobSystem::ExecuteMainThreadJobs() {
+	assert(tThreadIndex == 0);
+
+	// 実行中に追加されても良いように入れ替えてから実行する
+	{
+		std::lock_guard<std::mutex> lock(mainThreadMutex_);
+		executingMainThreadJobs_.swap(mainThreadJobs_);
+	}
+	for (auto& function : executingMainThreadJobs_) {
+		function();
+	}
+	executingMainThreadJobs_.clear();
+}
+
+JobSystem::Statistics JobSystem::GetStatistics() const {
+	Statistics statistics;
+	for (auto& thread : threadContexts_) {
+		statistics.executedCount += thread->executedCount.load(std::memory_order_relaxed);
+		statistics.stolenCount += thread->stolenCount.load(std::memory_order_relaxed);
+	}
+	return statistics;
+}
+
+void JobSystem::ExecuteRange(const void* context, uint32_t begin, uint32_t end) {
+	const RangeContext* range = static_cast<const RangeContext*>(context);
+	JobSystem* jobSystem = GetInstance();
+
+	// 粒度以下になるまで後半を他スレッドに回す
+	while (end - begin > range->grainSize) {
+		uint32_t middle = begin + (end - begin) / 2;
+		jobSystem->Run(&ExecuteRange, context, range->counter, middle, end);
+		end = middle;
+	}
+	range->function(range->context, begin, end);
+}
+
+void JobSystem::WorkerMain(uint32_t threadIndex) {
+	tThreadIndex = threadIndex;
+	Profiler::GetInstance()->SetThreadName("Worker " + std::to_string(threadIndex));
+
+	uint32_t spinCount = 0;
+	Job job;
+	while (!quit_.load(std::memory_order_relaxed)) {
+		if (FindJob(threadIndex, job)) {
+			pendingJobCount_.fetch_sub(1);
+			Execute(job);
+			spinCount = 0;
+			continue;
+		}
+
+		// しばらく空回りしてからスリープ
+		if (++spinCount < kSpinCountBeforeSleep) {
+			std::this_thread::yield();
+			continue;
+		}
+		spinCount = 0;
+
+		std::unique_lock<std::mutex> lock(sleepMutex_);
+		sleepingWorkerCount_.fetch_add(1);
+		sleepCondition_.wait(lock, [this] { return pendingJobCount_.load() > 0 || quit_.load(); });
+		sleepingWorkerCount_.fetch_sub(1);
+	}
+}
+
+bool JobSystem::FindJob(uint32_t threadIndex, Job& job) {
+	ThreadContext& thread = *threadContexts_[threadIndex];
+
+	// 自分のキューから取り出す
+	if (thread.queue.Pop(job)) {
+		return true;
+	}
+
+	// 他スレッドのキューから盗む（開始位置はランダム）
+	uint32_t threadCount = static_cast<uint32_t>(threadContexts_.size());
+	uint32_t start = XorShift(thread.randomState) % threadCount;
+	for (uint32_t i = 0; i < threadCount; i++) {
+		uint32_t victim = (start + i) % threadCount;
+		if (victim == threadIndex) {
+			continue;
+		}
+		if (threadContexts_[victim]->queue.Steal(job)) {
+			thread.stolenCount.fetch_add(1, std::memory_order_relaxed);
+			return true;
+		}
+	}
+	return false;
+}
+
+void JobSystem::Execute(const Job& job) {
+#if JOB_SYSTEM_PROFILE_JOBS
+	{
+		Profiler::Scope scope("Job");
+		job.function(job.context, job.begin, job.end);
+	}
+#else
+	job.function(job.context, job.begin, job.end);
+#endif
+
+	if (tThreadIndex != kInvalidThreadIndex && !threadContexts_.empty()) {
+		threadContexts_[tThreadIndex]->executedCount.fetch_add(1, std::memory_order_relaxed);
+	}
+	// 依存カウンタを減らす
+	if (job.counter) {
+		job.counter->value.fetch_sub(1, std::memory_order_release);
+	}
+}
+
+void JobSystem::WakeWorkers() {
+	if (sleepingWorkerCount_.load() == 0) {
+		return;
+	}
+	// 待機に入る直前のワーカーを取りこぼさないようロックを経由する
+	{ std::lock_guard<std::mutex> lock(sleepMutex_); }
+	sleepCondition_.notify_one();
+}
+
+void JobSystem::ParallelForInternal(RangeContext& range, uint32_t count) {
+	if (count == 0) {
+		return;
+	}
+
+	Counter counter;
+	range.counter = &counter;
+	Run(&ExecuteRange, &range, &counter, 0, count);
+	Wait(counter);
+}
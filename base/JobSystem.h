@@ -0,0 +1,255 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+/// <summary>
+/// ジョブシステム（ワークスティーリング）
+/// </summary>
+class JobSystem {
+public: // 定数
+	// ワーカースレッドの最大数
+	static constexpr uint32_t kMaxWorkerCount = 63;
+	// スレッド毎のジョブ数（2の累乗）
+	static const uint32_t kJobCountPerThread = 4096;
+	// スレッド番号が無効
+	static const uint32_t kInvalidThreadIndex = UINT32_MAX;
+
+public: // サブクラス
+	/// <summary>
+	/// 依存カウンタ。完了していないジョブ数を保持する
+	/// </summary>
+	struct Counter {
+		std::atomic<uint32_t> value{0};
+
+		/// <summary>
+		/// 全ジョブが完了したか
+		/// </summary>
+		/// <returns>完了したか</returns>
+		bool IsDone() const { return value.load(std::memory_order_acquire) == 0; }
+	};
+
+	// ジョブ関数（contextとbegin～endの範囲を受け取る）
+	using JobFunction = void (*)(const void* context, uint32_t begin, uint32_t end);
+
+	// ジョブ
+	struct Job {
+		JobFunction function = nullptr;
+		const void* context = nullptr;
+		uint32_t begin = 0;
+		uint32_t end = 0;
+		Counter* counter = nullptr;
+	};
+
+	// 統計情報
+	struct Statistics {
+		uint64_t executedCount = 0; // 実行したジョブ数
+		uint64_t stolenCount = 0;   // 他スレッドから盗んだジョブ数
+	};
+
+public: // 静的メンバ関数
+	/// <summary>
+	/// シングルトンインスタンスの取得
+	/// </summary>
+	/// <returns>シングルトンインスタンス</returns>
+	static JobSystem* GetInstance();
+
+	/// <summary>
+	/// 現在のスレッド番号を取得（0がメインスレッド）
+	/// </summary>
+	/// <returns>スレッド番号。ジョブシステム外のスレッドはkInvalidThreadIndex</returns>
+	static uint32_t GetCurrentThreadIndex();
+
+public: // メンバ関数
+	/// <summary>
+	/// 初期化。呼び出したスレッドがメインスレッドになる
+	/// </summary>
+	/// <param name="workerCount">ワーカースレッド数。0ならCPUコア数-1</param>
+	void Initialize(uint32_t workerCount = 0);
+
+	/// <summary>
+	/// 終了処理
+	/// </summary>
+	void Finalize();
+
+	/// <summary>
+	/// ジョブ投入
+	/// </summary>
+	/// <param name="function">ジョブ関数</param>
+	/// <param name="context">ジョブ関数に渡すデータ（完了まで生存させること）</param>
+	/// <param name="counter">依存カウンタ（nullptr可）</param>
+	/// <param name="begin">範囲の開始</param>
+	/// <param name="end">範囲の終了</param>
+	void Run(
+	    JobFunction function, const void* context, Counter* counter, uint32_t begin = 0,
+	    uint32_t end = 0);
+
+	/// <summary>
+	/// カウンタが0になるまで待つ。待つ間は他のジョブを実行する
+	/// </summary>
+	/// <param name="counter">依存カウンタ</param>
+	void Wait(const Counter& counter);
+
+	/// <summary>
+	/// 並列for。[0, count)をgrainSize以下の範囲に分割して function(begin, end) を呼ぶ
+	/// </summary>
+	/// <param name="count">要素数</param>
+	/// <param name="grainSize">1ジョブあたりの最小要素数</param>
+	/// <param name="function">処理関数</param>
+	template<class Function>
+	void ParallelFor(uint32_t count, uint32_t grainSize, const Function& function) {
+		RangeContext range{};
+		range.function = &InvokeRange<Function>;
+		range.context = &function;
+		range.grainSize = grainSize == 0 ? 1 : grainSize;
+		range.counter = nullptr;
+		ParallelForInternal(range, count);
+	}
+
+	/// <summary>
+	/// メインスレッドで実行するジョブを登録（D3D12等スレッド制約のある処理用）
+	/// </summary>
+	/// <param name="function">処理関数</param>
+	void RunOnMainThread(std::function<void()> function);
+
+	/// <summary>
+	/// メインスレッドジョブの実行。メインスレッドから毎フレーム呼ぶ
+	/// </summary>
+	void ExecuteMainThreadJobs();
+
+	/// <summary>
+	/// ワーカースレッド数を取得
+	/// </summary>
+	/// <returns>ワーカースレッド数</returns>
+	uint32_t GetWorkerCount() const { return static_cast<uint32_t>(workers_.size()); }
+
+	/// <summary>
+	/// ジョブを実行するスレッド数を取得（メインスレッド含む）
+	/// </summary>
+	/// <returns>スレッド数</returns>
+	uint32_t GetThreadCount() const { return static_cast<uint32_t>(threadContexts_.size()); }
+
+	/// <summary>
+	/// 統計情報を取得
+	/// </summary>
+	/// <returns>統計情報</returns>
+	Statistics GetStatistics() const;
+
+private: // サブクラス
+	/// <summary>
+	/// ワークスティーリング用両端キュー（Chase-Lev）
+	/// 末尾は所有スレッドのみ、先頭は他スレッドが盗む。
+	/// ジョブは値で持ち、取り出す時に先頭を進める前に写すので、取り出したジョブの実行中に
+	/// 所有スレッドが同じ場所へ次のジョブを積んでも影響しない
+	/// </summary>
+	class WorkStealingQueue {
+	public:
+		bool Push(const Job& job);
+		bool Pop(Job& job);
+		bool Steal(Job& job);
+
+	private:
+		// 盗む側が所有スレッドの書き込みと同時に読んでも良いよう、各値をatomicで持つ
+		struct Slot {
+			std::atomic<JobFunction> function;
+			std::atomic<const void*> context;
+			std::atomic<uint32_t> begin;
+			std::atomic<uint32_t> end;
+			std::atomic<Counter*> counter;
+		};
+
+		void Store(int64_t index, const Job& job);
+		void Load(int64_t index, Job& job) const;
+
+		std::atomic<int64_t> top_{0};
+		// topとbottomが同じキャッシュラインに乗らないようにする
+		char pad_[64];
+		std::atomic<int64_t> bottom_{0};
+		std::array<Slot, kJobCountPerThread> jobs_;
+	};
+
+	// スレッド毎のデータ
+	struct ThreadContext {
+		WorkStealingQueue queue;
+		uint32_t randomState = 0;
+		std::atomic<uint64_t> executedCount{0};
+		std::atomic<uint64_t> stolenCount{0};
+	};
+
+	// 並列forの分割情報
+	struct RangeContext {
+		JobFunction function;
+		const void* context;
+		uint32_t grainSize;
+		Counter* counter;
+	};
+
+private: // 静的メンバ関数
+	template<class Function>
+	static void InvokeRange(const void* context, uint32_t begin, uint32_t end) {
+		(*static_cast<const Function*>(context))(begin, end);
+	}
+
+	/// <summary>
+	/// 範囲を二分しながら実行する
+	/// </summary>
+	static void ExecuteRange(const void* context, uint32_t begin, uint32_t end);
+
+private: // メンバ関数
+	JobSystem() = default;
+	~JobSystem() = default;
+	JobSystem(const JobSystem&) = delete;
+	const JobSystem& operator=(const JobSystem&) = delete;
+
+	/// <summary>
+	/// ワーカースレッドの処理
+	/// </summary>
+	void WorkerMain(uint32_t threadIndex);
+
+	/// <summary>
+	/// 実行するジョブを取得（自分のキュー→他スレッドから盗む）
+	/// </summary>
+	/// <returns>取得できたか</returns>
+	bool FindJob(uint32_t threadIndex, Job& job);
+
+	/// <summary>
+	/// ジョブ実行
+	/// </summary>
+	void Execute(const Job& job);
+
+	/// <summary>
+	/// 眠っているワーカーを起こす
+	/// </summary>
+	void WakeWorkers();
+
+	/// <summary>
+	/// 並列forの本体
+	/// </summary>
+	void ParallelForInternal(RangeContext& range, uint32_t count);
+
+private: // メンバ変数
+	// スレッド毎のデータ（0番はメインスレッド）
+	std::vector<std::unique_ptr<ThreadContext>> threadContexts_;
+	// ワーカースレッド
+	std::vector<std::thread> workers_;
+	// 終了フラグ
+	std::atomic<bool> quit_{false};
+	// 未実行のジョブ数
+	std::atomic<int32_t> pendingJobCount_{0};
+	// 眠っているワーカー数
+	std::atomic<uint32_t> sleepingWorkerCount_{0};
+	// スリープ用
+	std::mutex sleepMutex_;
+	std::condition_variable sleepCondition_;
+	// メインスレッドジョブ
+	std::mutex mainThreadMutex_;
+	std::vector<std::function<void()>> mainThreadJobs_;
+	std::vector<std::function<void()>> executingMainThreadJobs_;
+};
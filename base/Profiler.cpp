@@ -0,0 +1,294 @@
+﻿#include "Profiler.h"
+#include <algorithm>
+#include <cassert>
+#include <chrono>
+#include <cstdio>
+#include <fstream>
+
+namespace {
+
+// 呼び出したスレッドのバッファ
+thread_local void* tThreadBuffer = nullptr;
+
+// JSONの文字列として書き出す
+void AppendJsonString(std::string& out, const char* text) {
+	out += '"';
+	for (const char* c = text; *c; c++) {
+		switch (*c) {
+		case '"':
+			out += "\\\"";
+			break;
+		case '\\':
+			out += "\\\\";
+			break;
+		case '\n':
+			out += "\\n";
+			break;
+		default:
+			if (static_cast<unsigned char>(*c) < 0x20) {
+				char escaped[8];
+				snprintf(escaped, sizeof(escaped), "\\u%04x", *c);
+				out += escaped;
+			} else {
+				out += *c;
+			}
+			break;
+		}
+	}
+	out += '"';
+}
+
+// ナノ秒をトレース形式の時刻（マイクロ秒）にする
+void AppendMicroseconds(std::string& out, uint64_t nanoseconds) {
+	char text[32];
+	snprintf(
+	    text, sizeof(text), "%llu.%03llu", static_cast<unsigned long long>(nanoseconds / 1000),
+	    static_cast<unsigned long long>(nanoseconds % 1000));
+	out += text;
+}
+
+} // namespace
+
+Profiler::Scope::Scope(const char* name) : name_(name), begin_(GetTime()) {
+	ThreadBuffer* buffer = Profiler::GetInstance()->GetThreadBuffer();
+	if (buffer) {
+		buffer->depth++;
+	}
+}
+
+Profiler::Scope::~Scope() {
+	uint64_t end = GetTime();
+	ThreadBuffer* buffer = Profiler::GetInstance()->GetThreadBuffer();
+	if (buffer) {
+		buffer->depth--;
+		Push(buffer, {name_, begin_, end, buffer->index, buffer->depth});
+	}
+}
+
+Profiler* Profiler::GetInstance() {
+	static Profiler instance;
+	return &instance;
+}
+
+uint64_t Profiler::GetTime() {
+	std::chrono::nanoseconds time = std::chrono::duration_cast<std::chrono::nanoseconds>(
+	    std::chrono::steady_clock::now().time_since_epoch());
+	return static_cast<uint64_t>(time.count());
+}
+
+void Profiler::BeginFrame() { frameBegin_ = GetTime(); }
+
+void Profiler::EndFrame() {
+	uint64_t frameEnd = GetTime();
+
+	// 書き込む枠（停止中は履歴を残すため使わない）
+	Frame* frame = nullptr;
+	if (!paused_) {
+		uint32_t slot = (frameHead_ + frameCount_) % kFrameHistoryCount;
+		if (frameCount_ == kFrameHistoryCount) {
+			frameHead_ = (frameHead_ + 1) % kFrameHistoryCount;
+		} else {
+			frameCount_++;
+		}
+		frame = &frames_[slot];
+		frame->index = frameIndex_;
+		frame->begin = frameBegin_;
+		frame->end = frameEnd;
+		frame->cpuEvents.clear();
+		frame->gpuEvents.clear();
+	}
+
+	// 各スレッドの前回から増えた区間を回収する
+	uint32_t threadCount = threadCount_.load(std::memory_order_acquire);
+	for (uint32_t t = 0; t < threadCount; t++) {
+		ThreadBuffer* buffer = threads_[t].get();
+		uint64_t writeCount = buffer->writeCount.load(std::memory_order_acquire);
+		uint64_t readCount = buffer->readCount;
+		// 一周以上遅れた分は上書きされているので捨てる
+		if (writeCount - readCount > kEventCountPerThread) {
+			statistics_.droppedEventCount += writeCount - readCount - kEventCountPerThread;
+			readCount = writeCount - kEventCountPerThread;
+		}
+		if (frame) {
+			size_t first = frame->cpuEvents.size();
+			for (uint64_t i = readCount; i < writeCount; i++) {
+				frame->cpuEvents.push_back(buffer->events[i & (kEventCountPerThread - 1)]);
+			}
+			// 写している間に追い越された分は壊れている可能性があるので捨てる
+			uint64_t latest = buffer->writeCount.load(std::memory_order_acquire);
+			if (latest - readCount > kEventCountPerThread) {
+				uint64_t overwritten =
+				    (std::min)(latest - readCount - kEventCountPerThread, writeCount - readCount);
+				frame->cpuEvents.erase(
+				    frame->cpuEvents.begin() + first,
+				    frame->cpuEvents.begin() + first + static_cast<size_t>(overwritten));
+				statistics_.droppedEventCount += overwritten;
+			}
+			statistics_.recordedEventCount += frame->cpuEvents.size() - first;
+		}
+		buffer->readCount = writeCount;
+	}
+
+	// 区間は終了時に積まれるので、スレッド毎に開始時刻順（同時刻は外側が先）に並べ直す
+	if (frame) {
+		std::sort(
+		    frame->cpuEvents.begin(), frame->cpuEvents.end(), [](const Event& a, const Event& b) {
+			    if (a.threadIndex != b.threadIndex) {
+				    return a.threadIndex < b.threadIndex;
+			    }
+			    if (a.begin != b.begin) {
+				    return a.begin < b.begin;
+			    }
+			    return a.depth < b.depth;
+		    });
+	}
+	frameIndex_++;
+}
+
+void Profiler::Record(const char* name, uint64_t begin, uint64_t end) {
+	ThreadBuffer* buffer = GetThreadBuffer();
+	if (buffer) {
+		Push(buffer, {name, begin, end, buffer->index, buffer->depth});
+	}
+}
+
+void Profiler::AddGpuEvents(uint64_t frameIndex, const Event* events, uint32_t count) {
+	Frame* frame = FindFrame(frameIndex);
+	if (!frame) {
+		return;
+	}
+	frame->gpuEvents.assign(events, events + count);
+	std::sort(frame->gpuEvents.begin(), frame->gpuEvents.end(), [](const Event& a, const Event& b) {
+		return a.begin != b.begin ? a.begin < b.begin : a.depth < b.depth;
+	});
+}
+
+void Profiler::SetThreadName(const std::string& name) {
+	ThreadBuffer* buffer = GetThreadBuffer();
+	if (buffer) {
+		std::lock_guard<std::mutex> lock(threadMutex_);
+		buffer->name = name;
+	}
+}
+
+std::string Profiler::GetThreadName(uint32_t threadIndex) const {
+	if (threadIndex == kGpuThreadIndex) {
+		return "GPU";
+	}
+	std::lock_guard<std::mutex> lock(threadMutex_);
+	if (threadIndex < threadCount_.load(std::memory_order_acquire) &&
+	    !threads_[threadIndex]->name.empty()) {
+		return threads_[threadIndex]->name;
+	}
+	return "Thread " + std::to_string(threadIndex);
+}
+
+const Profiler::Frame& Profiler::GetFrame(uint32_t i) const {
+	assert(i < frameCount_);
+	return frames_[(frameHead_ + i) % kFrameHistoryCount];
+}
+
+std::string Profiler::ExportChromeTrace() const {
+	std::string out = "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n";
+	bool first = true;
+	auto appendEvent = [&](const Event& event, uint32_t pid, uint32_t tid, uint64_t origin) {
+		out += first ? "" : ",\n";
+		first = false;
+		out += "{\"name\":";
+		AppendJsonString(out, event.name);
+		out += ",\"ph\":\"X\",\"pid\":" + std::to_string(pid) + ",\"tid\":" + std::to_string(tid);
+		out += ",\"ts\":";
+		AppendMicroseconds(out, event.begin - origin);
+		out += ",\"dur\":";
+		AppendMicroseconds(out, event.end - event.begin);
+		out += "}";
+	};
+	auto appendName = [&](const char* kind, uint32_t pid, uint32_t tid, const std::string& name) {
+		out += first ? "" : ",\n";
+		first = false;
+		out += "{\"name\":\"";
+		out += kind;
+		out += "\",\"ph\":\"M\",\"pid\":" + std::to_string(pid) + ",\"tid\":" + std::to_string(tid);
+		out += ",\"args\":{\"name\":";
+		AppendJsonString(out, name.c_str());
+		out += "}}";
+	};
+
+	// CPUはプロセス0のスレッド毎、GPUはプロセス1に並べる
+	appendName("process_name", 0, 0, "CPU");
+	appendName("process_name", 1, 0, "GPU");
+	appendName("thread_name", 1, 0, "Queue");
+	uint32_t threadCount = threadCount_.load(std::memory_order_acquire);
+	for (uint32_t t = 0; t < threadCount; t++) {
+		appendName("thread_name", 0, t, GetThreadName(t));
+	}
+
+	// 時刻は最も古いフレームの開始からの経過にする
+	uint64_t origin = frameCount_ > 0 ? GetFrame(0).begin : 0;
+	for (uint32_t i = 0; i < frameCount_; i++) {
+		const Frame& frame = GetFrame(i);
+		Event frameEvent = {"Frame", frame.begin, frame.end, 0, 0};
+		appendEvent(frameEvent, 0, kMaxThreadCount, origin);
+		for (const Event& event : frame.cpuEvents) {
+			// 記録開始前に始まった区間は時刻が負になるので切り詰める
+			Event clipped = event;
+			clipped.begin = (std::max)(clipped.begin, origin);
+			clipped.end = (std::max)(clipped.end, clipped.begin);
+			appendEvent(clipped, 0, event.threadIndex, origin);
+		}
+		for (const Event& event : frame.gpuEvents) {
+			Event clipped = event;
+			clipped.begin = (std::max)(clipped.begin, origin);
+			clipped.end = (std::max)(clipped.end, clipped.begin);
+			appendEvent(clipped, 1, 0, origin);
+		}
+	}
+	appendName("thread_name", 0, kMaxThreadCount, "Frames");
+	out += "\n]}\n";
+	return out;
+}
+
+bool Profiler::SaveChromeTrace(const std::string& filePath) const {
+	std::ofstream file(filePath, std::ios::binary);
+	if (!file) {
+		return false;
+	}
+	std::string trace = ExportChromeTrace();
+	file.write(trace.data(), static_cast<std::streamsize>(trace.size()));
+	return static_cast<bool>(file);
+}
+
+Profiler::ThreadBuffer* Profiler::GetThreadBuffer() {
+	if (tThreadBuffer) {
+		return static_cast<ThreadBuffer*>(tThreadBuffer);
+	}
+
+	// 初めて記録するスレッドだけロックして登録する
+	std::lock_guard<std::mutex> lock(threadMutex_);
+	uint32_t index = threadCount_.load(std::memory_order_relaxed);
+	if (index >= kMaxThreadCount) {
+		return nullptr;
+	}
+	threads_[index] = std::make_unique<ThreadBuffer>();
+	threads_[index]->index = index;
+	tThreadBuffer = threads_[index].get();
+	threadCount_.store(index + 1, std::memory_order_release);
+	return threads_[index].get();
+}
+
+void Profiler::Push(ThreadBuffer* buffer, const Event& event) {
+	// 所有スレッドだけが書くので、書いてから件数を公開すれば回収側と競合しない
+	uint64_t writeCount = buffer->writeCount.load(std::memory_order_relaxed);
+	buffer->events[writeCount & (kEventCountPerThread - 1)] = event;
+	buffer->writeCount.store(writeCount + 1, std::memory_order_release);
+}
+
+Profiler::Frame* Profiler::FindFrame(uint64_t frameIndex) {
+	for (uint32_t i = 0; i < frameCount_; i++) {
+		Frame& frame = frames_[(frameHead_ + i) % kFrameHistoryCount];
+		if (frame.index == frameIndex) {
+			return &frame;
+		}
+	}
+	return nullptr;
+}
@@ -0,0 +1,201 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+/// <summary>
+/// フレーム単位のCPU・GPUプロファイラ
+/// CPUの区間はスレッド毎のリングバッファに所有スレッドだけが書き込み、
+/// フレームの終わりにメインスレッドがまとめて回収する（書き込み側はロックしない）
+/// </summary>
+class Profiler {
+public: // 定数
+	// 記録できるスレッドの最大数
+	static const uint32_t kMaxThreadCount = 64;
+	// スレッド毎に回収前まで溜められる区間数（2の累乗）
+	static const uint32_t kEventCountPerThread = 1 << 14;
+	// 保持するフレーム数
+	static const uint32_t kFrameHistoryCount = 240;
+	// GPUの区間のスレッド番号
+	static const uint32_t kGpuThreadIndex = UINT32_MAX;
+
+public: // サブクラス
+	// 計測した区間
+	struct Event {
+		const char* name;     // 名前（文字列リテラルなど、寿命の長いもの）
+		uint64_t begin;       // 開始時刻（ナノ秒）
+		uint64_t end;         // 終了時刻（ナノ秒）
+		uint32_t threadIndex; // 記録したスレッドの番号（GPUはkGpuThreadIndex）
+		uint32_t depth;       // 入れ子の深さ
+	};
+
+	// 1フレーム分の記録
+	struct Frame {
+		uint64_t index = 0;           // フレーム番号
+		uint64_t begin = 0;           // 開始時刻（ナノ秒）
+		uint64_t end = 0;             // 終了時刻（ナノ秒）
+		std::vector<Event> cpuEvents; // CPUの区間（スレッド毎に開始時刻順）
+		std::vector<Event> gpuEvents; // GPUの区間（数フレーム遅れて届く）
+	};
+
+	// 統計
+	struct Statistics {
+		uint64_t recordedEventCount = 0; // 回収した区間数
+		uint64_t droppedEventCount = 0;  // 回収が間に合わず捨てた区間数
+	};
+
+	/// <summary>
+	/// 生存期間を計測する区間
+	/// </summary>
+	class Scope {
+	public:
+		explicit Scope(const char* name);
+		~Scope();
+		Scope(const Scope&) = delete;
+		Scope& operator=(const Scope&) = delete;
+
+	private:
+		const char* name_;
+		uint64_t begin_;
+	};
+
+public: // 静的メンバ関数
+	/// <summary>
+	/// シングルトンインスタンスの取得
+	/// </summary>
+	/// <returns>シングルトンインスタンス</returns>
+	static Profiler* GetInstance();
+
+	/// <summary>
+	/// 現在時刻（ナノ秒）。Windowsではパフォーマンスカウンタと同じ基準
+	/// </summary>
+	static uint64_t GetTime();
+
+public: // メンバ関数
+	/// <summary>
+	/// フレームの開始（メインスレッドから呼ぶ）
+	/// </summary>
+	void BeginFrame();
+
+	/// <summary>
+	/// フレームの終了。各スレッドの区間を回収する（メインスレッドから呼ぶ）
+	/// </summary>
+	void EndFrame();
+
+	/// <summary>
+	/// 区間を記録する（Scopeを使わずに開始・終了時刻が分かっている場合）
+	/// </summary>
+	/// <param name="name">名前</param>
+	/// <param name="begin">開始時刻（ナノ秒）</param>
+	/// <param name="end">終了時刻（ナノ秒）</param>
+	void Record(const char* name, uint64_t begin, uint64_t end);
+
+	/// <summary>
+	/// GPUの区間をフレームに追加する
+	/// </summary>
+	/// <param name="frameIndex">区間を積んだフレームの番号</param>
+	/// <param name="events">区間（時刻はCPUと同じ基準に変換済みのこと）</param>
+	/// <param name="count">区間数</param>
+	void AddGpuEvents(uint64_t frameIndex, const Event* events, uint32_t count);
+
+	/// <summary>
+	/// 呼び出したスレッドに名前を付ける（トレースの表示用）
+	/// </summary>
+	void SetThreadName(const std::string& name);
+
+	/// <summary>
+	/// スレッドの名前を取得
+	/// </summary>
+	std::string GetThreadName(uint32_t threadIndex) const;
+
+	/// <summary>
+	/// 記録を一時停止する。停止中はフレームを回収せず、履歴をそのまま残す
+	/// </summary>
+	void SetPaused(bool paused) { paused_ = paused; }
+	bool IsPaused() const { return paused_; }
+
+	/// <summary>
+	/// 現在のフレーム番号
+	/// </summary>
+	uint64_t GetFrameIndex() const { return frameIndex_; }
+
+	/// <summary>
+	/// 保持しているフレーム数
+	/// </summary>
+	uint32_t GetFrameCount() const { return frameCount_; }
+
+	/// <summary>
+	/// 保持しているフレームを古い順に取得
+	/// </summary>
+	/// <param name="i">0が最も古い</param>
+	const Frame& GetFrame(uint32_t i) const;
+
+	/// <summary>
+	/// 統計を取得
+	/// </summary>
+	const Statistics& GetStatistics() const { return statistics_; }
+
+	/// <summary>
+	/// 保持している全フレームをChromeのトレース形式（JSON）で書き出す
+	/// chrome://tracing や Perfetto で開ける
+	/// </summary>
+	std::string ExportChromeTrace() const;
+
+	/// <summary>
+	/// トレースをファイルに保存する
+	/// </summary>
+	/// <returns>成功したか</returns>
+	bool SaveChromeTrace(const std::string& filePath) const;
+
+private: // サブクラス
+	// スレッド毎の区間バッファ（書き込みは所有スレッドだけ）
+	struct ThreadBuffer {
+		std::array<Event, kEventCountPerThread> events;
+		std::atomic<uint64_t> writeCount{0};
+		uint64_t readCount = 0;
+		uint32_t depth = 0;
+		uint32_t index = 0;
+		std::string name;
+	};
+
+private:
+	Profiler() = default;
+	~Profiler() = default;
+	Profiler(const Profiler&) = delete;
+	Profiler& operator=(const Profiler&) = delete;
+
+	// 呼び出したスレッドのバッファ（初回だけ登録する）
+	ThreadBuffer* GetThreadBuffer();
+	// バッファに区間を積む
+	static void Push(ThreadBuffer* buffer, const Event& event);
+	// フレーム番号から保持しているフレームを探す
+	Frame* FindFrame(uint64_t frameIndex);
+
+private: // メンバ変数
+	// スレッド毎のバッファ
+	std::array<std::unique_ptr<ThreadBuffer>, kMaxThreadCount> threads_;
+	std::atomic<uint32_t> threadCount_{0};
+	// スレッド登録と名前の変更用
+	mutable std::mutex threadMutex_;
+	// フレームの履歴（リング）
+	std::array<Frame, kFrameHistoryCount> frames_;
+	uint32_t frameCount_ = 0;
+	uint32_t frameHead_ = 0;
+	// 現在のフレーム
+	uint64_t frameIndex_ = 0;
+	uint64_t frameBegin_ = 0;
+	// 一時停止中か
+	bool paused_ = false;
+	// 統計
+	Statistics statistics_;
+};
+
+// 生存期間を計測する区間を置く
+#define PROFILE_SCOPE_CONCAT_INNER(a, b) a##b
+#define PROFILE_SCOPE_CONCAT(a, b) PROFILE_SCOPE_CONCAT_INNER(a, b)
+#define PROFILE_SCOPE(name) Profiler::Scope PROFILE_SCOPE_CONCAT(profileScope, __LINE__)(name)
@@ -8,10 +8,20 @@ uint32_t TextureManager::Load(const std::string& fileName) {
 	return TextureManager::GetInstance()->LoadInternal(fileName);
 }
 
+uint32_t TextureManager::LoadLinear(const std::string& fileName) {
+	return TextureManager::GetInstance()->LoadInternal(fileName, false);
+}
+
 bool TextureManager::Unload(uint32_t textureHandle) {
 	return TextureManager::GetInstance()->UnloadInternal(textureHandle);
 }
 
+uint32_t TextureManager::Register(
+    const std::string& name, ID3D12Resource* resource,
+    const D3D12_SHADER_RESOURCE_VIEW_DESC& srvDesc) {
+	return TextureManager::GetInstance()->RegisterInternal(name, resource, srvDesc);
+}
+
 TextureManager* TextureManager::GetInstance() {
 	static TextureManager instance;
 	return &instance;
@@ -71,7 +81,7 @@ void TextureManager::SetGraphicsRootDescriptorTable(
 	    rootParamIndex, textures_[textureHandle].gpuDescHandleSRV);
 }
 
-uint32_t TextureManager::LoadInternal(const std::string& fileName) {
+uint32_t TextureManager::LoadInternal(const std::string& fileName, bool srgb) {
 
 	// 読み込み済みテクスチャを検索
 	auto it = std::find_if(textures_.begin(), textures_.end(), [&](const auto& texture) {
@@ -120,7 +130,9 @@ uint32_t TextureManager::LoadInternal(const std::string& fileName) {
 	}
 
 	// 読み込んだディフューズテクスチャをSRGBとして扱う
-	metadata.format = MakeSRGB(metadata.format);
+	if (srgb) {
+		metadata.format = MakeSRGB(metadata.format);
+	}
 
 	// リソース設定
 	CD3DX12_RESOURCE_DESC texresDesc = CD3DX12_RESOURCE_DESC::Tex2D(
@@ -177,6 +189,33 @@ uint32_t TextureManager::LoadInternal(const std::string& fileName) {
 	return handle;
 }
 
+uint32_t TextureManager::RegisterInternal(
+    const std::string& name, ID3D12Resource* resource,
+    const D3D12_SHADER_RESOURCE_VIEW_DESC& srvDesc) {
+	assert(resource);
+
+	// 書き込むテクスチャの参照
+	uint32_t handle = uint32_t(useTable_.FindFirst());
+	assert(handle < kNumDescriptors);
+
+	Texture& texture = textures_.at(handle);
+	texture.name = name;
+	texture.resource = resource;
+
+	// シェーダリソースビュー作成
+	texture.cpuDescHandleSRV = CD3DX12_CPU_DESCRIPTOR_HANDLE(
+	    descriptorHeap_->GetCPUDescriptorHandleForHeapStart(), handle,
+	    sDescriptorHandleIncrementSize_);
+	texture.gpuDescHandleSRV = CD3DX12_GPU_DESCRIPTOR_HANDLE(
+	    descriptorHeap_->GetGPUDescriptorHandleForHeapStart(), handle,
+	    sDescriptorHandleIncrementSize_);
+	device_->CreateShaderResourceView(resource, &srvDesc, texture.cpuDescHandleSRV);
+
+	useTable_.Set(handle);
+
+	return handle;
+}
+
 bool TextureManager::UnloadInternal(uint32_t textureHandle) {
 	// 範囲外
 	if (textures_.size() <= textureHandle) {
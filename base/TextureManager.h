@@ -35,12 +35,30 @@ public:
 	/// <returns>テクスチャハンドル</returns>
 	static uint32_t Load(const std::string& fileName);
 
+	/// <summary>
+	/// 色ではないデータ（法線マップなど）をSRGB変換せずに読み込み
+	/// </summary>
+	/// <param name="fileName">ファイル名</param>
+	/// <returns>テクスチャハンドル</returns>
+	static uint32_t LoadLinear(const std::string& fileName);
+
 	/// <summary>
 	/// 読み込み解除
 	/// </summary>
 	/// <param name="textureHandle">テクスチャハンドル</param>
 	static bool Unload(uint32_t textureHandle);
 
+	/// <summary>
+	/// 作成済みのリソース（シャドウマップなど）をシェーダリソースビューで登録
+	/// </summary>
+	/// <param name="name">名前</param>
+	/// <param name="resource">リソース</param>
+	/// <param name="srvDesc">シェーダリソースビューの設定</param>
+	/// <returns>テクスチャハンドル</returns>
+	static uint32_t Register(
+	    const std::string& name, ID3D12Resource* resource,
+	    const D3D12_SHADER_RESOURCE_VIEW_DESC& srvDesc);
+
 	/// <summary>
 	/// シングルトンインスタンスの取得
 	/// </summary>
@@ -120,7 +138,18 @@ private:
 	/// 読み込み
 	/// </summary>
 	/// <param name="fileName">ファイル名</param>
-	uint32_t LoadInternal(const std::string& fileName);
+	/// <param name="srgb">SRGBとして扱うか</param>
+	uint32_t LoadInternal(const std::string& fileName, bool srgb = true);
+
+	/// <summary>
+	/// 登録
+	/// </summary>
+	/// <param name="name">名前</param>
+	/// <param name="resource">リソース</param>
+	/// <param name="srvDesc">シェーダリソースビューの設定</param>
+	uint32_t RegisterInternal(
+	    const std::string& name, ID3D12Resource* resource,
+	    const D3D12_SHADER_RESOURCE_VIEW_DESC& srvDesc);
 
 	/// <summary>
 	/// 読み込み解除
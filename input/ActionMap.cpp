@@ -0,0 +1,211 @@
+﻿#include "ActionMap.h"
+#include <algorithm>
+#include <bit>
+#include <cassert>
+#include <cmath>
+#include <cstring>
+#include <emmintrin.h>
+
+namespace {
+
+// ビット列の128bit単位の数
+const uint32_t kLaneCount = InputSnapshot::kWordCount / 2;
+
+} // namespace
+
+void InputSnapshot::Clear() {
+	std::memset(buttons, 0, sizeof(buttons));
+	std::memset(axes, 0, sizeof(axes));
+}
+
+void InputSnapshot::SetKeys(const uint8_t* keys) {
+	// 16キーずつ最上位ビット（0x80）を集め、4回分で64bitにする
+	for (uint32_t word = 0; word < kKeyCount / 64; word++) {
+		uint64_t bits = 0;
+		for (uint32_t i = 0; i < 4; i++) {
+			__m128i key =
+			  _mm_loadu_si128(reinterpret_cast<const __m128i*>(keys + word * 64 + i * 16));
+			bits |= static_cast<uint64_t>(_mm_movemask_epi8(key)) << (i * 16);
+		}
+		buttons[word] = bits;
+	}
+}
+
+void InputSnapshot::SetButton(InputCode code, bool pressed) {
+	assert(code < kCodeCount);
+	uint64_t bit = 1ull << (code % 64);
+	if (pressed) {
+		buttons[code / 64] |= bit;
+	} else {
+		buttons[code / 64] &= ~bit;
+	}
+}
+
+uint32_t ActionMap::CreateAction(const std::string& name) {
+	auto it = actionIndices_.find(name);
+	if (it != actionIndices_.end()) {
+		return it->second;
+	}
+	uint32_t action = static_cast<uint32_t>(states_.size());
+	actionIndices_.emplace(name, action);
+	states_.emplace_back();
+	return action;
+}
+
+uint32_t ActionMap::FindAction(const std::string& name) const {
+	auto it = actionIndices_.find(name);
+	if (it == actionIndices_.end()) {
+		return kInvalidAction;
+	}
+	return it->second;
+}
+
+uint32_t ActionMap::Bind(uint32_t action, const std::vector<InputCode>& chord, float value) {
+	assert(action < states_.size());
+	Binding binding;
+	binding.action = action;
+	binding.value = value;
+	bindings_.push_back(binding);
+	uint32_t index = static_cast<uint32_t>(bindings_.size() - 1);
+	Rebind(index, chord);
+	return index;
+}
+
+uint32_t ActionMap::BindAxis(uint32_t action, uint32_t axis, float scale) {
+	assert(action < states_.size());
+	assert(axis < InputSnapshot::kAxisCount);
+	Binding binding;
+	binding.action = action;
+	binding.axis = axis;
+	binding.value = scale;
+	bindings_.push_back(binding);
+	dirty_ = true;
+	return static_cast<uint32_t>(bindings_.size() - 1);
+}
+
+void ActionMap::Rebind(uint32_t binding, const std::vector<InputCode>& chord) {
+	assert(binding < bindings_.size());
+	assert(bindings_[binding].action != kInvalidAction);
+	assert(!chord.empty());
+	assert(std::all_of(chord.begin(), chord.end(), [](InputCode code) {
+		return code < InputSnapshot::kCodeCount;
+	}));
+	bindings_[binding].chord = chord;
+	dirty_ = true;
+}
+
+void ActionMap::ClearBindings(uint32_t action) {
+	assert(action < states_.size());
+	for (Binding& binding : bindings_) {
+		if (binding.action == action) {
+			// 番号がずれないよう、消さずに外したことにする
+			binding.action = kInvalidAction;
+			binding.chord.clear();
+		}
+	}
+	dirty_ = true;
+}
+
+void ActionMap::Compile() {
+	chords_.clear();
+	axes_.clear();
+	for (const Binding& binding : bindings_) {
+		if (binding.action == kInvalidAction) {
+			continue;
+		}
+		if (binding.chord.empty()) {
+			axes_.push_back({binding.action, binding.axis, binding.value});
+			continue;
+		}
+		CompiledChord chord = {};
+		for (InputCode code : binding.chord) {
+			chord.mask[code / 64] |= 1ull << (code % 64);
+		}
+		// 同じボタンを重ねて書いても1つと数える
+		for (uint64_t word : chord.mask) {
+			chord.buttonCount += static_cast<uint32_t>(std::popcount(word));
+		}
+		chord.action = binding.action;
+		chord.value = binding.value;
+		chords_.push_back(chord);
+	}
+	// 長いコードから評価する（同じ長さの中は割り当てた順）
+	std::stable_sort(
+	  chords_.begin(), chords_.end(), [](const CompiledChord& a, const CompiledChord& b) {
+		  return a.buttonCount > b.buttonCount;
+	  });
+	dirty_ = false;
+}
+
+void ActionMap::Update(const InputSnapshot& input) {
+	if (dirty_) {
+		Compile();
+	}
+	inputPre_ = input_;
+	input_ = input;
+
+	for (ActionState& state : states_) {
+		state.previous = state.pressed;
+		state.value = 0.0f;
+		state.pressed = false;
+	}
+
+	// 成立したコードのボタン。usedはより長いコードが使ったもの、
+	// groupUsedは今評価している長さのコードが使ったもの
+	const __m128i zero = _mm_setzero_si128();
+	__m128i used[kLaneCount];
+	__m128i groupUsed[kLaneCount];
+	for (uint32_t i = 0; i < kLaneCount; i++) {
+		used[i] = zero;
+		groupUsed[i] = zero;
+	}
+	const __m128i* buttons = reinterpret_cast<const __m128i*>(input_.buttons);
+	uint32_t groupButtonCount = 0;
+
+	for (const CompiledChord& chord : chords_) {
+		if (chord.buttonCount != groupButtonCount) {
+			for (uint32_t i = 0; i < kLaneCount; i++) {
+				used[i] = _mm_or_si128(used[i], groupUsed[i]);
+			}
+			groupButtonCount = chord.buttonCount;
+		}
+		// 全て押していて、より長いコードが使ったボタンを含まなければ成立
+		const __m128i* mask = reinterpret_cast<const __m128i*>(chord.mask);
+		int32_t match = 0xffff;
+		for (uint32_t i = 0; i < kLaneCount; i++) {
+			__m128i held = _mm_and_si128(buttons[i], mask[i]);
+			__m128i overlap = _mm_and_si128(used[i], mask[i]);
+			match &= _mm_movemask_epi8(_mm_cmpeq_epi32(held, mask[i]));
+			match &= _mm_movemask_epi8(_mm_cmpeq_epi32(overlap, zero));
+		}
+		if (match != 0xffff) {
+			continue;
+		}
+		for (uint32_t i = 0; i < kLaneCount; i++) {
+			groupUsed[i] = _mm_or_si128(groupUsed[i], mask[i]);
+		}
+		ActionState& state = states_[chord.action];
+		state.value += chord.value;
+		state.pressed = true;
+	}
+
+	for (const CompiledAxis& axis : axes_) {
+		float value = input_.axes[axis.axis] * axis.scale;
+		ActionState& state = states_[axis.action];
+		state.value += value;
+		if (std::fabs(value) >= kPressThreshold) {
+			state.pressed = true;
+		}
+	}
+}
+
+bool ActionMap::FindTriggeredCode(InputCode& code) const {
+	for (uint32_t word = 0; word < InputSnapshot::kWordCount; word++) {
+		uint64_t triggered = input_.buttons[word] & ~inputPre_.buttons[word];
+		if (triggered) {
+			code = static_cast<InputCode>(word * 64 + std::countr_zero(triggered));
+			return true;
+		}
+	}
+	return false;
+}
@@ -0,0 +1,250 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+// 入力のボタン番号（キー、マウスボタン、パッドのボタンを1つの番号にまとめたもの）
+using InputCode = uint16_t;
+
+/// <summary>
+/// 1フレーム分の入力を詰めたもの
+/// ボタンは押していれば立つビット列、軸は-1～1（マウスは移動量そのまま）で持つ
+/// </summary>
+struct InputSnapshot {
+	// キーの数
+	static const uint32_t kKeyCount = 256;
+	// マウスボタンの数
+	static const uint32_t kMouseButtonCount = 8;
+	// パッドの最大数
+	static const uint32_t kMaxPadCount = 4;
+	// パッド1つのボタン数（XInputはwButtonsのビット番号と、16:LT、17:RT。
+	// DirectInputはrgbButtonsの番号）
+	static const uint32_t kPadButtonCount = 32;
+	// ボタン番号の始まり
+	static const InputCode kMouseCodeBase = kKeyCount;
+	static const InputCode kPadCodeBase = kMouseCodeBase + kMouseButtonCount;
+	// ボタン番号の数
+	static const uint32_t kCodeCount = kPadCodeBase + kMaxPadCount * kPadButtonCount;
+	// ビット列の64bit単位の数（SSEで2つずつ扱えるよう偶数にする）
+	static const uint32_t kWordCount = (kCodeCount + 127) / 128 * 2;
+
+	// パッドの軸（スティックは右と上が正、トリガーは0～1）
+	enum PadAxis {
+		kLeftX,
+		kLeftY,
+		kRightX,
+		kRightY,
+		kLeftTrigger,
+		kRightTrigger,
+		kPadAxisCount,
+	};
+	// 軸の番号（マウスのX,Y,ホイールの後に、パッド毎にPadAxisが並ぶ）
+	static const uint32_t kMouseAxisCount = 3;
+	static const uint32_t kAxisCount = kMouseAxisCount + kMaxPadCount * kPadAxisCount;
+
+	alignas(16) uint64_t buttons[kWordCount] = {};
+	float axes[kAxisCount] = {};
+
+	/// <summary>
+	/// キーのボタン番号
+	/// </summary>
+	/// <param name="key">キー番号( DIK_0 等)</param>
+	static InputCode Key(uint8_t key) { return key; }
+
+	/// <summary>
+	/// マウスボタンのボタン番号
+	/// </summary>
+	/// <param name="button">マウスボタン番号(0:左,1:右,2:中,3~7:拡張マウスボタン)</param>
+	static InputCode Mouse(uint32_t button) {
+		return static_cast<InputCode>(kMouseCodeBase + button);
+	}
+
+	/// <summary>
+	/// パッドのボタンのボタン番号
+	/// </summary>
+	/// <param name="pad">パッド番号</param>
+	/// <param name="button">ボタン（XInputはwButtonsのビット番号）</param>
+	static InputCode Pad(uint32_t pad, uint32_t button) {
+		return static_cast<InputCode>(kPadCodeBase + pad * kPadButtonCount + button);
+	}
+
+	/// <summary>
+	/// パッドの軸の番号
+	/// </summary>
+	static uint32_t PadAxisIndex(uint32_t pad, PadAxis axis) {
+		return kMouseAxisCount + pad * kPadAxisCount + axis;
+	}
+
+	/// <summary>
+	/// 全て離した状態にする
+	/// </summary>
+	void Clear();
+
+	/// <summary>
+	/// 全キーの状態（DirectInputと同じく押していれば0x80）をまとめて詰める
+	/// </summary>
+	void SetKeys(const uint8_t* keys);
+
+	/// <summary>
+	/// ボタンの状態を設定する
+	/// </summary>
+	void SetButton(InputCode code, bool pressed);
+
+	/// <summary>
+	/// ボタンを押しているか
+	/// </summary>
+	bool IsPressed(InputCode code) const {
+		return ((buttons[code / 64] >> (code % 64)) & 1) != 0;
+	}
+};
+
+/// <summary>
+/// アクションへの入力の割り当て
+/// ボタンの組み合わせ（コード）と軸をアクションに割り当て、毎フレーム全てのアクションを
+/// まとめて評価する。コードはボタン番号のビット列に変換しておき、押しているボタンとの
+/// 論理積で判定する。長いコードが成立している間は、そのボタンを含む短いコードは成立させない
+/// （Ctrl+SでSのアクションが動かないように）
+/// </summary>
+class ActionMap {
+public: // 定数
+	// 無効なアクション
+	static const uint32_t kInvalidAction = UINT32_MAX;
+	// 軸の値の絶対値がこれ以上なら押しているとみなす
+	static constexpr float kPressThreshold = 0.5f;
+
+public: // メンバ関数
+	/// <summary>
+	/// アクションを作る（同じ名前があればそれを返す）
+	/// </summary>
+	/// <returns>アクション番号</returns>
+	uint32_t CreateAction(const std::string& name);
+
+	/// <summary>
+	/// 名前でアクションを探す
+	/// </summary>
+	/// <returns>アクション番号（無ければkInvalidAction）</returns>
+	uint32_t FindAction(const std::string& name) const;
+
+	/// <summary>
+	/// ボタンの組み合わせを割り当てる（全て押している間だけ成立する）
+	/// </summary>
+	/// <param name="action">アクション番号</param>
+	/// <param name="chord">同時に押すボタン（1つ以上）</param>
+	/// <param name="value">成立している間にアクションの値に足す値（左右移動の左なら-1など）</param>
+	/// <returns>割り当て番号</returns>
+	uint32_t Bind(uint32_t action, const std::vector<InputCode>& chord, float value = 1.0f);
+
+	/// <summary>
+	/// 軸を割り当てる
+	/// </summary>
+	/// <param name="action">アクション番号</param>
+	/// <param name="axis">軸の番号</param>
+	/// <param name="scale">軸の値に掛ける値</param>
+	/// <returns>割り当て番号</returns>
+	uint32_t BindAxis(uint32_t action, uint32_t axis, float scale = 1.0f);
+
+	/// <summary>
+	/// ボタンの組み合わせを割り当て直す
+	/// </summary>
+	/// <param name="binding">Bindの割り当て番号</param>
+	/// <param name="chord">同時に押すボタン（1つ以上）</param>
+	void Rebind(uint32_t binding, const std::vector<InputCode>& chord);
+
+	/// <summary>
+	/// アクションの割り当てを全て外す
+	/// </summary>
+	void ClearBindings(uint32_t action);
+
+	/// <summary>
+	/// 割り当てたボタンの組み合わせの取得（軸の割り当てや外したものは空）
+	/// </summary>
+	const std::vector<InputCode>& GetChord(uint32_t binding) const {
+		return bindings_[binding].chord;
+	}
+
+	/// <summary>
+	/// 毎フレーム処理（全てのアクションをまとめて評価する）
+	/// </summary>
+	void Update(const InputSnapshot& input);
+
+	/// <summary>
+	/// アクションを押しているか
+	/// </summary>
+	bool IsPressed(uint32_t action) const { return states_[action].pressed; }
+
+	/// <summary>
+	/// アクションのトリガー（押した瞬間だけtrue）
+	/// </summary>
+	bool IsTriggered(uint32_t action) const {
+		return states_[action].pressed && !states_[action].previous;
+	}
+
+	/// <summary>
+	/// アクションのリリース（離した瞬間だけtrue）
+	/// </summary>
+	bool IsReleased(uint32_t action) const {
+		return !states_[action].pressed && states_[action].previous;
+	}
+
+	/// <summary>
+	/// アクションの値（成立しているコードの値と軸の値の和）
+	/// </summary>
+	float GetValue(uint32_t action) const { return states_[action].value; }
+
+	/// <summary>
+	/// このフレームに押したボタンを探す（割り当て直す時に、押されたボタンを得るのに使う）
+	/// </summary>
+	/// <param name="code">見つけたボタン番号</param>
+	/// <returns>見つかったか</returns>
+	bool FindTriggeredCode(InputCode& code) const;
+
+private: // サブクラス
+	// アクションの状態
+	struct ActionState {
+		float value = 0.0f;
+		bool pressed = false;
+		bool previous = false;
+	};
+
+	// 割り当て
+	struct Binding {
+		uint32_t action = kInvalidAction; // 外したものはkInvalidAction
+		std::vector<InputCode> chord;     // ボタンの組み合わせ（軸なら空）
+		uint32_t axis = 0;                // 軸の番号
+		float value = 1.0f;               // 成立時に足す値か、軸に掛ける値
+	};
+
+	// 評価用に変換したボタンの組み合わせ
+	struct alignas(16) CompiledChord {
+		uint64_t mask[InputSnapshot::kWordCount];
+		uint32_t action;
+		uint32_t buttonCount;
+		float value;
+	};
+
+	// 評価用に変換した軸
+	struct CompiledAxis {
+		uint32_t action;
+		uint32_t axis;
+		float scale;
+	};
+
+private: // メンバ関数
+	// 割り当てを評価用に変換する
+	void Compile();
+
+private: // メンバ変数
+	std::unordered_map<std::string, uint32_t> actionIndices_;
+	std::vector<ActionState> states_;
+	std::vector<Binding> bindings_;
+	// 評価用（ボタン数の多い順）
+	std::vector<CompiledChord> chords_;
+	std::vector<CompiledAxis> axes_;
+	// 割り当てを変えてから変換していないか
+	bool dirty_ = false;
+	// 今回と前回の入力
+	InputSnapshot input_;
+	InputSnapshot inputPre_;
+};
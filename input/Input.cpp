@@ -1,5 +1,6 @@
 ﻿#include "Input.h"
 #include "WinApp.h"
+#include <algorithm>
 #include <cassert>
 
 #include <XInput.h>
@@ -28,10 +29,35 @@
 
 namespace {
 
+// DirectInputのバッファ入力を受け取る数（1回に読む数も同じ）
+const DWORD kDeviceBufferSize = 256;
+// デバイスを取得できていない時に取得し直す間隔（ミリ秒）
+const DWORD kReacquireInterval = 8;
+// 取得できている時も、通知を取りこぼした場合に備えて確かめる間隔（ミリ秒）
+const DWORD kIdleInterval = 100;
+// 押している状態の値
+const BYTE kPressed = 0x80;
+// 積み直す時に全キーと全ボタンの差を出すための、押下状態にない値
+const BYTE kUnknownState = 0xFF;
+
 std::vector<DWORD> sXInputVidPids;
 IDirectInputDevice8* sCurrentDevice = nullptr;
 bool sRefreshInputDevices = false;
 
+// バッファ入力のサイズとイベント通知を設定する（取得していない状態で呼ぶ）
+void SetupBufferedInput(IDirectInputDevice8* device, HANDLE notify) {
+	DIPROPDWORD diprop{};
+	diprop.diph.dwSize = sizeof(DIPROPDWORD);
+	diprop.diph.dwHeaderSize = sizeof(DIPROPHEADER);
+	diprop.diph.dwHow = DIPH_DEVICE;
+	diprop.diph.dwObj = 0;
+	diprop.dwData = kDeviceBufferSize;
+	HRESULT result = device->SetProperty(DIPROP_BUFFERSIZE, &diprop.diph);
+	assert(SUCCEEDED(result));
+	result = device->SetEventNotification(notify);
+	assert(SUCCEEDED(result));
+}
+
 bool IsPress(const DIMOUSESTATE2& mouseState, int32_t buttonNumber) {
 	assert(0 <= buttonNumber && buttonNumber < _countof(mouseState.rgbButtons));
 	return (mouseState.rgbButtons[buttonNumber] & 0x80) != 0;
@@ -204,6 +230,16 @@ Input* Input::GetInstance() {
 }
 
 Input::~Input() {
+	// 入力スレッドを止めてからデバイスを手放す
+	if (inputThread_.joinable()) {
+		SetEvent(quitNotify_);
+		inputThread_.join();
+	}
+	for (HANDLE notify : {keyboardNotify_, mouseNotify_, quitNotify_}) {
+		if (notify) {
+			CloseHandle(notify);
+		}
+	}
 	if (devKeyboard_) {
 		devKeyboard_->Unacquire();
 	}
@@ -211,7 +247,9 @@ Input::~Input() {
 		devMouse_->Unacquire();
 	}
 	for (auto& joystick : devJoysticks_) {
-		joystick.device_->Unacquire();
+		if (joystick.device_) {
+			joystick.device_->Unacquire();
+		}
 	}
 }
 
@@ -251,6 +289,14 @@ void Input::Initialize() {
 	result = devMouse_->SetCooperativeLevel(hwnd_, DISCL_FOREGROUND | DISCL_NONEXCLUSIVE);
 	assert(SUCCEEDED(result));
 
+	// キーボードとマウスはバッファ入力にして、入力があったら入力スレッドを起こす
+	keyboardNotify_ = CreateEvent(nullptr, FALSE, FALSE, nullptr);
+	mouseNotify_ = CreateEvent(nullptr, FALSE, FALSE, nullptr);
+	quitNotify_ = CreateEvent(nullptr, FALSE, FALSE, nullptr);
+	assert(keyboardNotify_ && mouseNotify_ && quitNotify_);
+	SetupBufferedInput(devKeyboard_.Get(), keyboardNotify_);
+	SetupBufferedInput(devMouse_.Get(), mouseNotify_);
+
 	// XInput判定
 	SetupForIsXInputDevice();
 
@@ -269,9 +315,17 @@ void Input::Initialize() {
 
 	SetWindowsHookExW(
 	  WH_CALLWNDPROC, (HOOKPROC)&SubWndProc, GetModuleHandleW(NULL), GetCurrentThreadId());
+
+	// 入力スレッドを開始
+	inputState_.Reset();
+	inputThread_ = std::thread(&Input::InputThreadMain, this);
 }
 
 void Input::Update() {
+	// 再生中は記録から状態を作る（抜き差しの反映は再生が終わってから）
+	if (replaying_ && UpdateReplay()) {
+		return;
+	}
 
 	if (sRefreshInputDevices) {
 		SetupForIsXInputDevice();
@@ -279,8 +333,7 @@ void Input::Update() {
 		sRefreshInputDevices = false;
 	}
 
-	devKeyboard_->Acquire(); // キーボード動作開始
-	devMouse_->Acquire();    // マウス動作開始
+	// キーボードとマウスは入力スレッドが取得する
 	for (auto& joystick : devJoysticks_) {
 		joystick.device_->Acquire();
 	}
@@ -289,13 +342,20 @@ void Input::Update() {
 	keyPre_ = key_;
 	mousePre_ = mouse_;
 
+	// 前のフレームから届いたイベントでキーとマウスの状態を作る
+	inputState_.BeginFrame();
+	inputState_.ApplyAll(eventQueue_);
+
 	// キーの入力
-	key_.fill(0);
-	devKeyboard_->GetDeviceState((DWORD)size(key_), key_.data());
+	key_ = inputState_.GetKeys();
 
 	// マウスの入力
 	std::memset(&mouse_, 0, sizeof(mouse_));
-	devMouse_->GetDeviceState(sizeof(mouse_), &mouse_);
+	mouse_.lX = inputState_.GetMouseMove(0);
+	mouse_.lY = inputState_.GetMouseMove(1);
+	mouse_.lZ = inputState_.GetMouseMove(2);
+	const auto& mouseButtons = inputState_.GetMouseButtons();
+	std::memcpy(mouse_.rgbButtons, mouseButtons.data(), sizeof(mouse_.rgbButtons));
 
 	// ジョイスティックの入力情報取得
 	int32_t xInputIndex = 0;
@@ -344,6 +404,163 @@ void Input::Update() {
 	ScreenToClient(hwnd_, &mousePosition);
 	mousePosition_.x = static_cast<float>(mousePosition.x);
 	mousePosition_.y = static_cast<float>(mousePosition.y);
+
+	UpdateSnapshot();
+
+	if (recording_) {
+		RecordFrame();
+	}
+}
+
+void Input::StartRecording() {
+	assert(!replaying_);
+	recorder_.Clear();
+	recording_ = true;
+}
+
+bool Input::StopRecording(const std::string& filePath) {
+	recording_ = false;
+	return recorder_.Save(filePath);
+}
+
+bool Input::StartReplay(const std::string& filePath) {
+	assert(!recording_);
+	if (!player_.Load(filePath)) {
+		return false;
+	}
+	// ジョイスティックは記録した台数に合わせて作り直す
+	for (auto& joystick : devJoysticks_) {
+		joystick.device_->Unacquire();
+	}
+	devJoysticks_.clear();
+	replaying_ = true;
+	return true;
+}
+
+bool Input::UpdateReplay() {
+	// デバイスの入力は捨てるが、再生後に押したままにならないよう状態は追いかけておく
+	inputState_.BeginFrame();
+	inputState_.ApplyAll(eventQueue_);
+
+	if (!player_.Read(frame_)) {
+		// 最後まで再生したら、デバイスの入力に戻す
+		replaying_ = false;
+		SetupJoysticks();
+		return false;
+	}
+
+	// 前回の入力を保存
+	keyPre_ = key_;
+	mousePre_ = mouse_;
+
+	std::copy(frame_.keys.begin(), frame_.keys.end(), key_.begin());
+	std::memset(&mouse_, 0, sizeof(mouse_));
+	mouse_.lX = frame_.mouseMove[0];
+	mouse_.lY = frame_.mouseMove[1];
+	mouse_.lZ = frame_.mouseMove[2];
+	std::memcpy(mouse_.rgbButtons, frame_.mouseButtons.data(), sizeof(mouse_.rgbButtons));
+	mousePosition_.x = frame_.mousePosition[0];
+	mousePosition_.y = frame_.mousePosition[1];
+
+	// ジョイスティックは1台毎に種類と状態が並ぶ（デバイスは持たない）
+	const size_t joystickSize = sizeof(uint8_t) + sizeof(State);
+	devJoysticks_.resize(frame_.joysticks.size() / joystickSize);
+	for (size_t i = 0; i < devJoysticks_.size(); i++) {
+		Joystick& joystick = devJoysticks_[i];
+		const uint8_t* data = frame_.joysticks.data() + i * joystickSize;
+		joystick.statePre_ = joystick.state_;
+		joystick.type_ = static_cast<PadType>(data[0]);
+		std::memcpy(&joystick.state_, data + 1, sizeof(State));
+	}
+	UpdateSnapshot();
+	return true;
+}
+
+void Input::RecordFrame() {
+	std::copy(key_.begin(), key_.end(), frame_.keys.begin());
+	std::memcpy(frame_.mouseButtons.data(), mouse_.rgbButtons, sizeof(mouse_.rgbButtons));
+	frame_.mouseMove[0] = mouse_.lX;
+	frame_.mouseMove[1] = mouse_.lY;
+	frame_.mouseMove[2] = mouse_.lZ;
+	frame_.mousePosition[0] = mousePosition_.x;
+	frame_.mousePosition[1] = mousePosition_.y;
+
+	// ジョイスティックはデッドゾーンを適用した後の状態を、種類と合わせて並べる
+	const size_t joystickSize = sizeof(uint8_t) + sizeof(State);
+	frame_.joysticks.resize(devJoysticks_.size() * joystickSize);
+	for (size_t i = 0; i < devJoysticks_.size(); i++) {
+		const Joystick& joystick = devJoysticks_[i];
+		uint8_t* data = frame_.joysticks.data() + i * joystickSize;
+		data[0] = static_cast<uint8_t>(joystick.type_);
+		std::memcpy(data + 1, &joystick.state_, sizeof(State));
+	}
+	recorder_.Record(frame_);
+}
+
+void Input::UpdateSnapshot() {
+	snapshot_.Clear();
+	snapshot_.SetKeys(key_.data());
+	for (uint32_t i = 0; i < InputSnapshot::kMouseButtonCount; i++) {
+		snapshot_.SetButton(InputSnapshot::Mouse(i), (mouse_.rgbButtons[i] & kPressed) != 0);
+	}
+	snapshot_.axes[0] = static_cast<float>(mouse_.lX);
+	snapshot_.axes[1] = static_cast<float>(mouse_.lY);
+	snapshot_.axes[2] = static_cast<float>(mouse_.lZ);
+
+	// スティックは-1～1（右と上が正）、トリガーは0～1にする
+	const float kStickScale = 1.0f / 32768.0f;
+	const float kTriggerScale = 1.0f / 255.0f;
+	uint32_t padCount =
+	  (std::min)(static_cast<uint32_t>(devJoysticks_.size()), InputSnapshot::kMaxPadCount);
+	for (uint32_t pad = 0; pad < padCount; pad++) {
+		const Joystick& joystick = devJoysticks_[pad];
+		float* axes = snapshot_.axes + InputSnapshot::PadAxisIndex(pad, InputSnapshot::kLeftX);
+		if (joystick.type_ == PadType::DirectInput) {
+			const DIJOYSTATE2& directInput = joystick.state_.directInput_;
+			for (uint32_t i = 0; i < InputSnapshot::kPadButtonCount; i++) {
+				snapshot_.SetButton(
+				  InputSnapshot::Pad(pad, i), (directInput.rgbButtons[i] & kPressed) != 0);
+			}
+			// DirectInputは下が正
+			axes[InputSnapshot::kLeftX] = static_cast<float>(directInput.lX) * kStickScale;
+			axes[InputSnapshot::kLeftY] = -static_cast<float>(directInput.lY) * kStickScale;
+			axes[InputSnapshot::kRightX] = static_cast<float>(directInput.lRx) * kStickScale;
+			axes[InputSnapshot::kRightY] = -static_cast<float>(directInput.lRy) * kStickScale;
+		} else {
+			const XINPUT_GAMEPAD& gamePad = joystick.state_.xInput_.Gamepad;
+			for (uint32_t i = 0; i < 16; i++) {
+				snapshot_.SetButton(InputSnapshot::Pad(pad, i), ((gamePad.wButtons >> i) & 1) != 0);
+			}
+			// トリガーはボタンとしても使えるようにする
+			snapshot_.SetButton(
+			  InputSnapshot::Pad(pad, 16), gamePad.bLeftTrigger > XINPUT_GAMEPAD_TRIGGER_THRESHOLD);
+			snapshot_.SetButton(
+			  InputSnapshot::Pad(pad, 17),
+			  gamePad.bRightTrigger > XINPUT_GAMEPAD_TRIGGER_THRESHOLD);
+			axes[InputSnapshot::kLeftX] = static_cast<float>(gamePad.sThumbLX) * kStickScale;
+			axes[InputSnapshot::kLeftY] = static_cast<float>(gamePad.sThumbLY) * kStickScale;
+			axes[InputSnapshot::kRightX] = static_cast<float>(gamePad.sThumbRX) * kStickScale;
+			axes[InputSnapshot::kRightY] = static_cast<float>(gamePad.sThumbRY) * kStickScale;
+			axes[InputSnapshot::kLeftTrigger] =
+			  static_cast<float>(gamePad.bLeftTrigger) * kTriggerScale;
+			axes[InputSnapshot::kRightTrigger] =
+			  static_cast<float>(gamePad.bRightTrigger) * kTriggerScale;
+		}
+	}
+}
+
+uint64_t Input::GetTime() {
+	static const LARGE_INTEGER frequency = [] {
+		LARGE_INTEGER value;
+		QueryPerformanceFrequency(&value);
+		return value;
+	}();
+	LARGE_INTEGER counter;
+	QueryPerformanceCounter(&counter);
+	// そのまま100万倍すると桁あふれするので、秒と端数に分ける
+	uint64_t ticks = static_cast<uint64_t>(counter.QuadPart);
+	uint64_t ticksPerSecond = static_cast<uint64_t>(frequency.QuadPart);
+	return ticks / ticksPerSecond * 1000000 + ticks % ticksPerSecond * 1000000 / ticksPerSecond;
 }
 
 bool Input::PushKey(BYTE keyNumber) const {
@@ -488,4 +705,171 @@ void Input::SetupJoysticks() {
 		sCurrentDevice = joystick.device_.Get();
 		joystick.device_->EnumObjects(EnumAxesCallback, reinterpret_cast<void*>(hwnd_), DIDFT_AXIS);
 	}
-}
\ No newline at end of file
+}
+
+void Input::InputThreadMain() {
+	HANDLE notifies[] = {keyboardNotify_, mouseNotify_, quitNotify_};
+	while (true) {
+		// 入力が来るまで待つ（取得できていないデバイスがあれば、一定間隔で取得し直す）
+		// （積み直しを待っている間も、キューが空くのを一定間隔で確かめる）
+		DWORD timeout = keyboardAcquired_ && mouseAcquired_ && !resyncPending_ ? kIdleInterval
+		                                                                      : kReacquireInterval;
+		DWORD wait = WaitForMultipleObjects(
+		  static_cast<DWORD>(_countof(notifies)), notifies, FALSE, timeout);
+		if (wait == WAIT_OBJECT_0 + 2) {
+			return;
+		}
+		uint64_t time = GetTime();
+		ReadKeyboard(time);
+		ReadMouse(time);
+		if (resyncPending_) {
+			ResyncState(time);
+		}
+	}
+}
+
+void Input::ReadKeyboard(uint64_t time) {
+	if (!keyboardAcquired_) {
+		if (FAILED(devKeyboard_->Acquire())) {
+			return;
+		}
+		// 取得していない間の変化はバッファに入らないので、今の状態との差を積む
+		keyboardAcquired_ = true;
+		SyncKeyboard(time, false);
+	}
+
+	DIDEVICEOBJECTDATA data[kDeviceBufferSize];
+	DWORD count;
+	// あふれてもバッファは満杯まで返るので、続けて読んだ結果で上書きしないように覚えておく
+	bool overflowed = false;
+	do {
+		count = kDeviceBufferSize;
+		HRESULT result = devKeyboard_->GetDeviceData(sizeof(DIDEVICEOBJECTDATA), data, &count, 0);
+		if (FAILED(result)) {
+			// フォーカスを失ったら、押していたキーは全て離したことにする
+			keyboardAcquired_ = false;
+			SyncKeyboard(time, true);
+			return;
+		}
+		overflowed |= (result == DI_BUFFEROVERFLOW);
+		for (DWORD i = 0; i < count; i++) {
+			BYTE key = static_cast<BYTE>(data[i].dwOfs);
+			threadKeys_[key] = static_cast<BYTE>(data[i].dwData & kPressed);
+			PushEvent(time, InputEventType::kKey, key, threadKeys_[key]);
+		}
+	} while (count == kDeviceBufferSize);
+
+	// バッファからあふれた分は、今の状態との差で補う
+	if (overflowed) {
+		SyncKeyboard(time, false);
+	}
+}
+
+void Input::ReadMouse(uint64_t time) {
+	if (!mouseAcquired_) {
+		if (FAILED(devMouse_->Acquire())) {
+			return;
+		}
+		mouseAcquired_ = true;
+		SyncMouse(time, false);
+	}
+
+	DIDEVICEOBJECTDATA data[kDeviceBufferSize];
+	DWORD count;
+	bool overflowed = false;
+	// 移動量は軸毎にまとめ、ボタンの変化の前と読み終わりにだけ積む（移動でキューを埋めない）
+	int32_t moves[InputStateBuilder::kMouseAxisCount] = {};
+	auto flushMoves = [&]() {
+		for (uint8_t axis = 0; axis < InputStateBuilder::kMouseAxisCount; axis++) {
+			if (moves[axis] != 0) {
+				PushEvent(time, InputEventType::kMouseMove, axis, moves[axis]);
+				moves[axis] = 0;
+			}
+		}
+	};
+	do {
+		count = kDeviceBufferSize;
+		HRESULT result = devMouse_->GetDeviceData(sizeof(DIDEVICEOBJECTDATA), data, &count, 0);
+		if (FAILED(result)) {
+			flushMoves();
+			mouseAcquired_ = false;
+			SyncMouse(time, true);
+			return;
+		}
+		overflowed |= (result == DI_BUFFEROVERFLOW);
+		for (DWORD i = 0; i < count; i++) {
+			// 軸とボタンはDIMOUSESTATE2の中の位置で区別する
+			DWORD offset = data[i].dwOfs;
+			if (offset <= static_cast<DWORD>(DIMOFS_Z)) {
+				// 移動量は軸毎の相対値（X、Y、ホイールの順に先頭からLONGで並ぶ）
+				uint8_t axis = static_cast<uint8_t>(offset / sizeof(LONG));
+				moves[axis] += static_cast<int32_t>(data[i].dwData);
+			} else if (
+			  static_cast<DWORD>(DIMOFS_BUTTON0) <= offset &&
+			  offset <= static_cast<DWORD>(DIMOFS_BUTTON7)) {
+				flushMoves();
+				uint8_t button = static_cast<uint8_t>(offset - DIMOFS_BUTTON0);
+				threadMouseButtons_[button] = static_cast<BYTE>(data[i].dwData & kPressed);
+				PushEvent(
+				  time, InputEventType::kMouseButton, button, threadMouseButtons_[button]);
+			}
+		}
+	} while (count == kDeviceBufferSize);
+	flushMoves();
+
+	// あふれた分の移動量は失われるが、ボタンは今の状態との差で補う
+	if (overflowed) {
+		SyncMouse(time, false);
+	}
+}
+
+void Input::SyncKeyboard(uint64_t time, bool release) {
+	std::array<BYTE, 256> keys = {};
+	if (!release && FAILED(devKeyboard_->GetDeviceState(
+	                  static_cast<DWORD>(keys.size()), keys.data()))) {
+		keys.fill(0);
+	}
+	for (uint32_t i = 0; i < keys.size(); i++) {
+		BYTE state = static_cast<BYTE>(keys[i] & kPressed);
+		if (state != threadKeys_[i]) {
+			threadKeys_[i] = state;
+			PushEvent(time, InputEventType::kKey, static_cast<uint8_t>(i), state);
+		}
+	}
+}
+
+void Input::SyncMouse(uint64_t time, bool release) {
+	DIMOUSESTATE2 mouse = {};
+	if (!release && FAILED(devMouse_->GetDeviceState(sizeof(mouse), &mouse))) {
+		mouse = {};
+	}
+	for (uint32_t i = 0; i < threadMouseButtons_.size(); i++) {
+		BYTE state = static_cast<BYTE>(mouse.rgbButtons[i] & kPressed);
+		if (state != threadMouseButtons_[i]) {
+			threadMouseButtons_[i] = state;
+			PushEvent(time, InputEventType::kMouseButton, static_cast<uint8_t>(i), state);
+		}
+	}
+}
+
+void Input::ResyncState(uint64_t time) {
+	// 全キーと全ボタンを積める空きができるまで待つ
+	if (eventQueue_.GetFreeCount() < threadKeys_.size() + threadMouseButtons_.size()) {
+		return;
+	}
+	resyncPending_ = false;
+	// 入力スレッドが知っている状態はメインスレッドに届いていないかもしれないので、全て積む
+	threadKeys_.fill(kUnknownState);
+	threadMouseButtons_.fill(kUnknownState);
+	SyncKeyboard(time, !keyboardAcquired_);
+	SyncMouse(time, !mouseAcquired_);
+}
+
+void Input::PushEvent(uint64_t time, InputEventType type, uint8_t code, int32_t value) {
+	// メインスレッドが長く止まってキューが満杯なら捨てる（数えておく）
+	// 捨てた押下状態はメインスレッドに届かないので、空いたら状態を積み直す
+	if (!eventQueue_.Push({time, type, code, value})) {
+		droppedEventCount_++;
+		resyncPending_ = true;
+	}
+}
@@ -1,8 +1,14 @@
 #pragma once
 
+#include "ActionMap.h"
+#include "InputEvent.h"
+#include "InputRecord.h"
 #include "Vector2.h"
 #include <Windows.h>
 #include <array>
+#include <atomic>
+#include <string>
+#include <thread>
 #include <vector>
 #include <wrl.h>
 
@@ -12,6 +18,9 @@
 
 /// <summary>
 /// 入力
+/// キーボードとマウスは入力スレッドがDirectInputのバッファ入力を受け取り、
+/// 時刻付きのイベントにしてキューに積む。Updateはそのイベントから状態を組み立てるので、
+/// フレームの途中で押して離したキーも取りこぼさない。ジョイスティックは毎フレーム読む
 /// </summary>
 class Input {
 
@@ -56,6 +65,39 @@ public: // メンバ関数
 	/// </summary>
 	void Update();
 
+	/// <summary>
+	/// 現在時刻（マイクロ秒。入力イベントの時刻と同じ起点）
+	/// </summary>
+	static uint64_t GetTime();
+
+	/// <summary>
+	/// 入力の記録を開始する（以降のUpdateで毎フレームの入力を記録する）
+	/// </summary>
+	void StartRecording();
+
+	/// <summary>
+	/// 入力の記録を終了し、ファイルに書き出す
+	/// </summary>
+	/// <param name="filePath">書き出すファイル</param>
+	/// <returns>書き出せたか</returns>
+	bool StopRecording(const std::string& filePath);
+
+	/// <summary>
+	/// 記録した入力の再生を開始する
+	/// 再生中はデバイスを読まず、記録したキー、マウス、ジョイスティックの状態をフレーム毎に返す。
+	/// 最後まで再生すると、次のUpdateからデバイスの入力に戻る
+	/// </summary>
+	/// <param name="filePath">StopRecordingで書き出したファイル</param>
+	/// <returns>記録を読めたか</returns>
+	bool StartReplay(const std::string& filePath);
+
+	/// <summary>
+	/// 記録した入力を再生中か（まだ再生していないフレームが残っているか）
+	/// </summary>
+	bool IsReplaying() const {
+		return replaying_ && player_.GetFrameIndex() < player_.GetFrameCount();
+	}
+
 	/// <summary>
 	/// キーの押下をチェック
 	/// </summary>
@@ -70,6 +112,23 @@ public: // メンバ関数
 	/// <returns>トリガーか</returns>
 	bool TriggerKey(BYTE keyNumber) const;
 
+	/// <summary>
+	/// キーを最後に押したか離した時刻を取得する
+	/// </summary>
+	/// <param name="keyNumber">キー番号( DIK_0 等)</param>
+	/// <returns>時刻（マイクロ秒。GetTimeと同じ起点。一度も無ければ0）</returns>
+	uint64_t GetKeyTime(BYTE keyNumber) const { return inputState_.GetKeyTime(keyNumber); }
+
+	/// <summary>
+	/// このフレームの入力をまとめたものを取得する（ActionMap::Updateに渡す）
+	/// </summary>
+	const InputSnapshot& GetSnapshot() const { return snapshot_; }
+
+	/// <summary>
+	/// キューが満杯で捨てた入力イベントの数を取得する
+	/// </summary>
+	uint32_t GetDroppedEventCount() const { return droppedEventCount_; }
+
 	/// <summary>
 	/// 全キー情報取得
 	/// </summary>
@@ -169,6 +228,25 @@ private:
 	Input(const Input&) = delete;
 	const Input& operator=(const Input&) = delete;
 	void SetupJoysticks();
+	// 記録した入力を1フレーム分読んで状態にする（最後まで読んだらfalse）
+	bool UpdateReplay();
+	// 今のフレームの入力を記録する
+	void RecordFrame();
+	// 今のフレームの入力をsnapshot_にまとめる
+	void UpdateSnapshot();
+	// 入力スレッドの処理
+	void InputThreadMain();
+	// キーボードのバッファ入力を読んでイベントを積む
+	void ReadKeyboard(uint64_t time);
+	// マウスのバッファ入力を読んでイベントを積む
+	void ReadMouse(uint64_t time);
+	// 現在の状態を読み、入力スレッドが知っている状態との差をイベントとして積む
+	void SyncKeyboard(uint64_t time, bool release);
+	void SyncMouse(uint64_t time, bool release);
+	// イベントを捨てた後、キューが空いたら全キーと全ボタンの状態を積み直す
+	void ResyncState(uint64_t time);
+	// イベントを積む（入力スレッド）
+	void PushEvent(uint64_t time, InputEventType type, uint8_t code, int32_t value);
 
 private: // メンバ変数
 	Microsoft::WRL::ComPtr<IDirectInput8> dInput_;
@@ -181,4 +259,30 @@ private: // メンバ変数
 	DIMOUSESTATE2 mousePre_;
 	HWND hwnd_;
 	Vector2 mousePosition_;
+	// 今のフレームの入力をまとめたもの
+	InputSnapshot snapshot_;
+	// 入力イベントから組み立てた状態
+	InputStateBuilder inputState_;
+	// 入力スレッドが積んだイベント
+	InputEventQueue eventQueue_;
+	std::atomic<uint32_t> droppedEventCount_ = 0;
+	// 入力スレッド
+	std::thread inputThread_;
+	// 入力スレッドを起こすイベント（キーボード、マウス、終了）
+	HANDLE keyboardNotify_ = nullptr;
+	HANDLE mouseNotify_ = nullptr;
+	HANDLE quitNotify_ = nullptr;
+	// 入力スレッドだけが触る、デバイスを取得中か、最後に積んだ押下状態
+	bool keyboardAcquired_ = false;
+	bool mouseAcquired_ = false;
+	std::array<BYTE, 256> threadKeys_ = {};
+	std::array<BYTE, 8> threadMouseButtons_ = {};
+	// イベントを捨てたので状態を積み直す必要があるか
+	bool resyncPending_ = false;
+	// 入力の記録と再生
+	InputRecorder recorder_;
+	InputPlayer player_;
+	InputFrame frame_;
+	bool recording_ = false;
+	bool replaying_ = false;
 };
@@ -0,0 +1,84 @@
+﻿#include "InputEvent.h"
+#include <cassert>
+
+namespace {
+
+// 押している状態の値（DirectInputと同じ）
+const uint8_t kPressed = 0x80;
+
+} // namespace
+
+void InputStateBuilder::Reset() {
+	keys_.fill(0);
+	mouseButtons_.fill(0);
+	for (int32_t& move : mouseMove_) {
+		move = 0;
+	}
+	keyPressedInFrame_.fill(0);
+	mousePressedInFrame_.fill(0);
+	keyReleasePending_.fill(0);
+	mouseReleasePending_.fill(0);
+}
+
+void InputStateBuilder::BeginFrame() {
+	// 前のフレームで押してすぐ離したものを、ここで離す
+	for (uint32_t i = 0; i < kKeyCount; i++) {
+		if (keyReleasePending_[i]) {
+			keys_[i] = 0;
+		}
+	}
+	for (uint32_t i = 0; i < kMouseButtonCount; i++) {
+		if (mouseReleasePending_[i]) {
+			mouseButtons_[i] = 0;
+		}
+	}
+	keyPressedInFrame_.fill(0);
+	mousePressedInFrame_.fill(0);
+	keyReleasePending_.fill(0);
+	mouseReleasePending_.fill(0);
+	for (int32_t& move : mouseMove_) {
+		move = 0;
+	}
+}
+
+void InputStateBuilder::Apply(const InputEvent& event) {
+	lastEventTime_ = event.time;
+	bool press = (event.value & kPressed) != 0;
+	switch (event.type) {
+	case InputEventType::kKey:
+		ApplyButton(
+		  keys_.data(), keyPressedInFrame_.data(), keyReleasePending_.data(), event.code, press);
+		keyTimes_[event.code] = event.time;
+		break;
+	case InputEventType::kMouseButton:
+		if (event.code < kMouseButtonCount) {
+			ApplyButton(
+			  mouseButtons_.data(), mousePressedInFrame_.data(), mouseReleasePending_.data(),
+			  event.code, press);
+		}
+		break;
+	case InputEventType::kMouseMove:
+		if (event.code < kMouseAxisCount) {
+			mouseMove_[event.code] += event.value;
+		}
+		break;
+	default:
+		assert(false);
+		break;
+	}
+}
+
+void InputStateBuilder::ApplyButton(
+  uint8_t* states, uint8_t* pressedInFrame, uint8_t* releasePending, uint32_t index, bool press) {
+	if (press) {
+		// 押して離してまた押したなら、持ち越した離す操作は取り消す
+		states[index] = kPressed;
+		pressedInFrame[index] = 1;
+		releasePending[index] = 0;
+	} else if (pressedInFrame[index]) {
+		// このフレームに押したものは、このフレームの間は押したままにする
+		releasePending[index] = 1;
+	} else {
+		states[index] = 0;
+	}
+}
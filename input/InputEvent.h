@@ -0,0 +1,116 @@
+#pragma once
+
+#include "SpscQueue.h"
+#include <array>
+#include <cstdint>
+
+// 入力イベントの種類
+enum class InputEventType : uint8_t {
+	kKey,         // キー（codeはキー番号、valueは押していれば0x80、離したら0）
+	kMouseButton, // マウスボタン（codeはボタン番号、valueはkKeyと同じ）
+	kMouseMove,   // マウスの移動（codeは軸。0:X,1:Y,2:ホイール、valueは移動量）
+};
+
+/// <summary>
+/// 入力イベント
+/// </summary>
+struct InputEvent {
+	uint64_t time;       // 発生時刻（マイクロ秒。起点は任意だが単調増加）
+	InputEventType type; // 種類
+	uint8_t code;        // キー番号、ボタン番号、軸
+	int32_t value;       // 押下状態か移動量
+};
+
+// 入力スレッドからメインスレッドへ渡すキュー
+using InputEventQueue = SpscQueue<InputEvent, 4096>;
+
+/// <summary>
+/// 入力イベントからキーとマウスの状態を組み立てる
+/// 1フレームの間に押して離したキーやボタンは、そのフレームは押したままにして次のフレームで離す
+/// （フレームの途中の短い入力でもPushKeyとTriggerKeyで必ず1フレームは見える）
+/// </summary>
+class InputStateBuilder {
+public: // 定数
+	// キーの数
+	static const uint32_t kKeyCount = 256;
+	// マウスボタンの数
+	static const uint32_t kMouseButtonCount = 8;
+	// マウスの軸の数
+	static const uint32_t kMouseAxisCount = 3;
+
+public: // メンバ関数
+	/// <summary>
+	/// 全て離した状態にする
+	/// </summary>
+	void Reset();
+
+	/// <summary>
+	/// フレームの始まり（前のフレームから持ち越した離す操作を反映し、移動量を0にする）
+	/// </summary>
+	void BeginFrame();
+
+	/// <summary>
+	/// イベントを反映する
+	/// </summary>
+	void Apply(const InputEvent& event);
+
+	/// <summary>
+	/// キューのイベントを全て反映する
+	/// </summary>
+	/// <returns>反映したイベント数</returns>
+	template<uint32_t Capacity>
+	uint32_t ApplyAll(SpscQueue<InputEvent, Capacity>& queue) {
+		uint32_t count = 0;
+		InputEvent event;
+		while (queue.Pop(event)) {
+			Apply(event);
+			count++;
+		}
+		return count;
+	}
+
+	/// <summary>
+	/// 全キーの状態（DirectInputのキー番号で引く。押していれば0x80）
+	/// </summary>
+	const std::array<uint8_t, kKeyCount>& GetKeys() const { return keys_; }
+
+	/// <summary>
+	/// マウスボタンの状態（押していれば0x80）
+	/// </summary>
+	const std::array<uint8_t, kMouseButtonCount>& GetMouseButtons() const { return mouseButtons_; }
+
+	/// <summary>
+	/// このフレームのマウスの移動量
+	/// </summary>
+	/// <param name="axis">軸（0:X,1:Y,2:ホイール）</param>
+	int32_t GetMouseMove(uint32_t axis) const { return mouseMove_[axis]; }
+
+	/// <summary>
+	/// キーを最後に押したか離した時刻（マイクロ秒。一度も無ければ0）
+	/// </summary>
+	uint64_t GetKeyTime(uint8_t key) const { return keyTimes_[key]; }
+
+	/// <summary>
+	/// 最後に反映したイベントの時刻（マイクロ秒。一度も無ければ0）
+	/// </summary>
+	uint64_t GetLastEventTime() const { return lastEventTime_; }
+
+private: // メンバ関数
+	// 押下状態の変化を反映する（このフレームに押したものを離す時は次のフレームに回す）
+	void ApplyButton(
+	    uint8_t* states, uint8_t* pressedInFrame, uint8_t* releasePending, uint32_t index,
+	    bool press);
+
+private: // メンバ変数
+	std::array<uint8_t, kKeyCount> keys_ = {};
+	std::array<uint8_t, kMouseButtonCount> mouseButtons_ = {};
+	int32_t mouseMove_[kMouseAxisCount] = {};
+	// このフレームに押したか
+	std::array<uint8_t, kKeyCount> keyPressedInFrame_ = {};
+	std::array<uint8_t, kMouseButtonCount> mousePressedInFrame_ = {};
+	// 次のフレームの始めに離すか
+	std::array<uint8_t, kKeyCount> keyReleasePending_ = {};
+	std::array<uint8_t, kMouseButtonCount> mouseReleasePending_ = {};
+	std::array<uint64_t, kKeyCount> keyTimes_ = {};
+	uint64_t lastEventTime_ = 0;
+};
@@ -0,0 +1,239 @@
+﻿#include "InputRecord.h"
+#include <cstring>
+#include <fstream>
+#include <iterator>
+
+namespace {
+
+const char kMagic[4] = {'I', 'N', 'R', 'C'};
+const uint32_t kVersion = 1;
+
+// ヘッダー
+struct Header {
+	char magic[4];       // "INRC"
+	uint32_t version;    // kVersion
+	uint32_t frameCount; // フレーム数
+	uint32_t reserved;
+};
+
+// ジョイスティックより前の部分のバイト数
+const size_t kFixedSize = sizeof(InputFrame::keys) + sizeof(InputFrame::mouseButtons) +
+                          sizeof(InputFrame::mouseMove) + sizeof(InputFrame::mousePosition);
+
+// 1フレームのバイト数の上限（壊れた記録で大きく確保しないようにする）
+const uint64_t kMaxFrameSize = 64 * 1024;
+
+// 変わっていないバイトがこれより短く挟まるだけなら、範囲を分けずにまとめて書く
+// （範囲を分けると長さと間隔で2バイト以上増えるため）
+const size_t kMergeGap = 3;
+
+// フレームを1つのバイト列に並べる
+void Flatten(const InputFrame& frame, std::vector<uint8_t>& bytes) {
+	bytes.resize(kFixedSize + frame.joysticks.size());
+	uint8_t* p = bytes.data();
+	memcpy(p, frame.keys.data(), sizeof(frame.keys));
+	p += sizeof(frame.keys);
+	memcpy(p, frame.mouseButtons.data(), sizeof(frame.mouseButtons));
+	p += sizeof(frame.mouseButtons);
+	memcpy(p, frame.mouseMove, sizeof(frame.mouseMove));
+	p += sizeof(frame.mouseMove);
+	memcpy(p, frame.mousePosition, sizeof(frame.mousePosition));
+	p += sizeof(frame.mousePosition);
+	if (!frame.joysticks.empty()) {
+		memcpy(p, frame.joysticks.data(), frame.joysticks.size());
+	}
+}
+
+// バイト列からフレームに戻す
+bool Unflatten(const std::vector<uint8_t>& bytes, InputFrame& frame) {
+	if (bytes.size() < kFixedSize) {
+		return false;
+	}
+	const uint8_t* p = bytes.data();
+	memcpy(frame.keys.data(), p, sizeof(frame.keys));
+	p += sizeof(frame.keys);
+	memcpy(frame.mouseButtons.data(), p, sizeof(frame.mouseButtons));
+	p += sizeof(frame.mouseButtons);
+	memcpy(frame.mouseMove, p, sizeof(frame.mouseMove));
+	p += sizeof(frame.mouseMove);
+	memcpy(frame.mousePosition, p, sizeof(frame.mousePosition));
+	p += sizeof(frame.mousePosition);
+	frame.joysticks.assign(p, bytes.data() + bytes.size());
+	return true;
+}
+
+// 可変長整数（LEB128）を書く
+void WriteVarint(std::vector<uint8_t>& data, uint64_t value) {
+	while (value >= 0x80) {
+		data.push_back(static_cast<uint8_t>(value | 0x80));
+		value >>= 7;
+	}
+	data.push_back(static_cast<uint8_t>(value));
+}
+
+// 可変長整数（LEB128）を読む
+bool ReadVarint(const std::vector<uint8_t>& data, size_t& offset, uint64_t& value) {
+	value = 0;
+	for (uint32_t shift = 0; shift < 64; shift += 7) {
+		if (offset >= data.size()) {
+			return false;
+		}
+		uint8_t byte = data[offset++];
+		value |= static_cast<uint64_t>(byte & 0x7f) << shift;
+		if (!(byte & 0x80)) {
+			return true;
+		}
+	}
+	return false;
+}
+
+} // namespace
+
+void InputRecorder::Clear() {
+	frames_.clear();
+	previous_.clear();
+	frameCount_ = 0;
+}
+
+void InputRecorder::Record(const InputFrame& frame) {
+	Flatten(frame, current_);
+	size_t size = current_.size();
+	WriteVarint(frames_, size);
+
+	// 長さが変わったら、前のフレームは増えた分を0として比べる（再生側も同じように伸ばす）
+	previous_.resize(size, 0);
+
+	// 変わった範囲を書く
+	size_t end = 0;
+	size_t i = 0;
+	while (i < size) {
+		if (current_[i] == previous_[i]) {
+			i++;
+			continue;
+		}
+		// 変わっていないバイトが続くまで範囲を伸ばす
+		size_t begin = i;
+		size_t last = i;
+		while (i < size && i - last <= kMergeGap) {
+			if (current_[i] != previous_[i]) {
+				last = i;
+			}
+			i++;
+		}
+		WriteVarint(frames_, last + 1 - begin);
+		WriteVarint(frames_, begin - end);
+		frames_.insert(frames_.end(), current_.begin() + begin, current_.begin() + last + 1);
+		end = last + 1;
+		i = end;
+	}
+	// 長さ0の範囲で終わり
+	WriteVarint(frames_, 0);
+
+	previous_.swap(current_);
+	frameCount_++;
+}
+
+std::vector<uint8_t> InputRecorder::GetData() const {
+	Header header = {};
+	memcpy(header.magic, kMagic, sizeof(kMagic));
+	header.version = kVersion;
+	header.frameCount = frameCount_;
+
+	std::vector<uint8_t> data(sizeof(header) + frames_.size());
+	memcpy(data.data(), &header, sizeof(header));
+	if (!frames_.empty()) {
+		memcpy(data.data() + sizeof(header), frames_.data(), frames_.size());
+	}
+	return data;
+}
+
+bool InputRecorder::Save(const std::string& filePath) const {
+	std::ofstream file(filePath, std::ios_base::binary);
+	if (file.fail()) {
+		return false;
+	}
+	std::vector<uint8_t> data = GetData();
+	file.write(reinterpret_cast<const char*>(data.data()), data.size());
+	return !file.fail();
+}
+
+bool InputPlayer::Open(std::vector<uint8_t> data) {
+	data_.clear();
+	frameCount_ = 0;
+	Rewind();
+
+	Header header;
+	if (data.size() < sizeof(header)) {
+		return false;
+	}
+	memcpy(&header, data.data(), sizeof(header));
+	if (memcmp(header.magic, kMagic, sizeof(kMagic)) != 0 || header.version != kVersion) {
+		return false;
+	}
+	data_ = std::move(data);
+	frameCount_ = header.frameCount;
+	Rewind();
+	return true;
+}
+
+bool InputPlayer::Load(const std::string& filePath) {
+	std::ifstream file(filePath, std::ios_base::binary);
+	if (file.fail()) {
+		return false;
+	}
+	std::vector<uint8_t> data(
+	  (std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+	return Open(std::move(data));
+}
+
+bool InputPlayer::Read(InputFrame& frame) {
+	if (frameIndex_ >= frameCount_) {
+		return false;
+	}
+
+	// 失敗したら続きを読まないよう、最後まで読んだことにする
+	size_t offset = offset_;
+	uint64_t size;
+	if (!ReadVarint(data_, offset, size) || size < kFixedSize || size > kMaxFrameSize) {
+		frameIndex_ = frameCount_;
+		return false;
+	}
+	std::vector<uint8_t>& bytes = current_;
+	bytes = previous_;
+	bytes.resize(static_cast<size_t>(size), 0);
+
+	// 変わった範囲を書き戻す
+	size_t end = 0;
+	while (true) {
+		uint64_t length;
+		uint64_t skip;
+		if (!ReadVarint(data_, offset, length)) {
+			frameIndex_ = frameCount_;
+			return false;
+		}
+		if (length == 0) {
+			break;
+		}
+		if (!ReadVarint(data_, offset, skip) || skip > bytes.size() - end ||
+		    length > bytes.size() - end - skip || length > data_.size() - offset) {
+			frameIndex_ = frameCount_;
+			return false;
+		}
+		size_t begin = end + static_cast<size_t>(skip);
+		memcpy(bytes.data() + begin, data_.data() + offset, static_cast<size_t>(length));
+		offset += static_cast<size_t>(length);
+		end = begin + static_cast<size_t>(length);
+	}
+
+	Unflatten(bytes, frame);
+	previous_.swap(bytes);
+	offset_ = offset;
+	frameIndex_++;
+	return true;
+}
+
+void InputPlayer::Rewind() {
+	offset_ = sizeof(Header);
+	previous_.clear();
+	frameIndex_ = 0;
+}
@@ -0,0 +1,115 @@
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+/// <summary>
+/// 1フレーム分の入力
+/// </summary>
+struct InputFrame {
+	std::array<uint8_t, 256> keys = {};        // 全キーの状態
+	std::array<uint8_t, 8> mouseButtons = {};  // マウスボタンの状態
+	int32_t mouseMove[3] = {};                 // マウスの移動量（X,Y,ホイール）
+	float mousePosition[2] = {};               // マウスの位置（ウィンドウ座標）
+	// ジョイスティックの状態（中身は呼び出し側が決める。Inputは1台毎に種類1バイトと状態を並べる）
+	std::vector<uint8_t> joysticks;
+};
+
+/// <summary>
+/// 入力の記録
+/// 毎フレームの入力を1つのバイト列に並べ、前のフレームと変わったところだけを書く。
+/// フレーム毎に、バイト列の長さと、変わった範囲（長さ、前の範囲からの間隔、中身）を
+/// LEB128の可変長整数で並べ、長さ0の範囲で終える
+/// </summary>
+class InputRecorder {
+public: // メンバ関数
+	/// <summary>
+	/// 記録を空にする
+	/// </summary>
+	void Clear();
+
+	/// <summary>
+	/// 1フレーム分を記録する
+	/// </summary>
+	void Record(const InputFrame& frame);
+
+	/// <summary>
+	/// 記録したフレーム数
+	/// </summary>
+	uint32_t GetFrameCount() const { return frameCount_; }
+
+	/// <summary>
+	/// 記録の中身（ヘッダーを含む）
+	/// </summary>
+	std::vector<uint8_t> GetData() const;
+
+	/// <summary>
+	/// ファイルに書き出す
+	/// </summary>
+	/// <returns>書き出せたか</returns>
+	bool Save(const std::string& filePath) const;
+
+private: // メンバ変数
+	// フレームを並べたもの（ヘッダーを除く）
+	std::vector<uint8_t> frames_;
+	// 前のフレームのバイト列
+	std::vector<uint8_t> previous_;
+	// 作業用
+	std::vector<uint8_t> current_;
+	uint32_t frameCount_ = 0;
+};
+
+/// <summary>
+/// 記録した入力の再生
+/// </summary>
+class InputPlayer {
+public: // メンバ関数
+	/// <summary>
+	/// 記録を開く
+	/// </summary>
+	/// <param name="data">InputRecorder::GetDataの中身</param>
+	/// <returns>記録として読めたか</returns>
+	bool Open(std::vector<uint8_t> data);
+
+	/// <summary>
+	/// ファイルから記録を開く
+	/// </summary>
+	/// <returns>記録として読めたか</returns>
+	bool Load(const std::string& filePath);
+
+	/// <summary>
+	/// 次のフレームを読む
+	/// </summary>
+	/// <param name="frame">読み込み先</param>
+	/// <returns>読めたか（最後まで読んだか、壊れていればfalse）</returns>
+	bool Read(InputFrame& frame);
+
+	/// <summary>
+	/// 最初から読み直す
+	/// </summary>
+	void Rewind();
+
+	/// <summary>
+	/// 記録のフレーム数
+	/// </summary>
+	uint32_t GetFrameCount() const { return frameCount_; }
+
+	/// <summary>
+	/// 次に読むフレームの番号
+	/// </summary>
+	uint32_t GetFrameIndex() const { return frameIndex_; }
+
+private: // メンバ変数
+	std::vector<uint8_t> data_;
+	// 次に読む位置
+	size_t offset_ = 0;
+	// 前のフレームのバイト列
+	std::vector<uint8_t> previous_;
+	// 作業用
+	std::vector<uint8_t> current_;
+	uint32_t frameCount_ = 0;
+	uint32_t frameIndex_ = 0;
+};
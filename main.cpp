@@ -2,13 +2,82 @@
 #include "AxisIndicator.h"
 #include "DirectXCommon.h"
 #include "GameScene.h"
+#include "GpuProfiler.h"
 #include "ImGuiManager.h"
+#include "JobSystem.h"
 #include "PrimitiveDrawer.h"
+#include "Profiler.h"
+#include "ProfilerWindow.h"
 #include "TextureManager.h"
 #include "WinApp.h"
+#include <string>
+#include <vector>
+
+namespace {
+
+// 記録した入力の再生と記録で使う1フレームの時間
+const float kReplayDeltaTime = 1.0f / 60.0f;
+
+// 起動オプション
+struct LaunchOptions {
+	std::string recordPath; // -record <ファイル> 入力を記録し、終了時に書き出す
+	std::string replayPath; // -replay <ファイル> 記録した入力を再生し、最後まで再生したら終了する
+	std::string tracePath;  // -trace <ファイル> 終了時にプロファイラのトレースを書き出す
+	std::string audioPath;  // -audioout <ファイル> 音を鳴らさず、ミックス結果をWAVに書き出す
+};
+
+// コマンドラインを空白で区切る（""で囲めば空白を含められる）
+std::vector<std::string> SplitCommandLine(const char* commandLine) {
+	std::vector<std::string> arguments;
+	std::string argument;
+	bool quoted = false;
+	bool hasArgument = false;
+	for (const char* c = commandLine; *c; c++) {
+		if (*c == '"') {
+			quoted = !quoted;
+			hasArgument = true;
+		} else if ((*c == ' ' || *c == '\t') && !quoted) {
+			if (hasArgument) {
+				arguments.push_back(argument);
+				argument.clear();
+				hasArgument = false;
+			}
+		} else {
+			argument.push_back(*c);
+			hasArgument = true;
+		}
+	}
+	if (hasArgument) {
+		arguments.push_back(argument);
+	}
+	return arguments;
+}
+
+// 起動オプションを読む（知らないオプションは無視する）
+LaunchOptions ParseLaunchOptions(const char* commandLine) {
+	LaunchOptions options;
+	std::vector<std::string> arguments = SplitCommandLine(commandLine);
+	for (size_t i = 0; i + 1 < arguments.size(); i++) {
+		if (arguments[i] == "-record") {
+			options.recordPath = arguments[++i];
+		} else if (arguments[i] == "-replay") {
+			options.replayPath = arguments[++i];
+		} else if (arguments[i] == "-trace") {
+			options.tracePath = arguments[++i];
+		} else if (arguments[i] == "-audioout") {
+			options.audioPath = arguments[++i];
+		}
+	}
+	return options;
+}
+
+// 失敗をデバッグ出力に書く
+void LogError(const std::string& message) { OutputDebugStringA((message + "\n").c_str()); }
+
+} // namespace
 
 // Windowsアプリでのエントリーポイント(main関数)
-int WINAPI WinMain(HINSTANCE, HINSTANCE, LPSTR, int) {
+int WINAPI WinMain(HINSTANCE, HINSTANCE, LPSTR commandLine, int) {
 	WinApp* win = nullptr;
 	DirectXCommon* dxCommon = nullptr;
 	// 汎用機能
@@ -17,6 +86,12 @@ int WINAPI WinMain(HINSTANCE, HINSTANCE, LPSTR, int) {
 	AxisIndicator* axisIndicator = nullptr;
 	PrimitiveDrawer* primitiveDrawer = nullptr;
 	GameScene* gameScene = nullptr;
+	JobSystem* jobSystem = nullptr;
+	Profiler* profiler = nullptr;
+	GpuProfiler* gpuProfiler = nullptr;
+	LaunchOptions options = ParseLaunchOptions(commandLine);
+	// 終了コード（記録した入力やトレースを扱えなかったら0以外）
+	int exitCode = 0;
 
 	// ゲームウィンドウの作成
 	win = WinApp::GetInstance();
@@ -27,6 +102,16 @@ int WINAPI WinMain(HINSTANCE, HINSTANCE, LPSTR, int) {
 	dxCommon->Initialize(win);
 
 #pragma region 汎用機能初期化
+	// プロファイラの初期化
+	profiler = Profiler::GetInstance();
+	profiler->SetThreadName("Main");
+	gpuProfiler = GpuProfiler::GetInstance();
+	gpuProfiler->Initialize(dxCommon->GetDevice(), dxCommon->GetCommandQueue());
+
+	// ジョブシステムの初期化（このスレッドがメインスレッドになる）
+	jobSystem = JobSystem::GetInstance();
+	jobSystem->Initialize();
+
 	// ImGuiの初期化
 	ImGuiManager* imguiManager = ImGuiManager::GetInstance();
 	imguiManager->Initialize(win, dxCommon);
@@ -35,9 +120,19 @@ int WINAPI WinMain(HINSTANCE, HINSTANCE, LPSTR, int) {
 	input = Input::GetInstance();
 	input->Initialize();
 
-	// オーディオの初期化
+	// オーディオの初期化（-audiooutならXAudio2を使わず、Mixerで混ぜてファイルに書く）
 	audio = Audio::GetInstance();
-	audio->Initialize();
+	WaveFileOutput audioFile;
+	NullAudioOutput nullAudio;
+	if (options.audioPath.empty()) {
+		audio->Initialize();
+	} else if (audioFile.Open(options.audioPath, Audio::kMixerSampleRate)) {
+		audio->Initialize("Resources/", Audio::Backend::kMixer, &audioFile);
+	} else {
+		// 書き出せなくても止めず、音の出ない出力で続ける
+		LogError("Failed to open audio output: " + options.audioPath);
+		audio->Initialize("Resources/", Audio::Backend::kMixer, &nullAudio);
+	}
 
 	// テクスチャマネージャの初期化
 	TextureManager::GetInstance()->Initialize(dxCommon->GetDevice());
@@ -57,50 +152,125 @@ int WINAPI WinMain(HINSTANCE, HINSTANCE, LPSTR, int) {
 	primitiveDrawer->Initialize();
 #pragma endregion
 
+	// 入力の記録と再生（同じ入力から毎回同じ結果になるよう、時間刻みを固定する）
+	// 記録中は60fps固定の待ちを残し、プレイヤーが見ていた速さのまま1フレームずつ進める。
+	// 再生は実時間に合わせる必要がないので待たない
+	if (!options.recordPath.empty() || !options.replayPath.empty()) {
+		dxCommon->SetFixedDeltaTime(kReplayDeltaTime);
+	}
+	if (!options.replayPath.empty()) {
+		dxCommon->SetFrameLimitEnabled(false);
+		if (!input->StartReplay(options.replayPath)) {
+			LogError("Failed to start replay: " + options.replayPath);
+			exitCode = 1;
+		}
+	} else if (!options.recordPath.empty()) {
+		input->StartRecording();
+	}
+
 	// ゲームシーンの初期化
 	gameScene = new GameScene();
 	gameScene->Initialize();
 
-	// メインループ
-	while (true) {
+	// メインループ（記録した入力を再生できなければ始めずに終了する）
+	while (exitCode == 0) {
 		// メッセージ処理
 		if (win->ProcessMessage()) {
 			break;
 		}
 
+		// 計測開始
+		profiler->BeginFrame();
+
 		// ImGui受付開始
 		imguiManager->Begin();
 		// 入力関連の毎フレーム処理
 		input->Update();
 		// ゲームシーンの毎フレーム処理
-		gameScene->Update();
+		{
+			Profiler::Scope scope("GameScene::Update");
+			gameScene->Update();
+		}
+		// 3D再生の音源の反映
+		{
+			Profiler::Scope scope("Audio::Update");
+			audio->Update(dxCommon->GetDeltaTime());
+		}
 		// 軸表示の更新
-		axisIndicator->Update();
+		{
+			Profiler::Scope scope("AxisIndicator::Update");
+			axisIndicator->Update();
+		}
+		// プロファイラの表示
+		ProfilerWindow::GetInstance()->Draw();
 		// ImGui受付終了
 		imguiManager->End();
+		// メインスレッド指定のジョブを実行
+		jobSystem->ExecuteMainThreadJobs();
 
 		// 描画開始
 		dxCommon->PreDraw();
+		ID3D12GraphicsCommandList* commandList = dxCommon->GetCommandList();
+		gpuProfiler->BeginFrame();
+		// 描画統計のリセット
+		Model::ResetDrawStatistics();
 		// ゲームシーンの描画
-		gameScene->Draw();
+		{
+			Profiler::Scope scope("GameScene::Draw");
+			GpuProfiler::Scope gpuScope(commandList, "GameScene::Draw");
+			gameScene->Draw();
+		}
 		// 軸表示の描画
-		axisIndicator->Draw();
+		{
+			Profiler::Scope scope("AxisIndicator::Draw");
+			GpuProfiler::Scope gpuScope(commandList, "AxisIndicator::Draw");
+			axisIndicator->Draw();
+		}
 		// プリミティブ描画のリセット
 		primitiveDrawer->Reset();
 		// ImGui描画
-		imguiManager->Draw();
+		{
+			Profiler::Scope scope("ImGuiManager::Draw");
+			GpuProfiler::Scope gpuScope(commandList, "ImGuiManager::Draw");
+			imguiManager->Draw();
+		}
 		// 描画終了
-		dxCommon->PostDraw();
+		gpuProfiler->EndFrame(commandList);
+		{
+			Profiler::Scope scope("DirectXCommon::PostDraw");
+			dxCommon->PostDraw();
+		}
+
+		// 計測終了
+		profiler->EndFrame();
+
+		// 記録した入力を最後まで再生したら終了
+		if (!options.replayPath.empty() && !input->IsReplaying()) {
+			break;
+		}
+	}
+
+	// 記録した入力とトレースの書き出し
+	if (!options.recordPath.empty() && !input->StopRecording(options.recordPath)) {
+		LogError("Failed to save recording: " + options.recordPath);
+		exitCode = 1;
+	}
+	if (!options.tracePath.empty() && !profiler->SaveChromeTrace(options.tracePath)) {
+		LogError("Failed to save trace: " + options.tracePath);
+		exitCode = 1;
 	}
 
 	// 各種解放
 	SafeDelete(gameScene);
 	audio->Finalize();
+	audioFile.Close();
 	// ImGui解放
 	imguiManager->Finalize();
+	// ジョブシステム解放
+	jobSystem->Finalize();
 
 	// ゲームウィンドウの破棄
 	win->TerminateGameWindow();
 
-	return 0;
+	return exitCode;
 }
\ No newline at end of file
@@ -0,0 +1,102 @@
+#pragma once
+
+#include "Matrix4x4.h"
+#include "Vector3.h"
+#include "Vector4.h"
+#include <cmath>
+
+// ベクトル・行列の基本演算
+
+// 加算
+inline Vector3 Add(const Vector3& v1, const Vector3& v2) {
+	return {v1.x + v2.x, v1.y + v2.y, v1.z + v2.z};
+}
+
+// 減算
+inline Vector3 Subtract(const Vector3& v1, const Vector3& v2) {
+	return {v1.x - v2.x, v1.y - v2.y, v1.z - v2.z};
+}
+
+// スカラー倍
+inline Vector3 Multiply(float scalar, const Vector3& v) {
+	return {scalar * v.x, scalar * v.y, scalar * v.z};
+}
+
+// 内積
+inline float Dot(const Vector3& v1, const Vector3& v2) {
+	return v1.x * v2.x + v1.y * v2.y + v1.z * v2.z;
+}
+
+// クロス積
+inline Vector3 Cross(const Vector3& v1, const Vector3& v2) {
+	return {v1.y * v2.z - v1.z * v2.y, v1.z * v2.x - v1.x * v2.z, v1.x * v2.y - v1.y * v2.x};
+}
+
+// 長さ
+inline float Length(const Vector3& v) { return std::sqrt(Dot(v, v)); }
+
+// 正規化（長さ0ならそのまま返す）
+inline Vector3 Normalize(const Vector3& v) {
+	float length = Length(v);
+	if (length == 0.0f) {
+		return v;
+	}
+	return Multiply(1.0f / length, v);
+}
+
+// 成分毎の最小値
+inline Vector3 Min(const Vector3& v1, const Vector3& v2) {
+	return {
+	    v1.x < v2.x ? v1.x : v2.x, v1.y < v2.y ? v1.y : v2.y, v1.z < v2.z ? v1.z : v2.z};
+}
+
+// 成分毎の最大値
+inline Vector3 Max(const Vector3& v1, const Vector3& v2) {
+	return {
+	    v1.x > v2.x ? v1.x : v2.x, v1.y > v2.y ? v1.y : v2.y, v1.z > v2.z ? v1.z : v2.z};
+}
+
+// 行列の積
+inline Matrix4x4 Multiply(const Matrix4x4& m1, const Matrix4x4& m2) {
+	Matrix4x4 result{};
+	for (int row = 0; row < 4; row++) {
+		for (int column = 0; column < 4; column++) {
+			result.m[row][column] = m1.m[row][0] * m2.m[0][column] +
+			                        m1.m[row][1] * m2.m[1][column] +
+			                        m1.m[row][2] * m2.m[2][column] + m1.m[row][3] * m2.m[3][column];
+		}
+	}
+	return result;
+}
+
+// 座標変換（w除算あり）
+inline Vector3 Transform(const Vector3& v, const Matrix4x4& m) {
+	float x = v.x * m.m[0][0] + v.y * m.m[1][0] + v.z * m.m[2][0] + m.m[3][0];
+	float y = v.x * m.m[0][1] + v.y * m.m[1][1] + v.z * m.m[2][1] + m.m[3][1];
+	float z = v.x * m.m[0][2] + v.y * m.m[1][2] + v.z * m.m[2][2] + m.m[3][2];
+	float w = v.x * m.m[0][3] + v.y * m.m[1][3] + v.z * m.m[2][3] + m.m[3][3];
+	if (w != 0.0f && w != 1.0f) {
+		return {x / w, y / w, z / w};
+	}
+	return {x, y, z};
+}
+
+// 方向ベクトルの変換（平行移動なし）
+inline Vector3 TransformNormal(const Vector3& v, const Matrix4x4& m) {
+	return {
+	    v.x * m.m[0][0] + v.y * m.m[1][0] + v.z * m.m[2][0],
+	    v.x * m.m[0][1] + v.y * m.m[1][1] + v.z * m.m[2][1],
+	    v.x * m.m[0][2] + v.y * m.m[1][2] + v.z * m.m[2][2]};
+}
+
+// 平行移動成分の取得
+inline Vector3 GetTranslation(const Matrix4x4& m) { return {m.m[3][0], m.m[3][1], m.m[3][2]}; }
+
+// 各軸のスケールの最大値
+inline float GetMaxScale(const Matrix4x4& m) {
+	float scaleX = Length({m.m[0][0], m.m[0][1], m.m[0][2]});
+	float scaleY = Length({m.m[1][0], m.m[1][1], m.m[1][2]});
+	float scaleZ = Length({m.m[2][0], m.m[2][1], m.m[2][2]});
+	float scale = scaleX > scaleY ? scaleX : scaleY;
+	return scale > scaleZ ? scale : scaleZ;
+}
@@ -0,0 +1,51 @@
+#pragma once
+
+#include "Vector3.h"
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <type_traits>
+#include <xmmintrin.h>
+
+// 頂点配列を処理するモジュール（法線の平滑化、接線の生成、簡略化など）で共有する内部用の関数
+
+// ストライド付き配列の要素
+template<class T> T& At(T* base, size_t stride, uint32_t index) {
+	using Byte = std::conditional_t<std::is_const_v<T>, const uint8_t, uint8_t>;
+	return *reinterpret_cast<T*>(reinterpret_cast<Byte*>(base) + stride * index);
+}
+
+// SSEレジスタへの読み込み（4番目のレーンは0）
+inline __m128 Load(const Vector3& v) { return _mm_set_ps(0.0f, v.z, v.y, v.x); }
+
+// SSEレジスタからの書き出し
+inline void Store(Vector3& v, __m128 value) {
+	float result[4];
+	_mm_storeu_ps(result, value);
+	v = {result[0], result[1], result[2]};
+}
+
+// 内積
+inline float Dot(__m128 a, __m128 b) {
+	__m128 product = _mm_mul_ps(a, b);
+	__m128 sum = _mm_add_ps(product, _mm_movehl_ps(product, product));
+	sum = _mm_add_ss(sum, _mm_shuffle_ps(sum, sum, _MM_SHUFFLE(1, 1, 1, 1)));
+	return _mm_cvtss_f32(sum);
+}
+
+// クロス積
+inline __m128 Cross(__m128 a, __m128 b) {
+	__m128 aYzx = _mm_shuffle_ps(a, a, _MM_SHUFFLE(3, 0, 2, 1));
+	__m128 bYzx = _mm_shuffle_ps(b, b, _MM_SHUFFLE(3, 0, 2, 1));
+	__m128 c = _mm_sub_ps(_mm_mul_ps(a, bYzx), _mm_mul_ps(aYzx, b));
+	return _mm_shuffle_ps(c, c, _MM_SHUFFLE(3, 0, 2, 1));
+}
+
+// 正規化（長さ0なら0のまま）
+inline __m128 Normalize(__m128 v) {
+	float lengthSq = Dot(v, v);
+	if (lengthSq <= 0.0f) {
+		return _mm_setzero_ps();
+	}
+	return _mm_mul_ps(v, _mm_set1_ps(1.0f / std::sqrt(lengthSq)));
+}
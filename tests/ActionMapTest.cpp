@@ -0,0 +1,235 @@
+﻿#include "ActionMap.h"
+#include "TestUtility.h"
+#include <algorithm>
+#include <random>
+#include <string>
+#include <vector>
+
+namespace {
+
+using Snapshot = InputSnapshot;
+
+// キー番号（DirectInput）
+const uint8_t kKeyLeftControl = 0x1d;
+const uint8_t kKeyA = 0x1e;
+const uint8_t kKeyS = 0x1f;
+const uint8_t kKeyD = 0x20;
+const uint8_t kKeySpace = 0x39;
+// XInputの左トリガー
+const uint32_t kPadLeftTrigger = 16;
+
+// 全キーの状態からフレームの入力を作る
+Snapshot MakeSnapshot(const uint8_t* keys) {
+	Snapshot snapshot;
+	snapshot.Clear();
+	snapshot.SetKeys(keys);
+	return snapshot;
+}
+
+// Ctrl+SではSのアクションもCtrlのアクションも動かない
+void TestChord() {
+	ActionMap map;
+	uint32_t save = map.CreateAction("Save");
+	uint32_t s = map.CreateAction("S");
+	uint32_t control = map.CreateAction("Control");
+	CHECK(map.CreateAction("Save") == save);
+	CHECK(map.FindAction("S") == s);
+	CHECK(map.FindAction("Load") == ActionMap::kInvalidAction);
+	map.Bind(save, {Snapshot::Key(kKeyLeftControl), Snapshot::Key(kKeyS)});
+	map.Bind(s, {Snapshot::Key(kKeyS)});
+	map.Bind(control, {Snapshot::Key(kKeyLeftControl)});
+
+	uint8_t keys[256] = {};
+	keys[kKeyS] = 0x80;
+	map.Update(MakeSnapshot(keys));
+	CHECK(map.IsPressed(s) && map.IsTriggered(s));
+	CHECK(!map.IsPressed(save));
+
+	keys[kKeyLeftControl] = 0x80;
+	map.Update(MakeSnapshot(keys));
+	CHECK(map.IsPressed(save) && map.IsTriggered(save));
+	CHECK(!map.IsPressed(s) && map.IsReleased(s));
+	CHECK(!map.IsPressed(control));
+
+	keys[kKeyS] = 0;
+	map.Update(MakeSnapshot(keys));
+	CHECK(!map.IsPressed(save) && map.IsReleased(save));
+	CHECK(map.IsPressed(control) && map.IsTriggered(control));
+}
+
+// 値は成立しているコードと軸の和になり、軸は閾値を超えたら押しているとみなす
+void TestValueAndAxis() {
+	ActionMap map;
+	uint32_t move = map.CreateAction("Move");
+	map.Bind(move, {Snapshot::Key(kKeyA)}, -1.0f);
+	map.Bind(move, {Snapshot::Key(kKeyD)}, 1.0f);
+	const uint32_t axis = Snapshot::PadAxisIndex(0, Snapshot::kLeftX);
+	map.BindAxis(move, axis);
+
+	uint8_t keys[256] = {};
+	keys[kKeyA] = 0x80;
+	map.Update(MakeSnapshot(keys));
+	CHECK(map.GetValue(move) == -1.0f && map.IsPressed(move));
+	// 両方押すと打ち消し合うが、押してはいる
+	keys[kKeyD] = 0x80;
+	map.Update(MakeSnapshot(keys));
+	CHECK(map.GetValue(move) == 0.0f && map.IsPressed(move));
+
+	keys[kKeyA] = 0;
+	keys[kKeyD] = 0;
+	Snapshot snapshot = MakeSnapshot(keys);
+	snapshot.axes[axis] = 0.3f;
+	map.Update(snapshot);
+	CHECK(map.GetValue(move) == 0.3f && !map.IsPressed(move));
+	snapshot.axes[axis] = -0.7f;
+	map.Update(snapshot);
+	CHECK(map.GetValue(move) == -0.7f && map.IsPressed(move) && map.IsTriggered(move));
+}
+
+// パッドとマウスのボタンも同じように割り当てられる
+void TestPadAndMouse() {
+	ActionMap map;
+	uint32_t fire = map.CreateAction("Fire");
+	map.Bind(fire, {Snapshot::Pad(0, kPadLeftTrigger)});
+	map.Bind(fire, {Snapshot::Mouse(0)});
+
+	Snapshot snapshot;
+	snapshot.Clear();
+	snapshot.SetButton(Snapshot::Pad(0, kPadLeftTrigger), true);
+	map.Update(snapshot);
+	CHECK(map.IsTriggered(fire));
+	// もう1つ押しても押したまま（トリガーは出ない）
+	snapshot.SetButton(Snapshot::Mouse(0), true);
+	map.Update(snapshot);
+	CHECK(map.IsPressed(fire) && !map.IsTriggered(fire));
+	// 別のパッドのボタンでは動かない
+	snapshot.Clear();
+	snapshot.SetButton(Snapshot::Pad(1, kPadLeftTrigger), true);
+	map.Update(snapshot);
+	CHECK(!map.IsPressed(fire) && map.IsReleased(fire));
+}
+
+// 押されたボタンを探して割り当て直す
+void TestRebind() {
+	ActionMap map;
+	uint32_t jump = map.CreateAction("Jump");
+	uint32_t binding = map.Bind(jump, {Snapshot::Key(kKeyS)});
+
+	uint8_t keys[256] = {};
+	map.Update(MakeSnapshot(keys));
+	InputCode code;
+	CHECK(!map.FindTriggeredCode(code));
+	keys[kKeySpace] = 0x80;
+	map.Update(MakeSnapshot(keys));
+	CHECK(map.FindTriggeredCode(code) && code == Snapshot::Key(kKeySpace));
+	CHECK(!map.IsPressed(jump));
+
+	map.Rebind(binding, {code});
+	CHECK(map.GetChord(binding).size() == 1 && map.GetChord(binding)[0] == code);
+	map.Update(MakeSnapshot(keys));
+	CHECK(!map.FindTriggeredCode(code));
+	CHECK(map.IsPressed(jump) && map.IsTriggered(jump));
+
+	map.ClearBindings(jump);
+	map.Update(MakeSnapshot(keys));
+	CHECK(!map.IsPressed(jump) && map.IsReleased(jump));
+	CHECK(map.GetChord(binding).empty());
+}
+
+// 全キーをまとめて詰めても、1つずつ調べた結果と一致する
+void TestSetKeys() {
+	std::mt19937 random(1);
+	uint32_t wrongCount = 0;
+	for (int i = 0; i < 1000; i++) {
+		uint8_t keys[256];
+		for (uint8_t& key : keys) {
+			key = random() % 2 ? 0x80 : static_cast<uint8_t>(random() & 0x7f);
+		}
+		Snapshot snapshot = MakeSnapshot(keys);
+		for (uint32_t key = 0; key < 256; key++) {
+			wrongCount += snapshot.IsPressed(Snapshot::Key(static_cast<uint8_t>(key))) !=
+			              ((keys[key] & 0x80) != 0);
+		}
+	}
+	CHECK(wrongCount == 0);
+}
+
+// ランダムな割り当てで、ボタン数の多い順に1つずつ判定する参照実装と一致する
+void TestRandomChords() {
+	const uint32_t kActionCount = 20;
+	const uint32_t kBindingCount = 40;
+	std::mt19937 random(2);
+	uint32_t wrongCount = 0;
+	for (int repeat = 0; repeat < 200; repeat++) {
+		ActionMap map;
+		for (uint32_t i = 0; i < kActionCount; i++) {
+			map.CreateAction(std::to_string(i));
+		}
+		// 少ない種類のボタンから選んで、重なりを多くする
+		std::vector<std::vector<InputCode>> chords(kBindingCount);
+		std::vector<uint32_t> actions(kBindingCount);
+		for (uint32_t i = 0; i < kBindingCount; i++) {
+			for (uint32_t j = 0, count = 1 + random() % 3; j < count; j++) {
+				chords[i].push_back(static_cast<InputCode>(random() % 8 * 50));
+			}
+			actions[i] = random() % kActionCount;
+			map.Bind(actions[i], chords[i]);
+			// 同じボタンを重ねて書いても1つとして数える
+			std::sort(chords[i].begin(), chords[i].end());
+			chords[i].erase(std::unique(chords[i].begin(), chords[i].end()), chords[i].end());
+		}
+
+		for (int frame = 0; frame < 20; frame++) {
+			Snapshot snapshot;
+			snapshot.Clear();
+			for (InputCode code = 0; code < 8 * 50; code += 50) {
+				snapshot.SetButton(code, random() % 2 != 0);
+			}
+			map.Update(snapshot);
+
+			// 成立したコードより短く、ボタンを共有するコードは成立させない
+			std::vector<bool> pressed(kActionCount, false);
+			std::vector<bool> fired(kBindingCount, false);
+			for (size_t length = 3; length >= 1; length--) {
+				for (uint32_t i = 0; i < kBindingCount; i++) {
+					if (chords[i].size() != length) {
+						continue;
+					}
+					bool held = std::all_of(chords[i].begin(), chords[i].end(), [&](InputCode c) {
+						return snapshot.IsPressed(c);
+					});
+					bool suppressed = false;
+					for (uint32_t j = 0; j < kBindingCount; j++) {
+						if (!fired[j] || chords[j].size() <= length) {
+							continue;
+						}
+						const std::vector<InputCode>& longer = chords[j];
+						for (InputCode code : chords[i]) {
+							suppressed |= std::binary_search(longer.begin(), longer.end(), code);
+						}
+					}
+					if (held && !suppressed) {
+						pressed[actions[i]] = true;
+						fired[i] = true;
+					}
+				}
+			}
+			for (uint32_t i = 0; i < kActionCount; i++) {
+				wrongCount += pressed[i] != map.IsPressed(i);
+			}
+		}
+	}
+	CHECK(wrongCount == 0);
+}
+
+} // namespace
+
+int main() {
+	TestChord();
+	TestValueAndAxis();
+	TestPadAndMouse();
+	TestRebind();
+	TestSetKeys();
+	TestRandomChords();
+	return Test::Finish("ActionMapTest");
+}
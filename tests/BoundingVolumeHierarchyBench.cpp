@@ -0,0 +1,91 @@
+﻿#include "BoundingVolumeHierarchy.h"
+#include "TestMath.h"
+#include "TestUtility.h"
+#include <random>
+#include <vector>
+
+// 10万オブジェクトでの構築、再フィット、問い合わせの時間を測る
+
+int main() {
+	const uint32_t kObjectCount = 100000;
+	const uint32_t kQueryCount = 10000;
+	std::mt19937 random(1);
+	std::uniform_real_distribution<float> position(-500.0f, 500.0f);
+	std::uniform_real_distribution<float> size(0.5f, 3.0f);
+
+	BoundingVolumeHierarchy bvh;
+	std::vector<BoundingVolumeHierarchy::Handle> handles(kObjectCount);
+	std::vector<AABB> bounds(kObjectCount);
+	for (uint32_t i = 0; i < kObjectCount; i++) {
+		Vector3 center = {position(random), position(random), position(random)};
+		float halfSize = size(random);
+		bounds[i] = {
+		  {center.x - halfSize, center.y - halfSize, center.z - halfSize},
+		  {center.x + halfSize, center.y + halfSize, center.z + halfSize}};
+		handles[i] = bvh.Insert(bounds[i], i);
+	}
+
+	double build = Test::MeasureMicroseconds(5, [&] { bvh.Build(); });
+	std::printf(
+	  "build   %u objects: %.2f ms (%u nodes)\n", kObjectCount, build / 1000.0,
+	  bvh.GetStatistics().nodeCount);
+
+	// 1割を少し動かして再フィット
+	double refit = Test::MeasureMicroseconds(5, [&] {
+		for (uint32_t i = 0; i < kObjectCount; i += 10) {
+			bounds[i].min.x += 0.1f;
+			bounds[i].max.x += 0.1f;
+			bvh.Move(handles[i], bounds[i]);
+		}
+		bvh.Refit();
+	});
+	std::printf("refit   10%% moved: %.3f ms (including Move)\n", refit / 1000.0);
+
+	std::vector<BoundingVolumeHierarchy::Handle> results;
+	std::vector<AABB> boxes(kQueryCount);
+	for (AABB& box : boxes) {
+		Vector3 center = {position(random), position(random), position(random)};
+		box = {
+		  {center.x - 10.0f, center.y - 10.0f, center.z - 10.0f},
+		  {center.x + 10.0f, center.y + 10.0f, center.z + 10.0f}};
+	}
+	size_t hitCount = 0;
+	double aabb = Test::MeasureMicroseconds(3, [&] {
+		hitCount = 0;
+		for (const AABB& box : boxes) {
+			results.clear();
+			bvh.QueryAABB(box, results);
+			hitCount += results.size();
+		}
+	});
+	std::printf(
+	  "aabb    %.0f queries/ms (%.1f hits/query)\n", kQueryCount / (aabb / 1000.0),
+	  static_cast<double>(hitCount) / kQueryCount);
+
+	double sphere = Test::MeasureMicroseconds(3, [&] {
+		for (const AABB& box : boxes) {
+			results.clear();
+			bvh.QuerySphere({box.min, 10.0f}, results);
+		}
+	});
+	std::printf("sphere  %.0f queries/ms\n", kQueryCount / (sphere / 1000.0));
+
+	double ray = Test::MeasureMicroseconds(3, [&] {
+		for (const AABB& box : boxes) {
+			BoundingVolumeHierarchy::RaycastHit hit;
+			bvh.Raycast(box.min, Normalize(box.max), 300.0f, hit);
+		}
+	});
+	std::printf("ray     %.0f rays/ms\n", kQueryCount / (ray / 1000.0));
+
+	Matrix4x4 viewProjection = Multiply(
+	  Test::MakeLookAt({0.0f, 0.0f, -600.0f}, {0.0f, 0.0f, 0.0f}, {0.0f, 1.0f, 0.0f}),
+	  Test::MakePerspective(0.8f, 16.0f / 9.0f, 0.1f, 1000.0f));
+	Frustum frustum = MakeFrustum(viewProjection);
+	double frustumTime = Test::MeasureMicroseconds(10, [&] {
+		results.clear();
+		bvh.QueryFrustum(frustum, results);
+	});
+	std::printf("frustum %.3f ms (%zu visible)\n", frustumTime / 1000.0, results.size());
+	return 0;
+}
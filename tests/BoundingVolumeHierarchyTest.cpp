@@ -0,0 +1,218 @@
+﻿#include "BoundingVolumeHierarchy.h"
+#include "TestMath.h"
+#include "TestUtility.h"
+#include <algorithm>
+#include <random>
+#include <vector>
+
+namespace {
+
+using Handle = BoundingVolumeHierarchy::Handle;
+
+// 登録したオブジェクト（総当たりで答えを出す用）
+struct Entry {
+	Handle handle;
+	AABB bounds;
+};
+
+bool Overlaps(const AABB& a, const AABB& b) {
+	return a.min.x <= b.max.x && a.max.x >= b.min.x && a.min.y <= b.max.y &&
+	       a.max.y >= b.min.y && a.min.z <= b.max.z && a.max.z >= b.min.z;
+}
+
+bool Overlaps(const Sphere& sphere, const AABB& box) {
+	Vector3 closest = Min(Max(sphere.center, box.min), box.max);
+	Vector3 offset = Subtract(closest, sphere.center);
+	return Dot(offset, offset) <= sphere.radius * sphere.radius;
+}
+
+// レイとAABBの交差（スラブ法）。当たれば始点からの距離を返す
+bool IntersectRay(
+  const Vector3& origin, const Vector3& direction, float maxDistance, const AABB& box,
+  float& distance) {
+	const float* o = &origin.x;
+	const float* d = &direction.x;
+	const float* lower = &box.min.x;
+	const float* upper = &box.max.x;
+	float tNear = 0.0f;
+	float tFar = maxDistance;
+	for (int axis = 0; axis < 3; axis++) {
+		float inverse = 1.0f / d[axis];
+		float t0 = (lower[axis] - o[axis]) * inverse;
+		float t1 = (upper[axis] - o[axis]) * inverse;
+		tNear = (std::max)(tNear, (std::min)(t0, t1));
+		tFar = (std::min)(tFar, (std::max)(t0, t1));
+	}
+	distance = tNear;
+	return tNear <= tFar;
+}
+
+AABB MakeBox(const Vector3& center, float halfSize) {
+	return {
+	  {center.x - halfSize, center.y - halfSize, center.z - halfSize},
+	  {center.x + halfSize, center.y + halfSize, center.z + halfSize}};
+}
+
+// 問い合わせの結果と総当たりの結果が一致するか
+template<class Predicate>
+bool MatchesBruteForce(
+  const std::vector<Entry>& entries, std::vector<Handle> results, const Predicate& predicate) {
+	std::vector<Handle> expected;
+	for (const Entry& entry : entries) {
+		if (predicate(entry.bounds)) {
+			expected.push_back(entry.handle);
+		}
+	}
+	std::sort(results.begin(), results.end());
+	std::sort(expected.begin(), expected.end());
+	return results == expected;
+}
+
+// 全ての問い合わせを総当たりと比べる
+void CheckQueries(
+  const BoundingVolumeHierarchy& bvh, const std::vector<Entry>& entries, std::mt19937& random) {
+	std::uniform_real_distribution<float> position(-120.0f, 120.0f);
+	std::uniform_real_distribution<float> size(1.0f, 30.0f);
+	std::vector<Handle> results;
+
+	for (int i = 0; i < 50; i++) {
+		AABB box = MakeBox({position(random), position(random), position(random)}, size(random));
+		results.clear();
+		bvh.QueryAABB(box, results);
+		CHECK(MatchesBruteForce(
+		  entries, results, [&](const AABB& bounds) { return Overlaps(box, bounds); }));
+
+		Sphere sphere = {{position(random), position(random), position(random)}, size(random)};
+		results.clear();
+		bvh.QuerySphere(sphere, results);
+		CHECK(MatchesBruteForce(
+		  entries, results, [&](const AABB& bounds) { return Overlaps(sphere, bounds); }));
+	}
+
+	for (int i = 0; i < 10; i++) {
+		Vector3 eye = {position(random), position(random), position(random)};
+		Vector3 target = {position(random), position(random), position(random)};
+		Matrix4x4 viewProjection = Multiply(
+		  Test::MakeLookAt(eye, target, {0.0f, 1.0f, 0.0f}),
+		  Test::MakePerspective(0.8f, 16.0f / 9.0f, 0.1f, 150.0f));
+		Frustum frustum = MakeFrustum(viewProjection);
+		results.clear();
+		bvh.QueryFrustum(frustum, results);
+		CHECK(MatchesBruteForce(
+		  entries, results, [&](const AABB& bounds) { return IsVisible(frustum, bounds); }));
+	}
+
+	for (int i = 0; i < 50; i++) {
+		Vector3 origin = {position(random), position(random), position(random)};
+		Vector3 direction =
+		  Normalize({position(random), position(random), position(random)});
+		const float maxDistance = 200.0f;
+		float bestDistance = maxDistance;
+		bool expectHit = false;
+		for (const Entry& entry : entries) {
+			float distance;
+			if (IntersectRay(origin, direction, bestDistance, entry.bounds, distance)) {
+				bestDistance = distance;
+				expectHit = true;
+			}
+		}
+		BoundingVolumeHierarchy::RaycastHit hit;
+		bool isHit = bvh.Raycast(origin, direction, maxDistance, hit);
+		CHECK(isHit == expectHit);
+		if (isHit && expectHit) {
+			CHECK_NEAR(hit.distance, bestDistance, 1e-3f);
+		}
+	}
+}
+
+// 登録、削除、移動を繰り返しても、問い合わせは総当たりと一致する
+void TestRandomOperations() {
+	std::mt19937 random(1);
+	std::uniform_real_distribution<float> position(-100.0f, 100.0f);
+	std::uniform_real_distribution<float> size(0.2f, 3.0f);
+	std::uniform_real_distribution<float> step(-2.0f, 2.0f);
+
+	BoundingVolumeHierarchy bvh;
+	std::vector<Entry> entries;
+	for (uint32_t i = 0; i < 3000; i++) {
+		AABB box = MakeBox({position(random), position(random), position(random)}, size(random));
+		entries.push_back({bvh.Insert(box, i), box});
+	}
+	// 構築前（全て未構築）でも問い合わせられる
+	CheckQueries(bvh, entries, random);
+	bvh.Update();
+	CHECK(bvh.GetStatistics().pendingCount == 0);
+	CheckQueries(bvh, entries, random);
+
+	for (int frame = 0; frame < 8; frame++) {
+		// 一部を動かす
+		for (size_t i = frame % 3; i < entries.size(); i += 3) {
+			Entry& entry = entries[i];
+			Vector3 offset = {step(random), step(random), step(random)};
+			entry.bounds.min = Add(entry.bounds.min, offset);
+			entry.bounds.max = Add(entry.bounds.max, offset);
+			bvh.Move(entry.handle, entry.bounds);
+		}
+		// 一部を消して、新しく登録する
+		for (int i = 0; i < 40; i++) {
+			size_t index = random() % entries.size();
+			bvh.Remove(entries[index].handle);
+			entries[index] = entries.back();
+			entries.pop_back();
+		}
+		for (int i = 0; i < 50; i++) {
+			AABB box =
+			  MakeBox({position(random), position(random), position(random)}, size(random));
+			entries.push_back({bvh.Insert(box, 100000 + i), box});
+		}
+		// 未構築や移動後のオブジェクトが残った状態と、Update後の両方を調べる
+		CheckQueries(bvh, entries, random);
+		bvh.Update();
+		CheckQueries(bvh, entries, random);
+	}
+	CHECK(bvh.GetStatistics().objectCount == entries.size());
+}
+
+// 削除したハンドルは無効になり、再利用されても古いハンドルでは引けない
+void TestHandles() {
+	BoundingVolumeHierarchy bvh;
+	Handle first = bvh.Insert(MakeBox({0.0f, 0.0f, 0.0f}, 1.0f), 7);
+	CHECK(bvh.GetUserData(first) == 7);
+	bvh.Update();
+	bvh.Remove(first);
+	bvh.Build();
+	Handle second = bvh.Insert(MakeBox({5.0f, 0.0f, 0.0f}, 1.0f), 8);
+	CHECK(second != first);
+	CHECK(bvh.GetUserData(second) == 8);
+
+	std::vector<Handle> results;
+	bvh.QueryAABB(MakeBox({0.0f, 0.0f, 0.0f}, 10.0f), results);
+	CHECK(results.size() == 1 && results[0] == second);
+}
+
+// ローカルAABBとワールド行列から登録すると、変換後のAABBで引ける
+void TestTransformedInsert() {
+	BoundingVolumeHierarchy bvh;
+	AABB local = MakeBox({0.0f, 0.0f, 0.0f}, 1.0f);
+	Matrix4x4 world =
+	  Multiply(Test::MakeScale({2.0f, 2.0f, 2.0f}), Test::MakeTranslation({50.0f, 0.0f, 0.0f}));
+	Handle handle = bvh.Insert(local, world);
+	const AABB& bounds = bvh.GetBounds(handle);
+	CHECK_NEAR(bounds.min.x, 48.0f, 1e-4f);
+	CHECK_NEAR(bounds.max.x, 52.0f, 1e-4f);
+
+	bvh.Move(handle, local, Test::MakeTranslation({-50.0f, 0.0f, 0.0f}));
+	bvh.Update();
+	std::vector<Handle> results;
+	bvh.QuerySphere({{-50.0f, 0.0f, 0.0f}, 0.5f}, results);
+	CHECK(results.size() == 1);
+}
+
+} // namespace
+
+int main() {
+	TestRandomOperations();
+	TestHandles();
+	TestTransformedInsert();
+	return Test::Finish("BoundingVolumeHierarchyTest");
+}
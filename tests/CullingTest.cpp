@@ -0,0 +1,189 @@
+﻿#include "Culling.h"
+#include "JobSystem.h"
+#include "TestMath.h"
+#include "TestUtility.h"
+#include <random>
+#include <vector>
+
+namespace {
+
+// 基準の視錐台（原点から斜め前を見るカメラ）
+Matrix4x4 MakeViewProjection() {
+	Matrix4x4 view =
+	  Test::MakeLookAt({3.0f, 2.0f, -10.0f}, {0.0f, 0.0f, 20.0f}, {0.0f, 1.0f, 0.0f});
+	Matrix4x4 projection = Test::MakePerspective(0.8f, 16.0f / 9.0f, 0.5f, 100.0f);
+	return Multiply(view, projection);
+}
+
+// 平面までの符号付き距離
+float Distance(const Vector4& plane, const Vector3& point) {
+	return plane.x * point.x + plane.y * point.y + plane.z * point.z + plane.w;
+}
+
+// 境界ボックスが最も内側に入り込む平面との余裕（負なら外）
+float GetMargin(const Frustum& frustum, const Vector3& center, const Vector3& extent) {
+	float margin = 1.0e30f;
+	for (const Vector4& plane : frustum.planes) {
+		float radius = std::fabs(plane.x) * extent.x + std::fabs(plane.y) * extent.y +
+		               std::fabs(plane.z) * extent.z;
+		margin = (std::min)(margin, Distance(plane, center) + radius);
+	}
+	return margin;
+}
+
+// 抽出した平面がクリップ空間の判定（-w<=x,y<=w、0<=z<=w）と一致する
+void TestMakeFrustum() {
+	Matrix4x4 viewProjection = MakeViewProjection();
+	Frustum frustum = MakeFrustum(viewProjection);
+	for (const Vector4& plane : frustum.planes) {
+		CHECK_NEAR(Length({plane.x, plane.y, plane.z}), 1.0f, 1e-5f);
+	}
+	// 近平面の法線はカメラの向き、遠平面はその逆
+	Vector3 forward = Normalize(Vector3{-3.0f, -2.0f, 30.0f});
+	const Vector4& nearPlane = frustum.planes[Frustum::kNear];
+	const Vector4& farPlane = frustum.planes[Frustum::kFar];
+	CHECK_NEAR(Dot({nearPlane.x, nearPlane.y, nearPlane.z}, forward), 1.0f, 1e-4f);
+	CHECK_NEAR(Dot({farPlane.x, farPlane.y, farPlane.z}, forward), -1.0f, 1e-4f);
+
+	std::mt19937 random(1);
+	std::uniform_real_distribution<float> coordinate(-60.0f, 60.0f);
+	uint32_t insideCount = 0;
+	uint32_t wrongCount = 0;
+	for (uint32_t i = 0; i < 100000; i++) {
+		Vector3 point = {coordinate(random), coordinate(random), coordinate(random) + 50.0f};
+		const auto& m = viewProjection.m;
+		float clip[4];
+		for (int c = 0; c < 4; c++) {
+			clip[c] = point.x * m[0][c] + point.y * m[1][c] + point.z * m[2][c] + m[3][c];
+		}
+		bool clipInside = -clip[3] <= clip[0] && clip[0] <= clip[3] && -clip[3] <= clip[1] &&
+		                  clip[1] <= clip[3] && 0.0f <= clip[2] && clip[2] <= clip[3];
+		float margin = 1.0e30f;
+		for (const Vector4& plane : frustum.planes) {
+			margin = (std::min)(margin, Distance(plane, point));
+		}
+		// 境界上の丸め誤差は数えない
+		if (std::fabs(margin) < 1e-3f) {
+			continue;
+		}
+		insideCount += clipInside;
+		wrongCount += clipInside != (margin >= 0.0f);
+	}
+	CHECK(wrongCount == 0);
+	CHECK(insideCount > 1000);
+}
+
+// SIMDの一括判定が、1個ずつのAABB判定と一致する
+void TestCullBoxes() {
+	Frustum frustum = MakeFrustum(MakeViewProjection());
+	std::mt19937 random(2);
+	std::uniform_real_distribution<float> coordinate(-60.0f, 60.0f);
+	std::uniform_real_distribution<float> size(0.0f, 8.0f);
+	// 4の倍数でない数にして端数の処理も通す
+	const uint32_t kCount = 10003;
+	std::vector<float> centerX(kCount), centerY(kCount), centerZ(kCount);
+	std::vector<float> extentX(kCount), extentY(kCount), extentZ(kCount);
+	for (uint32_t i = 0; i < kCount; i++) {
+		centerX[i] = coordinate(random);
+		centerY[i] = coordinate(random);
+		centerZ[i] = coordinate(random) + 50.0f;
+		extentX[i] = size(random);
+		extentY[i] = size(random);
+		extentZ[i] = size(random);
+	}
+	std::vector<uint8_t> visibility(kCount, 2);
+	uint32_t visibleCount = FrustumCuller::CullBoxes(
+	  frustum, centerX.data(), centerY.data(), centerZ.data(), extentX.data(), extentY.data(),
+	  extentZ.data(), kCount, visibility.data());
+
+	uint32_t countedVisible = 0;
+	uint32_t wrongCount = 0;
+	for (uint32_t i = 0; i < kCount; i++) {
+		countedVisible += visibility[i];
+		Vector3 center = {centerX[i], centerY[i], centerZ[i]};
+		Vector3 extent = {extentX[i], extentY[i], extentZ[i]};
+		bool expected = IsVisible(frustum, AABB{Subtract(center, extent), Add(center, extent)});
+		// 演算順の違いによる境界上の差は数えない
+		if (std::fabs(GetMargin(frustum, center, extent)) < 1e-3f) {
+			continue;
+		}
+		wrongCount += visibility[i] > 1 || (visibility[i] != 0) != expected;
+	}
+	CHECK(wrongCount == 0);
+	CHECK(visibleCount == countedVisible);
+	CHECK(visibleCount > kCount / 20 && visibleCount < kCount - kCount / 20);
+
+	// 球を箱として判定すると、球の判定で見えるものは必ず見える（安全側に倒れる）
+	uint32_t missedCount = 0;
+	for (uint32_t i = 0; i < kCount; i++) {
+		Sphere sphere = {{centerX[i], centerY[i], centerZ[i]}, extentX[i]};
+		uint8_t box = 0;
+		FrustumCuller::CullBoxes(
+		  frustum, &centerX[i], &centerY[i], &centerZ[i], &extentX[i], &extentX[i], &extentX[i],
+		  1, &box);
+		missedCount += IsVisible(frustum, sphere) && box == 0;
+	}
+	CHECK(missedCount == 0);
+}
+
+// 溜めた境界の一括判定（閾値を超えるとジョブシステムで分割する）
+void TestFrustumCuller() {
+	Frustum frustum = MakeFrustum(MakeViewProjection());
+	std::mt19937 random(3);
+	std::uniform_real_distribution<float> coordinate(-60.0f, 60.0f);
+	std::uniform_real_distribution<float> size(0.0f, 4.0f);
+
+	JobSystem::GetInstance()->Initialize(3);
+	FrustumCuller culler;
+	for (uint32_t count : {100u, FrustumCuller::kParallelThreshold * 3 + 7}) {
+		culler.Clear();
+		std::vector<Sphere> spheres;
+		std::vector<AABB> boxes;
+		for (uint32_t i = 0; i < count; i++) {
+			Vector3 center = {coordinate(random), coordinate(random), coordinate(random) + 50.0f};
+			if (i % 2 == 0) {
+				spheres.push_back({center, size(random)});
+				CHECK(culler.AddSphere(spheres.back()) == i);
+			} else {
+				Vector3 extent = {size(random), size(random), size(random)};
+				boxes.push_back({Subtract(center, extent), Add(center, extent)});
+				CHECK(culler.AddAABB(boxes.back()) == i);
+			}
+		}
+		CHECK(culler.GetCount() == count);
+		uint32_t visibleCount = culler.Cull(frustum);
+		CHECK(culler.GetCulledCount() == count - visibleCount);
+
+		uint32_t countedVisible = 0;
+		uint32_t wrongCount = 0;
+		for (uint32_t i = 0; i < count; i++) {
+			countedVisible += culler.IsVisible(i);
+			const AABB* box = i % 2 ? &boxes[i / 2] : nullptr;
+			Vector3 center, extent;
+			if (box) {
+				center = Multiply(0.5f, Add(box->min, box->max));
+				extent = Multiply(0.5f, Subtract(box->max, box->min));
+			} else {
+				const Sphere& sphere = spheres[i / 2];
+				center = sphere.center;
+				extent = {sphere.radius, sphere.radius, sphere.radius};
+			}
+			float margin = GetMargin(frustum, center, extent);
+			if (std::fabs(margin) >= 1e-3f) {
+				wrongCount += culler.IsVisible(i) != (margin >= 0.0f);
+			}
+		}
+		CHECK(wrongCount == 0);
+		CHECK(countedVisible == visibleCount);
+	}
+	JobSystem::GetInstance()->Finalize();
+}
+
+} // namespace
+
+int main() {
+	TestMakeFrustum();
+	TestCullBoxes();
+	TestFrustumCuller();
+	return Test::Finish("CullingTest");
+}
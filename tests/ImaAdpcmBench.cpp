@@ -0,0 +1,42 @@
+﻿#include "ImaAdpcm.h"
+#include "TestUtility.h"
+#include <cmath>
+#include <vector>
+
+// 10秒の波形を圧縮・展開する時間と、圧縮による波形データの削減量を測る
+
+int main() {
+	const size_t kFrameCount = 44100 * 10;
+	for (uint32_t channels : {1u, 2u}) {
+		std::vector<int16_t> samples(kFrameCount * channels);
+		for (size_t i = 0; i < kFrameCount; i++) {
+			for (uint32_t c = 0; c < channels; c++) {
+				float t = static_cast<float>(i);
+				samples[i * channels + c] = static_cast<int16_t>(
+				  12000.0f * std::sin(t * 0.031f * static_cast<float>(c + 1)) +
+				  6000.0f * std::sin(t * 0.0071f));
+			}
+		}
+
+		WaveFormat format;
+		std::vector<uint8_t> encoded;
+		double encode = Test::MeasureMicroseconds(1, [&] {
+			encoded = ImaAdpcm::Encode(
+			  samples.data(), kFrameCount, channels, 44100, 1024 * channels, format);
+		});
+		std::vector<int16_t> decoded(ImaAdpcm::GetDecodedSize(format, encoded.size()) / 2);
+		double decode = Test::MeasureMicroseconds(5, [&] {
+			ImaAdpcm::Decode(format, encoded.data(), encoded.size(), decoded.data());
+		});
+
+		// 読み込み時に展開するとPCMの大きさ、ストリーミングなら圧縮したままの大きさで常駐する
+		size_t pcmSize = samples.size() * sizeof(int16_t);
+		std::printf(
+		  "%u ch: pcm %zu KB, adpcm %zu KB (%.2f:1)\n", channels, pcmSize / 1024,
+		  encoded.size() / 1024, static_cast<double>(pcmSize) / encoded.size());
+		std::printf(
+		  "      encode %.1f ms, decode %.2f ms (%.0f Msamples/s, %.0fx realtime)\n",
+		  encode / 1000.0, decode / 1000.0, decoded.size() / decode, 10.0e6 / decode);
+	}
+	return 0;
+}
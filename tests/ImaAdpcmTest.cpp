@@ -0,0 +1,267 @@
+﻿#include "ImaAdpcm.h"
+#include "TestUtility.h"
+#include "WaveParser.h"
+#include "WaveStream.h"
+#include <cstring>
+#include <random>
+#include <vector>
+
+namespace {
+
+const int32_t kStepTable[89] = {
+  7,     8,     9,     10,    11,    12,    13,    14,    16,    17,    19,    21,    23,
+  25,    28,    31,    34,    37,    41,    45,    50,    55,    60,    66,    73,    80,
+  88,    97,    107,   118,   130,   143,   157,   173,   190,   209,   230,   253,   279,
+  307,   337,   371,   408,   449,   494,   544,   598,   658,   724,   796,   876,   963,
+  1060,  1166,  1282,  1411,  1552,  1707,  1878,  2066,  2272,  2499,  2749,  3024,  3327,
+  3660,  4026,  4428,  4871,  5358,  5894,  6484,  7132,  7845,  8630,  9493,  10442, 11487,
+  12635, 13899, 15289, 16818, 18500, 20350, 22385, 24623, 27086, 29794, 32767};
+const int32_t kIndexTable[16] = {-1, -1, -1, -1, 2, 4, 6, 8, -1, -1, -1, -1, 2, 4, 6, 8};
+
+// 仕様どおりに1サンプルずつ展開する参照実装（1ブロック分）
+void DecodeBlockReference(const uint8_t* block, const WaveFormat& format, int16_t* frames) {
+	uint32_t channels = format.channels;
+	uint32_t codeBytes = format.blockAlign / channels - 4;
+	for (uint32_t c = 0; c < channels; c++) {
+		const uint8_t* header = block + c * 4;
+		int32_t predictor = static_cast<int16_t>(header[0] | header[1] << 8);
+		int32_t index = (std::min)(static_cast<int32_t>(header[2]), 88);
+		frames[c] = static_cast<int16_t>(predictor);
+		uint32_t frame = 1;
+		for (uint32_t byte = 0; byte < codeBytes; byte++) {
+			uint8_t value = block[channels * 4 + (byte / 4) * channels * 4 + c * 4 + byte % 4];
+			for (uint32_t nibble = 0; nibble < 2; nibble++) {
+				int32_t code = (value >> (nibble * 4)) & 15;
+				int32_t step = kStepTable[index];
+				int32_t difference = step >> 3;
+				if (code & 1) {
+					difference += step >> 2;
+				}
+				if (code & 2) {
+					difference += step >> 1;
+				}
+				if (code & 4) {
+					difference += step;
+				}
+				if (code & 8) {
+					difference = -difference;
+				}
+				predictor = std::clamp(predictor + difference, -32768, 32767);
+				index = std::clamp(index + kIndexTable[code], 0, 88);
+				frames[frame * channels + c] = static_cast<int16_t>(predictor);
+				frame++;
+			}
+		}
+	}
+}
+
+WaveFormat MakeFormat(uint32_t channels, uint32_t blockAlign) {
+	WaveFormat format = {};
+	format.formatTag = ImaAdpcm::kFormatTag;
+	format.channels = static_cast<uint16_t>(channels);
+	format.samplesPerSec = 44100;
+	format.blockAlign = static_cast<uint16_t>(blockAlign);
+	format.bitsPerSample = 4;
+	return format;
+}
+
+// 正弦波と雑音を混ぜた16bit PCM
+std::vector<int16_t> MakeSignal(size_t frameCount, uint32_t channels) {
+	std::mt19937 random(1);
+	std::uniform_int_distribution<int32_t> noise(-128, 127);
+	std::vector<int16_t> samples(frameCount * channels);
+	for (size_t i = 0; i < frameCount; i++) {
+		for (uint32_t c = 0; c < channels; c++) {
+			float t = static_cast<float>(i);
+			samples[i * channels + c] = static_cast<int16_t>(
+			  12000.0f * std::sin(t * 0.031f * static_cast<float>(c + 1)) +
+			  6000.0f * std::sin(t * 0.0071f) + static_cast<float>(noise(random)));
+		}
+	}
+	return samples;
+}
+
+// 展開できる形式の判定
+void TestFormat() {
+	CHECK(ImaAdpcm::IsValidFormat(MakeFormat(1, 36)));
+	CHECK(ImaAdpcm::IsValidFormat(MakeFormat(2, 2048)));
+	// チャンネル毎のバイト数が4の倍数でない、ヘッダーしかない、チャンネル数が多い
+	CHECK(!ImaAdpcm::IsValidFormat(MakeFormat(1, 34)));
+	CHECK(!ImaAdpcm::IsValidFormat(MakeFormat(1, 4)));
+	CHECK(!ImaAdpcm::IsValidFormat(MakeFormat(2, 36)));
+	CHECK(!ImaAdpcm::IsValidFormat(MakeFormat(3, 36 * 3)));
+	WaveFormat pcm = MakeFormat(1, 36);
+	pcm.formatTag = 1;
+	CHECK(!ImaAdpcm::IsValidFormat(pcm));
+
+	WaveFormat format = MakeFormat(2, 1024);
+	CHECK(ImaAdpcm::GetFramesPerBlock(format) == 1017);
+	WaveFormat decoded = ImaAdpcm::GetDecodedFormat(format);
+	CHECK(decoded.formatTag == 1 && decoded.bitsPerSample == 16 && decoded.blockAlign == 4);
+	CHECK(decoded.avgBytesPerSec == 44100 * 4);
+	// 端数のブロックは数えない
+	CHECK(ImaAdpcm::GetDecodedSize(format, 1024 * 3 + 500) == 1017 * 3 * 4);
+}
+
+// ランダムなデータ（範囲外の量子化幅の番号を含む）の展開が参照実装と一致する
+void TestDecodeMatchesReference() {
+	std::mt19937 random(2);
+	for (uint32_t channels : {1u, 2u}) {
+		for (uint32_t blockBytes : {8u, 36u, 512u, 1024u}) {
+			// ブロック数は、4チャンネル分ずつまとめる処理の端数が全て出るように選ぶ
+			for (uint32_t blockCount : {1u, 2u, 3u, 5u, 37u}) {
+				WaveFormat format = MakeFormat(channels, blockBytes * channels);
+				std::vector<uint8_t> source(format.blockAlign * blockCount + format.blockAlign / 2);
+				for (uint8_t& byte : source) {
+					byte = static_cast<uint8_t>(random());
+				}
+				uint32_t framesPerBlock = ImaAdpcm::GetFramesPerBlock(format);
+				size_t sampleCount = ImaAdpcm::GetDecodedSize(format, source.size()) / 2;
+				CHECK(sampleCount == size_t(framesPerBlock) * channels * blockCount);
+
+				std::vector<int16_t> decoded(sampleCount);
+				size_t frameCount =
+				  ImaAdpcm::Decode(format, source.data(), source.size(), decoded.data());
+				CHECK(frameCount == size_t(framesPerBlock) * blockCount);
+
+				std::vector<int16_t> expected(sampleCount);
+				for (uint32_t b = 0; b < blockCount; b++) {
+					DecodeBlockReference(
+					  source.data() + b * format.blockAlign, format,
+					  expected.data() + b * framesPerBlock * channels);
+				}
+				CHECK(decoded == expected);
+			}
+		}
+	}
+}
+
+// 圧縮して展開すると元の波形に近く、ブロックの先頭は元の値そのもの
+void TestRoundTrip() {
+	for (uint32_t channels : {1u, 2u}) {
+		const size_t frameCount = 44100;
+		std::vector<int16_t> samples = MakeSignal(frameCount, channels);
+		WaveFormat format;
+		std::vector<uint8_t> encoded = ImaAdpcm::Encode(
+		  samples.data(), frameCount, channels, 44100, 512 * channels, format);
+		CHECK(ImaAdpcm::IsValidFormat(format));
+		CHECK(format.samplesPerSec == 44100 && format.channels == channels);
+		uint32_t framesPerBlock = ImaAdpcm::GetFramesPerBlock(format);
+		size_t blockCount = (frameCount + framesPerBlock - 1) / framesPerBlock;
+		CHECK(encoded.size() == blockCount * format.blockAlign);
+		CHECK(format.avgBytesPerSec == 44100 * format.blockAlign / framesPerBlock);
+
+		std::vector<int16_t> decoded(ImaAdpcm::GetDecodedSize(format, encoded.size()) / 2);
+		ImaAdpcm::Decode(format, encoded.data(), encoded.size(), decoded.data());
+		CHECK(decoded.size() >= samples.size());
+
+		double signal = 0.0;
+		double noise = 0.0;
+		for (size_t i = 0; i < samples.size(); i++) {
+			double error = static_cast<double>(samples[i]) - decoded[i];
+			signal += static_cast<double>(samples[i]) * samples[i];
+			noise += error * error;
+		}
+		// 4bitの差分で25dB以上の音質が出ていること
+		CHECK(10.0 * std::log10(signal / noise) > 25.0);
+
+		uint32_t wrongCount = 0;
+		for (size_t frame = 0; frame < frameCount; frame += framesPerBlock) {
+			for (uint32_t c = 0; c < channels; c++) {
+				wrongCount += decoded[frame * channels + c] != samples[frame * channels + c];
+			}
+		}
+		CHECK(wrongCount == 0);
+		// 最後のブロックの足りない分は最後のサンプルに近い値で埋まる
+		CHECK(std::abs(decoded.back() - samples.back()) < 2000);
+	}
+}
+
+// ストリーミングと同じく、ブロック単位で少しずつ読んで展開しても一度に展開した結果と一致する
+void TestStreamingDecode() {
+	const uint32_t channels = 2;
+	std::vector<int16_t> samples = MakeSignal(20000, channels);
+	WaveFormat format;
+	std::vector<uint8_t> encoded =
+	  ImaAdpcm::Encode(samples.data(), 20000, channels, 44100, 256 * channels, format);
+	std::vector<int16_t> whole(ImaAdpcm::GetDecodedSize(format, encoded.size()) / 2);
+	ImaAdpcm::Decode(format, encoded.data(), encoded.size(), whole.data());
+
+	WaveStreamReader reader;
+	reader.OpenMemory(format, encoded.data(), static_cast<uint32_t>(encoded.size()));
+	// 3ブロックと少し（読み込みはブロック境界に切り捨てられる）
+	std::vector<uint8_t> buffer(format.blockAlign * 3 + 100);
+	std::vector<int16_t> streamed;
+	std::vector<int16_t> decoded;
+	for (;;) {
+		size_t size = reader.Read(buffer.data(), buffer.size(), false);
+		if (size == 0) {
+			break;
+		}
+		CHECK(size % format.blockAlign == 0);
+		decoded.resize(ImaAdpcm::GetDecodedSize(format, size) / 2);
+		ImaAdpcm::Decode(format, buffer.data(), size, decoded.data());
+		streamed.insert(streamed.end(), decoded.begin(), decoded.end());
+	}
+	CHECK(reader.IsEnd());
+	CHECK(streamed == whole);
+
+	// ループ再生では末尾の次に先頭のブロックが続く
+	reader.Rewind();
+	size_t total = 0;
+	while (total < encoded.size() + format.blockAlign) {
+		total += reader.Read(buffer.data(), format.blockAlign, true);
+	}
+	CHECK(memcmp(buffer.data(), encoded.data(), format.blockAlign) == 0);
+}
+
+// 圧縮したWAVのチャンクを読める（フレーム数はfactチャンクで切り詰める）
+void TestParseCompressedWave() {
+	std::vector<int16_t> samples = MakeSignal(3000, 1);
+	WaveFormat format;
+	std::vector<uint8_t> encoded =
+	  ImaAdpcm::Encode(samples.data(), 3000, 1, 22050, 256, format);
+	// 途中で切れたブロックを付け足す
+	encoded.resize(encoded.size() + 100, 0);
+
+	std::vector<uint8_t> file;
+	auto append = [&file](const void* data, size_t size) {
+		const uint8_t* bytes = static_cast<const uint8_t*>(data);
+		file.insert(file.end(), bytes, bytes + size);
+	};
+	auto appendChunk = [&](const char* id, uint32_t size) {
+		append(id, 4);
+		append(&size, 4);
+	};
+	// fmtチャンクはcbSizeと1ブロックのフレーム数を含む20バイト
+	uint16_t extra[2] = {2, static_cast<uint16_t>(ImaAdpcm::GetFramesPerBlock(format))};
+	uint32_t frameCount = 3000;
+	append("RIFF\0\0\0\0WAVE", 12);
+	appendChunk("fmt ", 20);
+	append(&format, sizeof(format));
+	append(extra, sizeof(extra));
+	appendChunk("fact", 4);
+	append(&frameCount, 4);
+	appendChunk("data", static_cast<uint32_t>(encoded.size()));
+	size_t dataOffset = file.size();
+	append(encoded.data(), encoded.size());
+
+	WaveInfo info;
+	CHECK(WaveParser::Parse(file.data(), file.size(), info));
+	CHECK(info.format.formatTag == ImaAdpcm::kFormatTag && info.format.samplesPerSec == 22050);
+	CHECK(info.dataOffset == dataOffset);
+	CHECK(info.dataSize == encoded.size() - 100);
+	CHECK(info.frameCount == 3000);
+	CHECK(!info.hasLoop);
+}
+
+} // namespace
+
+int main() {
+	TestFormat();
+	TestDecodeMatchesReference();
+	TestRoundTrip();
+	TestStreamingDecode();
+	TestParseCompressedWave();
+	return Test::Finish("ImaAdpcmTest");
+}
@@ -0,0 +1,166 @@
+﻿#include "InputEvent.h"
+#include "TestUtility.h"
+#include <memory>
+#include <thread>
+
+namespace {
+
+const int32_t kPressed = 0x80;
+
+InputEvent MakeKey(uint64_t time, uint8_t key, bool press) {
+	return {time, InputEventType::kKey, key, press ? kPressed : 0};
+}
+
+InputEvent MakeMouseButton(uint64_t time, uint8_t button, bool press) {
+	return {time, InputEventType::kMouseButton, button, press ? kPressed : 0};
+}
+
+InputEvent MakeMouseMove(uint64_t time, uint8_t axis, int32_t value) {
+	return {time, InputEventType::kMouseMove, axis, value};
+}
+
+// 1フレームの間に押して離したキーは、そのフレームだけ押したままになる
+void TestTapWithinFrame() {
+	InputEventQueue queue;
+	InputStateBuilder builder;
+	builder.Reset();
+	builder.BeginFrame();
+	queue.Push(MakeKey(10, 30, true));
+	queue.Push(MakeKey(12, 30, false));
+	queue.Push(MakeMouseButton(13, 1, true));
+	queue.Push(MakeMouseButton(14, 1, false));
+	CHECK(builder.ApplyAll(queue) == 4);
+	CHECK(builder.GetKeys()[30] == kPressed);
+	CHECK(builder.GetMouseButtons()[1] == kPressed);
+	CHECK(builder.GetKeyTime(30) == 12);
+	CHECK(builder.GetLastEventTime() == 14);
+
+	builder.BeginFrame();
+	CHECK(builder.GetKeys()[30] == 0);
+	CHECK(builder.GetMouseButtons()[1] == 0);
+}
+
+// 前のフレームから押しているキーは、離したイベントですぐ離れる
+void TestHoldAndRelease() {
+	InputStateBuilder builder;
+	builder.Reset();
+	builder.BeginFrame();
+	builder.Apply(MakeKey(20, 31, true));
+	builder.BeginFrame();
+	CHECK(builder.GetKeys()[31] == kPressed);
+	builder.BeginFrame();
+	CHECK(builder.GetKeys()[31] == kPressed);
+	builder.Apply(MakeKey(21, 31, false));
+	CHECK(builder.GetKeys()[31] == 0);
+
+	// 押して離してまた押したら、次のフレームも押したまま
+	builder.BeginFrame();
+	builder.Apply(MakeKey(30, 32, true));
+	builder.Apply(MakeKey(31, 32, false));
+	builder.Apply(MakeKey(32, 32, true));
+	builder.BeginFrame();
+	CHECK(builder.GetKeys()[32] == kPressed);
+
+	// Resetで全て離す
+	builder.Reset();
+	CHECK(builder.GetKeys()[32] == 0);
+}
+
+// マウスの移動量はフレーム毎に足し合わせ、範囲外の番号は無視する
+void TestMouse() {
+	InputStateBuilder builder;
+	builder.Reset();
+	builder.BeginFrame();
+	builder.Apply(MakeMouseMove(1, 0, 5));
+	builder.Apply(MakeMouseMove(2, 0, -2));
+	builder.Apply(MakeMouseMove(3, 1, 7));
+	builder.Apply(MakeMouseMove(4, 2, 120));
+	builder.Apply(MakeMouseMove(5, 9, 100));
+	builder.Apply(MakeMouseButton(6, 200, true));
+	CHECK(builder.GetMouseMove(0) == 3);
+	CHECK(builder.GetMouseMove(1) == 7);
+	CHECK(builder.GetMouseMove(2) == 120);
+	uint32_t pressedCount = 0;
+	for (uint8_t state : builder.GetMouseButtons()) {
+		pressedCount += state != 0;
+	}
+	CHECK(pressedCount == 0);
+
+	builder.BeginFrame();
+	CHECK(builder.GetMouseMove(0) == 0 && builder.GetMouseMove(2) == 0);
+}
+
+// キューは満杯なら追加できず、取り出すとまた追加できる
+void TestQueueFull() {
+	std::unique_ptr<InputEventQueue> queue = std::make_unique<InputEventQueue>();
+	CHECK(queue->GetFreeCount() == 4096);
+	uint32_t pushedCount = 0;
+	while (queue->Push(MakeKey(pushedCount, 1, true))) {
+		pushedCount++;
+	}
+	CHECK(pushedCount == 4096);
+	CHECK(queue->GetFreeCount() == 0);
+	InputEvent event;
+	CHECK(queue->Pop(event) && event.time == 0);
+	// 入力スレッドは空きを見て状態を積み直す
+	CHECK(queue->GetFreeCount() == 1);
+	CHECK(queue->Push(MakeKey(5000, 1, false)));
+	InputStateBuilder builder;
+	builder.Reset();
+	CHECK(builder.ApplyAll(*queue) == 4096);
+	CHECK(builder.GetLastEventTime() == 5000);
+}
+
+// 別スレッドから送ったイベントが、失われず順番どおりに届く
+void TestThreadedProducer() {
+	// 256キーを押すのと離すのを交互に繰り返し、離して終わる数
+	const uint32_t kEventCount = 256 * 782;
+	std::unique_ptr<InputEventQueue> queue = std::make_unique<InputEventQueue>();
+	std::thread producer([&] {
+		for (uint32_t i = 0; i < kEventCount; i++) {
+			// 時刻は通し番号
+			InputEvent event = MakeKey(i + 1, static_cast<uint8_t>(i), (i >> 8) % 2 == 0);
+			while (!queue->Push(event)) {
+				std::this_thread::yield();
+			}
+		}
+	});
+
+	InputStateBuilder builder;
+	builder.Reset();
+	uint32_t receivedCount = 0;
+	uint32_t outOfOrderCount = 0;
+	uint64_t lastTime = 0;
+	while (receivedCount < kEventCount) {
+		builder.BeginFrame();
+		InputEvent event;
+		while (queue->Pop(event)) {
+			outOfOrderCount += event.time != lastTime + 1;
+			lastTime = event.time;
+			builder.Apply(event);
+			receivedCount++;
+		}
+		std::this_thread::yield();
+	}
+	producer.join();
+	builder.BeginFrame();
+
+	CHECK(receivedCount == kEventCount);
+	CHECK(outOfOrderCount == 0);
+	uint32_t pressedCount = 0;
+	for (uint8_t state : builder.GetKeys()) {
+		pressedCount += state != 0;
+	}
+	CHECK(pressedCount == 0);
+}
+
+} // namespace
+
+int main() {
+	TestTapWithinFrame();
+	TestHoldAndRelease();
+	TestMouse();
+	TestQueueFull();
+	TestThreadedProducer();
+	return Test::Finish("InputEventTest");
+}
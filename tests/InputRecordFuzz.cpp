@@ -0,0 +1,103 @@
+﻿#include "InputRecord.h"
+#include "TestUtility.h"
+#include <cstdlib>
+#include <cstring>
+#include <random>
+#include <vector>
+
+// 正しい記録を壊したものを再生させ、範囲外を読まず、必ず読み終わることを調べる
+// ctestでは回数を抑えて実行する。引数で回数を指定できる（InputRecordFuzz 1000000 など）
+
+namespace {
+
+// 壊す元になる記録
+std::vector<uint8_t> MakeRecord(uint32_t seed) {
+	std::mt19937 random(seed);
+	InputRecorder recorder;
+	InputFrame frame;
+	for (uint32_t i = 0; i < 20; i++) {
+		frame.keys[random() % 256] ^= 0x80;
+		frame.mouseMove[0] = static_cast<int32_t>(random() % 100) - 50;
+		frame.mousePosition[1] += 1.5f;
+		if (i == 5 || i == 15) {
+			frame.joysticks.resize(frame.joysticks.empty() ? 16 + seed % 8 : 0, 0);
+		}
+		if (!frame.joysticks.empty()) {
+			frame.joysticks[random() % frame.joysticks.size()] = static_cast<uint8_t>(random());
+		}
+		recorder.Record(frame);
+	}
+	return recorder.GetData();
+}
+
+// 壊し方をランダムに選んで壊す（ヘッダーは残す）
+void Mutate(std::vector<uint8_t>& data, std::mt19937& random) {
+	const size_t kHeaderSize = 16;
+	switch (random() % 4) {
+	case 0:
+		for (uint32_t i = 0, count = 1 + random() % 8; i < count; i++) {
+			data[kHeaderSize + random() % (data.size() - kHeaderSize)] =
+			  static_cast<uint8_t>(random());
+		}
+		break;
+	case 1:
+		data.resize(kHeaderSize + random() % (data.size() - kHeaderSize + 1));
+		break;
+	case 2: {
+		// 可変長整数の続きの印を立てて、長さを極端に大きくする
+		size_t offset = kHeaderSize + random() % (data.size() - kHeaderSize);
+		for (size_t i = offset; i < data.size() && i < offset + 1 + random() % 10; i++) {
+			data[i] |= 0x80;
+		}
+		break;
+	}
+	default: {
+		// フレーム数を書き換える
+		uint32_t frameCount = random() % 2 ? 0xffffffff : static_cast<uint32_t>(random() % 40);
+		memcpy(data.data() + 8, &frameCount, sizeof(frameCount));
+		break;
+	}
+	}
+}
+
+} // namespace
+
+int main(int argc, char* argv[]) {
+	uint32_t iterationCount = argc > 1 ? static_cast<uint32_t>(std::atol(argv[1])) : 100000;
+	std::vector<std::vector<uint8_t>> seeds;
+	for (uint32_t seed = 0; seed < 8; seed++) {
+		seeds.push_back(MakeRecord(seed));
+	}
+
+	std::mt19937 random(1);
+	InputPlayer player;
+	InputFrame frame;
+	uint64_t readFrameCount = 0;
+	uint32_t tooManyCount = 0;
+	for (uint32_t i = 0; i < iterationCount; i++) {
+		std::vector<uint8_t> data = seeds[random() % seeds.size()];
+		Mutate(data, random);
+		size_t dataSize = data.size();
+		if (!player.Open(std::move(data))) {
+			continue;
+		}
+		// 1フレームは少なくとも2バイトなので、データの大きさより多くは読めない
+		uint32_t count = 0;
+		while (player.Read(frame)) {
+			count++;
+			if (count > dataSize) {
+				break;
+			}
+		}
+		tooManyCount += count > dataSize;
+		CHECK(!player.Read(frame));
+		readFrameCount += count;
+	}
+	CHECK(tooManyCount == 0);
+	// 壊しすぎて何も読めていないと調べたことにならない
+	CHECK(readFrameCount > iterationCount);
+	std::printf(
+	  "%u iterations, %llu frames read\n", iterationCount,
+	  static_cast<unsigned long long>(readFrameCount));
+	return Test::Finish("InputRecordFuzz");
+}
@@ -0,0 +1,158 @@
+﻿#include "InputRecord.h"
+#include "TestUtility.h"
+#include <cstring>
+#include <filesystem>
+#include <random>
+#include <vector>
+
+namespace {
+
+bool IsSame(const InputFrame& a, const InputFrame& b) {
+	return a.keys == b.keys && a.mouseButtons == b.mouseButtons &&
+	       memcmp(a.mouseMove, b.mouseMove, sizeof(a.mouseMove)) == 0 &&
+	       memcmp(a.mousePosition, b.mousePosition, sizeof(a.mousePosition)) == 0 &&
+	       a.joysticks == b.joysticks;
+}
+
+// 実際の操作に近い、少しずつ変わるフレーム列
+std::vector<InputFrame> MakeFrames(uint32_t count) {
+	std::mt19937 random(1);
+	std::vector<InputFrame> frames(count);
+	InputFrame frame;
+	for (uint32_t i = 0; i < count; i++) {
+		// たまにキーやボタンを押し変える
+		if (random() % 8 == 0) {
+			frame.keys[random() % 256] ^= 0x80;
+		}
+		if (random() % 16 == 0) {
+			frame.mouseButtons[random() % 8] ^= 0x80;
+		}
+		// マウスは動いたり止まったりする
+		bool moving = (i / 30) % 2 == 0;
+		frame.mouseMove[0] = moving ? static_cast<int32_t>(random() % 11) - 5 : 0;
+		frame.mouseMove[1] = moving ? static_cast<int32_t>(random() % 11) - 5 : 0;
+		frame.mouseMove[2] = random() % 50 == 0 ? 120 : 0;
+		frame.mousePosition[0] += static_cast<float>(frame.mouseMove[0]);
+		frame.mousePosition[1] += static_cast<float>(frame.mouseMove[1]);
+		// ジョイスティックはつないだり外したりする
+		if (i % 200 == 100) {
+			frame.joysticks.resize(frame.joysticks.empty() ? 40 : 0, 0);
+		}
+		if (!frame.joysticks.empty() && random() % 4 == 0) {
+			frame.joysticks[random() % frame.joysticks.size()] = static_cast<uint8_t>(random());
+		}
+		frames[i] = frame;
+	}
+	return frames;
+}
+
+// 記録したフレームをそのまま読み戻せる
+void TestRoundTrip() {
+	std::vector<InputFrame> frames = MakeFrames(1000);
+	InputRecorder recorder;
+	for (const InputFrame& frame : frames) {
+		recorder.Record(frame);
+	}
+	CHECK(recorder.GetFrameCount() == 1000);
+	std::vector<uint8_t> data = recorder.GetData();
+	// 前のフレームとの差分だけなので、1フレームあたり数十バイトに収まる
+	CHECK(data.size() < frames.size() * 32);
+
+	InputPlayer player;
+	CHECK(player.Open(data));
+	CHECK(player.GetFrameCount() == 1000);
+	uint32_t wrongCount = 0;
+	InputFrame frame;
+	for (const InputFrame& expected : frames) {
+		wrongCount += !player.Read(frame) || !IsSame(frame, expected);
+	}
+	CHECK(wrongCount == 0);
+	CHECK(player.GetFrameIndex() == 1000);
+	CHECK(!player.Read(frame));
+
+	// 最初から読み直せる
+	player.Rewind();
+	CHECK(player.Read(frame) && IsSame(frame, frames[0]));
+	CHECK(player.Read(frame) && IsSame(frame, frames[1]));
+}
+
+// 何も変わらないフレームは3バイトになる
+void TestUnchangedFrames() {
+	InputFrame frame;
+	frame.keys[10] = 0x80;
+	frame.mousePosition[0] = 100.0f;
+	InputRecorder recorder;
+	recorder.Record(frame);
+	size_t firstSize = recorder.GetData().size();
+	for (int i = 0; i < 100; i++) {
+		recorder.Record(frame);
+	}
+	// 長さ（280バイトなので2バイト）と終わりの印の3バイト
+	CHECK(recorder.GetData().size() == firstSize + 100 * 3);
+
+	recorder.Clear();
+	CHECK(recorder.GetFrameCount() == 0);
+	recorder.Record(frame);
+	CHECK(recorder.GetData().size() == firstSize);
+}
+
+// ファイルに書き出して読み込める
+void TestSaveLoad() {
+	std::string filePath =
+	  (std::filesystem::temp_directory_path() / "InputRecordTest.bin").string();
+	std::vector<InputFrame> frames = MakeFrames(300);
+	InputRecorder recorder;
+	for (const InputFrame& frame : frames) {
+		recorder.Record(frame);
+	}
+	CHECK(recorder.Save(filePath));
+
+	InputPlayer player;
+	CHECK(player.Load(filePath));
+	std::filesystem::remove(filePath);
+	uint32_t wrongCount = 0;
+	InputFrame frame;
+	for (const InputFrame& expected : frames) {
+		wrongCount += !player.Read(frame) || !IsSame(frame, expected);
+	}
+	CHECK(wrongCount == 0);
+	CHECK(!player.Load(filePath));
+}
+
+// 記録でないデータや途中で切れたデータ
+void TestInvalidData() {
+	InputPlayer player;
+	CHECK(!player.Open({}));
+	CHECK(!player.Open(std::vector<uint8_t>(16, 0)));
+
+	InputRecorder recorder;
+	for (const InputFrame& frame : MakeFrames(10)) {
+		recorder.Record(frame);
+	}
+	std::vector<uint8_t> data = recorder.GetData();
+	// 版が違う
+	std::vector<uint8_t> version = data;
+	version[4] = 2;
+	CHECK(!player.Open(version));
+
+	// 途中で切れていれば、そこまでは読めて、その先は読めない
+	data.resize(data.size() - 10);
+	CHECK(player.Open(data));
+	InputFrame frame;
+	uint32_t readCount = 0;
+	while (player.Read(frame)) {
+		readCount++;
+	}
+	CHECK(readCount < 10);
+	CHECK(!player.Read(frame));
+}
+
+} // namespace
+
+int main() {
+	TestRoundTrip();
+	TestUnchangedFrames();
+	TestSaveLoad();
+	TestInvalidData();
+	return Test::Finish("InputRecordTest");
+}
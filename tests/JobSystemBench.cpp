@@ -0,0 +1,65 @@
+﻿#include "JobSystem.h"
+#include "TestUtility.h"
+#include <cmath>
+#include <thread>
+#include <vector>
+
+// ジョブ1個あたりの投入と実行のコストと、並列forのスレッド数によるスケーリングを測る
+
+namespace {
+
+void Empty(const void*, uint32_t, uint32_t) {}
+
+// 並列forで処理する1要素分の計算
+float Work(uint32_t index) {
+	float value = static_cast<float>(index);
+	for (uint32_t i = 0; i < 64; i++) {
+		value = std::sqrt(value * 1.0001f + 1.0f);
+	}
+	return value;
+}
+
+} // namespace
+
+int main() {
+	const uint32_t kJobCount = 100000;
+	const uint32_t kElementCount = 1 << 20;
+	uint32_t hardwareCount = (std::max)(std::thread::hardware_concurrency(), 2u);
+	std::vector<float> results(kElementCount);
+
+	// 1スレッドでそのまま処理した場合
+	double serial = Test::MeasureMicroseconds(3, [&] {
+		for (uint32_t i = 0; i < kElementCount; i++) {
+			results[i] = Work(i);
+		}
+	});
+	std::printf("parallel-for %u elements: serial %.2f ms\n", kElementCount, serial / 1000.0);
+
+	std::printf("threads  job overhead(ns)  parallel-for(ms)  speedup\n");
+	for (uint32_t threadCount = 2; threadCount <= hardwareCount; threadCount++) {
+		JobSystem* jobSystem = JobSystem::GetInstance();
+		jobSystem->Initialize(threadCount - 1);
+
+		// 空のジョブを投入して全て終わるまで
+		double overhead = Test::MeasureMicroseconds(5, [&] {
+			JobSystem::Counter counter;
+			for (uint32_t i = 0; i < kJobCount; i++) {
+				jobSystem->Run(&Empty, nullptr, &counter);
+			}
+			jobSystem->Wait(counter);
+		});
+
+		double parallel = Test::MeasureMicroseconds(3, [&] {
+			jobSystem->ParallelFor(kElementCount, 1024, [&](uint32_t begin, uint32_t end) {
+				for (uint32_t i = begin; i < end; i++) {
+					results[i] = Work(i);
+				}
+			});
+		});
+		std::printf(
+		  "%7u  %16.1f  %16.2f  %7.2f\n", threadCount, overhead * 1000.0 / kJobCount,
+		  parallel / 1000.0, serial / parallel);
+		jobSystem->Finalize();
+	}
+	return 0;
+}
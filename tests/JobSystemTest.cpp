@@ -0,0 +1,165 @@
+﻿#include "JobSystem.h"
+#include "TestUtility.h"
+#include <atomic>
+#include <thread>
+#include <vector>
+
+namespace {
+
+std::atomic<bool> sRelease{false};
+std::vector<std::atomic<uint32_t>> sRunCounts(65536);
+
+void Block(const void*, uint32_t, uint32_t) {
+	while (!sRelease.load()) {
+		std::this_thread::yield();
+	}
+}
+
+void CountRun(const void*, uint32_t begin, uint32_t) { sRunCounts[begin].fetch_add(1); }
+
+// 子ジョブを投入するジョブ
+void SpawnChildren(const void* context, uint32_t begin, uint32_t end) {
+	JobSystem::Counter* counter =
+	  const_cast<JobSystem::Counter*>(static_cast<const JobSystem::Counter*>(context));
+	for (uint32_t i = begin; i < end; i++) {
+		JobSystem::GetInstance()->Run(&CountRun, nullptr, counter, i, i + 1);
+	}
+}
+
+void ResetRunCounts() {
+	for (auto& count : sRunCounts) {
+		count = 0;
+	}
+}
+
+// キューが溢れても、全てのジョブがちょうど1回ずつ実行される
+void TestQueueOverflow() {
+	JobSystem* jobSystem = JobSystem::GetInstance();
+	jobSystem->Initialize(1);
+	ResetRunCounts();
+	sRelease = false;
+
+	// ワーカーを塞いでから、キューの容量を超えて投入する
+	JobSystem::Counter blocker;
+	jobSystem->Run(&Block, nullptr, &blocker);
+	while (jobSystem->GetStatistics().stolenCount == 0) {
+		std::this_thread::yield();
+	}
+	const uint32_t jobCount = JobSystem::kJobCountPerThread + 904;
+	JobSystem::Counter counter;
+	for (uint32_t i = 0; i < jobCount; i++) {
+		jobSystem->Run(&CountRun, nullptr, &counter, i, i + 1);
+	}
+	sRelease = true;
+	jobSystem->Wait(counter);
+	jobSystem->Wait(blocker);
+
+	uint32_t wrongCount = 0;
+	for (uint32_t i = 0; i < jobCount; i++) {
+		wrongCount += sRunCounts[i] != 1;
+	}
+	CHECK(wrongCount == 0);
+	jobSystem->Finalize();
+}
+
+// ジョブから投入したジョブも、依存カウンタで待てる
+void TestNestedRun() {
+	JobSystem* jobSystem = JobSystem::GetInstance();
+	jobSystem->Initialize(3);
+	ResetRunCounts();
+
+	for (uint32_t repeat = 0; repeat < 20; repeat++) {
+		JobSystem::Counter counter;
+		for (uint32_t i = 0; i < 8; i++) {
+			jobSystem->Run(&SpawnChildren, &counter, &counter, i * 1000, i * 1000 + 1000);
+		}
+		jobSystem->Wait(counter);
+		CHECK(counter.IsDone());
+	}
+	uint32_t wrongCount = 0;
+	for (uint32_t i = 0; i < 8000; i++) {
+		wrongCount += sRunCounts[i] != 20;
+	}
+	CHECK(wrongCount == 0);
+	jobSystem->Finalize();
+}
+
+// 並列forは範囲の全ての要素をちょうど1回ずつ処理する
+void TestParallelFor() {
+	JobSystem* jobSystem = JobSystem::GetInstance();
+	for (uint32_t workerCount : {1u, 2u, 4u}) {
+		jobSystem->Initialize(workerCount);
+		for (uint32_t grainSize : {1u, 7u, 64u, 100000u}) {
+			std::vector<std::atomic<uint32_t>> counts(10000);
+			jobSystem->ParallelFor(10000, grainSize, [&](uint32_t begin, uint32_t end) {
+				for (uint32_t i = begin; i < end; i++) {
+					counts[i].fetch_add(1);
+				}
+			});
+			uint32_t wrongCount = 0;
+			for (auto& count : counts) {
+				wrongCount += count != 1;
+			}
+			CHECK(wrongCount == 0);
+		}
+		// 空の範囲は何もしない
+		jobSystem->ParallelFor(0, 1, [&](uint32_t, uint32_t) { CHECK(false); });
+		jobSystem->Finalize();
+	}
+}
+
+// メインスレッドジョブはExecuteMainThreadJobsを呼んだスレッドで実行される
+void TestMainThreadJobs() {
+	JobSystem* jobSystem = JobSystem::GetInstance();
+	jobSystem->Initialize(2);
+	std::atomic<uint32_t> runCount = 0;
+	jobSystem->ParallelFor(64, 1, [&](uint32_t begin, uint32_t end) {
+		for (uint32_t i = begin; i < end; i++) {
+			jobSystem->RunOnMainThread([&] {
+				CHECK(JobSystem::GetCurrentThreadIndex() == 0);
+				runCount++;
+			});
+		}
+	});
+	CHECK(runCount == 0);
+	jobSystem->ExecuteMainThreadJobs();
+	CHECK(runCount == 64);
+	jobSystem->Finalize();
+}
+
+// 所有スレッドが積んではすぐ取り出す間に他スレッドが盗みに来ても、最後の1個を取り合った
+// 後に古いジョブが戻らず、全てのジョブがちょうど1回ずつ実行される
+void TestPopStealRace() {
+	JobSystem* jobSystem = JobSystem::GetInstance();
+	jobSystem->Initialize(4);
+	ResetRunCounts();
+
+	const uint32_t jobCount = static_cast<uint32_t>(sRunCounts.size());
+	// 古いジョブが後から走ってもカウンタが生きているよう、ジョブ毎に持つ
+	std::vector<JobSystem::Counter> counters(jobCount);
+	for (uint32_t i = 0; i < jobCount; i++) {
+		jobSystem->Run(&CountRun, nullptr, &counters[i], i, i + 1);
+		jobSystem->Wait(counters[i]);
+	}
+	jobSystem->Finalize();
+
+	uint32_t wrongCount = 0;
+	uint32_t wrongCounterCount = 0;
+	for (uint32_t i = 0; i < jobCount; i++) {
+		wrongCount += sRunCounts[i] != 1;
+		wrongCounterCount += !counters[i].IsDone();
+	}
+	CHECK(wrongCount == 0);
+	CHECK(wrongCounterCount == 0);
+}
+
+} // namespace
+
+int main() {
+	TestQueueOverflow();
+	TestNestedRun();
+	TestParallelFor();
+	TestMainThreadJobs();
+	TestPopStealRace();
+	return Test::Finish("JobSystemTest");
+}
@@ -0,0 +1,86 @@
+﻿#include "JobSystem.h"
+#include "LightCluster.h"
+#include "TestMath.h"
+#include "TestUtility.h"
+#include <algorithm>
+#include <cmath>
+#include <random>
+#include <vector>
+
+// 1000個と10000個のライトの割り当て時間を、クラスタ毎のAABBとの総当たりと比べる
+
+namespace {
+
+// 総当たり（クラスタ毎のビュー空間AABBと全ライトの球を比べる）
+size_t BuildBruteForce(const LightCluster::Grid& grid, const std::vector<Sphere>& viewLights) {
+	const float tileCountX = static_cast<float>(LightCluster::kTileCountX);
+	const float tileCountY = static_cast<float>(LightCluster::kTileCountY);
+	const float sliceCount = static_cast<float>(LightCluster::kSliceCount);
+	const float ratio = grid.farZ / grid.nearZ;
+	size_t indexCount = 0;
+	for (uint32_t slice = 0; slice < LightCluster::kSliceCount; slice++) {
+		float z0 = grid.nearZ * std::pow(ratio, static_cast<float>(slice) / sliceCount);
+		float z1 = grid.nearZ * std::pow(ratio, static_cast<float>(slice + 1) / sliceCount);
+		for (uint32_t y = 0; y < LightCluster::kTileCountY; y++) {
+			for (uint32_t x = 0; x < LightCluster::kTileCountX; x++) {
+				float left = (-1.0f + 2.0f * x / tileCountX) / grid.projectionX;
+				float right = (-1.0f + 2.0f * (x + 1) / tileCountX) / grid.projectionX;
+				float bottom = (1.0f - 2.0f * (y + 1) / tileCountY) / grid.projectionY;
+				float top = (1.0f - 2.0f * y / tileCountY) / grid.projectionY;
+				Vector3 min = {
+				  (std::min)(left * z0, left * z1), (std::min)(bottom * z0, bottom * z1), z0};
+				Vector3 max = {
+				  (std::max)(right * z0, right * z1), (std::max)(top * z0, top * z1), z1};
+				for (const Sphere& light : viewLights) {
+					Vector3 offset = Subtract(light.center, Min(Max(light.center, min), max));
+					indexCount += Dot(offset, offset) <= light.radius * light.radius;
+				}
+			}
+		}
+	}
+	return indexCount;
+}
+
+} // namespace
+
+int main() {
+	LightCluster::Grid grid;
+	grid.view = Test::MakeTranslation({0.0f, 0.0f, 50.0f});
+	Matrix4x4 projection = Test::MakePerspective(0.785398f, 16.0f / 9.0f, 0.1f, 1000.0f);
+	grid.projectionX = projection.m[0][0];
+	grid.projectionY = projection.m[1][1];
+
+	std::mt19937 random(1);
+	std::uniform_real_distribution<float> unit(-1.0f, 1.0f);
+	for (uint32_t lightCount : {1000u, 10000u}) {
+		// 45度の視錐台の中に、手前ほど密にライトを置く
+		std::vector<Sphere> lights(lightCount);
+		std::vector<Sphere> viewLights(lightCount);
+		for (uint32_t i = 0; i < lightCount; i++) {
+			float z = std::pow(10.0f, 0.3f + 2.2f * (unit(random) * 0.5f + 0.5f));
+			viewLights[i] = {
+			  {unit(random) * z * 0.7f, unit(random) * z * 0.45f, z},
+			  0.5f + 2.0f * (unit(random) + 1.0f)};
+			lights[i] = viewLights[i];
+			lights[i].center.z -= 50.0f;
+		}
+
+		LightCluster cluster;
+		double serial =
+		  Test::MeasureMicroseconds(10, [&] { cluster.Build(grid, lights.data(), lightCount); });
+		size_t indexCount = cluster.GetLightIndices().size();
+		JobSystem::GetInstance()->Initialize();
+		double threaded =
+		  Test::MeasureMicroseconds(10, [&] { cluster.Build(grid, lights.data(), lightCount); });
+		JobSystem::GetInstance()->Finalize();
+		size_t bruteForceCount = 0;
+		double bruteForce = Test::MeasureMicroseconds(
+		  1, [&] { bruteForceCount = BuildBruteForce(grid, viewLights); });
+		std::printf(
+		  "%5u lights: build %.3f ms (jobs %.3f ms, %zu indices), brute-force AABB %.1f ms "
+		  "(%zu indices)\n",
+		  lightCount, serial / 1000.0, threaded / 1000.0, indexCount, bruteForce / 1000.0,
+		  bruteForceCount);
+	}
+	return 0;
+}
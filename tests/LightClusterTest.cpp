@@ -0,0 +1,219 @@
+﻿#include "JobSystem.h"
+#include "LightCluster.h"
+#include "TestMath.h"
+#include "TestUtility.h"
+#include <algorithm>
+#include <cmath>
+#include <random>
+#include <vector>
+
+namespace {
+
+const float kFovAngleY = 0.785398f;
+const float kAspectRatio = 16.0f / 9.0f;
+
+LightCluster::Grid MakeGrid(const Vector3& eye, const Vector3& target) {
+	LightCluster::Grid grid;
+	grid.view = Test::MakeLookAt(eye, target, {0.0f, 1.0f, 0.0f});
+	Matrix4x4 projection = Test::MakePerspective(kFovAngleY, kAspectRatio, 0.1f, 1000.0f);
+	grid.projectionX = projection.m[0][0];
+	grid.projectionY = projection.m[1][1];
+	grid.nearZ = 0.1f;
+	grid.farZ = 1000.0f;
+	return grid;
+}
+
+// カメラの前方に、手前ほど密になるようにライトを置く
+std::vector<Sphere> MakeLights(
+  uint32_t count, const LightCluster::Grid& grid, const Vector3& eye, std::mt19937& random) {
+	std::uniform_real_distribution<float> unit(0.0f, 1.0f);
+	std::uniform_real_distribution<float> lateral(-1.2f, 1.2f);
+	// ビュー行列は回転と平行移動なので、転置で基底を取り出せる
+	Vector3 right = {grid.view.m[0][0], grid.view.m[1][0], grid.view.m[2][0]};
+	Vector3 up = {grid.view.m[0][1], grid.view.m[1][1], grid.view.m[2][1]};
+	Vector3 forward = {grid.view.m[0][2], grid.view.m[1][2], grid.view.m[2][2]};
+	std::vector<Sphere> lights(count);
+	for (Sphere& light : lights) {
+		float z = std::pow(10.0f, -0.5f + 3.0f * unit(random));
+		float x = lateral(random) * z / grid.projectionX;
+		float y = lateral(random) * z / grid.projectionY;
+		light.center =
+		  Add(eye, Add(Multiply(x, right), Add(Multiply(y, up), Multiply(z, forward))));
+		light.radius = 0.2f + 0.1f * z * unit(random);
+	}
+	return lights;
+}
+
+// ビュー空間の点が入るクラスタ。タイルやスライスの境界にごく近ければfalse
+bool FindCluster(const LightCluster::Grid& grid, const Vector3& point, uint32_t& cluster) {
+	if (point.z <= grid.nearZ || point.z >= grid.farZ) {
+		return false;
+	}
+	float u = (point.x * grid.projectionX / point.z + 1.0f) * 0.5f;
+	float v = (1.0f - point.y * grid.projectionY / point.z) * 0.5f;
+	if (u < 0.0f || u >= 1.0f || v < 0.0f || v >= 1.0f) {
+		return false;
+	}
+	float tileX = u * LightCluster::kTileCountX;
+	float tileY = v * LightCluster::kTileCountY;
+	float slice =
+	  std::log(point.z) * LightCluster::GetDepthScale(grid) + LightCluster::GetDepthBias(grid);
+	auto nearBoundary = [](float value) {
+		return std::fabs(value - std::round(value)) < 1e-3f;
+	};
+	if (nearBoundary(tileX) || nearBoundary(tileY) || nearBoundary(slice)) {
+		return false;
+	}
+	cluster = LightCluster::GetClusterIndex(
+	  static_cast<uint32_t>(tileX), static_cast<uint32_t>(tileY), static_cast<uint32_t>(slice));
+	return true;
+}
+
+// 範囲が一覧を重ならずに覆い、クラスタ内の番号は昇順で重複しない
+void CheckLayout(const LightCluster& cluster, uint32_t lightCount) {
+	const auto& ranges = cluster.GetRanges();
+	const auto& indices = cluster.GetLightIndices();
+	CHECK(ranges.size() == LightCluster::kClusterCount);
+	uint32_t wrongCount = 0;
+	uint32_t total = 0;
+	for (const LightCluster::Range& range : ranges) {
+		wrongCount += range.offset != total;
+		total += range.count;
+		if (total > indices.size()) {
+			wrongCount++;
+			break;
+		}
+		for (uint32_t i = range.offset; i < range.offset + range.count; i++) {
+			wrongCount += indices[i] >= lightCount;
+			wrongCount += i > range.offset && indices[i] <= indices[i - 1];
+		}
+	}
+	CHECK(wrongCount == 0);
+	CHECK(total == indices.size());
+}
+
+// ライトの内側の点が入るクラスタには、必ずそのライトが含まれる
+void CheckConservative(
+  const LightCluster& cluster, const LightCluster::Grid& grid, const std::vector<Sphere>& lights,
+  std::mt19937& random) {
+	std::uniform_real_distribution<float> unit(-1.0f, 1.0f);
+	const auto& ranges = cluster.GetRanges();
+	const auto& indices = cluster.GetLightIndices();
+	uint32_t checkCount = 0;
+	uint32_t missCount = 0;
+	for (uint32_t i = 0; i < lights.size(); i++) {
+		Vector3 center = Transform(lights[i].center, grid.view);
+		for (int sample = 0; sample < 20; sample++) {
+			// 球の内側（半分は表面近く）の点
+			Vector3 offset = {unit(random), unit(random), unit(random)};
+			if (Length(offset) > 1.0f || Length(offset) == 0.0f) {
+				continue;
+			}
+			if (sample % 2 == 0) {
+				offset = Multiply(0.999f, Normalize(offset));
+			}
+			Vector3 point = Add(center, Multiply(lights[i].radius, offset));
+			uint32_t index;
+			if (!FindCluster(grid, point, index)) {
+				continue;
+			}
+			checkCount++;
+			auto begin = indices.begin() + ranges[index].offset;
+			auto end = begin + ranges[index].count;
+			missCount += !std::binary_search(begin, end, i);
+		}
+	}
+	CHECK(missCount == 0);
+	CHECK(checkCount > lights.size());
+}
+
+// 様々な向きのカメラで、割り当てが漏れないか
+void TestConservative() {
+	std::mt19937 random(1);
+	std::uniform_real_distribution<float> position(-50.0f, 50.0f);
+	LightCluster cluster;
+	for (int camera = 0; camera < 6; camera++) {
+		Vector3 eye = {position(random), position(random), position(random)};
+		Vector3 target = {position(random), position(random), position(random)};
+		LightCluster::Grid grid = MakeGrid(eye, target);
+		// 並列化の閾値の前後
+		uint32_t lightCount = camera % 2 == 0 ? 100 : 2000;
+		std::vector<Sphere> lights = MakeLights(lightCount, grid, eye, random);
+		cluster.Build(grid, lights.data(), lightCount);
+		CheckLayout(cluster, lightCount);
+		CheckConservative(cluster, grid, lights, random);
+	}
+}
+
+// カメラの後ろや遠すぎるライトはどのクラスタにも入らない
+void TestOutside() {
+	LightCluster::Grid grid = MakeGrid({0.0f, 0.0f, 0.0f}, {0.0f, 0.0f, 1.0f});
+	std::vector<Sphere> lights = {
+	  {{0.0f, 0.0f, -10.0f}, 5.0f},  // 後ろ
+	  {{0.0f, 0.0f, 1200.0f}, 5.0f}, // 奥
+	  {{500.0f, 0.0f, 50.0f}, 5.0f}, // 右
+	  {{0.0f, 0.0f, 50.0f}, 1.0f},   // 正面
+	};
+	LightCluster cluster;
+	cluster.Build(grid, lights.data(), static_cast<uint32_t>(lights.size()));
+	CheckLayout(cluster, static_cast<uint32_t>(lights.size()));
+	const auto& indices = cluster.GetLightIndices();
+	CHECK(!indices.empty());
+	CHECK(std::all_of(indices.begin(), indices.end(), [](uint32_t i) { return i == 3; }));
+
+	// 正面のライトは画面中央のタイルの、深度50を含むスライスに入る
+	uint32_t slice = LightCluster::GetSlice(grid, 50.0f);
+	const LightCluster::Range& range = cluster.GetRanges()[LightCluster::GetClusterIndex(
+	  LightCluster::kTileCountX / 2, LightCluster::kTileCountY / 2, slice)];
+	CHECK(range.count == 1);
+
+	// ライトが無ければ全て空
+	cluster.Build(grid, nullptr, 0);
+	CheckLayout(cluster, 0);
+	CHECK(cluster.GetLightIndices().empty());
+}
+
+// スライスは深度の対数で等分され、シェーダーと同じ式で求まる
+void TestSlices() {
+	LightCluster::Grid grid = MakeGrid({0.0f, 0.0f, 0.0f}, {0.0f, 0.0f, 1.0f});
+	CHECK(LightCluster::GetSlice(grid, grid.nearZ * 1.001f) == 0);
+	CHECK(LightCluster::GetSlice(grid, grid.farZ * 0.999f) == LightCluster::kSliceCount - 1);
+	CHECK(LightCluster::GetSlice(grid, grid.farZ * 2.0f) == LightCluster::kSliceCount - 1);
+	CHECK(LightCluster::GetSlice(grid, grid.nearZ * 0.5f) == 0);
+	uint32_t previous = 0;
+	for (float z = 0.2f; z < 900.0f; z *= 1.1f) {
+		uint32_t slice = LightCluster::GetSlice(grid, z);
+		CHECK(slice >= previous);
+		previous = slice;
+	}
+}
+
+// ジョブシステムで並列に作っても結果は同じ
+void TestThreadedMatchesSerial() {
+	std::mt19937 random(7);
+	LightCluster::Grid grid = MakeGrid({0.0f, 5.0f, -20.0f}, {0.0f, 0.0f, 10.0f});
+	std::vector<Sphere> lights = MakeLights(3000, grid, {0.0f, 5.0f, -20.0f}, random);
+	LightCluster serial;
+	serial.Build(grid, lights.data(), 3000);
+	JobSystem::GetInstance()->Initialize(3);
+	LightCluster threaded;
+	threaded.Build(grid, lights.data(), 3000);
+	JobSystem::GetInstance()->Finalize();
+	CHECK(serial.GetLightIndices() == threaded.GetLightIndices());
+	bool sameRanges = true;
+	for (uint32_t i = 0; i < LightCluster::kClusterCount; i++) {
+		sameRanges &= serial.GetRanges()[i].offset == threaded.GetRanges()[i].offset &&
+		              serial.GetRanges()[i].count == threaded.GetRanges()[i].count;
+	}
+	CHECK(sameRanges);
+}
+
+} // namespace
+
+int main() {
+	TestConservative();
+	TestOutside();
+	TestSlices();
+	TestThreadedMatchesSerial();
+	return Test::Finish("LightClusterTest");
+}
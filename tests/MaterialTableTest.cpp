@@ -0,0 +1,153 @@
+﻿#include "MaterialTable.h"
+#include "TestUtility.h"
+#include <vector>
+
+namespace {
+
+// Material::ConstBufferDataと同じく16バイト境界に揃えた値
+struct Value {
+	float color[4];
+};
+
+Value MakeValue(float red) { return {{red, 0.5f, 0.25f, 1.0f}}; }
+
+// 同じ値は同じ番号を共有し、番号は0から詰めて振る
+void TestDeduplicate() {
+	MaterialTable<Value, 8> table;
+	uint32_t red = table.Acquire(MakeValue(1.0f));
+	uint32_t green = table.Acquire(MakeValue(0.0f));
+	CHECK(red == 0 && green == 1);
+	// 別の場所に作った同じ値
+	Value copy = MakeValue(1.0f);
+	CHECK(table.Acquire(copy) == red);
+	CHECK(table.GetReferenceCount(red) == 2);
+	CHECK(table.GetStatistics().materialCount == 2);
+	CHECK(table.GetStatistics().referenceCount == 3);
+
+	// 転送範囲は登録した番号だけ。取り出すと空になる
+	uint32_t begin, end;
+	CHECK(table.TakeDirtyRange(begin, end) == 2);
+	CHECK(begin == 0 && end == 2);
+	CHECK(table.TakeDirtyRange(begin, end) == 0);
+	// 共有しただけでは転送しない
+	table.Acquire(MakeValue(0.0f));
+	CHECK(table.TakeDirtyRange(begin, end) == 0);
+
+	// 参照が残っている間は登録を外さない
+	table.Release(red);
+	CHECK(table.Acquire(MakeValue(1.0f)) == red);
+	table.Release(red);
+	table.Release(red);
+	CHECK(table.GetReferenceCount(red) == 0);
+	CHECK(table.GetStatistics().materialCount == 1);
+
+	// 空いた番号を再利用し、その番号だけを転送する
+	uint32_t blue = table.Acquire(MakeValue(0.75f));
+	CHECK(blue == red);
+	CHECK(table.GetEntries()[blue].color[0] == 0.75f);
+	CHECK(table.TakeDirtyRange(begin, end) == 1);
+	CHECK(begin == blue && end == blue + 1);
+
+	// 同じ値への差し替えは番号も参照数も変えない
+	CHECK(table.Replace(blue, MakeValue(0.75f)) == blue);
+	CHECK(table.GetReferenceCount(blue) == 1);
+	// 登録済みの値への差し替えはその番号を共有し、古い番号を解放する
+	CHECK(table.Replace(blue, MakeValue(0.0f)) == green);
+	CHECK(table.GetReferenceCount(green) == 3);
+	CHECK(table.GetReferenceCount(blue) == 0);
+	CHECK(table.Replace(MaterialTable<Value, 8>::kInvalidId, MakeValue(0.0f)) == green);
+}
+
+// 満杯になったら代わりの番号を共有し、解放すればまた登録できる
+void TestFallback() {
+	using Table = MaterialTable<Value, 4>;
+	Table table;
+	std::vector<uint32_t> ids;
+	for (uint32_t i = 0; i < 4; i++) {
+		ids.push_back(table.Acquire(MakeValue(static_cast<float>(i))));
+		CHECK(ids.back() == i);
+	}
+	uint32_t begin, end;
+	table.TakeDirtyRange(begin, end);
+
+	// 満杯の時の新しい値は登録されず、代わりの番号の参照が増える
+	uint32_t overflow = table.Acquire(MakeValue(100.0f));
+	CHECK(overflow == Table::kFallbackId);
+	CHECK(table.GetReferenceCount(Table::kFallbackId) == 2);
+	CHECK(table.GetStatistics().overflowCount == 1);
+	CHECK(table.GetStatistics().materialCount == 4);
+	CHECK(table.GetEntries().size() == 4);
+	CHECK(table.GetEntries()[Table::kFallbackId].color[0] == 0.0f);
+	// バッファの外や他の値は書き換えない
+	CHECK(table.TakeDirtyRange(begin, end) == 0);
+	// 登録済みの値は満杯でも共有できる
+	CHECK(table.Acquire(MakeValue(3.0f)) == 3);
+	CHECK(table.GetStatistics().overflowCount == 1);
+
+	// 代わりに渡した番号も普通に解放でき、元の持ち主の分の参照は残る
+	table.Release(overflow);
+	CHECK(table.GetReferenceCount(Table::kFallbackId) == 1);
+
+	// 番号が空けば新しい値を登録できる
+	table.Release(ids[2]);
+	CHECK(table.Acquire(MakeValue(100.0f)) == 2);
+	CHECK(table.GetStatistics().overflowCount == 1);
+
+	table.Clear();
+	CHECK(table.GetEntries().empty());
+	CHECK(table.GetStatistics().referenceCount == 0);
+	CHECK(table.Acquire(MakeValue(5.0f)) == 0);
+}
+
+// Material::Updateと同じくReplaceだけで埋める（MaterialBufferはこの経路で満杯を知らせる）
+void TestReplaceWhenFull() {
+	using Table = MaterialTable<Value, 4>;
+	Table table;
+	std::vector<uint32_t> ids(6, Table::kInvalidId);
+	for (uint32_t i = 0; i < 4; i++) {
+		ids[i] = table.Replace(ids[i], MakeValue(static_cast<float>(i)));
+		CHECK(ids[i] == i);
+	}
+	CHECK(!table.TakeFirstOverflow());
+
+	// 満杯を超えた分は代わりの番号を共有し、知らせるのは最初の1回だけ
+	ids[4] = table.Replace(ids[4], MakeValue(4.0f));
+	CHECK(ids[4] == Table::kFallbackId);
+	CHECK(table.TakeFirstOverflow());
+	ids[5] = table.Replace(ids[5], MakeValue(5.0f));
+	CHECK(ids[5] == Table::kFallbackId);
+	CHECK(table.GetStatistics().overflowCount == 2);
+	CHECK(!table.TakeFirstOverflow());
+
+	// 自分だけが使っている番号は先に解放するので、満杯でもその番号に書き換えられる
+	uint32_t begin, end;
+	table.TakeDirtyRange(begin, end);
+	ids[2] = table.Replace(ids[2], MakeValue(20.0f));
+	CHECK(ids[2] == 2);
+	CHECK(table.GetEntries()[2].color[0] == 20.0f);
+	CHECK(table.GetStatistics().overflowCount == 2);
+	CHECK(table.TakeDirtyRange(begin, end) == 1);
+	CHECK(begin == 2 && end == 3);
+
+	// 共有している番号は空かないので、満杯なら代わりの番号のまま
+	ids[4] = table.Replace(ids[4], MakeValue(40.0f));
+	CHECK(ids[4] == Table::kFallbackId);
+	CHECK(table.GetReferenceCount(Table::kFallbackId) == 3);
+	CHECK(table.GetStatistics().referenceCount == 6);
+
+	// Clearの後はまた知らせる
+	table.Clear();
+	for (uint32_t i = 0; i < 5; i++) {
+		table.Replace(Table::kInvalidId, MakeValue(static_cast<float>(i)));
+	}
+	CHECK(table.TakeFirstOverflow());
+}
+
+} // namespace
+
+int main() {
+	TestDeduplicate();
+	TestFallback();
+	TestReplaceWhenFull();
+	return Test::Finish("MaterialTableTest");
+}
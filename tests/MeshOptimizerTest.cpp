@@ -0,0 +1,127 @@
+﻿#include "MeshOptimizer.h"
+#include "TestUtility.h"
+#include <algorithm>
+#include <array>
+#include <random>
+#include <vector>
+
+namespace {
+
+// OBJの読み込み結果と同じく、面の頂点毎に複製した格子
+struct Grid {
+	std::vector<Vector3> positions;
+	std::vector<uint32_t> indices;
+};
+
+Grid MakeGrid(uint32_t size, bool shuffle) {
+	Grid grid;
+	std::vector<std::array<uint32_t, 2>> cells;
+	for (uint32_t y = 0; y < size; y++) {
+		for (uint32_t x = 0; x < size; x++) {
+			cells.push_back({x, y});
+		}
+	}
+	if (shuffle) {
+		std::mt19937 random(1);
+		std::shuffle(cells.begin(), cells.end(), random);
+	}
+	auto corner = [&grid](uint32_t x, uint32_t y) {
+		grid.indices.push_back(static_cast<uint32_t>(grid.positions.size()));
+		grid.positions.push_back({static_cast<float>(x), 0.0f, static_cast<float>(y)});
+	};
+	for (const auto& [x, y] : cells) {
+		corner(x, y);
+		corner(x, y + 1);
+		corner(x + 1, y + 1);
+		corner(x, y);
+		corner(x + 1, y + 1);
+		corner(x + 1, y);
+	}
+	return grid;
+}
+
+// 三角形を巡回させて最小の番号を先頭にし（向きは保つ）、全体を並べたもの
+std::vector<std::array<uint32_t, 3>> SortTriangles(const std::vector<uint32_t>& indices) {
+	std::vector<std::array<uint32_t, 3>> triangles;
+	for (size_t i = 0; i < indices.size(); i += 3) {
+		std::array<uint32_t, 3> triangle = {indices[i], indices[i + 1], indices[i + 2]};
+		std::rotate(
+		  triangle.begin(), std::min_element(triangle.begin(), triangle.end()), triangle.end());
+		triangles.push_back(triangle);
+	}
+	std::sort(triangles.begin(), triangles.end());
+	return triangles;
+}
+
+// Mesh::Optimizeと同じ順に最適化し、ACMRが下がって同じ三角形のままであることを確かめる
+void TestOptimize(const char* name, bool shuffle) {
+	const uint32_t kSize = 64;
+	Grid grid = MakeGrid(kSize, shuffle);
+
+	// 同じ頂点をまとめる
+	std::vector<uint32_t> remap;
+	uint32_t vertexCount = MeshOptimizer::GenerateVertexRemap(
+	  grid.positions.data(), static_cast<uint32_t>(grid.positions.size()), sizeof(Vector3),
+	  remap);
+	CHECK(vertexCount == (kSize + 1) * (kSize + 1));
+	std::vector<uint32_t> indices(grid.indices.size());
+	std::vector<Vector3> positions(vertexCount);
+	for (size_t i = 0; i < indices.size(); i++) {
+		indices[i] = remap[grid.indices[i]];
+		positions[indices[i]] = grid.positions[grid.indices[i]];
+	}
+	std::vector<std::array<uint32_t, 3>> source = SortTriangles(indices);
+
+	// 三角形の並べ替え
+	MeshOptimizer::VertexCacheStatistics before =
+	  MeshOptimizer::AnalyzeVertexCache(indices.data(), indices.size(), vertexCount);
+	MeshOptimizer::OptimizeVertexCache(indices.data(), indices.size(), vertexCount);
+	MeshOptimizer::VertexCacheStatistics cache =
+	  MeshOptimizer::AnalyzeVertexCache(indices.data(), indices.size(), vertexCount);
+	MeshOptimizer::OptimizeOverdraw(
+	  indices.data(), indices.size(), positions.data(), sizeof(Vector3), vertexCount);
+	MeshOptimizer::VertexCacheStatistics after =
+	  MeshOptimizer::AnalyzeVertexCache(indices.data(), indices.size(), vertexCount);
+	CHECK(SortTriangles(indices) == source);
+
+	// Model::GetOptimizeReportと同じ形式で表示する
+	std::printf(
+	  "  %s vertices %zu -> %u, ACMR %.3f -> %.3f, ATVR %.3f -> %.3f\n", name,
+	  grid.positions.size(), vertexCount, before.acmr, after.acmr, before.atvr, after.atvr);
+	CHECK(after.acmr < before.acmr);
+	CHECK(cache.acmr < 0.8f);
+	CHECK(after.acmr <= cache.acmr * MeshOptimizer::kDefaultOverdrawThreshold + 1e-4f);
+	CHECK(after.atvr >= 1.0f && after.atvr < before.atvr);
+
+	// 頂点を使われる順に並べ替えても、番号を付け替えた同じ三角形のまま
+	std::vector<uint32_t> fetchRemap =
+	  MeshOptimizer::OptimizeVertexFetch(indices.data(), indices.size(), vertexCount);
+	std::vector<uint32_t> renamed(grid.indices.size());
+	for (size_t i = 0; i < renamed.size(); i++) {
+		renamed[i] = fetchRemap[remap[grid.indices[i]]];
+	}
+	CHECK(SortTriangles(indices) == SortTriangles(renamed));
+	// 初めて使われる頂点の番号は0から1ずつ増える
+	uint32_t nextVertex = 0;
+	uint32_t wrongCount = 0;
+	for (uint32_t index : indices) {
+		if (index >= nextVertex) {
+			wrongCount += index != nextVertex;
+			nextVertex = index + 1;
+		}
+	}
+	CHECK(wrongCount == 0);
+	CHECK(nextVertex == vertexCount);
+	// 頂点の並びが変わってもキャッシュの効き方は変わらない
+	MeshOptimizer::VertexCacheStatistics fetched =
+	  MeshOptimizer::AnalyzeVertexCache(indices.data(), indices.size(), vertexCount);
+	CHECK(fetched.missCount == after.missCount);
+}
+
+} // namespace
+
+int main() {
+	TestOptimize("grid", false);
+	TestOptimize("shuffled grid", true);
+	return Test::Finish("MeshOptimizerTest");
+}
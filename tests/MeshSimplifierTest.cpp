@@ -0,0 +1,121 @@
+﻿#include "MathUtility.h"
+#include "MeshSimplifier.h"
+#include "TestMesh.h"
+#include "TestUtility.h"
+#include <vector>
+
+namespace {
+
+using Vertex = Test::MeshVertex;
+
+// でこぼこの球
+void MakeBumpySphere(
+  uint32_t rings, uint32_t segments, std::vector<Vertex>& vertices,
+  std::vector<uint32_t>& indices) {
+	Test::MakeSphere(rings, segments, 0.1f, vertices, indices);
+}
+
+MeshSimplifier::VertexInput MakeInput(const std::vector<Vertex>& vertices) {
+	MeshSimplifier::VertexInput input;
+	input.positions = &vertices[0].position;
+	input.positionStride = sizeof(Vertex);
+	input.normals = &vertices[0].normal;
+	input.normalStride = sizeof(Vertex);
+	input.uvs = &vertices[0].uv;
+	input.uvStride = sizeof(Vertex);
+	input.vertexCount = static_cast<uint32_t>(vertices.size());
+	return input;
+}
+
+// Mesh::GenerateLodsと同じく、毎回元の形状から目標を半分ずつにして簡略化する
+std::vector<MeshSimplifier::Result>
+  GenerateLods(const std::vector<Vertex>& vertices, const std::vector<uint32_t>& indices) {
+	std::vector<MeshSimplifier::Result> lods;
+	for (uint32_t level = 1; level < 4; level++) {
+		lods.push_back(MeshSimplifier::Simplify(
+		  MakeInput(vertices), indices.data(), indices.size(), indices.size() >> level));
+	}
+	return lods;
+}
+
+// 同じメッシュを2回（別のメモリに）作って簡略化すると、インデックスまで同じになる
+void TestDeterministic() {
+	std::vector<Vertex> vertices[2];
+	std::vector<uint32_t> indices[2];
+	for (int i = 0; i < 2; i++) {
+		MakeBumpySphere(48, 96, vertices[i], indices[i]);
+	}
+	std::vector<MeshSimplifier::Result> first = GenerateLods(vertices[0], indices[0]);
+	std::vector<MeshSimplifier::Result> second = GenerateLods(vertices[1], indices[1]);
+	CHECK(first.size() == second.size());
+	for (size_t level = 0; level < first.size(); level++) {
+		CHECK(first[level].indices == second[level].indices);
+		CHECK(first[level].error == second[level].error);
+	}
+}
+
+// 三角形数は目標（元の数をLOD番号だけ右シフトしたもの）まで減り、誤差は段毎に増える
+void TestLodReduction() {
+	std::vector<Vertex> vertices;
+	std::vector<uint32_t> indices;
+	MakeBumpySphere(48, 96, vertices, indices);
+	std::vector<MeshSimplifier::Result> lods = GenerateLods(vertices, indices);
+
+	// Model::GetLodReportと同じ形式で表示する
+	size_t sourceTriangleCount = indices.size() / 3;
+	std::printf("  sphere LOD0: %zu tris (100.0%%) error 0.00000\n", sourceTriangleCount);
+	size_t previousCount = indices.size();
+	float previousError = 0.0f;
+	for (uint32_t level = 1; level <= lods.size(); level++) {
+		const MeshSimplifier::Result& lod = lods[level - 1];
+		size_t triangleCount = lod.indices.size() / 3;
+		std::printf(
+		  "  sphere LOD%u: %zu tris (%.1f%%) error %.5f\n", level, triangleCount,
+		  100.0 * static_cast<double>(triangleCount) / static_cast<double>(sourceTriangleCount),
+		  lod.error);
+
+		size_t targetCount = indices.size() >> level;
+		CHECK(lod.indices.size() % 3 == 0);
+		CHECK(lod.indices.size() <= targetCount);
+		CHECK(lod.indices.size() >= targetCount * 9 / 10);
+		CHECK(lod.indices.size() < previousCount);
+		CHECK(lod.error > previousError);
+		previousCount = lod.indices.size();
+		previousError = lod.error;
+
+		// 頂点は元の頂点バッファを指し、潰れた三角形を含まない
+		uint32_t wrongCount = 0;
+		for (size_t i = 0; i < lod.indices.size(); i += 3) {
+			const uint32_t* corner = &lod.indices[i];
+			wrongCount += corner[0] >= vertices.size() || corner[1] >= vertices.size() ||
+			              corner[2] >= vertices.size();
+			wrongCount +=
+			  corner[0] == corner[1] || corner[1] == corner[2] || corner[2] == corner[0];
+		}
+		CHECK(wrongCount == 0);
+	}
+}
+
+// 許容誤差を与えると、それを超える縮約は行わない
+void TestTargetError() {
+	std::vector<Vertex> vertices;
+	std::vector<uint32_t> indices;
+	MakeBumpySphere(48, 96, vertices, indices);
+	MeshSimplifier::Result unbounded =
+	  MeshSimplifier::Simplify(MakeInput(vertices), indices.data(), indices.size(), 0);
+	float targetError = unbounded.error * 0.1f;
+	MeshSimplifier::Result bounded = MeshSimplifier::Simplify(
+	  MakeInput(vertices), indices.data(), indices.size(), 0, targetError);
+	CHECK(bounded.error <= targetError);
+	CHECK(bounded.indices.size() > unbounded.indices.size());
+	CHECK(bounded.indices.size() < indices.size());
+}
+
+} // namespace
+
+int main() {
+	TestDeterministic();
+	TestLodReduction();
+	TestTargetError();
+	return Test::Finish("MeshSimplifierTest");
+}
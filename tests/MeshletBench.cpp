@@ -0,0 +1,58 @@
+﻿#include "MathUtility.h"
+#include "MeshOptimizer.h"
+#include "Meshlet.h"
+#include "TestMath.h"
+#include "TestUtility.h"
+#include <cmath>
+#include <vector>
+
+// 32万三角形の球をメッシュレットに分ける時間と、カリングの速さ（クラスタ/ms）を測る
+
+int main() {
+	const uint32_t kRings = 400;
+	const uint32_t kSegments = 400;
+	const float kPi = 3.14159265f;
+	std::vector<Vector3> positions;
+	std::vector<uint32_t> indices;
+	for (uint32_t i = 0; i <= kRings; i++) {
+		for (uint32_t j = 0; j <= kSegments; j++) {
+			float theta = kPi * static_cast<float>(i) / kRings;
+			float phi = 2.0f * kPi * static_cast<float>(j) / kSegments;
+			positions.push_back(
+			  {std::sin(theta) * std::cos(phi), std::cos(theta), std::sin(theta) * std::sin(phi)});
+		}
+	}
+	for (uint32_t i = 0; i < kRings; i++) {
+		for (uint32_t j = 0; j < kSegments; j++) {
+			uint32_t a = i * (kSegments + 1) + j;
+			uint32_t b = a + kSegments + 1;
+			indices.insert(indices.end(), {a, b + 1, b, a, a + 1, b + 1});
+		}
+	}
+	uint32_t vertexCount = static_cast<uint32_t>(positions.size());
+	MeshOptimizer::OptimizeVertexCache(indices.data(), indices.size(), vertexCount);
+
+	std::vector<Meshlet> meshlets;
+	double build = Test::MeasureMicroseconds(3, [&] {
+		meshlets = BuildMeshlets(
+		  indices.data(), indices.size(), positions.data(), sizeof(Vector3), vertexCount);
+	});
+	std::printf(
+	  "build %zu triangles: %.2f ms, %zu meshlets (%.0f clusters/ms)\n", indices.size() / 3,
+	  build / 1000.0, meshlets.size(), meshlets.size() / (build / 1000.0));
+
+	Vector3 camera = {0.0f, 0.5f, -3.0f};
+	Matrix4x4 viewProjection = Multiply(
+	  Test::MakeLookAt(camera, {0.0f, 0.0f, 0.0f}, {0.0f, 1.0f, 0.0f}),
+	  Test::MakePerspective(0.6f, 16.0f / 9.0f, 0.1f, 100.0f));
+	Frustum frustum = MakeFrustum(viewProjection);
+	std::vector<IndexRange> ranges;
+	uint32_t visibleCount = 0;
+	double cull = Test::MeasureMicroseconds(20, [&] {
+		visibleCount = CullMeshlets(meshlets.data(), meshlets.size(), frustum, camera, ranges);
+	});
+	std::printf(
+	  "cull  %.3f ms, %u visible in %zu ranges (%.0f clusters/ms)\n", cull / 1000.0,
+	  visibleCount, ranges.size(), meshlets.size() / (cull / 1000.0));
+	return 0;
+}
@@ -0,0 +1,203 @@
+﻿#include "MathUtility.h"
+#include "MeshOptimizer.h"
+#include "Meshlet.h"
+#include "TestMath.h"
+#include "TestMesh.h"
+#include "TestUtility.h"
+#include <algorithm>
+#include <cmath>
+#include <random>
+#include <vector>
+
+namespace {
+
+// でこぼこの球（外向きが時計回りとは限らないので、判定は面毎の向きで行う）
+void MakeBumpySphere(
+  uint32_t rings, uint32_t segments, std::vector<Vector3>& positions,
+  std::vector<uint32_t>& indices) {
+	std::vector<Test::MeshVertex> vertices;
+	Test::MakeSphere(rings, segments, 0.1f, vertices, indices);
+	for (const Test::MeshVertex& vertex : vertices) {
+		positions.push_back(vertex.position);
+	}
+	MeshOptimizer::OptimizeVertexCache(
+	  indices.data(), indices.size(), static_cast<uint32_t>(positions.size()));
+}
+
+Vector3 FaceNormal(const std::vector<Vector3>& positions, const uint32_t* triangle) {
+	const Vector3& p0 = positions[triangle[0]];
+	return Cross(
+	  Subtract(positions[triangle[1]], p0), Subtract(positions[triangle[2]], p0));
+}
+
+// メッシュレットがインデックスを隙間なく順に覆い、上限と境界を守っているか
+void CheckMeshlets(
+  const std::vector<Meshlet>& meshlets, const std::vector<uint32_t>& indices,
+  const std::vector<Vector3>& positions, uint32_t maxVertices, uint32_t maxTriangles) {
+	uint32_t offset = 0;
+	uint32_t wrongCount = 0;
+	for (const Meshlet& meshlet : meshlets) {
+		wrongCount += meshlet.indexOffset != offset;
+		wrongCount += meshlet.triangleCount == 0 || meshlet.triangleCount > maxTriangles;
+		offset += meshlet.triangleCount * 3;
+
+		const uint32_t* begin = &indices[meshlet.indexOffset];
+		std::vector<uint32_t> vertices(begin, begin + meshlet.triangleCount * 3);
+		std::sort(vertices.begin(), vertices.end());
+		vertices.erase(std::unique(vertices.begin(), vertices.end()), vertices.end());
+		wrongCount += meshlet.vertexCount != vertices.size() || meshlet.vertexCount > maxVertices;
+
+		// 境界球は全頂点を含む
+		for (uint32_t v : vertices) {
+			wrongCount += Length(Subtract(positions[v], meshlet.bounds.center)) >
+			              meshlet.bounds.radius * (1.0f + 1e-5f) + 1e-6f;
+		}
+		// 法線コーンは全ての面の向きを含む
+		if (meshlet.coneCutoff < 1.0f) {
+			float minDot = std::sqrt(1.0f - meshlet.coneCutoff * meshlet.coneCutoff);
+			for (uint32_t t = 0; t < meshlet.triangleCount; t++) {
+				Vector3 normal = FaceNormal(positions, begin + t * 3);
+				float length = Length(normal);
+				if (length > 0.0f) {
+					wrongCount += Dot(meshlet.coneAxis, normal) / length < minDot - 1e-4f;
+				}
+			}
+		}
+	}
+	CHECK(wrongCount == 0);
+	CHECK(offset == indices.size());
+}
+
+// 上限を変えても分け方の性質は保たれる
+void TestBuild() {
+	std::vector<Vector3> positions;
+	std::vector<uint32_t> indices;
+	MakeBumpySphere(60, 80, positions, indices);
+	uint32_t vertexCount = static_cast<uint32_t>(positions.size());
+
+	const uint32_t limits[][2] = {
+	  {kMeshletMaxVertices, kMeshletMaxTriangles}, {3, 1}, {16, 8}, {128, 256}};
+	for (const auto& limit : limits) {
+		std::vector<Meshlet> meshlets = BuildMeshlets(
+		  indices.data(), indices.size(), positions.data(), sizeof(Vector3), vertexCount,
+		  limit[0], limit[1]);
+		CheckMeshlets(meshlets, indices, positions, limit[0], limit[1]);
+	}
+
+	// 頂点キャッシュ最適化済みなら、塊は上限近くまで埋まる
+	std::vector<Meshlet> meshlets = BuildMeshlets(
+	  indices.data(), indices.size(), positions.data(), sizeof(Vector3), vertexCount);
+	float averageTriangles = static_cast<float>(indices.size() / 3) / meshlets.size();
+	CHECK(averageTriangles > kMeshletMaxTriangles * 0.6f);
+}
+
+// 空の入力、潰れた三角形、平面のメッシュ
+void TestEdgeCases() {
+	std::vector<Vector3> positions = {
+	  {0.0f, 0.0f, 0.0f}, {1.0f, 0.0f, 0.0f}, {0.0f, 1.0f, 0.0f}, {1.0f, 1.0f, 0.0f}};
+	CHECK(BuildMeshlets(nullptr, 0, positions.data(), sizeof(Vector3), 4).empty());
+
+	// 同じ頂点を含む三角形は頂点を重複して数えない
+	std::vector<uint32_t> indices = {0, 0, 1, 0, 1, 2, 1, 3, 2};
+	std::vector<Meshlet> meshlets =
+	  BuildMeshlets(indices.data(), indices.size(), positions.data(), sizeof(Vector3), 4);
+	CHECK(meshlets.size() == 1);
+	CHECK(meshlets[0].vertexCount == 4);
+	CHECK(meshlets[0].triangleCount == 3);
+	// 平面なら法線コーンは1方向に閉じる
+	CHECK(meshlets[0].coneCutoff < 1e-3f);
+	CHECK_NEAR(std::fabs(meshlets[0].coneAxis.z), 1.0f, 1e-4f);
+
+	// ストライド付きの頂点（座標の後ろに別の要素がある）
+	struct Vertex {
+		Vector3 position;
+		float uv[2];
+	};
+	std::vector<Vertex> vertices;
+	for (const Vector3& position : positions) {
+		vertices.push_back({position, {0.0f, 0.0f}});
+	}
+	std::vector<Meshlet> strided = BuildMeshlets(
+	  indices.data(), indices.size(), &vertices[0].position, sizeof(Vertex), 4);
+	CHECK(strided.size() == 1);
+	CHECK_NEAR(strided[0].bounds.radius, meshlets[0].bounds.radius, 1e-6f);
+}
+
+// カリングで落とした三角形は、全て裏向きか視錐台の外にある
+void TestCulling() {
+	std::vector<Vector3> positions;
+	std::vector<uint32_t> indices;
+	MakeBumpySphere(80, 120, positions, indices);
+	std::vector<Meshlet> meshlets = BuildMeshlets(
+	  indices.data(), indices.size(), positions.data(), sizeof(Vector3),
+	  static_cast<uint32_t>(positions.size()));
+
+	std::mt19937 random(5);
+	std::uniform_real_distribution<float> direction(-1.0f, 1.0f);
+	std::uniform_real_distribution<float> distance(1.5f, 6.0f);
+	std::vector<IndexRange> ranges;
+	uint32_t wrongCount = 0;
+	uint32_t backfaceCount = 0;
+	uint32_t culledBackfaceCount = 0;
+	for (int i = 0; i < 50; i++) {
+		Vector3 camera = Multiply(
+		  distance(random), Normalize({direction(random), direction(random), direction(random)}));
+		// 半分は球の中心を、半分は球の横を向く
+		Vector3 target = i % 2 == 0 ? Vector3{0.0f, 0.0f, 0.0f} : Multiply(0.5f, camera);
+		target.y += i % 2 == 0 ? 0.0f : 1.5f;
+		Matrix4x4 viewProjection = Multiply(
+		  Test::MakeLookAt(camera, target, {0.0f, 1.0f, 0.0f}),
+		  Test::MakePerspective(0.6f, 16.0f / 9.0f, 0.1f, 100.0f));
+		Frustum frustum = MakeFrustum(viewProjection);
+
+		uint32_t visibleCount =
+		  CullMeshlets(meshlets.data(), meshlets.size(), frustum, camera, ranges);
+		CHECK(visibleCount <= meshlets.size());
+
+		// 範囲は昇順で、隣り合うものはまとめてある
+		std::vector<uint8_t> drawn(indices.size() / 3, 0);
+		for (size_t r = 0; r < ranges.size(); r++) {
+			if (r > 0) {
+				wrongCount += ranges[r].indexOffset <=
+				              ranges[r - 1].indexOffset + ranges[r - 1].indexCount;
+			}
+			for (uint32_t t = ranges[r].indexOffset / 3;
+			     t < (ranges[r].indexOffset + ranges[r].indexCount) / 3; t++) {
+				drawn[t] = 1;
+			}
+		}
+
+		for (size_t t = 0; t < drawn.size(); t++) {
+			const uint32_t* triangle = &indices[t * 3];
+			Vector3 toTriangle = Subtract(positions[triangle[0]], camera);
+			bool backface = Dot(FaceNormal(positions, triangle), toTriangle) >= 0.0f;
+			backfaceCount += backface;
+			if (drawn[t]) {
+				continue;
+			}
+			culledBackfaceCount += backface;
+			bool outside = false;
+			for (const Vector4& plane : frustum.planes) {
+				bool allOutside = true;
+				for (int k = 0; k < 3; k++) {
+					const Vector3& p = positions[triangle[k]];
+					allOutside &= plane.x * p.x + plane.y * p.y + plane.z * p.z + plane.w < 0.0f;
+				}
+				outside |= allOutside;
+			}
+			wrongCount += !backface && !outside;
+		}
+	}
+	CHECK(wrongCount == 0);
+	// 法線コーンで裏向きの面の多くを落とせている
+	CHECK(culledBackfaceCount > backfaceCount / 3);
+}
+
+} // namespace
+
+int main() {
+	TestBuild();
+	TestEdgeCases();
+	TestCulling();
+	return Test::Finish("MeshletTest");
+}
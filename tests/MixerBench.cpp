@@ -0,0 +1,63 @@
+﻿#include "AudioOutput.h"
+#include "Mixer.h"
+#include "TestUtility.h"
+#include <cmath>
+#include <vector>
+
+// 256音声を1秒分ミックスする時間を測り、CPU時間1ミリ秒あたりに混ぜられる音声の量を出す
+
+namespace {
+
+const uint32_t kVoiceCount = 256;
+const uint32_t kOutputRate = 48000;
+
+// 全ての音声を少しずつ違う再生速度でループ再生し、1秒分ミックスする
+void Measure(const char* name, const MixerSource& source) {
+	NullAudioOutput output;
+	Mixer mixer;
+	mixer.Initialize(kOutputRate, &output, kVoiceCount);
+	for (uint32_t i = 0; i < kVoiceCount; i++) {
+		MixerVoiceDesc desc;
+		desc.volume = 0.002f;
+		desc.pan = static_cast<float>(i) / kVoiceCount * 2.0f - 1.0f;
+		desc.pitch = 0.9f + static_cast<float>(i) * 0.001f;
+		desc.loop = true;
+		mixer.Play(source, desc);
+	}
+	double time = Test::MeasureMicroseconds(3, [&] { mixer.Render(kOutputRate); });
+	// CPU時間1ミリ秒で混ぜられる音声の長さ（音声数×ミリ秒）。実時間で混ぜられる音声数と同じ
+	std::printf(
+	  "%-12s %u voices x 1 s: %.2f ms (%.0f voice-ms per CPU ms)\n", name, kVoiceCount,
+	  time / 1000.0, kVoiceCount * 1000.0 / (time / 1000.0));
+}
+
+} // namespace
+
+int main() {
+	std::vector<int16_t> stereo(44100 * 2);
+	std::vector<float> mono(44100);
+	for (size_t i = 0; i < mono.size(); i++) {
+		float sample = std::sin(static_cast<float>(i) * 0.01f);
+		mono[i] = sample;
+		stereo[i * 2] = static_cast<int16_t>(sample * 10000.0f);
+		stereo[i * 2 + 1] = static_cast<int16_t>(sample * -10000.0f);
+	}
+	Measure("int16 stereo", {stereo.data(), 44100, 2, 44100, MixerSampleFormat::kInt16});
+	Measure("float mono", {mono.data(), 44100, 1, 44100, MixerSampleFormat::kFloat32});
+
+	// 上限を超えた分は仮想化されるので、混ぜる数だけで時間が決まる
+	NullAudioOutput output;
+	Mixer mixer;
+	mixer.Initialize(kOutputRate, &output, 64);
+	MixerSource source = {stereo.data(), 44100, 2, 44100, MixerSampleFormat::kInt16};
+	for (uint32_t i = 0; i < Mixer::kMaxVoiceCount; i++) {
+		MixerVoiceDesc desc;
+		desc.volume = 0.002f + static_cast<float>(i) * 0.0001f;
+		desc.loop = true;
+		mixer.Play(source, desc);
+	}
+	double time = Test::MeasureMicroseconds(3, [&] { mixer.Render(kOutputRate); });
+	std::printf(
+	  "virtualized  %u voices (64 real) x 1 s: %.2f ms\n", Mixer::kMaxVoiceCount, time / 1000.0);
+	return 0;
+}
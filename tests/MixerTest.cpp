@@ -0,0 +1,309 @@
+﻿#include "AudioOutput.h"
+#include "Mixer.h"
+#include "TestUtility.h"
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <vector>
+
+namespace {
+
+const float kPi = 3.14159265f;
+
+// 書き込まれた波形を全て残す出力
+class CaptureOutput : public AudioOutput {
+public:
+	void Write(const float* left, const float* right, uint32_t frameCount) override {
+		left_.insert(left_.end(), left, left + frameCount);
+		right_.insert(right_.end(), right, right + frameCount);
+	}
+
+	std::vector<float> left_;
+	std::vector<float> right_;
+};
+
+// 線形補間でリサンプリングした波形（ミキサーと同じ規則で、倍精度で計算する）
+std::vector<float> Resample(
+  const std::vector<float>& source, double ratio, bool loop, uint32_t outputCount) {
+	std::vector<float> output(outputCount, 0.0f);
+	size_t count = source.size();
+	for (uint32_t i = 0; i < outputCount; i++) {
+		double position = ratio * i;
+		size_t index = static_cast<size_t>(position);
+		if (index >= count) {
+			if (!loop) {
+				break;
+			}
+			index %= count;
+		}
+		// 最後のフレームは、ループなら先頭と、そうでなければ自身と補間する
+		size_t next = index + 1 < count ? index + 1 : (loop ? 0 : index);
+		double fraction = position - static_cast<double>(static_cast<size_t>(position));
+		output[i] = static_cast<float>(source[index] + (source[next] - source[index]) * fraction);
+	}
+	return output;
+}
+
+// 2つの波形の差の最大
+float MaxDifference(const std::vector<float>& a, const std::vector<float>& b, float scale) {
+	float difference = 0.0f;
+	for (size_t i = 0; i < a.size() && i < b.size(); i++) {
+		difference = (std::max)(difference, std::fabs(a[i] - b[i] * scale));
+	}
+	return difference;
+}
+
+std::vector<float> MakeSine(uint32_t count, float frequency) {
+	std::vector<float> wave(count);
+	for (uint32_t i = 0; i < count; i++) {
+		wave[i] = 0.5f * std::sin(static_cast<float>(i) * frequency);
+	}
+	return wave;
+}
+
+// サンプリング周波数と再生速度の変換が、線形補間の参照実装と一致する
+void TestResample() {
+	std::vector<float> wave = MakeSine(1000, 0.05f);
+	MixerSource source = {wave.data(), 1000, 1, 44100, MixerSampleFormat::kFloat32};
+	// モノラルを中央に置いた時のゲイン
+	const float center = std::cos(kPi * 0.25f);
+
+	for (float pitch : {1.0f, 0.37f, 1.5f, 3.0f}) {
+		for (bool loop : {false, true}) {
+			CaptureOutput output;
+			Mixer mixer;
+			mixer.Initialize(48000, &output);
+			MixerVoiceDesc desc;
+			desc.pitch = pitch;
+			desc.loop = loop;
+			uint32_t handle = mixer.Play(source, desc);
+			mixer.Render(3000);
+
+			double ratio = 44100.0 / 48000.0 * pitch;
+			std::vector<float> expected = Resample(wave, ratio, loop, 3000);
+			CHECK(output.left_.size() == 3000);
+			CHECK(MaxDifference(output.left_, expected, center) < 1e-4f);
+			CHECK(MaxDifference(output.right_, expected, center) < 1e-4f);
+			// ループしなければ最後まで再生したら止まる
+			CHECK(mixer.IsPlaying(handle) == (loop || 1000.0 / ratio > 3000.0));
+		}
+	}
+}
+
+// 16bitステレオ、定位、入れ子のバスの音量
+void TestStereoAndBuses() {
+	std::vector<int16_t> wave(200);
+	for (size_t i = 0; i < 100; i++) {
+		wave[i * 2] = 16384;
+		wave[i * 2 + 1] = -16384;
+	}
+	CaptureOutput output;
+	Mixer mixer;
+	mixer.Initialize(48000, &output);
+	uint32_t bus = mixer.CreateBus(Mixer::kMasterBus, 0.5f);
+	uint32_t subBus = mixer.CreateBus(bus, 0.5f);
+	MixerSource source = {wave.data(), 100, 2, 48000, MixerSampleFormat::kInt16};
+	MixerVoiceDesc desc;
+	desc.bus = subBus;
+	desc.loop = true;
+	desc.pan = 0.5f;
+	uint32_t handle = mixer.Play(source, desc);
+	mixer.Render(1000);
+
+	// ステレオは右に寄せると左だけ絞る
+	CHECK_NEAR(output.left_[500], 0.5f * 0.25f * 0.5f, 1e-6f);
+	CHECK_NEAR(output.right_[500], -0.5f * 0.25f, 1e-6f);
+	CHECK_NEAR(output.left_[999], output.left_[0], 1e-6f);
+	CHECK(mixer.IsPlaying(handle));
+
+	// バスの音量を変えると次のブロックから反映される
+	mixer.SetBusVolume(bus, 1.0f);
+	mixer.Render(256);
+	CHECK_NEAR(output.right_.back(), -0.5f * 0.5f, 1e-6f);
+
+	mixer.Stop(handle);
+	CHECK(!mixer.IsPlaying(handle));
+	mixer.Render(256);
+	CHECK(output.left_.back() == 0.0f && output.right_.back() == 0.0f);
+}
+
+// 音量の変更はブロック内で滑らかにつながる
+void TestVolumeRamp() {
+	std::vector<float> wave(64, 1.0f);
+	CaptureOutput output;
+	Mixer mixer;
+	mixer.Initialize(48000, &output);
+	MixerSource source = {wave.data(), 64, 1, 48000, MixerSampleFormat::kFloat32};
+	MixerVoiceDesc desc;
+	desc.loop = true;
+	desc.pan = -1.0f;
+	uint32_t handle = mixer.Play(source, desc);
+	mixer.Render(Mixer::kBlockFrameCount);
+	// 最初のブロックはいきなり目標の音量で鳴る
+	CHECK_NEAR(output.left_[0], 1.0f, 1e-6f);
+	CHECK_NEAR(output.right_[0], 0.0f, 1e-6f);
+
+	mixer.SetVolume(handle, 0.5f);
+	mixer.Render(Mixer::kBlockFrameCount);
+	float maxError = 0.0f;
+	for (uint32_t i = 0; i < Mixer::kBlockFrameCount; i++) {
+		float expected = 1.0f - 0.5f * static_cast<float>(i) / Mixer::kBlockFrameCount;
+		maxError = (std::max)(
+		  maxError, std::fabs(output.left_[Mixer::kBlockFrameCount + i] - expected));
+	}
+	CHECK(maxError < 1e-5f);
+	mixer.Render(Mixer::kBlockFrameCount);
+	CHECK_NEAR(output.left_.back(), 0.5f, 1e-6f);
+}
+
+// 一時停止中は混ぜず再生位置も進まない。再開すると無音から立ち上がる
+void TestPause() {
+	const uint32_t kBlock = Mixer::kBlockFrameCount;
+	std::vector<float> wave(kBlock * 3, 0.5f);
+	CaptureOutput output;
+	Mixer mixer;
+	mixer.Initialize(48000, &output);
+	MixerSource source = {wave.data(), kBlock * 3, 1, 48000, MixerSampleFormat::kFloat32};
+	MixerVoiceDesc desc;
+	desc.pan = -1.0f;
+	uint32_t handle = mixer.Play(source, desc);
+	mixer.Render(kBlock);
+
+	mixer.SetPaused(handle, true);
+	mixer.Render(kBlock);
+	CHECK(mixer.IsPlaying(handle));
+	CHECK(mixer.GetStatistics().realVoiceCount == 0);
+	float pausedPeak = 0.0f;
+	for (uint32_t i = kBlock; i < kBlock * 2; i++) {
+		pausedPeak = (std::max)(pausedPeak, std::fabs(output.left_[i]));
+	}
+	CHECK(pausedPeak == 0.0f);
+
+	mixer.SetPaused(handle, false);
+	mixer.Render(kBlock);
+	CHECK(output.left_[kBlock * 2] == 0.0f);
+	CHECK_NEAR(output.left_[kBlock * 3 - 1], 0.5f, 0.01f);
+	// 止めていた分だけ遅れて終わる
+	mixer.Render(kBlock);
+	CHECK(mixer.IsPlaying(handle));
+	mixer.Render(kBlock);
+	CHECK(!mixer.IsPlaying(handle));
+}
+
+// 上限を超えたら聞こえにくいものから仮想化し、仮想化中も再生位置は進む
+void TestVirtualization() {
+	std::vector<float> wave(1000, 1.0f);
+	MixerSource source = {wave.data(), 1000, 1, 48000, MixerSampleFormat::kFloat32};
+	const float center = std::cos(kPi * 0.25f);
+
+	CaptureOutput output;
+	Mixer mixer;
+	mixer.Initialize(48000, &output, 2);
+	for (float volume : {0.1f, 0.4f, 0.2f, 0.3f}) {
+		MixerVoiceDesc desc;
+		desc.volume = volume;
+		desc.loop = true;
+		mixer.Play(source, desc);
+	}
+	mixer.Render(Mixer::kBlockFrameCount);
+	CHECK(mixer.GetStatistics().realVoiceCount == 2);
+	CHECK(mixer.GetStatistics().virtualVoiceCount == 2);
+	// 大きい2つだけが混ざる
+	CHECK_NEAR(output.left_.back(), (0.4f + 0.3f) * center, 1e-5f);
+
+	// 優先度も聞こえる大きさに掛ける
+	MixerVoiceDesc important;
+	important.volume = 0.05f;
+	important.priority = 100.0f;
+	important.loop = true;
+	mixer.Play(source, important);
+	mixer.Render(Mixer::kBlockFrameCount);
+	mixer.Render(Mixer::kBlockFrameCount);
+	CHECK_NEAR(output.left_.back(), (0.4f + 0.05f) * center, 1e-5f);
+
+	// ループしない音は、混ぜても仮想化しても同じ時間で止まる
+	for (uint32_t budget : {0u, 1u}) {
+		Mixer single;
+		single.Initialize(48000, &output, budget);
+		uint32_t handle = single.Play(source);
+		single.Render(Mixer::kBlockFrameCount * 3);
+		CHECK(single.IsPlaying(handle));
+		single.Render(Mixer::kBlockFrameCount);
+		CHECK(!single.IsPlaying(handle));
+	}
+}
+
+// マスターは-1～1に収めて出力する
+void TestClamp() {
+	std::vector<float> wave(64, 1.0f);
+	MixerSource source = {wave.data(), 64, 1, 48000, MixerSampleFormat::kFloat32};
+	NullAudioOutput output;
+	Mixer mixer;
+	mixer.Initialize(48000, &output);
+	for (int i = 0; i < 8; i++) {
+		MixerVoiceDesc desc;
+		desc.loop = true;
+		mixer.Play(source, desc);
+	}
+	mixer.Render(1000);
+	CHECK(output.GetFrameCount() == 1000);
+	CHECK(output.GetPeak() == 1.0f);
+	CHECK(mixer.GetStatistics().renderedFrameCount == 1000);
+}
+
+// WAVファイルに書き出した内容をそのまま読み戻せる
+void TestWaveFileOutput() {
+	std::string filePath = (std::filesystem::temp_directory_path() / "MixerTest.wav").string();
+	std::vector<float> wave = MakeSine(1000, 0.05f);
+	MixerSource source = {wave.data(), 1000, 1, 48000, MixerSampleFormat::kFloat32};
+	CaptureOutput capture;
+	{
+		WaveFileOutput output;
+		CHECK(output.Open(filePath, 48000));
+		Mixer mixer;
+		mixer.Initialize(48000, &output);
+		mixer.Play(source);
+		mixer.Render(600);
+		Mixer reference;
+		reference.Initialize(48000, &capture);
+		reference.Play(source);
+		reference.Render(600);
+	}
+
+	std::ifstream file(filePath, std::ios_base::binary);
+	std::vector<char> bytes(
+	  (std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+	file.close();
+	std::filesystem::remove(filePath);
+	CHECK(bytes.size() == 44 + 600 * 8);
+	if (bytes.size() != 44 + 600 * 8) {
+		return;
+	}
+	uint32_t riffSize;
+	uint32_t dataSize;
+	memcpy(&riffSize, bytes.data() + 4, sizeof(riffSize));
+	memcpy(&dataSize, bytes.data() + 40, sizeof(dataSize));
+	CHECK(memcmp(bytes.data(), "RIFF", 4) == 0 && memcmp(bytes.data() + 36, "data", 4) == 0);
+	CHECK(riffSize == 36 + 600 * 8);
+	CHECK(dataSize == 600 * 8);
+	uint32_t wrongCount = 0;
+	for (uint32_t i = 0; i < 600; i++) {
+		float frame[2];
+		memcpy(frame, bytes.data() + 44 + i * 8, sizeof(frame));
+		wrongCount += frame[0] != capture.left_[i] || frame[1] != capture.right_[i];
+	}
+	CHECK(wrongCount == 0);
+}
+
+} // namespace
+
+int main() {
+	TestResample();
+	TestStereoAndBuses();
+	TestVolumeRamp();
+	TestPause();
+	TestVirtualization();
+	TestClamp();
+	TestWaveFileOutput();
+	return Test::Finish("MixerTest");
+}
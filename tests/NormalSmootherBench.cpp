@@ -0,0 +1,93 @@
+﻿#include "JobSystem.h"
+#include "MathUtility.h"
+#include "NormalSmoother.h"
+#include "TestUtility.h"
+#include <cmath>
+#include <unordered_map>
+#include <vector>
+
+// 角毎に頂点を複製した約100万頂点のメッシュで、従来のハッシュマップ版と比べる
+
+namespace {
+
+struct Vertex {
+	Vector3 position;
+	Vector3 normal;
+	float uv[2];
+};
+
+} // namespace
+
+int main() {
+	const uint32_t kRings = 409;
+	const uint32_t kSegments = 408;
+	const float kPi = 3.14159265f;
+	std::vector<Vector3> positions;
+	for (uint32_t i = 0; i <= kRings; i++) {
+		for (uint32_t j = 0; j <= kSegments; j++) {
+			float theta = kPi * static_cast<float>(i) / kRings;
+			float phi = 2.0f * kPi * static_cast<float>(j) / kSegments;
+			positions.push_back(
+			  {std::sin(theta) * std::cos(phi), std::cos(theta), std::sin(theta) * std::sin(phi)});
+		}
+	}
+	std::vector<Vertex> source;
+	std::vector<uint32_t> keys;
+	std::vector<uint32_t> indices;
+	for (uint32_t i = 0; i < kRings; i++) {
+		for (uint32_t j = 0; j < kSegments; j++) {
+			uint32_t a = i * (kSegments + 1) + j;
+			uint32_t b = a + kSegments + 1;
+			for (uint32_t key : {a, b + 1, b, a, a + 1, b + 1}) {
+				indices.push_back(static_cast<uint32_t>(source.size()));
+				keys.push_back(key);
+				source.push_back({positions[key], positions[key], {0.0f, 0.0f}});
+			}
+		}
+	}
+	std::printf("%zu corners, %zu positions\n", source.size(), positions.size());
+
+	std::vector<Vertex> vertices;
+	double map = Test::MeasureMicroseconds(3, [&] {
+		vertices = source;
+		std::unordered_map<uint32_t, std::vector<uint32_t>> smoothData;
+		for (uint32_t v = 0; v < vertices.size(); v++) {
+			smoothData[keys[v]].push_back(v);
+		}
+		for (const auto& [key, list] : smoothData) {
+			Vector3 normal = {0.0f, 0.0f, 0.0f};
+			for (uint32_t v : list) {
+				normal = Add(normal, vertices[v].normal);
+			}
+			normal = Normalize(normal);
+			for (uint32_t v : list) {
+				vertices[v].normal = normal;
+			}
+		}
+	});
+	std::printf("map                %7.2f ms\n", map / 1000.0);
+
+	auto measure = [&](const char* label, NormalSmoother::Weighting weighting) {
+		double time = Test::MeasureMicroseconds(3, [&] {
+			vertices = source;
+			NormalSmoother::VertexInput input;
+			input.positionKeys = keys.data();
+			input.positions = &vertices[0].position;
+			input.positionStride = sizeof(Vertex);
+			input.normals = &vertices[0].normal;
+			input.normalStride = sizeof(Vertex);
+			input.vertexCount = static_cast<uint32_t>(vertices.size());
+			input.indices = indices.data();
+			input.indexCount = indices.size();
+			NormalSmoother::Smooth(input, weighting);
+		});
+		std::printf("%-18s %7.2f ms (%.1fx)\n", label, time / 1000.0, map / time);
+	};
+	measure("average", NormalSmoother::Weighting::kAverage);
+	measure("area-angle", NormalSmoother::Weighting::kAreaAngle);
+	JobSystem::GetInstance()->Initialize();
+	measure("average (jobs)", NormalSmoother::Weighting::kAverage);
+	measure("area-angle (jobs)", NormalSmoother::Weighting::kAreaAngle);
+	JobSystem::GetInstance()->Finalize();
+	return 0;
+}
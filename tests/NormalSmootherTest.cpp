@@ -0,0 +1,183 @@
+﻿#include "JobSystem.h"
+#include "MathUtility.h"
+#include "NormalSmoother.h"
+#include "TestMesh.h"
+#include "TestUtility.h"
+#include <cmath>
+#include <random>
+#include <unordered_map>
+#include <vector>
+
+namespace {
+
+// 頂点（座標と法線の間に別の要素を挟み、ストライドを確かめる）
+struct Vertex {
+	Vector3 position;
+	float uv[2];
+	Vector3 normal;
+};
+
+// 角毎に頂点を複製した格子状の球。法線は少し乱しておく
+void MakeNoisySphere(
+  uint32_t rings, uint32_t segments, uint32_t keyBase, std::vector<Vertex>& vertices,
+  std::vector<uint32_t>& keys, std::vector<uint32_t>& indices) {
+	std::vector<Test::MeshVertex> grid;
+	std::vector<uint32_t> gridIndices;
+	Test::MakeSphere(rings, segments, 0.0f, grid, gridIndices);
+	std::mt19937 random(1);
+	std::uniform_real_distribution<float> noise(-0.1f, 0.1f);
+	for (uint32_t key : gridIndices) {
+		const Vector3& p = grid[key].position;
+		indices.push_back(static_cast<uint32_t>(vertices.size()));
+		keys.push_back(keyBase + key);
+		Vector3 offset = {noise(random), noise(random), noise(random)};
+		vertices.push_back({p, {0.0f, 0.0f}, Normalize(Add(p, offset))});
+	}
+}
+
+NormalSmoother::VertexInput MakeInput(
+  std::vector<Vertex>& vertices, const std::vector<uint32_t>& keys,
+  const std::vector<uint32_t>& indices) {
+	NormalSmoother::VertexInput input;
+	input.positionKeys = keys.data();
+	input.positions = &vertices[0].position;
+	input.positionStride = sizeof(Vertex);
+	input.normals = &vertices[0].normal;
+	input.normalStride = sizeof(Vertex);
+	input.vertexCount = static_cast<uint32_t>(vertices.size());
+	input.indices = indices.data();
+	input.indexCount = indices.size();
+	return input;
+}
+
+// 従来の処理（座標番号→頂点番号一覧のハッシュマップで平均する）
+void SmoothWithMap(std::vector<Vertex>& vertices, const std::vector<uint32_t>& keys) {
+	std::unordered_map<uint32_t, std::vector<uint32_t>> smoothData;
+	for (uint32_t v = 0; v < vertices.size(); v++) {
+		if (keys[v] != NormalSmoother::kNoPositionKey) {
+			smoothData[keys[v]].push_back(v);
+		}
+	}
+	for (const auto& [key, list] : smoothData) {
+		Vector3 normal = {0.0f, 0.0f, 0.0f};
+		for (uint32_t v : list) {
+			normal = Add(normal, vertices[v].normal);
+		}
+		normal = Normalize(Multiply(1.0f / static_cast<float>(list.size()), normal));
+		for (uint32_t v : list) {
+			vertices[v].normal = normal;
+		}
+	}
+}
+
+float MaxDifference(const std::vector<Vertex>& a, const std::vector<Vertex>& b) {
+	float difference = 0.0f;
+	for (size_t v = 0; v < a.size(); v++) {
+		difference = (std::max)(difference, Length(Subtract(a[v].normal, b[v].normal)));
+	}
+	return difference;
+}
+
+// 平均は従来の処理と誤差の範囲で一致する（並列化の閾値の前後どちらでも）
+void TestAverageMatchesMap() {
+	JobSystem::GetInstance()->Initialize(3);
+	for (uint32_t size : {8u, 130u}) {
+		std::vector<Vertex> vertices;
+		std::vector<uint32_t> keys;
+		std::vector<uint32_t> indices;
+		// 座標番号はファイル全体の通し番号なので0から始まるとは限らない
+		MakeNoisySphere(size, size, 1000, vertices, keys, indices);
+		// 一部の頂点は平滑化しない
+		for (size_t v = 0; v < keys.size(); v += 97) {
+			keys[v] = NormalSmoother::kNoPositionKey;
+		}
+
+		std::vector<Vertex> expected = vertices;
+		SmoothWithMap(expected, keys);
+		NormalSmoother::Smooth(MakeInput(vertices, keys, indices));
+		CHECK(MaxDifference(vertices, expected) < 1e-5f);
+	}
+	JobSystem::GetInstance()->Finalize();
+}
+
+// 面積と角で重み付けすると、立方体の角の法線は分割の仕方によらず対角線方向になる
+void TestAreaAngleCube() {
+	const uint32_t faces[6][4] = {{0, 2, 3, 1}, {4, 5, 7, 6}, {0, 1, 5, 4},
+	                              {2, 6, 7, 3}, {0, 4, 6, 2}, {1, 3, 7, 5}};
+	auto corner = [](uint32_t i) {
+		return Vector3{(i & 1) ? 1.0f : -1.0f, (i & 2) ? 1.0f : -1.0f, (i & 4) ? 1.0f : -1.0f};
+	};
+	std::vector<Vertex> vertices;
+	std::vector<uint32_t> keys;
+	std::vector<uint32_t> indices;
+	for (const auto& face : faces) {
+		uint32_t base = static_cast<uint32_t>(vertices.size());
+		for (uint32_t i : face) {
+			vertices.push_back({corner(i), {0.0f, 0.0f}, {0.0f, 0.0f, 0.0f}});
+			keys.push_back(i);
+		}
+		indices.insert(indices.end(), {base, base + 1, base + 2, base, base + 2, base + 3});
+	}
+	NormalSmoother::Smooth(
+	  MakeInput(vertices, keys, indices), NormalSmoother::Weighting::kAreaAngle);
+
+	// 向きは巻き順で決まるので、全ての角で同じ向きかだけを見る
+	float sign = Dot(vertices[0].normal, corner(keys[0])) > 0.0f ? 1.0f : -1.0f;
+	uint32_t wrongCount = 0;
+	for (size_t v = 0; v < vertices.size(); v++) {
+		Vector3 expected = Multiply(sign / std::sqrt(3.0f), corner(keys[v]));
+		wrongCount += Length(Subtract(vertices[v].normal, expected)) > 1e-5f;
+	}
+	CHECK(wrongCount == 0);
+}
+
+// 面積と角の重み付けでも、同じ座標番号の頂点は同じ法線になり、並列でも結果は変わらない
+void TestAreaAngleSphere() {
+	std::vector<Vertex> vertices;
+	std::vector<uint32_t> keys;
+	std::vector<uint32_t> indices;
+	MakeNoisySphere(130, 130, 0, vertices, keys, indices);
+	std::vector<Vertex> serial = vertices;
+	NormalSmoother::Smooth(
+	  MakeInput(serial, keys, indices), NormalSmoother::Weighting::kAreaAngle);
+
+	JobSystem::GetInstance()->Initialize(3);
+	NormalSmoother::Smooth(
+	  MakeInput(vertices, keys, indices), NormalSmoother::Weighting::kAreaAngle);
+	JobSystem::GetInstance()->Finalize();
+	CHECK(MaxDifference(vertices, serial) == 0.0f);
+
+	// 球なので、極付近を除けば法線は座標とほぼ同じ向き
+	std::vector<Vector3> normalOfKey(keys.size());
+	uint32_t wrongCount = 0;
+	for (size_t v = 0; v < vertices.size(); v++) {
+		if (normalOfKey[keys[v]].x == 0.0f && normalOfKey[keys[v]].y == 0.0f &&
+		    normalOfKey[keys[v]].z == 0.0f) {
+			normalOfKey[keys[v]] = vertices[v].normal;
+		}
+		wrongCount += Length(Subtract(normalOfKey[keys[v]], vertices[v].normal)) != 0.0f;
+		if (std::fabs(vertices[v].position.y) < 0.95f) {
+			wrongCount += std::fabs(Dot(vertices[v].normal, vertices[v].position)) < 0.999f;
+		}
+	}
+	CHECK(wrongCount == 0);
+}
+
+// 平滑化しない頂点だけなら何もしない
+void TestNoKeys() {
+	std::vector<Vertex> vertices = {{{0.0f, 0.0f, 0.0f}, {0.0f, 0.0f}, {0.0f, 2.0f, 0.0f}}};
+	std::vector<uint32_t> keys = {NormalSmoother::kNoPositionKey};
+	std::vector<uint32_t> indices;
+	NormalSmoother::Smooth(MakeInput(vertices, keys, indices));
+	CHECK(vertices[0].normal.y == 2.0f);
+}
+
+} // namespace
+
+int main() {
+	TestAverageMatchesMap();
+	TestAreaAngleCube();
+	TestAreaAngleSphere();
+	TestNoKeys();
+	return Test::Finish("NormalSmootherTest");
+}
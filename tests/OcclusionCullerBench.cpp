@@ -0,0 +1,83 @@
+﻿#include "JobSystem.h"
+#include "OcclusionCuller.h"
+#include "TestMath.h"
+#include "TestUtility.h"
+#include <random>
+#include <vector>
+
+// 遮蔽物2000個の描画と、1万個の隠れ判定の時間を1スレッドとワーカーありで測る
+// （目安はフレームあたり1ms）
+
+namespace {
+
+OccluderMesh MakeCube() {
+	OccluderMesh cube;
+	for (int i = 0; i < 8; i++) {
+		cube.positions.push_back(
+		  {(i & 1) ? 1.0f : -1.0f, (i & 2) ? 1.0f : -1.0f, (i & 4) ? 1.0f : -1.0f});
+	}
+	const uint32_t faces[6][4] = {{0, 2, 3, 1}, {4, 5, 7, 6}, {0, 1, 5, 4},
+	                              {2, 6, 7, 3}, {0, 4, 6, 2}, {1, 3, 7, 5}};
+	for (const auto& face : faces) {
+		cube.indices.insert(
+		  cube.indices.end(), {face[0], face[1], face[2], face[0], face[2], face[3]});
+	}
+	return cube;
+}
+
+} // namespace
+
+int main() {
+	const uint32_t kOccluderCount = 2000;
+	const uint32_t kTestCount = 10000;
+	std::mt19937 random(1);
+	std::uniform_real_distribution<float> position(-200.0f, 200.0f);
+	std::uniform_real_distribution<float> size(1.0f, 6.0f);
+
+	OccluderMesh cube = MakeCube();
+	std::vector<Matrix4x4> occluders(kOccluderCount);
+	for (Matrix4x4& matWorld : occluders) {
+		matWorld = Multiply(
+		  Test::MakeScale({size(random), size(random), size(random)}),
+		  Test::MakeTranslation({position(random), 0.0f, position(random)}));
+	}
+	std::vector<AABB> boxes(kTestCount);
+	for (AABB& box : boxes) {
+		Vector3 center = {position(random), 0.0f, position(random)};
+		box = {
+		  {center.x - 1.0f, center.y - 1.0f, center.z - 1.0f},
+		  {center.x + 1.0f, center.y + 1.0f, center.z + 1.0f}};
+	}
+	Matrix4x4 viewProjection = Multiply(
+	  Test::MakeLookAt({0.0f, 2.0f, -250.0f}, {0.0f, 0.0f, 0.0f}, {0.0f, 1.0f, 0.0f}),
+	  Test::MakePerspective(0.8f, 16.0f / 9.0f, 0.1f, 1000.0f));
+
+	auto measure = [&](const char* label) {
+		OcclusionCuller culler;
+		culler.Initialize();
+		double render = Test::MeasureMicroseconds(10, [&] {
+			culler.BeginFrame(viewProjection);
+			for (const Matrix4x4& matWorld : occluders) {
+				culler.AddOccluder(&cube, matWorld);
+			}
+			culler.Render();
+		});
+		uint32_t occludedCount = 0;
+		double test = Test::MeasureMicroseconds(10, [&] {
+			occludedCount = 0;
+			for (const AABB& box : boxes) {
+				occludedCount += !culler.IsVisible(box);
+			}
+		});
+		std::printf(
+		  "%-9s render %.3f ms (%u triangles), %u tests %.3f ms (%u occluded)\n", label,
+		  render / 1000.0, culler.GetStatistics().rasterizedTriangleCount, kTestCount,
+		  test / 1000.0, occludedCount);
+	};
+
+	measure("serial");
+	JobSystem::GetInstance()->Initialize();
+	measure("jobs");
+	JobSystem::GetInstance()->Finalize();
+	return 0;
+}
@@ -0,0 +1,255 @@
+﻿#include "JobSystem.h"
+#include "OcclusionCuller.h"
+#include "TestMath.h"
+#include "TestUtility.h"
+#include <algorithm>
+#include <random>
+#include <vector>
+
+namespace {
+
+const float kFovAngleY = 0.8f;
+const float kAspectRatio = 2.0f;
+
+// 立方体（-1～1）。外から見て時計回り
+OccluderMesh MakeCube() {
+	OccluderMesh cube;
+	for (int i = 0; i < 8; i++) {
+		cube.positions.push_back(
+		  {(i & 1) ? 1.0f : -1.0f, (i & 2) ? 1.0f : -1.0f, (i & 4) ? 1.0f : -1.0f});
+	}
+	const uint32_t faces[6][4] = {{0, 2, 3, 1}, {4, 5, 7, 6}, {0, 1, 5, 4},
+	                              {2, 6, 7, 3}, {0, 4, 6, 2}, {1, 3, 7, 5}};
+	for (const auto& face : faces) {
+		cube.indices.insert(
+		  cube.indices.end(), {face[0], face[1], face[2], face[0], face[2], face[3]});
+	}
+	return cube;
+}
+
+// 原点から+Z向きのカメラ
+Matrix4x4 MakeViewProjection() {
+	return Test::MakePerspective(kFovAngleY, kAspectRatio, 0.1f, 1000.0f);
+}
+
+AABB MakeBox(const Vector3& min, const Vector3& max) { return {min, max}; }
+
+// 壁（中心と半分の大きさ）
+struct Wall {
+	Vector3 center;
+	Vector3 halfSize;
+};
+
+Matrix4x4 MakeWallMatrix(const Wall& wall) {
+	return Multiply(Test::MakeScale(wall.halfSize), Test::MakeTranslation(wall.center));
+}
+
+// 原点から点への視線が、いずれかの壁で確実に遮られるか
+// （ラスタライズの誤差を見込み、壁の縁からmarginPixel以内を通るものは遮られたとみなす）
+bool IsBlocked(const std::vector<Wall>& walls, const Vector3& point, float marginPixel) {
+	float pixelPerUnit = 0.5f / std::tan(kFovAngleY * 0.5f) *
+	                     static_cast<float>(OcclusionCuller::kDefaultHeight);
+	for (const Wall& wall : walls) {
+		// 壁の奥の面の距離での余白だけ、壁を上下左右に広げる
+		float margin = marginPixel / pixelPerUnit * (wall.center.z + wall.halfSize.z);
+		Vector3 halfSize = {wall.halfSize.x + margin, wall.halfSize.y + margin, wall.halfSize.z};
+		// 原点から点までの線分と、広げた壁の交差（スラブ法）
+		const float* center = &wall.center.x;
+		const float* size = &halfSize.x;
+		const float* direction = &point.x;
+		float tNear = 0.0f;
+		float tFar = 1.0f;
+		for (int axis = 0; axis < 3; axis++) {
+			float inverse = 1.0f / direction[axis];
+			float t0 = (center[axis] - size[axis]) * inverse;
+			float t1 = (center[axis] + size[axis]) * inverse;
+			tNear = (std::max)(tNear, (std::min)(t0, t1));
+			tFar = (std::min)(tFar, (std::max)(t0, t1));
+		}
+		if (tNear <= tFar) {
+			return true;
+		}
+	}
+	return false;
+}
+
+// 点が画面内にあるか（画面外は視錐台カリングの担当）
+bool IsOnScreen(const Vector3& point) {
+	float tanHalfFov = std::tan(kFovAngleY * 0.5f);
+	return point.z > 0.0f && std::fabs(point.y) <= point.z * tanHalfFov &&
+	       std::fabs(point.x) <= point.z * tanHalfFov * kAspectRatio;
+}
+
+// 箱の表面のどこかが画面内で壁に遮られずに見えているか
+bool HasVisiblePoint(const std::vector<Wall>& walls, const AABB& box) {
+	const int kSteps = 6;
+	for (int i = 0; i <= kSteps; i++) {
+		for (int j = 0; j <= kSteps; j++) {
+			for (int k = 0; k <= kSteps; k++) {
+				// 表面の点だけ調べる
+				if (i != 0 && i != kSteps && j != 0 && j != kSteps && k != 0 && k != kSteps) {
+					continue;
+				}
+				Vector3 point = {
+				  box.min.x + (box.max.x - box.min.x) * static_cast<float>(i) / kSteps,
+				  box.min.y + (box.max.y - box.min.y) * static_cast<float>(j) / kSteps,
+				  box.min.z + (box.max.z - box.min.z) * static_cast<float>(k) / kSteps};
+				if (IsOnScreen(point) && !IsBlocked(walls, point, 2.0f)) {
+					return true;
+				}
+			}
+		}
+	}
+	return false;
+}
+
+// 壁1枚の前後や周りの箱を判定する
+void TestSingleWall() {
+	OccluderMesh cube = MakeCube();
+	OcclusionCuller culler;
+	culler.Initialize();
+
+	// 何も描いていなければ全て見える
+	culler.BeginFrame(MakeViewProjection());
+	culler.Render();
+	CHECK(culler.IsVisible(MakeBox({-1.0f, -1.0f, 40.0f}, {1.0f, 1.0f, 42.0f})));
+
+	culler.BeginFrame(MakeViewProjection());
+	culler.AddOccluder(&cube, MakeWallMatrix({{0.0f, 0.0f, 20.0f}, {5.0f, 5.0f, 1.0f}}));
+	culler.Render();
+	CHECK(culler.GetStatistics().occluderTriangleCount == 12);
+
+	// 壁の真後ろの小さい箱は隠れる
+	CHECK(!culler.IsVisible(MakeBox({-1.0f, -1.0f, 40.0f}, {1.0f, 1.0f, 42.0f})));
+	// 壁の手前面より奥なら、壁の中でも隠れる
+	CHECK(!culler.IsVisible(MakeBox({-1.0f, -1.0f, 19.5f}, {1.0f, 1.0f, 20.5f})));
+	// 壁より手前は見える
+	CHECK(culler.IsVisible(MakeBox({-1.0f, -1.0f, 5.0f}, {1.0f, 1.0f, 7.0f})));
+	// 壁の後ろでも横にずれていれば見える
+	CHECK(culler.IsVisible(MakeBox({30.0f, -1.0f, 40.0f}, {32.0f, 1.0f, 42.0f})));
+	// 一部が壁からはみ出していれば見える
+	CHECK(culler.IsVisible(MakeBox({6.0f, -1.0f, 40.0f}, {14.0f, 1.0f, 42.0f})));
+	// 壁より大きければ見える
+	CHECK(culler.IsVisible(MakeBox({-100.0f, -1.0f, 40.0f}, {100.0f, 1.0f, 42.0f})));
+	// ニア面をまたぐものは見える
+	CHECK(culler.IsVisible(MakeBox({-1.0f, -1.0f, -5.0f}, {1.0f, 1.0f, 50.0f})));
+
+	OcclusionCuller::Statistics statistics = culler.GetStatistics();
+	CHECK(statistics.testCount == 7);
+	CHECK(statistics.occludedCount == 2);
+}
+
+// 2枚の壁の隙間から見えるものは隠れない
+void TestGap() {
+	OccluderMesh cube = MakeCube();
+	OcclusionCuller culler;
+	culler.Initialize();
+	culler.BeginFrame(MakeViewProjection());
+	culler.AddOccluder(&cube, MakeWallMatrix({{-6.0f, 0.0f, 20.0f}, {5.0f, 5.0f, 0.5f}}));
+	culler.AddOccluder(&cube, MakeWallMatrix({{6.0f, 0.0f, 20.0f}, {5.0f, 5.0f, 0.5f}}));
+	culler.Render();
+
+	CHECK(culler.IsVisible(MakeBox({-0.2f, -0.2f, 40.0f}, {0.2f, 0.2f, 41.0f})));
+	CHECK(!culler.IsVisible(MakeBox({-8.0f, -1.0f, 40.0f}, {-6.0f, 1.0f, 41.0f})));
+	CHECK(!culler.IsVisible(MakeBox({6.0f, -1.0f, 40.0f}, {8.0f, 1.0f, 41.0f})));
+}
+
+// ニア面をまたぐ遮蔽物もクリップして描ける
+void TestNearClip() {
+	OccluderMesh cube = MakeCube();
+	OcclusionCuller culler;
+	culler.Initialize();
+	culler.BeginFrame(MakeViewProjection());
+	// 床のように手前から奥まで続く板
+	culler.AddOccluder(&cube, MakeWallMatrix({{0.0f, -2.0f, 40.0f}, {50.0f, 0.5f, 50.0f}}));
+	culler.Render();
+	CHECK(culler.GetStatistics().rasterizedTriangleCount > 0);
+	// 床の下は隠れ、床の上は見える
+	CHECK(!culler.IsVisible(MakeBox({-1.0f, -6.0f, 30.0f}, {1.0f, -4.0f, 32.0f})));
+	CHECK(culler.IsVisible(MakeBox({-1.0f, 0.0f, 30.0f}, {1.0f, 2.0f, 32.0f})));
+}
+
+// ランダムな壁と箱で、隠れたと判定した箱に見えている点が無いか調べる
+void TestConservative(uint32_t seed) {
+	OccluderMesh cube = MakeCube();
+	std::mt19937 random(seed);
+	std::uniform_real_distribution<float> wallX(-30.0f, 30.0f);
+	std::uniform_real_distribution<float> wallY(-10.0f, 10.0f);
+	std::uniform_real_distribution<float> wallZ(10.0f, 60.0f);
+	std::uniform_real_distribution<float> wallSize(1.0f, 8.0f);
+	std::uniform_real_distribution<float> boxX(-40.0f, 40.0f);
+	std::uniform_real_distribution<float> boxY(-15.0f, 15.0f);
+	std::uniform_real_distribution<float> boxZ(15.0f, 100.0f);
+	std::uniform_real_distribution<float> boxSize(0.3f, 3.0f);
+
+	OcclusionCuller culler;
+	culler.Initialize();
+	uint32_t occludedCount = 0;
+	uint32_t wrongCount = 0;
+	for (int frame = 0; frame < 20; frame++) {
+		std::vector<Wall> walls;
+		culler.BeginFrame(MakeViewProjection());
+		for (int i = 0; i < 30; i++) {
+			Wall wall = {
+			  {wallX(random), wallY(random), wallZ(random)},
+			  {wallSize(random), wallSize(random), 0.5f}};
+			walls.push_back(wall);
+			culler.AddOccluder(&cube, MakeWallMatrix(wall));
+		}
+		culler.Render();
+		for (int i = 0; i < 200; i++) {
+			Vector3 center = {boxX(random), boxY(random), boxZ(random)};
+			float halfSize = boxSize(random);
+			AABB box = {
+			  {center.x - halfSize, center.y - halfSize, center.z - halfSize},
+			  {center.x + halfSize, center.y + halfSize, center.z + halfSize}};
+			if (!culler.IsVisible(box)) {
+				occludedCount++;
+				wrongCount += HasVisiblePoint(walls, box);
+			}
+		}
+	}
+	CHECK(wrongCount == 0);
+	// 何も隠さない実装でも通ってしまわないように
+	CHECK(occludedCount > 400);
+}
+
+// ワーカースレッドで描いても、1スレッドで描いた深度バッファと一致する
+void TestThreadedMatchesSerial() {
+	OccluderMesh cube = MakeCube();
+	std::mt19937 random(3);
+	std::uniform_real_distribution<float> position(-100.0f, 100.0f);
+	std::uniform_real_distribution<float> depth(5.0f, 300.0f);
+
+	auto render = [&](OcclusionCuller& culler) {
+		random.seed(3);
+		culler.Initialize();
+		culler.BeginFrame(MakeViewProjection());
+		for (int i = 0; i < 500; i++) {
+			Wall wall = {{position(random), 0.0f, depth(random)}, {3.0f, 10.0f, 3.0f}};
+			culler.AddOccluder(&cube, MakeWallMatrix(wall));
+		}
+		culler.Render();
+	};
+
+	OcclusionCuller serial;
+	render(serial);
+	JobSystem::GetInstance()->Initialize(3);
+	OcclusionCuller threaded;
+	render(threaded);
+	JobSystem::GetInstance()->Finalize();
+	CHECK(serial.GetDepthBuffer() == threaded.GetDepthBuffer());
+}
+
+} // namespace
+
+int main() {
+	TestSingleWall();
+	TestGap();
+	TestNearClip();
+	for (uint32_t seed = 1; seed <= 5; seed++) {
+		TestConservative(seed);
+	}
+	TestThreadedMatchesSerial();
+	return Test::Finish("OcclusionCullerTest");
+}
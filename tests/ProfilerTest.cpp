@@ -0,0 +1,346 @@
+﻿#include "JobSystem.h"
+#include "Profiler.h"
+#include "TestUtility.h"
+#include <algorithm>
+#include <atomic>
+#include <cctype>
+#include <cstring>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace {
+
+// 最新のフレームの、名前が一致する区間
+std::vector<Profiler::Event> FindEvents(const char* name) {
+	Profiler* profiler = Profiler::GetInstance();
+	const Profiler::Frame& frame = profiler->GetFrame(profiler->GetFrameCount() - 1);
+	std::vector<Profiler::Event> events;
+	for (const Profiler::Event& event : frame.cpuEvents) {
+		if (std::strcmp(event.name, name) == 0) {
+			events.push_back(event);
+		}
+	}
+	return events;
+}
+
+// 入れ子の区間は深さが付き、外側が内側を含み、開始時刻順に並ぶ
+void TestNestedScopes() {
+	Profiler* profiler = Profiler::GetInstance();
+	profiler->BeginFrame();
+	{
+		PROFILE_SCOPE("Outer");
+		{
+			PROFILE_SCOPE("Middle");
+			PROFILE_SCOPE("Inner");
+		}
+		PROFILE_SCOPE("Second");
+		// 時刻を指定した区間は、今の深さで積まれる
+		uint64_t now = Profiler::GetTime();
+		profiler->Record("Recorded", now, now + 1000);
+	}
+	profiler->EndFrame();
+
+	std::vector<Profiler::Event> outer = FindEvents("Outer");
+	std::vector<Profiler::Event> middle = FindEvents("Middle");
+	std::vector<Profiler::Event> inner = FindEvents("Inner");
+	std::vector<Profiler::Event> second = FindEvents("Second");
+	std::vector<Profiler::Event> recorded = FindEvents("Recorded");
+	CHECK(outer.size() == 1 && middle.size() == 1 && inner.size() == 1);
+	CHECK(second.size() == 1 && recorded.size() == 1);
+	if (outer.size() != 1 || middle.size() != 1 || inner.size() != 1 || second.size() != 1 ||
+	    recorded.size() != 1) {
+		return;
+	}
+	CHECK(outer[0].depth == 0 && middle[0].depth == 1 && inner[0].depth == 2);
+	CHECK(second[0].depth == 1 && recorded[0].depth == 2);
+	CHECK(outer[0].begin <= middle[0].begin && middle[0].begin <= inner[0].begin);
+	CHECK(inner[0].end <= middle[0].end && middle[0].end <= second[0].begin);
+	CHECK(second[0].end <= outer[0].end);
+	CHECK(recorded[0].end - recorded[0].begin == 1000);
+
+	// 終了順に積まれても、回収後は開始時刻順（同時刻は外側が先）
+	const Profiler::Frame& frame = profiler->GetFrame(profiler->GetFrameCount() - 1);
+	uint32_t wrongCount = 0;
+	for (size_t i = 1; i < frame.cpuEvents.size(); i++) {
+		const Profiler::Event& a = frame.cpuEvents[i - 1];
+		const Profiler::Event& b = frame.cpuEvents[i];
+		if (a.threadIndex == b.threadIndex) {
+			wrongCount += a.begin > b.begin || (a.begin == b.begin && a.depth > b.depth);
+		}
+	}
+	CHECK(wrongCount == 0);
+	CHECK(frame.begin <= outer[0].begin && outer[0].end <= frame.end);
+}
+
+// スレッド毎に別のバッファへ書き込み、全て回収される。溢れた分は捨てて数える
+void TestThreads() {
+	Profiler* profiler = Profiler::GetInstance();
+	const uint32_t kThreadCount = 4;
+	const uint32_t kEventCount = 1000;
+	const uint32_t kOverflow = 100;
+	// スレッド毎の目印（名前は寿命の長い文字列にする）
+	const char* const kMarkers[kThreadCount + 1] = {
+	  "Marker 0", "Marker 1", "Marker 2", "Marker 3", "Marker 4"};
+	Profiler::Statistics before = profiler->GetStatistics();
+
+	profiler->BeginFrame();
+	std::vector<std::thread> threads;
+	for (uint32_t t = 0; t <= kThreadCount; t++) {
+		threads.emplace_back([t, &kMarkers, profiler]() {
+			profiler->SetThreadName("Test " + std::to_string(t));
+			// 最後のスレッドは回収前にバッファを一周以上書く
+			uint32_t count =
+			  t < kThreadCount ? kEventCount : Profiler::kEventCountPerThread + kOverflow;
+			for (uint32_t i = 0; i < count; i++) {
+				PROFILE_SCOPE("Work");
+			}
+			uint64_t now = Profiler::GetTime();
+			profiler->Record(kMarkers[t], now, now);
+		});
+	}
+	for (std::thread& thread : threads) {
+		thread.join();
+	}
+	profiler->EndFrame();
+
+	std::vector<Profiler::Event> work = FindEvents("Work");
+	std::vector<uint32_t> indices;
+	uint32_t wrongCount = 0;
+	for (uint32_t t = 0; t <= kThreadCount; t++) {
+		std::vector<Profiler::Event> marker = FindEvents(kMarkers[t]);
+		CHECK(marker.size() == 1);
+		if (marker.size() != 1) {
+			return;
+		}
+		uint32_t index = marker[0].threadIndex;
+		indices.push_back(index);
+		wrongCount += profiler->GetThreadName(index) != "Test " + std::to_string(t);
+		uint32_t count = 0;
+		for (const Profiler::Event& event : work) {
+			count += event.threadIndex == index;
+		}
+		// 溢れたスレッドは最新の区間だけが残る（目印の分1つ少ない）
+		uint32_t expected = t < kThreadCount ? kEventCount : Profiler::kEventCountPerThread - 1;
+		wrongCount += count != expected;
+	}
+	CHECK(wrongCount == 0);
+	// スレッド毎に別の番号
+	std::sort(indices.begin(), indices.end());
+	CHECK(std::unique(indices.begin(), indices.end()) == indices.end());
+
+	Profiler::Statistics after = profiler->GetStatistics();
+	CHECK(after.droppedEventCount - before.droppedEventCount == kOverflow + 1);
+	CHECK(
+	  after.recordedEventCount - before.recordedEventCount ==
+	  kThreadCount * (kEventCount + 1) + Profiler::kEventCountPerThread);
+}
+
+// ジョブ毎の区間は既定では記録しない（JOB_SYSTEM_PROFILE_JOBSで有効にする）
+void TestJobsNotProfiled() {
+	Profiler* profiler = Profiler::GetInstance();
+	JobSystem::GetInstance()->Initialize(3);
+	profiler->BeginFrame();
+	std::atomic<uint32_t> sum{0};
+	JobSystem::GetInstance()->ParallelFor(
+	  1000, 10, [&sum](uint32_t begin, uint32_t end) { sum += end - begin; });
+	profiler->EndFrame();
+	JobSystem::GetInstance()->Finalize();
+	CHECK(sum == 1000);
+	CHECK(FindEvents("Job").empty());
+}
+
+// 最小限のJSONの読み取り（値を1つ読み飛ばし、文字列は中身を返す）
+class JsonReader {
+public:
+	explicit JsonReader(const std::string& text) : text_(text) {}
+
+	// 全体が1つの値として読めるか
+	bool Validate() {
+		SkipSpace();
+		if (!Value()) {
+			return false;
+		}
+		SkipSpace();
+		return position_ == text_.size();
+	}
+
+	// 読んだ文字列の一覧
+	const std::vector<std::string>& GetStrings() const { return strings_; }
+
+private:
+	bool Value() {
+		if (position_ >= text_.size()) {
+			return false;
+		}
+		char c = text_[position_];
+		if (c == '{') {
+			return Container('}', true);
+		}
+		if (c == '[') {
+			return Container(']', false);
+		}
+		if (c == '"') {
+			return String();
+		}
+		if (c == '-' || ('0' <= c && c <= '9')) {
+			return Number();
+		}
+		for (const char* literal : {"true", "false", "null"}) {
+			if (text_.compare(position_, std::strlen(literal), literal) == 0) {
+				position_ += std::strlen(literal);
+				return true;
+			}
+		}
+		return false;
+	}
+
+	bool Container(char close, bool object) {
+		position_++;
+		SkipSpace();
+		if (Peek() == close) {
+			position_++;
+			return true;
+		}
+		while (true) {
+			SkipSpace();
+			if (object) {
+				if (Peek() != '"' || !String()) {
+					return false;
+				}
+				SkipSpace();
+				if (Peek() != ':') {
+					return false;
+				}
+				position_++;
+				SkipSpace();
+			}
+			if (!Value()) {
+				return false;
+			}
+			SkipSpace();
+			if (Peek() == close) {
+				position_++;
+				return true;
+			}
+			if (Peek() != ',') {
+				return false;
+			}
+			position_++;
+		}
+	}
+
+	bool String() {
+		position_++;
+		std::string value;
+		while (position_ < text_.size()) {
+			char c = text_[position_++];
+			if (c == '"') {
+				strings_.push_back(value);
+				return true;
+			}
+			// 制御文字はエスケープが必要
+			if (static_cast<unsigned char>(c) < 0x20) {
+				return false;
+			}
+			if (c != '\\') {
+				value += c;
+				continue;
+			}
+			char escaped = Peek();
+			position_++;
+			if (escaped == 'u') {
+				if (position_ + 4 > text_.size()) {
+					return false;
+				}
+				value += static_cast<char>(std::stoi(text_.substr(position_, 4), nullptr, 16));
+				position_ += 4;
+			} else if (escaped == 'n') {
+				value += '\n';
+			} else if (escaped == '"' || escaped == '\\' || escaped == '/') {
+				value += escaped;
+			} else {
+				return false;
+			}
+		}
+		return false;
+	}
+
+	bool Number() {
+		size_t begin = position_;
+		if (Peek() == '-') {
+			position_++;
+		}
+		while (position_ < text_.size() &&
+		       (std::isdigit(static_cast<unsigned char>(text_[position_])) ||
+		        text_[position_] == '.')) {
+			position_++;
+		}
+		return position_ > begin;
+	}
+
+	char Peek() const { return position_ < text_.size() ? text_[position_] : '\0'; }
+
+	void SkipSpace() {
+		while (std::isspace(static_cast<unsigned char>(Peek()))) {
+			position_++;
+		}
+	}
+
+	const std::string& text_;
+	size_t position_ = 0;
+	std::vector<std::string> strings_;
+};
+
+// 書き出したトレースはJSONとして読め、エスケープが必要な名前も元に戻る
+void TestChromeTrace() {
+	Profiler* profiler = Profiler::GetInstance();
+	const char* const kName = "quote\" backslash\\ newline\n tab\t end";
+	profiler->BeginFrame();
+	{
+		PROFILE_SCOPE(kName);
+	}
+	profiler->EndFrame();
+	// GPUの区間も書き出す
+	uint64_t now = Profiler::GetTime();
+	Profiler::Event gpuEvent = {"GpuPass", now, now + 5000, Profiler::kGpuThreadIndex, 0};
+	profiler->AddGpuEvents(profiler->GetFrame(profiler->GetFrameCount() - 1).index, &gpuEvent, 1);
+
+	std::string trace = profiler->ExportChromeTrace();
+	JsonReader reader(trace);
+	CHECK(reader.Validate());
+	const std::vector<std::string>& strings = reader.GetStrings();
+	auto contains = [&strings](const std::string& value) {
+		return std::find(strings.begin(), strings.end(), value) != strings.end();
+	};
+	CHECK(contains(kName));
+	CHECK(contains("GpuPass"));
+	CHECK(contains("Test 3"));
+	CHECK(contains("traceEvents"));
+
+	// 区間の数は、全フレームの区間とフレーム自身の合計
+	size_t eventCount = 0;
+	for (uint32_t i = 0; i < profiler->GetFrameCount(); i++) {
+		const Profiler::Frame& frame = profiler->GetFrame(i);
+		eventCount += frame.cpuEvents.size() + frame.gpuEvents.size() + 1;
+	}
+	CHECK(static_cast<size_t>(std::count(strings.begin(), strings.end(), "X")) == eventCount);
+
+	// 一時停止中はフレームを回収しない
+	uint32_t frameCount = profiler->GetFrameCount();
+	profiler->SetPaused(true);
+	profiler->BeginFrame();
+	profiler->EndFrame();
+	CHECK(profiler->GetFrameCount() == frameCount);
+	profiler->SetPaused(false);
+}
+
+} // namespace
+
+int main() {
+	TestNestedScopes();
+	TestThreads();
+	TestJobsNotProfiled();
+	TestChromeTrace();
+	return Test::Finish("ProfilerTest");
+}
@@ -0,0 +1,192 @@
+﻿#include "ShadowCascade.h"
+#include "TestMath.h"
+#include "TestUtility.h"
+#include <cmath>
+#include <random>
+
+namespace {
+
+const Vector3 kLightDirection = {0.3f, -1.0f, 0.5f};
+
+// 原点付近から斜め下を見るカメラ
+ShadowCascadeCamera MakeCamera(const Vector3& eye, const Vector3& target) {
+	ShadowCascadeCamera camera;
+	camera.view = Test::MakeLookAt(eye, target, {0.0f, 1.0f, 0.0f});
+	camera.fovAngleY = 0.9f;
+	camera.aspectRatio = 16.0f / 9.0f;
+	camera.nearZ = 0.1f;
+	camera.farZ = 1000.0f;
+	return camera;
+}
+
+// 分割位置は手前から奥へ増え、両端は指定の深度。混合率で対数分割と均等分割の間を動く
+void TestSplits() {
+	const float kNear = 0.1f;
+	const float kFar = 200.0f;
+	for (uint32_t count = 1; count <= kMaxShadowCascades; count++) {
+		float uniform[kMaxShadowCascades + 1];
+		float logarithmic[kMaxShadowCascades + 1];
+		ComputeCascadeSplits(kNear, kFar, count, 0.0f, uniform);
+		ComputeCascadeSplits(kNear, kFar, count, 1.0f, logarithmic);
+		for (float lambda : {0.0f, 0.25f, 0.5f, 0.75f, 1.0f}) {
+			float splits[kMaxShadowCascades + 1];
+			ComputeCascadeSplits(kNear, kFar, count, lambda, splits);
+			CHECK(splits[0] == kNear);
+			CHECK(splits[count] == kFar);
+			for (uint32_t i = 1; i <= count; i++) {
+				CHECK(splits[i - 1] < splits[i]);
+			}
+			// 対数分割は均等分割より手前寄りで、混ぜるとその間に入る
+			for (uint32_t i = 1; i < count; i++) {
+				CHECK(logarithmic[i] <= splits[i] + 1e-4f && splits[i] <= uniform[i] + 1e-4f);
+			}
+		}
+		for (uint32_t i = 1; i < count; i++) {
+			// 均等分割は間隔が同じ、対数分割は比が同じ
+			CHECK_NEAR(uniform[i] - uniform[i - 1], (kFar - kNear) / count, 1e-3f);
+			CHECK_NEAR(
+			  logarithmic[i] / logarithmic[i - 1], std::pow(kFar / kNear, 1.0f / count), 1e-3f);
+		}
+	}
+}
+
+// 各カスケードの球は担当する深度範囲の視錐台の角を全て含み、シャドウマップの中に写る
+void TestBounds() {
+	ShadowCascadeSettings settings;
+	const Vector3 eye = {3.0f, 12.0f, -20.0f};
+	ShadowCascadeCamera camera = MakeCamera(eye, {0.0f, 0.0f, 30.0f});
+	ShadowCascade cascades[kMaxShadowCascades];
+	ComputeShadowCascades(settings, camera, kLightDirection, cascades);
+
+	// ビュー行列の列がカメラの軸
+	const auto& v = camera.view.m;
+	Vector3 right = {v[0][0], v[1][0], v[2][0]};
+	Vector3 up = {v[0][1], v[1][1], v[2][1]};
+	Vector3 forward = {v[0][2], v[1][2], v[2][2]};
+	float tanY = std::tan(camera.fovAngleY * 0.5f);
+	float tanX = tanY * camera.aspectRatio;
+
+	float previousFar = camera.nearZ;
+	for (uint32_t i = 0; i < settings.cascadeCount; i++) {
+		const ShadowCascade& cascade = cascades[i];
+		CHECK(cascade.splitNear == previousFar);
+		previousFar = cascade.splitFar;
+		float maxDistance = 0.0f;
+		uint32_t outsideCount = 0;
+		for (float z : {cascade.splitNear, cascade.splitFar}) {
+			for (float sx : {-1.0f, 1.0f}) {
+				for (float sy : {-1.0f, 1.0f}) {
+					Vector3 corner = Add(
+					  eye, Add(Multiply(z, forward),
+					           Add(Multiply(sx * z * tanX, right), Multiply(sy * z * tanY, up))));
+					float distance = Length(Subtract(corner, cascade.bounds.center));
+					maxDistance = (std::max)(maxDistance, distance);
+					// シャドウマップの範囲（xyは-1～1、深度は0～1）
+					Vector3 clip = Transform(corner, cascade.lightViewProjection);
+					outsideCount += std::fabs(clip.x) > 1.0f || std::fabs(clip.y) > 1.0f;
+					outsideCount += clip.z < -1e-5f || clip.z > 1.0f + 1e-5f;
+				}
+			}
+		}
+		std::printf(
+		  "  cascade %u: depth %.2f-%.2f radius %.3f (corners %.3f) texel %.5f\n", i,
+		  cascade.splitNear, cascade.splitFar, cascade.bounds.radius, maxDistance,
+		  cascade.texelSize);
+		CHECK(maxDistance <= cascade.bounds.radius * (1.0f + 1e-5f));
+		CHECK(outsideCount == 0);
+		// 余裕は半径の切り上げ分（1/16）程度に収まる
+		CHECK(cascade.bounds.radius - maxDistance < 0.1f);
+	}
+	CHECK(previousFar == settings.shadowDistance);
+}
+
+// カメラが回っても球の大きさは変わらず、動いても影はテクセル単位でしかずれない
+void TestTexelSnapping() {
+	ShadowCascadeSettings settings;
+	const Vector3 eye = {3.0f, 12.0f, -20.0f};
+	ShadowCascade reference[kMaxShadowCascades];
+	ComputeShadowCascades(
+	  settings, MakeCamera(eye, {0.0f, 0.0f, 30.0f}), kLightDirection, reference);
+	// 動かない点（影を受ける地面の1点）
+	const Vector3 point = {1.0f, 0.0f, 5.0f};
+	const float texelsPerUnit = static_cast<float>(settings.resolution) * 0.5f;
+
+	std::mt19937 random(1);
+	std::uniform_real_distribution<float> offset(-0.05f, 0.05f);
+	std::uniform_real_distribution<float> angle(-3.14159265f, 3.14159265f);
+	float maxFraction = 0.0f;
+	uint32_t wrongCount = 0;
+	for (uint32_t n = 0; n < 200; n++) {
+		// 少しだけ動かす
+		Vector3 movedEye = {eye.x + offset(random), eye.y + offset(random), eye.z + offset(random)};
+		Vector3 target = Add(movedEye, {0.0f, -12.0f, 50.0f});
+		// 回すだけ
+		if (n % 2 == 1) {
+			movedEye = eye;
+			float a = angle(random);
+			target = Add(eye, {std::sin(a) * 50.0f, -12.0f, std::cos(a) * 50.0f});
+		}
+		ShadowCascade cascades[kMaxShadowCascades];
+		ComputeShadowCascades(settings, MakeCamera(movedEye, target), kLightDirection, cascades);
+		for (uint32_t i = 0; i < settings.cascadeCount; i++) {
+			const ShadowCascade& cascade = cascades[i];
+			wrongCount += cascade.bounds.radius != reference[i].bounds.radius;
+			wrongCount += cascade.texelSize != reference[i].texelSize;
+			// 正射影の中心はテクセルの格子上
+			float centerTexel = cascade.lightProjection.m[3][0] * texelsPerUnit;
+			maxFraction = (std::max)(maxFraction, std::fabs(centerTexel - std::round(centerTexel)));
+			// 同じ点を写す位置のずれはテクセルの整数倍
+			Vector3 clip = Transform(point, cascade.lightViewProjection);
+			Vector3 referenceClip = Transform(point, reference[i].lightViewProjection);
+			for (float delta : {clip.x - referenceClip.x, clip.y - referenceClip.y}) {
+				float texels = delta * texelsPerUnit;
+				maxFraction = (std::max)(maxFraction, std::fabs(texels - std::round(texels)));
+			}
+		}
+	}
+	std::printf("  texel snapping: max fraction %.4f\n", maxFraction);
+	CHECK(wrongCount == 0);
+	CHECK(maxFraction < 0.02f);
+}
+
+// 影を落とす物の判定は、光源側にいくら離れた物も残し、反対側や横に外れた物は外す
+void TestCasterFrustum() {
+	ShadowCascadeSettings settings;
+	ShadowCascade cascades[kMaxShadowCascades];
+	ComputeShadowCascades(
+	  settings, MakeCamera({3.0f, 12.0f, -20.0f}, {0.0f, 0.0f, 30.0f}), kLightDirection,
+	  cascades);
+	Vector3 toLight = Multiply(-1.0f, Normalize(kLightDirection));
+	for (uint32_t i = 0; i < settings.cascadeCount; i++) {
+		const ShadowCascade& cascade = cascades[i];
+		const Sphere& bounds = cascade.bounds;
+		// 範囲の中の物
+		CHECK(IsShadowCaster(cascade, {bounds.center, 0.5f}));
+		// 光源側の近平面より手前（高い建物や上空の雲）
+		for (float distance : {2.0f, 10.0f, 1000.0f}) {
+			Vector3 center = Add(bounds.center, Multiply(bounds.radius * distance, toLight));
+			Vector3 clip = Transform(center, cascade.lightViewProjection);
+			CHECK(clip.z < 0.0f);
+			CHECK(IsShadowCaster(cascade, {center, 0.5f}));
+		}
+		// 光の進む側の奥は影を落とさない
+		Vector3 behind = Add(bounds.center, Multiply(-bounds.radius * 2.0f, toLight));
+		CHECK(!IsShadowCaster(cascade, {behind, 0.5f}));
+		// 横（ライト空間のx方向）に外れた物は、光源側にあっても外す
+		const auto& l = cascade.lightView.m;
+		Vector3 side = {l[0][0], l[1][0], l[2][0]};
+		Vector3 outside =
+		  Add(Add(bounds.center, Multiply(bounds.radius * 3.0f, side)), Multiply(50.0f, toLight));
+		CHECK(!IsShadowCaster(cascade, {outside, 0.5f}));
+	}
+}
+
+} // namespace
+
+int main() {
+	TestSplits();
+	TestBounds();
+	TestTexelSnapping();
+	TestCasterFrustum();
+	return Test::Finish("ShadowCascadeTest");
+}
@@ -0,0 +1,205 @@
+﻿#include "SoundBank.h"
+#include "TestUtility.h"
+#include "TestWave.h"
+#include "WaveParser.h"
+#include <cstddef>
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <string>
+#include <vector>
+
+namespace {
+
+using Test::WaveBuilder;
+
+// 波形データの先頭のバイトが番号になる波形
+SoundBank::Source MakeSource(const std::string& name, uint32_t size) {
+	SoundBank::Source source;
+	source.name = name;
+	source.format = {1, 2, 44100, 44100 * 4, 4, 16};
+	for (uint32_t i = 0; i < size; i++) {
+		source.data.push_back(static_cast<uint8_t>(i * 7 + name.size()));
+	}
+	source.frameCount = size / 4;
+	return source;
+}
+
+// 作ったバンクを開き、全ての波形を名前のハッシュで引ける
+void TestRoundTrip() {
+	std::vector<SoundBank::Source> sources;
+	for (uint32_t i = 0; i < 200; i++) {
+		// 長さがばらばらなので、波形データの境界揃えも確かめられる
+		sources.push_back(MakeSource("se/sound" + std::to_string(i) + ".wav", i * 4 + 4));
+	}
+	sources[3].loopStart = 0;
+	sources[3].loopEnd = 2;
+	sources[5].flags = SoundBank::kFlagKeepCompressed;
+	std::vector<uint8_t> file = SoundBank::Build(sources);
+	// 同じ入力からは同じファイルになる
+	CHECK(SoundBank::Build(sources) == file);
+
+	SoundBank bank;
+	CHECK(bank.Open(file.data(), file.size()));
+	CHECK(bank.GetEntryCount() == sources.size());
+	uint32_t wrongCount = 0;
+	for (const SoundBank::Source& source : sources) {
+		int32_t index = bank.Find(source.name);
+		if (index < 0) {
+			wrongCount++;
+			continue;
+		}
+		const SoundBank::Entry& entry = bank.GetEntry(index);
+		wrongCount += bank.GetName(index) != source.name;
+		wrongCount += entry.nameHash != SoundBank::HashName(source.name);
+		wrongCount += entry.dataOffset % SoundBank::kDataAlignment != 0;
+		wrongCount += entry.dataSize != source.data.size();
+		wrongCount += std::memcmp(bank.GetData(index), source.data.data(), entry.dataSize) != 0;
+		wrongCount += entry.format.blockAlign != 4 || entry.frameCount != source.frameCount;
+		wrongCount += entry.loopStart != source.loopStart || entry.loopEnd != source.loopEnd;
+		wrongCount += entry.flags != source.flags;
+	}
+	CHECK(wrongCount == 0);
+	// 索引はハッシュ順
+	for (uint32_t i = 1; i < bank.GetEntryCount(); i++) {
+		wrongCount += bank.GetEntry(i - 1).nameHash > bank.GetEntry(i).nameHash;
+	}
+	CHECK(wrongCount == 0);
+	// 無い名前、途中までの名前は見つからない
+	CHECK(bank.Find("se/sound200.wav") == -1);
+	CHECK(bank.Find("se/sound1") == -1);
+	CHECK(bank.Find("") == -1);
+
+	// 空のバンク
+	std::vector<uint8_t> empty = SoundBank::Build({});
+	SoundBank emptyBank;
+	CHECK(emptyBank.Open(empty.data(), empty.size()));
+	CHECK(emptyBank.GetEntryCount() == 0);
+	CHECK(emptyBank.Find("a.wav") == -1);
+}
+
+// ハッシュが衝突しても名前で見分ける
+void TestHashCollision() {
+	std::vector<uint8_t> file = SoundBank::Build({MakeSource("a.wav", 16), MakeSource("b.wav", 8)});
+	// 1つ目の索引のハッシュを2つ目と同じに書き換え、2つ目の名前と衝突させる（並びは崩れない）
+	SoundBank::Entry entries[2];
+	std::memcpy(entries, file.data() + sizeof(SoundBank::Header), sizeof(entries));
+	entries[0].nameHash = entries[1].nameHash;
+	std::memcpy(file.data() + sizeof(SoundBank::Header), entries, sizeof(entries));
+
+	SoundBank bank;
+	CHECK(bank.Open(file.data(), file.size()));
+	std::string_view first = bank.GetName(0);
+	std::string_view second = bank.GetName(1);
+	// 同じハッシュの先頭は名前が違うので飛ばし、2つ目を返す
+	CHECK(bank.Find(second) == 1);
+	// 書き換えた索引は本来のハッシュでは引けない
+	CHECK(bank.Find(first) == -1);
+	CHECK(bank.Find("c.wav") == -1);
+}
+
+// 壊れたファイルは開かない
+void TestCorrupt() {
+	std::vector<uint8_t> file = SoundBank::Build({MakeSource("a.wav", 16), MakeSource("b.wav", 8)});
+	SoundBank bank;
+	// 途中で切れている
+	for (size_t size : {size_t(0), sizeof(SoundBank::Header) - 1, sizeof(SoundBank::Header) + 8}) {
+		CHECK(!bank.Open(file.data(), size));
+	}
+	CHECK(!bank.Open(file.data(), file.size() - 1));
+	CHECK(bank.GetEntryCount() == 0);
+
+	auto modified = [&file](size_t offset, uint32_t value) {
+		std::vector<uint8_t> copy = file;
+		std::memcpy(copy.data() + offset, &value, sizeof(value));
+		return copy;
+	};
+	size_t entry = sizeof(SoundBank::Header);
+	const std::vector<uint8_t> broken[] = {
+	  // 識別子、バージョン、索引の数
+	  modified(0, 0x4b4e4258),
+	  modified(offsetof(SoundBank::Header, version), SoundBank::kVersion + 1),
+	  modified(offsetof(SoundBank::Header, entryCount), 1000),
+	  // 名前、波形データ、ループ範囲がファイルや波形の外
+	  modified(entry + offsetof(SoundBank::Entry, nameLength), 1 << 20),
+	  modified(entry + offsetof(SoundBank::Entry, dataOffset), 1 << 20),
+	  modified(entry + offsetof(SoundBank::Entry, loopEnd), 1000),
+	};
+	for (const std::vector<uint8_t>& copy : broken) {
+		CHECK(!bank.Open(copy.data(), copy.size()));
+	}
+}
+
+// ファイルの中身を全て読む
+std::vector<uint8_t> ReadFile(const std::filesystem::path& path) {
+	std::ifstream file(path, std::ios_base::binary);
+	return std::vector<uint8_t>(std::istreambuf_iterator<char>(file), {});
+}
+
+void WriteFile(const std::filesystem::path& path, const std::vector<uint8_t>& data) {
+	std::filesystem::create_directories(path.parent_path());
+	std::ofstream file(path, std::ios_base::binary);
+	file.write(reinterpret_cast<const char*>(data.data()), data.size());
+}
+
+// ディレクトリの.wavをツールでまとめ、相対パスの名前で引ける
+void TestCook(const char* cookPath) {
+	std::filesystem::path directory = std::filesystem::temp_directory_path() / "SoundBankTest";
+	std::filesystem::remove_all(directory);
+	WaveBuilder looped;
+	looped.Format();
+	looped.Data(300);
+	looped.SampleLoop(100, 199);
+	const std::vector<uint8_t>& loopedFile = looped.Finish();
+	WriteFile(directory / "input" / "bgm" / "loop.WAV", loopedFile);
+	WaveBuilder plain;
+	plain.Format();
+	plain.Data(50);
+	const std::vector<uint8_t>& plainFile = plain.Finish();
+	WriteFile(directory / "input" / "se.wav", plainFile);
+	// 読めないWAVと.wav以外は入れない
+	WriteFile(directory / "input" / "broken.wav", {'R', 'I', 'F', 'F'});
+	WriteFile(directory / "input" / "readme.txt", plainFile);
+
+	std::filesystem::path output = directory / "bank.sbnk";
+	std::string command = std::string("\"") + cookPath + "\" \"" +
+	                      (directory / "input").string() + "\" \"" + output.string() + "\"";
+	CHECK(std::system(command.c_str()) == 0);
+
+	std::vector<uint8_t> file = ReadFile(output);
+	SoundBank bank;
+	CHECK(bank.Open(file.data(), file.size()));
+	CHECK(bank.GetEntryCount() == 2);
+	int32_t loop = bank.Find("bgm/loop.WAV");
+	int32_t se = bank.Find("se.wav");
+	CHECK(loop >= 0 && se >= 0);
+	if (loop >= 0 && se >= 0) {
+		const SoundBank::Entry& loopEntry = bank.GetEntry(loop);
+		CHECK(loopEntry.frameCount == 300 && loopEntry.dataSize == 300 * 4);
+		CHECK(loopEntry.loopStart == 100 && loopEntry.loopEnd == 200);
+		CHECK(loopEntry.flags == 0);
+		const uint8_t* loopData = loopedFile.data() + looped.GetDataOffset();
+		CHECK(std::memcmp(bank.GetData(loop), loopData, loopEntry.dataSize) == 0);
+		const SoundBank::Entry& seEntry = bank.GetEntry(se);
+		CHECK(seEntry.frameCount == 50 && seEntry.loopEnd == 0);
+		const uint8_t* seData = plainFile.data() + plain.GetDataOffset();
+		CHECK(std::memcmp(bank.GetData(se), seData, seEntry.dataSize) == 0);
+	}
+	CHECK(bank.Find("broken.wav") == -1 && bank.Find("readme.txt") == -1);
+	std::filesystem::remove_all(directory);
+}
+
+} // namespace
+
+int main(int argc, char* argv[]) {
+	TestRoundTrip();
+	TestHashCollision();
+	TestCorrupt();
+	// 引数にSoundBankCookのパスを渡す（ctestから実行すると渡される）
+	CHECK(argc > 1);
+	if (argc > 1) {
+		TestCook(argv[1]);
+	}
+	return Test::Finish("SoundBankTest");
+}
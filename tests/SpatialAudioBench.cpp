@@ -0,0 +1,47 @@
+﻿#include "SpatialAudio.h"
+#include "TestSpatialAudio.h"
+#include "TestUtility.h"
+#include <random>
+#include <vector>
+
+// 1000音源の減衰と定位とドップラー効果の計算時間を、1音源ずつ計算する場合と比べる
+
+int main() {
+	const uint32_t kEmitterCount = 1000;
+	std::mt19937 random(1);
+	std::uniform_real_distribution<float> position(-50.0f, 50.0f);
+	std::uniform_real_distribution<float> velocity(-30.0f, 30.0f);
+	std::vector<Vector3> positions(kEmitterCount);
+	std::vector<Vector3> velocities(kEmitterCount);
+	for (uint32_t i = 0; i < kEmitterCount; i++) {
+		positions[i] = {position(random), position(random), position(random)};
+		velocities[i] = {velocity(random), velocity(random), velocity(random)};
+	}
+	SpatialEmitterDesc desc;
+	SpatialListener listener;
+
+	SpatialBatch batch;
+	double gather = Test::MeasureMicroseconds(20, [&] {
+		batch.Clear();
+		for (uint32_t i = 0; i < kEmitterCount; i++) {
+			batch.Add(positions[i], velocities[i], desc);
+		}
+	});
+	std::printf("add     %u emitters: %.1f us\n", kEmitterCount, gather);
+
+	for (uint32_t channelCount : {2u, 6u, 8u}) {
+		SpeakerLayout layout = SpeakerLayout::Create(channelCount);
+		double batchTime = Test::MeasureMicroseconds(50, [&] { batch.Compute(listener, layout); });
+		std::vector<Test::SpatialResult> results(kEmitterCount);
+		double scalarTime = Test::MeasureMicroseconds(50, [&] {
+			for (uint32_t i = 0; i < kEmitterCount; i++) {
+				results[i] =
+				  Test::ComputeSpatial(positions[i], velocities[i], desc, listener, layout);
+			}
+		});
+		std::printf(
+		  "compute %u ch: batch %.1f us, scalar %.1f us (%.1fx)\n", channelCount, batchTime,
+		  scalarTime, scalarTime / batchTime);
+	}
+	return 0;
+}
@@ -0,0 +1,149 @@
+﻿#include "SpatialAudio.h"
+#include "TestSpatialAudio.h"
+#include "TestUtility.h"
+#include <random>
+#include <vector>
+
+namespace {
+
+// 音源
+struct Emitter {
+	Vector3 position;
+	Vector3 velocity;
+	SpatialEmitterDesc desc;
+};
+
+// ランダムな音源（設定の組み合わせが全て出るようにし、リスナーと重なるものも含める）
+std::vector<Emitter> MakeEmitters(uint32_t count, const SpatialListener& listener) {
+	std::mt19937 random(1);
+	std::uniform_real_distribution<float> position(-50.0f, 50.0f);
+	std::uniform_real_distribution<float> velocity(-200.0f, 200.0f);
+	std::vector<Emitter> emitters(count);
+	for (uint32_t i = 0; i < count; i++) {
+		Emitter& emitter = emitters[i];
+		emitter.position = {position(random), position(random), position(random)};
+		emitter.velocity = {velocity(random), velocity(random), velocity(random)};
+		emitter.desc.curve = static_cast<AttenuationCurve>(i % 3);
+		emitter.desc.minDistance = 1.0f + static_cast<float>(i % 5);
+		// kLinear以外では、最大距離が最小距離より近い設定も混ぜる
+		bool shortRange = i % 7 == 0 && emitter.desc.curve != AttenuationCurve::kLinear;
+		emitter.desc.maxDistance = shortRange ? 0.5f : 60.0f;
+		emitter.desc.rolloff = 0.5f + static_cast<float>(i % 4);
+		emitter.desc.dopplerScale = i % 2 ? 1.0f : 0.5f;
+	}
+	emitters[0].position = listener.position;
+	emitters[1].position = Add(listener.position, {0.0f, 0.3f, 0.0f});
+	return emitters;
+}
+
+// まとめて計算した結果が、1音源ずつの参照実装と一致する
+void TestMatchesReference() {
+	SpatialListener listener;
+	listener.position = {1.0f, 2.0f, 3.0f};
+	listener.right = {0.0f, 0.0f, -1.0f};
+	listener.forward = {1.0f, 0.0f, 0.0f};
+	listener.velocity = {3.0f, 0.0f, 1.0f};
+	// 4の倍数でない数で、端数の部分も調べる
+	std::vector<Emitter> emitters = MakeEmitters(1001, listener);
+
+	for (uint32_t channelCount : {1u, 2u, 3u, 4u, 6u, 8u}) {
+		SpeakerLayout layout = SpeakerLayout::Create(channelCount);
+		SpatialBatch batch;
+		for (const Emitter& emitter : emitters) {
+			batch.Add(emitter.position, emitter.velocity, emitter.desc);
+		}
+		CHECK(batch.GetCount() == emitters.size());
+		batch.Compute(listener, layout);
+
+		float maxError = 0.0f;
+		float maxPowerError = 0.0f;
+		uint32_t nanCount = 0;
+		for (uint32_t i = 0; i < batch.GetCount(); i++) {
+			const Emitter& emitter = emitters[i];
+			Test::SpatialResult expected = Test::ComputeSpatial(
+			  emitter.position, emitter.velocity, emitter.desc, listener, layout);
+			maxError = (std::max)(maxError, std::fabs(batch.GetGain(i) - expected.gain));
+			maxError = (std::max)(
+			  maxError, std::fabs(batch.GetFrequencyRatio(i) - expected.frequencyRatio));
+			float power = 0.0f;
+			for (uint32_t c = 0; c < channelCount; c++) {
+				float gain = batch.GetChannelGain(i, c);
+				nanCount += std::isnan(gain);
+				maxError = (std::max)(maxError, std::fabs(gain - expected.channelGains[c]));
+				power += gain * gain;
+			}
+			nanCount += std::isnan(batch.GetFrequencyRatio(i));
+			// チャンネルのゲインの2乗の和は減衰の2乗になる
+			maxPowerError = (std::max)(
+			  maxPowerError, std::fabs(std::sqrt(power) - batch.GetGain(i)));
+		}
+		CHECK(nanCount == 0);
+		CHECK(maxError < 1e-4f);
+		CHECK(maxPowerError < 1e-4f);
+	}
+}
+
+// 向き、距離減衰、ドップラー効果の向き
+void TestDirections() {
+	SpatialListener listener;
+	SpeakerLayout stereo = SpeakerLayout::Create(2);
+	SpatialBatch batch;
+	SpatialEmitterDesc desc;
+	uint32_t right = batch.Add({10.0f, 0.0f, 0.0f}, {}, desc);
+	uint32_t left = batch.Add({-10.0f, 0.0f, 0.0f}, {}, desc);
+	uint32_t front = batch.Add({0.0f, 0.0f, 10.0f}, {}, desc);
+	uint32_t approaching = batch.Add({0.0f, 0.0f, 10.0f}, {0.0f, 0.0f, -34.3f}, desc);
+	uint32_t leaving = batch.Add({0.0f, 0.0f, 10.0f}, {0.0f, 0.0f, 34.3f}, desc);
+	desc.curve = AttenuationCurve::kLinear;
+	desc.maxDistance = 20.0f;
+	uint32_t linear = batch.Add({0.0f, 0.0f, 10.5f}, {}, desc);
+	uint32_t outside = batch.Add({0.0f, 0.0f, 30.0f}, {}, desc);
+	batch.Compute(listener, stereo);
+
+	// 真横の音は片側だけ、正面の音は左右同じ大きさ
+	CHECK_NEAR(batch.GetChannelGain(right, 0), 0.0f, 1e-6f);
+	CHECK_NEAR(batch.GetChannelGain(right, 1), batch.GetGain(right), 1e-6f);
+	CHECK_NEAR(batch.GetChannelGain(left, 1), 0.0f, 1e-6f);
+	CHECK_NEAR(batch.GetChannelGain(front, 0), batch.GetChannelGain(front, 1), 1e-6f);
+	// 最小距離1、rolloff1の反比例
+	CHECK_NEAR(batch.GetGain(front), 0.1f, 1e-5f);
+	CHECK_NEAR(batch.GetGain(linear), 0.5f, 1e-5f);
+	CHECK(batch.GetGain(outside) == 0.0f);
+	// 近づく音は高く、遠ざかる音は低く聞こえる
+	CHECK_NEAR(batch.GetFrequencyRatio(front), 1.0f, 1e-6f);
+	CHECK_NEAR(batch.GetFrequencyRatio(approaching), 343.0f / (343.0f - 34.3f), 1e-5f);
+	CHECK_NEAR(batch.GetFrequencyRatio(leaving), 343.0f / (343.0f + 34.3f), 1e-5f);
+
+	// 音速に近い速度でも周波数比は範囲内に収まる
+	batch.Clear();
+	CHECK(batch.GetCount() == 0);
+	uint32_t fast = batch.Add({0.0f, 0.0f, 10.0f}, {0.0f, 0.0f, -1000.0f}, {});
+	batch.Compute(listener, stereo);
+	CHECK(batch.GetFrequencyRatio(fast) == SpatialBatch::kMaxFrequencyRatio);
+}
+
+// 5.1chでは後ろの音は後方のスピーカーから、LFEには振り分けない
+void TestSurround() {
+	SpatialListener listener;
+	SpeakerLayout layout = SpeakerLayout::Create(6);
+	SpatialBatch batch;
+	uint32_t behind = batch.Add({-3.0f, 0.0f, -10.0f}, {}, {});
+	uint32_t ahead = batch.Add({0.0f, 0.0f, 10.0f}, {}, {});
+	batch.Compute(listener, layout);
+
+	CHECK(batch.GetChannelGain(behind, 3) == 0.0f);
+	CHECK(batch.GetChannelGain(ahead, 3) == 0.0f);
+	CHECK(batch.GetChannelGain(behind, 4) > batch.GetChannelGain(behind, 0));
+	CHECK(batch.GetChannelGain(behind, 4) > batch.GetChannelGain(behind, 5));
+	CHECK(batch.GetChannelGain(ahead, 2) > batch.GetChannelGain(ahead, 4));
+	CHECK_NEAR(batch.GetChannelGain(ahead, 0), batch.GetChannelGain(ahead, 1), 1e-6f);
+}
+
+} // namespace
+
+int main() {
+	TestMatchesReference();
+	TestDirections();
+	TestSurround();
+	return Test::Finish("SpatialAudioTest");
+}
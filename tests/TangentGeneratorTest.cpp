@@ -0,0 +1,144 @@
+﻿#include "JobSystem.h"
+#include "MathUtility.h"
+#include "TangentGenerator.h"
+#include "TestUtility.h"
+#include <cmath>
+#include <vector>
+
+namespace {
+
+// Meshと同じく、位置・法線・UVを1つの構造体に並べた頂点
+struct Vertex {
+	Vector3 position;
+	Vector3 normal;
+	Vector2 uv;
+};
+
+std::vector<Vector4> Generate(
+  const std::vector<Vertex>& vertices, const std::vector<uint32_t>& indices) {
+	TangentGenerator::VertexInput input;
+	input.positions = &vertices[0].position;
+	input.positionStride = sizeof(Vertex);
+	input.normals = &vertices[0].normal;
+	input.normalStride = sizeof(Vertex);
+	input.uvs = &vertices[0].uv;
+	input.uvStride = sizeof(Vertex);
+	input.vertexCount = static_cast<uint32_t>(vertices.size());
+	input.indices = indices.data();
+	input.indexCount = indices.size();
+	std::vector<Vector4> tangents(vertices.size());
+	TangentGenerator::Generate(input, tangents.data());
+	return tangents;
+}
+
+// 従法線（w * cross(法線, 接線)）
+Vector3 GetBitangent(const Vector3& normal, const Vector4& tangent) {
+	return Multiply(tangent.w, Cross(normal, {tangent.x, tangent.y, tangent.z}));
+}
+
+// 左右で同じテクスチャを鏡写しにした2枚の四角形（継ぎ目の頂点はUVが違うので別にする）
+// 左はuが+x方向、右はuが-x方向に増える。vはどちらも+y方向
+void TestMirroredQuad() {
+	std::vector<Vertex> vertices;
+	std::vector<uint32_t> indices;
+	const Vector3 normal = {0.0f, 0.0f, -1.0f};
+	for (int side = 0; side < 2; side++) {
+		uint32_t base = static_cast<uint32_t>(vertices.size());
+		float left = side == 0 ? -1.0f : 0.0f;
+		for (int y = 0; y < 2; y++) {
+			for (int x = 0; x < 2; x++) {
+				float u = side == 0 ? static_cast<float>(x) : static_cast<float>(1 - x);
+				vertices.push_back(
+				  {{left + static_cast<float>(x), static_cast<float>(y), 0.0f}, normal,
+				   {u, static_cast<float>(y)}});
+			}
+		}
+		indices.insert(indices.end(), {base, base + 2, base + 3, base, base + 3, base + 1});
+	}
+	std::vector<Vector4> tangents = Generate(vertices, indices);
+
+	uint32_t wrongCount = 0;
+	for (size_t v = 0; v < vertices.size(); v++) {
+		const Vector4& tangent = tangents[v];
+		Vector3 direction = {tangent.x, tangent.y, tangent.z};
+		// 単位長で法線と直交する
+		wrongCount += std::fabs(Length(direction) - 1.0f) > 1e-5f;
+		wrongCount += std::fabs(Dot(direction, normal)) > 1e-5f;
+		wrongCount += tangent.w != 1.0f && tangent.w != -1.0f;
+		// 接線はuの増える向き、従法線はvの増える向き
+		float expectedX = v < 4 ? 1.0f : -1.0f;
+		wrongCount += Dot(direction, {expectedX, 0.0f, 0.0f}) < 0.9999f;
+		wrongCount += Dot(GetBitangent(normal, tangent), {0.0f, 1.0f, 0.0f}) < 0.9999f;
+	}
+	CHECK(wrongCount == 0);
+	// 鏡写しの側は従法線の向き（w）が反対になる
+	CHECK(tangents[0].w == -tangents[4].w);
+}
+
+// 並列処理に入る大きさの球。UVの勾配（解析解）と向きが合い、法線と直交する
+void TestSphere() {
+	const uint32_t kRings = 128;
+	const uint32_t kSegments = 256;
+	const float kPi = 3.14159265f;
+	std::vector<Vertex> vertices;
+	std::vector<uint32_t> indices;
+	std::vector<Vector3> expectedTangents;
+	std::vector<Vector3> expectedBitangents;
+	for (uint32_t i = 0; i <= kRings; i++) {
+		for (uint32_t j = 0; j <= kSegments; j++) {
+			float u = static_cast<float>(j) / static_cast<float>(kSegments);
+			float v = static_cast<float>(i) / static_cast<float>(kRings);
+			float theta = kPi * v;
+			float phi = 2.0f * kPi * u;
+			Vector3 normal = {
+			  std::sin(theta) * std::cos(phi), std::cos(theta), std::sin(theta) * std::sin(phi)};
+			vertices.push_back({normal, normal, {u, v}});
+			// 位置をu、vで微分した向き
+			expectedTangents.push_back({-std::sin(phi), 0.0f, std::cos(phi)});
+			expectedBitangents.push_back(
+			  {std::cos(theta) * std::cos(phi), -std::sin(theta), std::cos(theta) * std::sin(phi)});
+		}
+	}
+	auto vertex = [](uint32_t i, uint32_t j) { return i * (kSegments + 1) + j; };
+	for (uint32_t i = 0; i < kRings; i++) {
+		for (uint32_t j = 0; j < kSegments; j++) {
+			indices.insert(
+			  indices.end(), {vertex(i, j), vertex(i + 1, j + 1), vertex(i + 1, j), vertex(i, j),
+			                  vertex(i, j + 1), vertex(i + 1, j + 1)});
+		}
+	}
+	CHECK(vertices.size() >= TangentGenerator::kParallelThreshold);
+
+	JobSystem::GetInstance()->Initialize(3);
+	std::vector<Vector4> tangents = Generate(vertices, indices);
+	JobSystem::GetInstance()->Finalize();
+
+	uint32_t wrongCount = 0;
+	float minAlignment = 1.0f;
+	for (uint32_t i = 0; i <= kRings; i++) {
+		for (uint32_t j = 0; j <= kSegments; j++) {
+			uint32_t v = vertex(i, j);
+			const Vector4& tangent = tangents[v];
+			Vector3 direction = {tangent.x, tangent.y, tangent.z};
+			wrongCount += std::fabs(Length(direction) - 1.0f) > 1e-5f;
+			wrongCount += std::fabs(Dot(direction, vertices[v].normal)) > 1e-5f;
+			// 極はUVの勾配が定まらないので向きは調べない
+			if (i == 0 || i == kRings) {
+				continue;
+			}
+			minAlignment = (std::min)(minAlignment, Dot(direction, expectedTangents[v]));
+			wrongCount +=
+			  Dot(GetBitangent(vertices[v].normal, tangent), expectedBitangents[v]) <= 0.0f;
+		}
+	}
+	CHECK(wrongCount == 0);
+	CHECK(minAlignment > 0.999f);
+}
+
+} // namespace
+
+int main() {
+	TestMirroredQuad();
+	TestSphere();
+	return Test::Finish("TangentGeneratorTest");
+}
@@ -0,0 +1,70 @@
+#pragma once
+
+#include "MathUtility.h"
+#include <cmath>
+
+// テスト用の行列（DirectXMathと同じ左手系、行ベクトル）
+
+namespace Test {
+
+// 単位行列
+inline Matrix4x4 MakeIdentity() {
+	Matrix4x4 m = {};
+	for (int i = 0; i < 4; i++) {
+		m.m[i][i] = 1.0f;
+	}
+	return m;
+}
+
+// 平行移動行列
+inline Matrix4x4 MakeTranslation(const Vector3& translation) {
+	Matrix4x4 m = MakeIdentity();
+	m.m[3][0] = translation.x;
+	m.m[3][1] = translation.y;
+	m.m[3][2] = translation.z;
+	return m;
+}
+
+// スケール行列
+inline Matrix4x4 MakeScale(const Vector3& scale) {
+	Matrix4x4 m = MakeIdentity();
+	m.m[0][0] = scale.x;
+	m.m[1][1] = scale.y;
+	m.m[2][2] = scale.z;
+	return m;
+}
+
+// 透視投影行列（XMMatrixPerspectiveFovLHと同じ）
+inline Matrix4x4 MakePerspective(float fovAngleY, float aspectRatio, float nearZ, float farZ) {
+	Matrix4x4 m = {};
+	float yScale = 1.0f / std::tan(fovAngleY * 0.5f);
+	m.m[0][0] = yScale / aspectRatio;
+	m.m[1][1] = yScale;
+	m.m[2][2] = farZ / (farZ - nearZ);
+	m.m[2][3] = 1.0f;
+	m.m[3][2] = -nearZ * farZ / (farZ - nearZ);
+	return m;
+}
+
+// ビュー行列（XMMatrixLookAtLHと同じ）
+inline Matrix4x4 MakeLookAt(const Vector3& eye, const Vector3& target, const Vector3& up) {
+	Vector3 zAxis = Normalize(Subtract(target, eye));
+	Vector3 xAxis = Normalize(Cross(up, zAxis));
+	Vector3 yAxis = Cross(zAxis, xAxis);
+	Matrix4x4 m = MakeIdentity();
+	m.m[0][0] = xAxis.x;
+	m.m[1][0] = xAxis.y;
+	m.m[2][0] = xAxis.z;
+	m.m[0][1] = yAxis.x;
+	m.m[1][1] = yAxis.y;
+	m.m[2][1] = yAxis.z;
+	m.m[0][2] = zAxis.x;
+	m.m[1][2] = zAxis.y;
+	m.m[2][2] = zAxis.z;
+	m.m[3][0] = -Dot(xAxis, eye);
+	m.m[3][1] = -Dot(yAxis, eye);
+	m.m[3][2] = -Dot(zAxis, eye);
+	return m;
+}
+
+} // namespace Test
@@ -0,0 +1,49 @@
+#pragma once
+
+#include "MathUtility.h"
+#include "Vector2.h"
+#include <cmath>
+#include <cstdint>
+#include <vector>
+
+// テスト用のメッシュ
+
+namespace Test {
+
+// Meshと同じく、位置・法線・UVを1つの構造体に並べた頂点
+struct MeshVertex {
+	Vector3 position;
+	Vector3 normal;
+	Vector2 uv;
+};
+
+// 格子状の球。半径はbumpinessの分だけでこぼこさせる（0なら単位球）
+// UVの継ぎ目と極は同じ座標の頂点が複数ある（OBJを読んだ時と同じ）。
+// インデックスは格子の1マス毎に2つの三角形を並べる
+inline void MakeSphere(
+  uint32_t rings, uint32_t segments, float bumpiness, std::vector<MeshVertex>& vertices,
+  std::vector<uint32_t>& indices) {
+	const float kPi = 3.14159265f;
+	for (uint32_t i = 0; i <= rings; i++) {
+		for (uint32_t j = 0; j <= segments; j++) {
+			float u = static_cast<float>(j) / static_cast<float>(segments);
+			float v = static_cast<float>(i) / static_cast<float>(rings);
+			float theta = kPi * v;
+			float phi = 2.0f * kPi * u;
+			float radius = 1.0f + bumpiness * std::sin(theta * 5.0f) * std::cos(phi * 7.0f);
+			Vector3 normal = {
+			  std::sin(theta) * std::cos(phi), std::cos(theta), std::sin(theta) * std::sin(phi)};
+			vertices.push_back({Multiply(radius, normal), normal, {u, v}});
+		}
+	}
+	auto vertex = [segments](uint32_t i, uint32_t j) { return i * (segments + 1) + j; };
+	for (uint32_t i = 0; i < rings; i++) {
+		for (uint32_t j = 0; j < segments; j++) {
+			indices.insert(
+			  indices.end(), {vertex(i, j), vertex(i + 1, j + 1), vertex(i + 1, j), vertex(i, j),
+			                  vertex(i, j + 1), vertex(i + 1, j + 1)});
+		}
+	}
+}
+
+} // namespace Test
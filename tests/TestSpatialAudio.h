@@ -0,0 +1,75 @@
+#pragma once
+
+#include "MathUtility.h"
+#include "SpatialAudio.h"
+#include <algorithm>
+#include <cmath>
+
+// SpatialBatchの計算を1音源ずつスカラーで行う参照実装
+
+namespace Test {
+
+/// <summary>
+/// 1音源の計算結果
+/// </summary>
+struct SpatialResult {
+	float gain = 0.0f;
+	float channelGains[SpeakerLayout::kMaxChannelCount] = {};
+	float frequencyRatio = 1.0f;
+};
+
+/// <summary>
+/// 1音源の減衰、チャンネル毎のゲイン、周波数比を計算する
+/// </summary>
+inline SpatialResult ComputeSpatial(
+    const Vector3& position, const Vector3& velocity, const SpatialEmitterDesc& desc,
+    const SpatialListener& listener, const SpeakerLayout& layout) {
+	SpatialResult result;
+	Vector3 offset = Subtract(position, listener.position);
+	float distance = std::sqrt(Dot(offset, offset));
+	float inverseDistance = distance > 1.0e-4f ? 1.0f / distance : 0.0f;
+
+	// 距離減衰
+	float minDistance = desc.minDistance;
+	float maxDistance = (std::max)(desc.maxDistance, desc.minDistance);
+	float over = std::clamp(distance, minDistance, maxDistance) - minDistance;
+	if (desc.curve == AttenuationCurve::kInverse) {
+		result.gain = minDistance / (minDistance + desc.rolloff * over);
+	} else if (desc.curve == AttenuationCurve::kLinear) {
+		result.gain = 1.0f - over / (maxDistance - minDistance);
+	} else {
+		result.gain = 1.0f;
+	}
+
+	// 定位（最小距離より近ければ向きを弱める）
+	float scale = inverseDistance * (std::min)(distance / minDistance, 1.0f);
+	float directionX = Dot(offset, listener.right) * scale;
+	float directionZ = Dot(offset, listener.forward) * scale;
+	float weights[SpeakerLayout::kMaxChannelCount] = {};
+	float weightSum = 0.0f;
+	for (uint32_t c = 0; c < layout.channelCount; c++) {
+		float cosine = directionX * layout.directionX[c] + directionZ * layout.directionZ[c];
+		weights[c] = std::pow((1.0f + cosine) * 0.5f, static_cast<float>(layout.sharpness)) *
+		    layout.weight[c];
+		weightSum += weights[c];
+	}
+	for (uint32_t c = 0; c < layout.channelCount; c++) {
+		result.channelGains[c] =
+		    std::sqrt(weights[c] * result.gain * result.gain / (std::max)(weightSum, 1.0e-20f));
+	}
+
+	// ドップラー効果
+	const float maxSpeed = SpatialBatch::kSpeedOfSound * 0.5f;
+	Vector3 unit = {
+	    offset.x * inverseDistance, offset.y * inverseDistance, offset.z * inverseDistance};
+	float listenerSpeed = std::clamp(Dot(listener.velocity, unit), -maxSpeed, maxSpeed);
+	float sourceSpeed = std::clamp(Dot(velocity, unit), -maxSpeed, maxSpeed);
+	float ratio = (SpatialBatch::kSpeedOfSound + listenerSpeed) /
+	    (SpatialBatch::kSpeedOfSound + sourceSpeed);
+	ratio = 1.0f + (ratio - 1.0f) * desc.dopplerScale;
+	result.frequencyRatio =
+	    std::clamp(ratio, SpatialBatch::kMinFrequencyRatio, SpatialBatch::kMaxFrequencyRatio);
+	return result;
+}
+
+} // namespace Test
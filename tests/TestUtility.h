@@ -0,0 +1,63 @@
+#pragma once
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+
+// テストとベンチマークの共通処理
+
+namespace Test {
+
+// 失敗した数
+inline uint32_t& FailureCount() {
+	static uint32_t count = 0;
+	return count;
+}
+
+// 失敗を報告する
+inline void Fail(const char* file, int line, const char* expression) {
+	std::printf("%s(%d): failed: %s\n", file, line, expression);
+	FailureCount()++;
+}
+
+/// <summary>
+/// テストの結果を表示し、mainの戻り値を返す
+/// </summary>
+inline int Finish(const char* name) {
+	if (FailureCount() == 0) {
+		std::printf("%s: passed\n", name);
+		return 0;
+	}
+	std::printf("%s: %u failed\n", name, FailureCount());
+	return 1;
+}
+
+/// <summary>
+/// 処理をrepeat回繰り返し、1回あたりの最短時間（マイクロ秒）を返す
+/// </summary>
+template<class Function>
+double MeasureMicroseconds(uint32_t repeat, const Function& function) {
+	double best = 1e30;
+	for (uint32_t i = 0; i < repeat; i++) {
+		auto begin = std::chrono::steady_clock::now();
+		function();
+		auto end = std::chrono::steady_clock::now();
+		best = (std::min)(best, std::chrono::duration<double, std::micro>(end - begin).count());
+	}
+	return best;
+}
+
+} // namespace Test
+
+// 式が偽なら失敗として報告する（テストは続ける）
+#define CHECK(expression)                                                                          \
+	do {                                                                                           \
+		if (!(expression)) {                                                                       \
+			Test::Fail(__FILE__, __LINE__, #expression);                                           \
+		}                                                                                          \
+	} while (false)
+
+// 2つの値の差がepsilon以下か
+#define CHECK_NEAR(a, b, epsilon) CHECK(std::fabs((a) - (b)) <= (epsilon))
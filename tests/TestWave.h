@@ -0,0 +1,112 @@
+#pragma once
+
+#include <cstdint>
+#include <cstring>
+#include <initializer_list>
+#include <vector>
+
+// テスト用のWAVファイルをメモリ上に組み立てる
+
+namespace Test {
+
+/// <summary>
+/// チャンクを順に書き足してWAVを組み立てる
+/// </summary>
+class WaveBuilder {
+public:
+	// RIFFヘッダー（サイズはFinishで埋める）
+	WaveBuilder() : bytes_{'R', 'I', 'F', 'F', 0, 0, 0, 0, 'W', 'A', 'V', 'E'} {}
+
+	void Id(const char* id) { bytes_.insert(bytes_.end(), id, id + 4); }
+	void U16(uint16_t value) { Append(&value, sizeof(value)); }
+	void U32(uint32_t value) { Append(&value, sizeof(value)); }
+	void Append(const void* data, size_t size) {
+		const uint8_t* begin = static_cast<const uint8_t*>(data);
+		bytes_.insert(bytes_.end(), begin, begin + size);
+	}
+
+	// 16bitステレオのfmtチャンク（cbSize付きの18バイト）
+	void Format() {
+		Id("fmt ");
+		U32(18);
+		U16(1);
+		U16(2);
+		U32(44100);
+		U32(44100 * 4);
+		U16(4);
+		U16(16);
+		U16(0);
+	}
+
+	// 各フレームの値がフレーム番号になる波形
+	void Data(uint32_t frameCount) {
+		Id("data");
+		U32(frameCount * 4);
+		dataOffset_ = bytes_.size();
+		for (uint32_t i = 0; i < frameCount; i++) {
+			U16(static_cast<uint16_t>(i));
+			U16(static_cast<uint16_t>(i));
+		}
+	}
+
+	// 奇数バイトのLISTチャンク（後ろに詰め物が入る）
+	void OddList() {
+		Id("LIST");
+		U32(5);
+		Append("INFOx", 5);
+		bytes_.push_back(0);
+	}
+
+	void Fact(uint32_t frameCount) {
+		Id("fact");
+		U32(4);
+		U32(frameCount);
+	}
+
+	// 1つ目のループが[start, end]のsmplチャンク
+	void SampleLoop(uint32_t start, uint32_t end) {
+		Id("smpl");
+		U32(36 + 24);
+		for (int i = 0; i < 7; i++) {
+			U32(0);
+		}
+		U32(1);
+		U32(0);
+		U32(0);
+		U32(0);
+		U32(start);
+		U32(end);
+		U32(0);
+		U32(0);
+	}
+
+	void Cue(std::initializer_list<uint32_t> positions) {
+		Id("cue ");
+		U32(static_cast<uint32_t>(4 + 24 * positions.size()));
+		U32(static_cast<uint32_t>(positions.size()));
+		uint32_t id = 0;
+		for (uint32_t position : positions) {
+			U32(id++);
+			U32(position);
+			Id("data");
+			U32(0);
+			U32(0);
+			U32(position);
+		}
+	}
+
+	// RIFFのサイズを埋めて返す
+	const std::vector<uint8_t>& Finish() {
+		uint32_t size = static_cast<uint32_t>(bytes_.size() - 8);
+		memcpy(&bytes_[4], &size, sizeof(size));
+		return bytes_;
+	}
+
+	size_t GetDataOffset() const { return dataOffset_; }
+
+private:
+	std::vector<uint8_t> bytes_;
+	size_t dataOffset_ = 0;
+};
+
+} // namespace Test
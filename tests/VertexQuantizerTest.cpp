@@ -0,0 +1,120 @@
+﻿#include "MathUtility.h"
+#include "TestUtility.h"
+#include "VertexQuantizer.h"
+#include <cmath>
+#include <numbers>
+#include <random>
+
+namespace {
+
+// 半精度でvalueを表す時の1目盛り
+float HalfStep(float value) {
+	int exponent = (std::max)(static_cast<int>(std::floor(std::log2(std::fabs(value)))), -14);
+	return std::ldexp(1.0f, exponent - 10);
+}
+
+// 座標・法線・uvを圧縮して戻し、最大誤差が量子化の半目盛りに収まる
+void TestRoundTrip() {
+	AABB aabb = {{-3.0f, 0.0f, -10.0f}, {5.0f, 2.0f, 10.0f}};
+	VertexQuantizer::Range range = VertexQuantizer::MakeRange(aabb);
+	Vector3 step = Multiply(1.0f / 65535.0f, Subtract(aabb.max, aabb.min));
+
+	std::mt19937 random(1);
+	std::uniform_real_distribution<float> unit(0.0f, 1.0f);
+	std::normal_distribution<float> gaussian;
+	std::uniform_real_distribution<float> tiledUv(-4.0f, 4.0f);
+	VertexQuantizer::ErrorStatistics statistics;
+	uint32_t uvWrongCount = 0;
+	for (uint32_t i = 0; i < 200000; i++) {
+		Vector3 position = {
+		  aabb.min.x + unit(random) * 8.0f, aabb.min.y + unit(random) * 2.0f,
+		  aabb.min.z + unit(random) * 20.0f};
+		// 角は範囲の端ちょうどになる
+		if (i < 8) {
+			position = {
+			  i & 1 ? aabb.max.x : aabb.min.x, i & 2 ? aabb.max.y : aabb.min.y,
+			  i & 4 ? aabb.max.z : aabb.min.z};
+		}
+		// 軸方向と、下半球の折り返しの境目も含める
+		Vector3 normal = Normalize({gaussian(random), gaussian(random), gaussian(random)});
+		const Vector3 axes[] = {{1, 0, 0}, {-1, 0, 0}, {0, 1, 0}, {0, -1, 0}, {0, 0, 1},
+		                        {0, 0, -1}, {0.6f, 0.8f, 0}, {-0.6f, 0, -0.8f}};
+		if (i < 8) {
+			normal = axes[i];
+		}
+		Vector2 uv = i % 2 ? Vector2{unit(random), unit(random)}
+		                   : Vector2{tiledUv(random), tiledUv(random)};
+
+		VertexQuantizer::PackedVertex vertex =
+		  VertexQuantizer::Encode(position, normal, uv, range);
+		VertexQuantizer::AccumulateError(statistics, vertex, range, position, normal, uv);
+
+		Vector3 decodedPosition, decodedNormal;
+		Vector2 decodedUv;
+		VertexQuantizer::Decode(vertex, range, decodedPosition, decodedNormal, decodedUv);
+		uvWrongCount += std::fabs(decodedUv.x - uv.x) > HalfStep(uv.x) * 0.5f;
+		uvWrongCount += std::fabs(decodedUv.y - uv.y) > HalfStep(uv.y) * 0.5f;
+	}
+
+	// 座標は軸毎に半目盛り（単精度の丸めの分だけ余裕を持たせる）
+	float positionBound = Length(step) * 0.5f + 1e-5f;
+	// 8面体写像の1目盛りは1/32767。球面上では伸び、下半球の折り返しの境目をまたぐと
+	// さらに伸びるので3目盛りまで許す
+	float normalBound = 3.0f / 32767.0f * 180.0f / std::numbers::pi_v<float>;
+	std::printf(
+	  "max error pos %.7f (bound %.7f) normal %.5fdeg (bound %.5f) uv %.6f\n",
+	  statistics.position, positionBound, statistics.normalDegree, normalBound, statistics.uv);
+	CHECK(statistics.position <= positionBound);
+	CHECK(statistics.normalDegree <= normalBound);
+	CHECK(statistics.uv <= HalfStep(4.0f) * 0.5f);
+	CHECK(uvWrongCount == 0);
+}
+
+// 厚みの無い軸は範囲の端にそのまま戻る
+void TestFlatRange() {
+	AABB aabb = {{-1.0f, 3.0f, -1.0f}, {1.0f, 3.0f, 1.0f}};
+	VertexQuantizer::Range range = VertexQuantizer::MakeRange(aabb);
+	VertexQuantizer::PackedVertex vertex =
+	  VertexQuantizer::Encode({0.25f, 3.0f, -0.5f}, {0, 1, 0}, {0.5f, 0.5f}, range);
+	Vector3 position, normal;
+	Vector2 uv;
+	VertexQuantizer::Decode(vertex, range, position, normal, uv);
+	CHECK(position.y == 3.0f);
+	CHECK_NEAR(position.x, 0.25f, 2.0f / 65535.0f);
+	CHECK_NEAR(normal.y, 1.0f, 1e-6f);
+	CHECK(uv.x == 0.5f && uv.y == 0.5f);
+}
+
+// 半精度の変換
+void TestHalf() {
+	// NaN以外の全ての値は、単精度を経由しても同じ値に戻る
+	uint32_t wrongCount = 0;
+	for (uint32_t bits = 0; bits < 0x10000; bits++) {
+		uint16_t half = static_cast<uint16_t>(bits);
+		if ((half & 0x7c00u) == 0x7c00u && (half & 0x03ffu) != 0) {
+			continue;
+		}
+		wrongCount += VertexQuantizer::FloatToHalf(VertexQuantizer::HalfToFloat(half)) != half;
+	}
+	CHECK(wrongCount == 0);
+
+	// 目盛りのちょうど中間は偶数側に丸める
+	CHECK(VertexQuantizer::FloatToHalf(1.0f + 1.0f / 2048.0f) == 0x3c00u);
+	CHECK(VertexQuantizer::FloatToHalf(1.0f + 3.0f / 2048.0f) == 0x3c02u);
+	// 表せない大きさは無限大、NaNはNaN
+	CHECK(VertexQuantizer::FloatToHalf(70000.0f) == 0x7c00u);
+	CHECK(VertexQuantizer::FloatToHalf(-70000.0f) == 0xfc00u);
+	CHECK(VertexQuantizer::FloatToHalf(std::nanf("")) == 0x7e00u);
+	// 非正規化数
+	CHECK(VertexQuantizer::HalfToFloat(0x0001u) == std::ldexp(1.0f, -24));
+	CHECK(sizeof(VertexQuantizer::PackedVertex) == 16);
+}
+
+} // namespace
+
+int main() {
+	TestRoundTrip();
+	TestFlatRange();
+	TestHalf();
+	return Test::Finish("VertexQuantizerTest");
+}
@@ -0,0 +1,133 @@
+﻿#include "ImaAdpcm.h"
+#include "TestUtility.h"
+#include "TestWave.h"
+#include "WaveParser.h"
+#include <cstdlib>
+#include <memory>
+#include <random>
+#include <vector>
+
+// 正しいWAVを壊したものを読ませ、範囲外を読まず、結果が矛盾しないことを調べる
+// ctestでは回数を抑えて実行する。引数で回数を指定できる（WaveParserFuzz 10000000 など）
+
+namespace {
+
+// 壊す元になるWAV
+std::vector<std::vector<uint8_t>> MakeSeeds() {
+	std::vector<std::vector<uint8_t>> seeds;
+	for (uint32_t pattern = 0; pattern < 16; pattern++) {
+		Test::WaveBuilder builder;
+		if (pattern & 1) {
+			builder.OddList();
+		}
+		builder.Format();
+		builder.Data((pattern & 8) ? 3 : 300);
+		builder.Fact(300);
+		if (pattern & 2) {
+			builder.SampleLoop(10, 99);
+		}
+		if (pattern & 4) {
+			builder.Cue({200, 20, 5});
+		}
+		seeds.push_back(builder.Finish());
+	}
+	// IMA-ADPCM（fmtの形式とブロックの大きさを書き換える）
+	Test::WaveBuilder builder;
+	builder.Format();
+	builder.Data(300);
+	std::vector<uint8_t> adpcm = builder.Finish();
+	uint16_t formatTag = ImaAdpcm::kFormatTag;
+	uint16_t blockAlign = 72;
+	uint16_t bitsPerSample = 4;
+	memcpy(adpcm.data() + 20, &formatTag, sizeof(formatTag));
+	memcpy(adpcm.data() + 32, &blockAlign, sizeof(blockAlign));
+	memcpy(adpcm.data() + 34, &bitsPerSample, sizeof(bitsPerSample));
+	seeds.push_back(adpcm);
+	return seeds;
+}
+
+// 壊し方をランダムに選んで壊す
+void Mutate(std::vector<uint8_t>& bytes, std::mt19937& random) {
+	switch (random() % 4) {
+	case 0:
+		// 数バイトを書き換える
+		for (uint32_t i = 0, count = 1 + random() % 8; i < count; i++) {
+			bytes[random() % bytes.size()] = static_cast<uint8_t>(random());
+		}
+		break;
+	case 1:
+		// 途中で切る
+		bytes.resize(random() % (bytes.size() + 1));
+		break;
+	case 2: {
+		// チャンクサイズなどに極端な値を入れる
+		const uint32_t values[] = {
+		  0, 1, 0x7fffffff, 0xfffffffe, 0xffffffff, static_cast<uint32_t>(random())};
+		uint32_t value = values[random() % 6];
+		memcpy(&bytes[random() % (bytes.size() - 3)], &value, sizeof(value));
+		break;
+	}
+	default:
+		// ヘッダーだけ正しいランダムなバイト列
+		bytes.resize(12 + random() % 256);
+		for (uint8_t& byte : bytes) {
+			byte = static_cast<uint8_t>(random());
+		}
+		memcpy(bytes.data(), "RIFF", 4);
+		memcpy(bytes.data() + 8, "WAVE", 4);
+		break;
+	}
+}
+
+// 読めたなら、結果が波形データの範囲内で矛盾していない
+bool IsConsistent(const WaveInfo& info, size_t size) {
+	if (info.dataOffset + info.dataSize > size || info.dataSize % info.format.blockAlign != 0) {
+		return false;
+	}
+	if (info.hasLoop) {
+		return info.loopStart < info.loopEnd && info.loopEnd <= info.frameCount;
+	}
+	return info.loopStart == 0 && info.loopEnd == 0;
+}
+
+} // namespace
+
+int main(int argc, char* argv[]) {
+	uint32_t iterationCount = argc > 1 ? static_cast<uint32_t>(std::atol(argv[1])) : 200000;
+	std::vector<std::vector<uint8_t>> seeds = MakeSeeds();
+	std::mt19937 random(1);
+	uint32_t parsedCount = 0;
+	uint32_t outOfRangeCount = 0;
+	for (uint32_t i = 0; i < iterationCount; i++) {
+		std::vector<uint8_t> bytes = seeds[random() % seeds.size()];
+		Mutate(bytes, random);
+
+		// 末尾を超えた読み込みをサニタイザーで捕まえられるよう、ちょうどの大きさにコピーする
+		std::unique_ptr<uint8_t[]> file(new uint8_t[bytes.size() + 1]);
+		memcpy(file.get(), bytes.data(), bytes.size());
+		WaveInfo info;
+		if (WaveParser::Parse(file.get(), bytes.size(), info)) {
+			parsedCount++;
+			CHECK(IsConsistent(info, bytes.size()));
+		}
+
+		// 読み込み関数には、ファイルの範囲内だけを頼む
+		auto read = [&](uint64_t offset, void* destination, size_t size) {
+			if (offset + size > bytes.size()) {
+				outOfRangeCount++;
+				return false;
+			}
+			memcpy(destination, bytes.data() + offset, size);
+			return true;
+		};
+		WaveInfo streamInfo;
+		if (WaveParser::Parse(read, bytes.size(), streamInfo)) {
+			CHECK(streamInfo == info);
+		}
+	}
+	CHECK(outOfRangeCount == 0);
+	// 壊しすぎて何も読めていないと調べたことにならない
+	CHECK(parsedCount > iterationCount / 10);
+	std::printf("%u iterations, %u parsed\n", iterationCount, parsedCount);
+	return Test::Finish("WaveParserFuzz");
+}
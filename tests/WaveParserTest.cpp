@@ -0,0 +1,184 @@
+﻿#include "TestUtility.h"
+#include "TestWave.h"
+#include "WaveParser.h"
+#include "WaveStream.h"
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <string>
+#include <vector>
+
+namespace {
+
+using Test::WaveBuilder;
+
+bool Parse(const std::vector<uint8_t>& bytes, WaveInfo& info) {
+	return WaveParser::Parse(bytes.data(), bytes.size(), info);
+}
+
+// チャンクの順番や詰め物、知らないチャンクに関わらずfmtとdataを見つける
+void TestChunkOrder() {
+	for (bool dataFirst : {false, true}) {
+		for (bool list : {false, true}) {
+			WaveBuilder builder;
+			if (list) {
+				builder.OddList();
+			}
+			if (dataFirst) {
+				builder.Data(1000);
+				builder.Format();
+			} else {
+				builder.Format();
+				builder.Data(1000);
+			}
+			builder.Fact(1000);
+			WaveInfo info;
+			CHECK(Parse(builder.Finish(), info));
+			CHECK(info.format.channels == 2 && info.format.samplesPerSec == 44100);
+			CHECK(info.dataOffset == builder.GetDataOffset());
+			CHECK(info.dataSize == 4000);
+			CHECK(info.frameCount == 1000);
+			CHECK(!info.hasLoop);
+		}
+	}
+}
+
+// ループ範囲はsmplの最初のループ、無ければcueの2点から得る
+void TestLoopPoints() {
+	{
+		WaveBuilder builder;
+		builder.Format();
+		builder.Data(1000);
+		builder.Cue({300, 50});
+		builder.SampleLoop(100, 199);
+		WaveInfo info;
+		CHECK(Parse(builder.Finish(), info));
+		// smplの終了フレームは含むので、endは1つ後になる
+		CHECK(info.hasLoop && info.loopStart == 100 && info.loopEnd == 200);
+	}
+	{
+		WaveBuilder builder;
+		builder.Format();
+		builder.Data(1000);
+		builder.Cue({300, 50});
+		WaveInfo info;
+		CHECK(Parse(builder.Finish(), info));
+		CHECK(info.hasLoop && info.loopStart == 50 && info.loopEnd == 300);
+	}
+	{
+		// 1点なら末尾まで
+		WaveBuilder builder;
+		builder.Format();
+		builder.Data(1000);
+		builder.Cue({700});
+		WaveInfo info;
+		CHECK(Parse(builder.Finish(), info));
+		CHECK(info.hasLoop && info.loopStart == 700 && info.loopEnd == 1000);
+	}
+	// 波形の外、空の範囲、終了フレームが最大値のループは無視する
+	for (uint32_t end : {1000u, 99u, UINT32_MAX}) {
+		WaveBuilder builder;
+		builder.Format();
+		builder.Data(1000);
+		builder.SampleLoop(100, end);
+		WaveInfo info;
+		CHECK(Parse(builder.Finish(), info));
+		CHECK(!info.hasLoop && info.loopStart == 0 && info.loopEnd == 0);
+	}
+}
+
+// 壊れたファイル
+void TestMalformed() {
+	WaveInfo info;
+	CHECK(!Parse({}, info));
+	{
+		WaveBuilder builder;
+		builder.Format();
+		builder.Data(10);
+		std::vector<uint8_t> bytes = builder.Finish();
+		memcpy(bytes.data() + 8, "AVI ", 4);
+		CHECK(!Parse(bytes, info));
+	}
+	{
+		WaveBuilder builder;
+		builder.Data(10);
+		CHECK(!Parse(builder.Finish(), info));
+	}
+	{
+		WaveBuilder builder;
+		builder.Format();
+		CHECK(!Parse(builder.Finish(), info));
+	}
+	{
+		// 途中で切れたdataチャンクは、ある分をブロック境界に切り捨てて使う
+		WaveBuilder builder;
+		builder.Format();
+		builder.Data(1000);
+		std::vector<uint8_t> bytes = builder.Finish();
+		bytes.resize(bytes.size() - 1002);
+		CHECK(Parse(bytes, info));
+		// 残った2998バイトを4バイト単位に切り捨てる
+		CHECK(info.dataSize == 2996);
+		CHECK(info.dataOffset + info.dataSize <= bytes.size());
+		CHECK(info.frameCount == info.dataSize / 4);
+	}
+	{
+		// factのフレーム数がdataより多くても、dataの分までにする
+		WaveBuilder builder;
+		builder.Format();
+		builder.Data(100);
+		builder.Fact(5000);
+		CHECK(Parse(builder.Finish(), info));
+		CHECK(info.frameCount == 100);
+	}
+}
+
+// ファイルから読むと、ループ範囲の終わりで始めに戻る
+void TestStreamReaderLoop() {
+	WaveBuilder builder;
+	builder.OddList();
+	builder.Data(1000);
+	builder.Format();
+	builder.SampleLoop(100, 199);
+	std::string filePath = (std::filesystem::temp_directory_path() / "WaveParserTest.wav").string();
+	{
+		const std::vector<uint8_t>& bytes = builder.Finish();
+		std::ofstream file(filePath, std::ios_base::binary);
+		file.write(reinterpret_cast<const char*>(bytes.data()), bytes.size());
+	}
+
+	WaveStreamReader reader;
+	CHECK(reader.Open(filePath));
+	CHECK(reader.GetDataSize() == 4000);
+	std::vector<uint8_t> buffer(4 * 500);
+	CHECK(reader.Read(buffer.data(), buffer.size(), true) == buffer.size());
+	uint32_t wrongCount = 0;
+	for (uint32_t i = 0; i < 500; i++) {
+		uint16_t value;
+		memcpy(&value, buffer.data() + i * 4, sizeof(value));
+		uint32_t expected = i < 200 ? i : 100 + (i - 200) % 100;
+		wrongCount += value != expected;
+	}
+	CHECK(wrongCount == 0);
+
+	// ループしなければ末尾で止まる
+	reader.Rewind();
+	std::vector<uint8_t> whole(8000);
+	CHECK(reader.Read(whole.data(), whole.size(), false) == 4000);
+	CHECK(reader.IsEnd());
+	CHECK(reader.Read(whole.data(), whole.size(), false) == 0);
+	reader.Close();
+	std::filesystem::remove(filePath);
+
+	CHECK(!reader.Open(filePath));
+}
+
+} // namespace
+
+int main() {
+	TestChunkOrder();
+	TestLoopPoints();
+	TestMalformed();
+	TestStreamReaderLoop();
+	return Test::Finish("WaveParserTest");
+}
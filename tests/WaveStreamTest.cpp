@@ -0,0 +1,240 @@
+﻿#include "TestUtility.h"
+#include "TestWave.h"
+#include "WaveStream.h"
+#include <atomic>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace {
+
+using Test::WaveBuilder;
+
+const uint32_t kBlockAlign = 4;
+
+// WaveBuilder::Dataで作った波形の各フレームの値（フレーム番号）
+std::vector<uint32_t> GetFrameValues(const uint8_t* data, size_t size) {
+	std::vector<uint32_t> values;
+	for (size_t i = 0; i + kBlockAlign <= size; i += kBlockAlign) {
+		uint16_t value;
+		std::memcpy(&value, data + i, sizeof(value));
+		values.push_back(value);
+	}
+	return values;
+}
+
+// WAVファイルを一時ディレクトリに書き出す
+std::string WriteWave(const char* name, WaveBuilder& builder) {
+	std::string filePath = (std::filesystem::temp_directory_path() / name).string();
+	const std::vector<uint8_t>& bytes = builder.Finish();
+	std::ofstream file(filePath, std::ios_base::binary);
+	file.write(reinterpret_cast<const char*>(bytes.data()), bytes.size());
+	return filePath;
+}
+
+// ブロック境界に揃わない大きさで区切って読んでも、つなげると元の波形になる
+void TestChunkBoundaries() {
+	WaveBuilder builder;
+	builder.Format();
+	builder.Data(5000);
+	std::string filePath = WriteWave("WaveStreamTest.wav", builder);
+
+	WaveStreamReader reader;
+	CHECK(reader.Open(filePath));
+	for (size_t chunkSize : {size_t(kBlockAlign), size_t(kBlockAlign * 37 + 3), size_t(8192)}) {
+		reader.Rewind();
+		std::vector<uint8_t> chunk(chunkSize);
+		std::vector<uint32_t> values;
+		uint32_t wrongCount = 0;
+		for (;;) {
+			size_t size = reader.Read(chunk.data(), chunk.size(), false);
+			if (size == 0) {
+				break;
+			}
+			// 末尾の1回以外は、ブロック境界に切り捨てた大きさちょうど
+			wrongCount += size % kBlockAlign != 0 || size > chunkSize;
+			wrongCount += !reader.IsEnd() && size != chunkSize - chunkSize % kBlockAlign;
+			std::vector<uint32_t> read = GetFrameValues(chunk.data(), size);
+			values.insert(values.end(), read.begin(), read.end());
+		}
+		CHECK(wrongCount == 0);
+		CHECK(reader.IsEnd());
+		CHECK(values.size() == 5000);
+		for (uint32_t i = 0; i < values.size(); i++) {
+			wrongCount += values[i] != i;
+		}
+		CHECK(wrongCount == 0);
+		// 終わった後は何度読んでも0
+		CHECK(reader.Read(chunk.data(), chunk.size(), false) == 0);
+	}
+	// 1ブロックに満たない読み込みは何も読まない
+	reader.Rewind();
+	uint8_t small[kBlockAlign];
+	CHECK(reader.Read(small, kBlockAlign - 1, false) == 0);
+	CHECK(!reader.IsEnd());
+	reader.Close();
+	std::filesystem::remove(filePath);
+}
+
+// ループ範囲の終わりをまたぐ読み込みは、範囲の始めから続く
+void TestLoopWrap() {
+	WaveBuilder builder;
+	builder.Format();
+	builder.Data(1000);
+	builder.SampleLoop(300, 699);
+	std::string filePath = WriteWave("WaveStreamLoopTest.wav", builder);
+
+	WaveStreamReader reader;
+	CHECK(reader.Open(filePath));
+	// 範囲の長さ（400）と素な大きさで区切り、継ぎ目が毎回違う位置に来るようにする
+	std::vector<uint8_t> chunk(kBlockAlign * 97);
+	std::vector<uint32_t> values;
+	while (values.size() < 5000) {
+		size_t size = reader.Read(chunk.data(), chunk.size(), true);
+		CHECK(size == chunk.size());
+		std::vector<uint32_t> read = GetFrameValues(chunk.data(), size);
+		values.insert(values.end(), read.begin(), read.end());
+	}
+	uint32_t wrongCount = 0;
+	for (uint32_t i = 0; i < values.size(); i++) {
+		uint32_t expected = i < 700 ? i : 300 + (i - 700) % 400;
+		wrongCount += values[i] != expected;
+	}
+	CHECK(wrongCount == 0);
+	// ループ中は末尾に達しない
+	CHECK(!reader.IsEnd());
+
+	// ループしなければ範囲を無視して末尾まで読む
+	reader.Rewind();
+	std::vector<uint8_t> whole(kBlockAlign * 2000);
+	CHECK(reader.Read(whole.data(), whole.size(), false) == kBlockAlign * 1000);
+	CHECK(GetFrameValues(whole.data(), kBlockAlign * 1000).back() == 999);
+	reader.Close();
+	std::filesystem::remove(filePath);
+
+	// ループ範囲が無ければ末尾から先頭に戻る。半端な末尾のバイトは使わない
+	std::vector<uint8_t> memory(kBlockAlign * 10 + 3);
+	for (uint32_t i = 0; i < 10; i++) {
+		uint16_t value = static_cast<uint16_t>(i);
+		std::memcpy(memory.data() + i * kBlockAlign, &value, sizeof(value));
+	}
+	WaveFormat format = {1, 2, 44100, 44100 * 4, 4, 16};
+	reader.OpenMemory(format, memory.data(), static_cast<uint32_t>(memory.size()));
+	CHECK(reader.GetDataSize() == kBlockAlign * 10);
+	std::vector<uint8_t> buffer(kBlockAlign * 25);
+	CHECK(reader.Read(buffer.data(), buffer.size(), true) == buffer.size());
+	std::vector<uint32_t> memoryValues = GetFrameValues(buffer.data(), buffer.size());
+	for (uint32_t i = 0; i < memoryValues.size(); i++) {
+		wrongCount += memoryValues[i] != i % 10;
+	}
+	CHECK(wrongCount == 0);
+
+	// 空の波形はループしても止まる
+	reader.OpenMemory(format, memory.data(), 0);
+	CHECK(reader.Read(buffer.data(), buffer.size(), true) == 0);
+	CHECK(reader.IsEnd());
+}
+
+// 渡した数と返ってきた数で、空き・満杯と次に埋める番号が決まる
+void TestRing() {
+	const uint32_t kBufferCount = StreamBufferRing::kBufferCount;
+	StreamBufferRing ring;
+	CHECK(ring.HasFreeBuffer() && ring.GetQueuedCount() == 0 && ring.GetFillIndex() == 0);
+	for (uint32_t i = 0; i < kBufferCount; i++) {
+		CHECK(ring.HasFreeBuffer());
+		CHECK(ring.GetFillIndex() == i);
+		ring.Submit();
+	}
+	// 満杯
+	CHECK(!ring.HasFreeBuffer());
+	CHECK(ring.GetQueuedCount() == kBufferCount);
+	// 1つ返ると、最初に渡したバッファが空く
+	ring.Release();
+	CHECK(ring.HasFreeBuffer() && ring.GetFillIndex() == 0);
+	// 何周しても番号は順に回る
+	uint32_t wrongCount = 0;
+	for (uint32_t i = 0; i < 100; i++) {
+		wrongCount += ring.GetFillIndex() != (kBufferCount + i) % kBufferCount;
+		ring.Submit();
+		ring.Release();
+	}
+	CHECK(wrongCount == 0);
+	while (ring.GetQueuedCount() > 0) {
+		ring.Release();
+	}
+	CHECK(ring.GetQueuedCount() == 0 && ring.HasFreeBuffer());
+	ring.Submit();
+	ring.Reset();
+	CHECK(ring.GetQueuedCount() == 0 && ring.GetFillIndex() == 0);
+}
+
+// 読み込みスレッドと再生スレッドの間でリングを回し、ループ再生の波形が順に届く
+void TestStreaming() {
+	WaveBuilder builder;
+	builder.Format();
+	builder.Data(1000);
+	builder.SampleLoop(100, 899);
+	std::string filePath = WriteWave("WaveStreamRingTest.wav", builder);
+	WaveStreamReader reader;
+	CHECK(reader.Open(filePath));
+
+	const size_t kChunkSize = kBlockAlign * 61;
+	const uint32_t kChunkCount = 2000;
+	std::vector<uint8_t> buffers[StreamBufferRing::kBufferCount];
+	for (std::vector<uint8_t>& buffer : buffers) {
+		buffer.resize(kChunkSize);
+	}
+	StreamBufferRing ring;
+	std::atomic<bool> failed{false};
+
+	// 読み込み側（Audioのストリーミングスレッドと同じ）
+	std::thread loader([&]() {
+		for (uint32_t n = 0; n < kChunkCount; n++) {
+			while (!ring.HasFreeBuffer()) {
+				std::this_thread::yield();
+			}
+			std::vector<uint8_t>& buffer = buffers[ring.GetFillIndex()];
+			if (reader.Read(buffer.data(), buffer.size(), true) != buffer.size()) {
+				failed = true;
+			}
+			ring.Submit();
+		}
+	});
+
+	// 再生側（XAudio2のバッファ終了コールバックと同じ順に使って返す）
+	std::vector<uint32_t> values;
+	for (uint32_t n = 0; n < kChunkCount; n++) {
+		while (ring.GetQueuedCount() == 0) {
+			std::this_thread::yield();
+		}
+		const std::vector<uint8_t>& buffer = buffers[n % StreamBufferRing::kBufferCount];
+		std::vector<uint32_t> read = GetFrameValues(buffer.data(), kChunkSize);
+		values.insert(values.end(), read.begin(), read.end());
+		ring.Release();
+	}
+	loader.join();
+	reader.Close();
+	std::filesystem::remove(filePath);
+
+	CHECK(!failed);
+	CHECK(values.size() == kChunkCount * kChunkSize / kBlockAlign);
+	uint32_t wrongCount = 0;
+	for (uint32_t i = 0; i < values.size(); i++) {
+		uint32_t expected = i < 900 ? i : 100 + (i - 900) % 800;
+		wrongCount += values[i] != expected;
+	}
+	CHECK(wrongCount == 0);
+}
+
+} // namespace
+
+int main() {
+	TestChunkBoundaries();
+	TestLoopWrap();
+	TestRing();
+	TestStreaming();
+	return Test::Finish("WaveStreamTest");
+}
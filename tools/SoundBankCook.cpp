@@ -0,0 +1,99 @@
+﻿// サウンドバンクを作るツール
+// ディレクトリ以下の.wavを全てまとめ、ディレクトリからの相対パス（区切りは/）を名前にする。
+// Audio::Initializeに渡すディレクトリ（Resources/など）から作れば、LoadWaveと同じ名前で引ける。
+//
+// 使い方: SoundBankCook <入力ディレクトリ> <出力ファイル> [--keep-compressed]
+//   --keep-compressed: IMA-ADPCMの波形を、読み込み時に展開せず再生時に展開する
+//
+// ビルド（開発者コマンドプロンプトでリポジトリのルートから）:
+//   cl /std:c++20 /EHsc /O2 /Iaudio tools\SoundBankCook.cpp audio\SoundBank.cpp
+//      audio\WaveParser.cpp audio\ImaAdpcm.cpp
+
+#include "SoundBank.h"
+#include "WaveParser.h"
+#include <algorithm>
+#include <cctype>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <vector>
+
+namespace {
+
+// ファイルの中身を全て読む
+bool ReadFile(const std::filesystem::path& path, std::vector<uint8_t>& data) {
+	std::ifstream file(path, std::ios_base::binary);
+	if (!file.is_open()) {
+		return false;
+	}
+	file.seekg(0, std::ios_base::end);
+	data.resize(static_cast<size_t>(file.tellg()));
+	file.seekg(0, std::ios_base::beg);
+	file.read(reinterpret_cast<char*>(data.data()), data.size());
+	return static_cast<size_t>(file.gcount()) == data.size();
+}
+
+// 拡張子が.wavか（大文字小文字を区別しない）
+bool IsWaveFile(const std::filesystem::path& path) {
+	std::string extension = path.extension().string();
+	std::transform(extension.begin(), extension.end(), extension.begin(), [](char c) {
+		return static_cast<char>(std::tolower(static_cast<unsigned char>(c)));
+	});
+	return extension == ".wav";
+}
+
+} // namespace
+
+int main(int argc, char* argv[]) {
+	if (argc < 3) {
+		std::cerr << "usage: SoundBankCook <input directory> <output file> [--keep-compressed]\n";
+		return 1;
+	}
+	std::filesystem::path inputDirectory = argv[1];
+	std::filesystem::path outputPath = argv[2];
+	bool keepCompressed = argc > 3 && std::string(argv[3]) == "--keep-compressed";
+
+	// 出力を毎回同じにするため、パスの順に並べる
+	std::vector<std::filesystem::path> paths;
+	for (const auto& item : std::filesystem::recursive_directory_iterator(inputDirectory)) {
+		if (item.is_regular_file() && IsWaveFile(item.path())) {
+			paths.push_back(item.path());
+		}
+	}
+	std::sort(paths.begin(), paths.end());
+
+	std::vector<SoundBank::Source> sources;
+	size_t skipCount = 0;
+	for (const auto& path : paths) {
+		std::vector<uint8_t> file;
+		WaveInfo info;
+		if (!ReadFile(path, file) || !WaveParser::Parse(file.data(), file.size(), info)) {
+			std::cerr << "skip: " << path.string() << "\n";
+			skipCount++;
+			continue;
+		}
+		SoundBank::Source source;
+		source.name = std::filesystem::relative(path, inputDirectory).generic_string();
+		source.format = info.format;
+		source.data.assign(
+		  file.begin() + static_cast<ptrdiff_t>(info.dataOffset),
+		  file.begin() + static_cast<ptrdiff_t>(info.dataOffset + info.dataSize));
+		source.frameCount = info.frameCount;
+		source.loopStart = info.loopStart;
+		source.loopEnd = info.loopEnd;
+		source.flags = keepCompressed ? SoundBank::kFlagKeepCompressed : 0;
+		sources.push_back(std::move(source));
+	}
+
+	std::vector<uint8_t> bank = SoundBank::Build(sources);
+	std::ofstream output(outputPath, std::ios_base::binary);
+	if (!output.is_open()) {
+		std::cerr << "cannot open " << outputPath.string() << "\n";
+		return 1;
+	}
+	output.write(reinterpret_cast<const char*>(bank.data()), bank.size());
+	std::cout << sources.size() << " waves (" << skipCount << " skipped), " << bank.size()
+	          << " bytes -> " << outputPath.string() << "\n";
+	return 0;
+}